@@ -4,7 +4,7 @@
  * @{
  * @file       WorldMagModel.c
  * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
- * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013-2014
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013-2015
  * @brief      Source file for the World Magnetic Model
  *             This is a port of code available from the US NOAA.
  *
@@ -22,6 +22,8 @@
  *                - Hard coded coefficients for model
  *                - Elimination of user interface
  *                - Elimination of dynamic memory allocation
+ *                - Coefficients for the date and Legendre functions are cached
+ *                - Grid of field values for cheap lookups along the flight path
  *
  * @see        The GNU Public License (GPL) Version 3
  *
@@ -61,6 +63,40 @@ static WMMtype_Ellipsoid        Ellip;
 static WMMtype_MagneticModel    MagneticModel;
 static float                    decimal_date;
 
+// Main field coefficients at decimal_date
+static bool                     date_valid;
+static float                    main_field_coeff_g[NUMTERMS];
+static float                    main_field_coeff_h[NUMTERMS];
+
+// Ratio between the Gauss and Schmidt quasi-normalized Legendre functions
+static bool                     schmidt_valid;
+static float                    schmidt_quasi_norm[NUMPCUP];
+
+// Legendre functions of the last geocentric latitude. Kept out of the
+// stack, they are the largest part of an evaluation.
+static bool                     legendre_valid;
+static float                    legendre_phig;
+static WMMtype_LegendreFunction legendre;
+
+// One grid cell, the field at its corners is interpolated in between
+#define WMM_GRID_SPACING        0.5f    // degrees between the corners
+#define WMM_GRID_ALTITUDE       2000.0f // altitude change (m) that refills the grid
+#define WMM_GRID_CORNERS        4
+#define WMM_GRID_COMPLETE       ((1 << WMM_GRID_CORNERS) - 1)
+
+struct wmm_grid {
+	int16_t  lat_idx;                       // south west corner in units of WMM_GRID_SPACING
+	int16_t  lon_idx;
+	float    alt;                           // altitude the corners were evaluated at (m)
+	float    B[WMM_GRID_CORNERS][3];        // SW, SE, NW, NE
+	uint8_t  valid;                         // corners evaluated so far
+};
+
+static struct wmm_grid          grid;           // used for lookups
+static struct wmm_grid          grid_pending;   // being filled in
+
+static int WMM_Field(float Lat, float Lon, float AltEllipsoid, float B[3]);
+
 /**************************************************************************************
 *   Example use - very simple - only two exposed functions
 *
@@ -70,6 +106,11 @@ static float                    decimal_date;
 *	e.g. Iceland in may of 2012 = WMM_GetMagVector(65.0, -20.0, 0.0, 5, 5, 2012, B);
 *	Alt is above the WGS-84 Ellipsoid
 *	B is the NED (XYZ) magnetic vector in nTesla
+*
+*	To follow the field along the flight path once the date is set:
+*
+*	WMM_UpdateGrid(Lat, Lon, Alt);          // at a low rate, evaluates one grid corner per call
+*	WMM_GetGridMagVector(Lat, Lon, Alt, B); // at navigation rate, interpolates the grid
 **************************************************************************************/
 
 int WMM_Initialize()
@@ -92,16 +133,77 @@ int WMM_Initialize()
 
 	// Must be updated periodically. Last update expires in 2020
 
+	// Compute the ratio between the Gauss-normalized associated Legendre
+	// functions and the Schmidt quasi-normalized version. This is equivalent to
+	// sqrt((m==0?1:2)*(n-m)!/(n+m!))*(2n-1)!!/(n-m)!
+	if (!schmidt_valid) {
+		uint16_t n, m, index, index1;
+
+		schmidt_quasi_norm[0] = 1.0;
+		for (n = 1; n <= MagneticModel.nMax; n++)
+		{
+			index = (n * (n + 1) / 2);
+			index1 = (n - 1) * n / 2;
+			/* for m = 0 */
+			schmidt_quasi_norm[index] = schmidt_quasi_norm[index1] * (float)(2 * n - 1) / (float)n;
+
+			for (m = 1; m <= n; m++)
+			{
+				index = (n * (n + 1) / 2 + m);
+				index1 = (n * (n + 1) / 2 + m - 1);
+				schmidt_quasi_norm[index] = schmidt_quasi_norm[index1] * sqrtf((float)((n - m + 1) * (m == 1 ? 2 : 1)) / (float)(n + m));
+			}
+		}
+		schmidt_valid = true;
+	}
+
 	return 0;                       // OK
 }
 
+int WMM_SetDate(uint16_t Month, uint16_t Day, uint16_t Year)
+//      Sets the date the field is computed for and the main field
+//      coefficients for that date. Nothing is done if the date didn't change.
+//      UPDATES : decimal_date, main_field_coeff_g and main_field_coeff_h
+{
+	static uint16_t last_month, last_day, last_year;
+
+	if (date_valid && Month == last_month && Day == last_day && Year == last_year)
+		return 0;
+
+	if (WMM_Initialize() < 0)
+		return -1;
+
+	if (WMM_DateToYear(Month, Day, Year) < 0)
+		return -2;
+
+	for (uint16_t index = 0; index < NUMTERMS; index++) {
+		main_field_coeff_g[index] = CoeffFile[index][2];
+		main_field_coeff_h[index] = CoeffFile[index][3];
+
+		// The model has no secular variation for the constant term
+		if (index > 0) {
+			main_field_coeff_g[index] += (decimal_date - MagneticModel.epoch) * CoeffFile[index][4];
+			main_field_coeff_h[index] += (decimal_date - MagneticModel.epoch) * CoeffFile[index][5];
+		}
+	}
+
+	last_month = Month;
+	last_day = Day;
+	last_year = Year;
+	date_valid = true;
+
+	// The grid was computed for another date
+	grid.valid = 0;
+	grid_pending.valid = 0;
+
+	return 0;
+}
+
 int WMM_GetMagVector(float Lat, float Lon, float AltEllipsoid, uint16_t Month, uint16_t Day, uint16_t Year, float B[3])
 {	
     // return '0' if all appears to be OK
     // return < 0 if error
 
-    int returned = 0;   // default to OK
-
     // ***********
     // range check supplied params
 
@@ -111,58 +213,175 @@ int WMM_GetMagVector(float Lat, float Lon, float AltEllipsoid, uint16_t Month, u
     if (Lon < -180) return -3;  // error
     if (Lon >  180) return -4;  // error
 
+    // ***********
 
-    WMMtype_CoordSpherical CoordSpherical;
-    WMMtype_CoordGeodetic CoordGeodetic;
-    WMMtype_GeoMagneticElements GeoMagneticElements;
+    if (WMM_SetDate(Month, Day, Year) < 0)
+        return -8;  // error
 
+    if (WMM_Field(Lat, Lon, AltEllipsoid, B) < 0)
+        return -9;  // error
 
-    // ***********
+    return 0;
+}
 
-    if (returned >= 0)
-    {
-        if (WMM_Initialize() < 0)
-            returned = -6;  // error
-    }
+int WMM_UpdateGrid(float Lat, float Lon, float AltEllipsoid)
+//      Moves the grid to the cell around a position, for the date set last.
+//      At most one corner of the cell is evaluated per call, so this can be
+//      called periodically from a control loop. Corners shared with the
+//      previous cell are reused.
+//      return 0 if the grid covers the position
+//      return 1 while the grid is still being filled in
+//      return < 0 if error
+{
+    if (Lat <  -90) return -1;  // error
+    if (Lat >   90) return -2;  // error
 
-    if (returned >= 0)
-    {
-        CoordGeodetic.lambda = Lon;
-        CoordGeodetic.phi = Lat;
-        CoordGeodetic.HeightAboveEllipsoid = AltEllipsoid/1000.0f; // convert to km
+    if (Lon < -180) return -3;  // error
+    if (Lon >  180) return -4;  // error
 
-        // Convert from geodeitic to Spherical Equations: 17-18, WMM Technical report
-        if (WMM_GeodeticToSpherical(&CoordGeodetic, &CoordSpherical) < 0)
-            returned = -7;  // error
+    if (!date_valid)
+        return -5;  // error
+
+    // The cell that contains the position, the last row and column include
+    // the pole and the date line
+    int16_t lat_idx = floorf(Lat / WMM_GRID_SPACING);
+    int16_t lon_idx = floorf(Lon / WMM_GRID_SPACING);
+    if (lat_idx > (int16_t)(90 / WMM_GRID_SPACING) - 1)
+        lat_idx = (int16_t)(90 / WMM_GRID_SPACING) - 1;
+    if (lon_idx > (int16_t)(180 / WMM_GRID_SPACING) - 1)
+        lon_idx = (int16_t)(180 / WMM_GRID_SPACING) - 1;
+
+    bool same_altitude = fabsf(AltEllipsoid - grid.alt) < WMM_GRID_ALTITUDE;
+
+    if (grid.valid == WMM_GRID_COMPLETE && same_altitude &&
+            grid.lat_idx == lat_idx && grid.lon_idx == lon_idx)
+        return 0;
+
+    if (grid_pending.valid == 0 || grid_pending.lat_idx != lat_idx || grid_pending.lon_idx != lon_idx ||
+            fabsf(AltEllipsoid - grid_pending.alt) >= WMM_GRID_ALTITUDE) {
+        grid_pending.lat_idx = lat_idx;
+        grid_pending.lon_idx = lon_idx;
+        grid_pending.valid = 0;
+
+        if (grid.valid == WMM_GRID_COMPLETE && same_altitude) {
+            // Reuse the corners the cells have in common
+            grid_pending.alt = grid.alt;
+            for (uint8_t c = 0; c < WMM_GRID_CORNERS; c++) {
+                int16_t lat_c = lat_idx + (c >> 1);
+                int16_t lon_c = lon_idx + (c & 1);
+                for (uint8_t d = 0; d < WMM_GRID_CORNERS; d++) {
+                    if (grid.lat_idx + (d >> 1) == lat_c && grid.lon_idx + (d & 1) == lon_c) {
+                        memcpy(grid_pending.B[c], grid.B[d], sizeof(grid.B[d]));
+                        grid_pending.valid |= 1 << c;
+                    }
+                }
+            }
+        } else {
+            grid_pending.alt = AltEllipsoid;
+        }
     }
 
+    // Evaluate the next corner, the southern ones first so the second
+    // one of a row uses the cached Legendre functions
+    for (uint8_t c = 0; c < WMM_GRID_CORNERS; c++) {
+        if (grid_pending.valid & (1 << c))
+            continue;
 
-    if (returned >= 0)
-    {
-        if (WMM_DateToYear(Month, Day, Year) < 0)
-            returned = -8;  // error
+        float lat_c = (lat_idx + (c >> 1)) * WMM_GRID_SPACING;
+        float lon_c = (lon_idx + (c & 1)) * WMM_GRID_SPACING;
+        if (WMM_Field(lat_c, lon_c, grid_pending.alt, grid_pending.B[c]) < 0)
+            return -9;  // error
+
+        grid_pending.valid |= 1 << c;
+        break;
     }
 
-    if (returned >= 0)
-    {
-        // Compute the geoMagnetic field elements and their time change
-        if (WMM_Geomag(&CoordSpherical, &CoordGeodetic, &GeoMagneticElements) < 0)
-            returned = -9;  // error
-        else
-        {   // set the returned values
-            B[0] = GeoMagneticElements.X;
-            B[1] = GeoMagneticElements.Y;
-            B[2] = GeoMagneticElements.Z;
-        }
+    if (grid_pending.valid != WMM_GRID_COMPLETE)
+        return 1;
+
+    grid = grid_pending;
+    grid_pending.valid = 0;
+
+    return 0;
+}
+
+int WMM_GetGridMagVector(float Lat, float Lon, float AltEllipsoid, float B[3])
+//      Interpolates the field from the grid. Cheap enough for every
+//      navigation update, WMM_UpdateGrid keeps the grid around the position.
+//      return 0 if the position is in the grid
+//      return 1 if the position is outside, B is from the closest edge
+//      return < 0 if the grid is not ready
+{
+    if (grid.valid != WMM_GRID_COMPLETE)
+        return -1;  // error
+
+    int returned = 0;
+
+    // Position in the cell, 0 to 1 from south west to north east
+    float x = Lon / WMM_GRID_SPACING - grid.lon_idx;
+    float y = Lat / WMM_GRID_SPACING - grid.lat_idx;
+
+    if (x < 0.0f || x > 1.0f || y < 0.0f || y > 1.0f) {
+        x = fminf(fmaxf(x, 0.0f), 1.0f);
+        y = fminf(fmaxf(y, 0.0f), 1.0f);
+        returned = 1;
     }
 
-	B[0] = GeoMagneticElements.X * 1e-2f;
-	B[1] = GeoMagneticElements.Y * 1e-2f;
-	B[2] = GeoMagneticElements.Z * 1e-2f;
+    // The field falls off about like a dipole away from the grid altitude
+    float ratio = (Ellip.re * 1000.0f + grid.alt) / (Ellip.re * 1000.0f + AltEllipsoid);
+    float scale = ratio * ratio * ratio;
+
+    for (uint8_t i = 0; i < 3; i++) {
+        float south = grid.B[0][i] + (grid.B[1][i] - grid.B[0][i]) * x;
+        float north = grid.B[2][i] + (grid.B[3][i] - grid.B[2][i]) * x;
+        B[i] = (south + (north - south) * y) * scale;
+    }
 
     return returned;
 }
 
+static int WMM_Field(float Lat, float Lon, float AltEllipsoid, float B[3])
+//      Computes the main field at a point for the date set last. The
+//      Legendre functions are reused when the latitude didn't change.
+{
+    WMMtype_CoordSpherical              CoordSpherical;
+    WMMtype_CoordGeodetic               CoordGeodetic;
+    WMMtype_SphericalHarmonicVariables  SphVariables;
+    WMMtype_MagneticResults             MagneticResultsSph;
+    WMMtype_MagneticResults             MagneticResultsGeo;
+
+    CoordGeodetic.lambda = Lon;
+    CoordGeodetic.phi = Lat;
+    CoordGeodetic.HeightAboveEllipsoid = AltEllipsoid/1000.0f; // convert to km
+
+    // Convert from geodeitic to Spherical Equations: 17-18, WMM Technical report
+    if (WMM_GeodeticToSpherical(&CoordGeodetic, &CoordSpherical) < 0)
+        return -1;  // error
+
+    if (WMM_ComputeSphericalHarmonicVariables(&CoordSpherical, MagneticModel.nMax, &SphVariables) < 0)
+        return -2;  // error
+
+    if (!legendre_valid || CoordSpherical.phig != legendre_phig) {
+        legendre_valid = false;
+        if (WMM_AssociatedLegendreFunction(&CoordSpherical, MagneticModel.nMax, &legendre) < 0)
+            return -3;  // error
+        legendre_phig = CoordSpherical.phig;
+        legendre_valid = true;
+    }
+
+    if (WMM_Summation(&legendre, &SphVariables, &CoordSpherical, &MagneticResultsSph) < 0)
+        return -4;  // error
+
+    if (WMM_RotateMagneticVector(&CoordSpherical, &CoordGeodetic, &MagneticResultsSph, &MagneticResultsGeo) < 0)
+        return -5;  // error
+
+    B[0] = MagneticResultsGeo.Bx * 1e-2f;
+    B[1] = MagneticResultsGeo.By * 1e-2f;
+    B[2] = MagneticResultsGeo.Bz * 1e-2f;
+
+    return 0;
+}
+
 int WMM_Geomag(WMMtype_CoordSpherical * CoordSpherical, WMMtype_CoordGeodetic * CoordGeodetic, WMMtype_GeoMagneticElements * GeoMagneticElements)
    /*
       The main subroutine that calls a sequence of WMM sub-functions to calculate the magnetic field elements for a single point.
@@ -195,7 +414,6 @@ int WMM_Geomag(WMMtype_CoordSpherical * CoordSpherical, WMMtype_CoordGeodetic *
     WMMtype_MagneticResults             MagneticResultsSphVar;
     WMMtype_MagneticResults             MagneticResultsGeoVar;
 
-    WMMtype_LegendreFunction            LegendreFunction;
     WMMtype_SphericalHarmonicVariables  SphVariables;
 
     // ********
@@ -206,21 +424,26 @@ int WMM_Geomag(WMMtype_CoordSpherical * CoordSpherical, WMMtype_CoordGeodetic *
             returned = -2;  // error
     }
 
-    if (returned >= 0)
-    {   // Compute ALF
-        if (WMM_AssociatedLegendreFunction(CoordSpherical, MagneticModel.nMax, &LegendreFunction) < 0)
+    if (returned >= 0 && (!legendre_valid || CoordSpherical->phig != legendre_phig))
+    {   // Compute ALF, unless the latitude didn't change
+        legendre_valid = false;
+        if (WMM_AssociatedLegendreFunction(CoordSpherical, MagneticModel.nMax, &legendre) < 0)
             returned = -3;  // error
+        else {
+            legendre_phig = CoordSpherical->phig;
+            legendre_valid = true;
+        }
     }
 
     if (returned >= 0)
     {   // Accumulate the spherical harmonic coefficients
-        if (WMM_Summation(&LegendreFunction, &SphVariables, CoordSpherical, &MagneticResultsSph) < 0)
+        if (WMM_Summation(&legendre, &SphVariables, CoordSpherical, &MagneticResultsSph) < 0)
             returned = -4;  // error
     }
 
     if (returned >= 0)
     {   // Sum the Secular Variation Coefficients
-        if (WMM_SecVarSummation(&LegendreFunction, &SphVariables, CoordSpherical, &MagneticResultsSphVar) < 0)
+        if (WMM_SecVarSummation(&legendre, &SphVariables, CoordSpherical, &MagneticResultsSphVar) < 0)
             returned = -5;  // error
     }
 
@@ -380,14 +603,16 @@ int WMM_Summation(WMMtype_LegendreFunction * LegendreFunction,
 		{
 			index = (n * (n + 1) / 2 + m);
 
+			/* Shared by the three components */
+			float gh_cos = main_field_coeff_g[index] * SphVariables->cos_mlambda[m] + main_field_coeff_h[index] * SphVariables->sin_mlambda[m];
+			float gh_sin = main_field_coeff_g[index] * SphVariables->sin_mlambda[m] - main_field_coeff_h[index] * SphVariables->cos_mlambda[m];
+
 /*		    nMax  	(n+2) 	  n     m            m           m
 	Bz =   -SUM (a/r)   (n+1) SUM  [g cos(m p) + h sin(m p)] P (sin(phi))
 			n=1      	      m=0   n            n           n  */
 /* Equation 12 in the WMM Technical report.  Derivative with respect to radius.*/
 			MagneticResults->Bz -=
-			    SphVariables->RelativeRadiusPower[n] *
-			    (WMM_get_main_field_coeff_g(index) *
-			     SphVariables->cos_mlambda[m] + WMM_get_main_field_coeff_h(index) * SphVariables->sin_mlambda[m])
+			    SphVariables->RelativeRadiusPower[n] * gh_cos
 			    * (float)(n + 1) * LegendreFunction->Pcup[index];
 
 /*		  1 nMax  (n+2)    n     m            m           m
@@ -395,9 +620,7 @@ int WMM_Summation(WMMtype_LegendreFunction * LegendreFunction,
 		   n=1             m=0   n            n           n  */
 /* Equation 11 in the WMM Technical report. Derivative with respect to longitude, divided by radius. */
 			MagneticResults->By +=
-			    SphVariables->RelativeRadiusPower[n] *
-			    (WMM_get_main_field_coeff_g(index) *
-			     SphVariables->sin_mlambda[m] - WMM_get_main_field_coeff_h(index) * SphVariables->cos_mlambda[m])
+			    SphVariables->RelativeRadiusPower[n] * gh_sin
 			    * (float)(m) * LegendreFunction->Pcup[index];
 /*		   nMax  (n+2) n     m            m           m
 	Bx = - SUM (a/r)   SUM  [g cos(m p) + h sin(m p)] dP (sin(phi))
@@ -405,9 +628,7 @@ int WMM_Summation(WMMtype_LegendreFunction * LegendreFunction,
 /* Equation 10  in the WMM Technical report. Derivative with respect to latitude, divided by radius. */
 
 			MagneticResults->Bx -=
-			    SphVariables->RelativeRadiusPower[n] *
-			    (WMM_get_main_field_coeff_g(index) *
-			     SphVariables->cos_mlambda[m] + WMM_get_main_field_coeff_h(index) * SphVariables->sin_mlambda[m])
+			    SphVariables->RelativeRadiusPower[n] * gh_cos
 			    * LegendreFunction->dPcup[index];
 
 		}
@@ -791,10 +1012,9 @@ int WMM_PcupLow(float *Pcup, float *dPcup, float x, uint16_t nMax)
 {
     uint16_t    n, m, index, index1, index2;
     float       k, z;
-    float schmidtQuasiNorm_s[NUMPCUP];
-    float       *schmidtQuasiNorm = schmidtQuasiNorm_s;
+    const float *schmidtQuasiNorm = schmidt_quasi_norm;
 
-    if (!schmidtQuasiNorm)
+    if (!schmidt_valid || nMax > MagneticModel.nMax)
     {
         return -1;
     }
@@ -844,27 +1064,6 @@ int WMM_PcupLow(float *Pcup, float *dPcup, float x, uint16_t nMax)
 			}
 		}
 	}
-/*Compute the ration between the Gauss-normalized associated Legendre
-  functions and the Schmidt quasi-normalized version. This is equivalent to
-  sqrt((m==0?1:2)*(n-m)!/(n+m!))*(2n-1)!!/(n-m)!  */
-
-	schmidtQuasiNorm[0] = 1.0;
-	for (n = 1; n <= nMax; n++)
-	{
-		index = (n * (n + 1) / 2);
-		index1 = (n - 1) * n / 2;
-		/* for m = 0 */
-		schmidtQuasiNorm[index] = schmidtQuasiNorm[index1] * (float)(2 * n - 1) / (float)n;
-
-		for (m = 1; m <= n; m++)
-		{
-			index = (n * (n + 1) / 2 + m);
-			index1 = (n * (n + 1) / 2 + m - 1);
-			schmidtQuasiNorm[index] = schmidtQuasiNorm[index1] * sqrtf((float)((n - m + 1) * (m == 1 ? 2 : 1)) / (float)(n + m));
-		}
-
-	}
-
 /* Converts the  Gauss-normalized associated Legendre
 	  functions to the Schmidt quasi-normalized version using pre-computed
 	  relation stored in the variable schmidtQuasiNorm */
@@ -903,10 +1102,10 @@ int WMM_SummationSpecial(WMMtype_SphericalHarmonicVariables *
     float       schmidtQuasiNorm2;
     float       schmidtQuasiNorm3;
 
-    float PcupsS_s[NUMPCUPS];
-    float       *PcupS = PcupsS_s;
-    if (!PcupS)
-        return -1;
+	float PcupsS_s[NUMPCUPS];
+	float       *PcupS = PcupsS_s;
+	if (!PcupS)
+		return -1;
 
 	PcupS[0] = 1;
 	schmidtQuasiNorm1 = 1.0;
@@ -968,10 +1167,10 @@ int WMM_SecVarSummationSpecial(WMMtype_SphericalHarmonicVariables *
     float       schmidtQuasiNorm2;
     float       schmidtQuasiNorm3;
 
-    float PcupsS_s[NUMPCUPS];
-    float       *PcupS = PcupsS_s;
-    if (!PcupS)
-        return -1;
+	float PcupsS_s[NUMPCUPS];
+	float       *PcupS = PcupsS_s;
+	if (!PcupS)
+		return -1;
 
 	PcupS[0] = 1;
 	schmidtQuasiNorm1 = 1.0;
@@ -1011,66 +1210,25 @@ int WMM_SecVarSummationSpecial(WMMtype_SphericalHarmonicVariables *
 }
 
 /**
- * @brief Comput the MainFieldCoeffH accounting for the date
+ * @brief Get the MainFieldCoeffG accounting for the date
  */
 float WMM_get_main_field_coeff_g(uint16_t index) 
 {	
 	if (index >= NUMTERMS)
 		return 0;
 
-    uint16_t n, m, sum_index, a, b;
-
-    float coeff = CoeffFile[index][2];
-	
-	a = MagneticModel.nMaxSecVar;
-	b = (a * (a + 1) / 2 + a);
-	for (n = 1; n <= MagneticModel.nMax; n++)
-	{
-		for (m = 0; m <= n; m++)
-		{
-			
-			sum_index = (n * (n + 1) / 2 + m);
-			
-			/* Hacky for now, will solve for which conditions need summing analytically */
-			if (sum_index != index)
-				continue;
-			
-			if (index <= b) 
-				coeff += (decimal_date - MagneticModel.epoch) * WMM_get_secular_var_coeff_g(sum_index);
-			
-		}
-	}
-	
-	return coeff;
+	return main_field_coeff_g[index];
 }
 
+/**
+ * @brief Get the MainFieldCoeffH accounting for the date
+ */
 float WMM_get_main_field_coeff_h(uint16_t index) 
 {	
 	if (index >= NUMTERMS)
 		return 0;
-	
-    uint16_t n, m, sum_index, a, b;
-	float coeff = CoeffFile[index][3];
-	
-	a = MagneticModel.nMaxSecVar;
-	b = (a * (a + 1) / 2 + a);
-	for (n = 1; n <= MagneticModel.nMax; n++)
-	{
-		for (m = 0; m <= n; m++)
-		{
-			
-			sum_index = (n * (n + 1) / 2 + m);
-			
-			/* Hacky for now, will solve for which conditions need summing analytically */
-			if (sum_index != index)
-				continue;
-			
-			if (index <= b) 
-				coeff += (decimal_date - MagneticModel.epoch) * WMM_get_secular_var_coeff_h(sum_index);
-		}
-	}
-	
-	return coeff;	
+
+	return main_field_coeff_h[index];
 }
 
 float WMM_get_secular_var_coeff_g(uint16_t index) 
@@ -5,7 +5,7 @@
  *
  * @file       WorldMagModel.h
  * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
- * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013-2015
  * @brief      Source file for the World Magnetic Model
  * @see        The GNU Public License (GPL) Version 3
  *
@@ -32,6 +32,9 @@
 	//  Exposed Function Prototypes
 int WMM_Initialize();
 int WMM_GetMagVector(float Lat, float Lon, float AltEllipsoid, uint16_t Month, uint16_t Day, uint16_t Year, float B[3]);
+int WMM_SetDate(uint16_t Month, uint16_t Day, uint16_t Year);
+int WMM_UpdateGrid(float Lat, float Lon, float AltEllipsoid);
+int WMM_GetGridMagVector(float Lat, float Lon, float AltEllipsoid, float B[3]);
 
 #endif /* WORLDMAGMODEL_H_ */
 
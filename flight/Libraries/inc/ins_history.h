@@ -0,0 +1,49 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       ins_history.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Recent INS states to fuse delayed measurements
+ * @see        The GNU Public License (GPL) Version 3
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef INS_HISTORY_H
+#define INS_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Keep the INS state every 10 ms for 230 ms, longer than the GPS latency
+#define INS_HISTORY_LENGTH    24
+#define INS_HISTORY_PERIOD_MS 10
+
+struct ins_history;
+
+struct ins_history *ins_history_create(uint8_t length, uint16_t period_ms);
+void ins_history_reset(struct ins_history *hist);
+void ins_history_push(struct ins_history *hist, uint32_t now_ms, const float pos[3], const float vel[3]);
+bool ins_history_get(struct ins_history *hist, uint32_t time_ms, float pos[3], float vel[3]);
+bool ins_history_shift(struct ins_history *hist, uint32_t time_ms,
+		const float pos_now[3], const float vel_now[3], float pos_meas[3], float vel_meas[3]);
+
+#endif // INS_HISTORY_H
+
+/**
+ * @}
+ */
@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       link_scheduler.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Shares the bandwidth of a telemetry port between messages
+ * @see        The GNU Public License (GPL) Version 3
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef LINK_SCHEDULER_H
+#define LINK_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Writes one message into buf with the current data.
+ * @param[out] buf      buffer for the message
+ * @param[in]  buf_len  size of the buffer
+ * @returns length of the message, 0 to skip it this time
+ */
+typedef uint16_t (*link_sched_pack)(uint8_t *buf, uint16_t buf_len);
+
+struct link_sched_stats {
+	uint32_t capacity;        // estimated link capacity in bytes/s
+	uint32_t bytes_sent;
+	uint32_t msgs_sent;
+	uint32_t msgs_late;       // messages sent more than twice their period apart
+	uint32_t tx_full;         // messages refused by the COM layer
+};
+
+struct link_sched;
+
+struct link_sched *link_sched_create(uintptr_t com_id, uint8_t max_producers, uint16_t max_msg_len);
+int32_t link_sched_add(struct link_sched *sched, link_sched_pack pack,
+		uint16_t period_ms, uint8_t priority, uint16_t size);
+void link_sched_run(struct link_sched *sched, uint32_t now_ms);
+void link_sched_get_stats(struct link_sched *sched, struct link_sched_stats *stats);
+
+#endif // LINK_SCHEDULER_H
+
+/**
+ * @}
+ */
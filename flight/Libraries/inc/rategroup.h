@@ -0,0 +1,72 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       rategroup.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Runs the periodic work of low priority modules on one thread
+ * @see        The GNU Public License (GPL) Version 3
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef RATEGROUP_H
+#define RATEGROUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Period of the fastest group, the others run every few of its ticks
+#define RATE_GROUP_TICK_MS 20
+
+enum rate_group {
+	RATE_GROUP_50HZ,
+	RATE_GROUP_10HZ,
+	RATE_GROUP_5HZ,
+	RATE_GROUP_2HZ,
+	RATE_GROUP_1HZ,
+	RATE_GROUP_NUM
+};
+
+/**
+ * One step of a module's periodic work. It must not block, all steps
+ * share the thread.
+ * @param[in] dT  period of the group in s
+ */
+typedef void (*rate_group_step)(float dT);
+
+struct rate_group_stats {
+	uint32_t wakeups;
+	uint32_t steps_run;
+	uint32_t overruns;      // wakeups that started after the next one was due
+};
+
+struct rate_group_exec;
+
+/* The executive the modules share */
+int32_t rate_group_add(enum rate_group group, rate_group_step step);
+void rate_group_get_stats(struct rate_group_stats *stats);
+
+/* The scheduling itself, without a thread */
+struct rate_group_exec *rate_group_exec_create(uint8_t max_steps);
+int32_t rate_group_exec_add(struct rate_group_exec *exec, enum rate_group group, rate_group_step step);
+uint32_t rate_group_exec_run(struct rate_group_exec *exec, uint32_t tick);
+
+#endif // RATEGROUP_H
+
+/**
+ * @}
+ */
@@ -30,6 +30,14 @@
 #include "taskinfo.h"
 #include "pios_thread.h"
 
+#if defined(DIAG_TASK_PROFILE)
+#include "taskprofile.h"
+
+#if TASKPROFILE_LATENCY_NUMELEM != PIOS_THREAD_PROFILE_BUCKETS || TASKPROFILE_RUNTIME_NUMELEM != PIOS_THREAD_PROFILE_BUCKETS
+#error "TaskProfile does not match PIOS_THREAD_PROFILE_BUCKETS"
+#endif
+#endif
+
 int32_t TaskMonitorInitialize(void);
 int32_t TaskMonitorAdd(TaskInfoRunningElem task, struct pios_thread *handlep);
 int32_t TaskMonitorRemove(TaskInfoRunningElem task);
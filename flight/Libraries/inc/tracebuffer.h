@@ -1,16 +1,12 @@
 /**
  ******************************************************************************
- * @addtogroup TauLabsModules Tau Labs Modules
- * @{ 
- * @addtogroup OveroSyncModule OveroSync Module
- * @{ 
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
  *
- * @file       overosync.h
- * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
- * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
- * @brief      Simulation for Overo sync
+ * @file       tracebuffer.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Reads the PiOS trace buffer out through the TraceData object
  * @see        The GNU Public License (GPL) Version 3
- *
  *****************************************************************************/
 /*
  * This program is free software; you can redistribute it and/or modify
@@ -27,15 +23,20 @@
  * with this program; if not, write to the Free Software Foundation, Inc.,
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
+#ifndef TRACEBUFFER_H
+#define TRACEBUFFER_H
 
-#ifndef OVEROSYNC_H
-#define OVEROSYNC_H
+#include "tracedata.h"
+#include "pios_trace.h"
 
-int32_t OveroSyncInitialize(void);
+int32_t TraceBufferInitialize(void);
+uint32_t TraceBufferFreeze(void);
+bool TraceBufferLoadChunk(uint16_t chunk);
+void TraceBufferResume(void);
 
-#endif /* OVEROSYNC_H */
+#endif // TRACEBUFFER_H
 
 /**
-  * @}
-  * @}
-  */
+ * @}
+ * @}
+ */
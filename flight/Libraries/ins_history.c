@@ -0,0 +1,194 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       ins_history.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Recent INS states to fuse delayed measurements
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * A GPS solution reaches the INS 100-200 ms after the receiver measured
+ * it. Fused as if it was measured now, the innovation also contains how
+ * far the vehicle moved since, which in dynamic flight is a large error.
+ *
+ * The history keeps the estimated position and velocity every period_ms
+ * in a ring. For a measurement with a known time the state at that time
+ * is interpolated from it, and the measurement is shifted by how much the
+ * state changed since:
+ *
+ *   z' = z + (x_now - x_then)   so   z' - x_now = z - x_then
+ *
+ * The filter then sees the innovation the measurement had at its own time
+ * and applies it to the current state with the current gain. That is the
+ * usual approximation of an out of sequence update: the covariance isn't
+ * kept, with 13-16 states a snapshot of it would take up to 1 kB, while a
+ * sample here is 28 bytes.
+ */
+
+#include "pios.h"
+#include "ins_history.h"
+
+struct ins_history_sample {
+	uint32_t time_ms;
+	float pos[3];
+	float vel[3];
+};
+
+struct ins_history {
+	struct ins_history_sample *samples;
+	uint8_t length;
+	uint8_t count;
+	uint8_t newest;
+	uint16_t period_ms;
+};
+
+/**
+ * Create a history
+ * @param[in] length     number of samples kept, covers length * period_ms
+ * @param[in] period_ms  time between the samples
+ * @returns the history or NULL if out of memory
+ */
+struct ins_history *ins_history_create(uint8_t length, uint16_t period_ms)
+{
+	if (length < 2)
+		return NULL;
+
+	struct ins_history *hist = PIOS_malloc(sizeof(*hist));
+	if (hist == NULL)
+		return NULL;
+
+	memset(hist, 0, sizeof(*hist));
+
+	hist->samples = PIOS_malloc(length * sizeof(*hist->samples));
+	if (hist->samples == NULL) {
+		PIOS_free(hist);
+		return NULL;
+	}
+
+	hist->length = length;
+	hist->period_ms = period_ms;
+
+	return hist;
+}
+
+/**
+ * Forget all samples, when the state was reset
+ */
+void ins_history_reset(struct ins_history *hist)
+{
+	hist->count = 0;
+}
+
+/**
+ * Store the current state if a period passed since the last sample
+ * @param[in] now_ms  current time
+ * @param[in] pos     estimated position
+ * @param[in] vel     estimated velocity
+ */
+void ins_history_push(struct ins_history *hist, uint32_t now_ms, const float pos[3], const float vel[3])
+{
+	if (hist->count > 0 && now_ms - hist->samples[hist->newest].time_ms < hist->period_ms)
+		return;
+
+	hist->newest = (hist->newest + 1) % hist->length;
+	if (hist->count < hist->length)
+		hist->count++;
+
+	struct ins_history_sample *s = &hist->samples[hist->newest];
+
+	s->time_ms = now_ms;
+	for (uint8_t i = 0; i < 3; i++) {
+		s->pos[i] = pos[i];
+		s->vel[i] = vel[i];
+	}
+}
+
+/**
+ * Get the state at a past time, interpolated between the samples
+ * @param[in]  time_ms  the time
+ * @param[out] pos      position at that time
+ * @param[out] vel      velocity at that time
+ * @returns false if the time isn't covered by the samples
+ */
+bool ins_history_get(struct ins_history *hist, uint32_t time_ms, float pos[3], float vel[3])
+{
+	if (hist->count < 2)
+		return false;
+
+	// Walk back from the newest sample to the first one that isn't later
+	uint8_t later = hist->newest;
+
+	if ((int32_t)(time_ms - hist->samples[later].time_ms) > 0)
+		return false;
+
+	for (uint8_t n = 1; n < hist->count; n++) {
+		uint8_t earlier = (later + hist->length - 1) % hist->length;
+		const struct ins_history_sample *a = &hist->samples[earlier];
+		const struct ins_history_sample *b = &hist->samples[later];
+
+		if ((int32_t)(time_ms - a->time_ms) >= 0) {
+			float f = (float)(time_ms - a->time_ms) / (float)(b->time_ms - a->time_ms);
+
+			for (uint8_t i = 0; i < 3; i++) {
+				pos[i] = a->pos[i] + f * (b->pos[i] - a->pos[i]);
+				vel[i] = a->vel[i] + f * (b->vel[i] - a->vel[i]);
+			}
+
+			return true;
+		}
+
+		later = earlier;
+	}
+
+	return false;
+}
+
+/**
+ * Move a delayed measurement to the current time
+ * @param[in]     time_ms   when the measurement was taken
+ * @param[in]     pos_now   current position estimate
+ * @param[in]     vel_now   current velocity estimate
+ * @param[in,out] pos_meas  measured position or NULL
+ * @param[in,out] vel_meas  measured velocity or NULL
+ * @returns false if the time isn't covered, the measurement is unchanged then
+ */
+bool ins_history_shift(struct ins_history *hist, uint32_t time_ms,
+		const float pos_now[3], const float vel_now[3], float pos_meas[3], float vel_meas[3])
+{
+	float pos_then[3], vel_then[3];
+
+	if (!ins_history_get(hist, time_ms, pos_then, vel_then))
+		return false;
+
+	for (uint8_t i = 0; i < 3; i++) {
+		if (pos_meas)
+			pos_meas[i] += pos_now[i] - pos_then[i];
+		if (vel_meas)
+			vel_meas[i] += vel_now[i] - vel_then[i];
+	}
+
+	return true;
+}
+
+/**
+ * @}
+ */
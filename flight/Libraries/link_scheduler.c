@@ -0,0 +1,329 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       link_scheduler.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Shares the bandwidth of a telemetry port between messages
+ * @see        The GNU Public License (GPL) Version 3
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * The bridges register a producer for each message they send, with the
+ * period it should be sent at, a priority and its typical size. Each call
+ * to link_sched_run() then:
+ *
+ * - estimates the link capacity from how much of the COM transmit buffer
+ *   drained since the last run. While data is left in the buffer the link
+ *   was busy and the drained amount is what it can carry, when the buffer
+ *   ran empty while messages were waiting the estimate is raised.
+ * - tops the transmit buffer up to LINK_SCHED_BACKLOG_MS worth of data, so
+ *   it never overflows and what is queued is never old
+ * - hands that budget to the due messages by their deficit counters: every
+ *   run a message waits it earns priority * LINK_SCHED_QUANTUM bytes of
+ *   credit, it can be sent once its credit covers its size and the one with
+ *   the most credit left over goes first. When no due message has enough
+ *   credit yet and there is budget left, all of them earn another round.
+ *   So on a fast link everything goes out at its own period, on a slow one
+ *   the high priority messages keep most of their rate and the low priority
+ *   ones are delayed, but as credit keeps growing while they wait they never
+ *   starve.
+ *
+ * Messages are packed when they are sent, so they always carry the latest
+ * data.
+ */
+
+#include "pios.h"
+#include "link_scheduler.h"
+
+//! Credit a message earns per run or round for each priority level, in bytes
+#define LINK_SCHED_QUANTUM          4
+//! Maximum number of extra rounds in one run
+#define LINK_SCHED_MAX_ROUNDS       32
+//! Limit of the credit, far above any message size
+#define LINK_SCHED_MAX_DEFICIT      0x7fff
+//! How much data is kept queued in the transmit buffer
+#define LINK_SCHED_BACKLOG_MS       50
+//! Capacity assumed before anything was measured, 1200 baud
+#define LINK_SCHED_INITIAL_CAPACITY 120
+
+struct link_sched_producer {
+	link_sched_pack pack;
+	uint16_t period_ms;
+	uint16_t size;
+	uint8_t priority;
+	bool due;
+	int32_t deficit;
+	uint32_t last_sent;
+	uint32_t next_due;          // when the message should be sent next
+};
+
+struct link_sched {
+	uintptr_t com_id;
+	uint8_t *buf;
+	uint16_t buf_len;
+
+	struct link_sched_producer *producers;
+	uint8_t num_producers;
+	uint8_t max_producers;
+	uint8_t next;               // producer the next round starts with
+
+	bool started;
+	bool limited;               // the last run had to leave due messages waiting
+	uint32_t last_run;
+	uint16_t last_used;         // transmit buffer level after the last run
+
+	struct link_sched_stats stats;
+};
+
+/**
+ * Create a scheduler for a COM port
+ * @param[in] com_id         the port
+ * @param[in] max_producers  number of messages that can be registered
+ * @param[in] max_msg_len    size of the largest message
+ * @returns the scheduler or NULL if out of memory
+ */
+struct link_sched *link_sched_create(uintptr_t com_id, uint8_t max_producers, uint16_t max_msg_len)
+{
+	struct link_sched *sched = PIOS_malloc(sizeof(*sched));
+	if (sched == NULL)
+		return NULL;
+
+	memset(sched, 0, sizeof(*sched));
+
+	sched->producers = PIOS_malloc(max_producers * sizeof(*sched->producers));
+	sched->buf = PIOS_malloc(max_msg_len);
+	if (sched->producers == NULL || sched->buf == NULL) {
+		PIOS_free(sched->producers);
+		PIOS_free(sched->buf);
+		PIOS_free(sched);
+		return NULL;
+	}
+
+	sched->com_id = com_id;
+	sched->buf_len = max_msg_len;
+	sched->max_producers = max_producers;
+	sched->stats.capacity = LINK_SCHED_INITIAL_CAPACITY;
+
+	return sched;
+}
+
+/**
+ * Register a message
+ * @param[in] sched      the scheduler
+ * @param[in] pack       writes the message
+ * @param[in] period_ms  how often the message should be sent
+ * @param[in] priority   share of the bandwidth when the link is short, at least 1
+ * @param[in] size       typical length of the message
+ * @returns 0 on success, -1 if there is no room for it
+ */
+int32_t link_sched_add(struct link_sched *sched, link_sched_pack pack,
+		uint16_t period_ms, uint8_t priority, uint16_t size)
+{
+	if (sched == NULL || sched->num_producers >= sched->max_producers)
+		return -1;
+
+	struct link_sched_producer *p = &sched->producers[sched->num_producers];
+
+	p->pack = pack;
+	p->period_ms = period_ms;
+	p->size = (size > 0) ? size : 1;
+	p->priority = (priority > 0) ? priority : 1;
+	p->due = false;
+	p->deficit = 0;
+	p->last_sent = 0;
+	p->next_due = 0;
+
+	sched->num_producers++;
+
+	return 0;
+}
+
+/**
+ * Give a due message its credit for one run or round
+ */
+static void earn_credit(struct link_sched_producer *p)
+{
+	p->deficit += p->priority * LINK_SCHED_QUANTUM;
+	if (p->deficit > LINK_SCHED_MAX_DEFICIT)
+		p->deficit = LINK_SCHED_MAX_DEFICIT;
+}
+
+/**
+ * Update the capacity estimate from the transmit buffer level
+ */
+static void update_capacity(struct link_sched *sched, uint32_t now_ms, uint16_t used)
+{
+	uint32_t dt = now_ms - sched->last_run;
+
+	if (!sched->started || dt == 0)
+		return;
+
+	uint32_t drained = (sched->last_used > used) ? sched->last_used - used : 0;
+	uint32_t rate = drained * 1000 / dt;
+
+	if (used > 0 && sched->last_used > 0) {
+		// The link was busy all the time, what drained is what it can carry
+		sched->stats.capacity = (3 * sched->stats.capacity + rate) / 4;
+	} else if (sched->limited) {
+		// The buffer ran empty while messages were waiting, try more
+		if (rate > sched->stats.capacity)
+			sched->stats.capacity = rate;
+		sched->stats.capacity += sched->stats.capacity / 4 + 1;
+	}
+
+	if (sched->stats.capacity < LINK_SCHED_INITIAL_CAPACITY / 4)
+		sched->stats.capacity = LINK_SCHED_INITIAL_CAPACITY / 4;
+}
+
+/**
+ * Send the messages that are due as far as the link allows. Call this
+ * periodically, at least as often as the shortest message period.
+ * @param[in] sched   the scheduler
+ * @param[in] now_ms  current time
+ */
+void link_sched_run(struct link_sched *sched, uint32_t now_ms)
+{
+	if (sched == NULL || sched->num_producers == 0)
+		return;
+
+	uint16_t used = PIOS_COM_GetTxUsed(sched->com_id);
+	uint16_t tx_free = PIOS_COM_GetTxFree(sched->com_id);
+
+	update_capacity(sched, now_ms, used);
+
+	// Keep LINK_SCHED_BACKLOG_MS of data queued, but always let one
+	// message through when the buffer is empty
+	int32_t budget = (int32_t) (sched->stats.capacity * LINK_SCHED_BACKLOG_MS / 1000) - used;
+	if (used == 0 && budget < sched->buf_len)
+		budget = sched->buf_len;
+	if (budget > tx_free)
+		budget = tx_free;
+
+	bool any_due = false;
+
+	for (uint8_t i = 0; i < sched->num_producers; i++) {
+		struct link_sched_producer *p = &sched->producers[i];
+
+		// Against the deadline rather than the last send, so a run that
+		// comes a tick late doesn't push the message back a whole period
+		if (p->period_ms > 0 && (!sched->started || (int32_t) (now_ms - p->next_due) >= 0)) {
+			p->due = true;
+			any_due = true;
+			earn_credit(p);
+		} else {
+			p->due = false;
+			p->deficit = 0;
+		}
+	}
+
+	bool limited = false;
+	uint8_t rounds = 0;
+
+	while (any_due) {
+		struct link_sched_producer *best = NULL;
+		uint8_t best_idx = 0;
+
+		any_due = false;
+
+		// Starting at the rotation point so ties are served in turn
+		for (uint8_t k = 0; k < sched->num_producers; k++) {
+			uint8_t idx = (sched->next + k) % sched->num_producers;
+			struct link_sched_producer *p = &sched->producers[idx];
+
+			if (!p->due)
+				continue;
+
+			any_due = true;
+
+			if (p->deficit >= p->size &&
+			    (best == NULL || p->deficit - p->size > best->deficit - best->size)) {
+				best = p;
+				best_idx = idx;
+			}
+		}
+
+		if (best == NULL) {
+			if (!any_due || budget <= 0 || rounds++ >= LINK_SCHED_MAX_ROUNDS)
+				break;
+
+			for (uint8_t i = 0; i < sched->num_producers; i++) {
+				if (sched->producers[i].due)
+					earn_credit(&sched->producers[i]);
+			}
+			continue;
+		}
+
+		// The best message waits for the next run rather than being
+		// overtaken by smaller ones, so it can't starve
+		if (best->size > budget) {
+			limited = true;
+			break;
+		}
+
+		uint16_t len = best->pack(sched->buf, sched->buf_len);
+
+		if (len > 0) {
+			if (len > tx_free ||
+			    PIOS_COM_SendBufferNonBlocking(sched->com_id, sched->buf, len) != len) {
+				sched->stats.tx_full++;
+				limited = true;
+				break;
+			}
+
+			budget -= len;
+			tx_free -= len;
+			sched->stats.bytes_sent += len;
+			sched->stats.msgs_sent++;
+			if (sched->started && now_ms - best->last_sent > 2 * best->period_ms)
+				sched->stats.msgs_late++;
+		}
+
+		best->deficit = 0;
+		best->due = false;
+		best->last_sent = now_ms;
+
+		// Keep the cadence, unless the link held the message back so
+		// long that it would have to catch up
+		best->next_due += best->period_ms;
+		if ((int32_t) (now_ms - best->next_due) >= 0)
+			best->next_due = now_ms + best->period_ms;
+		sched->next = (best_idx + 1) % sched->num_producers;
+	}
+
+	sched->limited = limited;
+	sched->started = true;
+	sched->last_run = now_ms;
+	sched->last_used = PIOS_COM_GetTxUsed(sched->com_id);
+}
+
+/**
+ * Get the statistics of a scheduler
+ */
+void link_sched_get_stats(struct link_sched *sched, struct link_sched_stats *stats)
+{
+	if (sched == NULL)
+		return;
+
+	*stats = sched->stats;
+}
+
+/**
+ * @}
+ */
@@ -28,6 +28,7 @@
 
 #include "atmospheric_math.h" 		/* API declarations */
 #include "physical_constants.h"
+#include "fastmath.h"
 
 /**
  * @brief air_density_from_altitude calculate air density from altitude. http://en.wikipedia.org/wiki/Density_of_air
@@ -53,7 +54,7 @@ float air_density_from_altitude(float altitude, struct AirParameters *air)
  */
 float air_pressure_from_altitude(float altitude, struct AirParameters *air)
 {
-	float pressure = air->sea_level_press* powf(1 - air->temperature_lapse_rate*altitude / air->air_temperature_at_surface, GRAVITY*air->M / (air->univ_gas_constant*air->temperature_lapse_rate));
+	float pressure = air->sea_level_press* fast_powf(1 - air->temperature_lapse_rate*altitude / air->air_temperature_at_surface, GRAVITY*air->M / (air->univ_gas_constant*air->temperature_lapse_rate));
 
 	return pressure;
 }
@@ -36,6 +36,7 @@
 #include <stdint.h>
 #include "coordinate_conversions.h"
 #include "physical_constants.h"
+#include "fastmath.h"
 
 // ****** find ECEF to NED rotation matrix ********
 void RneFromLLA(float LLA[3], float Rne[3][3])
@@ -73,9 +74,10 @@ void Quaternion2RPY(const float q[4], float rpy[3])
 	R23 = 2.0f * (q[2] * q[3] + q[0] * q[1]);
 	R33 = q0s - q1s - q2s + q3s;
 
-	rpy[1] = RAD2DEG * asinf(-R13);	// pitch always between -pi/2 to pi/2
-	rpy[2] = RAD2DEG * atan2f(R12, R11);
-	rpy[0] = RAD2DEG * atan2f(R23, R33);
+	// The approximations are within 1e-3 deg
+	rpy[1] = RAD2DEG * fast_asinf(-R13);	// pitch always between -pi/2 to pi/2
+	rpy[2] = RAD2DEG * fast_atan2f(R12, R11);
+	rpy[0] = RAD2DEG * fast_atan2f(R23, R33);
 
 	//TODO: consider the cases where |R13| ~= 1, |pitch| ~= pi/2
 }
@@ -0,0 +1,186 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ * @addtogroup TauLabsMath Tau Labs math support libraries
+ * @{
+ *
+ * @file       fastmath.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Fast approximations of the transcendental functions
+ *
+ * Polynomial approximations that replace the newlib functions where a
+ * small, known error is acceptable. Each function states its maximum
+ * error, which flight/tests/fastmath checks against libm over the stated
+ * range, so a call site can pick the one that fits its accuracy needs.
+ * The polynomials are minimax fits, evaluated with Horner's scheme.
+ *
+ * Inputs that are NaN or out of the stated range give undefined results.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define FASTMATH_PI   3.14159265358979f
+#define FASTMATH_PI_2 1.57079632679490f
+
+/**
+ * @brief Fast atan2f
+ * Max error 1.5e-5 rad for all finite inputs, atan2(0, 0) is 0.
+ */
+static inline float fast_atan2f(float y, float x)
+{
+	const float ax = fabsf(x), ay = fabsf(y);
+	const float max = ax > ay ? ax : ay;
+	const float min = ax > ay ? ay : ax;
+
+	if (max == 0.0f)
+		return 0.0f;
+
+	// atan on [0, 1], then use the symmetries for the other octants
+	const float a = min / max;
+	const float s = a * a;
+	float r = a * (0.99986633f + s * (-0.33030480f + s * (0.18015930f +
+			s * (-0.08515633f + s * 0.02084510f))));
+
+	if (ay > ax)
+		r = FASTMATH_PI_2 - r;
+	if (x < 0)
+		r = FASTMATH_PI - r;
+	if (y < 0)
+		r = -r;
+
+	return r;
+}
+
+/**
+ * @brief Fast asinf
+ * Max error 1.5e-5 rad, the input is clamped to [-1, 1].
+ */
+static inline float fast_asinf(float x)
+{
+	if (x > 1.0f)
+		x = 1.0f;
+	else if (x < -1.0f)
+		x = -1.0f;
+
+	return fast_atan2f(x, sqrtf(1.0f - x * x));
+}
+
+/**
+ * @brief Fast sinf
+ * Max error 2e-6 for |x| <= 8 pi, growing with |x| because of the
+ * reduction to [-pi, pi].
+ */
+static inline float fast_sinf(float x)
+{
+	// Remove whole turns, then fold into [-pi/2, pi/2]
+	float turns = x * (0.5f / FASTMATH_PI);
+	turns = (float)(int32_t)(turns + (turns >= 0 ? 0.5f : -0.5f));
+	float r = x - turns * (2 * FASTMATH_PI);
+
+	if (r > FASTMATH_PI_2)
+		r = FASTMATH_PI - r;
+	else if (r < -FASTMATH_PI_2)
+		r = -FASTMATH_PI - r;
+
+	const float s = r * r;
+	return r * (0.99999662f + s * (-0.16664828f + s * (0.00830633f + s * -0.00018364f)));
+}
+
+/**
+ * @brief Fast cosf
+ * Max error 2e-6 for |x| <= 8 pi, like fast_sinf.
+ */
+static inline float fast_cosf(float x)
+{
+	return fast_sinf(x + FASTMATH_PI_2);
+}
+
+/**
+ * @brief Fast log2f
+ * Max error 3e-6 for 2^-16 <= x <= 2^16. Over all positive, normal x it
+ * is 8e-6, the rounding of results up to 126.
+ */
+static inline float fast_log2f(float x)
+{
+	union {
+		float f;
+		uint32_t i;
+	} u;
+	u.f = x;
+
+	// x = 2^e * (1 + m) with m in [0, 1)
+	const float e = (float)((int32_t)((u.i >> 23) & 0xff) - 127);
+	u.i = (u.i & 0x007fffff) | 0x3f800000;
+	const float m = u.f - 1.0f;
+
+	return e + m * (1.44255313f + m * (-0.71828178f + m * (0.45827016f +
+			m * (-0.27953685f + m * (0.12345031f + m * -0.02645705f)))));
+}
+
+/**
+ * @brief Fast exp2f
+ * Max relative error 4e-6 for -126 <= x < 128, 0 below that range.
+ */
+static inline float fast_exp2f(float x)
+{
+	if (x < -126.0f)
+		return 0.0f;
+
+	// x = i + f with f in [0, 1), 2^i goes straight into the exponent
+	int32_t i = (int32_t)x;
+	if (x < i)
+		i--;
+	const float f = x - i;
+
+	union {
+		float f;
+		uint32_t i;
+	} u;
+	u.i = (uint32_t)(i + 127) << 23;
+
+	return u.f * (1.00000370f + f * (0.69296612f + f * (0.24163844f +
+			f * (0.05169037f + f * 0.01369766f))));
+}
+
+/**
+ * @brief Fast powf for a positive base
+ * Max relative error 1.5e-5 while the result stays within 2^-16 and
+ * 2^16, the error of the log grows with the exponent. powf(0, y) is 0.
+ */
+static inline float fast_powf(float x, float y)
+{
+	if (x == 0.0f)
+		return 0.0f;
+
+	return fast_exp2f(y * fast_log2f(x));
+}
+
+#endif /* FASTMATH_H */
+
+/**
+ * @}
+ * @}
+ */
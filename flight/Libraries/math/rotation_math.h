@@ -0,0 +1,157 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ * @addtogroup TauLabsMath Tau Labs math support libraries
+ * @{
+ *
+ * @file       rotation_math.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Inline quaternion and rotation kernels
+ *
+ * Header only so the compiler can inline the kernels into the sensor and
+ * attitude loops and keep the intermediate values in registers. They use
+ * the conventions of coordinate_conversions.c: q = [q0 q1 q2 q3] with the
+ * scalar first, and Rbe = Quaternion2R(q) rotates from earth to body frame.
+ *
+ * The expressions are written as multiply-accumulate chains, which the
+ * Cortex-M4 FPU computes with fused multiply-adds. The integer SIMD
+ * instructions of the M4 DSP extension don't apply to single precision.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ROTATION_MATH_H
+#define ROTATION_MATH_H
+
+#include <stdbool.h>
+#include <math.h>
+
+/**
+ * @brief Normalize a quaternion in place
+ * @returns the magnitude before normalizing, the caller should check it
+ * isn't zero or NaN
+ */
+static inline float quat_normalize(float q[4])
+{
+	float qmag = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+	float inv_qmag = 1.0f / qmag;
+
+	q[0] *= inv_qmag;
+	q[1] *= inv_qmag;
+	q[2] *= inv_qmag;
+	q[3] *= inv_qmag;
+
+	return qmag;
+}
+
+/**
+ * @brief Take a first order step of the attitude and normalize it
+ * @param[in,out] q attitude quaternion
+ * @param[in] rates body rates in rad/s
+ * @param[in] dT time step in s
+ * @returns the magnitude before normalizing, the caller should check it
+ * isn't zero or NaN
+ */
+static inline float quat_integrate_normalize(float q[4], const float rates[3], float dT)
+{
+	const float h = 0.5f * dT;
+	const float wx = rates[0] * h, wy = rates[1] * h, wz = rates[2] * h;
+	const float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+
+	q[0] = q0 - q1 * wx - q2 * wy - q3 * wz;
+	q[1] = q1 + q0 * wx - q3 * wy + q2 * wz;
+	q[2] = q2 + q3 * wx + q0 * wy - q1 * wz;
+	q[3] = q3 - q2 * wx + q1 * wy + q0 * wz;
+
+	return quat_normalize(q);
+}
+
+/**
+ * @brief Rotate a vector from earth to body frame with a unit quaternion,
+ * the same as rot_mult(Rbe, v, out, false) without building Rbe
+ * @param[in] q unit quaternion
+ * @param[in] v vector in earth frame
+ * @param[out] out vector in body frame, must not be v
+ */
+static inline void quat_rotate(const float q[4], const float v[3], float out[3])
+{
+	// t = 2 (v x u), out = v + q0 t + t x u with u the vector part of q
+	const float t0 = 2 * (v[1] * q[3] - v[2] * q[2]);
+	const float t1 = 2 * (v[2] * q[1] - v[0] * q[3]);
+	const float t2 = 2 * (v[0] * q[2] - v[1] * q[1]);
+
+	out[0] = v[0] + q[0] * t0 + t1 * q[3] - t2 * q[2];
+	out[1] = v[1] + q[0] * t1 + t2 * q[1] - t0 * q[3];
+	out[2] = v[2] + q[0] * t2 + t0 * q[2] - t1 * q[1];
+}
+
+/**
+ * @brief Rotate a vector from body to earth frame with a unit quaternion,
+ * the same as rot_mult(Rbe, v, out, true) without building Rbe
+ * @param[in] q unit quaternion
+ * @param[in] v vector in body frame
+ * @param[out] out vector in earth frame, must not be v
+ */
+static inline void quat_rotate_transpose(const float q[4], const float v[3], float out[3])
+{
+	// t = 2 (u x v), out = v + q0 t + u x t with u the vector part of q
+	const float t0 = 2 * (q[2] * v[2] - q[3] * v[1]);
+	const float t1 = 2 * (q[3] * v[0] - q[1] * v[2]);
+	const float t2 = 2 * (q[1] * v[1] - q[2] * v[0]);
+
+	out[0] = v[0] + q[0] * t0 + q[2] * t2 - q[3] * t1;
+	out[1] = v[1] + q[0] * t1 + q[3] * t0 - q[1] * t2;
+	out[2] = v[2] + q[0] * t2 + q[1] * t1 - q[2] * t0;
+}
+
+/**
+ * @brief Calibrate and rotate a sensor sample in one pass,
+ * out = R * (in .* scale - bias) or R' * (in .* scale - bias)
+ * @param[in] R rotation matrix (first index is row)
+ * @param[in] in raw sample
+ * @param[in] scale scale of each axis
+ * @param[in] bias bias of each axis after scaling
+ * @param[out] out calibrated and rotated sample, must not be in
+ * @param[in] transpose If false use R, else if true use R'
+ */
+static inline void rot_mult_scale_bias(const float R[3][3], const float in[3], const float scale[3],
+		const float bias[3], float out[3], bool transpose)
+{
+	const float v0 = in[0] * scale[0] - bias[0];
+	const float v1 = in[1] * scale[1] - bias[1];
+	const float v2 = in[2] * scale[2] - bias[2];
+
+	if (!transpose) {
+		out[0] = R[0][0] * v0 + R[0][1] * v1 + R[0][2] * v2;
+		out[1] = R[1][0] * v0 + R[1][1] * v1 + R[1][2] * v2;
+		out[2] = R[2][0] * v0 + R[2][1] * v1 + R[2][2] * v2;
+	} else {
+		out[0] = R[0][0] * v0 + R[1][0] * v1 + R[2][0] * v2;
+		out[1] = R[0][1] * v0 + R[1][1] * v1 + R[2][1] * v2;
+		out[2] = R[0][2] * v0 + R[1][2] * v1 + R[2][2] * v2;
+	}
+}
+
+#endif /* ROTATION_MATH_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -12,6 +12,10 @@ extern "C" {
  *
  */
 
+#if defined(MAVLINK_USE_PIOS_CRC)
+#include "pios_crc.h"
+#endif
+
 #define X25_INIT_CRC 0xffff
 #define X25_VALIDATE_CRC 0xf0b8
 
@@ -54,12 +58,17 @@ static inline void crc_init(uint16_t* crcAccum)
  **/
 static inline uint16_t crc_calculate(const uint8_t* pBuffer, uint16_t length)
 {
+#if defined(MAVLINK_USE_PIOS_CRC)
+	/* Same CRC as the X.25 one, PIOS_CRC16 processes whole buffers faster */
+	return PIOS_CRC16_updateCRC(X25_INIT_CRC, pBuffer, length);
+#else
         uint16_t crcTmp;
         crc_init(&crcTmp);
 	while (length--) {
                 crc_accumulate(*pBuffer++, &crcTmp);
         }
         return crcTmp;
+#endif
 }
 
 /**
@@ -74,9 +83,13 @@ static inline uint16_t crc_calculate(const uint8_t* pBuffer, uint16_t length)
 static inline void crc_accumulate_buffer(uint16_t *crcAccum, const char *pBuffer, uint8_t length)
 {
 	const uint8_t *p = (const uint8_t *)pBuffer;
+#if defined(MAVLINK_USE_PIOS_CRC)
+	*crcAccum = PIOS_CRC16_updateCRC(*crcAccum, p, length);
+#else
 	while (length--) {
                 crc_accumulate(*p++, crcAccum);
         }
+#endif
 }
 
 
@@ -0,0 +1,248 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       rategroup.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Runs the periodic work of low priority modules on one thread
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * Instead of a thread with its own stack that sleeps between runs, a low
+ * priority module can register a step function in one of the rate groups
+ * from its start function. All steps run on a single thread:
+ *
+ * - time is counted in ticks of the fastest group, a group runs on the
+ *   ticks that are a multiple of its divider. So the slower groups run on
+ *   ticks of the 10 Hz one, always after the faster groups, and the thread
+ *   only wakes up when a group is due.
+ * - the thread is created with the first step, a target without any
+ *   registered step doesn't pay for it.
+ * - the stack has to fit the deepest step, not the sum of them. Steps must
+ *   not block and should be short, a slow step delays all the others. When
+ *   a run takes longer than the wait for the next one the executive catches
+ *   up and counts an overrun.
+ *
+ * Steps are only added, from the module start functions which run one
+ * after another, so the thread can read the table without a lock. A step
+ * added while the thread sleeps starts with its next wakeup.
+ */
+
+#include "openpilot.h"
+#include "pios_thread.h"
+#include "rategroup.h"
+
+// Private constants
+#if !defined(RATE_GROUP_MAX_STEPS)
+#define RATE_GROUP_MAX_STEPS         8
+#endif
+
+#if defined(PIOS_RATEGROUP_STACK_SIZE)
+#define STACK_SIZE_BYTES             PIOS_RATEGROUP_STACK_SIZE
+#else
+#define STACK_SIZE_BYTES             600
+#endif /* PIOS_RATEGROUP_STACK_SIZE */
+
+#define TASK_PRIORITY                PIOS_THREAD_PRIO_LOW
+
+//! Ticks between the runs of each group
+static const uint8_t group_divider[RATE_GROUP_NUM] = {
+	[RATE_GROUP_50HZ] = 1,
+	[RATE_GROUP_10HZ] = 5,
+	[RATE_GROUP_5HZ]  = 10,
+	[RATE_GROUP_2HZ]  = 25,
+	[RATE_GROUP_1HZ]  = 50,
+};
+
+struct rate_group_entry {
+	rate_group_step step;
+	enum rate_group group;
+};
+
+struct rate_group_exec {
+	struct rate_group_entry *steps;
+	volatile uint8_t num_steps;
+	uint8_t max_steps;
+
+	struct rate_group_stats stats;
+};
+
+// Private variables
+static struct rate_group_exec *shared_exec;
+static struct pios_thread *rateGroupTaskHandle;
+
+// Private functions
+static void rateGroupTask(void *parameters);
+
+/**
+ * Register a step with the shared executive, starting it if needed
+ * @param[in] group  how often the step runs
+ * @param[in] step   the step
+ * @returns 0 on success, -1 if it can't be added
+ */
+int32_t rate_group_add(enum rate_group group, rate_group_step step)
+{
+	if (shared_exec == NULL) {
+		shared_exec = rate_group_exec_create(RATE_GROUP_MAX_STEPS);
+		if (shared_exec == NULL)
+			return -1;
+	}
+
+	if (rate_group_exec_add(shared_exec, group, step) != 0)
+		return -1;
+
+	if (rateGroupTaskHandle == NULL) {
+		rateGroupTaskHandle = PIOS_Thread_Create(rateGroupTask, "RateGroups", STACK_SIZE_BYTES, NULL, TASK_PRIORITY);
+		TaskMonitorAdd(TASKINFO_RUNNING_RATEGROUPS, rateGroupTaskHandle);
+	}
+
+	return 0;
+}
+
+/**
+ * Get the statistics of the shared executive
+ */
+void rate_group_get_stats(struct rate_group_stats *stats)
+{
+	if (shared_exec == NULL) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+
+	*stats = shared_exec->stats;
+}
+
+/**
+ * Create an executive
+ * @param[in] max_steps  number of steps that can be registered
+ * @returns the executive or NULL if out of memory
+ */
+struct rate_group_exec *rate_group_exec_create(uint8_t max_steps)
+{
+	struct rate_group_exec *exec = PIOS_malloc(sizeof(*exec));
+	if (exec == NULL)
+		return NULL;
+
+	memset(exec, 0, sizeof(*exec));
+
+	exec->steps = PIOS_malloc(max_steps * sizeof(*exec->steps));
+	if (exec->steps == NULL) {
+		PIOS_free(exec);
+		return NULL;
+	}
+
+	exec->max_steps = max_steps;
+
+	return exec;
+}
+
+/**
+ * Register a step
+ * @param[in] exec   the executive
+ * @param[in] group  how often the step runs
+ * @param[in] step   the step
+ * @returns 0 on success, -1 if there is no room for it
+ */
+int32_t rate_group_exec_add(struct rate_group_exec *exec, enum rate_group group, rate_group_step step)
+{
+	if (exec == NULL || step == NULL || group >= RATE_GROUP_NUM ||
+			exec->num_steps >= exec->max_steps)
+		return -1;
+
+	struct rate_group_entry *entry = &exec->steps[exec->num_steps];
+
+	entry->step = step;
+	entry->group = group;
+
+	// Only visible to the thread once it is complete
+	exec->num_steps++;
+
+	return 0;
+}
+
+/**
+ * Run the groups that are due in a tick, fastest group first
+ * @param[in] exec  the executive
+ * @param[in] tick  the current tick
+ * @returns the next tick a group with steps is due
+ */
+uint32_t rate_group_exec_run(struct rate_group_exec *exec, uint32_t tick)
+{
+	const uint8_t num_steps = exec->num_steps;
+	uint32_t next = UINT32_MAX;
+
+	exec->stats.wakeups++;
+
+	for (enum rate_group group = 0; group < RATE_GROUP_NUM; group++) {
+		const uint8_t divider = group_divider[group];
+		bool used = false;
+
+		for (uint8_t i = 0; i < num_steps; i++) {
+			struct rate_group_entry *entry = &exec->steps[i];
+
+			if (entry->group != group)
+				continue;
+
+			used = true;
+
+			if (tick % divider == 0) {
+				entry->step(divider * RATE_GROUP_TICK_MS / 1000.0f);
+				exec->stats.steps_run++;
+			}
+		}
+
+		if (used) {
+			uint32_t group_next = (tick / divider + 1) * divider;
+			if (group_next < next)
+				next = group_next;
+		}
+	}
+
+	// Nothing registered, check again on the next tick
+	if (next == UINT32_MAX)
+		next = tick + 1;
+
+	return next;
+}
+
+/**
+ * Executive task. It does not return.
+ */
+static void rateGroupTask(void *parameters)
+{
+	uint32_t tick = 0;
+	uint32_t lastSysTime = PIOS_Thread_Systime();
+
+	while (true) {
+		uint32_t next = rate_group_exec_run(shared_exec, tick);
+		uint32_t wait_ms = (next - tick) * RATE_GROUP_TICK_MS;
+
+		if (PIOS_Thread_Systime() - lastSysTime >= wait_ms)
+			shared_exec->stats.overruns++;
+
+		PIOS_Thread_Sleep_Until(&lastSysTime, wait_ms);
+		tick = next;
+	}
+}
+
+/**
+ * @}
+ */
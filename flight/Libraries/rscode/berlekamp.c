@@ -38,36 +38,30 @@
 #include <stdio.h>
 #include "ecc.h"
 
-/* The Error Locator Polynomial, also known as Lambda or Sigma. Lambda[0] == 1 */
-static int Lambda[MAXDEG];
-
-/* The Error Evaluator Polynomial */
-static int Omega[MAXDEG];
+/* All the state of the decoder is on the stack, so that more than one
+ * radio can decode at the same time.
+ *
+ * Lambda is the Error Locator Polynomial, also known as Sigma. Lambda[0] == 1
+ * Omega is the Error Evaluator Polynomial
+ */
 
 /* local ANSI declarations */
 static int compute_discrepancy(int lambda[], int S[], int L, int n);
-static void init_gamma(int gamma[]);
-static void compute_modified_omega (void);
+static void init_gamma(int gamma[], int NErasures, int ErasureLocs[]);
+static void compute_modified_omega (int synBytes[], int Lambda[], int Omega[]);
 static void mul_z_poly (int src[]);
 
-/* error locations found using Chien's search*/
-static int ErrorLocs[256];
-static int NErrors;
-
-/* erasure flags */
-static int ErasureLocs[256];
-static int NErasures;
-
 /* From  Cain, Clark, "Error-Correction Coding For Digital Communications", pp. 216. */
-void
-Modified_Berlekamp_Massey (void)
+static void
+Modified_Berlekamp_Massey (int synBytes[], int NErasures, int ErasureLocs[],
+			   int Lambda[], int Omega[])
 {	
   int n, L, L2, k, d, i;
   int psi[MAXDEG], psi2[MAXDEG], D[MAXDEG];
   int gamma[MAXDEG];
 	
   /* initialize Gamma, the erasure locator polynomial */
-  init_gamma(gamma);
+  init_gamma(gamma, NErasures, ErasureLocs);
 
   /* initialize to z */
   copy_poly(D, gamma);
@@ -102,7 +96,7 @@ Modified_Berlekamp_Massey (void)
   }
 	
   for(i = 0; i < MAXDEG; i++) Lambda[i] = psi[i];
-  compute_modified_omega();
+  compute_modified_omega(synBytes, Lambda, Omega);
 
 	
 }
@@ -111,8 +105,8 @@ Modified_Berlekamp_Massey (void)
    compute the combined erasure/error evaluator polynomial as 
    Psi*S mod z^4
   */
-void
-compute_modified_omega ()
+static void
+compute_modified_omega (int synBytes[], int Lambda[], int Omega[])
 {
   int i;
   int product[MAXDEG*2];
@@ -149,8 +143,8 @@ mult_polys (int dst[], int p1[], int p2[])
 
 	
 /* gamma = product (1-z*a^Ij) for erasure locs Ij */
-void
-init_gamma (int gamma[])
+static void
+init_gamma (int gamma[], int NErasures, int ErasureLocs[])
 {
   int e, tmp[MAXDEG];
 	
@@ -230,14 +224,17 @@ static void mul_z_poly (int src[])
  * Lambda[j] by evaluating Lambda at successive values of alpha. 
  * 
  * This can be tested with the decoder's equations case.
+ *
+ * Returns the number of roots. The search stops after RS_ECC_NPARITY+1
+ * roots, more can not be corrected anyway.
  */
 
 
-void 
-Find_Roots (void)
+static int
+Find_Roots (int Lambda[], int ErrorLocs[])
 {
   int sum, r, k;	
-  NErrors = 0;
+  int NErrors = 0;
   
   for (r = 1; r < 256; r++) {
     sum = 0;
@@ -249,15 +246,17 @@ Find_Roots (void)
       { 
 	ErrorLocs[NErrors] = (255-r); NErrors++; 
 	//if (DEBUG) fprintf(stderr, "Root found at r = %d, (255-r) = %d\n", r, (255-r));
+	if (NErrors > RS_ECC_NPARITY) break;
       }
   }
+  return NErrors;
 }
 
 /* Combined Erasure And Error Magnitude Computation 
  * 
- * Pass in the codeword, its size in bytes, as well as
- * an array of any known erasure locations, along the number
- * of these erasures.
+ * Pass in the decoder state from decode_data(), the codeword,
+ * its size in bytes, as well as an array of any known erasure
+ * locations, along the number of these erasures.
  * 
  * Evaluate Omega(actually Psi)/Lambda' at the roots
  * alpha^(-i) for error locs i. 
@@ -267,24 +266,33 @@ Find_Roots (void)
  */
 
 int
-correct_errors_erasures (unsigned char codeword[], 
+correct_errors_erasures (struct ecc_decoder *dec,
+			 unsigned char codeword[], 
 			 int csize,
 			 int nerasures,
 			 int erasures[])
 {
   int r, i, j, err;
+  int Lambda[MAXDEG];
+  int Omega[MAXDEG];
+  int ErrorLocs[RS_ECC_NPARITY+1];
+  int ErrorVals[RS_ECC_NPARITY+1];
+  int NErrors, degree;
+  struct ecc_decoder check;
 
   /* If you want to take advantage of erasure correction, be sure to
-     set NErasures and ErasureLocs[] with the locations of erasures. 
+     pass in erasures[] with the locations of erasures. 
      */
-  NErasures = nerasures;
-  for (i = 0; i < NErasures; i++) ErasureLocs[i] = erasures[i];
+  if (nerasures > RS_ECC_NPARITY) return(0);
 
-  Modified_Berlekamp_Massey();
-  Find_Roots();
+  Modified_Berlekamp_Massey(dec->synBytes, nerasures, erasures, Lambda, Omega);
+  NErrors = Find_Roots(Lambda, ErrorLocs);
   
+  /* Lambda must have as many roots as its degree, otherwise there
+     were more errors than can be corrected */
+  for (degree = MAXDEG-1; degree > 0 && Lambda[degree] == 0; degree--);
 
-  if ((NErrors <= RS_ECC_NPARITY) && NErrors > 0) { 
+  if ((NErrors <= RS_ECC_NPARITY) && NErrors > 0 && NErrors == degree) { 
 
     /* first check for illegal error locs */
     for (r = 0; r < NErrors; r++) {
@@ -313,6 +321,14 @@ correct_errors_erasures (unsigned char codeword[],
       //if (DEBUG) fprintf(stderr, "Error magnitude %#x at loc %d\n", err, csize-i);
       
       codeword[csize-i-1] ^= err;
+      ErrorVals[r] = err;
+    }
+
+    /* the result must be a codeword, else put the errors back */
+    decode_data(&check, codeword, csize);
+    if (check_syndrome(&check)) {
+      for (r = 0; r < NErrors; r++) codeword[csize-ErrorLocs[r]-1] ^= ErrorVals[r];
+      return(0);
     }
     return(1);
   }
@@ -60,20 +60,30 @@ typedef unsigned short BIT16;
 /* Maximum degree of various polynomials. */
 #define MAXDEG (RS_ECC_NPARITY*2)
 
-/*************************************/
-/* Encoder parity bytes */
-extern int pBytes[MAXDEG];
+/* The encoder keeps all parity bytes of its LFSR in one word */
+#if RS_ECC_NPARITY <= 4
+typedef uint32_t ecc_word_t;
+#elif RS_ECC_NPARITY <= 8
+typedef uint64_t ecc_word_t;
+#else
+#error "RS_ECC_NPARITY is limited to 8"
+#endif
 
-/* Decoder syndrome bytes */
-extern int synBytes[MAXDEG];
+/*************************************/
+/* Decoder state from decode_data() for check_syndrome() and
+ * correct_errors_erasures(). Each user of the decoder has its own. */
+struct ecc_decoder {
+  int synBytes[MAXDEG];		/* syndrome bytes */
+  int nonzero;			/* any syndrome byte is not zero */
+};
 
 /* print debugging info */
 extern int DEBUG;
 
 /* Reed Solomon encode/decode routines */
 void initialize_ecc (void);
-int check_syndrome (void);
-void decode_data (unsigned char data[], int nbytes);
+int check_syndrome (const struct ecc_decoder *dec);
+void decode_data (struct ecc_decoder *dec, unsigned char data[], int nbytes);
 void encode_data (unsigned char msg[], int nbytes, unsigned char dst[]);
 
 /* CRC-CCITT checksum generator */
@@ -89,7 +99,7 @@ int gmult(int a, int b);
 
 
 /* Error location routines */
-int correct_errors_erasures (unsigned char codeword[], int csize,int nerasures, int erasures[]);
+int correct_errors_erasures (struct ecc_decoder *dec, unsigned char codeword[], int csize, int nerasures, int erasures[]);
 
 /* polynomial arithmetic */
 void add_polys(int dst[], int src[]) ;
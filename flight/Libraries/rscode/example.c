@@ -79,6 +79,7 @@ main (int argc, char *argv[])
  
   int erasures[16];
   int nerasures = 0;
+  struct ecc_decoder dec;
 
   /* Initialization the ECC library */
  
@@ -111,11 +112,12 @@ main (int argc, char *argv[])
 
  
   /* Now decode -- encoded codeword size must be passed */
-  decode_data(codeword, ML);
+  decode_data(&dec, codeword, ML);
 
   /* check if syndrome is all zeros */
-  if (check_syndrome () != 0) {
-    correct_errors_erasures (codeword, 
+  if (check_syndrome (&dec) != 0) {
+    correct_errors_erasures (&dec,
+			     codeword, 
 			     ML,
 			     nerasures, 
 			     erasures);
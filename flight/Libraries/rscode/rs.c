@@ -27,16 +27,21 @@
 
 #include <stdio.h>
 #include <ctype.h>
+#include <string.h>
 #include "ecc.h"
 
-/* Encoder parity bytes */
-int pBytes[MAXDEG];
+/* generator polynomial */
+static int genPoly[MAXDEG*2];
 
-/* Decoder syndrome bytes */
-int synBytes[MAXDEG];
+/* Product of every byte with each generator coefficient, coefficient j
+ * in byte j of the entry. The LFSR of the encoder steps a whole byte
+ * with one lookup. */
+static ecc_word_t genTable[256];
 
-/* generator polynomial */
-int genPoly[MAXDEG*2];
+/* a^(-(j+1)*NPARITY), turns the LFSR remainder into syndrome j */
+static int synScale[RS_ECC_NPARITY];
+
+static int initialized = FALSE;
 
 int DEBUG = FALSE;
 
@@ -47,11 +52,27 @@ compute_genpoly (int nbytes, int genpoly[]);
 void
 initialize_ecc ()
 {
+  int i, j;
+
+  if (initialized) return;
+
   /* Initialize the galois field arithmetic tables */
     init_galois_tables();
 
     /* Compute the encoder generator polynomial */
     compute_genpoly(RS_ECC_NPARITY, genPoly);
+
+    for (i = 0; i < 256; i++) {
+      ecc_word_t entry = 0;
+      for (j = 0; j < RS_ECC_NPARITY; j++)
+	entry |= (ecc_word_t)gmult(genPoly[j], i) << (8 * j);
+      genTable[i] = entry;
+    }
+
+    for (j = 0; j < RS_ECC_NPARITY; j++)
+      synScale[j] = gexp[(255 - ((j + 1) * RS_ECC_NPARITY) % 255) % 255];
+
+    initialized = TRUE;
 }
 
 void
@@ -61,92 +82,62 @@ zero_fill_from (unsigned char buf[], int from, int to)
   for (i = from; i < to; i++) buf[i] = 0;
 }
 
-/* debugging routines */
-void
-print_parity (void)
+/* Run the LFSR over some bytes. Returns the remainder of the bytes
+ * times x^NPARITY divided by the generator polynomial, coefficient j
+ * in byte j. */
+static ecc_word_t
+run_lfsr (const unsigned char data[], int nbytes)
 {
-#ifdef NEVER
+  ecc_word_t lfsr = 0;
   int i;
-  printf("Parity Bytes: ");
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    printf("[%d]:%x, ",i,pBytes[i]);
-  printf("\n");
-#endif
-}
 
+  for (i = 0; i < nbytes; i++) {
+    unsigned char dbyte = data[i] ^ (unsigned char)(lfsr >> (8 * (RS_ECC_NPARITY - 1)));
+    lfsr = (lfsr << 8) ^ genTable[dbyte];
+  }
 
-void
-print_syndrome (void)
-{
-#ifdef NEVER
-  int i;
-  printf("Syndrome Bytes: ");
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    printf("[%d]:%x, ",i,synBytes[i]);
-  printf("\n");
+#if RS_ECC_NPARITY != 4 && RS_ECC_NPARITY != 8
+  lfsr &= ((ecc_word_t)1 << (8 * RS_ECC_NPARITY)) - 1;
 #endif
+  return lfsr;
 }
 
-/* Append the parity bytes onto the end of the message */
-void
-build_codeword (unsigned char msg[], int nbytes, unsigned char dst[])
-{
-  int i;
-	
-  for (i = 0; i < nbytes; i++) dst[i] = msg[i];
-	
-  for (i = 0; i < RS_ECC_NPARITY; i++) {
-    dst[i+nbytes] = pBytes[RS_ECC_NPARITY-1-i];
-  }
-}
-	
 /**********************************************************
  * Reed Solomon Decoder 
  *
  * Computes the syndrome of a codeword. Puts the results
- * into the synBytes[] array.
+ * into the synBytes[] array of the decoder.
+ *
+ * A codeword is a multiple of the generator polynomial, whose roots
+ * are a^1 .. a^NPARITY. So the syndromes are the remainder of the
+ * LFSR evaluated at the roots, and a zero remainder needs no more work.
  */
  
 void
-decode_data(unsigned char data[], int nbytes)
+decode_data(struct ecc_decoder *dec, unsigned char data[], int nbytes)
 {
-  int i, j, sum;
+  int j, k, sum;
+  ecc_word_t remainder = run_lfsr(data, nbytes);
+
+  memset(dec->synBytes, 0, sizeof(dec->synBytes));
+  dec->nonzero = (remainder != 0);
+  if (!dec->nonzero) return;
+
   for (j = 0; j < RS_ECC_NPARITY;  j++) {
-    sum	= 0;
-    for (i = 0; i < nbytes; i++) {
-      sum = data[i] ^ gmult(gexp[j+1], sum);
+    sum = 0;
+    for (k = RS_ECC_NPARITY - 1; k >= 0; k--) {
+      sum = ((remainder >> (8 * k)) & 0xff) ^ gmult(gexp[j+1], sum);
     }
-    synBytes[j]  = sum;
+    dec->synBytes[j] = gmult(sum, synScale[j]);
   }
 }
 
 
 /* Check if the syndrome is zero */
 int
-check_syndrome (void)
+check_syndrome (const struct ecc_decoder *dec)
 {
- int i, nz = 0;
- for (i =0 ; i < RS_ECC_NPARITY; i++) {
-  if (synBytes[i] != 0) {
-      nz = 1;
-      break;
-  }
- }
- return nz;
-}
-
-
-void
-debug_check_syndrome (void)
-{	
-#ifdef NEVER
-  int i;
-	
-  for (i = 0; i < 3; i++) {
-    printf(" inv log S[%d]/S[%d] = %d\n", i, i+1, 
-	   glog[gmult(synBytes[i], ginv(synBytes[i+1]))]);
-  }
-#endif
+ return dec->nonzero;
 }
 
 
@@ -179,29 +170,21 @@ compute_genpoly (int nbytes, int genpoly[])
 /* Simulate a LFSR with generator polynomial for n byte RS code. 
  * Pass in a pointer to the data array, and amount of data. 
  *
- * The parity bytes are deposited into pBytes[], and the whole message
- * and parity are copied to dest to make a codeword.
+ * The whole message and the parity bytes are copied to dest to
+ * make a codeword. msg and dst may be the same buffer.
  * 
  */
 
 void
 encode_data (unsigned char msg[], int nbytes, unsigned char dst[])
 {
-  int i, LFSR[RS_ECC_NPARITY+1],dbyte, j;
-	
-  for(i=0; i < RS_ECC_NPARITY+1; i++) LFSR[i]=0;
+  int i;
+  ecc_word_t parity = run_lfsr(msg, nbytes);
 
-  for (i = 0; i < nbytes; i++) {
-    dbyte = msg[i] ^ LFSR[RS_ECC_NPARITY-1];
-    for (j = RS_ECC_NPARITY-1; j > 0; j--) {
-      LFSR[j] = LFSR[j-1] ^ gmult(genPoly[j], dbyte);
-    }
-    LFSR[0] = gmult(genPoly[0], dbyte);
-  }
+  if (dst != msg) memmove(dst, msg, nbytes);
 
-  for (i = 0; i < RS_ECC_NPARITY; i++) 
-    pBytes[i] = LFSR[i];
-	
-  build_codeword(msg, nbytes, dst);
+  for (i = 0; i < RS_ECC_NPARITY; i++) {
+    dst[i+nbytes] = (unsigned char)(parity >> (8 * (RS_ECC_NPARITY - 1 - i)));
+  }
 }
 
@@ -37,6 +37,9 @@
 static struct pios_mutex *lock;
 static struct pios_thread *handles[TASKINFO_RUNNING_NUMELEM];
 static uint32_t lastMonitorTime;
+#if defined(DIAG_TASK_PROFILE)
+static uint32_t profileTask;
+#endif
 
 // Private functions
 
@@ -157,6 +160,30 @@ void TaskMonitorUpdateAll(void)
 	// Update object
 	TaskInfoSet(&data);
 
+#if defined(DIAG_TASK_PROFILE)
+	// Send the profile of the next running task
+	for (n = 0; n < TASKINFO_RUNNING_NUMELEM; ++n)
+	{
+		profileTask = (profileTask + 1) % TASKINFO_RUNNING_NUMELEM;
+
+		struct pios_thread_profile profile;
+		if (handles[profileTask] != 0 && PIOS_Thread_Get_Profile(handles[profileTask], &profile))
+		{
+			TaskProfileData profileData;
+
+			profileData.Task = profileTask;
+			memcpy(profileData.Latency, profile.latency, sizeof(profileData.Latency));
+			memcpy(profileData.Runtime, profile.runtime, sizeof(profileData.Runtime));
+			profileData.Activations = profile.activations;
+			profileData.Preemptions = profile.preemptions;
+			profileData.MaxLatency = profile.max_latency;
+			profileData.MaxRuntime = profile.max_runtime;
+			TaskProfileSet(&profileData);
+			break;
+		}
+	}
+#endif
+
 	// Done
 	PIOS_Mutex_Unlock(lock);
 #endif
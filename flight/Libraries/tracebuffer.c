@@ -0,0 +1,145 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsLibraries Tau Labs Libraries
+ * @{
+ *
+ * @file       tracebuffer.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Reads the PiOS trace buffer out through the TraceData object
+ * @see        The GNU Public License (GPL) Version 3
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "openpilot.h"
+
+#if defined(PIOS_INCLUDE_TRACE)
+
+#include "tracebuffer.h"
+#include "tracecontrol.h"
+
+// The event names sent to the GCS come from the TraceData object
+typedef char trace_ids_match_tracedata[
+	(TRACEDATA_EVENT_EVENTDISPATCH == PIOS_TRACE_EVENT_DISPATCH &&
+	 PIOS_TRACE_NUM_IDS == PIOS_TRACE_EVENT_DISPATCH + 1) ? 1 : -1] __attribute__((unused));
+
+// Private variables
+static uint32_t frozen_count;
+static uint32_t oldest_time;
+
+// Private functions
+static void traceControlUpdated(UAVObjEvent *ev);
+
+/**
+ * Initialize library
+ */
+int32_t TraceBufferInitialize(void)
+{
+	if (TraceDataInitialize() != 0 || TraceControlInitialize() != 0)
+		return -1;
+
+	TraceControlConnectCallback(traceControlUpdated);
+
+	return 0;
+}
+
+/**
+ * Stop recording so the trace can be read out in chunks
+ * \returns number of events in the trace
+ */
+uint32_t TraceBufferFreeze(void)
+{
+	struct pios_trace_event event;
+
+	frozen_count = PIOS_Trace_Freeze();
+	if (PIOS_Trace_Get(0, &event))
+		oldest_time = event.time;
+
+	return frozen_count;
+}
+
+/**
+ * Copy one chunk of a frozen trace to the TraceData object
+ * \param[in] chunk the chunk to copy, TRACEDATA_EVENT_NUMELEM events each
+ * \returns false if the chunk is past the end of the trace, the object
+ * is still updated so the reader learns the number of events
+ */
+bool TraceBufferLoadChunk(uint16_t chunk)
+{
+	TraceDataData data;
+	struct pios_trace_event event;
+	uint32_t first = chunk * TRACEDATA_EVENT_NUMELEM;
+
+	memset(&data, 0, sizeof(data));
+	data.Index = first;
+	data.Count = frozen_count;
+
+	for (uint32_t i = 0; i < TRACEDATA_EVENT_NUMELEM; i++) {
+		if (!PIOS_Trace_Get(first + i, &event))
+			break;
+
+		data.Time[i] = PIOS_DELAY_DiffuS2(oldest_time, event.time);
+		data.Data[i] = event.data;
+		data.Event[i] = event.id < PIOS_TRACE_NUM_IDS ? event.id : PIOS_TRACE_NONE;
+	}
+
+	TraceDataSet(&data);
+
+	return first < frozen_count;
+}
+
+/**
+ * Clear the trace and start recording again
+ */
+void TraceBufferResume(void)
+{
+	frozen_count = 0;
+	PIOS_Trace_Resume();
+}
+
+/**
+ * Execute the operation requested through TraceControl
+ */
+static void traceControlUpdated(UAVObjEvent *ev)
+{
+	TraceControlData control;
+
+	(void) ev;
+
+	TraceControlGet(&control);
+
+	switch (control.Operation) {
+	case TRACECONTROL_OPERATION_FREEZE:
+		TraceBufferFreeze();
+		TraceBufferLoadChunk(0);
+		break;
+	case TRACECONTROL_OPERATION_READ:
+		TraceBufferLoadChunk(control.Chunk);
+		break;
+	case TRACECONTROL_OPERATION_RESUME:
+		TraceBufferResume();
+		break;
+	default:
+		break;
+	}
+}
+
+#endif /* PIOS_INCLUDE_TRACE */
+
+/**
+ * @}
+ * @}
+ */
@@ -205,6 +205,8 @@ static void actuatorTask(void* parameters)
 			continue;
 		}
 
+		PIOS_Trace(PIOS_TRACE_ACTUATOR_START, 0);
+
 		// Check how long since last update
 		thisSysTime = PIOS_Thread_Systime();
 		if(thisSysTime > lastSysTime) // reuse dt in case of wraparound
@@ -379,6 +381,8 @@ static void actuatorTask(void* parameters)
 		PIOS_Servo_Update();
 #endif
 
+		PIOS_Trace(PIOS_TRACE_ACTUATOR_END, success);
+
 		if(!success) {
 			command.NumFailedUpdates++;
 			ActuatorCommandSet(&command);
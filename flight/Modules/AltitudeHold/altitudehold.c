@@ -43,6 +43,7 @@
 #include "openpilot.h"
 #include "physical_constants.h"
 #include "misc_math.h"
+#include "fastmath.h"
 #include "pid.h"
 
 #include "attitudeactual.h"
@@ -228,8 +229,9 @@ static void altitudeHoldTask(void *parameters)
 				                 attitudeActual.q4 * attitudeActual.q4;
 
 				// Add ability to scale up the amount of compensation to achieve
-				// level forward flight
-				fraction = powf(fraction, (float) altitudeHoldSettings.AttitudeComp / 100.0f);
+				// level forward flight. A negative fraction is left to the check below.
+				if (fraction > 0.0f)
+					fraction = fast_powf(fraction, (float) altitudeHoldSettings.AttitudeComp / 100.0f);
 
 				// Dividing by the fraction remaining in the vertical projection will
 				// attempt to compensate for tilt. This acts like the thrust is linear
@@ -53,7 +53,9 @@
 #include "misc_math.h"
 #include "physical_constants.h"
 #include "coordinate_conversions.h"
+#include "rotation_math.h"
 #include "WorldMagModel.h"
+#include "ins_history.h"
 
 // UAVOs
 #include "accels.h"
@@ -142,6 +144,9 @@ static struct pios_queue *baroQueue;
 static struct pios_queue *gpsQueue;
 static struct pios_queue *gpsVelQueue;
 
+//! Recent INS states to fuse the GPS at the time it was received
+static struct ins_history *ins_history;
+
 static AttitudeSettingsData attitudeSettings;
 static HomeLocationData homeLocation;
 static INSSettingsData insSettings;
@@ -168,6 +173,7 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 static int32_t setAttitudeComplementary();
 
 static float calc_ned_accel(float *q, float *accels);
+static void shift_to_measurement_time(uint32_t receive_time, float *pos, float *vel);
 static void cfvert_reset(struct cfvert *cf, float baro, float time_constant);
 static void cfvert_predict_pos(struct cfvert *cf, float z_accel, float dt);
 static void cfvert_update_baro(struct cfvert *cf, float baro, float dt);
@@ -200,6 +206,9 @@ static void set_state_estimation_error(SystemAlarmsStateEstimationOptions error_
 //! Determine if it is safe to set the home location then do it
 static void check_home_location();
 
+//! Follow the earth magnetic field along the flight path
+static void update_mag_north(GPSPositionData *gpsPosition);
+
 /**
  * API for sensor fusion algorithms:
  * Configure(struct pios_queue *gyro, struct pios_queue *accel, struct pios_queue *mag, struct pios_queue *baro)
@@ -252,6 +261,8 @@ int32_t AttitudeStart(void)
 	gpsQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
 	gpsVelQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
 
+	ins_history = ins_history_create(INS_HISTORY_LENGTH, INS_HISTORY_PERIOD_MS);
+
 	// Initialize quaternion
 	AttitudeActualData attitude;
 	AttitudeActualGet(&attitude);
@@ -386,6 +397,8 @@ static void AttitudeTask(void *parameters)
 
 		updateNedAccel();
 
+		PIOS_Trace(PIOS_TRACE_ATTITUDE_END, ins);
+
 		if(ret_val == 0)
 			first_run = false;
 
@@ -429,6 +442,8 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 				return -1;
 			}
 		}
+
+		PIOS_Trace(PIOS_TRACE_ATTITUDE_START, 0);
 	}
 
 	AccelsGet(&accelsData);
@@ -602,20 +617,17 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 		if  (!(IS_NOT_FINITE(mag.x) || IS_NOT_FINITE(mag.y) || IS_NOT_FINITE(mag.z))) {
 			float bmag = 1.0f;
 			float brot[3];
-			float Rbe[3][3];
-
-			// Get rotation to bring earth magnetic field into body frame		
-			Quaternion2R(cf_q, Rbe);
 
+			// Rotate the earth magnetic field into body frame
 			if (homeLocation.Set == HOMELOCATION_SET_TRUE) {
-				rot_mult(Rbe, homeLocation.Be, brot, false);
+				quat_rotate(cf_q, homeLocation.Be, brot);
 				bmag = sqrtf(brot[0] * brot[0] + brot[1] * brot[1] + brot[2] * brot[2]);
 				brot[0] /= bmag;
 				brot[1] /= bmag;
 				brot[2] /= bmag;
 			} else {
 				const float Be[3] = {1.0f, 0.0f, 0.0f};
-				rot_mult(Rbe, Be, brot, false);
+				quat_rotate(cf_q, Be, brot);
 			}
 
 			float mag_len = sqrtf(mag.x * mag.x + mag.y * mag.y + mag.z * mag.z);
@@ -650,19 +662,13 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 	gyrosData.y += accel_err[1] * attitudeSettings.AccelKp / dT;
 	gyrosData.z += accel_err[2] * attitudeSettings.AccelKp / dT + mag_err[2] * attitudeSettings.MagKp / dT;
 
-	// Work out time derivative from INSAlgo writeup
-	// Also accounts for the fact that gyros are in deg/s
-	float qdot[4];
-	qdot[0] = (-cf_q[1] * gyrosData.x - cf_q[2] * gyrosData.y - cf_q[3] * gyrosData.z) * dT * DEG2RAD / 2;
-	qdot[1] = (cf_q[0] * gyrosData.x - cf_q[3] * gyrosData.y + cf_q[2] * gyrosData.z) * dT * DEG2RAD / 2;
-	qdot[2] = (cf_q[3] * gyrosData.x + cf_q[0] * gyrosData.y - cf_q[1] * gyrosData.z) * dT * DEG2RAD / 2;
-	qdot[3] = (-cf_q[2] * gyrosData.x + cf_q[1] * gyrosData.y + cf_q[0] * gyrosData.z) * dT * DEG2RAD / 2;
-
-	// Take a time step
-	cf_q[0] = cf_q[0] + qdot[0];
-	cf_q[1] = cf_q[1] + qdot[1];
-	cf_q[2] = cf_q[2] + qdot[2];
-	cf_q[3] = cf_q[3] + qdot[3];
+	// Take a time step and renormalize, the gyros are in deg/s
+	const float rates[3] = {
+		gyrosData.x * DEG2RAD,
+		gyrosData.y * DEG2RAD,
+		gyrosData.z * DEG2RAD
+	};
+	float qmag = quat_integrate_normalize(cf_q, rates, dT);
 
 	if(cf_q[0] < 0) {
 		cf_q[0] = -cf_q[0];
@@ -671,14 +677,6 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 		cf_q[3] = -cf_q[3];
 	}
 
-	// Renomalize
-	float qmag;
-	qmag = sqrtf(cf_q[0]*cf_q[0] + cf_q[1]*cf_q[1] + cf_q[2]*cf_q[2] + cf_q[3]*cf_q[3]);
-	cf_q[0] = cf_q[0] / qmag;
-	cf_q[1] = cf_q[1] / qmag;
-	cf_q[2] = cf_q[2] / qmag;
-	cf_q[3] = cf_q[3] / qmag;
-
 	// If quaternion has become inappropriately short or has become Nan reinit.
 	// THIS SHOULD NEVER ACTUALLY HAPPEN
 	if((fabsf(qmag) < 1.0e-3f) || IS_NOT_FINITE(qmag)) {
@@ -720,12 +718,10 @@ static int32_t updateAttitudeComplementary(bool first_run, bool secondary, bool
 static float calc_ned_accel(float *q, float *accels)
 {
 	float accel_ned[3];
-	float Rbe[3][3];
 
 	// rotate the accels into the NED frame and remove
 	// the influence of gravity
-	Quaternion2R(q, Rbe);
-	rot_mult(Rbe, accels, accel_ned, true);
+	quat_rotate_transpose(q, accels, accel_ned);
 	accel_ned[2] += GRAVITY;
 
 	NedAccelData nedAccel;
@@ -931,6 +927,7 @@ static void accumulate_gyro(GyrosData *gyrosData)
 
 #include "insgps.h"
 static bool home_location_updated;
+static bool mag_north_home_valid;
 /**
  * @brief Use the INSGPS fusion algorithm in either indoor or outdoor mode (use GPS)
  * @params[in] first_run This is the first run so trigger reinitialization
@@ -981,6 +978,10 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		gps_vel_updated = false;
 
 		home_location_updated = false;
+		mag_north_home_valid = false;
+
+		if (ins_history)
+			ins_history_reset(ins_history);
 
 		ins_last_time = PIOS_DELAY_GetRaw();
 
@@ -999,6 +1000,8 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		return -1;
 	}
 
+	PIOS_Trace(PIOS_TRACE_ATTITUDE_START, 1);
+
 	// Get most recent data
 	GyrosGet(&gyrosData);
 	AccelsGet(&accelsData);
@@ -1199,6 +1202,11 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		nedPos.Down = NED[2];
 		NEDPositionSet(&nedPos);
 
+		shift_to_measurement_time(gpsData.ReceiveTime, NED, NULL);
+
+		if (ins_state == INS_RUNNING)
+			update_mag_north(&gpsData);
+
 		gps_updated = false;
 	}
 
@@ -1210,6 +1218,8 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		vel[1] = gpsVelData.East;
 		vel[2] = gpsVelData.Down;
 
+		shift_to_measurement_time(gpsVelData.ReceiveTime, NULL, vel);
+
 		gps_vel_updated = false;
 	}
 
@@ -1263,6 +1273,9 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	INSGetState(&state.State[0], &state.State[3], &state.State[6], &state.State[10], &state.State[13]);
 	INSStateSet(&state); // this sets the UAVO
 
+	if (ins_history)
+		ins_history_push(ins_history, PIOS_Thread_Systime(), &state.State[0], &state.State[3]);
+
 	if (insSettings.ComputeGyroBias == INSSETTINGS_COMPUTEGYROBIAS_FALSE)
 		INSSetGyroBias(zeros);
 
@@ -1272,6 +1285,26 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	return 0;
 }
 
+/**
+ * Move a GPS measurement from the time it was taken to now, so the filter
+ * compares it with the state it had at that time. The receiver took it
+ * GpsLatency before the solution arrived. Without a receive time or
+ * history it is fused as it is.
+ * @param[in] receive_time  system time the GPS solution arrived
+ * @param[in,out] pos       measured position or NULL
+ * @param[in,out] vel       measured velocity or NULL
+ */
+static void shift_to_measurement_time(uint32_t receive_time, float *pos, float *vel)
+{
+	float pos_now[3], vel_now[3];
+
+	if (ins_history == NULL || receive_time == 0)
+		return;
+
+	INSGetState(pos_now, vel_now, NULL, NULL, NULL);
+	ins_history_shift(ins_history, receive_time - insSettings.GpsLatency, pos_now, vel_now, pos, vel);
+}
+
 //! Set the attitude to the current INSGPS estimate
 static int32_t setAttitudeINSGPS()
 {
@@ -1437,6 +1470,50 @@ static void check_home_location()
 	}
 }
 
+/**
+ * Update the magnetic field the INS expects for the current position. The
+ * model is evaluated on a coarse grid, one corner per GPS update, and
+ * interpolated in between. The change from the model at home is added to
+ * the home field so a configured field is kept.
+ * @param[in] gpsPosition the current position
+ */
+static void update_mag_north(GPSPositionData *gpsPosition)
+{
+	static float home_B[3];
+
+	if (homeLocation.Be[0] == 0 && homeLocation.Be[1] == 0 && homeLocation.Be[2] == 0)
+		return;
+
+	if (!mag_north_home_valid) {
+		GPSTimeData gpsTime;
+		GPSTimeGet(&gpsTime);
+		if (gpsTime.Year < 2000)
+			return;
+
+		if (WMM_GetMagVector(homeLocation.Latitude / 10.0e6f, homeLocation.Longitude / 10.0e6f, homeLocation.Altitude,
+				gpsTime.Month, gpsTime.Day, gpsTime.Year, home_B) < 0)
+			return;
+
+		mag_north_home_valid = true;
+	}
+
+	float lat = gpsPosition->Latitude / 10.0e6f;
+	float lon = gpsPosition->Longitude / 10.0e6f;
+
+	if (WMM_UpdateGrid(lat, lon, gpsPosition->Altitude) < 0)
+		return;
+
+	float B[3];
+	if (WMM_GetGridMagVector(lat, lon, gpsPosition->Altitude, B) < 0)
+		return;
+
+	float Be[3];
+	for (uint8_t i = 0; i < 3; i++)
+		Be[i] = homeLocation.Be[i] + B[i] - home_B[i];
+
+	INSSetMagNorth(Be);
+}
+
 static void settingsUpdatedCb(UAVObjEvent * ev) 
 {
 	if (ev == NULL || ev->obj == SensorSettingsHandle()) {
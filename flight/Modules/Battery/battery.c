@@ -34,24 +34,21 @@
 #include "flightbatterystate.h"
 #include "flightbatterysettings.h"
 #include "modulesettings.h"
-#include "pios_thread.h"
+#include "rategroup.h"
 
 // ****************
 // Private constants
-#define STACK_SIZE_BYTES            496
-#define TASK_PRIORITY               PIOS_THREAD_PRIO_LOW
-#define SAMPLE_PERIOD_MS            500
+#define SAMPLE_RATE_GROUP           RATE_GROUP_2HZ
 // Private types
 
 // Private variables
 static bool module_enabled = false;
-static struct pios_thread *batteryTaskHandle;
 static int8_t voltageADCPin = -1; //ADC pin for voltage
 static int8_t currentADCPin = -1; //ADC pin for current
 
 // ****************
 // Private functions
-static void batteryTask(void * parameters);
+static void batteryStep(float dT);
 static void settingsUpdatedCb(UAVObjEvent * objEv);;
 
 static int32_t BatteryStart(void)
@@ -59,11 +56,10 @@ static int32_t BatteryStart(void)
 	if (module_enabled) {
 
 		FlightBatterySettingsConnectCallback(settingsUpdatedCb);
+		settingsUpdatedCb(NULL);
 
-		// Start tasks
-		batteryTaskHandle = PIOS_Thread_Create(batteryTask, "batteryBridge", STACK_SIZE_BYTES, NULL, TASK_PRIORITY);
-		TaskMonitorAdd(TASKINFO_RUNNING_BATTERY, batteryTaskHandle);
-		return 0;
+		// Run on the shared rate group thread
+		return rate_group_add(SAMPLE_RATE_GROUP, batteryStep);
 	}
 	return -1;
 }
@@ -93,91 +89,80 @@ int32_t BatteryInitialize(void)
 MODULE_INITCALL(BatteryInitialize, BatteryStart)
 
 static bool battery_settings_updated;
+static FlightBatterySettingsData batterySettings;
 
 /**
- * Main task. It does not return.
+ * Periodic step, reads the sensors and updates the state and alarms
  */
-static void batteryTask(void * parameters)
+static void batteryStep(float dT)
 {
-	const float dT = SAMPLE_PERIOD_MS / 1000.0f;
-
-	settingsUpdatedCb(NULL);
-
-	// Main task loop
-	uint32_t lastSysTime;
-	lastSysTime = PIOS_Thread_Systime();
-	while (true) {
-		PIOS_Thread_Sleep_Until(&lastSysTime, SAMPLE_PERIOD_MS);
-
-		FlightBatteryStateData flightBatteryData;
-		FlightBatterySettingsData batterySettings;
-		float energyRemaining;
-
-		FlightBatteryStateGet(&flightBatteryData);
-
-		if (battery_settings_updated) {
-			battery_settings_updated = false;
-			FlightBatterySettingsGet(&batterySettings);
-
-			voltageADCPin = batterySettings.VoltagePin;
-			if (voltageADCPin == FLIGHTBATTERYSETTINGS_VOLTAGEPIN_NONE)
-				voltageADCPin = -1;
-
-			currentADCPin = batterySettings.CurrentPin;
-			if (currentADCPin == FLIGHTBATTERYSETTINGS_CURRENTPIN_NONE)
-				currentADCPin = -1;
-		}
-
-		// handle voltage
-		if (voltageADCPin >= 0) {
-			flightBatteryData.Voltage = ((float) PIOS_ADC_GetChannelVolt(voltageADCPin)) / batterySettings.SensorCalibrationFactor[FLIGHTBATTERYSETTINGS_SENSORCALIBRATIONFACTOR_VOLTAGE] * 1000.0f +
-							batterySettings.SensorCalibrationOffset[FLIGHTBATTERYSETTINGS_SENSORCALIBRATIONOFFSET_VOLTAGE]; //in Volts
-
-			// generate alarms and warnings
-			if (flightBatteryData.Voltage < batterySettings.VoltageThresholds[FLIGHTBATTERYSETTINGS_VOLTAGETHRESHOLDS_ALARM])
-				AlarmsSet(SYSTEMALARMS_ALARM_BATTERY, SYSTEMALARMS_ALARM_CRITICAL);
-			else if (flightBatteryData.Voltage < batterySettings.VoltageThresholds[FLIGHTBATTERYSETTINGS_VOLTAGETHRESHOLDS_WARNING])
-				AlarmsSet(SYSTEMALARMS_ALARM_BATTERY, SYSTEMALARMS_ALARM_WARNING);
-			else
-				AlarmsClear(SYSTEMALARMS_ALARM_BATTERY);
-		} else {
-			flightBatteryData.Voltage = 0;
-		}
-
-		// handle current
-		if (currentADCPin >= 0) {
-			flightBatteryData.Current = ((float) PIOS_ADC_GetChannelVolt(currentADCPin)) / batterySettings.SensorCalibrationFactor[FLIGHTBATTERYSETTINGS_SENSORCALIBRATIONFACTOR_CURRENT] * 1000.0f +
-							batterySettings.SensorCalibrationOffset[FLIGHTBATTERYSETTINGS_SENSORCALIBRATIONOFFSET_CURRENT]; //in Amps
-			if (flightBatteryData.Current > flightBatteryData.PeakCurrent)
-				flightBatteryData.PeakCurrent = flightBatteryData.Current; //in Amps
-
-			flightBatteryData.ConsumedEnergy += (flightBatteryData.Current * dT * 1000.0f / 3600.0f); //in mAh
-
-			//Apply a 2 second rise time low-pass filter to average the current
-			float alpha = 1.0f - dT / (dT + 2.0f);
-			flightBatteryData.AvgCurrent = alpha * flightBatteryData.AvgCurrent + (1 - alpha) * flightBatteryData.Current; //in Amps
-
-			energyRemaining = batterySettings.Capacity - flightBatteryData.ConsumedEnergy; // in mAh
-			if (flightBatteryData.AvgCurrent > 0)
-				flightBatteryData.EstimatedFlightTime = (energyRemaining / (flightBatteryData.AvgCurrent * 1000.0f)) * 3600.0f; //in Sec
-			else
-				flightBatteryData.EstimatedFlightTime = 9999;
-
-			// generate alarms and warnings
-			if ((batterySettings.FlightTimeThresholds[FLIGHTBATTERYSETTINGS_FLIGHTTIMETHRESHOLDS_ALARM] > 0)
-				&& (flightBatteryData.EstimatedFlightTime < batterySettings.FlightTimeThresholds[FLIGHTBATTERYSETTINGS_FLIGHTTIMETHRESHOLDS_ALARM]))
-				AlarmsSet(SYSTEMALARMS_ALARM_FLIGHTTIME, SYSTEMALARMS_ALARM_CRITICAL);
-			else if ((batterySettings.FlightTimeThresholds[FLIGHTBATTERYSETTINGS_FLIGHTTIMETHRESHOLDS_WARNING] > 0)
-					 && (flightBatteryData.EstimatedFlightTime < batterySettings.FlightTimeThresholds[FLIGHTBATTERYSETTINGS_FLIGHTTIMETHRESHOLDS_WARNING]))
-				AlarmsSet(SYSTEMALARMS_ALARM_FLIGHTTIME, SYSTEMALARMS_ALARM_WARNING);
-			else
-				AlarmsClear(SYSTEMALARMS_ALARM_FLIGHTTIME);
-		} else {
-			flightBatteryData.Current = 0;
-		}
-
-		FlightBatteryStateSet(&flightBatteryData);
+	FlightBatteryStateData flightBatteryData;
+	float energyRemaining;
+
+	FlightBatteryStateGet(&flightBatteryData);
+
+	if (battery_settings_updated) {
+		battery_settings_updated = false;
+		FlightBatterySettingsGet(&batterySettings);
+
+		voltageADCPin = batterySettings.VoltagePin;
+		if (voltageADCPin == FLIGHTBATTERYSETTINGS_VOLTAGEPIN_NONE)
+			voltageADCPin = -1;
+
+		currentADCPin = batterySettings.CurrentPin;
+		if (currentADCPin == FLIGHTBATTERYSETTINGS_CURRENTPIN_NONE)
+			currentADCPin = -1;
+	}
+
+	// handle voltage
+	if (voltageADCPin >= 0) {
+		flightBatteryData.Voltage = ((float) PIOS_ADC_GetChannelVolt(voltageADCPin)) / batterySettings.SensorCalibrationFactor[FLIGHTBATTERYSETTINGS_SENSORCALIBRATIONFACTOR_VOLTAGE] * 1000.0f +
+						batterySettings.SensorCalibrationOffset[FLIGHTBATTERYSETTINGS_SENSORCALIBRATIONOFFSET_VOLTAGE]; //in Volts
+
+		// generate alarms and warnings
+		if (flightBatteryData.Voltage < batterySettings.VoltageThresholds[FLIGHTBATTERYSETTINGS_VOLTAGETHRESHOLDS_ALARM])
+			AlarmsSet(SYSTEMALARMS_ALARM_BATTERY, SYSTEMALARMS_ALARM_CRITICAL);
+		else if (flightBatteryData.Voltage < batterySettings.VoltageThresholds[FLIGHTBATTERYSETTINGS_VOLTAGETHRESHOLDS_WARNING])
+			AlarmsSet(SYSTEMALARMS_ALARM_BATTERY, SYSTEMALARMS_ALARM_WARNING);
+		else
+			AlarmsClear(SYSTEMALARMS_ALARM_BATTERY);
+	} else {
+		flightBatteryData.Voltage = 0;
+	}
+
+	// handle current
+	if (currentADCPin >= 0) {
+		flightBatteryData.Current = ((float) PIOS_ADC_GetChannelVolt(currentADCPin)) / batterySettings.SensorCalibrationFactor[FLIGHTBATTERYSETTINGS_SENSORCALIBRATIONFACTOR_CURRENT] * 1000.0f +
+						batterySettings.SensorCalibrationOffset[FLIGHTBATTERYSETTINGS_SENSORCALIBRATIONOFFSET_CURRENT]; //in Amps
+		if (flightBatteryData.Current > flightBatteryData.PeakCurrent)
+			flightBatteryData.PeakCurrent = flightBatteryData.Current; //in Amps
+
+		flightBatteryData.ConsumedEnergy += (flightBatteryData.Current * dT * 1000.0f / 3600.0f); //in mAh
+
+		//Apply a 2 second rise time low-pass filter to average the current
+		float alpha = 1.0f - dT / (dT + 2.0f);
+		flightBatteryData.AvgCurrent = alpha * flightBatteryData.AvgCurrent + (1 - alpha) * flightBatteryData.Current; //in Amps
+
+		energyRemaining = batterySettings.Capacity - flightBatteryData.ConsumedEnergy; // in mAh
+		if (flightBatteryData.AvgCurrent > 0)
+			flightBatteryData.EstimatedFlightTime = (energyRemaining / (flightBatteryData.AvgCurrent * 1000.0f)) * 3600.0f; //in Sec
+		else
+			flightBatteryData.EstimatedFlightTime = 9999;
+
+		// generate alarms and warnings
+		if ((batterySettings.FlightTimeThresholds[FLIGHTBATTERYSETTINGS_FLIGHTTIMETHRESHOLDS_ALARM] > 0)
+			&& (flightBatteryData.EstimatedFlightTime < batterySettings.FlightTimeThresholds[FLIGHTBATTERYSETTINGS_FLIGHTTIMETHRESHOLDS_ALARM]))
+			AlarmsSet(SYSTEMALARMS_ALARM_FLIGHTTIME, SYSTEMALARMS_ALARM_CRITICAL);
+		else if ((batterySettings.FlightTimeThresholds[FLIGHTBATTERYSETTINGS_FLIGHTTIMETHRESHOLDS_WARNING] > 0)
+				 && (flightBatteryData.EstimatedFlightTime < batterySettings.FlightTimeThresholds[FLIGHTBATTERYSETTINGS_FLIGHTTIMETHRESHOLDS_WARNING]))
+			AlarmsSet(SYSTEMALARMS_ALARM_FLIGHTTIME, SYSTEMALARMS_ALARM_WARNING);
+		else
+			AlarmsClear(SYSTEMALARMS_ALARM_FLIGHTTIME);
+	} else {
+		flightBatteryData.Current = 0;
 	}
+
+	FlightBatteryStateSet(&flightBatteryData);
 }
 
 //! Indicates the battery settings have been updated
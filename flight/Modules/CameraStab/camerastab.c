@@ -44,6 +44,7 @@
 #include "openpilot.h"
 #include "misc_math.h"
 #include "physical_constants.h"
+#include "fastmath.h"
 #include "pios_thread.h"
 #include "pios_can.h"
 
@@ -251,8 +252,8 @@ static void attitudeUpdated(UAVObjEvent* ev)
 
 			// Compute the pitch and yaw to the POI location, assuming UAVO is level facing north
 			float distance = sqrtf(powf(dLoc[0], 2) + powf(dLoc[1], 2));
-			float pitch = atan2f(-dLoc[2], distance) * RAD2DEG;
-			float yaw = atan2f(dLoc[1], dLoc[0]) * RAD2DEG;
+			float pitch = fast_atan2f(-dLoc[2], distance) * RAD2DEG;
+			float yaw = fast_atan2f(dLoc[1], dLoc[0]) * RAD2DEG;
 			if (yaw < 0.0f)
 				yaw += 360.0f;
 
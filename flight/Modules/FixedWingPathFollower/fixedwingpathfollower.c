@@ -49,6 +49,7 @@
 #include "physical_constants.h"
 #include "paths.h"
 #include "misc_math.h"
+#include "fastmath.h"
 
 #include "modulesettings.h"
 #include "attitudeactual.h"
@@ -611,7 +612,7 @@ static uint8_t updateFixedDesiredAttitude()
 	 * Compute desired roll command
 	 */
 	if (groundspeedDesired> 1e-6f) {
-		bearingError = RAD2DEG * (atan2f(velocityDesired.East,velocityDesired.North) - atan2f(velocityActual.East,velocityActual.North));
+		bearingError = RAD2DEG * (fast_atan2f(velocityDesired.East,velocityDesired.North) - fast_atan2f(velocityActual.East,velocityActual.North));
 	} else {
 		// if we are not supposed to move, keep going wherever we are now. Don't make things worse by changing direction.
 		bearingError = 0;
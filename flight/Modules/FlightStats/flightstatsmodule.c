@@ -29,7 +29,7 @@
 
 #include "openpilot.h"
 #include "modulesettings.h"
-#include "pios_thread.h"
+#include "rategroup.h"
 
 #include "misc_math.h"
 
@@ -43,21 +43,21 @@
 #include "velocityactual.h"
 
 // Private constants
-#define STACK_SIZE_BYTES 600
-#define TASK_PRIORITY PIOS_THREAD_PRIO_LOW
+#define UPDATE_RATE_GROUP RATE_GROUP_10HZ
 
 // Private types
 
 // Private variables
 static bool module_enabled;
-static struct pios_thread *flightStatsTaskHandle;
 static FlightStatsSettingsData settings;
+static FlightStatsData flightStatsData;
+static bool first_run;
 static PositionActualData lastPositionActual;
 static float initial_consumed_energy;
 static float previous_consumed_energy;
 
 // Private functions
-static void flightStatsTask(void *parameters);
+static void flightStatsStep(float dT);
 static void settingsUpdatedCb(UAVObjEvent * ev);
 static bool isArmed();
 static void resetStats(FlightStatsData *stats);
@@ -111,81 +111,72 @@ int32_t FlightStatModuleStart(void)
 		return -1;
 	}
 
-	// Start flight stats task
-	flightStatsTaskHandle = PIOS_Thread_Create(flightStatsTask, "FlightStats", STACK_SIZE_BYTES, NULL, TASK_PRIORITY);
+	resetStats(&flightStatsData);
+	flightStatsData.State = FLIGHTSTATS_STATE_IDLE;
 
-	TaskMonitorAdd(TASKINFO_RUNNING_FLIGHTSTATS, flightStatsTaskHandle);
-	
-	return 0;
+	// Update stats at 10Hz on the shared rate group thread
+	return rate_group_add(UPDATE_RATE_GROUP, flightStatsStep);
 }
 
 MODULE_INITCALL(FlightStatsModuleInitialize, FlightStatModuleStart);
 
-static void flightStatsTask(void *parameters)
+/**
+ * Periodic step, follows the arming state and collects the statistics
+ */
+static void flightStatsStep(float dT)
 {
-	FlightStatsData flightStatsData;
-	bool first_run = true;
-
-	resetStats(&flightStatsData);
-	flightStatsData.State = FLIGHTSTATS_STATE_IDLE;
-
-	// Loop forever
-	while (1) {
-		// Update stats at about 10Hz
-		PIOS_Thread_Sleep(100);
-		switch (flightStatsData.State) {
-			case FLIGHTSTATS_STATE_IDLE:
-				if (isArmed()) {
-					switch (settings.StatsBehavior) {
-					case FLIGHTSTATSSETTINGS_STATSBEHAVIOR_RESETONBOOT:
-						flightStatsData.State = FLIGHTSTATS_STATE_COLLECTING;
-						break;
-					case FLIGHTSTATSSETTINGS_STATSBEHAVIOR_RESETONARM:
-						flightStatsData.State = FLIGHTSTATS_STATE_RESET;
-						break;
-					}
-					first_run = true;
+	switch (flightStatsData.State) {
+		case FLIGHTSTATS_STATE_IDLE:
+			if (isArmed()) {
+				switch (settings.StatsBehavior) {
+				case FLIGHTSTATSSETTINGS_STATSBEHAVIOR_RESETONBOOT:
+					flightStatsData.State = FLIGHTSTATS_STATE_COLLECTING;
+					break;
+				case FLIGHTSTATSSETTINGS_STATSBEHAVIOR_RESETONARM:
+					flightStatsData.State = FLIGHTSTATS_STATE_RESET;
+					break;
 				}
-				break;
-			case FLIGHTSTATS_STATE_RESET:
-				resetStats(&flightStatsData);
-				flightStatsData.State = FLIGHTSTATS_STATE_COLLECTING;
-				break;
-			case FLIGHTSTATS_STATE_COLLECTING:
-				if (first_run) { // get some initial values
-					// initial position
-					PositionActualGet(&lastPositionActual);
-
-					// get the initial battery voltage and consumed energy
-					if (FlightBatteryStateHandle()) {
-						FlightBatteryStateConsumedEnergyGet(&initial_consumed_energy);
-
-						// either start a new calculation of consumed energy, or combine with data
-						// from previous flight
-						if (settings.StatsBehavior == FLIGHTSTATSSETTINGS_STATSBEHAVIOR_RESETONARM) {
-							previous_consumed_energy = 0.f;
-						}
-						else {
-							previous_consumed_energy = flightStatsData.ConsumedEnergy;
-						}
-
-						// only get the initial voltage if we reset on arm or if it is uninitialized
-						if ((settings.StatsBehavior == FLIGHTSTATSSETTINGS_STATSBEHAVIOR_RESETONARM)\
-							|| (flightStatsData.InitialBatteryVoltage == 0)){
-							float voltage;
-							FlightBatteryStateVoltageGet(&voltage);
-							flightStatsData.InitialBatteryVoltage = roundf(1000.f * voltage);
-						}
+				first_run = true;
+			}
+			break;
+		case FLIGHTSTATS_STATE_RESET:
+			resetStats(&flightStatsData);
+			flightStatsData.State = FLIGHTSTATS_STATE_COLLECTING;
+			break;
+		case FLIGHTSTATS_STATE_COLLECTING:
+			if (first_run) { // get some initial values
+				// initial position
+				PositionActualGet(&lastPositionActual);
+
+				// get the initial battery voltage and consumed energy
+				if (FlightBatteryStateHandle()) {
+					FlightBatteryStateConsumedEnergyGet(&initial_consumed_energy);
+
+					// either start a new calculation of consumed energy, or combine with data
+					// from previous flight
+					if (settings.StatsBehavior == FLIGHTSTATSSETTINGS_STATSBEHAVIOR_RESETONARM) {
+						previous_consumed_energy = 0.f;
+					}
+					else {
+						previous_consumed_energy = flightStatsData.ConsumedEnergy;
+					}
+
+					// only get the initial voltage if we reset on arm or if it is uninitialized
+					if ((settings.StatsBehavior == FLIGHTSTATSSETTINGS_STATSBEHAVIOR_RESETONARM)\
+						|| (flightStatsData.InitialBatteryVoltage == 0)){
+						float voltage;
+						FlightBatteryStateVoltageGet(&voltage);
+						flightStatsData.InitialBatteryVoltage = roundf(1000.f * voltage);
 					}
-					first_run = false;
-				}
-				collectStats(&flightStatsData);
-				if (!isArmed()) {
-					flightStatsData.State = FLIGHTSTATS_STATE_IDLE;
 				}
-				FlightStatsSet(&flightStatsData);
-				break;
-		}
+				first_run = false;
+			}
+			collectStats(&flightStatsData);
+			if (!isArmed()) {
+				flightStatsData.State = FLIGHTSTATS_STATE_IDLE;
+			}
+			FlightStatsSet(&flightStatsData);
+			break;
 	}
 }
 
@@ -63,10 +63,12 @@ static void updateSettings();
 #define GPS_COM_TIMEOUT_MS              100
 
 
+#define GPS_READ_BLOCK_SIZE             32
+
 #if defined(PIOS_GPS_MINIMAL)
-	#define STACK_SIZE_BYTES            500
+	#define STACK_SIZE_BYTES            (500 + GPS_READ_BLOCK_SIZE)
 #else
-	#define STACK_SIZE_BYTES            850
+	#define STACK_SIZE_BYTES            (850 + GPS_READ_BLOCK_SIZE)
 #endif // PIOS_GPS_MINIMAL
 
 #define TASK_PRIORITY                   PIOS_THREAD_PRIO_LOW
@@ -253,21 +255,25 @@ static void gpsTask(void *parameters)
 			continue;
 		}
 
-		uint8_t c;
+		uint8_t rx[GPS_READ_BLOCK_SIZE];
+		uint16_t received;
 
-		// This blocks the task until there is something on the buffer
-		while (PIOS_COM_ReceiveBuffer(gpsPort, &c, 1, xDelay) > 0)
+		// This blocks the task until there is something on the buffer.
+		// The first byte after the gap between solutions wakes the task, so
+		// the time a block is read is close to when a solution started arriving.
+		while ((received = PIOS_COM_ReceiveBuffer(gpsPort, rx, sizeof(rx), xDelay)) > 0)
 		{
+			uint32_t rxTimeMs = PIOS_Thread_Systime();
 			int res;
 			switch (gpsProtocol) {
 #if defined(PIOS_INCLUDE_GPS_NMEA_PARSER)
 				case MODULESETTINGS_GPSDATAPROTOCOL_NMEA:
-					res = parse_nmea_stream (c,gps_rx_buffer, &gpsposition, &gpsRxStats);
+					res = parse_nmea_stream (rx, received, rxTimeMs, gps_rx_buffer, &gpsposition, &gpsRxStats);
 					break;
 #endif
 #if defined(PIOS_INCLUDE_GPS_UBX_PARSER)
 				case MODULESETTINGS_GPSDATAPROTOCOL_UBX:
-					res = parse_ubx_stream (c,gps_rx_buffer, &gpsposition, &gpsRxStats);
+					res = parse_ubx_stream (rx, received, rxTimeMs, gps_rx_buffer, &gpsposition, &gpsRxStats);
 					break;
 #endif
 				default:
@@ -107,86 +107,108 @@ const static struct nmea_parser nmea_parsers[] = {
 #endif //PIOS_GPS_MINIMAL
 };
 
-int parse_nmea_stream (uint8_t c, char *gps_rx_buffer, GPSPositionData *GpsData, struct GPS_RX_STATS *gpsRxStats)
+/**
+ * Parse a span of the incoming stream for NMEA sentences. The parser state
+ * is kept between calls so a sentence can be split over any number of
+ * spans. Sentences are copied in runs up to the end of the line and the
+ * checksum is accumulated on the way.
+ *
+ * @param[in] rx            received bytes
+ * @param[in] len           number of received bytes
+ * @param[in] rx_time       system time (ms) the bytes were received
+ * @param[in] gps_rx_buffer buffer of NMEA_MAX_PACKET_LENGTH bytes
+ * @param[in,out] GpsData   position being assembled
+ * @param[in,out] gpsRxStats receive statistics
+ * @returns PARSER_COMPLETE if a sentence was completed, PARSER_OVERRUN or
+ * PARSER_ERROR if a sentence was dropped and none completed,
+ * PARSER_INCOMPLETE otherwise
+ */
+int parse_nmea_stream (const uint8_t *rx, uint16_t len, uint32_t rx_time, char *gps_rx_buffer, GPSPositionData *GpsData, struct GPS_RX_STATS *gpsRxStats)
 {
 	static uint8_t rx_count = 0;
 	static bool start_flag = false;
-	static bool found_cr = false;
+	static uint8_t checksum_computed;
+	static uint8_t checksum_pos;	// position of the '*', 0 until found
+	static uint32_t sentence_time;
+	const uint8_t *end = rx + len;
+	int ret = PARSER_INCOMPLETE;
+
+	while (rx < end) {
+		// detect start while acquiring stream
+		if (!start_flag) {
+			const uint8_t *start = memchr(rx, '$', end - rx); // NMEA identifier
+			if (start == NULL)
+				return ret;
+
+			rx = start + 1;
+			gps_rx_buffer[0] = '$';
+			rx_count = 1;
+			checksum_computed = 0;
+			checksum_pos = 0;
+			sentence_time = rx_time;
+			start_flag = true;
+			continue;
+		}
 
-	// detect start while acquiring stream
-	if (!start_flag && (c == '$')) // NMEA identifier found
-	{
-		start_flag = true;
-		found_cr = false;
-		rx_count = 0;
-	}
-	else
-	if (!start_flag)
-		return PARSER_ERROR;
+		// copy up to and including the next '\n'
+		const uint8_t *eol = memchr(rx, '\n', end - rx);
+		uint16_t n = (eol ? eol + 1 : end) - rx;
+
+		if (rx_count + n > NMEA_MAX_PACKET_LENGTH) {
+			// The buffer is full and we haven't found a valid NMEA sentence.
+			// Flush the buffer and note the overflow event.
+			gpsRxStats->gpsRxOverflow++;
+			start_flag = false;
+			if (ret != PARSER_COMPLETE)
+				ret = PARSER_OVERRUN;
+			continue;
+		}
 
-	if (rx_count >= NMEA_MAX_PACKET_LENGTH)
-	{
-		// The buffer is already full and we haven't found a valid NMEA sentence.
-		// Flush the buffer and note the overflow event.
-		gpsRxStats->gpsRxOverflow++;
-		start_flag = false;
-		found_cr = false;
-		rx_count = 0;
-		return PARSER_OVERRUN;
-	}
-	else
-	{
-		gps_rx_buffer[rx_count] = c;
-		rx_count++;
-	}
+		for (uint16_t i = 0; i < n; i++) {
+			uint8_t c = rx[i];
+			gps_rx_buffer[rx_count] = c;
+			if (!checksum_pos) {
+				if (c == '*')
+					checksum_pos = rx_count;
+				else
+					checksum_computed ^= c;
+			}
+			rx_count++;
+		}
+		rx += n;
+
+		// look for ending '\r\n' sequence
+		if (!eol || rx_count < 3 || gps_rx_buffer[rx_count - 2] != '\r')
+			continue;
 
-	// look for ending '\r\n' sequence
-	if (!found_cr && (c == '\r') )
-		found_cr = true;
-	else
-	if (found_cr && (c != '\n') )
-		found_cr = false;  // false end flag
-	else
-	if (found_cr && (c == '\n') )
-	{
 		// The NMEA functions require a zero-terminated string
 		// As we detected \r\n, the string as for sure 2 bytes long, we will also strip the \r\n
-		gps_rx_buffer[rx_count-2] = 0;
+		gps_rx_buffer[rx_count - 2] = 0;
 
 		// prepare to parse next sentence
 		start_flag = false;
-		found_cr = false;
-		rx_count = 0;
-		// Our rxBuffer must look like this now:
-		//   [0]           = '$'
-		//   ...           = zero or more bytes of sentence payload
-		//   [end_pos - 1] = '\r'
-		//   [end_pos]     = '\n'
-		//
-		// Prepare to consume the sentence from the buffer
 
 		// Validate the checksum over the sentence
-		if (!NMEA_checksum(&gps_rx_buffer[1]))
-		{	// Invalid checksum.  May indicate dropped characters on Rx.
-			//PIOS_DEBUG_PinHigh(2);
+		if (!checksum_pos ||
+				checksum_computed != strtol(&gps_rx_buffer[checksum_pos + 1], NULL, 16)) {
+			// Invalid checksum.  May indicate dropped characters on Rx.
 			gpsRxStats->gpsRxChkSumError++;
-			//PIOS_DEBUG_PinLow(2);
-			return PARSER_ERROR;
+			if (ret != PARSER_COMPLETE)
+				ret = PARSER_ERROR;
+			continue;
 		}
+
+		// Valid checksum, use this packet to update the GPS position
+		GpsData->ReceiveTime = sentence_time;
+		if (!NMEA_update_position(&gps_rx_buffer[1], GpsData))
+			gpsRxStats->gpsRxParserError++;
 		else
-		{	// Valid checksum, use this packet to update the GPS position
-			if (!NMEA_update_position(&gps_rx_buffer[1], GpsData)) {
-				//PIOS_DEBUG_PinHigh(2);
-				gpsRxStats->gpsRxParserError++;
-				//PIOS_DEBUG_PinLow(2);
-			}
-			else
-				gpsRxStats->gpsRxReceived++;;
+			gpsRxStats->gpsRxReceived++;
 
-			return PARSER_COMPLETE;
-		}
+		ret = PARSER_COMPLETE;
 	}
-	return PARSER_INCOMPLETE;
+
+	return ret;
 }
 
 const static struct nmea_parser *NMEA_find_parser_by_prefix(const char *prefix)
@@ -267,7 +289,7 @@ static bool NMEA_parse_real(int32_t * whole, uint32_t * fract, uint8_t * fract_u
 
 	*whole = strtol(field_w, NULL, 10);
 
-	if (field_w) {
+	if (field_f) {
 		/* decimal was found so we may have a fractional part */
 		*fract = strtoul(field_f, NULL, 10);
 		*fract_units = strlen(field_f);
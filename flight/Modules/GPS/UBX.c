@@ -35,15 +35,28 @@
 
 #include "UBX.h"
 #include "GPS.h"
+#include "misc_math.h"
 
 static uint32_t parse_errors;
 
-static bool checksum_ubx_message(const struct UBXPacket *);
-static uint32_t parse_ubx_message(const struct UBXPacket *, GPSPositionData *);
+static uint32_t parse_ubx_message(const struct UBXPacket *, GPSPositionData *, uint32_t);
 
-// parse incoming character stream for messages in UBX binary format
-
-int parse_ubx_stream (uint8_t c, char *gps_rx_buffer, GPSPositionData *GpsData, struct GPS_RX_STATS *gpsRxStats)
+/**
+ * Parse a span of the incoming stream for messages in UBX binary format.
+ * The parser state is kept between calls so a message can be split over
+ * any number of spans. The payload is copied in runs and the checksum is
+ * accumulated on the way.
+ *
+ * @param[in] rx            received bytes
+ * @param[in] len           number of received bytes
+ * @param[in] rx_time       system time (ms) the bytes were received
+ * @param[in] gps_rx_buffer buffer for a struct UBXPacket
+ * @param[in,out] GpsData   position being assembled
+ * @param[in,out] gpsRxStats receive statistics
+ * @returns PARSER_COMPLETE if a message was completed, PARSER_ERROR if a
+ * message was dropped and none completed, PARSER_INCOMPLETE otherwise
+ */
+int parse_ubx_stream (const uint8_t *rx, uint16_t len, uint32_t rx_time, char *gps_rx_buffer, GPSPositionData *GpsData, struct GPS_RX_STATS *gpsRxStats)
 {
 	enum proto_states {
 		START,
@@ -55,82 +68,117 @@ int parse_ubx_stream (uint8_t c, char *gps_rx_buffer, GPSPositionData *GpsData,
 		UBX_PAYLOAD,
 		UBX_CHK1,
 		UBX_CHK2,
-		FINISHED
 	};
 
 	static enum proto_states proto_state = START;
 	static uint16_t rx_count = 0;
+	static uint8_t ck_a, ck_b;
+	static uint32_t msg_time;
 	struct UBXPacket *ubx = (struct UBXPacket *)gps_rx_buffer;
-
-	switch (proto_state) {
-		case START: // detect protocol
-			if (c ==  UBX_SYNC1) // first UBX sync char found
+	const uint8_t *end = rx + len;
+	int ret = PARSER_INCOMPLETE;
+
+	while (rx < end) {
+		switch (proto_state) {
+			case START: // skip to the next sync char
+			{
+				const uint8_t *sync = memchr(rx, UBX_SYNC1, end - rx);
+				if (sync == NULL)
+					return ret;
+				rx = sync + 1;
+				msg_time = rx_time;
 				proto_state = UBX_SY2;
-			break;
-		case UBX_SY2:
-			if (c == UBX_SYNC2) // second UBX sync char found
-				proto_state = UBX_CLASS;
-			else
-				proto_state = START; // reset state
-			break;
-		case UBX_CLASS:
-			ubx->header.class = c;
-			proto_state = UBX_ID;
-			break;
-		case UBX_ID:
-			ubx->header.id = c;
-			proto_state = UBX_LEN1;
-			break;
-		case UBX_LEN1:
-			ubx->header.len = c;
-			proto_state = UBX_LEN2;
-			break;
-		case UBX_LEN2:
-			ubx->header.len += (c << 8);
-			if (ubx->header.len > sizeof(UBXPayload)) {
-				gpsRxStats->gpsRxOverflow++;
-				proto_state = START;
-			} else {
-				rx_count = 0;
-				proto_state = UBX_PAYLOAD;
+				continue;
 			}
-			break;
-		case UBX_PAYLOAD:
-			if (rx_count < ubx->header.len) {
-				ubx->payload.payload[rx_count] = c;
-				if (++rx_count == ubx->header.len)
+			case UBX_PAYLOAD:
+			{
+				uint16_t n = MIN(ubx->header.len - rx_count, end - rx);
+				uint8_t *dst = &ubx->payload.payload[rx_count];
+				uint8_t a = ck_a, b = ck_b;
+				for (uint16_t i = 0; i < n; i++) {
+					dst[i] = rx[i];
+					a += rx[i];
+					b += a;
+				}
+				ck_a = a;
+				ck_b = b;
+				rx += n;
+				rx_count += n;
+				if (rx_count == ubx->header.len)
 					proto_state = UBX_CHK1;
-			} else {
-				gpsRxStats->gpsRxOverflow++;
-				proto_state = START;
+				continue;
 			}
-			break;
-		case UBX_CHK1:
-			ubx->header.ck_a = c;
-			proto_state = UBX_CHK2;
-			break;
-		case UBX_CHK2:
-			ubx->header.ck_b = c;
-			if (checksum_ubx_message(ubx)) { // message complete and valid
-				parse_ubx_message(ubx, GpsData);
-				proto_state = FINISHED;
-			} else {
-				gpsRxStats->gpsRxChkSumError++;
+			default:
+				break;
+		}
+
+		uint8_t c = *rx++;
+
+		switch (proto_state) {
+			case UBX_SY2:
+				if (c == UBX_SYNC2) { // second UBX sync char found
+					ck_a = ck_b = 0;
+					proto_state = UBX_CLASS;
+				} else {
+					// look at this byte again, it may be the first sync char
+					rx--;
+					proto_state = START;
+				}
+				continue;
+			case UBX_CLASS:
+				ubx->header.class = c;
+				proto_state = UBX_ID;
+				break;
+			case UBX_ID:
+				ubx->header.id = c;
+				proto_state = UBX_LEN1;
+				break;
+			case UBX_LEN1:
+				ubx->header.len = c;
+				proto_state = UBX_LEN2;
+				break;
+			case UBX_LEN2:
+				ubx->header.len += (c << 8);
+				if (ubx->header.len > sizeof(UBXPayload)) {
+					gpsRxStats->gpsRxOverflow++;
+					if (ret != PARSER_COMPLETE)
+						ret = PARSER_ERROR;
+					proto_state = START;
+				} else {
+					rx_count = 0;
+					proto_state = ubx->header.len ? UBX_PAYLOAD : UBX_CHK1;
+				}
+				break;
+			case UBX_CHK1:
+				ubx->header.ck_a = c;
+				proto_state = UBX_CHK2;
+				continue;
+			case UBX_CHK2:
+				ubx->header.ck_b = c;
 				proto_state = START;
-			}
-			break;
-		default: break;
-	}
+				if (ubx->header.ck_a == ck_a && ubx->header.ck_b == ck_b) {
+					// message complete and valid
+					parse_ubx_message(ubx, GpsData, msg_time);
+					gpsRxStats->gpsRxReceived++;
+					ret = PARSER_COMPLETE;
+				} else {
+					gpsRxStats->gpsRxChkSumError++;
+					if (ret != PARSER_COMPLETE)
+						ret = PARSER_ERROR;
+					parse_errors++;
+					UBloxInfoParseErrorsSet(&parse_errors);
+				}
+				continue;
+			default:
+				break;
+		}
 
-	if (proto_state == START)
-		return PARSER_ERROR;	// parser couldn't use this byte
-	else if (proto_state == FINISHED) {
-		gpsRxStats->gpsRxReceived++;
-		proto_state = START;
-		return PARSER_COMPLETE;	// message complete & processed
+		// header bytes are part of the checksum
+		ck_a += c;
+		ck_b += ck_a;
 	}
 
-	return PARSER_INCOMPLETE; // message not (yet) complete
+	return ret;
 }
 
 
@@ -148,6 +196,8 @@ int parse_ubx_stream (uint8_t c, char *gps_rx_buffer, GPSPositionData *GpsData,
 static struct msgtracker{
 		uint32_t	currentTOW;		// TOW of the message set currently in progress
 		uint8_t		msg_received;	// keep track of received message types
+		uint32_t	msg_time;		// receive time of the message being parsed
+		uint32_t	set_time;		// receive time of the first message of the set
 	} msgtracker;
 
 // Check if a message belongs to the current data set and register it as 'received'
@@ -158,6 +208,7 @@ bool check_msgtracker (uint32_t tow, uint8_t msg_flag)
 		: (msgtracker.currentTOW - tow > 6*24*3600*1000)) { // 6 days, TOW wrap around occured
 		msgtracker.currentTOW = tow;
 		msgtracker.msg_received = NONE_RECEIVED;
+		msgtracker.set_time = msgtracker.msg_time;
 	} else if (tow < msgtracker.currentTOW)	// message outdated (don't process)
 				return false;
 
@@ -165,40 +216,6 @@ bool check_msgtracker (uint32_t tow, uint8_t msg_flag)
 	return true;
 }
 
-static bool checksum_ubx_message (const struct UBXPacket *ubx)
-{
-	int i;
-	uint8_t ck_a, ck_b;
-
-	ck_a = ubx->header.class;
-	ck_b = ck_a;
-
-	ck_a += ubx->header.id;
-	ck_b += ck_a;
-
-	ck_a += ubx->header.len & 0xff;
-	ck_b += ck_a;
-
-	ck_a += ubx->header.len >> 8;
-	ck_b += ck_a;
-
-	for (i = 0; i < ubx->header.len; i++) {
-		ck_a += ubx->payload.payload[i];
-		ck_b += ck_a;
-	}
-
-	if (ubx->header.ck_a == ck_a &&
-			ubx->header.ck_b == ck_b)
-		return true;
-	else {
-		parse_errors++;
-		UBloxInfoParseErrorsSet(&parse_errors);
-
-		return false;
-	}
-
-}
-
 static void parse_ubx_nav_posllh (const struct UBX_NAV_POSLLH *posllh, GPSPositionData *GpsPosition)
 {
 	if (check_msgtracker(posllh->iTOW, POSLLH_RECEIVED)) {
@@ -253,6 +270,7 @@ static void parse_ubx_nav_velned (const struct UBX_NAV_VELNED *velned, GPSPositi
 			GpsVelocity.East	= (float)velned->velE/100.0f;
 			GpsVelocity.Down	= (float)velned->velD/100.0f;
 			GpsVelocity.Accuracy	= (float)velned->sAcc/100.0f;
+			GpsVelocity.ReceiveTime	= msgtracker.set_time;
 			GPSVelocitySet(&GpsVelocity);
 			GpsPosition->Groundspeed = (float)velned->gSpeed * 0.01f;
 			GpsPosition->Heading = (float)velned->heading * 1.0e-5f;
@@ -358,10 +376,12 @@ static void parse_ubx_mon_ver (const struct UBX_MON_VER *version_info)
 // UBX message parser
 // returns UAVObjectID if a UAVObject structure is ready for further processing
 
-static uint32_t parse_ubx_message (const struct UBXPacket *ubx, GPSPositionData *GpsPosition)
+static uint32_t parse_ubx_message (const struct UBXPacket *ubx, GPSPositionData *GpsPosition, uint32_t rx_time)
 {
 	uint32_t id = 0;
 
+	msgtracker.msg_time = rx_time;
+
 	switch (ubx->header.class) {
 		case UBX_CLASS_NAV:
 			switch (ubx->header.id) {
@@ -398,6 +418,7 @@ static uint32_t parse_ubx_message (const struct UBXPacket *ubx, GPSPositionData
 #endif
 	}
 	if (msgtracker.msg_received == ALL_RECEIVED) {
+		GpsPosition->ReceiveTime = msgtracker.set_time;
 		GPSPositionSet(GpsPosition);
 		msgtracker.msg_received = NONE_RECEIVED;
 		id = GPSPOSITION_OBJID;
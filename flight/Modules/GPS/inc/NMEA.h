@@ -39,7 +39,7 @@
 
 extern bool NMEA_update_position(char *nmea_sentence, GPSPositionData *GpsData);
 extern bool NMEA_checksum(char *nmea_sentence);
-extern int parse_nmea_stream(uint8_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
+extern int parse_nmea_stream(const uint8_t *, uint16_t, uint32_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
 
 #endif /* NMEA_H */
 
@@ -227,7 +227,7 @@ struct UBXPacket {
 	UBXPayload	payload;
 };
 
-int  parse_ubx_stream(uint8_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
+int  parse_ubx_stream(const uint8_t *, uint16_t, uint32_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
 
 #endif /* UBX_H */
 
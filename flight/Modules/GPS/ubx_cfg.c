@@ -451,7 +451,7 @@ static void ubx_cfg_pause_parse(uintptr_t gps_port, uint32_t delay_ticks)
     {
         int32_t received = PIOS_COM_ReceiveBuffer(gps_port, &c, 1, 1);
         if (received > 0)
-            parse_ubx_stream (c, gps_rx_buffer, &gpsPosition, &gpsRxStats);
+            parse_ubx_stream (&c, 1, PIOS_Thread_Systime(), gps_rx_buffer, &gpsPosition, &gpsRxStats);
     }
 }
 
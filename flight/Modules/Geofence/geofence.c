@@ -7,7 +7,7 @@
  *
  * @file       geofence.c
  * @author     Tau Labs, http://taulabs.org, Copyright (C) 2012-2014
- * @brief      Check the UAV is within the geofence boundaries
+ * @brief      Check the UAV is within the geofence circle and zones
  *
  * @see        The GNU Public License (GPL) Version 3
  *
@@ -32,8 +32,15 @@
 #include "openpilot.h"
 #include "misc_math.h"
 #include "physical_constants.h"
+#include "pios_flashfs.h"
+#include "pios_thread.h"
+#include "pios_mutex.h"
+#include "rategroup.h"
 
+#include "geofence_index.h"
 #include "geofencesettings.h"
+#include "geofencevertex.h"
+#include "geofencezone.h"
 #include "positionactual.h"
 #include "modulesettings.h"
 
@@ -41,20 +48,44 @@
 //
 // Configuration
 //
-#define SAMPLE_PERIOD_MS     250
+#define MAX_ZONES            8
+#define RESERVED_VERTICES    64
+#define REBUILD_DELAY_MS     500
+
+#if !defined(GEOFENCE_INDEX_MEMORY)
+#define GEOFENCE_INDEX_MEMORY 8192
+#endif
 
 // Private types
 
-// Private variables
+//! A zone ready to be checked
+struct geofence_zone {
+	struct geofence_index index;
+	uint8_t type;
+	float floor;
+	float ceiling;
+};
 
 // Private functions
 static void settingsUpdated(UAVObjEvent* ev);
+static void zonesUpdated(UAVObjEvent* ev);
 static void checkPosition(UAVObjEvent* ev);
+static void rebuildStep(float dT);
+static void loadZones(void);
+static void rebuildZones(void);
 
 // Private variables
 static bool module_enabled;
 static GeoFenceSettingsData *geofenceSettings;
 
+static struct geofence_zone *zones;
+static uint8_t num_zones;
+static bool zones_invalid;
+static bool zones_dirty;
+static uint32_t zones_changed_time;
+static struct pios_mutex *zones_lock;
+static uint8_t *arena;
+
 /**
  * Initialise the module, called on startup
  * \returns 0 on success or -1 if initialisation failed
@@ -78,10 +109,18 @@ int32_t GeofenceInitialize(void)
 	if (module_enabled) {
 
 		GeoFenceSettingsInitialize();
+		GeoFenceZoneInitialize();
+		GeoFenceVertexInitialize();
+
+		// Uploaded zones and vertices are created after start up, keep room for them
+		UAVObjReserveInstances(GeoFenceZoneHandle(), MAX_ZONES);
+		UAVObjReserveInstances(GeoFenceVertexHandle(), RESERVED_VERTICES);
 
 		// allocate and initialize the static data storage only if module is enabled
 		geofenceSettings = (GeoFenceSettingsData *) PIOS_malloc(sizeof(GeoFenceSettingsData));
-		if (geofenceSettings == NULL) {
+		zones = (struct geofence_zone *) PIOS_malloc(sizeof(*zones) * MAX_ZONES);
+		zones_lock = PIOS_Mutex_Create();
+		if (geofenceSettings == NULL || zones == NULL || zones_lock == NULL) {
 			module_enabled = false;
 			return -1;
 		}
@@ -89,13 +128,14 @@ int32_t GeofenceInitialize(void)
 		GeoFenceSettingsConnectCallback(settingsUpdated);
 		settingsUpdated(NULL);
 
-		// Schedule periodic task to check position
-		UAVObjEvent ev = {
-			.obj = PositionActualHandle(),
-			.instId = 0,
-			.event = 0,
-		};
-		EventPeriodicCallbackCreate(&ev, checkPosition, SAMPLE_PERIOD_MS);
+		loadZones();
+		rebuildZones();
+		GeoFenceZoneConnectCallback(zonesUpdated);
+		GeoFenceVertexConnectCallback(zonesUpdated);
+
+		// Check every new position rather than polling it
+		PositionActualInitialize();
+		PositionActualConnectCallback(checkPosition);
 
 		return 0;
 	}
@@ -103,35 +143,236 @@ int32_t GeofenceInitialize(void)
 	return -1;
 }
 
-/* stub: module has no module thread */
+/**
+ * Start the module, it has no thread of its own. Positions are checked
+ * from the event callbacks and the zones are indexed in a rate group.
+ * \returns 0 on success or -1 if the module could not be started
+ */
 int32_t GeofenceStart(void)
 {
-	return 0;
+	if (!module_enabled)
+		return -1;
+
+	return rate_group_add(RATE_GROUP_5HZ, rebuildStep);
 }
 
 MODULE_INITCALL(GeofenceInitialize, GeofenceStart);
 
 /**
- * Periodic callback that processes changes in position and
- * sets the alarm.
+ * Called on every position update, checks the position against the
+ * circle and all the zones and sets the alarm.
  */
 static void checkPosition(UAVObjEvent* ev)
 {
-	if (PositionActualHandle()) {
-		PositionActualData positionActual;
-		PositionActualGet(&positionActual);
+	// The zones are being indexed, keep the alarm as it is until they are done
+	if (!PIOS_Mutex_Lock(zones_lock, 0))
+		return;
+
+	PositionActualData positionActual;
+	PositionActualGet(&positionActual);
 
-		const float distance2 = powf(positionActual.North, 2) + powf(positionActual.East, 2);
+	SystemAlarmsAlarmOptions severity = SYSTEMALARMS_ALARM_OK;
 
-		// ErrorRadius is squared when it is fetched, so this is correct
-		if (distance2 > geofenceSettings->ErrorRadius) {
-			AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, SYSTEMALARMS_ALARM_ERROR);
-		} else if (distance2 > geofenceSettings->WarningRadius) {
-			AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, SYSTEMALARMS_ALARM_WARNING);
+	const float distance2 = positionActual.North * positionActual.North + positionActual.East * positionActual.East;
+
+	// ErrorRadius is squared when it is fetched, so this is correct
+	if (distance2 > geofenceSettings->ErrorRadius) {
+		severity = SYSTEMALARMS_ALARM_ERROR;
+	} else if (distance2 > geofenceSettings->WarningRadius) {
+		severity = SYSTEMALARMS_ALARM_WARNING;
+	}
+
+	// A zone that could not be indexed cannot be trusted
+	if (zones_invalid)
+		severity = SYSTEMALARMS_ALARM_ERROR;
+
+	const float altitude = -positionActual.Down;
+
+	for (uint8_t i = 0; i < num_zones && severity < SYSTEMALARMS_ALARM_ERROR; i++) {
+		const struct geofence_zone *zone = &zones[i];
+
+		float distance;
+		bool inside = geofence_index_query(&zone->index, positionActual.North, positionActual.East, &distance);
+
+		// Positive within the altitude band
+		float band = fminf(altitude - zone->floor, zone->ceiling - altitude);
+
+		bool violated;
+		float clearance;
+		if (zone->type == GEOFENCEZONE_TYPE_KEEPIN) {
+			violated = !inside || band < 0;
+			clearance = fminf(distance, band);
 		} else {
-			AlarmsClear(SYSTEMALARMS_ALARM_GEOFENCE);
+			violated = inside && band >= 0;
+			clearance = inside ? -band : fmaxf(distance, -band);
+		}
+
+		if (violated) {
+			severity = SYSTEMALARMS_ALARM_ERROR;
+		} else if (clearance < geofenceSettings->ZoneWarningDistance) {
+			severity = SYSTEMALARMS_ALARM_WARNING;
+		}
+	}
+
+	PIOS_Mutex_Unlock(zones_lock);
+
+	if (severity == SYSTEMALARMS_ALARM_OK) {
+		AlarmsClear(SYSTEMALARMS_ALARM_GEOFENCE);
+	} else {
+		AlarmsSet(SYSTEMALARMS_ALARM_GEOFENCE, severity);
+	}
+}
+
+/**
+ * Index the zones again once the uploads settled. This walks all the
+ * vertices, so it runs in the rate group rather than in the event
+ * callbacks every other module shares.
+ */
+static void rebuildStep(float dT)
+{
+	if (!zones_dirty || (PIOS_Thread_Systime() - zones_changed_time) < REBUILD_DELAY_MS)
+		return;
+
+	zones_dirty = false;
+
+	PIOS_Mutex_Lock(zones_lock, PIOS_MUTEX_TIMEOUT_MAX);
+	rebuildZones();
+	PIOS_Mutex_Unlock(zones_lock);
+}
+
+/**
+ * Load the zone and vertex instances past the first one, only the
+ * first instance of settings is loaded by the object manager
+ */
+static void loadZones(void)
+{
+#if defined(PIOS_INCLUDE_LOGFS_SETTINGS)
+	extern uintptr_t pios_uavo_settings_fs_id;
+
+	for (uint16_t i = 1; ; i++) {
+		GeoFenceZoneData zone;
+		if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, GEOFENCEZONE_OBJID, i,
+				(uint8_t *) &zone, sizeof(zone)) != 0)
+			break;
+		if (i >= GeoFenceZoneGetNumInstances() && GeoFenceZoneCreateInstance() != i)
+			break;
+		GeoFenceZoneInstSet(i, &zone);
+	}
+
+	for (uint16_t i = 1; ; i++) {
+		GeoFenceVertexData vertex;
+		if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, GEOFENCEVERTEX_OBJID, i,
+				(uint8_t *) &vertex, sizeof(vertex)) != 0)
+			break;
+		if (i >= GeoFenceVertexGetNumInstances() && GeoFenceVertexCreateInstance() != i)
+			break;
+		GeoFenceVertexInstSet(i, &vertex);
+	}
+#endif /* PIOS_INCLUDE_LOGFS_SETTINGS */
+}
+
+/**
+ * Index all the enabled zones. The vertices are copied to the start of
+ * the arena zone after zone and the indexes share what is left.
+ */
+static void rebuildZones(void)
+{
+	num_zones = 0;
+	zones_invalid = false;
+
+	uint8_t zone_ids[MAX_ZONES];
+	uint16_t first_vertex[MAX_ZONES];
+	uint16_t zone_vertices[MAX_ZONES];
+
+	uint16_t zone_instances = GeoFenceZoneGetNumInstances();
+	for (uint16_t i = 0; i < zone_instances; i++) {
+		GeoFenceZoneData zone;
+		GeoFenceZoneInstGet(i, &zone);
+		if (zone.Type == GEOFENCEZONE_TYPE_DISABLED)
+			continue;
+
+		if (num_zones >= MAX_ZONES) {
+			zones_invalid = true;
+			break;
 		}
+
+		zone_ids[num_zones] = i;
+		zones[num_zones].type = zone.Type;
+		zones[num_zones].floor = zone.Floor;
+		zones[num_zones].ceiling = zone.Ceiling;
+		num_zones++;
 	}
+
+	if (num_zones == 0)
+		return;
+
+	// Only pay for the memory once zones are in use, it is never freed
+	if (arena == NULL) {
+		arena = (uint8_t *) PIOS_malloc(GEOFENCE_INDEX_MEMORY);
+		if (arena == NULL) {
+			num_zones = 0;
+			zones_invalid = true;
+			return;
+		}
+	}
+
+	float (*vertices)[2] = (float (*)[2]) arena;
+	const uint16_t max_vertices = GEOFENCE_INDEX_MEMORY / sizeof(vertices[0]);
+	uint16_t used_vertices = 0;
+
+	uint16_t vertex_instances = GeoFenceVertexGetNumInstances();
+	for (uint8_t z = 0; z < num_zones; z++) {
+		first_vertex[z] = used_vertices;
+		for (uint16_t i = 0; i < vertex_instances; i++) {
+			GeoFenceVertexData vertex;
+			GeoFenceVertexInstGet(i, &vertex);
+			if (vertex.Zone != zone_ids[z])
+				continue;
+
+			if (used_vertices >= max_vertices) {
+				zones_invalid = true;
+				break;
+			}
+
+			vertices[used_vertices][0] = vertex.Position[GEOFENCEVERTEX_POSITION_NORTH];
+			vertices[used_vertices][1] = vertex.Position[GEOFENCEVERTEX_POSITION_EAST];
+			used_vertices++;
+		}
+		zone_vertices[z] = used_vertices - first_vertex[z];
+	}
+
+	uint32_t offset = used_vertices * sizeof(vertices[0]);
+
+	uint8_t built = 0;
+	for (uint8_t z = 0; z < num_zones; z++) {
+		// Fair share of what is left so the later zones get memory too
+		uint32_t share = (GEOFENCE_INDEX_MEMORY - offset) / (num_zones - z);
+
+		struct geofence_zone *zone = &zones[built];
+		*zone = zones[z];
+
+		int32_t used = geofence_index_build(&zone->index, &vertices[first_vertex[z]],
+				zone_vertices[z], arena + offset, share);
+		if (used < 0) {
+			zones_invalid = true;
+			continue;
+		}
+
+		// Keep the next cells aligned
+		offset += (used + 3) & ~3;
+		built++;
+	}
+
+	num_zones = built;
+}
+
+/**
+ * Zone or vertex changed, the index is rebuilt once the updates stop
+ */
+static void zonesUpdated(UAVObjEvent* ev)
+{
+	zones_dirty = true;
+	zones_changed_time = PIOS_Thread_Systime();
 }
 
 /**
@@ -0,0 +1,411 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup GeoFence GeoFence Module
+ * @{
+ *
+ * @file       geofence_index.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
+ * @brief      Grid index for constant time queries against a polygon
+ *
+ * The bounding box of the polygon is covered by a uniform grid with about
+ * as many cells as there are edges. Each cell keeps the list of the edges
+ * that pass within half a cell size of it, whether its center is inside the
+ * polygon and how many cells away the closest edge is. A query then only
+ * looks at the few edges around the point, whatever the number of vertices.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "geofence_index.h"
+
+//! Number of cells per edge the grid is sized for
+#define CELLS_PER_EDGE    2
+#define MIN_CELLS         16
+#define MAX_CELLS         8192
+//! Edge lists are indexed with 16 bits
+#define MAX_EDGE_REFS     UINT16_MAX
+//! Number of times the cells are made bigger to fit the arena
+#define MAX_ATTEMPTS      16
+//! Edges this close to a cell, in cell sizes, are listed in the cell
+#define MARGIN            0.5f
+
+#define MIN(x,y) ((x) < (y) ? (x) : (y))
+
+// Private functions
+static bool segment_intersects_box(const float a[2], const float b[2],
+		float north0, float east0, float north1, float east1);
+static float segment_distance_squared(const float a[2], const float b[2], float north, float east);
+static uint32_t rasterize_edges(struct geofence_index *index, bool fill);
+static void compute_inside(struct geofence_index *index);
+static void compute_clearance(struct geofence_index *index);
+
+/**
+ * Build the index of a polygon
+ * @param[out] index The index to build
+ * @param[in] vertices The vertices of the polygon as (North, East) pairs. They
+ * are not copied and must remain valid as long as the index is used.
+ * @param[in] num_vertices Number of vertices, the last one connects back to the first
+ * @param[in] arena Memory for the grid, aligned on 4 bytes
+ * @param[in] arena_size Size of the arena in bytes
+ * @return the number of bytes of the arena used, or -1 if the polygon is
+ * degenerate or can't be indexed in that much memory
+ */
+int32_t geofence_index_build(struct geofence_index *index, const float (*vertices)[2],
+		uint16_t num_vertices, void *arena, uint32_t arena_size)
+{
+	if (num_vertices < 3)
+		return -1;
+
+	float north_min = vertices[0][0], north_max = vertices[0][0];
+	float east_min = vertices[0][1], east_max = vertices[0][1];
+	for (uint16_t i = 1; i < num_vertices; i++) {
+		north_min = fminf(north_min, vertices[i][0]);
+		north_max = fmaxf(north_max, vertices[i][0]);
+		east_min = fminf(east_min, vertices[i][1]);
+		east_max = fmaxf(east_max, vertices[i][1]);
+	}
+
+	const float height = north_max - north_min;
+	const float width = east_max - east_min;
+	if (!(height > 0) || !(width > 0))
+		return -1;
+
+	uint32_t target_cells = num_vertices * CELLS_PER_EDGE;
+	if (target_cells < MIN_CELLS)
+		target_cells = MIN_CELLS;
+	if (target_cells > MAX_CELLS)
+		target_cells = MAX_CELLS;
+
+	index->vertices = vertices;
+	index->num_vertices = num_vertices;
+	index->north_max = north_max;
+	index->east_max = east_max;
+
+	float cell_size = sqrtf(height * width / target_cells);
+	uint32_t used = 0;
+
+	// Start with the ideal cell size and make the cells bigger until it fits
+	for (uint32_t attempt = 0; attempt < MAX_ATTEMPTS && used == 0; attempt++, cell_size *= 1.4142f) {
+		// One more cell on each side so the boundary cells have neighbours
+		const uint32_t rows = (uint32_t)ceilf(height / cell_size) + 2;
+		const uint32_t cols = (uint32_t)ceilf(width / cell_size) + 2;
+		const uint32_t cells_size = rows * cols * sizeof(struct geofence_cell);
+
+		if (rows * cols > MAX_CELLS || cells_size > arena_size)
+			continue;
+
+		index->north_min = north_min - cell_size;
+		index->east_min = east_min - cell_size;
+		index->cell_size = cell_size;
+		index->inv_cell_size = 1.0f / cell_size;
+		index->rows = rows;
+		index->cols = cols;
+		index->cells = (struct geofence_cell *) arena;
+		index->edges = (uint16_t *) ((uint8_t *) arena + cells_size);
+
+		memset(index->cells, 0, cells_size);
+
+		// Count the edges of each cell, then lay the lists out and fill them
+		const uint32_t num_refs = rasterize_edges(index, false);
+		if (num_refs > MAX_EDGE_REFS || cells_size + num_refs * sizeof(uint16_t) > arena_size)
+			continue;
+
+		uint32_t first_edge = 0;
+		for (uint32_t i = 0; i < rows * cols; i++) {
+			index->cells[i].first_edge = first_edge;
+			first_edge += index->cells[i].num_edges;
+			index->cells[i].num_edges = 0;
+		}
+
+		rasterize_edges(index, true);
+
+		used = cells_size + num_refs * sizeof(uint16_t);
+	}
+
+	if (used == 0)
+		return -1;
+
+	compute_inside(index);
+	compute_clearance(index);
+
+	return used;
+}
+
+/**
+ * Check whether a point is inside the polygon and how far the boundary is
+ * @param[in] index The polygon index
+ * @param[in] north The point
+ * @param[in] east The point
+ * @param[out] distance Distance to the boundary. It is exact up to half a
+ * cell size, further away it is a lower bound.
+ * @return true if the point is inside the polygon
+ */
+bool geofence_index_query(const struct geofence_index *index, float north, float east,
+		float *distance)
+{
+	const float row = (north - index->north_min) * index->inv_cell_size;
+	const float col = (east - index->east_min) * index->inv_cell_size;
+
+	if (!(row >= 0) || !(col >= 0) || row >= index->rows || col >= index->cols) {
+		// Outside of the grid, the bounding box is close enough
+		const float north_box = index->north_min + index->cell_size;
+		const float east_box = index->east_min + index->cell_size;
+		const float dn = fmaxf(fmaxf(north_box - north, north - index->north_max), 0);
+		const float de = fmaxf(fmaxf(east_box - east, east - index->east_max), 0);
+		*distance = sqrtf(dn * dn + de * de);
+		return false;
+	}
+
+	const uint32_t r = (uint32_t) row;
+	const uint32_t c = (uint32_t) col;
+	const struct geofence_cell *cell = &index->cells[r * index->cols + c];
+	const float cell_size = index->cell_size;
+
+	if (cell->num_edges == 0) {
+		// No edge within the margin, and the closest cell with edges is
+		// clearance cells away
+		*distance = fmaxf(cell->clearance - 1.0f, MARGIN) * cell_size;
+		return cell->center_inside;
+	}
+
+	const float north_center = index->north_min + (r + 0.5f) * cell_size;
+	const float east_center = index->east_min + (c + 0.5f) * cell_size;
+	const float (*vertices)[2] = index->vertices;
+	const uint16_t *edges = &index->edges[cell->first_edge];
+
+	bool inside = cell->center_inside;
+
+	// Edges further than the margin may be missing from the list
+	float best = (MARGIN * cell_size) * (MARGIN * cell_size);
+
+	for (uint16_t i = 0; i < cell->num_edges; i++) {
+		const uint16_t edge = edges[i];
+		const float *a = vertices[edge];
+		const float *b = vertices[edge + 1 < index->num_vertices ? edge + 1 : 0];
+
+		// Walk from the center of the cell to the point, first along East
+		// then along North, and count the edges crossed on the way. The
+		// cell edge list covers the whole path.
+		if ((a[0] > north_center) != (b[0] > north_center)) {
+			const float east_cross = a[1] + (north_center - a[0]) * (b[1] - a[1]) / (b[0] - a[0]);
+			if ((east_cross < east) != (east_cross < east_center))
+				inside = !inside;
+		}
+
+		if ((a[1] > east) != (b[1] > east)) {
+			const float north_cross = a[0] + (east - a[1]) * (b[0] - a[0]) / (b[1] - a[1]);
+			if ((north_cross < north) != (north_cross < north_center))
+				inside = !inside;
+		}
+
+		best = fminf(best, segment_distance_squared(a, b, north, east));
+	}
+
+	*distance = sqrtf(best);
+
+	return inside;
+}
+
+/**
+ * Check whether a segment crosses a box
+ */
+static bool segment_intersects_box(const float a[2], const float b[2],
+		float north0, float east0, float north1, float east1)
+{
+	const float lo[2] = { north0, east0 };
+	const float hi[2] = { north1, east1 };
+	float t0 = 0, t1 = 1;
+
+	for (uint32_t k = 0; k < 2; k++) {
+		const float d = b[k] - a[k];
+		if (d == 0) {
+			if (a[k] < lo[k] || a[k] > hi[k])
+				return false;
+		} else {
+			float ta = (lo[k] - a[k]) / d;
+			float tb = (hi[k] - a[k]) / d;
+			if (ta > tb) {
+				const float tmp = ta;
+				ta = tb;
+				tb = tmp;
+			}
+			t0 = fmaxf(t0, ta);
+			t1 = fminf(t1, tb);
+			if (t0 > t1)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Squared distance from a point to a segment
+ */
+static float segment_distance_squared(const float a[2], const float b[2], float north, float east)
+{
+	const float dn = b[0] - a[0];
+	const float de = b[1] - a[1];
+	const float length2 = dn * dn + de * de;
+
+	float t = 0;
+	if (length2 > 0) {
+		t = ((north - a[0]) * dn + (east - a[1]) * de) / length2;
+		t = fminf(fmaxf(t, 0), 1);
+	}
+
+	const float pn = a[0] + t * dn - north;
+	const float pe = a[1] + t * de - east;
+
+	return pn * pn + pe * pe;
+}
+
+/**
+ * Add each edge to the cells it passes within the margin of
+ * @param[in] fill false to only count the edges of each cell, true to also
+ * store them at the position laid out from the counts
+ * @return the total number of edge references
+ */
+static uint32_t rasterize_edges(struct geofence_index *index, bool fill)
+{
+	const float cell_size = index->cell_size;
+	const float (*vertices)[2] = index->vertices;
+	uint32_t total = 0;
+
+	for (uint16_t i = 0; i < index->num_vertices; i++) {
+		const float *a = vertices[i];
+		const float *b = vertices[i + 1 < index->num_vertices ? i + 1 : 0];
+
+		// Range of cells whose grown box may touch the edge
+		const float margin = MARGIN * cell_size;
+		const float row0 = (fminf(a[0], b[0]) - margin - index->north_min) * index->inv_cell_size;
+		const float row1 = (fmaxf(a[0], b[0]) + margin - index->north_min) * index->inv_cell_size;
+		const float col0 = (fminf(a[1], b[1]) - margin - index->east_min) * index->inv_cell_size;
+		const float col1 = (fmaxf(a[1], b[1]) + margin - index->east_min) * index->inv_cell_size;
+
+		const uint32_t r0 = row0 > 0 ? (uint32_t) row0 : 0;
+		const uint32_t r1 = row1 < index->rows - 1u ? (uint32_t) row1 : index->rows - 1u;
+		const uint32_t c0 = col0 > 0 ? (uint32_t) col0 : 0;
+		const uint32_t c1 = col1 < index->cols - 1u ? (uint32_t) col1 : index->cols - 1u;
+
+		for (uint32_t r = r0; r <= r1; r++) {
+			const float north0 = index->north_min + r * cell_size - margin;
+			for (uint32_t c = c0; c <= c1; c++) {
+				const float east0 = index->east_min + c * cell_size - margin;
+
+				if (!segment_intersects_box(a, b, north0, east0,
+						north0 + cell_size + 2 * margin, east0 + cell_size + 2 * margin))
+					continue;
+
+				struct geofence_cell *cell = &index->cells[r * index->cols + c];
+				if (fill)
+					index->edges[cell->first_edge + cell->num_edges] = i;
+				cell->num_edges++;
+				total++;
+			}
+		}
+	}
+
+	return total;
+}
+
+/**
+ * Find which cell centers are inside the polygon, one scanline per row.
+ * A center is inside when an odd number of edges cross the row West of it.
+ */
+static void compute_inside(struct geofence_index *index)
+{
+	const float cell_size = index->cell_size;
+	const float (*vertices)[2] = index->vertices;
+
+	for (uint32_t r = 0; r < index->rows; r++) {
+		struct geofence_cell *row = &index->cells[r * index->cols];
+		const float north_center = index->north_min + (r + 0.5f) * cell_size;
+
+		// Flag the first center East of each crossing
+		for (uint16_t i = 0; i < index->num_vertices; i++) {
+			const float *a = vertices[i];
+			const float *b = vertices[i + 1 < index->num_vertices ? i + 1 : 0];
+
+			if ((a[0] > north_center) == (b[0] > north_center))
+				continue;
+
+			const float east_cross = a[1] + (north_center - a[0]) * (b[1] - a[1]) / (b[0] - a[0]);
+			const float first = floorf((east_cross - index->east_min) * index->inv_cell_size - 0.5f) + 1;
+			if (first >= index->cols)
+				continue;
+
+			row[first > 0 ? (uint32_t) first : 0].center_inside ^= 1;
+		}
+
+		// And count them from the West
+		for (uint32_t c = 1; c < index->cols; c++)
+			row[c].center_inside ^= row[c - 1].center_inside;
+	}
+}
+
+/**
+ * Distance in cells from each cell to the closest cell holding edges,
+ * with a two pass chessboard distance transform
+ */
+static void compute_clearance(struct geofence_index *index)
+{
+	const int32_t rows = index->rows;
+	const int32_t cols = index->cols;
+	struct geofence_cell *cells = index->cells;
+
+	for (int32_t i = 0; i < rows * cols; i++)
+		cells[i].clearance = cells[i].num_edges ? 0 : UINT8_MAX;
+
+	for (int32_t r = 0; r < rows; r++) {
+		for (int32_t c = 0; c < cols; c++) {
+			uint32_t clearance = cells[r * cols + c].clearance;
+			for (int32_t dc = -1; dc <= 1; dc++) {
+				if (r > 0 && c + dc >= 0 && c + dc < cols)
+					clearance = MIN(clearance, cells[(r - 1) * cols + c + dc].clearance + 1u);
+			}
+			if (c > 0)
+				clearance = MIN(clearance, cells[r * cols + c - 1].clearance + 1u);
+			cells[r * cols + c].clearance = clearance;
+		}
+	}
+
+	for (int32_t r = rows - 1; r >= 0; r--) {
+		for (int32_t c = cols - 1; c >= 0; c--) {
+			uint32_t clearance = cells[r * cols + c].clearance;
+			for (int32_t dc = -1; dc <= 1; dc++) {
+				if (r < rows - 1 && c + dc >= 0 && c + dc < cols)
+					clearance = MIN(clearance, cells[(r + 1) * cols + c + dc].clearance + 1u);
+			}
+			if (c < cols - 1)
+				clearance = MIN(clearance, cells[r * cols + c + 1].clearance + 1u);
+			cells[r * cols + c].clearance = clearance;
+		}
+	}
+}
+
+/**
+ * @}
+ * @}
+ */
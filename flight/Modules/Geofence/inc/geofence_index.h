@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup GeoFence GeoFence Module
+ * @{
+ *
+ * @file       geofence_index.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
+ * @brief      Grid index for constant time queries against a polygon
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef GEOFENCE_INDEX_H
+#define GEOFENCE_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! One cell of the grid
+struct geofence_cell {
+	uint16_t first_edge;    //!< Index of the first edge of the cell in the edge list
+	uint16_t num_edges;     //!< Edges within half a cell size of this cell
+	uint8_t center_inside;  //!< Whether the center of the cell is inside the polygon
+	uint8_t clearance;      //!< Distance in cells to the closest cell with edges
+};
+
+//! Index of a polygon, all the memory lives in the arena given to the build
+struct geofence_index {
+	const float (*vertices)[2];     //!< Polygon vertices (North, East), not copied
+	uint16_t num_vertices;
+
+	float north_min;                //!< Grid origin
+	float east_min;
+	float north_max;                //!< Bounding box of the polygon
+	float east_max;
+	float cell_size;
+	float inv_cell_size;
+	uint16_t rows;                  //!< Along North
+	uint16_t cols;                  //!< Along East
+
+	struct geofence_cell *cells;
+	uint16_t *edges;                //!< Edge lists of all the cells
+};
+
+int32_t geofence_index_build(struct geofence_index *index, const float (*vertices)[2],
+		uint16_t num_vertices, void *arena, uint32_t arena_size);
+bool geofence_index_query(const struct geofence_index *index, float north, float east,
+		float *distance);
+
+#endif /* GEOFENCE_INDEX_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -42,6 +42,7 @@
 #include "openpilot.h"
 #include "physical_constants.h"
 #include "misc_math.h"
+#include "fastmath.h"
 #include "paths.h"
 #include "pid.h"
 
@@ -64,6 +65,7 @@
 #include "velocityactual.h"
 #include "groundpathfollowersettings.h"
 #include "coordinate_conversions.h"
+#include "rotation_math.h"
 #include "pios_thread.h"
 
 // Private constants
@@ -389,7 +391,7 @@ static void updateGroundDesiredAttitude()
 	float eastVel = velocityActual.East;
 
 	// Calculate direction from velocityDesired and set stabDesired.Yaw
-	stabDesired.Yaw = atan2f( velocityDesired.East, velocityDesired.North ) * RAD2DEG;
+	stabDesired.Yaw = fast_atan2f( velocityDesired.East, velocityDesired.North ) * RAD2DEG;
 
 	// Calculate throttle and set stabDesired.Throttle
 	float velDesired = sqrtf(powf(velocityDesired.East,2) + powf(velocityDesired.North,2));
@@ -444,7 +446,6 @@ static void updateNedAccel()
 {
 	float accel[3];
 	float q[4];
-	float Rbe[3][3];
 	float accel_ned[3];
 
 	// Collect downsampled attitude data
@@ -461,12 +462,7 @@ static void updateNedAccel()
 	q[1]=attitudeActual.q2;
 	q[2]=attitudeActual.q3;
 	q[3]=attitudeActual.q4;
-	Quaternion2R(q, Rbe);
-	for (uint8_t i=0; i<3; i++){
-		accel_ned[i]=0;
-		for (uint8_t j=0; j<3; j++)
-			accel_ned[i] += Rbe[j][i]*accel[j];
-	}
+	quat_rotate_transpose(q, accel, accel_ned);
 	accel_ned[2] += GRAVITY;
 
 	NedAccelData accelData;
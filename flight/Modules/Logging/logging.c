@@ -56,6 +56,10 @@
 #include "waypoint.h"
 #include "waypointactive.h"
 
+#if defined(PIOS_INCLUDE_TRACE)
+#include "tracebuffer.h"
+#endif
+
 // Private constants
 #define STACK_SIZE_BYTES 1200
 #define TASK_PRIORITY PIOS_THREAD_PRIO_LOW
@@ -79,6 +83,9 @@ static void SettingsUpdatedCb(UAVObjEvent * ev);
 static void FlightStatusUpdatedCb(UAVObjEvent * ev);
 static void WaypointActiveUpdatedCb(UAVObjEvent * ev);
 static void writeHeader();
+#if defined(PIOS_INCLUDE_TRACE)
+static void writeTrace();
+#endif
 
 // Local variables
 static uintptr_t logging_com_id;
@@ -249,6 +256,9 @@ static void loggingTask(void *parameters)
 			loggingData.MaxFileId = PIOS_STREAMFS_MaxFileId(streamfs_id);
 			LoggingStatsSet(&loggingData);
 		} else if (loggingData.Operation != LOGGINGSTATS_OPERATION_LOGGING && write_open) {
+#if defined(PIOS_INCLUDE_TRACE)
+			writeTrace();
+#endif
 			PIOS_STREAMFS_Close(streamfs_id);
 			loggingData.MinFileId = PIOS_STREAMFS_MinFileId(streamfs_id);
 			loggingData.MaxFileId = PIOS_STREAMFS_MaxFileId(streamfs_id);
@@ -400,6 +410,22 @@ static void logSettings(UAVObjHandle obj)
 	}
 }
 
+#if defined(PIOS_INCLUDE_TRACE)
+/**
+ * Write the last events of the trace buffer at the end of the log
+ */
+static void writeTrace()
+{
+	TraceBufferFreeze();
+
+	for (uint16_t chunk = 0; TraceBufferLoadChunk(chunk); chunk++) {
+		UAVTalkSendObjectTimestamped(uavTalkCon, TraceDataHandle(), 0, false, 0);
+	}
+
+	TraceBufferResume();
+}
+#endif
+
 /**
  * Write log file header
  * see firmwareinfotemplate.c
@@ -63,7 +63,6 @@
 
 // Private variables
 static struct pios_thread *taskHandle;
-static uint32_t lastSysTime;
 
 // Private functions
 static void manualControlTask(void *parameters);
@@ -114,9 +113,6 @@ static void manualControlTask(void *parameters)
 	flightStatus.Armed = FLIGHTSTATUS_ARMED_DISARMED;
 	FlightStatusSet(&flightStatus);
 
-	// Main task loop
-	lastSysTime = PIOS_Thread_Systime();
-
 	// Select failsafe before run
 	failsafe_control_select(true);
 
@@ -190,8 +186,10 @@ static void manualControlTask(void *parameters)
 			break;
 		}
 
-		// Wait until next update
-		PIOS_Thread_Sleep_Until(&lastSysTime, UPDATE_PERIOD_MS);
+		// Wait until a receiver decoded the next frame. Receivers that
+		// do not signal their frames (PWM, PPM) and the other control
+		// sources are still updated every UPDATE_PERIOD_MS.
+		PIOS_RCVR_WaitActivity(UPDATE_PERIOD_MS);
 		PIOS_WDG_UpdateFlag(PIOS_WDG_MANUAL);
 	}
 }
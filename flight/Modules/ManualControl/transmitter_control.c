@@ -70,23 +70,28 @@
 #define CONNECTION_OFFSET_THROTTLE 100
 #define CONNECTION_OFFSET          250
 
+// The update runs on every receiver frame, so these are times rather than update counts
+#define CONNECTION_HYSTERESIS_MS 200
+
 #define RCVR_ACTIVITY_MONITOR_CHANNELS_PER_GROUP 12
 #define RCVR_ACTIVITY_MONITOR_MIN_RANGE 10
+#define RCVR_ACTIVITY_MONITOR_SAMPLE_MS 20
 struct rcvr_activity_fsm {
 	ManualControlSettingsChannelGroupsOptions group;
 	uint16_t prev[RCVR_ACTIVITY_MONITOR_CHANNELS_PER_GROUP];
 	uint8_t sample_count;
+	uint32_t sample_time;
 };
 
 
 // Private variables
 static ManualControlCommandData   cmd;
 static ManualControlSettingsData  settings;
-static uint8_t                    disconnected_count = 0;
-static uint8_t                    connected_count = 0;
+static uint32_t                   lastConnectionAgreedTime;
 static struct rcvr_activity_fsm   activity_fsm;
 static uint32_t               lastActivityTime;
 static uint32_t               lastSysTime;
+static uint32_t               lastFrameTime;
 static float                      flight_mode_value;
 static enum control_events        pending_control_event;
 static bool                       settings_updated;
@@ -138,6 +143,7 @@ int32_t transmitter_control_initialize()
 
 	/* Initialize the RcvrActivty FSM */
 	lastActivityTime = PIOS_Thread_Systime();
+	lastConnectionAgreedTime = lastActivityTime;
 	resetRcvrActivity(&activity_fsm);
 
 	// Use callback to update the settings when they change
@@ -317,15 +323,15 @@ int32_t transmitter_control_update()
 	    flightmode_valid_input &&
 	    arming_valid_input;
 
-	// Implement hysteresis loop on connection status
-	if (valid_input_detected && (++connected_count > 10)) {
-		cmd.Connected = MANUALCONTROLCOMMAND_CONNECTED_TRUE;
-		connected_count = 0;
-		disconnected_count = 0;
-	} else if (!valid_input_detected && (++disconnected_count > 10)) {
-		cmd.Connected = MANUALCONTROLCOMMAND_CONNECTED_FALSE;
-		connected_count = 0;
-		disconnected_count = 0;
+	// Implement hysteresis loop on connection status, the input has to
+	// disagree with it for CONNECTION_HYSTERESIS_MS to change it
+	bool connected = (cmd.Connected == MANUALCONTROLCOMMAND_CONNECTED_TRUE);
+	if (valid_input_detected == connected) {
+		lastConnectionAgreedTime = lastSysTime;
+	} else if (timeDifferenceMs(lastConnectionAgreedTime, lastSysTime) > CONNECTION_HYSTERESIS_MS) {
+		cmd.Connected = valid_input_detected ?
+			MANUALCONTROLCOMMAND_CONNECTED_TRUE : MANUALCONTROLCOMMAND_CONNECTED_FALSE;
+		lastConnectionAgreedTime = lastSysTime;
 	}
 
 	if (cmd.Connected == MANUALCONTROLCOMMAND_CONNECTED_FALSE) {
@@ -394,6 +400,14 @@ int32_t transmitter_control_update()
 	// is processed in the _update method instead of _select method so the state system is always
 	// evalulated, even if not detected.
 	process_transmitter_events(&cmd, &settings, valid_input_detected);
+
+	// Time from the receiver decoding the last frame until it is used here
+	uint32_t frameTime = PIOS_RCVR_GetLastActivity();
+	if (frameTime != lastFrameTime) {
+		lastFrameTime = frameTime;
+		uint32_t latency = PIOS_DELAY_DiffuS(frameTime);
+		cmd.InputLatency = (latency > UINT16_MAX) ? UINT16_MAX : latency;
+	}
 	
 	// Update cmd object
 	ManualControlCommandSet(&cmd);
@@ -862,6 +876,12 @@ static bool updateRcvrActivity(struct rcvr_activity_fsm * fsm)
 					fsm->prev,
 					NELEMENTS(fsm->prev));
 		fsm->sample_count++;
+		fsm->sample_time = lastSysTime;
+		return (false);
+	}
+
+	/* Give the channels time to change, updates can be a frame apart */
+	if (timeDifferenceMs(fsm->sample_time, lastSysTime) < RCVR_ACTIVITY_MONITOR_SAMPLE_MS) {
 		return (false);
 	}
 
@@ -890,6 +910,7 @@ group_completed:
 						fsm->prev,
 						NELEMENTS(fsm->prev));
 			fsm->sample_count++;
+			fsm->sample_time = lastSysTime;
 			break;
 		}
 	}
@@ -2,12 +2,7 @@
 #define IMAGES_H
 
 
-struct Image {
-	uint16_t width;
-	uint16_t height;
-	uint8_t* mask;
-	uint8_t* level;
-};
+#include "osd_utils.h"
 
 static const uint8_t mask_brain[] = {
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
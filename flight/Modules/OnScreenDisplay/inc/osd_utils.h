@@ -141,10 +141,36 @@ typedef struct {
 	int16_t y;
 } point_t;
 
+// Area of the screen, both corners included. Empty when x0 > x1.
+struct osd_rect {
+	int16_t x0, y0, x1, y1;
+};
+
+// Bitmap with a mask and a level plane
+struct Image {
+	uint16_t width;
+	uint16_t height;
+	uint8_t* mask;
+	uint8_t* level;
+};
+
+// Everything drawn since the last osd_bounds_reset() lies within these bounds,
+// this is how the areas that need clearing in the next frame are found
+extern struct osd_rect osd_draw_bounds;
+
+#define OSD_TRACK_BOUNDS(xa, ya, xb, yb) { \
+	if ((xa) < osd_draw_bounds.x0) { osd_draw_bounds.x0 = (xa); } \
+	if ((ya) < osd_draw_bounds.y0) { osd_draw_bounds.y0 = (ya); } \
+	if ((xb) > osd_draw_bounds.x1) { osd_draw_bounds.x1 = (xb); } \
+	if ((yb) > osd_draw_bounds.y1) { osd_draw_bounds.y1 = (yb); } }
+
 void plotFourQuadrants(int32_t centerX, int32_t centerY, int32_t deltaX, int32_t deltaY);
 void ellipse(int centerX, int centerY, int horizontalRadius, int verticalRadius);
 void drawArrow(uint16_t x, uint16_t y, uint16_t angle, uint16_t size_quarter);
 void drawBox(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+void draw_image(uint16_t x, uint16_t y, const struct Image * image);
+void osd_bounds_reset(void);
+void clear_rect(const struct osd_rect *rect);
 void write_pixel(uint8_t *buff, int x, int y, int mode);
 void write_pixel_lm(int x, int y, int mmode, int lmode);
 void write_hline(uint8_t *buff, int x0, int x1, int y, int mode);
@@ -174,6 +200,7 @@ void write_word_misaligned_lm(uint16_t wordl, uint16_t wordm, unsigned int addr,
 int fetch_font_info(uint8_t ch, int font, struct FontEntry *font_info, char *lookup);
 void write_char16(char ch, int x, int y, int flags, int font);
 void write_char(char ch, int x, int y, int flags, int font);
+void write_char_cached(char ch, int x, int y, int flags, int font);
 void calc_text_dimensions(char *str, struct FontEntry font, int xs, int ys, struct FontDimensions *dim);
 void write_string(char *str, int x, int y, int xs, int ys, int va, int ha, int flags, int font);
 void draw_polygon(int16_t x, int16_t y, float angle, const point_t * points, uint8_t n_points, int mode, int mmode);
@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * @addtogroup Tau Labs Modules
+ * @{
+ * @addtogroup OnScreenDisplay OSD Module
+ * @brief Retained OSD elements
+ * @{
+ *
+ * @file       osd_widgets.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Retained OSD elements, only redrawn when they change
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef OSDWIDGETS_H
+#define OSDWIDGETS_H
+
+#include "osd_utils.h"
+
+#define OSD_WIDGET_TEXT_LEN 48
+
+enum osd_widget_type {
+	OSD_WIDGET_NONE,
+	OSD_WIDGET_TEXT,
+	OSD_WIDGET_IMAGE,
+};
+
+// A text or an image that stays in the draw buffers between frames
+struct osd_widget {
+	struct osd_rect drawn[2];       // area covered in each draw buffer
+	float value;                    // value the content was made from
+	const struct Image *image;
+	int16_t x, y;
+	uint8_t type;
+	uint8_t va, ha, flags, font;
+	uint8_t pending;                // draw buffers that don't show the content yet
+	bool valid;                     // value is up to date
+	bool used;                      // declared in this frame
+	char text[OSD_WIDGET_TEXT_LEN];
+};
+
+void osd_widgets_begin(struct osd_widget *widgets, uint8_t num_widgets);
+void osd_widgets_end(void);
+void osd_widgets_invalidate(void);
+void osd_region_begin(void);
+void osd_region_end(void);
+bool osd_widget_update(struct osd_widget *widget, float value);
+void osd_widget_text(struct osd_widget *widget, const char *text, int x, int y, int va, int ha, int flags, int font);
+void osd_widget_image(struct osd_widget *widget, const struct Image *image, int x, int y);
+
+#endif /* OSDWIDGETS_H */
@@ -61,6 +61,7 @@
 #include "pios_thread.h"
 #include "pios_semaphore.h"
 #include "misc_math.h"
+#include "fastmath.h"
 
 #include "onscreendisplay.h"
 #include "onscreendisplaysettings.h"
@@ -101,6 +102,7 @@
 #include "waypointactive.h"
 
 #include "osd_utils.h"
+#include "osd_widgets.h"
 #include "osd_menu.h"
 #include "fonts.h"
 #include "font12x18.h"
@@ -201,6 +203,34 @@ static AccelsData accelsDataAcc;
 //                     small, normal, large
 const int SIZE_TO_FONT[3] = {2, 0, 3};
 
+// Retained elements of the user pages
+enum page_widget {
+	WIDGET_ALARMS,
+	WIDGET_ALTITUDE,
+	WIDGET_ARMED,
+	WIDGET_BATTERY_VOLT,
+	WIDGET_BATTERY_CURRENT,
+	WIDGET_BATTERY_CONSUMED,
+	WIDGET_CLIMB_RATE,
+	WIDGET_CUSTOM_TEXT,
+	WIDGET_CPU,
+	WIDGET_FLIGHT_MODE,
+	WIDGET_GFORCE,
+	WIDGET_GPS_ICON,
+	WIDGET_GPS_STATUS,
+	WIDGET_GPS_LAT,
+	WIDGET_GPS_LON,
+	WIDGET_GPS_MGRS,
+	WIDGET_HOME_ICON,
+	WIDGET_HOME_DISTANCE,
+	WIDGET_RSSI_ICON,
+	WIDGET_RSSI,
+	WIDGET_SPEED,
+	WIDGET_TIME,
+	NUM_PAGE_WIDGETS
+};
+static struct osd_widget page_widgets[NUM_PAGE_WIDGETS];
+
 
 #ifdef DEBUG_TIMING
 static uint32_t in_ticks  = 0;
@@ -216,33 +246,6 @@ void clearGraphics()
 	memset((uint8_t *)draw_buffer_level, 0, BUFFER_HEIGHT * BUFFER_WIDTH);
 }
 
-void draw_image(uint16_t x, uint16_t y, const struct Image * image)
-{
-	CHECK_COORDS(x + image->width, y + image->height);
-	uint8_t byte_width = image->width / 8;
-	uint8_t pixel_offset = x % 8;
-	uint8_t mask1 = 0xFF;
-	uint8_t mask2 = 0x00;
-
-	if (pixel_offset > 0) {
-		for (uint8_t i=0; i<pixel_offset; i++) {
-			mask2 |= 0x01 << i;
-		}
-		mask1 = ~mask2;
-	}
-
-	for (uint16_t yp = 0; yp < image->height; yp++){
-		for (uint16_t xp = 0; xp < image->width / 8; xp++){
-			draw_buffer_level[(y + yp) * BUFFER_WIDTH + xp + x / 8] |= (image->level[yp * byte_width + xp] & mask1) >> pixel_offset;
-			draw_buffer_mask[(y + yp) * BUFFER_WIDTH + xp + x / 8] |= (image->mask[yp * byte_width + xp] & mask1) >> pixel_offset;
-			if (pixel_offset > 0) {
-				draw_buffer_level[(y + yp) * BUFFER_WIDTH + xp + x / 8 + 1] |= (image->level[yp * byte_width + xp] & mask2) << (8 - pixel_offset);
-				draw_buffer_mask[(y + yp) * BUFFER_WIDTH + xp + x / 8 + 1] |= (image->mask[yp * byte_width + xp] & mask2) << (8 - pixel_offset);
-			}
-		}
-	}
-}
-
 void drawBattery(uint16_t x, uint16_t y, uint8_t battery, uint16_t size)
 {
 	write_rectangle_outlined(x - 2, y + 2, 2, size / 3 - 4, 0, 1);
@@ -565,8 +568,8 @@ void simple_artifical_horizon(float roll, float pitch, int16_t x, int16_t y, int
 	int16_t pp_y2;
 
 
-	sin_roll    = sinf(roll * (float)(M_PI / 180));
-	cos_roll    = cosf(roll * (float)(M_PI / 180));
+	sin_roll    = fast_sinf(roll * (float)(M_PI / 180));
+	cos_roll    = fast_cosf(roll * (float)(M_PI / 180));
 
 	// roll to pitch transformation
 	pp_x        = x * (1 + (sin_roll * pitch) / (float)max_pitch);
@@ -616,7 +619,7 @@ void simple_artifical_horizon(float roll, float pitch, int16_t x, int16_t y, int
 	}
 }
 
-void draw_flight_mode(int x, int y, int xs, int ys, int va, int ha, int flags, int font)
+const char * flight_mode_text()
 {
 	uint8_t mode;
 	FlightStatusFlightModeGet(&mode);
@@ -624,80 +627,59 @@ void draw_flight_mode(int x, int y, int xs, int ys, int va, int ha, int flags, i
 	switch (mode)
 	{
 		case FLIGHTSTATUS_FLIGHTMODE_MANUAL:
-			write_string("MAN", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "MAN";
 		case FLIGHTSTATUS_FLIGHTMODE_ACRO:
-			write_string("ACRO", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "ACRO";
 		case FLIGHTSTATUS_FLIGHTMODE_ACROPLUS:
-			write_string("ACRO PLUS", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "ACRO PLUS";
 		case FLIGHTSTATUS_FLIGHTMODE_LEVELING:
-			write_string("LEVEL", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "LEVEL";
 		case FLIGHTSTATUS_FLIGHTMODE_MWRATE:
-			write_string("MWRTE", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "MWRTE";
 		case FLIGHTSTATUS_FLIGHTMODE_HORIZON:
-			write_string("HOR", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "HOR";
 		case FLIGHTSTATUS_FLIGHTMODE_AXISLOCK:
-			write_string("ALCK", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "ALCK";
 		case FLIGHTSTATUS_FLIGHTMODE_VIRTUALBAR:
-			write_string("VBAR", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "VBAR";
 		case FLIGHTSTATUS_FLIGHTMODE_STABILIZED1:
-			write_string("ST1", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "ST1";
 		case FLIGHTSTATUS_FLIGHTMODE_STABILIZED2:
-			write_string("ST2", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "ST2";
 		case FLIGHTSTATUS_FLIGHTMODE_STABILIZED3:
-			write_string("ST3", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "ST3";
 		case FLIGHTSTATUS_FLIGHTMODE_AUTOTUNE:
-			write_string("TUNE", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "TUNE";
 		case FLIGHTSTATUS_FLIGHTMODE_ALTITUDEHOLD:
-			write_string("AHLD", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "AHLD";
 		case FLIGHTSTATUS_FLIGHTMODE_POSITIONHOLD:
-			write_string("PHLD", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "PHLD";
 		case FLIGHTSTATUS_FLIGHTMODE_RETURNTOHOME:
-			write_string("RTH", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "RTH";
 		case FLIGHTSTATUS_FLIGHTMODE_PATHPLANNER:
-			write_string("PLAN", x, y, xs, ys, va, ha, flags, font);
-			break;
+			return "PLAN";
 		case FLIGHTSTATUS_FLIGHTMODE_TABLETCONTROL:
 			TabletInfoTabletModeDesiredGet(&mode);
 			switch (mode) {
 				case TABLETINFO_TABLETMODEDESIRED_POSITIONHOLD:
-					write_string("TAB PH", x, y, xs, ys, va, ha, flags, font);
-					break;
+					return "TAB PH";
 				case TABLETINFO_TABLETMODEDESIRED_RETURNTOHOME:
-					write_string("TAB RTH", x, y, xs, ys, va, ha, flags, font);
-					break;
+					return "TAB RTH";
 				case TABLETINFO_TABLETMODEDESIRED_RETURNTOTABLET:
-					write_string("TAB RTT", x, y, xs, ys, va, ha, flags, font);
-					break;
+					return "TAB RTT";
 				case TABLETINFO_TABLETMODEDESIRED_PATHPLANNER:
-					write_string("TAB Path", x, y, xs, ys, va, ha, flags, font);
-					break;
+					return "TAB Path";
 				case TABLETINFO_TABLETMODEDESIRED_FOLLOWME:
-					write_string("TAB FollowMe", x, y, xs, ys, va, ha, flags, font);
-					break;
+					return "TAB FollowMe";
 				case TABLETINFO_TABLETMODEDESIRED_LAND:
-					write_string("TAB Land", x, y, xs, ys, va, ha, flags, font);
-					break;
+					return "TAB Land";
 				case TABLETINFO_TABLETMODEDESIRED_CAMERAPOI:
-					write_string("TAB POI", x, y, xs, ys, va, ha, flags, font);
-					break;
+					return "TAB POI";
 			}
 			break;
 	}
+
+	return NULL;
 }
 
 const uint8_t ALL_ALRARMS[] = {SYSTEMALARMS_ALARM_OUTOFMEMORY,
@@ -740,11 +722,10 @@ const char * ALL_ALRARM_NAMES[] = {"MEMORY",
 									"A-HOLD",
 									"BOOT"};
 
-void draw_alarms(int x, int y, int xs, int ys, int va, int ha, int flags, int font)
+bool alarms_text(char *temp, uint8_t size)
 {
 	uint8_t str_pos = 0;
 	uint8_t this_len;
-	char temp[100]  = { 0 };
 	SystemAlarmsData alarm;
 
 	SystemAlarmsGet(&alarm);
@@ -755,7 +736,7 @@ void draw_alarms(int x, int y, int xs, int ys, int va, int ha, int flags, int fo
 			(alarm.Alarm[ALL_ALRARMS[pos]] == SYSTEMALARMS_ALARM_ERROR) ||
 			(alarm.Alarm[ALL_ALRARMS[pos]] == SYSTEMALARMS_ALARM_CRITICAL)){
 			this_len = strlen(ALL_ALRARM_NAMES[pos]);
-			if (str_pos + this_len + 2 >= sizeof(temp))
+			if (str_pos + this_len + 2 >= size)
 				break;
 
 			if ((alarm.Alarm[ALL_ALRARMS[pos]] != SYSTEMALARMS_ALARM_WARNING) && !blink){
@@ -774,10 +755,8 @@ void draw_alarms(int x, int y, int xs, int ys, int va, int ha, int flags, int fo
 			str_pos += 1;
 		}
 	}
-	if (str_pos > 0){
-		temp[str_pos] = '\0';
-		write_string(temp, x, y, xs, ys, va, ha, flags, font);
-	}
+	temp[str_pos] = '\0';
+	return str_pos > 0;
 }
 
 
@@ -878,14 +857,14 @@ void draw_map_home_center(int width_px, int height_px, int width_m, int height_m
 		rot = yaw - 210;
 		if (rot < 0)
 			rot += 360;
-		x = p_east_draw + 10.f * sinf(rot * (float)(M_PI / 180));
-		y = p_north_draw - 10.f * cosf(rot * (float)(M_PI / 180));
+		x = p_east_draw + 10.f * fast_sinf(rot * (float)(M_PI / 180));
+		y = p_north_draw - 10.f * fast_cosf(rot * (float)(M_PI / 180));
 		write_line_outlined(p_east_draw, p_north_draw, x, y, 2, 0, 0, 1);
 		rot = yaw - 150;
 		if (rot < 0)
 			rot += 360;
-		x = p_east_draw + 10 * sinf(rot * (float)(M_PI / 180));
-		y = p_north_draw - 10 * cosf(rot * (float)(M_PI / 180));
+		x = p_east_draw + 10 * fast_sinf(rot * (float)(M_PI / 180));
+		y = p_north_draw - 10 * fast_cosf(rot * (float)(M_PI / 180));
 		write_line_outlined(p_east_draw, p_north_draw, x, y, 2, 0, 0, 1);
 	}
 }
@@ -912,8 +891,8 @@ void draw_map_uav_center(int width_px, int height_px, int width_m, int height_m,
 	PositionActualEastGet(&p_east);
 	if (yaw < 0)
 		yaw += 360;
-	sin_yaw = sinf(yaw * (float)(M_PI / 180));
-	cos_yaw = cosf(yaw * (float)(M_PI / 180));
+	sin_yaw = fast_sinf(yaw * (float)(M_PI / 180));
+	cos_yaw = fast_cosf(yaw * (float)(M_PI / 180));
 
 	// Draw waypoints
 	if (show_wp && WaypointHandle() && WaypointActiveHandle()) {
@@ -1122,11 +1101,12 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 
 		// XXX check HomeArrow
 		if (page->CompassHomeDir)
-			home_dir = (int)(atan2f(tmp1, tmp) * RAD2DEG) + 180;
+			home_dir = (int)(fast_atan2f(tmp1, tmp) * RAD2DEG) + 180;
 	}
 
 	// Draw Map
 	if (has_nav && page->Map && PositionActualHandle() ) {
+		osd_region_begin();
 		if (page->MapCenterMode == ONSCREENDISPLAYPAGESETTINGS_MAPCENTERMODE_UAV) {
 			draw_map_uav_center(page->MapWidthPixels, page->MapHeightPixels,
 								page->MapWidthMeters, page->MapHeightMeters,
@@ -1139,11 +1119,12 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 								page->MapShowWp, page->MapShowUavHome,
 								page->MapShowTablet);
 		}
+		osd_region_end();
 	}
 
 	// Alarms
-	if (page->Alarm) {
-		draw_alarms((int)page->AlarmPosX, (int)page->AlarmPosY, 0, 0, TEXT_VA_TOP, (int)page->AlarmAlign, 0, SIZE_TO_FONT[page->AlarmFont]);
+	if (page->Alarm && alarms_text(tmp_str, sizeof(tmp_str))) {
+		osd_widget_text(&page_widgets[WIDGET_ALARMS], tmp_str, (int)page->AlarmPosX, (int)page->AlarmPosY, TEXT_VA_TOP, (int)page->AlarmAlign, 0, SIZE_TO_FONT[page->AlarmFont]);
 	}
 	
 	// Altitude Scale
@@ -1157,10 +1138,12 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		} else {
 			tmp = 0.f;
 		}
+		osd_region_begin();
 		if (page->AltitudeScaleAlign == ONSCREENDISPLAYPAGESETTINGS_ALTITUDESCALEALIGN_LEFT)
 			hud_draw_vertical_scale(tmp * convert_distance, 100, -1, page->AltitudeScalePos, GRAPHICS_Y_MIDDLE, 120, 10, 20, 5, 8, 11, 10000, 0);
 		else
 			hud_draw_vertical_scale(tmp * convert_distance, 100, 1, page->AltitudeScalePos, GRAPHICS_Y_MIDDLE, 120, 10, 20, 5, 8, 11, 10000, 0);
+		osd_region_end();
 	}
 
 	// Altitude Numeric
@@ -1174,61 +1157,77 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		} else {
 			tmp = 0.f;
 		}
-		sprintf(tmp_str, "%d", (int)(tmp * convert_distance));
-		write_string(tmp_str, page->AltitudeNumericPosX, page->AltitudeNumericPosY, 0, 0, TEXT_VA_TOP, (int)page->AltitudeNumericAlign, 0, SIZE_TO_FONT[page->AltitudeNumericFont]);
+		if (osd_widget_update(&page_widgets[WIDGET_ALTITUDE], tmp)) {
+			sprintf(tmp_str, "%d", (int)(tmp * convert_distance));
+			osd_widget_text(&page_widgets[WIDGET_ALTITUDE], tmp_str, page->AltitudeNumericPosX, page->AltitudeNumericPosY, TEXT_VA_TOP, (int)page->AltitudeNumericAlign, 0, SIZE_TO_FONT[page->AltitudeNumericFont]);
+		}
 	}
 	
 	// Arming Status
 	if (page->ArmStatus) {
 		FlightStatusArmedGet(&tmp_uint8);
 		if (tmp_uint8 != FLIGHTSTATUS_ARMED_DISARMED)
-			write_string("ARMED", page->ArmStatusPosX, page->ArmStatusPosY, 0, 0, TEXT_VA_TOP, (int)page->ArmStatusAlign, 0, SIZE_TO_FONT[page->ArmStatusFont]);
+			osd_widget_text(&page_widgets[WIDGET_ARMED], "ARMED", page->ArmStatusPosX, page->ArmStatusPosY, TEXT_VA_TOP, (int)page->ArmStatusAlign, 0, SIZE_TO_FONT[page->ArmStatusFont]);
 	}
 	
 	// Artificial Horizon
 	if (page->ArtificialHorizon) {
 		AttitudeActualRollGet(&tmp);
 		AttitudeActualPitchGet(&tmp1);
+		osd_region_begin();
 		simple_artifical_horizon(tmp, tmp1, GRAPHICS_X_MIDDLE, GRAPHICS_Y_MIDDLE, 150, 150, page->ArtificialHorizonMaxPitch, page->ArtificialHorizonPitchSteps);
+		osd_region_end();
 	}
 
 	// Center mark
 	if (page->CenterMark) {
+		osd_region_begin();
 		write_line_outlined(GRAPHICS_X_MIDDLE - CENTER_WING - CENTER_BODY, GRAPHICS_Y_MIDDLE, GRAPHICS_X_MIDDLE - CENTER_BODY, GRAPHICS_Y_MIDDLE, 2, 0, 0, 1);
 		write_line_outlined(GRAPHICS_X_MIDDLE + 1 + CENTER_BODY, GRAPHICS_Y_MIDDLE, GRAPHICS_X_MIDDLE + 1 + CENTER_BODY + CENTER_WING, GRAPHICS_Y_MIDDLE, 0, 2, 0, 1);
 		write_line_outlined(GRAPHICS_X_MIDDLE, GRAPHICS_Y_MIDDLE - CENTER_RUDDER - CENTER_BODY, GRAPHICS_X_MIDDLE, GRAPHICS_Y_MIDDLE - CENTER_BODY, 2, 0, 0, 1);
+		osd_region_end();
 	}
 
 	// Battery
 	if (has_battery && FlightBatteryStateHandle()) {
 		if (page->BatteryVolt) {
 			FlightBatteryStateVoltageGet(&tmp);
-			sprintf(tmp_str, "%0.1fV", (double)tmp);
-			write_string(tmp_str, page->BatteryVoltPosX, page->BatteryVoltPosY, 0, 0, TEXT_VA_TOP, (int)page->BatteryVoltAlign, 0, SIZE_TO_FONT[page->BatteryVoltFont]);
+			if (osd_widget_update(&page_widgets[WIDGET_BATTERY_VOLT], tmp)) {
+				sprintf(tmp_str, "%0.1fV", (double)tmp);
+				osd_widget_text(&page_widgets[WIDGET_BATTERY_VOLT], tmp_str, page->BatteryVoltPosX, page->BatteryVoltPosY, TEXT_VA_TOP, (int)page->BatteryVoltAlign, 0, SIZE_TO_FONT[page->BatteryVoltFont]);
+			}
 		}
 		if (page->BatteryCurrent) {
 			FlightBatteryStateCurrentGet(&tmp);
-			sprintf(tmp_str, "%0.1fA", (double)tmp);
-			write_string(tmp_str, page->BatteryCurrentPosX, page->BatteryCurrentPosY, 0, 0, TEXT_VA_TOP, (int)page->BatteryCurrentAlign, 0, SIZE_TO_FONT[page->BatteryCurrentFont]);
+			if (osd_widget_update(&page_widgets[WIDGET_BATTERY_CURRENT], tmp)) {
+				sprintf(tmp_str, "%0.1fA", (double)tmp);
+				osd_widget_text(&page_widgets[WIDGET_BATTERY_CURRENT], tmp_str, page->BatteryCurrentPosX, page->BatteryCurrentPosY, TEXT_VA_TOP, (int)page->BatteryCurrentAlign, 0, SIZE_TO_FONT[page->BatteryCurrentFont]);
+			}
 		}
 		if (page->BatteryConsumed) {
 			FlightBatteryStateConsumedEnergyGet(&tmp);
-			sprintf(tmp_str, "%0.0fmAh", (double)tmp);
-			write_string(tmp_str, page->BatteryConsumedPosX, page->BatteryConsumedPosY, 0, 0, TEXT_VA_TOP, (int)page->BatteryConsumedAlign, 0, SIZE_TO_FONT[page->BatteryConsumedFont]);
+			if (osd_widget_update(&page_widgets[WIDGET_BATTERY_CONSUMED], tmp)) {
+				sprintf(tmp_str, "%0.0fmAh", (double)tmp);
+				osd_widget_text(&page_widgets[WIDGET_BATTERY_CONSUMED], tmp_str, page->BatteryConsumedPosX, page->BatteryConsumedPosY, TEXT_VA_TOP, (int)page->BatteryConsumedAlign, 0, SIZE_TO_FONT[page->BatteryConsumedFont]);
+			}
 		}
 
 		if (page->BatteryChargeState) {
 			FlightBatteryStateConsumedEnergyGet(&tmp);
 			FlightBatterySettingsCapacityGet(&tmp_uint32);
+			osd_region_begin();
 			drawBattery(page->BatteryChargeStatePosX, page->BatteryChargeStatePosY, 100 - 100 * tmp / tmp_uint32, 24);
+			osd_region_end();
 		}
 	}
 
 	// Climb rate
 	if (page->ClimbRate && VelocityActualHandle()) {
 		VelocityActualDownGet(&tmp);
-		sprintf(tmp_str, "%0.1f", (double)(-1.f * convert_distance * tmp));
-		write_string(tmp_str, page->ClimbRatePosX, page->ClimbRatePosY, 0, 0, TEXT_VA_TOP, (int)page->ClimbRateAlign, 0, SIZE_TO_FONT[page->ClimbRateFont]);
+		if (osd_widget_update(&page_widgets[WIDGET_CLIMB_RATE], tmp)) {
+			sprintf(tmp_str, "%0.1f", (double)(-1.f * convert_distance * tmp));
+			osd_widget_text(&page_widgets[WIDGET_CLIMB_RATE], tmp_str, page->ClimbRatePosX, page->ClimbRatePosY, TEXT_VA_TOP, (int)page->ClimbRateAlign, 0, SIZE_TO_FONT[page->ClimbRateFont]);
+		}
 	}
 	
 	// Compass
@@ -1236,19 +1235,21 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		AttitudeActualYawGet(&tmp);
 		if (tmp < 0)
 			tmp += 360;
+		osd_region_begin();
 		if (page->CompassHomeDir) {
 			hud_draw_linear_compass(tmp, home_dir, 120, 180, GRAPHICS_X_MIDDLE, (int)page->CompassPos, 15, 30, 5, 8, 0);
 		}
 		else {
 			hud_draw_linear_compass(tmp, -1, 120, 180, GRAPHICS_X_MIDDLE, (int)page->CompassPos, 15, 30, 5, 8, 0);
 		}
+		osd_region_end();
 	}
 
 	// Custom text
 	if (page->CustomText) {
 		memcpy((void *)tmp_str, (void *)(osd_settings.CustomText), ONSCREENDISPLAYSETTINGS_CUSTOMTEXT_NUMELEM);
 		tmp_str[ONSCREENDISPLAYSETTINGS_CUSTOMTEXT_NUMELEM] = 0;
-		write_string(tmp_str, page->CustomTextPosX, page->CustomTextPosY, 0, 0, TEXT_VA_TOP, (int)page->CustomTextAlign, 0, SIZE_TO_FONT[page->CustomTextFont]);
+		osd_widget_text(&page_widgets[WIDGET_CUSTOM_TEXT], tmp_str, page->CustomTextPosX, page->CustomTextPosY, TEXT_VA_TOP, (int)page->CustomTextAlign, 0, SIZE_TO_FONT[page->CustomTextFont]);
 	}
 
 	// Home arrow
@@ -1257,19 +1258,25 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 			AttitudeActualYawGet(&tmp);
 		}
 		tmp = fmodf(home_dir -tmp, 360.f);
+		osd_region_begin();
 		draw_polygon(page->HomeArrowPosX, page->HomeArrowPosY, tmp, HOME_ARROW, NELEMENTS(HOME_ARROW), 0, 1);
+		osd_region_end();
 	}
 
 	// CPU utilization
 	if (page->Cpu) {
 		SystemStatsCPULoadGet(&tmp_uint8);
-		sprintf(tmp_str, "CPU:%2d", tmp_uint8);
-		write_string(tmp_str, page->CpuPosX, page->CpuPosY, 0, 0, TEXT_VA_TOP, (int)page->CpuAlign, 0, SIZE_TO_FONT[page->CpuFont]);
+		if (osd_widget_update(&page_widgets[WIDGET_CPU], tmp_uint8)) {
+			sprintf(tmp_str, "CPU:%2d", tmp_uint8);
+			osd_widget_text(&page_widgets[WIDGET_CPU], tmp_str, page->CpuPosX, page->CpuPosY, TEXT_VA_TOP, (int)page->CpuAlign, 0, SIZE_TO_FONT[page->CpuFont]);
+		}
 	}
 
 	// Flight mode
 	if (page->FlightMode) {
-		draw_flight_mode(page->FlightModePosX, page->FlightModePosY, 0, 0, TEXT_VA_TOP, (int)page->FlightModeAlign, 0, SIZE_TO_FONT[page->FlightModeFont]);
+		const char *mode_text = flight_mode_text();
+		if (mode_text)
+			osd_widget_text(&page_widgets[WIDGET_FLIGHT_MODE], mode_text, page->FlightModePosX, page->FlightModePosY, TEXT_VA_TOP, (int)page->FlightModeAlign, 0, SIZE_TO_FONT[page->FlightModeFont]);
 	}
 
 	// G Force
@@ -1282,8 +1289,10 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		accelsDataAcc.z = 0.8f * accelsDataAcc.z + 0.2f * accelsData.z;
 
 		tmp = sqrtf(powf(accelsDataAcc.x, 2.f) + powf(accelsDataAcc.y, 2.f) + powf(accelsDataAcc.z, 2.f)) / 9.81f;
-		sprintf(tmp_str, "%0.1fG", (double)tmp);
-		write_string(tmp_str, page->GForcePosX, page->GForcePosY, 0, 0, TEXT_VA_TOP, (int)page->GForceAlign, 0, SIZE_TO_FONT[page->GForceFont]);
+		if (osd_widget_update(&page_widgets[WIDGET_GFORCE], tmp)) {
+			sprintf(tmp_str, "%0.1fG", (double)tmp);
+			osd_widget_text(&page_widgets[WIDGET_GFORCE], tmp_str, page->GForcePosX, page->GForcePosY, TEXT_VA_TOP, (int)page->GForceAlign, 0, SIZE_TO_FONT[page->GForceFont]);
+		}
 	}
 
 
@@ -1292,7 +1301,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		GPSPositionData gps_data;
 		GPSPositionGet(&gps_data);
 
-		draw_image(page->GpsStatusPosX, page->GpsStatusPosY - image_gps.height / 2, &image_gps);
+		osd_widget_image(&page_widgets[WIDGET_GPS_ICON], &image_gps, page->GpsStatusPosX, page->GpsStatusPosY - image_gps.height / 2);
 
 		uint8_t pdop_1 = gps_data.PDOP;
 		uint8_t pdop_2 = roundf(10 * (gps_data.PDOP - pdop_1));
@@ -1315,17 +1324,17 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 				default:
 					sprintf(tmp_str, "NOGPS");
 			}
-			write_string(tmp_str, page->GpsStatusPosX + image_gps.width -4, page->GpsStatusPosY, 0, 0, TEXT_VA_MIDDLE, TEXT_HA_LEFT, 0, SIZE_TO_FONT[page->GpsStatusFont]);
+			osd_widget_text(&page_widgets[WIDGET_GPS_STATUS], tmp_str, page->GpsStatusPosX + image_gps.width -4, page->GpsStatusPosY, TEXT_VA_MIDDLE, TEXT_HA_LEFT, 0, SIZE_TO_FONT[page->GpsStatusFont]);
 		}
 
 		if (page->GpsLat) {
 			sprintf(tmp_str, "%0.5f", (double)gps_data.Latitude / 10000000.0);
-			write_string(tmp_str, page->GpsLatPosX, page->GpsLatPosY, 0, 0, TEXT_VA_TOP, (int)page->GpsLatAlign, 0, SIZE_TO_FONT[page->GpsLatFont]);
+			osd_widget_text(&page_widgets[WIDGET_GPS_LAT], tmp_str, page->GpsLatPosX, page->GpsLatPosY, TEXT_VA_TOP, (int)page->GpsLatAlign, 0, SIZE_TO_FONT[page->GpsLatFont]);
 		}
 
 		if (page->GpsLon) {
 			sprintf(tmp_str, "%0.5f", (double)gps_data.Longitude / 10000000.0);
-			write_string(tmp_str, page->GpsLonPosX, page->GpsLonPosY, 0, 0, TEXT_VA_TOP, (int)page->GpsLonAlign, 0, SIZE_TO_FONT[page->GpsLonFont]);
+			osd_widget_text(&page_widgets[WIDGET_GPS_LON], tmp_str, page->GpsLonPosX, page->GpsLonPosY, TEXT_VA_TOP, (int)page->GpsLonAlign, 0, SIZE_TO_FONT[page->GpsLonFont]);
 		}
 
 		// MGRS location
@@ -1338,34 +1347,38 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 				if (tmp_int1 != 0)
 					sprintf(mgrs_str, "MGRS ERR: %d", tmp_int1);
 			}
-			write_string(mgrs_str, page->GpsMgrsPosX, page->GpsMgrsPosY, 0, 0, TEXT_VA_TOP, (int)page->GpsMgrsAlign, 0, SIZE_TO_FONT[page->GpsMgrsFont]);
+			osd_widget_text(&page_widgets[WIDGET_GPS_MGRS], mgrs_str, page->GpsMgrsPosX, page->GpsMgrsPosY, TEXT_VA_TOP, (int)page->GpsMgrsAlign, 0, SIZE_TO_FONT[page->GpsMgrsFont]);
 		}
 	}
 
 	// Home distance (will be -1 if enabled but GPS is not enabled)
 	if (home_dist >= 0)
 	{
-		tmp = home_dist * convert_distance;
-		if (tmp < convert_distance_divider)
-			sprintf(tmp_str, "%d%s", (int)tmp, dist_unit_short);
-		else {
-			sprintf(tmp_str, "%0.2f%s", (double)(tmp / convert_distance_divider), dist_unit_long);
+		if (osd_widget_update(&page_widgets[WIDGET_HOME_DISTANCE], home_dist)) {
+			tmp = home_dist * convert_distance;
+			if (tmp < convert_distance_divider)
+				sprintf(tmp_str, "%d%s", (int)tmp, dist_unit_short);
+			else {
+				sprintf(tmp_str, "%0.2f%s", (double)(tmp / convert_distance_divider), dist_unit_long);
+			}
+			osd_widget_text(&page_widgets[WIDGET_HOME_DISTANCE], tmp_str, page->HomeDistancePosX + image_home.width - 4, page->HomeDistancePosY, TEXT_VA_MIDDLE, TEXT_HA_LEFT, 0, SIZE_TO_FONT[page->HomeDistanceFont]);
 		}
 		if (page->HomeDistanceShowIcon) {
-			draw_image(page->HomeDistancePosX, page->HomeDistancePosY - image_home.height / 2, &image_home);
+			osd_widget_image(&page_widgets[WIDGET_HOME_ICON], &image_home, page->HomeDistancePosX, page->HomeDistancePosY - image_home.height / 2);
 		}
-		write_string(tmp_str, page->HomeDistancePosX + image_home.width - 4, page->HomeDistancePosY, 0, 0, TEXT_VA_MIDDLE, TEXT_HA_LEFT, 0, SIZE_TO_FONT[page->HomeDistanceFont]);
 	}
 
 	// RSSI
 	if (page->Rssi) {
 		ManualControlCommandRssiGet(&tmp_int16);
 		if (tmp_int16 > osd_settings.RssiWarnThreshold || blink) {
-			sprintf(tmp_str, "%3d", tmp_int16);
 			if (page->RssiShowIcon) { // XXX rename
-				draw_image(page->RssiPosX, page->RssiPosY - image_rssi.height / 2, &image_rssi);
+				osd_widget_image(&page_widgets[WIDGET_RSSI_ICON], &image_rssi, page->RssiPosX, page->RssiPosY - image_rssi.height / 2);
+			}
+			if (osd_widget_update(&page_widgets[WIDGET_RSSI], tmp_int16)) {
+				sprintf(tmp_str, "%3d", tmp_int16);
+				osd_widget_text(&page_widgets[WIDGET_RSSI], tmp_str, page->RssiPosX + image_rssi.width - 4, page->RssiPosY, TEXT_VA_MIDDLE, TEXT_HA_LEFT, 0, SIZE_TO_FONT[page->RssiFont]);
 			}
-			write_string(tmp_str, page->RssiPosX + image_rssi.width - 4, page->RssiPosY, 0, 0, TEXT_VA_MIDDLE, TEXT_HA_LEFT, 0, SIZE_TO_FONT[page->RssiFont]);
 		}
 	}
 
@@ -1397,6 +1410,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 				}
 				sprintf(tmp_str, "%s", "AIR");
 		}
+		osd_region_begin();
 		if (page->SpeedScaleAlign == ONSCREENDISPLAYPAGESETTINGS_SPEEDSCALEALIGN_LEFT) {
 			hud_draw_vertical_scale(tmp * convert_speed, 30, -1,  page->SpeedScalePos, GRAPHICS_Y_MIDDLE, 120, 10, 20, 5, 8, 11, 100, 0);
 			write_string(tmp_str, page->SpeedScalePos + 10, 200, 0, 0, TEXT_VA_MIDDLE, TEXT_HA_LEFT, 0, 1);
@@ -1405,6 +1419,7 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 			hud_draw_vertical_scale(tmp * convert_speed, 30, 1,  page->SpeedScalePos, GRAPHICS_Y_MIDDLE, 120, 10, 20, 5, 8, 11, 100, 0);
 			write_string(tmp_str, page->SpeedScalePos - 30, 200, 0, 0, TEXT_VA_MIDDLE, TEXT_HA_LEFT, 0, 1);
 		}
+		osd_region_end();
 	}
 
 	// Speed Numeric
@@ -1432,8 +1447,10 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 					AirspeedActualTrueAirspeedGet(&tmp);
 				}
 		}
-		sprintf(tmp_str, "%d", (int)(tmp * convert_speed));
-		write_string(tmp_str, page->SpeedNumericPosX, page->SpeedNumericPosY, 0, 0, (int)page->SpeedNumericAlign, TEXT_HA_LEFT, 0, SIZE_TO_FONT[page->SpeedNumericFont]);
+		if (osd_widget_update(&page_widgets[WIDGET_SPEED], tmp)) {
+			sprintf(tmp_str, "%d", (int)(tmp * convert_speed));
+			osd_widget_text(&page_widgets[WIDGET_SPEED], tmp_str, page->SpeedNumericPosX, page->SpeedNumericPosY, (int)page->SpeedNumericAlign, TEXT_HA_LEFT, 0, SIZE_TO_FONT[page->SpeedNumericFont]);
+		}
 	}
 
 	// Time
@@ -1441,17 +1458,20 @@ void render_user_page(OnScreenDisplayPageSettingsData * page)
 		uint32_t time;
 		SystemStatsFlightTimeGet(&time);
 
-		tmp_int16 = (time / 3600000); // hours
-		if (tmp_int16 == 0) {
-			tmp_int1 = time / 60000; // minutes
-			tmp_int2 = (time / 1000) - 60 * tmp_int1; // seconds
-			sprintf(tmp_str, "%02d:%02d", (int)tmp_int1, (int)tmp_int2);
-		} else {
-			tmp_int1 = time / 60000 - 60 * tmp_int16; // minutes
-			tmp_int2 = (time / 1000) - 60 * tmp_int1 - 3600 * tmp_int16; // seconds
-			sprintf(tmp_str, "%02d:%02d:%02d", (int)tmp_int16, (int)tmp_int1, (int)tmp_int2);
+		// Only changes once per second
+		if (osd_widget_update(&page_widgets[WIDGET_TIME], time / 1000)) {
+			tmp_int16 = (time / 3600000); // hours
+			if (tmp_int16 == 0) {
+				tmp_int1 = time / 60000; // minutes
+				tmp_int2 = (time / 1000) - 60 * tmp_int1; // seconds
+				sprintf(tmp_str, "%02d:%02d", (int)tmp_int1, (int)tmp_int2);
+			} else {
+				tmp_int1 = time / 60000 - 60 * tmp_int16; // minutes
+				tmp_int2 = (time / 1000) - 60 * tmp_int1 - 3600 * tmp_int16; // seconds
+				sprintf(tmp_str, "%02d:%02d:%02d", (int)tmp_int16, (int)tmp_int1, (int)tmp_int2);
+			}
+			osd_widget_text(&page_widgets[WIDGET_TIME], tmp_str, page->TimePosX, page->TimePosY, TEXT_VA_TOP, (int)page->TimeAlign, 0, SIZE_TO_FONT[page->TimeFont]);
 		}
-		write_string(tmp_str, page->TimePosX, page->TimePosY, 0, 0, TEXT_VA_TOP, (int)page->TimeAlign, 0, SIZE_TO_FONT[page->TimeFont]);
 	}
 }
 
@@ -1723,6 +1743,7 @@ static void onScreenDisplayTask(__attribute__((unused)) void *parameters)
 				}
 
 				osd_settings_updated = false;
+				osd_widgets_invalidate();
 			}
 
 			// decide whether to show blinking elements
@@ -1753,6 +1774,7 @@ static void onScreenDisplayTask(__attribute__((unused)) void *parameters)
 						OnScreenDisplayPageSettingsGet(&osd_page_settings);
 				}
 				osd_page_updated = false;
+				osd_widgets_invalidate();
 			}
 
 			// Show stats when we disarm
@@ -1788,25 +1810,40 @@ static void onScreenDisplayTask(__attribute__((unused)) void *parameters)
 				}
 			}
 
-			clearGraphics();
+			// The user pages keep their widgets in the draw buffers and only
+			// redraw what changed, everything else is drawn from scratch
 			switch (current_page) {
 				case ONSCREENDISPLAYSETTINGS_PAGECONFIG_OFF:
+					clearGraphics();
+					osd_widgets_invalidate();
 					break;
 				case ONSCREENDISPLAYSETTINGS_PAGECONFIG_STATISTICS:
+					clearGraphics();
+					osd_widgets_invalidate();
 					render_stats();
 					break;
 				case ONSCREENDISPLAYSETTINGS_PAGECONFIG_MENU:
 					if ((arm_status == FLIGHTSTATUS_ARMED_DISARMED) ||
 						(osd_settings.DisableMenuWhenArmed == ONSCREENDISPLAYSETTINGS_DISABLEMENUWHENARMED_DISABLED)){
+							clearGraphics();
+							osd_widgets_invalidate();
 							render_osd_menu();
 							break;
 					}
+					osd_widgets_begin(page_widgets, NUM_PAGE_WIDGETS);
+					osd_region_begin();
 					write_string("Menu Disabled", GRAPHICS_X_MIDDLE, 50, 0, 0, TEXT_VA_TOP, TEXT_HA_CENTER, 0, 3);
+					osd_region_end();
+					render_user_page(&osd_page_settings);
+					osd_widgets_end();
+					break;
 				case ONSCREENDISPLAYSETTINGS_PAGECONFIG_CUSTOM1:
 				case ONSCREENDISPLAYSETTINGS_PAGECONFIG_CUSTOM2:
 				case ONSCREENDISPLAYSETTINGS_PAGECONFIG_CUSTOM3:
 				case ONSCREENDISPLAYSETTINGS_PAGECONFIG_CUSTOM4:
+					osd_widgets_begin(page_widgets, NUM_PAGE_WIDGETS);
 					render_user_page(&osd_page_settings);
+					osd_widgets_end();
 					break;
 			}
 
@@ -1820,7 +1857,9 @@ static void onScreenDisplayTask(__attribute__((unused)) void *parameters)
 			in_time   = out_ticks - in_ticks;
 			char tmp_str[50];
 			sprintf(tmp_str, "%03d %03d", (int)in_time, (int)out_time);
+			osd_region_begin();
 			write_string(tmp_str, GRAPHICS_X_MIDDLE, GRAPHICS_Y_MIDDLE - 20, 0, 0, TEXT_VA_TOP, TEXT_HA_CENTER, 0, 3);
+			osd_region_end();
 #endif
 		}
 	}
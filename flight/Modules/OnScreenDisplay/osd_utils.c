@@ -38,6 +38,7 @@
 #include "physical_constants.h"
 #include "math.h"
 #include "misc_math.h"
+#include "fastmath.h"
 
 #include "gpsposition.h"
 #include "homelocation.h"
@@ -47,6 +48,25 @@ extern uint8_t *draw_buffer_mask;
 extern uint8_t *disp_buffer_level;
 extern uint8_t *disp_buffer_mask;
 
+struct osd_rect osd_draw_bounds;
+
+// Pre-shifted glyphs, see write_char_cached()
+#if !defined(OSD_GLYPH_CACHE_SIZE)
+#define OSD_GLYPH_CACHE_SIZE 32
+#endif
+#define GLYPH_MAX_HEIGHT 18
+
+struct glyph_cache_entry {
+	uint8_t valid;
+	uint8_t font;
+	uint8_t ch;
+	uint8_t key;                            // shift and invert flag
+	uint32_t or_mask[GLYPH_MAX_HEIGHT];     // three bytes per row, aligned to the buffer
+	uint32_t and_mask[GLYPH_MAX_HEIGHT];
+};
+
+static struct glyph_cache_entry glyph_cache[OSD_GLYPH_CACHE_SIZE];
+
 
 /// Draws four points relative to the given center point.
 ///
@@ -125,8 +145,8 @@ void ellipse(int centerX, int centerY, int horizontalRadius, int verticalRadius)
 
 void drawArrow(uint16_t x, uint16_t y, uint16_t angle, uint16_t size_quarter)
 {
-	float sin_angle = sinf(angle * (float)(M_PI / 180));
-	float cos_angle = cosf(angle * (float)(M_PI / 180));
+	float sin_angle = fast_sinf(angle * (float)(M_PI / 180));
+	float cos_angle = fast_cosf(angle * (float)(M_PI / 180));
 	int16_t peak_x  = (int16_t)(sin_angle * size_quarter * 2);
 	int16_t peak_y  = (int16_t)(cos_angle * size_quarter * 2);
 	int16_t d_end_x = (int16_t)(cos_angle * size_quarter);
@@ -146,6 +166,67 @@ void drawBox(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
 	write_line_lm(x1, y2, x2, y2, 1, 1); // bottom
 }
 
+void draw_image(uint16_t x, uint16_t y, const struct Image * image)
+{
+	CHECK_COORDS(x + image->width, y + image->height);
+	OSD_TRACK_BOUNDS(x, y, x + image->width - 1, y + image->height - 1);
+	uint8_t byte_width = image->width / 8;
+	uint8_t pixel_offset = x % 8;
+	uint8_t mask1 = 0xFF;
+	uint8_t mask2 = 0x00;
+
+	if (pixel_offset > 0) {
+		for (uint8_t i=0; i<pixel_offset; i++) {
+			mask2 |= 0x01 << i;
+		}
+		mask1 = ~mask2;
+	}
+
+	for (uint16_t yp = 0; yp < image->height; yp++){
+		for (uint16_t xp = 0; xp < image->width / 8; xp++){
+			draw_buffer_level[(y + yp) * BUFFER_WIDTH + xp + x / 8] |= (image->level[yp * byte_width + xp] & mask1) >> pixel_offset;
+			draw_buffer_mask[(y + yp) * BUFFER_WIDTH + xp + x / 8] |= (image->mask[yp * byte_width + xp] & mask1) >> pixel_offset;
+			if (pixel_offset > 0) {
+				draw_buffer_level[(y + yp) * BUFFER_WIDTH + xp + x / 8 + 1] |= (image->level[yp * byte_width + xp] & mask2) << (8 - pixel_offset);
+				draw_buffer_mask[(y + yp) * BUFFER_WIDTH + xp + x / 8 + 1] |= (image->mask[yp * byte_width + xp] & mask2) << (8 - pixel_offset);
+			}
+		}
+	}
+}
+
+/**
+ * osd_bounds_reset: Start tracking the area that gets drawn.
+ */
+void osd_bounds_reset(void)
+{
+	osd_draw_bounds.x0 = INT16_MAX;
+	osd_draw_bounds.y0 = INT16_MAX;
+	osd_draw_bounds.x1 = INT16_MIN;
+	osd_draw_bounds.y1 = INT16_MIN;
+}
+
+/**
+ * clear_rect: Clear an area of both draw buffers. The area is widened
+ * to whole bytes.
+ *
+ * @param       rect    area to clear
+ */
+void clear_rect(const struct osd_rect *rect)
+{
+	int x0 = MAX((int)rect->x0, 0) / 8;
+	int x1 = MIN((int)rect->x1, GRAPHICS_WIDTH_REAL - 1) / 8;
+	int y0 = MAX((int)rect->y0, 0);
+	int y1 = MIN((int)rect->y1, BUFFER_HEIGHT - 1);
+
+	if (x0 > x1) {
+		return;
+	}
+	for (int y = y0; y <= y1; y++) {
+		memset(&draw_buffer_mask[y * BUFFER_WIDTH + x0], 0, x1 - x0 + 1);
+		memset(&draw_buffer_level[y * BUFFER_WIDTH + x0], 0, x1 - x0 + 1);
+	}
+}
+
 /**
  * write_pixel: Write a pixel at an x,y position to a given surface.
  *
@@ -157,6 +238,7 @@ void drawBox(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
 void write_pixel(uint8_t *buff, int x, int y, int mode)
 {
 	CHECK_COORDS(x, y);
+	OSD_TRACK_BOUNDS(x, y, x, y);
 	// Determine the bit in the word to be set and the word
 	// index to set it in.
 	int bitnum    = CALC_BIT_IN_WORD(x);
@@ -178,6 +260,7 @@ void write_pixel(uint8_t *buff, int x, int y, int mode)
 void write_pixel_lm(int x, int y, int mmode, int lmode)
 {
 	CHECK_COORDS(x, y);
+	OSD_TRACK_BOUNDS(x, y, x, y);
 	// Determine the bit in the word to be set and the word
 	// index to set it in.
 	int bitnum    = CALC_BIT_IN_WORD(x);
@@ -208,6 +291,7 @@ void write_hline(uint8_t *buff, int x0, int x1, int y, int mode)
 	if (x0 == x1) {
 		return;
 	}
+	OSD_TRACK_BOUNDS(x0, y, x1, y);
 	/* This is an optimised algorithm for writing horizontal lines.
 	 * We begin by finding the addresses of the x0 and x1 points. */
 	int addr0     = CALC_BUFF_ADDR(x0, y);
@@ -300,6 +384,7 @@ void write_vline(uint8_t *buff, int x, int y0, int y1, int mode)
 	if (y0 == y1) {
 		return;
 	}
+	OSD_TRACK_BOUNDS(x, y0, x, y1);
 	/* This is an optimised algorithm for writing vertical lines.
 	 * We begin by finding the addresses of the x,y0 and x,y1 points. */
 	int addr0  = CALC_BUFF_ADDR(x, y0);
@@ -383,16 +468,19 @@ void write_filled_rectangle(uint8_t *buff, int x, int y, int width, int height,
 	if (width <= 0 || height <= 0) {
 		return;
 	}
+	// Last column, the rectangle covers x to x1 inclusive
+	int x1 = x + width - 1;
+	OSD_TRACK_BOUNDS(x, y, x1, y + height - 1);
 	// Calculate as if the rectangle was only a horizontal line. We then
 	// step these addresses through each row until we iterate `height` times.
 	int addr0     = CALC_BUFF_ADDR(x, y);
-	int addr1     = CALC_BUFF_ADDR(x + width, y);
+	int addr1     = CALC_BUFF_ADDR(x1, y);
 	int addr0_bit = CALC_BIT_IN_WORD(x);
-	int addr1_bit = CALC_BIT_IN_WORD(x + width);
+	int addr1_bit = CALC_BIT_IN_WORD(x1);
 	int mask, mask_l, mask_r, i;
 	// If the addresses are equal, we need to write one word vertically.
 	if (addr0 == addr1) {
-		mask = COMPUTE_HLINE_ISLAND_MASK(addr0_bit, addr1_bit);
+		mask = COMPUTE_HLINE_EDGE_L_MASK(addr0_bit) & COMPUTE_HLINE_EDGE_R_MASK(addr1_bit);
 		while (height--) {
 			WRITE_WORD_MODE(buff, addr0, mask, mode);
 			addr0 += BUFFER_WIDTH;
@@ -984,6 +1072,7 @@ void write_char16(char ch, int x, int y, int flags, int font)
 	if (partly_out && ((x + font_info.width < GRAPHICS_LEFT) || (x > GRAPHICS_RIGHT) || (y + font_info.height < GRAPHICS_TOP) || (y > GRAPHICS_BOTTOM))) {
 		return;
 	}
+	OSD_TRACK_BOUNDS(x, y, x + font_info.width - 1, y + font_info.height - 1);
 
 	// Compute starting address of character
 	int addr = CALC_BUFF_ADDR(x, y);
@@ -1058,6 +1147,7 @@ void write_char(char ch, int x, int y, int flags, int font)
 	if (partly_out && ((x + font_info.width < GRAPHICS_LEFT) || (x > GRAPHICS_RIGHT) || (y + font_info.height < GRAPHICS_TOP) || (y > GRAPHICS_BOTTOM))) {
 		return;
 	}
+	OSD_TRACK_BOUNDS(x, y, x + font_info.width - 1, y + font_info.height - 1);
 
 	// Compute starting address of character
 	unsigned int addr = CALC_BUFF_ADDR(x, y);
@@ -1097,6 +1187,136 @@ void write_char(char ch, int x, int y, int flags, int font)
 	}
 }
 
+/**
+ * fetch_glyph: Find a character in the glyph cache, rendering it
+ * into the cache if it is not there. The rows are computed exactly
+ * like write_char() and write_char16() do and are shifted for the
+ * position of the character within a byte.
+ *
+ * @param       ch      character
+ * @param       shift   x coordinate within the byte (0-7)
+ * @param       flags   font flags
+ * @param       font    font id
+ * @returns     the cache entry or NULL if the character does not exist
+ */
+static const struct glyph_cache_entry *fetch_glyph(uint8_t ch, int shift, int flags, int font)
+{
+	uint8_t key = shift | ((flags & FONT_INVERT) ? 0x80 : 0);
+	struct glyph_cache_entry *entry = &glyph_cache[(ch + 11 * shift + 23 * font + ((flags & FONT_INVERT) ? 41 : 0)) % OSD_GLYPH_CACHE_SIZE];
+
+	if (entry->valid && entry->ch == ch && entry->font == font && entry->key == key) {
+		return entry;
+	}
+
+	const struct FontEntry *font_info = &fonts[font];
+	int xshift = 16 - font_info->width;
+	int row;
+	uint16_t and_mask, or_mask, levels;
+
+	if (font_info->height > GLYPH_MAX_HEIGHT) {
+		return NULL;
+	}
+
+	if (font < 2) {
+		if (font_info->lookup[ch] == (char)0xff) {
+			return NULL;
+		}
+		row = (uint8_t)font_info->lookup[ch] * font_info->height * 2;
+	} else {
+		row = ch * font_info->height;
+	}
+
+	entry->valid = false;
+	for (int yy = 0; yy < font_info->height; yy++) {
+		if (font == 3) {
+			levels   = font_frame12x18[row];
+			if (!(flags & FONT_INVERT)) // data is normally inverted
+				levels   = ~levels;
+			or_mask  = font_mask12x18[row] << xshift;
+			and_mask = (font_mask12x18[row] & levels) << xshift;
+		} else if (font == 2) {
+			levels   = font_frame8x10[row];
+			if (!(flags & FONT_INVERT)) // data is normally inverted
+				levels   = ~levels;
+			or_mask  = font_mask8x10[row] << xshift;
+			and_mask = (font_mask8x10[row] & levels) << xshift;
+		} else {
+			levels = font_info->data[row + font_info->height];
+			if (!(flags & FONT_INVERT)) { // data is normally inverted
+				levels = ~levels;
+			}
+			or_mask  = font_info->data[row] << xshift;
+			and_mask = (font_info->data[row] & levels) << xshift;
+		}
+		// Same layout as write_word_misaligned: the first byte holds the top bits
+		entry->or_mask[yy]  = (uint32_t)or_mask << (8 - shift);
+		entry->and_mask[yy] = (uint32_t)and_mask << (8 - shift);
+		row++;
+	}
+
+	entry->ch    = ch;
+	entry->font  = font;
+	entry->key   = key;
+	entry->valid = true;
+
+	return entry;
+}
+
+/**
+ * write_char_cached: Draw a character on the current draw buffer from
+ * the glyph cache. Each row is one pre-shifted word written to three
+ * bytes of each buffer, instead of going through the misaligned word
+ * writes three times. Characters that are partly off screen are left
+ * to write_char() and write_char16().
+ *
+ * @param       ch      character to write
+ * @param       x       x coordinate (left)
+ * @param       y       y coordinate (top)
+ * @param       flags   flags to write with
+ * @param       font    font to use
+ */
+void write_char_cached(char ch, int x, int y, int flags, int font)
+{
+	if ((unsigned int)font >= NUM_FONTS) {
+		return;
+	}
+
+	const struct FontEntry *font_info = &fonts[font];
+
+	if ((x < GRAPHICS_LEFT) || (x + font_info->width > GRAPHICS_RIGHT) || (y < GRAPHICS_TOP) || (y + font_info->height > GRAPHICS_BOTTOM)) {
+		if (font < 2) {
+			write_char(ch, x, y, flags, font);
+		} else {
+			write_char16(ch, x, y, flags, font);
+		}
+		return;
+	}
+
+	const struct glyph_cache_entry *glyph = fetch_glyph(ch, CALC_BIT_IN_WORD(x), flags, font);
+	if (glyph == NULL) {
+		return;
+	}
+	OSD_TRACK_BOUNDS(x, y, x + font_info->width - 1, y + font_info->height - 1);
+
+	uint8_t *mask  = &draw_buffer_mask[CALC_BUFF_ADDR(x, y)];
+	uint8_t *level = &draw_buffer_level[CALC_BUFF_ADDR(x, y)];
+
+	for (int yy = 0; yy < font_info->height; yy++) {
+		uint32_t or_mask  = glyph->or_mask[yy];
+		uint32_t and_mask = glyph->and_mask[yy];
+
+		mask[0]  |= or_mask >> 16;
+		mask[1]  |= or_mask >> 8;
+		mask[2]  |= or_mask;
+		level[0]  = (level[0] | (or_mask >> 16)) & ~(and_mask >> 16);
+		level[1]  = (level[1] | (or_mask >> 8)) & ~(and_mask >> 8);
+		level[2]  = (level[2] | or_mask) & ~and_mask;
+
+		mask  += BUFFER_WIDTH;
+		level += BUFFER_WIDTH;
+	}
+}
+
 /**
  * calc_text_dimensions: Calculate the dimensions of a
  * string in a given font. Supports new lines and
@@ -1194,11 +1414,7 @@ void write_string(char *str, int x, int y, int xs, int ys, int va, int ha, int f
 			xx  = xx_original;
 		} else {
 			if (xx >= 0 && xx < GRAPHICS_WIDTH_REAL) {
-				if (font_info.id < 2) {
-					write_char(*str, xx, yy, flags, font);
-				} else {
-					write_char16(*str, xx, yy, flags, font);
-				}
+				write_char_cached(*str, xx, yy, flags, font);
 			}
 			xx += font_info.width + xs;
 		}
@@ -1215,8 +1431,8 @@ void draw_polygon(int16_t x, int16_t y, float angle, const point_t * points, uin
 	float sin_angle, cos_angle;
 	int16_t x1, y1, x2, y2;
 
-	sin_angle    = sinf(angle * (float)(M_PI / 180));
-	cos_angle    = cosf(angle * (float)(M_PI / 180));
+	sin_angle    = fast_sinf(angle * (float)(M_PI / 180));
+	cos_angle    = fast_cosf(angle * (float)(M_PI / 180));
 
 	x1 = roundf(cos_angle * points[0].x - sin_angle * points[0].y);
 	y1 = roundf(sin_angle * points[0].x + cos_angle * points[0].y);
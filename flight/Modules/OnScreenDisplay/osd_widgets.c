@@ -0,0 +1,357 @@
+/**
+ ******************************************************************************
+ * @addtogroup Tau Labs Modules
+ * @{
+ * @addtogroup OnScreenDisplay OSD Module
+ * @brief Retained OSD elements
+ * @{
+ *
+ * @file       osd_widgets.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Retained OSD elements, only redrawn when they change
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * A page is drawn in two kinds of elements:
+ *
+ * - widgets (numbers, labels, icons) stay in the draw buffers and are only
+ *   redrawn when their content changes or something else was drawn over
+ *   or cleared under them
+ * - regions (scales, horizon, map) are drawn every frame between
+ *   osd_region_begin() and osd_region_end(). The area they covered is
+ *   cleared the next time the same buffer is drawn.
+ *
+ * The video driver swaps two draw buffers, so everything is tracked per
+ * buffer and a change is drawn twice, once in each buffer.
+ *
+ * Widgets are drawn after the regions. Where a widget that changed overlaps
+ * a region, clearing the old widget also clears the region for one frame.
+ */
+
+#include <openpilot.h>
+#include "pios_video.h"
+#include "osd_widgets.h"
+
+extern uint8_t *draw_buffer_level;
+
+#define MAX_RECTS 16
+
+struct rect_list {
+	struct osd_rect rects[MAX_RECTS];
+	uint8_t num;
+};
+
+static struct osd_widget *widgets;
+static uint8_t num_widgets;
+
+static uint8_t *buffers[2];             // level buffer of each draw buffer
+static uint8_t *frame_buffer;           // level buffer when the frame started
+static uint8_t buffer;                  // index of the current draw buffer
+static uint8_t full_clear = 0x03;       // draw buffers that have to be cleared completely
+
+static struct rect_list regions[2];     // drawn by the regions in each draw buffer
+static struct rect_list damaged;        // cleared or drawn during this frame
+
+static void rect_set_empty(struct osd_rect *rect)
+{
+	rect->x0 = INT16_MAX;
+	rect->y0 = INT16_MAX;
+	rect->x1 = INT16_MIN;
+	rect->y1 = INT16_MIN;
+}
+
+static bool rect_is_empty(const struct osd_rect *rect)
+{
+	return rect->x0 > rect->x1 || rect->y0 > rect->y1;
+}
+
+static bool rect_intersects(const struct osd_rect *a, const struct osd_rect *b)
+{
+	return a->x0 <= b->x1 && b->x0 <= a->x1 && a->y0 <= b->y1 && b->y0 <= a->y1;
+}
+
+/**
+ * Widen a rectangle to whole bytes, which is what clear_rect() clears
+ */
+static void rect_align(struct osd_rect *rect)
+{
+	rect->x0 &= ~7;
+	rect->x1 |= 7;
+}
+
+/**
+ * Add a rectangle to a list, when the list is full the last rectangle
+ * grows to cover the new one
+ */
+static void rect_list_add(struct rect_list *list, const struct osd_rect *rect)
+{
+	if (rect_is_empty(rect))
+		return;
+
+	if (list->num < MAX_RECTS) {
+		list->rects[list->num++] = *rect;
+	} else {
+		struct osd_rect *last = &list->rects[MAX_RECTS - 1];
+		last->x0 = MIN(last->x0, rect->x0);
+		last->y0 = MIN(last->y0, rect->y0);
+		last->x1 = MAX(last->x1, rect->x1);
+		last->y1 = MAX(last->y1, rect->y1);
+	}
+}
+
+static bool rect_list_intersects(const struct rect_list *list, const struct osd_rect *rect)
+{
+	for (uint8_t i = 0; i < list->num; i++) {
+		if (rect_intersects(&list->rects[i], rect))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Start drawing a frame in the current draw buffer. Clears what the
+ * regions drew the last time this buffer was used.
+ *
+ * @param       page_widgets    widgets of the page
+ * @param       num_page_widgets        number of widgets
+ */
+void osd_widgets_begin(struct osd_widget *page_widgets, uint8_t num_page_widgets)
+{
+	if (page_widgets != widgets) {
+		widgets = page_widgets;
+		num_widgets = num_page_widgets;
+		full_clear = 0x03;
+	}
+
+	// The video driver swaps the buffers, find out which one we got
+	if (draw_buffer_level == buffers[0]) {
+		buffer = 0;
+	} else if (draw_buffer_level == buffers[1]) {
+		buffer = 1;
+	} else if (buffers[1] == NULL && buffers[0] != NULL) {
+		buffers[1] = draw_buffer_level;
+		buffer = 1;
+	} else {
+		buffers[0] = draw_buffer_level;
+		buffers[1] = NULL;
+		buffer = 0;
+		full_clear = 0x03;
+	}
+	frame_buffer = draw_buffer_level;
+
+	uint8_t bit = 1 << buffer;
+	damaged.num = 0;
+
+	if (full_clear & bit) {
+		struct osd_rect screen = {
+			.x0 = 0,
+			.y0 = 0,
+			.x1 = GRAPHICS_WIDTH_REAL - 1,
+			.y1 = BUFFER_HEIGHT - 1,
+		};
+		clear_rect(&screen);
+		for (uint8_t i = 0; i < num_widgets; i++) {
+			rect_set_empty(&widgets[i].drawn[buffer]);
+			widgets[i].pending |= bit;
+		}
+		full_clear &= ~bit;
+	} else {
+		for (uint8_t i = 0; i < regions[buffer].num; i++) {
+			clear_rect(&regions[buffer].rects[i]);
+			rect_list_add(&damaged, &regions[buffer].rects[i]);
+		}
+	}
+
+	regions[buffer].num = 0;
+}
+
+/**
+ * Finish the frame: clear the widgets that changed or were hidden and
+ * draw the widgets that need it.
+ */
+void osd_widgets_end(void)
+{
+	uint8_t bit = 1 << buffer;
+
+	// Widgets that were not declared in this frame are hidden
+	for (uint8_t i = 0; i < num_widgets; i++) {
+		struct osd_widget *widget = &widgets[i];
+		if (!widget->used && widget->type != OSD_WIDGET_NONE) {
+			widget->type = OSD_WIDGET_NONE;
+			widget->valid = false;
+			widget->pending = 0x03;
+		}
+		widget->used = false;
+	}
+
+	// The buffers were swapped while drawing, nothing is known about them
+	if (draw_buffer_level != frame_buffer) {
+		osd_widgets_invalidate();
+		return;
+	}
+
+	// Remove the old content of the widgets that changed
+	for (uint8_t i = 0; i < num_widgets; i++) {
+		struct osd_widget *widget = &widgets[i];
+		if ((widget->pending & bit) && !rect_is_empty(&widget->drawn[buffer])) {
+			clear_rect(&widget->drawn[buffer]);
+			rect_list_add(&damaged, &widget->drawn[buffer]);
+			rect_set_empty(&widget->drawn[buffer]);
+		}
+	}
+
+	// Draw what changed, what was cleared and what the regions drew over
+	for (uint8_t i = 0; i < num_widgets; i++) {
+		struct osd_widget *widget = &widgets[i];
+		struct osd_rect *drawn = &widget->drawn[buffer];
+
+		if (widget->type != OSD_WIDGET_NONE &&
+				((widget->pending & bit) ||
+				 rect_list_intersects(&damaged, drawn) ||
+				 rect_list_intersects(&regions[buffer], drawn))) {
+			osd_bounds_reset();
+			if (widget->type == OSD_WIDGET_TEXT) {
+				write_string(widget->text, widget->x, widget->y, 0, 0, widget->va, widget->ha, widget->flags, widget->font);
+			} else {
+				draw_image(widget->x, widget->y, widget->image);
+			}
+			*drawn = osd_draw_bounds;
+			rect_align(drawn);
+
+			// Later widgets that overlap have to be drawn again on top
+			rect_list_add(&damaged, drawn);
+		}
+
+		widget->pending &= ~bit;
+	}
+}
+
+/**
+ * Forget the content of both draw buffers. Used when something else
+ * drew into them and when the settings the widgets depend on changed.
+ */
+void osd_widgets_invalidate(void)
+{
+	full_clear = 0x03;
+
+	for (uint8_t i = 0; i < num_widgets; i++) {
+		widgets[i].valid = false;
+	}
+}
+
+/**
+ * Start an element that is drawn every frame
+ */
+void osd_region_begin(void)
+{
+	osd_bounds_reset();
+}
+
+/**
+ * End an element that is drawn every frame, its area will be cleared
+ * the next time this buffer is drawn
+ */
+void osd_region_end(void)
+{
+	struct osd_rect rect = osd_draw_bounds;
+
+	rect_align(&rect);
+	rect_list_add(&regions[buffer], &rect);
+}
+
+/**
+ * Declare a widget in this frame and check the value it shows.
+ *
+ * @param       widget  widget
+ * @param       value   value the widget is made from
+ * @returns     true when the value changed and the content has to be set again
+ */
+bool osd_widget_update(struct osd_widget *widget, float value)
+{
+	widget->used = true;
+
+	if (widget->valid && widget->value == value)
+		return false;
+
+	widget->value = value;
+	widget->valid = true;
+	return true;
+}
+
+/**
+ * Declare a text widget in this frame. It is only redrawn when the text
+ * or the position changed.
+ *
+ * @param       widget  widget
+ * @param       text    text to show
+ * @param       x       x coordinate
+ * @param       y       y coordinate
+ * @param       va      vertical align
+ * @param       ha      horizontal align
+ * @param       flags   font flags
+ * @param       font    font
+ */
+void osd_widget_text(struct osd_widget *widget, const char *text, int x, int y, int va, int ha, int flags, int font)
+{
+	widget->used = true;
+
+	if (widget->type == OSD_WIDGET_TEXT && widget->x == x && widget->y == y &&
+			widget->va == va && widget->ha == ha && widget->flags == flags && widget->font == font &&
+			strncmp(widget->text, text, OSD_WIDGET_TEXT_LEN - 1) == 0)
+		return;
+
+	widget->type  = OSD_WIDGET_TEXT;
+	widget->x     = x;
+	widget->y     = y;
+	widget->va    = va;
+	widget->ha    = ha;
+	widget->flags = flags;
+	widget->font  = font;
+	strncpy(widget->text, text, OSD_WIDGET_TEXT_LEN - 1);
+	widget->text[OSD_WIDGET_TEXT_LEN - 1] = 0;
+	widget->pending = 0x03;
+}
+
+/**
+ * Declare an image widget in this frame.
+ *
+ * @param       widget  widget
+ * @param       image   image to show
+ * @param       x       x coordinate (left)
+ * @param       y       y coordinate (top)
+ */
+void osd_widget_image(struct osd_widget *widget, const struct Image *image, int x, int y)
+{
+	widget->used = true;
+
+	if (widget->type == OSD_WIDGET_IMAGE && widget->image == image && widget->x == x && widget->y == y)
+		return;
+
+	widget->type  = OSD_WIDGET_IMAGE;
+	widget->image = image;
+	widget->x     = x;
+	widget->y     = y;
+	widget->pending = 0x03;
+}
+
+/**
+ * @}
+ * @}
+ */
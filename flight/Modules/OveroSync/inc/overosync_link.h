@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup OveroSyncModule OveroSync Module
+ * @{
+ *
+ * @file       overosync_link.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Batching and subscriptions of the companion computer link
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef OVEROSYNC_LINK_H
+#define OVEROSYNC_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct overosync_link_stats {
+	uint32_t sent_bytes;
+	uint32_t batches;         //!< Writes to the COM port
+	uint32_t dropped;         //!< Frames that found the batch full
+};
+
+struct overosync_link;
+
+struct overosync_link *overosync_link_create(uintptr_t com_id, uint16_t batch_size, uint8_t max_subscriptions);
+
+int32_t overosync_link_write(struct overosync_link *link, const uint8_t *data, uint16_t len);
+bool overosync_link_flush(struct overosync_link *link);
+uint16_t overosync_link_room(struct overosync_link *link);
+
+void overosync_link_unsubscribe_all(struct overosync_link *link);
+int32_t overosync_link_subscribe(struct overosync_link *link, uint32_t obj_id, uint16_t period_ms);
+bool overosync_link_forward_update(struct overosync_link *link, uint32_t obj_id);
+bool overosync_link_next_due(struct overosync_link *link, uint32_t now_ms, uint32_t *obj_id);
+void overosync_link_mark_sent(struct overosync_link *link, uint32_t obj_id, uint32_t now_ms);
+
+void overosync_link_get_stats(struct overosync_link *link, struct overosync_link_stats *stats);
+
+#endif /* OVEROSYNC_LINK_H */
+
+/**
+ * @}
+ * @}
+ */
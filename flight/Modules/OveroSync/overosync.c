@@ -7,8 +7,14 @@
  *
  * @file       overosync.c
  * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
- * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013-2014
- * @brief      Communication with an Overo via SPI
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013-2015
+ * @brief      Communication with a companion computer
+ *
+ * The companion computer talks UAVTalk on the same port. It picks the
+ * objects it wants with @ref OveroSyncSubscription, as long as it picks
+ * nothing every update goes out. Changing SettingsRequest gets all the
+ * settings, they are sent as fast as the port takes them and the request is
+ * copied to OveroSyncStats.SettingsSnapshot when all went out.
  * @see        The GNU Public License (GPL) Version 3
  *
  *****************************************************************************/
@@ -31,7 +37,9 @@
 #include "openpilot.h"
 #include "modulesettings.h"
 #include "overosync.h"
+#include "overosync_link.h"
 #include "overosyncstats.h"
+#include "overosyncsubscription.h"
 #include "systemstats.h"
 #include "pios_thread.h"
 #include "pios_queue.h"
@@ -40,6 +48,12 @@
 #define MAX_QUEUE_SIZE   200
 #define STACK_SIZE_BYTES 512
 #define TASK_PRIORITY PIOS_THREAD_PRIO_LOW
+#define TASK_PERIOD_MS   10
+#define BOOT_DELAY_MS    5000
+#define STATS_PERIOD_MS  1000
+#define BATCH_SIZE       1024     //!< One SPI transfer, the port must buffer this much
+#define FRAME_OVERHEAD   13       //!< UAVTalk header with timestamp and the checksum
+#define RX_CHUNK_SIZE    32
 
 // Private types
 
@@ -53,21 +67,35 @@ static bool module_enabled;
 static void    overoSyncTask(void *parameters);
 static int32_t pack_data(uint8_t * data, int32_t length);
 static void    register_object(UAVObjHandle obj);
-static void    send_settings(UAVObjHandle obj);
+static void    count_settings(UAVObjHandle obj);
+static void    add_settings(UAVObjHandle obj);
+static void    process_event(UAVObjEvent *ev);
+static void    update_subscriptions(void);
+static void    process_rx(void);
+static void    send_periodic(uint32_t now);
+static void    send_settings(void);
+static void    update_stats(uint32_t now);
 
 // External variables
-extern uint32_t pios_com_overo_id;
-extern uint32_t pios_overo_id;
+extern uintptr_t pios_com_overo_id;
+#if defined(PIOS_INCLUDE_OVERO)
+extern uintptr_t pios_overo_id;
+#endif
 
 struct overosync {
-	uint32_t sent_bytes;
-	uint32_t sent_objects;
-	uint32_t failed_objects;
-	uint32_t received_objects;
-	bool     sending_settings;
+	struct overosync_link *link;
+
+	UAVObjHandle *settings;
+	uint16_t num_settings;
+	uint16_t settings_cursor;     //!< Next one of the snapshot, num_settings when done
+	uint8_t settings_request;
+
+	uint32_t received_bytes;
+	uint32_t last_stats_time;
+	struct overosync_link_stats last_stats;
 };
 
-struct overosync *overosync;
+static struct overosync *overosync;
 
 /**
  * Initialise the overo sync module
@@ -88,6 +116,9 @@ int32_t OveroSyncInitialize(void)
 	}
 #endif
 
+	if (!pios_com_overo_id)
+		module_enabled = false;
+
 	if (!module_enabled)
 		return -1;
 
@@ -95,6 +126,7 @@ int32_t OveroSyncInitialize(void)
 	queue = PIOS_Queue_Create(MAX_QUEUE_SIZE, sizeof(UAVObjEvent));
 	
 	OveroSyncStatsInitialize();
+	OveroSyncSubscriptionInitialize();
 
 	// Initialise UAVTalk
 	uavTalkCon = UAVTalkInitialize(&pack_data);
@@ -118,7 +150,22 @@ int32_t OveroSyncStart(void)
 	if(overosync == NULL)
 		return -1;
 
-	overosync->sent_bytes = 0;
+	memset(overosync, 0, sizeof(*overosync));
+
+	overosync->link = overosync_link_create(pios_com_overo_id, BATCH_SIZE,
+	                                        OVEROSYNCSUBSCRIPTION_OBJECTID_NUMELEM);
+	if (overosync->link == NULL)
+		return -1;
+
+	// Keep a list of the settings for the snapshots
+	UAVObjIterate(&count_settings);
+	overosync->settings = PIOS_malloc(overosync->num_settings * sizeof(*overosync->settings));
+	if (overosync->settings == NULL)
+		return -1;
+
+	overosync->num_settings = 0;
+	UAVObjIterate(&add_settings);
+	overosync->settings_cursor = overosync->num_settings;
 
 	// Process all registered objects and connect queue for updates
 	UAVObjIterate(&register_object);
@@ -145,97 +192,197 @@ static void register_object(UAVObjHandle obj)
 	UAVObjConnectQueue(obj, queue, eventMask);
 }
 
-/**
- * Register a new object, adds object to local list and connects the queue depending on the object's
- * telemetry settings.
- * \param[in] obj Object to connect
- */
-static void send_settings(UAVObjHandle obj)
+static void count_settings(UAVObjHandle obj)
 {
-	if (UAVObjIsSettings(obj)) {
-		UAVTalkSendObjectTimestamped(uavTalkCon, obj, 0, false, 0);
-	}
+	if (UAVObjIsSettings(obj))
+		overosync->num_settings++;
+}
+
+static void add_settings(UAVObjHandle obj)
+{
+	if (UAVObjIsSettings(obj))
+		overosync->settings[overosync->num_settings++] = obj;
 }
 
 /**
- * Telemetry transmit task, regular priority
+ * Telemetry task, low priority
  *
- * Logic: We need to double buffer the DMA transfers.  Pack the buffer until either
- * 1) it is full (and then we should record the number of missed events then)
- * 2) the current transaction is done (we should immediately schedule since we are slave)
- * when done packing the buffer we should call PIOS_SPI_TransferBlock, change the active buffer
- * and then take the semaphrore
+ * Object updates are collected in a batch that goes to the port every
+ * TASK_PERIOD_MS, or earlier when it is full. Each period the data from the
+ * companion is processed, the periodic subscriptions and the settings
+ * snapshot get the room left in the port.
  */
 static void overoSyncTask(void *parameters)
 {
 	UAVObjEvent ev;
 
-	// Kick off SPI transfers (once one is completed another will automatically transmit)
-	overosync->sent_objects = 0;
-	overosync->failed_objects = 0;
-	overosync->received_objects = 0;
-	
-	uint32_t lastUpdateTime = PIOS_Thread_Systime();
-	uint32_t updateTime;
+	// For the first seconds do not send updates to allow the
+	// overo to boot.  Then enable it and act normally.
+	while (PIOS_Thread_Systime() < BOOT_DELAY_MS) {
+		PIOS_Queue_Receive(queue, &ev, TASK_PERIOD_MS);
+	}
+
+#if defined(PIOS_INCLUDE_OVERO)
+	PIOS_OVERO_Enable(pios_overo_id);
+#endif
 
-	bool initialized = false;
-	uint8_t last_connected = OVEROSYNCSTATS_CONNECTED_FALSE;
+	overosync->last_stats_time = PIOS_Thread_Systime();
+	uint32_t next_tick = overosync->last_stats_time;
 
 	// Loop forever
 	while (1) {
-		// Wait for queue message
-		if (PIOS_Queue_Receive(queue, &ev, PIOS_QUEUE_TIMEOUT_MAX) == true) {
-
-			// For the first seconds do not send updates to allow the
-			// overo to boot.  Then enable it and act normally.
-			if (!initialized && PIOS_Thread_Systime() < 5000) {
-				continue;
-			} else if (!initialized) {
-				initialized = true;
-				PIOS_OVERO_Enable(pios_overo_id);
-			}
-
-			// Process event.  This calls transmitData
-			UAVTalkSendObjectTimestamped(uavTalkCon, ev.obj, ev.instId, false, 0);
-			
-			updateTime = PIOS_Thread_Systime();
-			if(((uint32_t) (updateTime - lastUpdateTime)) > 1000) {
-				// Update stats.  This will trigger a local send event too
-				OveroSyncStatsData syncStats;
-				syncStats.Send = overosync->sent_bytes;
-				syncStats.Connected = syncStats.Send > 500 ? OVEROSYNCSTATS_CONNECTED_TRUE : OVEROSYNCSTATS_CONNECTED_FALSE;
-				syncStats.DroppedUpdates = overosync->failed_objects;
-				syncStats.Packets = PIOS_OVERO_GetPacketCount(pios_overo_id);
-				OveroSyncStatsSet(&syncStats);
-				overosync->failed_objects = 0;
-				overosync->sent_bytes = 0;
-				lastUpdateTime = updateTime;
-
-				// When first connected, send all the settings.  Right now this
-				// will fail since all the settings will overfill the buffer and
-				if (last_connected == OVEROSYNCSTATS_CONNECTED_FALSE &&
-					syncStats.Connected == OVEROSYNCSTATS_CONNECTED_TRUE) {
-					UAVObjIterate(&send_settings);
-				}
-
-				// Because the previous code only happens on connection and the
-				// remote logging program doesn't send the settings to the log
-				// when arming starts we send all settings every thirty seconds
-				static uint32_t second_count = 0;
-				if (second_count ++ > 30) {
-					UAVObjIterate(&send_settings);
-					second_count = 0;
-				}
-				last_connected = syncStats.Connected;
-			}
-
-			// TODO: Check the receive buffer
+		uint32_t now = PIOS_Thread_Systime();
+		int32_t wait = next_tick - now;
+
+		if (wait <= 0) {
+			process_rx();
+			send_periodic(now);
+			send_settings();
+			update_stats(now);
+			overosync_link_flush(overosync->link);
+
+			next_tick = now + TASK_PERIOD_MS;
+			wait = TASK_PERIOD_MS;
 		}
+
+		if (PIOS_Queue_Receive(queue, &ev, wait) == true)
+			process_event(&ev);
+	}
+}
+
+/**
+ * Forward an object update if the companion wants it right away
+ */
+static void process_event(UAVObjEvent *ev)
+{
+	if (ev->obj == OveroSyncSubscriptionHandle()) {
+		update_subscriptions();
+		return;
+	}
+
+	if (overosync_link_forward_update(overosync->link, UAVObjGetID(ev->obj)))
+		UAVTalkSendObjectTimestamped(uavTalkCon, ev->obj, ev->instId, false, 0);
+}
+
+/**
+ * Take the subscriptions from the companion and start a settings snapshot
+ * when it asks for one
+ */
+static void update_subscriptions(void)
+{
+	OveroSyncSubscriptionData subscription;
+	OveroSyncSubscriptionGet(&subscription);
+
+	overosync_link_unsubscribe_all(overosync->link);
+	for (uint8_t i = 0; i < OVEROSYNCSUBSCRIPTION_OBJECTID_NUMELEM; i++) {
+		// Unknown objects would stay due forever
+		if (subscription.ObjectID[i] == 0 || UAVObjGetByID(subscription.ObjectID[i]) == NULL)
+			continue;
+
+		overosync_link_subscribe(overosync->link, subscription.ObjectID[i], subscription.Period[i]);
+	}
+
+	if (subscription.SettingsRequest != overosync->settings_request) {
+		overosync->settings_request = subscription.SettingsRequest;
+		overosync->settings_cursor = 0;
+	}
+}
+
+/**
+ * Pass the data from the companion to UAVTalk
+ */
+static void process_rx(void)
+{
+	uint8_t buf[RX_CHUNK_SIZE];
+	uint16_t bytes;
+
+	while ((bytes = PIOS_COM_ReceiveBuffer(pios_com_overo_id, buf, sizeof(buf), 0)) > 0) {
+		for (uint16_t i = 0; i < bytes; i++)
+			UAVTalkProcessInputStream(uavTalkCon, buf[i]);
+
+		overosync->received_bytes += bytes;
+	}
+}
+
+/**
+ * Send the periodic subscriptions that are due and fit in the batch, the
+ * rest waits for the next period
+ */
+static void send_periodic(uint32_t now)
+{
+	uint32_t obj_id;
+
+	while (overosync_link_next_due(overosync->link, now, &obj_id)) {
+		UAVObjHandle obj = UAVObjGetByID(obj_id);
+
+		if (UAVObjGetNumBytes(obj) + FRAME_OVERHEAD > overosync_link_room(overosync->link))
+			return;
+
+		UAVTalkSendObjectTimestamped(uavTalkCon, obj, 0, false, 0);
+		overosync_link_mark_sent(overosync->link, obj_id, now);
+	}
+}
+
+/**
+ * Continue the settings snapshot with as much as the port takes without
+ * dropping anything
+ */
+static void send_settings(void)
+{
+	if (overosync->settings_cursor >= overosync->num_settings)
+		return;
+
+	while (overosync->settings_cursor < overosync->num_settings) {
+		UAVObjHandle obj = overosync->settings[overosync->settings_cursor];
+
+		if (UAVObjGetNumBytes(obj) + FRAME_OVERHEAD > overosync_link_room(overosync->link))
+			return;
+
+		UAVTalkSendObjectTimestamped(uavTalkCon, obj, 0, false, 0);
+		overosync->settings_cursor++;
+
+		// Make room in the batch as soon as the port can take it
+		overosync_link_flush(overosync->link);
 	}
+
+	// Tell the companion that it has all of them
+	OveroSyncStatsSettingsSnapshotSet(&overosync->settings_request);
+	UAVTalkSendObjectTimestamped(uavTalkCon, OveroSyncStatsHandle(), 0, false, 0);
 }
 
 /**
- * Transmit data buffer to the modem or USB port.
+ * Update the statistics once per STATS_PERIOD_MS
+ */
+static void update_stats(uint32_t now)
+{
+	if (now - overosync->last_stats_time < STATS_PERIOD_MS)
+		return;
+
+	struct overosync_link_stats link_stats;
+	overosync_link_get_stats(overosync->link, &link_stats);
+
+	// Update stats.  This will trigger a local send event too
+	OveroSyncStatsData syncStats;
+	OveroSyncStatsGet(&syncStats);
+	syncStats.Send = link_stats.sent_bytes - overosync->last_stats.sent_bytes;
+	syncStats.Received = overosync->received_bytes;
+	syncStats.Connected = (syncStats.Received > 0 || syncStats.Send > 500) ?
+		OVEROSYNCSTATS_CONNECTED_TRUE : OVEROSYNCSTATS_CONNECTED_FALSE;
+	syncStats.DroppedUpdates = link_stats.dropped - overosync->last_stats.dropped;
+#if defined(PIOS_INCLUDE_OVERO)
+	syncStats.Packets = PIOS_OVERO_GetPacketCount(pios_overo_id);
+#else
+	syncStats.Packets = link_stats.batches;
+#endif
+	OveroSyncStatsSet(&syncStats);
+
+	overosync->last_stats = link_stats;
+	overosync->received_bytes = 0;
+	overosync->last_stats_time = now;
+}
+
+/**
+ * Add a UAVTalk frame to the batch for the companion
  * \param[in] data Data buffer to send
  * \param[in] length Length of buffer
  * \return -1 on failure
@@ -243,16 +390,7 @@ static void overoSyncTask(void *parameters)
  */
 static int32_t pack_data(uint8_t * data, int32_t length)
 {
-	if( PIOS_COM_SendBufferNonBlocking(pios_com_overo_id, data, length) < 0)
-		goto fail;
-
-	overosync->sent_bytes += length;
-
-	return length;
-
-fail:
-	overosync->failed_objects++;
-	return -1;
+	return overosync_link_write(overosync->link, data, length);
 }
 
 /**
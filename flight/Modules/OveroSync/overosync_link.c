@@ -0,0 +1,257 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup OveroSyncModule OveroSync Module
+ * @{
+ *
+ * @file       overosync_link.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Batching and subscriptions of the companion computer link
+ *
+ * UAVTalk frames are collected in a batch that goes to the COM port with a
+ * single write, so a frame is never split by a full port and the transfers
+ * to the companion are filled. When the port can't take the batch it is
+ * kept and new frames are dropped until it drains, the room left tells
+ * the bulk transfers how much they can write without losing anything.
+ *
+ * The companion lists the objects it wants with a period each, a period of
+ * zero forwards every update. As long as it lists nothing every update is
+ * forwarded, like the Overo logger expects.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pios.h"
+#include "overosync_link.h"
+
+struct overosync_subscription {
+	uint32_t obj_id;
+	uint16_t period_ms;
+	uint32_t last_sent;
+};
+
+struct overosync_link {
+	uintptr_t com_id;
+
+	uint8_t *batch;
+	uint16_t batch_size;
+	uint16_t batch_used;
+
+	struct overosync_subscription *subs;
+	uint8_t num_subs;
+	uint8_t max_subs;
+
+	struct overosync_link_stats stats;
+};
+
+/**
+ * Create the link
+ * @param[in] com_id             port of the companion
+ * @param[in] batch_size         bytes written to the port at once, at least
+ *                               the largest UAVTalk frame
+ * @param[in] max_subscriptions  objects the companion can subscribe to
+ * @returns the link or NULL if out of memory
+ */
+struct overosync_link *overosync_link_create(uintptr_t com_id, uint16_t batch_size, uint8_t max_subscriptions)
+{
+	struct overosync_link *link = PIOS_malloc(sizeof(*link));
+	if (link == NULL)
+		return NULL;
+
+	memset(link, 0, sizeof(*link));
+
+	link->batch = PIOS_malloc(batch_size);
+	link->subs = PIOS_malloc(max_subscriptions * sizeof(*link->subs));
+	if (link->batch == NULL || link->subs == NULL)
+		return NULL;
+
+	link->com_id = com_id;
+	link->batch_size = batch_size;
+	link->max_subs = max_subscriptions;
+
+	return link;
+}
+
+/**
+ * Add a frame to the batch. Meant as the UAVTalk output stream.
+ * @returns len or -1 if the frame was dropped
+ */
+int32_t overosync_link_write(struct overosync_link *link, const uint8_t *data, uint16_t len)
+{
+	if (link->batch_used + len > link->batch_size)
+		overosync_link_flush(link);
+
+	if (link->batch_used + len > link->batch_size) {
+		link->stats.dropped++;
+		return -1;
+	}
+
+	memcpy(&link->batch[link->batch_used], data, len);
+	link->batch_used += len;
+
+	return len;
+}
+
+/**
+ * Write the batch to the port if it has room for it
+ * @returns true if the batch is empty now
+ */
+bool overosync_link_flush(struct overosync_link *link)
+{
+	if (link->batch_used == 0)
+		return true;
+
+	if (PIOS_COM_GetTxFree(link->com_id) < link->batch_used)
+		return false;
+
+	if (PIOS_COM_SendBufferNonBlocking(link->com_id, link->batch, link->batch_used) != link->batch_used)
+		return false;
+
+	link->stats.sent_bytes += link->batch_used;
+	link->stats.batches++;
+	link->batch_used = 0;
+
+	return true;
+}
+
+/**
+ * How much can be written without dropping frames
+ */
+uint16_t overosync_link_room(struct overosync_link *link)
+{
+	if (link->batch_used == 0 || PIOS_COM_GetTxFree(link->com_id) >= link->batch_used)
+		return link->batch_size;
+
+	return link->batch_size - link->batch_used;
+}
+
+/**
+ * Forget all subscriptions, every update is forwarded again
+ */
+void overosync_link_unsubscribe_all(struct overosync_link *link)
+{
+	link->num_subs = 0;
+}
+
+/**
+ * Subscribe to an object
+ * @param[in] obj_id     the object
+ * @param[in] period_ms  how often to send it, 0 to send every update
+ * @returns 0 on success, -1 if the table is full
+ */
+int32_t overosync_link_subscribe(struct overosync_link *link, uint32_t obj_id, uint16_t period_ms)
+{
+	struct overosync_subscription *sub = NULL;
+
+	for (uint8_t i = 0; i < link->num_subs; i++) {
+		if (link->subs[i].obj_id == obj_id)
+			sub = &link->subs[i];
+	}
+
+	if (sub == NULL) {
+		if (link->num_subs >= link->max_subs)
+			return -1;
+
+		sub = &link->subs[link->num_subs++];
+		sub->obj_id = obj_id;
+		sub->last_sent = 0;
+	}
+
+	sub->period_ms = period_ms;
+
+	return 0;
+}
+
+static struct overosync_subscription *find_subscription(struct overosync_link *link, uint32_t obj_id)
+{
+	for (uint8_t i = 0; i < link->num_subs; i++) {
+		if (link->subs[i].obj_id == obj_id)
+			return &link->subs[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Whether an update of the object goes to the companion right away
+ */
+bool overosync_link_forward_update(struct overosync_link *link, uint32_t obj_id)
+{
+	if (link->num_subs == 0)
+		return true;
+
+	struct overosync_subscription *sub = find_subscription(link, obj_id);
+
+	return sub != NULL && sub->period_ms == 0;
+}
+
+/**
+ * Find a periodic subscription that is due. It stays due until it is
+ * marked as sent.
+ * @param[in]  now_ms  current time
+ * @param[out] obj_id  the object to send
+ * @returns true if one is due
+ */
+bool overosync_link_next_due(struct overosync_link *link, uint32_t now_ms, uint32_t *obj_id)
+{
+	struct overosync_subscription *oldest = NULL;
+
+	// The one that waits longest first, so a slow link serves all of them
+	for (uint8_t i = 0; i < link->num_subs; i++) {
+		struct overosync_subscription *sub = &link->subs[i];
+
+		if (sub->period_ms == 0 || now_ms - sub->last_sent < sub->period_ms)
+			continue;
+
+		if (oldest == NULL || now_ms - sub->last_sent > now_ms - oldest->last_sent)
+			oldest = sub;
+	}
+
+	if (oldest == NULL)
+		return false;
+
+	*obj_id = oldest->obj_id;
+
+	return true;
+}
+
+/**
+ * Restart the period of a subscription
+ */
+void overosync_link_mark_sent(struct overosync_link *link, uint32_t obj_id, uint32_t now_ms)
+{
+	struct overosync_subscription *sub = find_subscription(link, obj_id);
+
+	if (sub != NULL)
+		sub->last_sent = now_ms;
+}
+
+/**
+ * Get the statistics of the link
+ */
+void overosync_link_get_stats(struct overosync_link *link, struct overosync_link_stats *stats)
+{
+	*stats = link->stats;
+}
+
+/**
+ * @}
+ * @}
+ */
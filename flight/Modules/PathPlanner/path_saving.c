@@ -28,6 +28,7 @@
 #include "pios.h"
 #include "openpilot.h"
 #include "pios_flashfs.h"
+#include "pios_crc.h"
 #include "waypoint.h"
 
 extern uintptr_t pios_waypoints_settings_fs_id;
@@ -35,71 +36,173 @@ extern uintptr_t pios_waypoints_settings_fs_id;
 /* Note: this system uses the flashfs in a slightly different way  */
 /* the flashfs saves entries with an object and instance id. in    */
 /* this code the object id is used to indicate the path id and the */
-/* instance id is the waypoint number                              */
+/* instance id is the chunk number plus PATH_CHUNK_INST_BASE.      */
+/*                                                                 */
+/* A path is stored in as few records as the slot size allows,     */
+/* each one starting with a path_chunk_header. Paths written by    */
+/* older firmware used one record per waypoint with the waypoint   */
+/* number as instance id, those are still loaded and are removed   */
+/* the next time the path is saved.                                */
+
+#define PATH_CHUNK_VERSION    1
+#define PATH_CHUNK_INST_BASE  0x8000
+#define PATH_CHUNK_MAX_SIZE   256
+
+struct path_chunk_header {
+	uint8_t version;          // PATH_CHUNK_VERSION
+	uint8_t waypoint_size;    // size of a waypoint when the path was saved
+	uint16_t num_waypoints;   // waypoints in the whole path
+	uint16_t first;           // first waypoint in this chunk
+	uint16_t crc;             // CRC16 of the header with crc = 0 and the waypoints
+} __attribute__((packed));
+
+static uint8_t chunk_buffer[PATH_CHUNK_MAX_SIZE] __attribute__((aligned(4)));
+
+/**
+ * Number of waypoints stored in each chunk, every chunk has the same
+ * size so it can be loaded without knowing the length of the path
+ */
+static int32_t waypoints_per_chunk(void)
+{
+	int32_t max_size = PIOS_FLASHFS_GetMaxObjSize(pios_waypoints_settings_fs_id);
+	if (max_size < 0)
+		return max_size;
+
+	if (max_size > PATH_CHUNK_MAX_SIZE)
+		max_size = PATH_CHUNK_MAX_SIZE;
+
+	return (max_size - (int32_t) sizeof(struct path_chunk_header)) / (int32_t) WaypointGetNumBytes();
+}
+
+static uint16_t chunk_crc(uint16_t chunk_size)
+{
+	struct path_chunk_header *header = (struct path_chunk_header *) chunk_buffer;
+	uint16_t crc = header->crc;
+
+	header->crc = 0;
+	uint16_t computed = PIOS_CRC16_updateCRC(0, chunk_buffer, chunk_size);
+	header->crc = crc;
+
+	return computed;
+}
+
+/**
+ * Check whether a path was saved with one record per waypoint and remove
+ * those records
+ */
+static void delete_legacy_path(uint32_t path_id)
+{
+	uint32_t waypoint_size = WaypointGetNumBytes();
+
+	for (uint16_t i = 0; i < PATH_CHUNK_INST_BASE; i++) {
+		if (PIOS_FLASHFS_ObjLoad(pios_waypoints_settings_fs_id, path_id, i, chunk_buffer, waypoint_size) != 0)
+			break;
+		PIOS_FLASHFS_ObjDelete(pios_waypoints_settings_fs_id, path_id, i);
+	}
+}
+
+/**
+ * Set the waypoints starting at first to INVALID to indicate they should
+ * not be used. Sends no update event.
+ */
+static void invalidate_waypoints(uint16_t first)
+{
+	WaypointData waypoint;
+
+	for (uint16_t i = first; i < WaypointGetNumInstances(); i++) {
+		WaypointInstGet(i, &waypoint);
+		waypoint.Mode = WAYPOINT_MODE_INVALID;
+		UAVObjSetInstancesDataQuiet(WaypointHandle(), i, 1, &waypoint);
+	}
+}
 
 /**
  * Save the in memory waypoints to the waypoint filesystem
  * @param[in] id The path id to save as
+ * @return -30 waypoint object not registered
+ * @return -32 a waypoint does not fit in a filesystem slot
+ * @return other indicates FlashFS error
  */
 int32_t pathplanner_save_path(uint32_t path_id)
 {
-	WaypointData waypoint;
-
 	if (WaypointHandle() == 0)
 		return -30; // leave room for flashfs error codes
 
-	uint16_t num_waypoints = WaypointGetNumInstances();
-	uint32_t  waypoint_size = WaypointGetNumBytes();
-	int32_t  erase_retval  = 0;
-	int32_t  last_save_id  = -1;
-	int32_t  retval        = 0;
+	int32_t per_chunk = waypoints_per_chunk();
+	if (per_chunk <= 0)
+		return -32;
 
-	// Save all elements
-	for (int32_t i = 0; i < num_waypoints && retval == 0; i++) {
-		WaypointInstGet(i, &waypoint);
+	struct path_chunk_header *header = (struct path_chunk_header *) chunk_buffer;
+	uint8_t *waypoints = chunk_buffer + sizeof(struct path_chunk_header);
+	uint32_t waypoint_size = WaypointGetNumBytes();
+	uint16_t chunk_size = sizeof(struct path_chunk_header) + per_chunk * waypoint_size;
 
-		// Stop saving when get to invalid waypoint.  Nothing after or including is valid
-		if (waypoint.Mode == WAYPOINT_MODE_INVALID)
-			break;
+	// Find out how many chunks the path that is overwritten used
+	uint16_t old_chunks = 0;
+	if (PIOS_FLASHFS_ObjLoad(pios_waypoints_settings_fs_id, path_id, PATH_CHUNK_INST_BASE,
+	                         chunk_buffer, chunk_size) == 0 &&
+	    header->version == PATH_CHUNK_VERSION && header->waypoint_size == waypoint_size) {
+		old_chunks = (header->num_waypoints + per_chunk - 1) / per_chunk;
+	}
 
-		retval = PIOS_FLASHFS_ObjSave(pios_waypoints_settings_fs_id, path_id, i, (uint8_t *) &waypoint, waypoint_size);
-		last_save_id = i; // Track the last valid waypoint id
+	// Stop saving at the first invalid waypoint.  Nothing after or including is valid
+	uint16_t num_waypoints = WaypointGetNumInstances();
+	for (uint16_t i = 0; i < num_waypoints; i++) {
+		WaypointData waypoint;
+		WaypointInstGet(i, &waypoint);
+		if (waypoint.Mode == WAYPOINT_MODE_INVALID) {
+			num_waypoints = i;
+			break;
+		}
 	}
 
-	// Use an explicit indication of the end of path
-	waypoint.Mode = WAYPOINT_MODE_INVALID;
-	retval = PIOS_FLASHFS_ObjSave(pios_waypoints_settings_fs_id, path_id, ++last_save_id,
-	                              (uint8_t *) &waypoint, waypoint_size);
+	// An empty path still writes the first chunk to mark the path as empty
+	uint16_t num_chunks = (num_waypoints + per_chunk - 1) / per_chunk;
+	if (num_chunks == 0)
+		num_chunks = 1;
+
+	int32_t retval = 0;
+	for (uint16_t chunk = 0; chunk < num_chunks && retval == 0; chunk++) {
+		uint16_t first = chunk * per_chunk;
 
-	// Check for any waypoints after the saved end of the path and erase them
-	for (int32_t i = last_save_id + 1; erase_retval == 0; i++) {
-		erase_retval = PIOS_FLASHFS_ObjLoad(pios_waypoints_settings_fs_id, path_id, i, (uint8_t *) &waypoint, waypoint_size);
-		if (erase_retval == 0) {
-			PIOS_FLASHFS_ObjDelete(pios_waypoints_settings_fs_id, path_id, i);
+		memset(chunk_buffer, 0, chunk_size);
+		header->version = PATH_CHUNK_VERSION;
+		header->waypoint_size = waypoint_size;
+		header->num_waypoints = num_waypoints;
+		header->first = first;
+		for (uint16_t i = first; i < num_waypoints && i < first + per_chunk; i++) {
+			WaypointInstGet(i, (WaypointData *) (waypoints + (i - first) * waypoint_size));
 		}
+		header->crc = chunk_crc(chunk_size);
+
+		retval = PIOS_FLASHFS_ObjSave(pios_waypoints_settings_fs_id, path_id,
+		                              PATH_CHUNK_INST_BASE + chunk, chunk_buffer, chunk_size);
 	}
 
+	if (retval != 0)
+		return retval;
+
+	// Erase the chunks of a longer path that was saved before
+	for (uint16_t chunk = num_chunks; chunk < old_chunks; chunk++) {
+		PIOS_FLASHFS_ObjDelete(pios_waypoints_settings_fs_id, path_id, PATH_CHUNK_INST_BASE + chunk);
+	}
+
+	delete_legacy_path(path_id);
+
 	return retval;
 }
 
 /**
- * Load a path from the waypoint filesystem into memory
- * @param[in] id The path id to load
- * @return -30 waypoint object not registered
- * @return -31 could not allocate waypoint in ram
- * @return other indicates FlashFS error
+ * Load a path saved with one record per waypoint
  */
-int32_t pathplanner_load_path(uint32_t path_id)
+static int32_t load_legacy_path(uint32_t path_id)
 {
 	WaypointData waypoint;
 
-	if (WaypointHandle() == 0)
-		return -30; // leave room for flashfs error codes
-
 	uint32_t  waypoint_size = WaypointGetNumBytes();
 	int32_t  retval = 0;
 
-	int32_t i;
+	uint16_t i;
 
 	for (i = 0; retval == 0; i++) {
 		retval = PIOS_FLASHFS_ObjLoad(pios_waypoints_settings_fs_id, path_id, i, (uint8_t *) &waypoint, waypoint_size);
@@ -110,27 +213,87 @@ int32_t pathplanner_load_path(uint32_t path_id)
 				break;
 
 			// Loaded waypoint locally, store in UAVO manager
-			if (i >= WaypointGetNumInstances()) {
-				int32_t new_instance_id = WaypointCreateInstance();
-				if (new_instance_id != i) {
-					retval = -31;
-					break;
-				}
+			if (UAVObjSetInstancesDataQuiet(WaypointHandle(), i, 1, &waypoint) != 0) {
+				retval = -31;
+				break;
 			}
-
-			WaypointInstSet(i, &waypoint);
 		}
 	}
 
-	// Set any remaining waypoints to INVALID to indicate they should not be used
 	// at this point i will be the index of the first waypoint that could not be
 	// loaded from flash.
-	for (; i <  WaypointGetNumInstances(); i++) {
-		WaypointInstGet(i, &waypoint);
-		waypoint.Mode = WAYPOINT_MODE_INVALID;
-		WaypointInstSet(i, &waypoint);
+	invalidate_waypoints(i);
+	UAVObjInstanceUpdated(WaypointHandle(), UAVOBJ_ALL_INSTANCES);
+
+	return retval;
+}
+
+/**
+ * Load a path from the waypoint filesystem into memory. The waypoints
+ * are set without events and one update is sent for all of them at the end.
+ * @param[in] id The path id to load
+ * @return -30 waypoint object not registered
+ * @return -31 could not allocate waypoint in ram
+ * @return -32 the stored path is corrupted or from an incompatible version
+ * @return other indicates FlashFS error
+ */
+int32_t pathplanner_load_path(uint32_t path_id)
+{
+	if (WaypointHandle() == 0)
+		return -30; // leave room for flashfs error codes
+
+	int32_t per_chunk = waypoints_per_chunk();
+	if (per_chunk <= 0)
+		return -32;
+
+	struct path_chunk_header *header = (struct path_chunk_header *) chunk_buffer;
+	uint32_t waypoint_size = WaypointGetNumBytes();
+	uint16_t chunk_size = sizeof(struct path_chunk_header) + per_chunk * waypoint_size;
+
+	int32_t retval = PIOS_FLASHFS_ObjLoad(pios_waypoints_settings_fs_id, path_id, PATH_CHUNK_INST_BASE,
+	                                      chunk_buffer, chunk_size);
+	if (retval == -3) // not found, try the old format
+		return load_legacy_path(path_id);
+
+	uint16_t num_waypoints = header->num_waypoints;
+	uint16_t loaded = 0;
+
+	for (uint16_t chunk = 0; retval == 0; chunk++) {
+		if (chunk > 0)
+			retval = PIOS_FLASHFS_ObjLoad(pios_waypoints_settings_fs_id, path_id, PATH_CHUNK_INST_BASE + chunk,
+			                              chunk_buffer, chunk_size);
+		if (retval != 0)
+			break;
+
+		if (header->version != PATH_CHUNK_VERSION || header->waypoint_size != waypoint_size ||
+		    header->num_waypoints != num_waypoints || header->first != loaded ||
+		    header->crc != chunk_crc(chunk_size)) {
+			retval = -32;
+			break;
+		}
+
+		uint16_t count = num_waypoints - loaded;
+		if (count > per_chunk)
+			count = per_chunk;
+
+		if (UAVObjSetInstancesDataQuiet(WaypointHandle(), loaded, count,
+		                                chunk_buffer + sizeof(struct path_chunk_header)) != 0) {
+			retval = -31;
+			break;
+		}
+
+		loaded += count;
+		if (loaded >= num_waypoints)
+			break;
 	}
 
+	// Do not leave part of a path that could not be loaded completely
+	if (retval != 0)
+		loaded = 0;
+
+	invalidate_waypoints(loaded);
+	UAVObjInstanceUpdated(WaypointHandle(), UAVOBJ_ALL_INSTANCES);
+
 	return retval;
 }
 
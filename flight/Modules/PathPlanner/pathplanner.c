@@ -46,6 +46,7 @@
 #define TASK_PRIORITY PIOS_THREAD_PRIO_LOW
 #define MAX_QUEUE_SIZE 2
 #define UPDATE_RATE_MS 20
+#define RESERVED_WAYPOINTS 32
 
 // Private types
 
@@ -115,6 +116,9 @@ int32_t PathPlannerInitialize()
 		WaypointInitialize();
 		WaypointActiveInitialize();
 
+		// Uploaded waypoints are created after start up, keep room for them
+		UAVObjReserveInstances(WaypointHandle(), RESERVED_WAYPOINTS);
+
 		// Create object queue
 		queue = PIOS_Queue_Create(MAX_QUEUE_SIZE, sizeof(UAVObjEvent));
 		FlightStatusConnectQueue(queue);
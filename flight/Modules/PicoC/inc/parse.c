@@ -460,6 +460,13 @@ void ParseFor(struct ParseState *Parser)
     if (ParseStatement(Parser, TRUE) != ParseResultOk)
         ProgramFail(Parser, "statement expected");
     
+    if (PlatformRunLoop(Parser, TokenFor))
+    {
+        /* the loop ran as bytecode */
+        VariableScopeEnd(Parser, ScopeID, PrevScopeID);
+        return;
+    }
+    
     ParserCopyPos(&PreConditional, Parser);
     if (LexGetToken(Parser, NULL, FALSE) == TokenSemicolon)
         Condition = TRUE;
@@ -689,6 +696,12 @@ enum ParseResult ParseStatement(struct ParseState *Parser, int CheckTrailingSemi
                 if (LexGetToken(Parser, NULL, TRUE) != TokenOpenBracket)
                     ProgramFail(Parser, "'(' expected");
                     
+                if (PlatformRunLoop(Parser, TokenWhile))
+                {
+                    CheckTrailingSemicolon = FALSE;
+                    break;
+                }
+                
                 ParserCopyPos(&PreConditional, Parser);
                 do
                 {
@@ -716,6 +729,9 @@ enum ParseResult ParseStatement(struct ParseState *Parser, int CheckTrailingSemi
             {
                 struct ParseState PreStatement;
                 enum RunMode PreMode = Parser->Mode;
+                if (PlatformRunLoop(Parser, TokenDo))
+                    break;
+                
                 ParserCopyPos(&PreStatement, Parser);
                 do
                 {
@@ -55,6 +55,15 @@ size_t PlatformHeapSize();
 void PlatformDebug(const char *format, ...);
 int picoc(const char *source, size_t stack_size);
 
+/* storage for the token image of a source, so it is only tokenised once */
+struct picoc_token_store {
+	int32_t (*load)(uint8_t *buffer, uint32_t size);	/* read the first size bytes, 0 on success */
+	int32_t (*save)(const uint8_t *buffer, uint32_t size);	/* replace the stored image, 0 on success */
+};
+int picoc_cached(const char *source, size_t stack_size, const struct picoc_token_store *store);
+void picoc_set_time_slice(uint32_t time_slice);
+void picoc_set_bytecode(bool enable);
+
 /* get all picoc definitions */
 #include "picoc.h"
 
@@ -68,9 +77,14 @@ extern struct LibraryFunction CLibrary[];
 #ifdef NO_DEBUGGER
 #define DebugInit(pc)
 #define DebugCleanup(pc)
-#define DebugCheckStatement(parser)
+#define DebugCheckStatement(parser) PlatformCheckStatement(parser)
+void PlatformCheckStatement(struct ParseState *Parser);
 #endif
 
+/* loops that only compute run as bytecode */
+void PlatformLoopInit(void);
+int PlatformRunLoop(struct ParseState *Parser, enum LexToken Loop);
+
 #endif /* PICOC_PORT_H */
 
 /**
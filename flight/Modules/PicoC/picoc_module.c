@@ -39,6 +39,7 @@
 #include "picocstatus.h" 
 #include "flightstatus.h"
 #include "modulesettings.h"
+#include "misc_math.h"
 #include "pios_thread.h"
 
 // Global variables
@@ -52,6 +53,7 @@ extern struct flashfs_logfs_cfg flashfs_waypoints_cfg;
 #define PICOC_STACKSIZE_MIN		(10*1024)
 #define PICOC_STACKSIZE_MAX		(128*1024)
 #define PICOC_SOURCE_FILE_TYPE	0X00704300		/* mark picoc sources with this ID */
+#define PICOC_TOKEN_FILE_TYPE	0X00705400		/* mark token images of picoc sources with this ID */
 #define PICOC_SECTOR_SIZE		48				/* size of filesystem object (less than slot_size - sizeof(slot_header) */
 #define SOH	0x01	/* (^A) start of heading */
 #define STX	0x02	/* (^B) start of text */
@@ -67,6 +69,8 @@ static char *sourcebuffer;
 static uint32_t sourcebuffer_size;
 static PicoCSettingsData picocsettings;
 static PicoCStatusData picocstatus;
+static int16_t source_file = -1;	/* file in the source buffer, -1 if the buffer was changed */
+static uint8_t token_file;
 
 // Private functions
 static void picocTask(void *parameters);
@@ -78,6 +82,15 @@ int32_t load_file(uint8_t file, char *buffer, uint32_t buffer_size);
 int32_t save_file(uint8_t file, char *buffer, uint32_t buffer_size);
 int32_t delete_file(uint8_t file);
 int32_t format_partition();
+static int32_t run_source();
+static int32_t load_tokens(uint8_t *buffer, uint32_t size);
+static int32_t save_tokens(const uint8_t *buffer, uint32_t size);
+static int32_t delete_tokens(uint8_t file);
+
+static const struct picoc_token_store token_store = {
+	.load = load_tokens,
+	.save = save_tokens,
+};
 
 /**
  * start the module
@@ -165,11 +178,13 @@ static void picocTask(void *parameters) {
 	PicoCSettingsGet(&picocsettings);
 	picocstatus.CommandError = load_file(picocsettings.BootFileID, sourcebuffer, sourcebuffer_size);
 	PicoCStatusCommandErrorSet(&picocstatus.CommandError);
+	source_file = picocsettings.BootFileID;
 
 	while (1) {
 		PicoCSettingsGet(&picocsettings);
 		PicoCStatusGet(&picocstatus);
 		FlightStatusGet(&flightstatus);
+		picoc_set_time_slice(picocsettings.TimeSlice);
 
 		// handle file and buffer commands
 		if (picocstatus.Command != PICOCSTATUS_COMMAND_IDLE) {
@@ -178,7 +193,7 @@ static void picocTask(void *parameters) {
 				// external start request
 				picocstatus.ExitValue = 0;
 				PicoCStatusExitValueSet(&picocstatus.ExitValue);
-				picocstatus.ExitValue = picoc(sourcebuffer, picocsettings.PicoCStackSize);
+				picocstatus.ExitValue = run_source();
 				PicoCStatusExitValueSet(&picocstatus.ExitValue);
 				picocstatus.CommandError = 0;
 				picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
@@ -187,6 +202,7 @@ static void picocTask(void *parameters) {
 			case PICOCSTATUS_COMMAND_USARTMODE:
 				// handle commands via USART
 				picocstatus.CommandError = usart_cmd(sourcebuffer, sourcebuffer_size);
+				source_file = -1;
 				if (picocstatus.CommandError) {
 					picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
 				}
@@ -200,21 +216,26 @@ static void picocTask(void *parameters) {
 			case PICOCSTATUS_COMMAND_SETSECTOR:
 				// fill buffer from uavo to selected sector
 				picocstatus.CommandError = set_sector(picocstatus.SectorID, sourcebuffer, sourcebuffer_size);
+				source_file = -1;
 				picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
 				break;
 			case PICOCSTATUS_COMMAND_LOADFILE:
 				// fill buffer from flash file
 				picocstatus.CommandError = load_file(picocstatus.FileID, sourcebuffer, sourcebuffer_size);
+				source_file = picocstatus.FileID;
 				picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
 				break;
 			case PICOCSTATUS_COMMAND_SAVEFILE:
 				// save buffer to flash file
 				picocstatus.CommandError = save_file(picocstatus.FileID, sourcebuffer, sourcebuffer_size);
+				delete_tokens(picocstatus.FileID);
+				source_file = (picocstatus.CommandError == 0) ? picocstatus.FileID : -1;
 				picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
 				break;
 			case PICOCSTATUS_COMMAND_DELETEFILE:
 				// delete flash file
 				picocstatus.CommandError = delete_file(picocstatus.FileID);
+				delete_tokens(picocstatus.FileID);
 				picocstatus.Command = PICOCSTATUS_COMMAND_IDLE;
 				break;
 			case PICOCSTATUS_COMMAND_FORMATPARTITION:
@@ -269,7 +290,7 @@ static void picocTask(void *parameters) {
 				// terminate source for security.
 				sourcebuffer[sourcebuffer_size - 1] = 0;
 				// start picoc in file mode.
-				picocstatus.ExitValue = picoc(sourcebuffer, picocsettings.PicoCStackSize);
+				picocstatus.ExitValue = run_source();
 				started = true;
 				break;
 			default:
@@ -285,6 +306,20 @@ static void picocTask(void *parameters) {
 	}
 }
 
+/**
+ * run the source buffer
+ * an unchanged file is run from its token image, which is made on the first run
+ */
+static int32_t run_source()
+{
+	if (source_file < 0) {
+		return picoc(sourcebuffer, picocsettings.PicoCStackSize);
+	}
+
+	token_file = source_file;
+	return picoc_cached(sourcebuffer, picocsettings.PicoCStackSize, &token_store);
+}
+
 /**
  * update picoc module settings
  */
@@ -474,6 +509,56 @@ int32_t delete_file(uint8_t file)
 	return retval;
 }
 
+/**
+ * load the first bytes of a token image from flash
+ */
+static int32_t load_tokens(uint8_t *buffer, uint32_t size)
+{
+	uint32_t file_id = PICOC_TOKEN_FILE_TYPE + token_file;
+	uint8_t sector[PICOC_SECTOR_SIZE];
+
+	for (uint32_t offset = 0; offset < size; offset += PICOC_SECTOR_SIZE) {
+		if (PIOS_FLASHFS_ObjLoad(pios_waypoints_settings_fs_id, file_id, offset / PICOC_SECTOR_SIZE, (uint8_t *) &sector, PICOC_SECTOR_SIZE) != 0) {
+			return -1;
+		}
+		memcpy(&buffer[offset], sector, MIN(size - offset, PICOC_SECTOR_SIZE));
+	}
+	return 0;
+}
+
+/**
+ * save a token image to flash
+ */
+static int32_t save_tokens(const uint8_t *buffer, uint32_t size)
+{
+	uint32_t file_id = PICOC_TOKEN_FILE_TYPE + token_file;
+	uint8_t sector[PICOC_SECTOR_SIZE];
+
+	for (uint32_t offset = 0; offset < size; offset += PICOC_SECTOR_SIZE) {
+		memset(sector, 0, sizeof(sector));
+		memcpy(sector, &buffer[offset], MIN(size - offset, PICOC_SECTOR_SIZE));
+		int32_t retval = PIOS_FLASHFS_ObjSave(pios_waypoints_settings_fs_id, file_id, offset / PICOC_SECTOR_SIZE, (uint8_t *) &sector, PICOC_SECTOR_SIZE);
+		if (retval != 0) {
+			return retval;
+		}
+	}
+	return 0;
+}
+
+/**
+ * delete the token image of a source file
+ */
+static int32_t delete_tokens(uint8_t file)
+{
+	uint32_t file_id = PICOC_TOKEN_FILE_TYPE + file;
+	uint16_t sector = 0;
+
+	while (PIOS_FLASHFS_ObjDelete(pios_waypoints_settings_fs_id, file_id, sector) == 0) {
+		sector++;
+	}
+	return 0;
+}
+
 /**
  * format flash partition
  */
@@ -39,12 +39,42 @@
 #include <setjmp.h>
 #include "pios_thread.h"
 
+#include "pios_delay.h"
+
+// Private constants
+#define TOKEN_IMAGE_VERSION		1
+#define TOKEN_IMAGE_MAGIC		(0x50540000 | (TOKEN_IMAGE_VERSION << 8) | (sizeof(char *) << 4) | sizeof(long))
+#define TOKEN_IMAGE_MAX_SIZE	(128*1024)
+#define TIME_SLICE_CHECK		32		/* statements between two looks at the clock */
+#define FNV_OFFSET_BASIS		2166136261u
+#define FNV_PRIME				16777619u
+
+/**
+ * A token image holds the lexer output of a source. Identifiers and string
+ * constants are pointers into the string table in the token stream, in the
+ * image they are indexes into a pool of the different strings behind the tokens.
+ */
+struct token_image_header {
+	uint32_t magic;
+	uint32_t source_hash;	/* of the source the tokens were made from */
+	uint32_t token_len;
+	uint32_t pool_len;
+	uint32_t string_count;	/* strings in the pool */
+	uint32_t image_hash;	/* of the tokens and the string pool */
+};
+
 // Private variables
 static char *heap_memory;
 static size_t heap_size;
 static bool heap_used;
+static uint32_t time_slice;
+static uint32_t slice_start;
+static uint8_t slice_statements;
 jmp_buf PicocExitBuf;
 
+// Private functions
+static void parse_cached(Picoc *pc, const char *source, const struct picoc_token_store *store);
+
 /**
  * picoc implemetation
  * This is needed to compile picoc without a makefile to prevent object name conflicts.
@@ -68,19 +98,37 @@ jmp_buf PicocExitBuf;
  * returns the exit() value
  */
 int picoc(const char * source, size_t stack_size)
+{
+	return picoc_cached(source, stack_size, NULL);
+}
+
+/**
+ * picoc main program with a token cache
+ * the source is only tokenised, if the store holds no image of it
+ * returns the exit() value
+ */
+int picoc_cached(const char *source, size_t stack_size, const struct picoc_token_store *store)
 {
 	Picoc pc;
 	PicocInitialise(&pc, stack_size);
 
+	slice_start = PIOS_DELAY_GetRaw();
+	slice_statements = 0;
+	PlatformLoopInit();
+
 	if (PicocPlatformSetExitPoint(&pc))
 	{	/* we get here, if an error occures or 'exit();' was called. */
 		PicocCleanup(&pc);
 		return pc.PicocExitValue;
 	}
 
-	if (source)
+	if (source && store)
+	{	/* start with a cached or new token image */
+		parse_cached(&pc, source, store);
+	}
+	else if (source)
 	{	/* start with complete source file */
-		PicocParse(&pc, "nofile", source, strlen(source), true, true, false, false);
+		PicocParse(&pc, "nofile", source, strlen(source), true, true, false, time_slice > 0);
 	}
 	else
 	{	/* start interactive */
@@ -91,6 +139,308 @@ int picoc(const char * source, size_t stack_size)
 	return pc.PicocExitValue;
 }
 
+/**
+ * limit the time the interpreter runs without giving up the cpu
+ * time_slice in us, 0 is unlimited
+ */
+void picoc_set_time_slice(uint32_t us)
+{
+	time_slice = us;
+}
+
+/**
+ * called before each statement, when the time slice is used up
+ * the task sleeps for a tick. parsers only call it, when a time slice is set.
+ */
+void PlatformCheckStatement(struct ParseState *Parser)
+{
+	if ((time_slice == 0) || (++slice_statements < TIME_SLICE_CHECK))
+		return;
+
+	slice_statements = 0;
+	if (PIOS_DELAY_DiffuS(slice_start) >= time_slice)
+	{
+		PIOS_Thread_Sleep(1);
+		slice_start = PIOS_DELAY_GetRaw();
+	}
+}
+
+/**
+ * FNV-1a hash, a word at a time
+ */
+static uint32_t hash_bytes(uint32_t hash, const uint8_t *data, uint32_t len)
+{
+	uint32_t word;
+	uint32_t i = 0;
+
+	for (; i + sizeof(word) <= len; i += sizeof(word))
+	{
+		memcpy(&word, &data[i], sizeof(word));
+		hash ^= word;
+		hash *= FNV_PRIME;
+	}
+	for (; i < len; i++)
+	{
+		hash ^= data[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * find a string in the pool or append it
+ * returns the index of the string or -1 if the pool is full
+ */
+static int32_t pool_add(uint8_t *pool, uint32_t *pool_len, uint32_t *string_count, uint32_t pool_size, const char *str)
+{
+	uint16_t len = strlen(str);
+	uint16_t entry_len;
+	uint32_t offset = 0;
+
+	for (uint32_t index = 0; index < *string_count; index++)
+	{
+		memcpy(&entry_len, &pool[offset], sizeof(entry_len));
+		if ((entry_len == len) && (memcmp(&pool[offset + sizeof(entry_len)], str, len) == 0))
+			return index;
+		offset += sizeof(entry_len) + entry_len;
+	}
+
+	if (*pool_len + sizeof(len) + len > pool_size)
+		return -1;
+
+	memcpy(&pool[offset], &len, sizeof(len));
+	memcpy(&pool[offset + sizeof(len)], str, len);
+	*pool_len += sizeof(len) + len;
+	return (*string_count)++;
+}
+
+/**
+ * make a token image from a token stream
+ * returns the size of the image or -1 if it does not fit
+ */
+static int32_t token_image_pack(const uint8_t *tokens, uint32_t token_len, uint32_t source_hash, uint8_t *image, uint32_t image_size)
+{
+	struct token_image_header *header = (struct token_image_header *)image;
+	uint8_t *image_tokens = image + sizeof(*header);
+	uint8_t *pool = image_tokens + token_len;
+	uint32_t pool_len = 0;
+	uint32_t string_count = 0;
+
+	if (sizeof(*header) + token_len > image_size)
+		return -1;
+
+	memcpy(image_tokens, tokens, token_len);
+
+	for (uint32_t pos = 0; pos < token_len; )
+	{
+		enum LexToken token = (enum LexToken)tokens[pos];
+		pos += TOKEN_DATA_OFFSET;
+
+		if ((token == TokenIdentifier) || (token == TokenStringConstant))
+		{
+			char *str;
+			memcpy(&str, &tokens[pos], sizeof(str));
+			int32_t index = pool_add(pool, &pool_len, &string_count, image_size - sizeof(*header) - token_len, str);
+			if (index < 0)
+				return -1;
+			uintptr_t value = index;
+			memcpy(&image_tokens[pos], &value, sizeof(value));
+		}
+		pos += LexTokenSize(token);
+	}
+
+	header->magic = TOKEN_IMAGE_MAGIC;
+	header->source_hash = source_hash;
+	header->token_len = token_len;
+	header->pool_len = pool_len;
+	header->string_count = string_count;
+	header->image_hash = hash_bytes(FNV_OFFSET_BASIS, image_tokens, token_len + pool_len);
+
+	return sizeof(*header) + token_len + pool_len;
+}
+
+/**
+ * register the strings of the pool in the string table
+ * string literals are defined like the lexer does
+ * returns 0 on success or -1 if the pool is not valid
+ */
+static int32_t pool_register(Picoc *pc, const uint8_t *pool, uint32_t pool_len, char **strings, uint32_t string_count)
+{
+	uint32_t offset = 0;
+	uint16_t len;
+
+	for (uint32_t index = 0; index < string_count; index++)
+	{
+		if (offset + sizeof(len) > pool_len)
+			return -1;
+		memcpy(&len, &pool[offset], sizeof(len));
+		offset += sizeof(len);
+		if (offset + len > pool_len)
+			return -1;
+
+		strings[index] = TableStrRegister2(pc, (const char *)&pool[offset], len);
+		offset += len;
+	}
+
+	return (offset == pool_len) ? 0 : -1;
+}
+
+/**
+ * make a token stream from a token image
+ * returns the tokens allocated on the heap or NULL if the image is not valid
+ */
+static void *token_image_unpack(Picoc *pc, const uint8_t *image, uint32_t image_len, uint32_t source_hash)
+{
+	const struct token_image_header *header = (const struct token_image_header *)image;
+
+	if ((image_len < sizeof(*header)) || (header->magic != TOKEN_IMAGE_MAGIC) ||
+		(header->source_hash != source_hash) || (header->token_len < TOKEN_DATA_OFFSET) ||
+		(header->token_len > TOKEN_IMAGE_MAX_SIZE) || (header->pool_len > TOKEN_IMAGE_MAX_SIZE) ||
+		(header->string_count > header->pool_len / sizeof(uint16_t)) ||
+		(sizeof(*header) + header->token_len + header->pool_len != image_len))
+		return NULL;
+
+	const uint8_t *image_tokens = image + sizeof(*header);
+	const uint8_t *pool = image_tokens + header->token_len;
+	uint32_t token_len = header->token_len;
+	uint32_t string_count = header->string_count;
+
+	if (hash_bytes(FNV_OFFSET_BASIS, image_tokens, token_len + header->pool_len) != header->image_hash)
+		return NULL;
+
+	uint32_t strings_size = string_count * sizeof(char *);
+	char **strings = HeapAllocStack(pc, strings_size);
+	if (strings == NULL)
+		return NULL;
+
+	uint8_t *tokens = NULL;
+	if (pool_register(pc, pool, header->pool_len, strings, string_count) != 0)
+		goto fail;
+
+	tokens = HeapAllocMem(pc, token_len);
+	if (tokens == NULL)
+		goto fail;
+
+	memcpy(tokens, image_tokens, token_len);
+
+	uint32_t pos = 0;
+	enum LexToken token = TokenNone;
+	while (pos < token_len)
+	{
+		token = (enum LexToken)tokens[pos];
+		if ((token > TokenEndOfFunction) || (pos + TOKEN_DATA_OFFSET + LexTokenSize(token) > token_len))
+			goto fail;
+		pos += TOKEN_DATA_OFFSET;
+
+		if ((token == TokenIdentifier) || (token == TokenStringConstant))
+		{
+			uintptr_t index;
+			memcpy(&index, &tokens[pos], sizeof(index));
+			if (index >= string_count)
+				goto fail;
+
+			char *str = strings[index];
+			if ((token == TokenStringConstant) && (VariableStringLiteralGet(pc, str) == NULL))
+			{
+				struct Value *literal = VariableAllocValueAndData(pc, NULL, 0, FALSE, NULL, TRUE);
+				literal->Typ = pc->CharArrayType;
+				literal->Val = (union AnyValue *)str;
+				VariableStringLiteralDefine(pc, str, literal);
+			}
+			memcpy(&tokens[pos], &str, sizeof(str));
+		}
+		pos += LexTokenSize(token);
+	}
+
+	if (token != TokenEOF)
+		goto fail;
+
+	HeapPopStack(pc, strings, strings_size);
+	return tokens;
+
+fail:
+	if (tokens != NULL)
+		HeapFreeMem(pc, tokens);
+	HeapPopStack(pc, strings, strings_size);
+	return NULL;
+}
+
+/**
+ * load and unpack the token image of a source
+ * returns the tokens or NULL if the store holds no valid image of the source
+ */
+static void *load_token_image(Picoc *pc, uint32_t source_hash, const struct picoc_token_store *store)
+{
+	struct token_image_header header;
+
+	if ((store->load((uint8_t *)&header, sizeof(header)) != 0) ||
+		(header.magic != TOKEN_IMAGE_MAGIC) || (header.source_hash != source_hash) ||
+		(header.token_len > TOKEN_IMAGE_MAX_SIZE) || (header.pool_len > TOKEN_IMAGE_MAX_SIZE))
+		return NULL;
+
+	uint32_t image_len = sizeof(header) + header.token_len + header.pool_len;
+	uint8_t *image = HeapAllocStack(pc, image_len);
+	if (image == NULL)
+		return NULL;
+
+	void *tokens = NULL;
+	if (store->load(image, image_len) == 0)
+		tokens = token_image_unpack(pc, image, image_len, source_hash);
+
+	HeapPopStack(pc, image, image_len);
+	return tokens;
+}
+
+/**
+ * pack and save the token image of a source
+ * nothing is saved, if there is not enough memory to build the image
+ */
+static void save_token_image(Picoc *pc, const void *tokens, int token_len, int source_len, uint32_t source_hash, const struct picoc_token_store *store)
+{
+	/* the string pool holds at most the source plus a length per token */
+	uint32_t image_size = sizeof(struct token_image_header) + 2 * token_len + source_len;
+	uint8_t *image = HeapAllocStack(pc, image_size);
+	if (image == NULL)
+		return;
+
+	int32_t image_len = token_image_pack(tokens, token_len, source_hash, image, image_size);
+	if (image_len > 0)
+		store->save(image, image_len);
+
+	HeapPopStack(pc, image, image_size);
+}
+
+/**
+ * run a source from its cached token image, tokenise it if there is none
+ */
+static void parse_cached(Picoc *pc, const char *source, const struct picoc_token_store *store)
+{
+	struct ParseState parser;
+	enum ParseResult ok;
+	int source_len = strlen(source);
+	uint32_t source_hash = hash_bytes(FNV_OFFSET_BASIS, (const uint8_t *)source, source_len);
+	char *file_name = TableStrRegister(pc, "nofile");
+
+	void *tokens = load_token_image(pc, source_hash, store);
+	if (tokens == NULL)
+	{
+		int token_len;
+		tokens = LexAnalyse(pc, file_name, source, source_len, &token_len);
+		save_token_image(pc, tokens, token_len, source_len, source_hash, store);
+	}
+
+	LexInitParser(&parser, pc, source, tokens, file_name, true, time_slice > 0);
+
+	do {
+		ok = ParseStatement(&parser, true);
+	} while (ok == ParseResultOk);
+
+	if (ok == ParseResultError)
+		ProgramFail(&parser, "parse error");
+
+	HeapFreeMem(pc, tokens);
+}
+
 /**
  * PicoC platform depending system functions
  * normaly stored in platform_xxx.c
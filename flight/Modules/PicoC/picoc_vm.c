@@ -0,0 +1,1332 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules TauLabs Modules
+ * @{
+ * @addtogroup PicoC Interpreter Module
+ * @{
+ *
+ * @file       picoc_vm.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      c-interpreter module for autonomous user programmed tasks
+ *             bytecode for the loops of a script
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * The interpreter walks the tokens of a loop again in every iteration and
+ * evaluates each expression on a stack of allocated values. When a while,
+ * do or for loop starts to run, the parser hands it to PlatformRunLoop().
+ * If the loop only does arithmetic on numeric variables, it is compiled
+ * to bytecode for a small stack machine, which runs all of its iterations
+ * and leaves the parser behind the loop.
+ *
+ * Supported are int, char, short, long (also unsigned) and float variables,
+ * constants and #define'd constants, all arithmetic, comparison, logic and
+ * assignment operators, if/else, nested loops, break and continue and
+ * declarations of numeric variables. Variables are resolved once, when the
+ * loop is compiled. Anything else - function calls, arrays, pointers,
+ * structs, casts, ?: - leaves the loop to the interpreter. A loop that
+ * can't be compiled is remembered, so it isn't tried again in the same run.
+ *
+ * The results are the ones of the interpreter: integers are computed as
+ * long and kept as int, floating point as double and conditions are
+ * truncated to an integer. A division by zero stops the script.
+ *
+ * The bytecode lives on the picoc stack while the loop runs, it is
+ * compiled again on the next entry of the loop.
+ */
+
+// conditional compilation of the module
+#include "pios.h"
+#ifdef PIOS_INCLUDE_PICOC
+
+#include "openpilot.h"
+#include "picoc_port.h"
+
+#include "picoc.h"
+#include "interpreter.h"
+
+// Private constants
+#define VM_MAX_CODE				384		/* words of bytecode */
+#define VM_MAX_VARS				24		/* variables used by a loop */
+#define VM_MAX_LOCALS			8		/* variables declared in a loop */
+#define VM_MAX_CONSTS			24
+#define VM_MAX_STACK			16
+#define VM_MAX_JUMPS			16		/* break and continue statements of a loop */
+#define VM_MAX_MACRO_DEPTH		4
+#define VM_FAILED_LOOPS			8		/* loops remembered as not compilable */
+#define VM_NO_VAR				0xff
+
+/* integer results are kept as int, like ExpressionPushInt() does */
+#define VM_INT(x)				((long)(int)(x))
+
+enum vm_type {
+	VM_TYPE_INT,
+	VM_TYPE_FP,
+};
+
+enum vm_op {
+	OP_END,
+	OP_CONST_I,		/* const: push a constant */
+	OP_CONST_F,
+	OP_LOAD_I,		/* var: push a variable */
+	OP_LOAD_F,
+	OP_STORE_I,		/* var: assign the top, it stays on the stack */
+	OP_STORE_F,
+	OP_SET_I,		/* var: assign and pop the top */
+	OP_SET_F,
+	OP_INC_I,		/* var, delta: add to a variable */
+	OP_PREINC_I,	/* var, delta: add and push the new value */
+	OP_POSTINC_I,	/* var, delta: add and push the old value */
+	OP_POP,
+	OP_I2F,			/* convert the top */
+	OP_I2F_NEXT,	/* convert the value below the top */
+	OP_F2I,
+	OP_ADD_I, OP_SUB_I, OP_MUL_I, OP_DIV_I, OP_MOD_I,
+	OP_SHL_I, OP_SHR_I, OP_AND_I, OP_OR_I, OP_XOR_I,
+	OP_EQ_I, OP_NE_I, OP_LT_I, OP_GT_I, OP_LE_I, OP_GE_I,
+	OP_NEG_I, OP_NOT_I, OP_INV_I, OP_BOOL_I,
+	OP_ADD_F, OP_SUB_F, OP_MUL_F, OP_DIV_F,
+	OP_EQ_F, OP_NE_F, OP_LT_F, OP_GT_F, OP_LE_F, OP_GE_F,
+	OP_NEG_F, OP_NOT_F,
+	OP_JUMP,		/* target */
+	OP_JZ,			/* target: pop, jump if zero */
+	OP_AND_JUMP,	/* target: jump if zero and keep it, else pop */
+	OP_OR_JUMP,		/* target: jump with 1 if not zero, else pop */
+	OP_LOOP,		/* target: jump back, the time slice is checked */
+};
+
+union vm_slot {
+	long i;
+	double f;
+};
+
+/* a variable declared in the loop */
+struct vm_local {
+	struct Value value;
+	union vm_slot data;
+	const char *name;
+	uint8_t scope;
+};
+
+struct vm_program {
+	uint16_t code[VM_MAX_CODE];
+	struct Value *vars[VM_MAX_VARS];
+	union vm_slot consts[VM_MAX_CONSTS];
+	struct vm_local locals[VM_MAX_LOCALS];
+	union vm_slot stack[VM_MAX_STACK];
+	uint16_t code_len;
+	uint8_t num_vars;
+	uint8_t num_consts;
+	uint8_t num_locals;
+};
+
+/* jumps to patch at the end of a loop */
+struct vm_loop {
+	uint16_t breaks[VM_MAX_JUMPS];
+	uint16_t continues[VM_MAX_JUMPS];
+	uint8_t num_breaks;
+	uint8_t num_continues;
+};
+
+/* something an expression produced, a variable isn't loaded until it is used */
+struct vm_operand {
+	enum vm_type type;
+	uint8_t var;
+};
+
+struct vm_compiler {
+	struct ParseState parser;	/* reads the tokens, a copy of the one of the loop */
+	struct vm_program *prog;
+	struct vm_loop *loop;		/* innermost loop */
+	short int hash_if_level;	/* to notice preprocessor directives */
+	short int hash_if_evaluate_to_level;
+	uint16_t label;				/* last jump target */
+	uint16_t last_op;
+	uint8_t depth;				/* of the stack */
+	uint8_t scope;
+	uint8_t visible[VM_MAX_LOCALS];		/* locals in scope, innermost last */
+	uint8_t num_visible;
+	uint8_t macro_depth;
+};
+
+// Private variables
+static bool bytecode_enabled = true;
+static const unsigned char *failed_loops[VM_FAILED_LOOPS];
+static uint8_t failed_next;
+
+// Private functions
+static bool vm_expression(struct vm_compiler *c, struct vm_operand *result, uint8_t precedence);
+static bool vm_statement(struct vm_compiler *c);
+
+/**
+ * run loops as bytecode, when they can be compiled
+ */
+void picoc_set_bytecode(bool enable)
+{
+	bytecode_enabled = enable;
+}
+
+/**
+ * forget the loops that could not be compiled, the tokens of the next run
+ * are somewhere else
+ */
+void PlatformLoopInit(void)
+{
+	memset(failed_loops, 0, sizeof(failed_loops));
+	failed_next = 0;
+}
+
+/**
+ * look at the next token
+ * returns TokenNone, if it comes with a preprocessor directive
+ */
+static enum LexToken vm_peek(struct vm_compiler *c)
+{
+	enum LexToken token = LexGetToken(&c->parser, NULL, FALSE);
+
+	if (c->parser.HashIfLevel != c->hash_if_level || c->parser.HashIfEvaluateToLevel != c->hash_if_evaluate_to_level)
+		return TokenNone;
+
+	return token;
+}
+
+/**
+ * get the next token
+ * returns TokenNone, if it comes with a preprocessor directive
+ */
+static enum LexToken vm_next(struct vm_compiler *c, struct Value **value)
+{
+	enum LexToken token = LexGetToken(&c->parser, value, TRUE);
+
+	if (c->parser.HashIfLevel != c->hash_if_level || c->parser.HashIfEvaluateToLevel != c->hash_if_evaluate_to_level)
+		return TokenNone;
+
+	return token;
+}
+
+static bool vm_expect(struct vm_compiler *c, enum LexToken token)
+{
+	return vm_next(c, NULL) == token;
+}
+
+/**
+ * emit an operation
+ * stack is how many values it adds to the stack, or removes when negative
+ */
+static bool vm_op(struct vm_compiler *c, enum vm_op op, int8_t stack)
+{
+	struct vm_program *prog = c->prog;
+
+	if (prog->code_len >= VM_MAX_CODE || c->depth + stack > VM_MAX_STACK || c->depth + stack < 0)
+		return false;
+
+	c->last_op = prog->code_len;
+	prog->code[prog->code_len++] = op;
+	c->depth += stack;
+	return true;
+}
+
+/**
+ * emit the argument of an operation
+ */
+static bool vm_arg(struct vm_compiler *c, uint16_t arg)
+{
+	struct vm_program *prog = c->prog;
+
+	if (prog->code_len >= VM_MAX_CODE)
+		return false;
+
+	prog->code[prog->code_len++] = arg;
+	return true;
+}
+
+/**
+ * emit a jump and return where its target goes, for vm_patch()
+ */
+static bool vm_jump(struct vm_compiler *c, enum vm_op op, int8_t stack, uint16_t *at)
+{
+	if (!vm_op(c, op, stack))
+		return false;
+
+	*at = c->prog->code_len;
+	return vm_arg(c, 0);
+}
+
+/**
+ * let a jump go to the next operation
+ */
+static void vm_patch(struct vm_compiler *c, uint16_t at)
+{
+	c->prog->code[at] = c->prog->code_len;
+	c->label = c->prog->code_len;
+}
+
+static bool vm_const(struct vm_compiler *c, enum vm_type type, union vm_slot value)
+{
+	struct vm_program *prog = c->prog;
+
+	if (prog->num_consts >= VM_MAX_CONSTS)
+		return false;
+
+	prog->consts[prog->num_consts] = value;
+	return vm_op(c, type == VM_TYPE_FP ? OP_CONST_F : OP_CONST_I, 1) && vm_arg(c, prog->num_consts++);
+}
+
+static bool vm_const_int(struct vm_compiler *c, long value)
+{
+	union vm_slot slot = { .i = value };
+	return vm_const(c, VM_TYPE_INT, slot);
+}
+
+static bool vm_const_fp(struct vm_compiler *c, double value)
+{
+	union vm_slot slot = { .f = value };
+	return vm_const(c, VM_TYPE_FP, slot);
+}
+
+/**
+ * find the index of a variable, or add it
+ */
+static uint8_t vm_var(struct vm_compiler *c, struct Value *value)
+{
+	struct vm_program *prog = c->prog;
+
+	for (uint8_t i = 0; i < prog->num_vars; i++)
+	{
+		if (prog->vars[i] == value)
+			return i;
+	}
+
+	if (prog->num_vars >= VM_MAX_VARS)
+		return VM_NO_VAR;
+
+	prog->vars[prog->num_vars] = value;
+	return prog->num_vars++;
+}
+
+/**
+ * push an operand that still is a variable
+ */
+static bool vm_value(struct vm_compiler *c, struct vm_operand *operand)
+{
+	if (operand->var == VM_NO_VAR)
+		return true;
+
+	if (!vm_op(c, operand->type == VM_TYPE_FP ? OP_LOAD_F : OP_LOAD_I, 1) || !vm_arg(c, operand->var))
+		return false;
+
+	operand->var = VM_NO_VAR;
+	return true;
+}
+
+/**
+ * push the value of a #define'd constant
+ */
+static bool vm_macro(struct vm_compiler *c, struct Value *macro, struct vm_operand *result)
+{
+	struct ParseState saved;
+	short int hash_if_level = c->hash_if_level;
+	short int hash_if_evaluate_to_level = c->hash_if_evaluate_to_level;
+	bool ok;
+
+	if (macro->Val->MacroDef.NumParams != 0 || c->macro_depth >= VM_MAX_MACRO_DEPTH)
+		return false;
+
+	ParserCopy(&saved, &c->parser);
+	ParserCopy(&c->parser, &macro->Val->MacroDef.Body);
+	c->hash_if_level = c->parser.HashIfLevel;
+	c->hash_if_evaluate_to_level = c->parser.HashIfEvaluateToLevel;
+	c->macro_depth++;
+
+	ok = vm_expression(c, result, 0) && vm_value(c, result) && vm_peek(c) == TokenEndOfFunction;
+
+	c->macro_depth--;
+	c->hash_if_level = hash_if_level;
+	c->hash_if_evaluate_to_level = hash_if_evaluate_to_level;
+	ParserCopy(&c->parser, &saved);
+	return ok;
+}
+
+/**
+ * a variable or a macro by its name
+ */
+static bool vm_identifier(struct vm_compiler *c, const char *name, struct vm_operand *result)
+{
+	Picoc *pc = c->parser.pc;
+	struct Value *value = NULL;
+
+	for (int8_t i = c->num_visible - 1; i >= 0 && value == NULL; i--)
+	{
+		struct vm_local *local = &c->prog->locals[c->visible[i]];
+		if (local->name == name)
+			value = &local->value;
+	}
+
+	if (value == NULL)
+	{
+		if (!VariableDefined(pc, name))
+			return false;
+		VariableGet(pc, &c->parser, name, &value);
+	}
+
+	if (value->Typ->Base == TypeMacro)
+		return vm_macro(c, value, result);
+#ifndef NO_FP
+	else if (value->Typ == &pc->FPType)
+		result->type = VM_TYPE_FP;
+#endif
+	else if (IS_INTEGER_NUMERIC(value))
+		result->type = VM_TYPE_INT;
+	else
+		return false;
+
+	result->var = vm_var(c, value);
+	return result->var != VM_NO_VAR;
+}
+
+/**
+ * add to a variable before or after its value is pushed
+ */
+static bool vm_increment(struct vm_compiler *c, struct vm_operand *operand, enum LexToken token, bool prefix)
+{
+	int16_t delta = token == TokenIncrement ? 1 : -1;
+	uint8_t var = operand->var;
+
+	if (var == VM_NO_VAR || !c->prog->vars[var]->IsLValue)
+		return false;
+
+	operand->var = VM_NO_VAR;
+
+	if (operand->type == VM_TYPE_INT)
+		return vm_op(c, prefix ? OP_PREINC_I : OP_POSTINC_I, 1) && vm_arg(c, var) && vm_arg(c, (uint16_t)delta);
+
+	/* the interpreter has the new value as the result of both */
+	return vm_op(c, OP_LOAD_F, 1) && vm_arg(c, var) &&
+		vm_const_fp(c, 1.0) && vm_op(c, delta > 0 ? OP_ADD_F : OP_SUB_F, -1) &&
+		vm_op(c, OP_STORE_F, 0) && vm_arg(c, var);
+}
+
+/**
+ * a value with its prefix and postfix operators
+ */
+static bool vm_unary(struct vm_compiler *c, struct vm_operand *result)
+{
+	struct Value *value;
+	enum LexToken token = vm_next(c, &value);
+	enum LexToken postfix;
+
+	result->var = VM_NO_VAR;
+	result->type = VM_TYPE_INT;
+
+	switch (token)
+	{
+		case TokenOpenBracket:
+			return vm_expression(c, result, 0) && vm_value(c, result) && vm_expect(c, TokenCloseBracket);
+
+		case TokenIntegerConstant:
+			return vm_const_int(c, value->Val->LongInteger);
+
+		case TokenCharacterConstant:
+			return vm_const_int(c, value->Val->Character);
+
+#ifndef NO_FP
+		case TokenFPConstant:
+			result->type = VM_TYPE_FP;
+			return vm_const_fp(c, value->Val->FP);
+#endif
+
+		case TokenIdentifier:
+			if (!vm_identifier(c, value->Val->Identifier, result))
+				return false;
+			postfix = vm_peek(c);
+			if (postfix == TokenIncrement || postfix == TokenDecrement)
+			{
+				vm_next(c, NULL);
+				return vm_increment(c, result, postfix, false);
+			}
+			return true;
+
+		case TokenIncrement:
+		case TokenDecrement:
+			return vm_unary(c, result) && vm_increment(c, result, token, true);
+
+		case TokenPlus:
+			return vm_unary(c, result) && vm_value(c, result);
+
+		case TokenMinus:
+			if (!vm_unary(c, result) || !vm_value(c, result))
+				return false;
+			return vm_op(c, result->type == VM_TYPE_FP ? OP_NEG_F : OP_NEG_I, 0);
+
+		case TokenUnaryNot:
+			if (!vm_unary(c, result) || !vm_value(c, result))
+				return false;
+			return vm_op(c, result->type == VM_TYPE_FP ? OP_NOT_F : OP_NOT_I, 0);
+
+		case TokenUnaryExor:
+			if (!vm_unary(c, result) || !vm_value(c, result) || result->type != VM_TYPE_INT)
+				return false;
+			return vm_op(c, OP_INV_I, 0);
+
+		default:
+			return false;
+	}
+}
+
+/**
+ * precedence of the infix operators that can be compiled, 0 for the others
+ * same as in the OperatorPrecedence table of the interpreter
+ */
+static uint8_t vm_precedence(enum LexToken token)
+{
+	switch (token)
+	{
+		case TokenAssign: case TokenAddAssign: case TokenSubtractAssign:
+		case TokenMultiplyAssign: case TokenDivideAssign: case TokenModulusAssign:
+		case TokenShiftLeftAssign: case TokenShiftRightAssign: case TokenArithmeticAndAssign:
+		case TokenArithmeticOrAssign: case TokenArithmeticExorAssign:
+			return 2;
+		case TokenLogicalOr:		return 4;
+		case TokenLogicalAnd:		return 5;
+		case TokenArithmeticOr:		return 6;
+		case TokenArithmeticExor:	return 7;
+		case TokenAmpersand:		return 8;
+		case TokenEqual: case TokenNotEqual:
+			return 9;
+		case TokenLessThan: case TokenGreaterThan: case TokenLessEqual: case TokenGreaterEqual:
+			return 10;
+		case TokenShiftLeft: case TokenShiftRight:
+			return 11;
+		case TokenPlus: case TokenMinus:
+			return 12;
+		case TokenAsterisk: case TokenSlash: case TokenModulus:
+			return 13;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * the operation of an infix operator, both values are on the stack
+ */
+static bool vm_binary(struct vm_compiler *c, struct vm_operand *left, const struct vm_operand *right, enum LexToken token)
+{
+	enum vm_op op;
+
+	if (left->type == VM_TYPE_FP || right->type == VM_TYPE_FP)
+	{
+		bool compare = false;
+
+		switch (token)
+		{
+			case TokenPlus:			op = OP_ADD_F; break;
+			case TokenMinus:		op = OP_SUB_F; break;
+			case TokenAsterisk:		op = OP_MUL_F; break;
+			case TokenSlash:		op = OP_DIV_F; break;
+			case TokenEqual:		op = OP_EQ_F; compare = true; break;
+			case TokenNotEqual:		op = OP_NE_F; compare = true; break;
+			case TokenLessThan:		op = OP_LT_F; compare = true; break;
+			case TokenGreaterThan:	op = OP_GT_F; compare = true; break;
+			case TokenLessEqual:	op = OP_LE_F; compare = true; break;
+			case TokenGreaterEqual:	op = OP_GE_F; compare = true; break;
+			default:				return false;
+		}
+
+		if (left->type == VM_TYPE_INT && !vm_op(c, OP_I2F_NEXT, 0))
+			return false;
+		if (right->type == VM_TYPE_INT && !vm_op(c, OP_I2F, 0))
+			return false;
+
+		left->type = compare ? VM_TYPE_INT : VM_TYPE_FP;
+		return vm_op(c, op, -1);
+	}
+
+	switch (token)
+	{
+		case TokenPlus:				op = OP_ADD_I; break;
+		case TokenMinus:			op = OP_SUB_I; break;
+		case TokenAsterisk:			op = OP_MUL_I; break;
+		case TokenSlash:			op = OP_DIV_I; break;
+#ifndef NO_MODULUS
+		case TokenModulus:			op = OP_MOD_I; break;
+#endif
+		case TokenShiftLeft:		op = OP_SHL_I; break;
+		case TokenShiftRight:		op = OP_SHR_I; break;
+		case TokenAmpersand:		op = OP_AND_I; break;
+		case TokenArithmeticOr:		op = OP_OR_I; break;
+		case TokenArithmeticExor:	op = OP_XOR_I; break;
+		case TokenEqual:			op = OP_EQ_I; break;
+		case TokenNotEqual:			op = OP_NE_I; break;
+		case TokenLessThan:			op = OP_LT_I; break;
+		case TokenGreaterThan:		op = OP_GT_I; break;
+		case TokenLessEqual:		op = OP_LE_I; break;
+		case TokenGreaterEqual:		op = OP_GE_I; break;
+		default:					return false;
+	}
+
+	return vm_op(c, op, -1);
+}
+
+/**
+ * an assignment to the variable left, the operator is read
+ */
+static bool vm_assign(struct vm_compiler *c, struct vm_operand *left, enum LexToken token)
+{
+	struct vm_operand right;
+	uint8_t var = left->var;
+	enum LexToken op;
+
+	if (var == VM_NO_VAR || !c->prog->vars[var]->IsLValue)
+		return false;
+
+	switch (token)
+	{
+		case TokenAssign:				op = TokenNone; break;
+		case TokenAddAssign:			op = TokenPlus; break;
+		case TokenSubtractAssign:		op = TokenMinus; break;
+		case TokenMultiplyAssign:		op = TokenAsterisk; break;
+		case TokenDivideAssign:			op = TokenSlash; break;
+		case TokenModulusAssign:		op = TokenModulus; break;
+		case TokenShiftLeftAssign:		op = TokenShiftLeft; break;
+		case TokenShiftRightAssign:		op = TokenShiftRight; break;
+		case TokenArithmeticAndAssign:	op = TokenAmpersand; break;
+		case TokenArithmeticOrAssign:	op = TokenArithmeticOr; break;
+		case TokenArithmeticExorAssign:	op = TokenArithmeticExor; break;
+		default:						return false;
+	}
+
+	if (op == TokenNone)
+	{
+		if (!vm_expression(c, &right, 2) || !vm_value(c, &right))
+			return false;
+	}
+	else
+	{
+		struct vm_operand current = *left;
+
+		if (!vm_value(c, &current) || !vm_expression(c, &right, 2) || !vm_value(c, &right) ||
+				!vm_binary(c, &current, &right, op))
+			return false;
+		right = current;
+	}
+
+	/* the result has the type of the variable */
+	left->var = VM_NO_VAR;
+	if (left->type == VM_TYPE_FP)
+		return (right.type == VM_TYPE_FP || vm_op(c, OP_I2F, 0)) && vm_op(c, OP_STORE_F, 0) && vm_arg(c, var);
+	else
+		return (right.type == VM_TYPE_INT || vm_op(c, OP_F2I, 0)) && vm_op(c, OP_STORE_I, 0) && vm_arg(c, var);
+}
+
+/**
+ * an expression of the operators with at least the given precedence
+ */
+static bool vm_expression(struct vm_compiler *c, struct vm_operand *result, uint8_t precedence)
+{
+	if (!vm_unary(c, result))
+		return false;
+
+	while (true)
+	{
+		enum LexToken token = vm_peek(c);
+		uint8_t token_precedence = vm_precedence(token);
+		struct vm_operand right;
+
+		if (token_precedence == 0 || token_precedence < precedence)
+			return true;
+
+		vm_next(c, NULL);
+
+		if (token_precedence == 2)
+		{
+			/* right to left */
+			if (!vm_assign(c, result, token))
+				return false;
+		}
+		else if (token == TokenLogicalAnd || token == TokenLogicalOr)
+		{
+			uint16_t skip;
+
+			if (!vm_value(c, result) || result->type != VM_TYPE_INT ||
+					!vm_jump(c, token == TokenLogicalAnd ? OP_AND_JUMP : OP_OR_JUMP, -1, &skip) ||
+					!vm_expression(c, &right, token_precedence + 1) || !vm_value(c, &right) ||
+					right.type != VM_TYPE_INT || !vm_op(c, OP_BOOL_I, 0))
+				return false;
+			vm_patch(c, skip);
+		}
+		else
+		{
+			if (!vm_value(c, result) || !vm_expression(c, &right, token_precedence + 1) ||
+					!vm_value(c, &right) || !vm_binary(c, result, &right, token))
+				return false;
+		}
+	}
+}
+
+/**
+ * an expression, that is used as an int like ExpressionParseInt() does
+ */
+static bool vm_condition(struct vm_compiler *c)
+{
+	struct vm_operand operand;
+
+	if (!vm_expression(c, &operand, 0) || !vm_value(c, &operand))
+		return false;
+
+	return operand.type == VM_TYPE_INT || vm_op(c, OP_F2I, 0);
+}
+
+/**
+ * drop the value of an expression statement
+ */
+static bool vm_discard(struct vm_compiler *c, struct vm_operand *operand)
+{
+	uint16_t *last = &c->prog->code[c->last_op];
+
+	if (operand->var != VM_NO_VAR)
+		return true;
+
+	/* fold into the assignment before, unless something jumps here */
+	if (c->label != c->prog->code_len)
+	{
+		switch (*last)
+		{
+			case OP_STORE_I:	*last = OP_SET_I; c->depth--; return true;
+			case OP_STORE_F:	*last = OP_SET_F; c->depth--; return true;
+			case OP_PREINC_I:
+			case OP_POSTINC_I:	*last = OP_INC_I; c->depth--; return true;
+			default:			break;
+		}
+	}
+
+	return vm_op(c, OP_POP, -1);
+}
+
+/**
+ * the tokens a declaration of a numeric variable starts with
+ */
+static bool vm_is_type(enum LexToken token)
+{
+	switch (token)
+	{
+		case TokenIntType:
+		case TokenCharType:
+		case TokenShortType:
+		case TokenLongType:
+		case TokenSignedType:
+		case TokenUnsignedType:
+		case TokenFloatType:
+		case TokenDoubleType:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * the type of a declaration
+ */
+static bool vm_type(struct vm_compiler *c, struct ValueType **type)
+{
+	Picoc *pc = c->parser.pc;
+	enum LexToken token = vm_peek(c);
+	bool is_signed = false;
+	bool is_unsigned = false;
+
+	if (token == TokenSignedType || token == TokenUnsignedType)
+	{
+		is_signed = token == TokenSignedType;
+		is_unsigned = token == TokenUnsignedType;
+		vm_next(c, NULL);
+		token = vm_peek(c);
+	}
+
+	switch (token)
+	{
+		case TokenCharType:
+			*type = is_unsigned ? &pc->UnsignedCharType : &pc->CharType;
+			break;
+		case TokenShortType:
+			*type = is_unsigned ? &pc->UnsignedShortType : &pc->ShortType;
+			break;
+		case TokenLongType:
+			*type = is_unsigned ? &pc->UnsignedLongType : &pc->LongType;
+			break;
+		case TokenIntType:
+			*type = is_unsigned ? &pc->UnsignedIntType : &pc->IntType;
+			break;
+#ifndef NO_FP
+		case TokenFloatType:
+		case TokenDoubleType:
+			if (is_signed || is_unsigned)
+				return false;
+			*type = &pc->FPType;
+			break;
+#endif
+		default:
+			/* a plain signed or unsigned */
+			*type = is_unsigned ? &pc->UnsignedIntType : &pc->IntType;
+			return is_signed || is_unsigned;
+	}
+
+	vm_next(c, NULL);
+
+	/* short int and long int */
+	if ((token == TokenShortType || token == TokenLongType) && vm_peek(c) == TokenIntType)
+		vm_next(c, NULL);
+
+	return true;
+}
+
+/**
+ * a declaration of numeric variables, they only exist in the bytecode
+ */
+static bool vm_declaration(struct vm_compiler *c)
+{
+	struct vm_program *prog = c->prog;
+	struct ValueType *type;
+
+	if (!vm_type(c, &type))
+		return false;
+
+	do
+	{
+		struct vm_local *local;
+		struct vm_operand init;
+		struct Value *value;
+		enum vm_type var_type = VM_TYPE_INT;
+		uint8_t var;
+
+		if (prog->num_locals >= VM_MAX_LOCALS || vm_next(c, &value) != TokenIdentifier)
+			return false;
+
+		local = &prog->locals[prog->num_locals];
+		local->name = value->Val->Identifier;
+		local->scope = c->scope;
+		local->value.Typ = type;
+		local->value.Val = (union AnyValue *)&local->data;
+		local->value.IsLValue = TRUE;
+#ifndef NO_FP
+		if (type == &c->parser.pc->FPType)
+			var_type = VM_TYPE_FP;
+#endif
+
+		var = vm_var(c, &local->value);
+		if (var == VM_NO_VAR)
+			return false;
+
+		if (vm_peek(c) == TokenAssign)
+		{
+			vm_next(c, NULL);
+			if (!vm_expression(c, &init, 2) || !vm_value(c, &init))
+				return false;
+			if (init.type != var_type && !vm_op(c, var_type == VM_TYPE_FP ? OP_I2F : OP_F2I, 0))
+				return false;
+		}
+		else if (!(var_type == VM_TYPE_FP ? vm_const_fp(c, 0.0) : vm_const_int(c, 0)))
+			return false;
+
+		if (!vm_op(c, var_type == VM_TYPE_FP ? OP_SET_F : OP_SET_I, -1) || !vm_arg(c, var))
+			return false;
+
+		/* visible after its initialiser */
+		prog->num_locals++;
+		c->visible[c->num_visible++] = prog->num_locals - 1;
+
+	} while (vm_peek(c) == TokenComma && vm_next(c, NULL) == TokenComma);
+
+	return vm_expect(c, TokenSemicolon);
+}
+
+static void vm_scope_begin(struct vm_compiler *c)
+{
+	c->scope++;
+}
+
+static void vm_scope_end(struct vm_compiler *c)
+{
+	c->scope--;
+	while (c->num_visible > 0 && c->prog->locals[c->visible[c->num_visible - 1]].scope > c->scope)
+		c->num_visible--;
+}
+
+/**
+ * the jumps of break and continue
+ */
+static bool vm_loop_jump(struct vm_compiler *c, enum LexToken token)
+{
+	struct vm_loop *loop = c->loop;
+
+	if (loop == NULL || !vm_expect(c, TokenSemicolon))
+		return false;
+
+	if (token == TokenBreak)
+	{
+		return loop->num_breaks < VM_MAX_JUMPS &&
+			vm_jump(c, OP_JUMP, 0, &loop->breaks[loop->num_breaks++]);
+	}
+	else
+	{
+		return loop->num_continues < VM_MAX_JUMPS &&
+			vm_jump(c, OP_JUMP, 0, &loop->continues[loop->num_continues++]);
+	}
+}
+
+/**
+ * compile the body of a loop, its break and continue jumps are patched after
+ */
+static bool vm_loop_body(struct vm_compiler *c, struct vm_loop *loop)
+{
+	struct vm_loop *outer = c->loop;
+	bool ok;
+
+	memset(loop, 0, sizeof(*loop));
+	c->loop = loop;
+	ok = vm_statement(c);
+	c->loop = outer;
+
+	return ok;
+}
+
+static void vm_patch_continues(struct vm_compiler *c, struct vm_loop *loop)
+{
+	for (uint8_t i = 0; i < loop->num_continues; i++)
+		vm_patch(c, loop->continues[i]);
+}
+
+static void vm_patch_breaks(struct vm_compiler *c, struct vm_loop *loop)
+{
+	for (uint8_t i = 0; i < loop->num_breaks; i++)
+		vm_patch(c, loop->breaks[i]);
+}
+
+/**
+ * a while loop after its '('
+ */
+static bool vm_while(struct vm_compiler *c)
+{
+	struct vm_loop loop;
+	uint16_t start = c->prog->code_len;
+	uint16_t end;
+
+	c->label = start;
+	if (!vm_condition(c) || !vm_expect(c, TokenCloseBracket) || !vm_jump(c, OP_JZ, -1, &end) ||
+			!vm_loop_body(c, &loop))
+		return false;
+
+	for (uint8_t i = 0; i < loop.num_continues; i++)
+		c->prog->code[loop.continues[i]] = start;
+
+	if (!vm_op(c, OP_LOOP, 0) || !vm_arg(c, start))
+		return false;
+
+	vm_patch(c, end);
+	vm_patch_breaks(c, &loop);
+	return true;
+}
+
+/**
+ * a do loop after the 'do'
+ * the ';' after it is only read, when it isn't left to the interpreter
+ */
+static bool vm_do(struct vm_compiler *c, bool semicolon)
+{
+	struct vm_loop loop;
+	uint16_t start = c->prog->code_len;
+	uint16_t end;
+
+	c->label = start;
+	if (!vm_loop_body(c, &loop))
+		return false;
+
+	vm_patch_continues(c, &loop);
+
+	if (!vm_expect(c, TokenWhile) || !vm_expect(c, TokenOpenBracket) || !vm_condition(c) ||
+			!vm_expect(c, TokenCloseBracket) || (semicolon && !vm_expect(c, TokenSemicolon)) ||
+			!vm_jump(c, OP_JZ, -1, &end) || !vm_op(c, OP_LOOP, 0) || !vm_arg(c, start))
+		return false;
+
+	vm_patch(c, end);
+	vm_patch_breaks(c, &loop);
+	return true;
+}
+
+/**
+ * a for loop after its first statement
+ * the increment is written before the body, but runs after it
+ */
+static bool vm_for(struct vm_compiler *c)
+{
+	struct vm_loop loop;
+	struct ParseState increment;
+	struct ParseState after;
+	struct vm_operand operand;
+	uint16_t start = c->prog->code_len;
+	uint16_t end = 0;
+	bool condition = false;
+	int brackets = 0;
+
+	c->label = start;
+	if (vm_peek(c) != TokenSemicolon)
+	{
+		condition = true;
+		if (!vm_condition(c) || !vm_jump(c, OP_JZ, -1, &end))
+			return false;
+	}
+
+	if (!vm_expect(c, TokenSemicolon))
+		return false;
+
+	/* skip the increment */
+	ParserCopy(&increment, &c->parser);
+	while (true)
+	{
+		enum LexToken token = vm_next(c, NULL);
+
+		if (token == TokenOpenBracket)
+			brackets++;
+		else if (token == TokenCloseBracket && brackets-- == 0)
+			break;
+		else if (token == TokenNone || token == TokenEOF || token == TokenSemicolon || token == TokenEndOfFunction)
+			return false;
+	}
+
+	if (!vm_loop_body(c, &loop))
+		return false;
+
+	/* and compile it after the body */
+	ParserCopy(&after, &c->parser);
+	ParserCopy(&c->parser, &increment);
+
+	vm_patch_continues(c, &loop);
+	if (vm_peek(c) != TokenCloseBracket)
+	{
+		if (!vm_expression(c, &operand, 0) || !vm_discard(c, &operand))
+			return false;
+	}
+
+	if (!vm_expect(c, TokenCloseBracket) || !vm_op(c, OP_LOOP, 0) || !vm_arg(c, start))
+		return false;
+
+	ParserCopy(&c->parser, &after);
+
+	if (condition)
+		vm_patch(c, end);
+	vm_patch_breaks(c, &loop);
+	return true;
+}
+
+/**
+ * a statement inside a loop
+ */
+static bool vm_statement(struct vm_compiler *c)
+{
+	enum LexToken token = vm_peek(c);
+	struct vm_operand operand;
+	uint16_t skip, end;
+	bool ok;
+
+	switch (token)
+	{
+		case TokenLeftBrace:
+			vm_next(c, NULL);
+			vm_scope_begin(c);
+			while (vm_peek(c) != TokenRightBrace)
+			{
+				if (!vm_statement(c))
+					return false;
+			}
+			vm_next(c, NULL);
+			vm_scope_end(c);
+			return true;
+
+		case TokenSemicolon:
+			vm_next(c, NULL);
+			return true;
+
+		case TokenIf:
+			vm_next(c, NULL);
+			if (!vm_expect(c, TokenOpenBracket) || !vm_condition(c) || !vm_expect(c, TokenCloseBracket) ||
+					!vm_jump(c, OP_JZ, -1, &skip) || !vm_statement(c))
+				return false;
+
+			if (vm_peek(c) != TokenElse)
+			{
+				vm_patch(c, skip);
+				return true;
+			}
+
+			vm_next(c, NULL);
+			if (!vm_jump(c, OP_JUMP, 0, &end))
+				return false;
+			vm_patch(c, skip);
+			if (!vm_statement(c))
+				return false;
+			vm_patch(c, end);
+			return true;
+
+		case TokenWhile:
+			vm_next(c, NULL);
+			return vm_expect(c, TokenOpenBracket) && vm_while(c);
+
+		case TokenDo:
+			vm_next(c, NULL);
+			return vm_do(c, true);
+
+		case TokenFor:
+			vm_next(c, NULL);
+			if (!vm_expect(c, TokenOpenBracket))
+				return false;
+
+			vm_scope_begin(c);
+			token = vm_peek(c);
+			if (token == TokenSemicolon)
+				ok = vm_next(c, NULL) == TokenSemicolon;
+			else if (vm_is_type(token))
+				ok = vm_declaration(c);
+			else
+				ok = vm_expression(c, &operand, 0) && vm_discard(c, &operand) && vm_expect(c, TokenSemicolon);
+
+			ok = ok && vm_for(c);
+			vm_scope_end(c);
+			return ok;
+
+		case TokenBreak:
+		case TokenContinue:
+			vm_next(c, NULL);
+			return vm_loop_jump(c, token);
+
+		default:
+			if (vm_is_type(token))
+				return vm_declaration(c);
+			return vm_expression(c, &operand, 0) && vm_discard(c, &operand) && vm_expect(c, TokenSemicolon);
+	}
+}
+
+static inline long vm_load_int(struct Value *value)
+{
+	if (value->Typ->Base == TypeInt)
+		return value->Val->Integer;
+
+	return ExpressionCoerceInteger(value);
+}
+
+static inline void vm_store_int(struct Value *value, long x)
+{
+	switch (value->Typ->Base)
+	{
+		case TypeInt:           value->Val->Integer = x; break;
+		case TypeShort:         value->Val->ShortInteger = (short)x; break;
+		case TypeChar:          value->Val->Character = (char)x; break;
+		case TypeLong:          value->Val->LongInteger = (long)x; break;
+		case TypeUnsignedInt:   value->Val->UnsignedInteger = (unsigned int)x; break;
+		case TypeUnsignedShort: value->Val->UnsignedShortInteger = (unsigned short)x; break;
+		case TypeUnsignedLong:  value->Val->UnsignedLongInteger = (unsigned long)x; break;
+		case TypeUnsignedChar:  value->Val->UnsignedCharacter = (unsigned char)x; break;
+		default: break;
+	}
+}
+
+/**
+ * run the bytecode
+ */
+static void vm_run(struct ParseState *Parser, struct vm_program *prog)
+{
+	const uint16_t *code = prog->code;
+	struct Value **vars = prog->vars;
+	union vm_slot *sp = prog->stack - 1;
+	uint16_t ip = 0;
+	struct Value *var;
+	long x;
+
+	while (true)
+	{
+		switch ((enum vm_op)code[ip++])
+		{
+			case OP_END:		return;
+			case OP_CONST_I:	(++sp)->i = prog->consts[code[ip++]].i; break;
+			case OP_CONST_F:	(++sp)->f = prog->consts[code[ip++]].f; break;
+			case OP_LOAD_I:		(++sp)->i = vm_load_int(vars[code[ip++]]); break;
+			case OP_LOAD_F:		(++sp)->f = vars[code[ip++]]->Val->FP; break;
+			case OP_STORE_I:	vm_store_int(vars[code[ip++]], sp->i); sp->i = VM_INT(sp->i); break;
+			case OP_STORE_F:	vars[code[ip++]]->Val->FP = sp->f; break;
+			case OP_SET_I:		vm_store_int(vars[code[ip++]], (sp--)->i); break;
+			case OP_SET_F:		vars[code[ip++]]->Val->FP = (sp--)->f; break;
+			case OP_INC_I:
+				var = vars[code[ip]];
+				vm_store_int(var, vm_load_int(var) + (int16_t)code[ip + 1]);
+				ip += 2;
+				break;
+			case OP_PREINC_I:
+				var = vars[code[ip]];
+				x = vm_load_int(var) + (int16_t)code[ip + 1];
+				vm_store_int(var, x);
+				(++sp)->i = VM_INT(x);
+				ip += 2;
+				break;
+			case OP_POSTINC_I:
+				var = vars[code[ip]];
+				x = vm_load_int(var);
+				vm_store_int(var, x + (int16_t)code[ip + 1]);
+				(++sp)->i = VM_INT(x);
+				ip += 2;
+				break;
+			case OP_POP:		sp--; break;
+			case OP_I2F:		sp->f = (double)sp->i; break;
+			case OP_I2F_NEXT:	sp[-1].f = (double)sp[-1].i; break;
+			case OP_F2I:		sp->i = VM_INT((long)sp->f); break;
+
+			case OP_ADD_I:		sp--; sp->i = VM_INT(sp->i + sp[1].i); break;
+			case OP_SUB_I:		sp--; sp->i = VM_INT(sp->i - sp[1].i); break;
+			case OP_MUL_I:		sp--; sp->i = VM_INT(sp->i * sp[1].i); break;
+			case OP_DIV_I:
+				sp--;
+				if (sp[1].i == 0)
+					ProgramFail(Parser, "division by zero");
+				sp->i = VM_INT(sp->i / sp[1].i);
+				break;
+			case OP_MOD_I:
+				sp--;
+				if (sp[1].i == 0)
+					ProgramFail(Parser, "division by zero");
+				sp->i = VM_INT(sp->i % sp[1].i);
+				break;
+			case OP_SHL_I:		sp--; sp->i = VM_INT(sp->i << sp[1].i); break;
+			case OP_SHR_I:		sp--; sp->i = VM_INT(sp->i >> sp[1].i); break;
+			case OP_AND_I:		sp--; sp->i = VM_INT(sp->i & sp[1].i); break;
+			case OP_OR_I:		sp--; sp->i = VM_INT(sp->i | sp[1].i); break;
+			case OP_XOR_I:		sp--; sp->i = VM_INT(sp->i ^ sp[1].i); break;
+			case OP_EQ_I:		sp--; sp->i = sp->i == sp[1].i; break;
+			case OP_NE_I:		sp--; sp->i = sp->i != sp[1].i; break;
+			case OP_LT_I:		sp--; sp->i = sp->i < sp[1].i; break;
+			case OP_GT_I:		sp--; sp->i = sp->i > sp[1].i; break;
+			case OP_LE_I:		sp--; sp->i = sp->i <= sp[1].i; break;
+			case OP_GE_I:		sp--; sp->i = sp->i >= sp[1].i; break;
+			case OP_NEG_I:		sp->i = VM_INT(-sp->i); break;
+			case OP_NOT_I:		sp->i = !sp->i; break;
+			case OP_INV_I:		sp->i = VM_INT(~sp->i); break;
+			case OP_BOOL_I:		sp->i = sp->i != 0; break;
+
+			case OP_ADD_F:		sp--; sp->f = sp->f + sp[1].f; break;
+			case OP_SUB_F:		sp--; sp->f = sp->f - sp[1].f; break;
+			case OP_MUL_F:		sp--; sp->f = sp->f * sp[1].f; break;
+			case OP_DIV_F:		sp--; sp->f = sp->f / sp[1].f; break;
+			case OP_EQ_F:		sp--; sp->i = sp->f == sp[1].f; break;
+			case OP_NE_F:		sp--; sp->i = sp->f != sp[1].f; break;
+			case OP_LT_F:		sp--; sp->i = sp->f < sp[1].f; break;
+			case OP_GT_F:		sp--; sp->i = sp->f > sp[1].f; break;
+			case OP_LE_F:		sp--; sp->i = sp->f <= sp[1].f; break;
+			case OP_GE_F:		sp--; sp->i = sp->f >= sp[1].f; break;
+			case OP_NEG_F:		sp->f = -sp->f; break;
+			case OP_NOT_F:		sp->f = !sp->f; break;
+
+			case OP_JUMP:		ip = code[ip]; break;
+			case OP_JZ:			ip = (sp--)->i ? ip + 1 : code[ip]; break;
+			case OP_AND_JUMP:
+				if (sp->i == 0)
+					ip = code[ip];
+				else
+				{
+					sp--;
+					ip++;
+				}
+				break;
+			case OP_OR_JUMP:
+				if (sp->i != 0)
+				{
+					sp->i = 1;
+					ip = code[ip];
+				}
+				else
+				{
+					sp--;
+					ip++;
+				}
+				break;
+			case OP_LOOP:
+				if (Parser->DebugMode)
+					DebugCheckStatement(Parser);
+				ip = code[ip];
+				break;
+		}
+	}
+}
+
+/**
+ * run a loop, that starts at the parser, as bytecode
+ * Loop is the keyword of the loop. A while loop starts after its '(', a do
+ * loop after the 'do' and a for loop after its first statement.
+ * returns TRUE if the loop ran and the parser is behind it
+ */
+int PlatformRunLoop(struct ParseState *Parser, enum LexToken Loop)
+{
+	Picoc *pc = Parser->pc;
+	struct vm_compiler c;
+	bool ok;
+
+	if (!bytecode_enabled || Parser->Mode != RunModeRun || Parser->FileName == pc->StrEmpty)
+		return FALSE;
+
+	for (uint8_t i = 0; i < VM_FAILED_LOOPS; i++)
+	{
+		if (failed_loops[i] == Parser->Pos)
+			return FALSE;
+	}
+
+	memset(&c, 0, sizeof(c));
+	c.prog = HeapAllocStack(pc, sizeof(struct vm_program));
+	if (c.prog == NULL)
+		return FALSE;
+
+	ParserCopy(&c.parser, Parser);
+	c.hash_if_level = Parser->HashIfLevel;
+	c.hash_if_evaluate_to_level = Parser->HashIfEvaluateToLevel;
+
+	switch (Loop)
+	{
+		case TokenWhile:	ok = vm_while(&c); break;
+		case TokenDo:		ok = vm_do(&c, false); break;
+		case TokenFor:		ok = vm_for(&c); break;
+		default:			ok = false; break;
+	}
+
+	ok = ok && vm_op(&c, OP_END, 0);
+
+	if (ok)
+	{
+		vm_run(Parser, c.prog);
+		ParserCopyPos(Parser, &c.parser);
+	}
+	else
+	{
+		failed_loops[failed_next] = Parser->Pos;
+		failed_next = (failed_next + 1) % VM_FAILED_LOOPS;
+	}
+
+	HeapPopStack(pc, c.prog, sizeof(struct vm_program));
+	return ok;
+}
+
+#endif /* PIOS_INCLUDE_PICOC */
+
+/**
+ * @}
+ * @}
+ */
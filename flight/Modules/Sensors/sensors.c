@@ -49,6 +49,7 @@
 #include "magnetometer.h"
 #include "magbias.h"
 #include "coordinate_conversions.h"
+#include "rotation_math.h"
 
 // Private constants
 #define STACK_SIZE_BYTES 1000
@@ -205,6 +206,8 @@ static void SensorsTask(void *parameters)
 			continue;
 		}
 
+		PIOS_Trace(PIOS_TRACE_SENSORS_START, 0);
+
 		queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_ACCEL);
 		if (queue == NULL || PIOS_Queue_Receive(queue, &accels, 0) == false) {
 			//If no new accels data is ready, reuse the latest sample
@@ -252,6 +255,8 @@ static void SensorsTask(void *parameters)
 		
 		PIOS_WDG_UpdateFlag(PIOS_WDG_SENSORS);
 
+		PIOS_Trace(PIOS_TRACE_SENSORS_END, 0);
+
 		// Check total time to get the sensors wasn't over the limit
 		uint32_t dT_us = PIOS_DELAY_DiffuS(timeval);
 		if (dT_us > (SENSOR_PERIOD * 1000))
@@ -266,23 +271,17 @@ static void SensorsTask(void *parameters)
  */
 static void update_accels(struct pios_sensor_accel_data *accels)
 {
-	// Average and scale the accels before rotation
-	float accels_out[3] = {
-	    accels->x * accel_scale[0] - accel_bias[0],
-	    accels->y * accel_scale[1] - accel_bias[1],
-	    accels->z * accel_scale[2] - accel_bias[2]
-	};
-
 	if (rotate) {
+		// Scale, remove the bias and rotate in one pass
 		float accel_rotated[3];
-		rot_mult(Rsb, accels_out, accel_rotated, true);
+		rot_mult_scale_bias(Rsb, &accels->x, accel_scale, accel_bias, accel_rotated, true);
 		accelsData.x = accel_rotated[0];
 		accelsData.y = accel_rotated[1];
 		accelsData.z = accel_rotated[2];
 	} else {
-		accelsData.x = accels_out[0];
-		accelsData.y = accels_out[1];
-		accelsData.z = accels_out[2];
+		accelsData.x = accels->x * accel_scale[0] - accel_bias[0];
+		accelsData.y = accels->y * accel_scale[1] - accel_bias[1];
+		accelsData.z = accels->z * accel_scale[2] - accel_bias[2];
 	}
 
 	accelsData.z += z_accel_offset;
@@ -356,23 +355,17 @@ static void update_gyros(struct pios_sensor_gyro_data *gyros)
  */
 static void update_mags(struct pios_sensor_mag_data *mag)
 {
-	float mags[3] = {
-	    mag->x * mag_scale[0] - mag_bias[0],
-	    mag->y * mag_scale[1] - mag_bias[1],
-	    mag->z * mag_scale[2] - mag_bias[2]
-	};
-
 	MagnetometerData magData;
 	if (rotate) {
 		float mag_out[3];
-		rot_mult(Rsb, mags, mag_out, true);
+		rot_mult_scale_bias(Rsb, &mag->x, mag_scale, mag_bias, mag_out, true);
 		magData.x = mag_out[0];
 		magData.y = mag_out[1];
 		magData.z = mag_out[2];
 	} else {
-		magData.x = mags[0];
-		magData.y = mags[1];
-		magData.z = mags[2];
+		magData.x = mag->x * mag_scale[0] - mag_bias[0];
+		magData.y = mag->y * mag_scale[1] - mag_bias[1];
+		magData.z = mag->z * mag_scale[2] - mag_bias[2];
 	}
 
 	// Correct for mag bias and update if the rate is non zero
@@ -438,12 +431,12 @@ static void updateTemperatureComp(float temperature, float *temp_bias)
 		temp_counter = 0;
 
 		// Compute a third order polynomial for each chanel after each 500 samples
-		temp_bias[0] = gyro_coeff_x[0] + gyro_coeff_x[1] * t + 
-		               gyro_coeff_x[2] * powf(t,2) + gyro_coeff_x[3] * powf(t,3);
-		temp_bias[1] = gyro_coeff_y[0] + gyro_coeff_y[1] * t + 
-		               gyro_coeff_y[2] * powf(t,2) + gyro_coeff_y[3] * powf(t,3);
-		temp_bias[2] = gyro_coeff_z[0] + gyro_coeff_z[1] * t + 
-		               gyro_coeff_z[2] * powf(t,2) + gyro_coeff_z[3] * powf(t,3);
+		temp_bias[0] = gyro_coeff_x[0] + t * (gyro_coeff_x[1] +
+		               t * (gyro_coeff_x[2] + t * gyro_coeff_x[3]));
+		temp_bias[1] = gyro_coeff_y[0] + t * (gyro_coeff_y[1] +
+		               t * (gyro_coeff_y[2] + t * gyro_coeff_y[3]));
+		temp_bias[2] = gyro_coeff_z[0] + t * (gyro_coeff_z[1] +
+		               t * (gyro_coeff_z[2] + t * gyro_coeff_z[3]));
 	}
 }
 
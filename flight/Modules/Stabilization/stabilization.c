@@ -213,7 +213,9 @@ static void stabilizationTask(void* parameters)
 			AlarmsSet(SYSTEMALARMS_ALARM_STABILIZATION,SYSTEMALARMS_ALARM_WARNING);
 			continue;
 		}
-		
+
+		PIOS_Trace(PIOS_TRACE_STABILIZATION_START, 0);
+
 		calculate_pids();
 
 		float dT = PIOS_DELAY_DiffuS(timeval) * 1.0e-6f;
@@ -782,6 +784,8 @@ static void stabilizationTask(void* parameters)
 			AlarmsSet(SYSTEMALARMS_ALARM_STABILIZATION,SYSTEMALARMS_ALARM_ERROR);
 		else
 			AlarmsClear(SYSTEMALARMS_ALARM_STABILIZATION);
+
+		PIOS_Trace(PIOS_TRACE_STABILIZATION_END, 0);
 	}
 }
 
@@ -33,6 +33,7 @@
 #include "systemmod.h"
 #include "sanitycheck.h"
 #include "objectpersistence.h"
+#include "poolstats.h"
 #include "flightstatus.h"
 #include "manualcontrolsettings.h"
 #include "rfm22bstatus.h"
@@ -43,8 +44,12 @@
 #include "taskinfo.h"
 #include "watchdogstatus.h"
 #include "taskmonitor.h"
+#if defined(PIOS_INCLUDE_TRACE)
+#include "tracebuffer.h"
+#endif
 #include "pios_thread.h"
 #include "pios_queue.h"
+#include "pios_mempool.h"
 
 //#define DEBUG_THIS_FILE
 
@@ -90,6 +95,7 @@ static void configurationUpdatedCb(UAVObjEvent * ev);
 
 static bool indicateError();
 static void updateStats();
+static void updatePoolStats();
 static void updateSystemAlarms();
 static void systemTask(void *parameters);
 static void updateRfm22bStats();
@@ -122,14 +128,21 @@ int32_t SystemModInitialize(void)
 	// Must registers objects here for system thread because ObjectManager started in OpenPilotInit
 	SystemSettingsInitialize();
 	SystemStatsInitialize();
+	PoolStatsInitialize();
 	FlightStatusInitialize();
 	ObjectPersistenceInitialize();
 #if defined(DIAG_TASKS)
 	TaskInfoInitialize();
 #endif
+#if defined(DIAG_TASK_PROFILE)
+	TaskProfileInitialize();
+#endif
 #if defined(WDG_STATS_DIAGNOSTICS)
 	WatchdogStatusInitialize();
 #endif
+#if defined(PIOS_INCLUDE_TRACE)
+	TraceBufferInitialize();
+#endif
 
 	objectPersistenceQueue = PIOS_Queue_Create(1, sizeof(UAVObjEvent));
 	if (objectPersistenceQueue == NULL)
@@ -188,10 +201,18 @@ static void systemTask(void *parameters)
 #endif
 #endif
 
+	// The modules allocated what they need in their initialization and
+	// start functions and the tasks of a higher priority than this one
+	// already ran up to their first wait. From here on event connections,
+	// queues and instances come from the pools and any heap allocation is
+	// counted as late.
+	PIOS_heap_lock();
+
 	// Main system loop
 	while (1) {
 		// Update the system statistics
 		updateStats();
+		updatePoolStats();
 
 		// Update the modem status, if present
 		updateRfm22bStats();
@@ -492,6 +513,30 @@ static void updateStats()
 	SystemStatsSet(&stats);
 }
 
+/**
+ * Called periodically to update the pool usage
+ */
+static void updatePoolStats()
+{
+	struct pios_mempool_stats pools[POOLSTATS_INUSE_NUMELEM];
+	PoolStatsData stats;
+
+	UAVObjGetPoolStats(&pools[POOLSTATS_INUSE_OBJECTEVENTS]);
+	EventGetPoolStats(&pools[POOLSTATS_INUSE_PERIODICEVENTS]);
+	PIOS_Queue_GetPoolStats(&pools[POOLSTATS_INUSE_QUEUES]);
+
+	for (int i = 0; i < POOLSTATS_INUSE_NUMELEM; i++) {
+		stats.BlockSize[i] = pools[i].block_size;
+		stats.Blocks[i] = pools[i].blocks;
+		stats.InUse[i] = pools[i].in_use;
+		stats.HighWater[i] = pools[i].high_water;
+		stats.Failures[i] = pools[i].failures;
+	}
+	stats.LateAllocations = PIOS_heap_get_late_allocations();
+
+	PoolStatsSet(&stats);
+}
+
 /**
  * Update system alarms
  */
@@ -32,9 +32,11 @@
 #include "flighttelemetrystats.h"
 #include "gcstelemetrystats.h"
 #include "modulesettings.h"
+#include "objecthashes.h"
 #include "sessionmanaging.h"
 #include "pios_thread.h"
 #include "pios_queue.h"
+#include "pios_mutex.h"
 
 // Private constants
 #define MAX_QUEUE_SIZE   TELEM_QUEUE_SIZE
@@ -47,8 +49,17 @@
 #define STATS_UPDATE_PERIOD_MS 4000
 #define CONNECTION_TIMEOUT_MS 8000
 #define PAUSE_PERIODIC_UPDATE_TIMEOUT 6000
+#define FIELD_UPDATE_REFRESH_MS 1000
+#define FIELD_UPDATE_MAX_PENDING 8
 // Private types
 
+//! An object instance sent with field updates since its last full update
+struct field_update_pending {
+	UAVObjHandle obj;
+	uint16_t instId;
+	uint32_t since;
+};
+
 // Private variables
 static uintptr_t telemetryPort;
 static struct pios_queue *queue;
@@ -69,6 +80,9 @@ static uint32_t timeOfLastObjectUpdate;
 static UAVTalkConnection uavTalkCon;
 static bool pausePeriodicUpdates;
 static uint32_t pausePeriodicUpdatesTime;
+static bool fieldUpdatesEnabled;
+static struct pios_mutex *fieldUpdatesLock;
+static struct field_update_pending fieldUpdatesPending[FIELD_UPDATE_MAX_PENDING];
 // Private functions
 static void telemetryTxTask(void *parameters);
 static void telemetryRxTask(void *parameters);
@@ -84,6 +98,10 @@ static uintptr_t getComPort();
 static void session_managing_updated(UAVObjEvent * ev);
 static void update_object_instances(uint32_t obj_id, uint32_t inst_id);
 static void check_pause_periodic_updates_timeout();
+static void sendObjectHashes();
+static bool startFieldUpdate(UAVObjEvent *ev, UAVObjMetadata *metadata);
+static void endFieldUpdates(UAVObjHandle obj, uint16_t instId);
+static void refreshFieldUpdates();
 
 /**
  * Initialise the telemetry module
@@ -97,6 +115,7 @@ int32_t TelemetryStart(void)
     
 	// Listen to objects of interest
 	GCSTelemetryStatsConnectQueue(priorityQueue);
+	UAVObjConnectQueue(ObjectHashesHandle(), priorityQueue, EV_UNPACKED);
     
 	// Start telemetry tasks
 	telemetryTxTaskHandle = PIOS_Thread_Create(telemetryTxTask, "TelTx", STACK_SIZE_BYTES, NULL, TASK_PRIORITY_TX);
@@ -124,6 +143,7 @@ int32_t TelemetryInitialize(void)
 
 	// Initialize vars
 	timeOfLastObjectUpdate = 0;
+	fieldUpdatesLock = PIOS_Mutex_Create();
 
 	// Create object queues
 	queue = PIOS_Queue_Create(MAX_QUEUE_SIZE, sizeof(UAVObjEvent));
@@ -147,6 +167,7 @@ int32_t TelemetryInitialize(void)
 
 	SessionManagingInitialize();
 	SessionManagingConnectCallback(session_managing_updated);
+	ObjectHashesInitialize();
 
 	//register the new uavo instance callback function in the uavobjectmanager
 	UAVObjRegisterNewInstanceCB(update_object_instances);
@@ -276,6 +297,8 @@ static void processObjEvent(UAVObjEvent * ev)
 		updateTelemetryStats();
 	} else if (ev->obj == GCSTelemetryStatsHandle()) {
 		gcsTelemetryStatsUpdated();
+	} else if (ev->obj == ObjectHashesHandle()) {
+		sendObjectHashes();
 	} else {
 		FlightTelemetryStatsGet(&flightStats);
 		// Get object metadata
@@ -293,8 +316,14 @@ static void processObjEvent(UAVObjEvent * ev)
 			while (retries < MAX_RETRIES && success == -1) {
 				if((ev->obj !=FlightTelemetryStatsHandle()) && (ev->event == EV_UPDATED_PERIODIC) && pausePeriodicUpdates) {
 					success = 0;
+				} else if (retries == 0 && startFieldUpdate(ev, &metadata)) {
+					// Only some fields changed and sending them is smaller than the object
+					success = UAVTalkSendObjectFields(uavTalkCon, ev->obj, ev->instId, ev->dataOffset, ev->dataSize);
 				} else {
+					// A retry sends the whole object, so a failed field update isn't lost
 					success = UAVTalkSendObject(uavTalkCon, ev->obj, ev->instId, UAVObjGetTelemetryAcked(&metadata), REQ_TIMEOUT_MS);	// call blocks until ack is received or timeout
+					if (success == 0)
+						endFieldUpdates(ev->obj, ev->instId);
 				}
 				++retries;
 			}
@@ -329,6 +358,8 @@ static void processObjEvent(UAVObjEvent * ev)
 						success = 0;
 					} else {
 						success = UAVTalkSendObject(uavTalkCon, ev->obj, ev->instId, UAVObjGetTelemetryAcked(&metadata), REQ_TIMEOUT_MS);	// call blocks until ack is received or timeout
+						if (success == 0)
+							endFieldUpdates(ev->obj, ev->instId);
 					}
 					++retries;
 				}
@@ -349,6 +380,8 @@ static void processObjEvent(UAVObjEvent * ev)
 			}
 		}
 	}
+
+	refreshFieldUpdates();
 }
 
 /**
@@ -539,6 +572,10 @@ static void updateTelemetryStats()
 		flightStats.Status = FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED;
 	}
 
+	// Field updates only go to a GCS that announced it understands them
+	fieldUpdatesEnabled = (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED &&
+			gcsStats.PartialUpdates == GCSTELEMETRYSTATS_PARTIALUPDATES_TRUE);
+
 	// Update the telemetry alarm
 	if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
 		AlarmsClear(SYSTEMALARMS_ALARM_TELEMETRY);
@@ -671,6 +708,197 @@ static void check_pause_periodic_updates_timeout()
 		pausePeriodicUpdates = false;
 	}
 }
+
+/**
+ * Check whether an update can be sent as a field update and remember that
+ * the instance then owes the GCS a full update.
+ *
+ * Field updates aren't acked, if one is lost the GCS copy stays stale until
+ * the object is sent again. So every instance sent with field updates gets
+ * a full update at most FIELD_UPDATE_REFRESH_MS later, and when no more
+ * instances can be tracked the whole object is sent right away.
+ * \param[in] ev The update event
+ * \param[in] metadata The metadata of the object
+ * \return true if the field update can be sent
+ */
+static bool startFieldUpdate(UAVObjEvent *ev, UAVObjMetadata *metadata)
+{
+	if (!fieldUpdatesEnabled || ev->event != EV_UPDATED || ev->dataSize == 0 ||
+			(ev->dataSize + 2) >= UAVObjGetNumBytes(ev->obj) ||
+			UAVObjGetTelemetryAcked(metadata))
+		return false;
+
+	struct field_update_pending *free_entry = NULL;
+	bool tracked = false;
+
+	PIOS_Mutex_Lock(fieldUpdatesLock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	for (uint8_t i = 0; i < FIELD_UPDATE_MAX_PENDING; i++) {
+		struct field_update_pending *entry = &fieldUpdatesPending[i];
+
+		if (entry->obj == ev->obj && entry->instId == ev->instId) {
+			tracked = true;
+			break;
+		} else if (entry->obj == NULL && free_entry == NULL) {
+			free_entry = entry;
+		}
+	}
+
+	if (!tracked && free_entry != NULL) {
+		free_entry->obj = ev->obj;
+		free_entry->instId = ev->instId;
+		free_entry->since = PIOS_Thread_Systime();
+		tracked = true;
+	}
+
+	PIOS_Mutex_Unlock(fieldUpdatesLock);
+
+	return tracked;
+}
+
+/**
+ * The whole object was sent, the GCS is in sync with it again
+ * \param[in] obj The object
+ * \param[in] instId The instance sent or UAVOBJ_ALL_INSTANCES
+ */
+static void endFieldUpdates(UAVObjHandle obj, uint16_t instId)
+{
+	PIOS_Mutex_Lock(fieldUpdatesLock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	for (uint8_t i = 0; i < FIELD_UPDATE_MAX_PENDING; i++) {
+		struct field_update_pending *entry = &fieldUpdatesPending[i];
+
+		if (entry->obj == obj && (instId == UAVOBJ_ALL_INSTANCES || entry->instId == instId))
+			entry->obj = NULL;
+	}
+
+	PIOS_Mutex_Unlock(fieldUpdatesLock);
+}
+
+/**
+ * Send the whole object for the instances that were sent with field
+ * updates more than FIELD_UPDATE_REFRESH_MS ago
+ */
+static void refreshFieldUpdates()
+{
+	uint32_t now = PIOS_Thread_Systime();
+
+	// A GCS connecting again fetches all objects anyway
+	if (!fieldUpdatesEnabled) {
+		PIOS_Mutex_Lock(fieldUpdatesLock, PIOS_MUTEX_TIMEOUT_MAX);
+		memset(fieldUpdatesPending, 0, sizeof(fieldUpdatesPending));
+		PIOS_Mutex_Unlock(fieldUpdatesLock);
+		return;
+	}
+
+	for (uint8_t i = 0; i < FIELD_UPDATE_MAX_PENDING; i++) {
+		struct field_update_pending *entry = &fieldUpdatesPending[i];
+		UAVObjHandle obj;
+		uint16_t instId;
+		uint32_t since;
+
+		// Release the entry before sending, so field updates sent meanwhile
+		// get a refresh of their own
+		PIOS_Mutex_Lock(fieldUpdatesLock, PIOS_MUTEX_TIMEOUT_MAX);
+		obj = entry->obj;
+		instId = entry->instId;
+		since = entry->since;
+		if (obj != NULL && (now - since) >= FIELD_UPDATE_REFRESH_MS)
+			entry->obj = NULL;
+		else
+			obj = NULL;
+		PIOS_Mutex_Unlock(fieldUpdatesLock);
+
+		if (obj == NULL)
+			continue;
+
+		if (UAVTalkSendObject(uavTalkCon, obj, instId, false, 0) != 0) {
+			// Try again with the next event if the entry is still free
+			++txErrors;
+			PIOS_Mutex_Lock(fieldUpdatesLock, PIOS_MUTEX_TIMEOUT_MAX);
+			if (entry->obj == NULL) {
+				entry->obj = obj;
+				entry->instId = instId;
+				entry->since = since;
+			}
+			PIOS_Mutex_Unlock(fieldUpdatesLock);
+		}
+	}
+}
+
+//! Page of the object hashes being filled by sendObjectHashes()
+static ObjectHashesData hashesPage;
+static uint16_t hashesSkip;
+static uint8_t hashesEntry;
+static uint16_t hashesCount;
+
+//! Whether the hash of an object is sent, data objects change all the time
+static bool isHashed(UAVObjHandle obj)
+{
+	return UAVObjIsMetaobject(obj) || UAVObjIsSettings(obj);
+}
+
+//! Count the hashed objects, for UAVObjIterate()
+static void countObjectHash(UAVObjHandle obj)
+{
+	if (isHashed(obj))
+		hashesCount++;
+}
+
+/**
+ * Add the hash of an object to the page, for UAVObjIterate(). Skips the
+ * entries of the pages already sent and stops when the page is full.
+ */
+static void addObjectHash(UAVObjHandle obj)
+{
+	if (!isHashed(obj))
+		return;
+
+	if (hashesSkip > 0) {
+		hashesSkip--;
+		return;
+	}
+
+	if (hashesEntry >= OBJECTHASHES_OBJECTID_NUMELEM)
+		return;
+
+	hashesPage.ObjectID[hashesEntry] = UAVObjGetID(obj);
+	hashesPage.Hash[hashesEntry] = UAVObjGetHash(obj);
+	hashesEntry++;
+}
+
+/**
+ * Send the hashes of all settings and metaobjects in pages. The GCS
+ * fetches the data objects anyway.
+ * Called when the GCS updates the ObjectHashes object.
+ *
+ * UAVObjIterate() holds the object manager lock, which the receive task
+ * takes after the UAVTalk connection lock. So each page is only collected
+ * while iterating and sent after it returns.
+ */
+static void sendObjectHashes()
+{
+	memset(&hashesPage, 0, sizeof(hashesPage));
+	PIOS_SYS_SerialNumberGetBinary(hashesPage.CPUSerial);
+	hashesCount = 0;
+
+	UAVObjIterate(&countObjectHash);
+	hashesPage.NumberOfPages = (hashesCount + OBJECTHASHES_OBJECTID_NUMELEM - 1) / OBJECTHASHES_OBJECTID_NUMELEM;
+
+	for (uint8_t page = 0; page < hashesPage.NumberOfPages; page++) {
+		hashesPage.Page = page;
+		memset(hashesPage.ObjectID, 0, sizeof(hashesPage.ObjectID));
+		memset(hashesPage.Hash, 0, sizeof(hashesPage.Hash));
+		hashesSkip = page * OBJECTHASHES_OBJECTID_NUMELEM;
+		hashesEntry = 0;
+
+		UAVObjIterate(&addObjectHash);
+
+		ObjectHashesSet(&hashesPage);
+		UAVTalkSendObject(uavTalkCon, ObjectHashesHandle(), 0, false, 0);
+	}
+}
+
 /**
   * @}
   * @}
@@ -44,6 +44,7 @@
 #include "velocityactual.h"
 #include "attitudeactual.h"
 #include "pios_thread.h"
+#include "link_scheduler.h"
 
 #if defined(PIOS_INCLUDE_FRSKY_SENSOR_HUB)
 // ****************
@@ -109,7 +110,10 @@ static void frsky_write_userdata_byte(uint8_t byte,
 		uint8_t *serial_buf,
 		uint8_t *index);
 
-static bool frame_trigger(uint8_t frame_num);
+static uint16_t frsky_pack_vario_frame(uint8_t *serial_buf, uint16_t buf_len);
+static uint16_t frsky_pack_battery_frame(uint8_t *serial_buf, uint16_t buf_len);
+static uint16_t frsky_pack_gps_frame(uint8_t *serial_buf, uint16_t buf_len);
+
 // ****************
 // Private constants
 
@@ -120,7 +124,7 @@ static bool frame_trigger(uint8_t frame_num);
 #endif
 
 #define TASK_PRIORITY               PIOS_THREAD_PRIO_LOW
-#define TASK_RATE_HZ 10
+#define TASK_RATE_HZ 50
 
 #define FRSKY_MAX_PACKET_LEN 106
 #define FRSKY_BAUD_RATE 9600
@@ -160,20 +164,21 @@ enum FRSKY_VALUE_ID {
 	FRSKY_CURRENT = 0x28,
 };
 
-enum FRSKY_FRAME {
-	FRSKY_FRAME_VARIO,
-	FRSKY_FRAME_BATTERY,
-	FRSKY_FRAME_GPS
+/*
+ * The frames with their rate, a priority for when the link can't carry
+ * all of them and their typical length
+ */
+static const struct {
+	link_sched_pack pack;
+	uint16_t period_ms;
+	uint8_t priority;
+	uint16_t size;
+} frsky_frames[] = {
+	{ frsky_pack_vario_frame,   200, 4, 26 },  //5Hz
+	{ frsky_pack_battery_frame, 200, 2, 40 },  //5Hz
+	{ frsky_pack_gps_frame,    1000, 2, 80 },  //1Hz
 };
 
-static const uint8_t frsky_rates[] = {
-	[FRSKY_FRAME_VARIO] = 0x05, //5Hz
-	[FRSKY_FRAME_BATTERY] = 0x05, //5Hz
-	[FRSKY_FRAME_GPS] = 0x01	//1Hz
-}; 
-
-#define MAXSTREAMS sizeof(frsky_rates)
-
 
 // ****************
 // Private variables
@@ -184,9 +189,15 @@ static uint32_t frsky_port;
 
 static bool module_enabled;
 
-static uint8_t *frame_ticks;
+static struct link_sched *link_sched;
 
-static uint8_t *serial_buf;
+static FlightBatterySettingsData batSettings;
+static FlightBatteryStateData batState;
+static GPSPositionData gpsPosData;
+static BaroAltitudeData baroAltitude;
+static float accX, accY, accZ;
+static uint8_t last_armed = FLIGHTSTATUS_ARMED_DISARMED;
+static float altitude_offset;
 
 /**
  * Start the module
@@ -223,16 +234,13 @@ static int32_t uavoFrSKYSensorHubBridgeInitialize(void)
 					== MODULESETTINGS_ADMINSTATE_ENABLED)) {
 		PIOS_COM_ChangeBaud(frsky_port, FRSKY_BAUD_RATE);
 
-		serial_buf = PIOS_malloc(FRSKY_MAX_PACKET_LEN);
-		if (serial_buf == 0)
+		link_sched = link_sched_create(frsky_port, NELEMENTS(frsky_frames), FRSKY_MAX_PACKET_LEN);
+		if (link_sched == NULL)
 			return -1;
 
-		frame_ticks = PIOS_malloc(MAXSTREAMS);
-		if (frame_ticks == 0)
-			return -1;
-
-		for (int x = 0; x < MAXSTREAMS; ++x) {
-			frame_ticks[x] = (TASK_RATE_HZ / frsky_rates[x]);
+		for (int x = 0; x < NELEMENTS(frsky_frames); ++x) {
+			link_sched_add(link_sched, frsky_frames[x].pack, frsky_frames[x].period_ms,
+					frsky_frames[x].priority, frsky_frames[x].size);
 		}
 
 		module_enabled = true;
@@ -251,13 +259,6 @@ MODULE_INITCALL(uavoFrSKYSensorHubBridgeInitialize, uavoFrSKYSensorHubBridgeStar
  */
 static void uavoFrSKYSensorHubBridgeTask(void *parameters)
 {
-	FlightBatterySettingsData batSettings;
-	FlightBatteryStateData batState;
-	GPSPositionData gpsPosData;
-	BaroAltitudeData baroAltitude;
-	FlightStatusData flightStatus;
-	float accX = 0, accY = 0, accZ = 0;
-
 	if (FlightBatterySettingsHandle() != NULL )
 		FlightBatterySettingsGet(&batSettings);
 	else {
@@ -295,10 +296,6 @@ static void uavoFrSKYSensorHubBridgeTask(void *parameters)
 		batState.Voltage = 0;
 	}
 
-	uint8_t last_armed = FLIGHTSTATUS_ARMED_DISARMED;
-	float altitude_offset = 0.0f;
-
-	uint16_t msg_length = 0;
 	uint32_t lastSysTime;
 
 	// Main task loop
@@ -307,247 +304,243 @@ static void uavoFrSKYSensorHubBridgeTask(void *parameters)
 	while (1) {
 		PIOS_Thread_Sleep_Until(&lastSysTime, 1000 / TASK_RATE_HZ);
 
-		if (frame_trigger(FRSKY_FRAME_VARIO)) {
-			msg_length = 0;
-
-			uint8_t accelDataSettings;
-			ModuleSettingsFrskyAccelDataGet(&accelDataSettings);
-			switch(accelDataSettings) {
-			case MODULESETTINGS_FRSKYACCELDATA_ACCELS: {
-				if (AccelsHandle() != NULL) {
-					AccelsxGet(&accX);
-					AccelsyGet(&accY);
-					AccelszGet(&accZ);
-				}
-				break;
-			}
+		link_sched_run(link_sched, PIOS_Thread_Systime());
+	}
+}
+
+/**
+ * Writes the accelerations and the altitude
+ * \return number of bytes written to the buffer
+ */
+static uint16_t frsky_pack_vario_frame(uint8_t *serial_buf, uint16_t buf_len)
+{
+	FlightStatusData flightStatus;
+	uint16_t msg_length = 0;
+
+	uint8_t accelDataSettings;
+	ModuleSettingsFrskyAccelDataGet(&accelDataSettings);
+	switch(accelDataSettings) {
+	case MODULESETTINGS_FRSKYACCELDATA_ACCELS: {
+		if (AccelsHandle() != NULL) {
+			AccelsxGet(&accX);
+			AccelsyGet(&accY);
+			AccelszGet(&accZ);
+		}
+		break;
+	}
 #ifndef SMALLF1
-			case MODULESETTINGS_FRSKYACCELDATA_NEDACCELS: {
-				if (NedAccelHandle() != NULL) {
-					NedAccelNorthGet(&accX);
-					NedAccelEastGet(&accY);
-					NedAccelDownGet(&accZ);
-				}
-				break;
-			}
-			case MODULESETTINGS_FRSKYACCELDATA_NEDVELOCITY: {
-				if (VelocityActualHandle() != NULL) {
-					VelocityActualNorthGet(&accX);
-					VelocityActualEastGet(&accY);
-					VelocityActualDownGet(&accZ);
-					accX *= GRAVITY / 10.0f;
-					accY *= GRAVITY / 10.0f;
-					accZ *= GRAVITY / 10.0f;
-				}
-				break;
-			}
+	case MODULESETTINGS_FRSKYACCELDATA_NEDACCELS: {
+		if (NedAccelHandle() != NULL) {
+			NedAccelNorthGet(&accX);
+			NedAccelEastGet(&accY);
+			NedAccelDownGet(&accZ);
+		}
+		break;
+	}
+	case MODULESETTINGS_FRSKYACCELDATA_NEDVELOCITY: {
+		if (VelocityActualHandle() != NULL) {
+			VelocityActualNorthGet(&accX);
+			VelocityActualEastGet(&accY);
+			VelocityActualDownGet(&accZ);
+			accX *= GRAVITY / 10.0f;
+			accY *= GRAVITY / 10.0f;
+			accZ *= GRAVITY / 10.0f;
+		}
+		break;
+	}
 #endif
-			case MODULESETTINGS_FRSKYACCELDATA_ATTITUDEANGLES: {
-				if (AttitudeActualHandle() != NULL) {
-					AttitudeActualRollGet(&accX);
-					AttitudeActualPitchGet(&accY);
-					AttitudeActualYawGet(&accZ);
-					accX *= GRAVITY / 10.0f;
-					accY *= GRAVITY / 10.0f;
-					accZ *= GRAVITY / 10.0f;
-				}
-				break;
-			}
-			}
-
-			msg_length += frsky_pack_accel(
-					accX,
-					accY,
-					accZ,
-					serial_buf + msg_length);
+	case MODULESETTINGS_FRSKYACCELDATA_ATTITUDEANGLES: {
+		if (AttitudeActualHandle() != NULL) {
+			AttitudeActualRollGet(&accX);
+			AttitudeActualPitchGet(&accY);
+			AttitudeActualYawGet(&accZ);
+			accX *= GRAVITY / 10.0f;
+			accY *= GRAVITY / 10.0f;
+			accZ *= GRAVITY / 10.0f;
+		}
+		break;
+	}
+	}
 
-			if (BaroAltitudeHandle() != NULL)
-				BaroAltitudeGet(&baroAltitude);
+	msg_length += frsky_pack_accel(
+			accX,
+			accY,
+			accZ,
+			serial_buf + msg_length);
 
-			FlightStatusGet(&flightStatus);
+	if (BaroAltitudeHandle() != NULL)
+		BaroAltitudeGet(&baroAltitude);
 
-			// set altitude offset when arming
-			if ((flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMING) ||
-					((last_armed != FLIGHTSTATUS_ARMED_ARMED) && (flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED))) {
-				altitude_offset = baroAltitude.Altitude;
-			}
-			last_armed = flightStatus.Armed;
+	FlightStatusGet(&flightStatus);
 
-			float altitude = baroAltitude.Altitude - altitude_offset;
-			msg_length += frsky_pack_altitude(
-					altitude,
-					serial_buf + msg_length);
+	// set altitude offset when arming
+	if ((flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMING) ||
+			((last_armed != FLIGHTSTATUS_ARMED_ARMED) && (flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED))) {
+		altitude_offset = baroAltitude.Altitude;
+	}
+	last_armed = flightStatus.Armed;
 
-			msg_length += frsky_pack_stop(serial_buf + msg_length);
+	float altitude = baroAltitude.Altitude - altitude_offset;
+	msg_length += frsky_pack_altitude(
+			altitude,
+			serial_buf + msg_length);
 
-			PIOS_COM_SendBuffer(frsky_port, serial_buf, msg_length);
-		}
+	msg_length += frsky_pack_stop(serial_buf + msg_length);
 
-		if (frame_trigger(FRSKY_FRAME_BATTERY)) {
-			msg_length = 0;
-
-			if (FlightBatteryStateHandle() != NULL)
-				FlightBatteryStateGet(&batState);
-
-			float voltage = 0.0f;
-			if (batSettings.VoltagePin != FLIGHTBATTERYSETTINGS_VOLTAGEPIN_NONE)
-				voltage = batState.Voltage;
-
-			float current = 0.0f;
-			if (batSettings.CurrentPin != FLIGHTBATTERYSETTINGS_CURRENTPIN_NONE)
-				current = batState.Current;
-
-			// As long as there is no voltage for each cell
-			// all cells will have the same voltage.
-			// Receiver will know number of cells.
-			if (batSettings.NbCells > 0) {
-				float cell_v = voltage / batSettings.NbCells;
-				for(uint8_t i = 0; i < batSettings.NbCells; ++i) {
-					msg_length += frsky_pack_cellvoltage(
-							i,
-							cell_v,
-							serial_buf + msg_length);
-				}
-			}
-
-			msg_length += frsky_pack_fas(
-					voltage,
-					current,
-					serial_buf + msg_length);
+	return msg_length;
+}
 
-			if (batSettings.Capacity > 0) {
-				float fuel = 1.0f - batState.ConsumedEnergy / batSettings.Capacity;
-				msg_length += frsky_pack_fuel(
-					fuel,
+/**
+ * Writes the cell voltages, current and fuel level
+ * \return number of bytes written to the buffer
+ */
+static uint16_t frsky_pack_battery_frame(uint8_t *serial_buf, uint16_t buf_len)
+{
+	uint16_t msg_length = 0;
+
+	if (FlightBatteryStateHandle() != NULL)
+		FlightBatteryStateGet(&batState);
+
+	float voltage = 0.0f;
+	if (batSettings.VoltagePin != FLIGHTBATTERYSETTINGS_VOLTAGEPIN_NONE)
+		voltage = batState.Voltage;
+
+	float current = 0.0f;
+	if (batSettings.CurrentPin != FLIGHTBATTERYSETTINGS_CURRENTPIN_NONE)
+		current = batState.Current;
+
+	// As long as there is no voltage for each cell
+	// all cells will have the same voltage.
+	// Receiver will know number of cells.
+	if (batSettings.NbCells > 0) {
+		float cell_v = voltage / batSettings.NbCells;
+		for(uint8_t i = 0; i < batSettings.NbCells; ++i) {
+			msg_length += frsky_pack_cellvoltage(
+					i,
+					cell_v,
 					serial_buf + msg_length);
-			}
+		}
+	}
 
-			msg_length += frsky_pack_stop(serial_buf + msg_length);
+	msg_length += frsky_pack_fas(
+			voltage,
+			current,
+			serial_buf + msg_length);
 
-			PIOS_COM_SendBuffer(frsky_port, serial_buf, msg_length);
-		}
+	if (batSettings.Capacity > 0) {
+		float fuel = 1.0f - batState.ConsumedEnergy / batSettings.Capacity;
+		msg_length += frsky_pack_fuel(
+			fuel,
+			serial_buf + msg_length);
+	}
+
+	msg_length += frsky_pack_stop(serial_buf + msg_length);
 
-		if (frame_trigger(FRSKY_FRAME_GPS)) {
-			msg_length = 0;
+	return msg_length;
+}
+
+/**
+ * Writes the flight status, GPS status and position
+ * \return number of bytes written to the buffer
+ */
+static uint16_t frsky_pack_gps_frame(uint8_t *serial_buf, uint16_t buf_len)
+{
+	uint16_t msg_length = 0;
 
-			/**
-			 * Encodes ARM status and flight mode number as RPM value
-			 * Since there is no RPM information in any UAVO available,
-			 * we will intentionally misuse this item to encode other useful information.
-			 * It will encode flight status as three-digit number as follow:
-			 * most left digit encodes arm status (200=armed, 100=disarmed)
-			 * two most right digits encode flight mode number (see FlightStatus UAVO FlightMode enum)
-			 * To work properly on Taranis, you have to set Blades to "60" in telemetry setting
-			 */
-			FlightStatusData flight_status;
-			FlightStatusGet(&flight_status);
+	/**
+	 * Encodes ARM status and flight mode number as RPM value
+	 * Since there is no RPM information in any UAVO available,
+	 * we will intentionally misuse this item to encode other useful information.
+	 * It will encode flight status as three-digit number as follow:
+	 * most left digit encodes arm status (200=armed, 100=disarmed)
+	 * two most right digits encode flight mode number (see FlightStatus UAVO FlightMode enum)
+	 * To work properly on Taranis, you have to set Blades to "60" in telemetry setting
+	 */
+	FlightStatusData flight_status;
+	FlightStatusGet(&flight_status);
 
-			uint16_t status = 0;
-			float hdop, vdop;
+	uint16_t status = 0;
+	float hdop, vdop;
 
-			status = (flight_status.Armed == FLIGHTSTATUS_ARMED_ARMED) ? 200 : 100;
-			status += flight_status.FlightMode;
+	status = (flight_status.Armed == FLIGHTSTATUS_ARMED_ARMED) ? 200 : 100;
+	status += flight_status.FlightMode;
 
-			msg_length += frsky_pack_rpm(status, serial_buf + msg_length);
+	msg_length += frsky_pack_rpm(status, serial_buf + msg_length);
 
-			uint8_t hl_set = HOMELOCATION_SET_FALSE;
-			
-			if (GPSPositionHandle() != NULL)
-				GPSPositionGet(&gpsPosData);
+	uint8_t hl_set = HOMELOCATION_SET_FALSE;
+	
+	if (GPSPositionHandle() != NULL)
+		GPSPositionGet(&gpsPosData);
 
-			if (HomeLocationHandle() != NULL)
-				HomeLocationSetGet(&hl_set);
+	if (HomeLocationHandle() != NULL)
+		HomeLocationSetGet(&hl_set);
         
-			/**
-			 * Encode GPS status and visible satellites as T1 value
-			 * We will intentionally misuse this item to encode other useful information.
-			 * Right-most two digits encode visible satellite count, left-most digit has following meaning:
-			 * 1 - no GPS connected
-			 * 2 - no fix
-			 * 3 - 2D fix
-			 * 4 - 3D fix
-			 * 5 - 3D fix and HomeLocation is SET - should be safe for navigation
-			 */
-			switch (gpsPosData.Status) {
-			case GPSPOSITION_STATUS_NOGPS:
-			status = 100;
-				break;
-			case GPSPOSITION_STATUS_NOFIX:
-				status = 200;
-				break;
-			case GPSPOSITION_STATUS_FIX2D:
-				status = 300;
-				break;
-			case GPSPOSITION_STATUS_FIX3D:
-			case GPSPOSITION_STATUS_DIFF3D:
-				if (hl_set == HOMELOCATION_SET_TRUE)
-					status = 500;
-				else
-					status = 400;
-				break;
-			}
-	
-			if (gpsPosData.Satellites > 0)
-				status += gpsPosData.Satellites;
-
-			msg_length += frsky_pack_temperature_01((float)status, serial_buf + msg_length);
-			
-			/**
-			 * Encode GPS HDOP and VDOP as T2 value
-			 * We will intentionally misuse this item to encode other useful information.
-			 * VDOP in the upper 16 bits, max 256 (2.56 * 100)
-			 * HDOP in the lower 16 bits, max 256 (2.56 * 100)
-			 */
-			hdop = gpsPosData.HDOP * 100.0f;
-			
-			if (hdop > 255.0f)
-				hdop = 255.0f;
-			
-			vdop = gpsPosData.VDOP * 100.0f;
-			
-			if (vdop > 255.0f)
-				vdop = 255.0f;
-			
-			msg_length += frsky_pack_temperature_02((vdop * 256 + hdop), serial_buf + msg_length);
-
-			if (gpsPosData.Status == GPSPOSITION_STATUS_FIX2D ||
-			    gpsPosData.Status == GPSPOSITION_STATUS_FIX3D) {
-				msg_length += frsky_pack_gps(
-						gpsPosData.Heading,
-						gpsPosData.Latitude,
-						gpsPosData.Longitude,
-						gpsPosData.Altitude,
-						gpsPosData.Groundspeed,
-						serial_buf + msg_length);
-			}
-
-			msg_length += frsky_pack_stop(serial_buf + msg_length);
-
-			PIOS_COM_SendBuffer(frsky_port, serial_buf, msg_length);
-		}
+	/**
+	 * Encode GPS status and visible satellites as T1 value
+	 * We will intentionally misuse this item to encode other useful information.
+	 * Right-most two digits encode visible satellite count, left-most digit has following meaning:
+	 * 1 - no GPS connected
+	 * 2 - no fix
+	 * 3 - 2D fix
+	 * 4 - 3D fix
+	 * 5 - 3D fix and HomeLocation is SET - should be safe for navigation
+	 */
+	switch (gpsPosData.Status) {
+	case GPSPOSITION_STATUS_NOGPS:
+	status = 100;
+		break;
+	case GPSPOSITION_STATUS_NOFIX:
+		status = 200;
+		break;
+	case GPSPOSITION_STATUS_FIX2D:
+		status = 300;
+		break;
+	case GPSPOSITION_STATUS_FIX3D:
+	case GPSPOSITION_STATUS_DIFF3D:
+		if (hl_set == HOMELOCATION_SET_TRUE)
+			status = 500;
+		else
+			status = 400;
+		break;
 	}
-}
-
-static bool frame_trigger(uint8_t frame_num)
-{
-	uint8_t rate = (uint8_t) frsky_rates[frame_num];
+	
+	if (gpsPosData.Satellites > 0)
+		status += gpsPosData.Satellites;
 
-	if (rate == 0) {
-		return false;
+	msg_length += frsky_pack_temperature_01((float)status, serial_buf + msg_length);
+	
+	/**
+	 * Encode GPS HDOP and VDOP as T2 value
+	 * We will intentionally misuse this item to encode other useful information.
+	 * VDOP in the upper 16 bits, max 256 (2.56 * 100)
+	 * HDOP in the lower 16 bits, max 256 (2.56 * 100)
+	 */
+	hdop = gpsPosData.HDOP * 100.0f;
+	
+	if (hdop > 255.0f)
+		hdop = 255.0f;
+	
+	vdop = gpsPosData.VDOP * 100.0f;
+	
+	if (vdop > 255.0f)
+		vdop = 255.0f;
+	
+	msg_length += frsky_pack_temperature_02((vdop * 256 + hdop), serial_buf + msg_length);
+
+	if (gpsPosData.Status == GPSPOSITION_STATUS_FIX2D ||
+	    gpsPosData.Status == GPSPOSITION_STATUS_FIX3D) {
+		msg_length += frsky_pack_gps(
+				gpsPosData.Heading,
+				gpsPosData.Latitude,
+				gpsPosData.Longitude,
+				gpsPosData.Altitude,
+				gpsPosData.Groundspeed,
+				serial_buf + msg_length);
 	}
 
-	if (frame_ticks[frame_num] == 0) {
-		// we're triggering now, setup the next trigger point
-		if (rate > TASK_RATE_HZ) {
-			rate = TASK_RATE_HZ;
-		}
-		frame_ticks[frame_num] = (TASK_RATE_HZ / rate);
-		return true;
-	}
+	msg_length += frsky_pack_stop(serial_buf + msg_length);
 
-	// count down at 50Hz
-	frame_ticks[frame_num]--;
-	return false;
+	return msg_length;
 }
 
 /**
@@ -55,16 +55,18 @@
 #include "manualcontrolcommand.h"
 #include "flightstatus.h"
 #include "pios_thread.h"
+#include "link_scheduler.h"
 
 #if defined(PIOS_INCLUDE_LIGHTTELEMETRY)
 // Private constants
 #define STACK_SIZE_BYTES 512
 #define TASK_PRIORITY PIOS_THREAD_PRIO_LOW
-#define UPDATE_PERIOD 100
+#define UPDATE_PERIOD 20
 
 #define LTM_GFRAME_SIZE 18
 #define LTM_AFRAME_SIZE 10
 #define LTM_SFRAME_SIZE 11
+#define LTM_MAX_FRAME_SIZE LTM_GFRAME_SIZE
 
 // Private types
 
@@ -72,17 +74,31 @@
 static bool module_enabled;
 static struct pios_thread *taskHandle;
 static uint32_t lighttelemetryPort;
-static uint8_t ltm_scheduler;
-static uint8_t ltm_slowrate;
+static struct link_sched *link_sched;
 
 // Private functions
 static void uavoLighttelemetryBridgeTask(void *parameters);
 static void updateSettings();
 
-static void send_LTM_Packet(uint8_t *LTPacket, uint8_t LTPacket_size);
-static void send_LTM_Gframe();
-static void send_LTM_Aframe();
-static void send_LTM_Sframe();
+static uint16_t finish_LTM_Packet(uint8_t *LTPacket, uint8_t LTPacket_size);
+static uint16_t pack_LTM_Gframe(uint8_t *LTBuff, uint16_t buf_len);
+static uint16_t pack_LTM_Aframe(uint8_t *LTBuff, uint16_t buf_len);
+static uint16_t pack_LTM_Sframe(uint8_t *LTBuff, uint16_t buf_len);
+
+/*
+ * The frames with their rate and a priority for when the link can't carry
+ * all of them, e.g. at 1200 baud the attitude is sent less often
+ */
+static const struct {
+	link_sched_pack pack;
+	uint16_t period_ms;
+	uint8_t priority;
+	uint16_t size;
+} ltm_frames[] = {
+	{ pack_LTM_Aframe, 100, 4, LTM_AFRAME_SIZE },  //10Hz
+	{ pack_LTM_Gframe, 333, 4, LTM_GFRAME_SIZE },  //3Hz
+	{ pack_LTM_Sframe, 500, 2, LTM_SFRAME_SIZE },  //2Hz
+};
 
 
 /**
@@ -103,15 +119,17 @@ int32_t uavoLighttelemetryBridgeInitialize()
 		if ( module_state[MODULESETTINGS_ADMINSTATE_UAVOLIGHTTELEMETRYBRIDGE] == MODULESETTINGS_ADMINSTATE_ENABLED ) 
 		{ 
 			// Update telemetry settings
-			ltm_scheduler = 1;
 			updateSettings();
-			uint8_t speed;
-			ModuleSettingsLightTelemetrySpeedGet(&speed);
-			if (speed == MODULESETTINGS_LIGHTTELEMETRYSPEED_1200)
-				ltm_slowrate = 1;
-			else 
-				ltm_slowrate = 0;
-	
+
+			link_sched = link_sched_create(lighttelemetryPort, NELEMENTS(ltm_frames), LTM_MAX_FRAME_SIZE);
+			if (link_sched == NULL)
+				return -1;
+
+			for (int i = 0; i < NELEMENTS(ltm_frames); i++) {
+				link_sched_add(link_sched, ltm_frames[i].pack, ltm_frames[i].period_ms,
+						ltm_frames[i].priority, ltm_frames[i].size);
+			}
+
 			module_enabled = true; 
 			return 0;
 		}
@@ -152,23 +170,8 @@ static void uavoLighttelemetryBridgeTask(void *parameters)
 	lastSysTime = PIOS_Thread_Systime();
 	while (1)
 	{
+		link_sched_run(link_sched, PIOS_Thread_Systime());
 
-		if (ltm_scheduler & 1) {	// is odd
-			send_LTM_Aframe();
-		}
-		else						// is even
-		{
-			if (ltm_slowrate == 0)
-				send_LTM_Aframe();
-				
-			if (ltm_scheduler % 4 == 0)
-				send_LTM_Sframe();
-			else 
-				send_LTM_Gframe();
-		}
-		ltm_scheduler++;
-		if (ltm_scheduler > 10)
-			ltm_scheduler = 1;
 		// Delay until it is time to read the next sample
 		PIOS_Thread_Sleep_Until(&lastSysTime, UPDATE_PERIOD);
 	}
@@ -179,7 +182,7 @@ static void uavoLighttelemetryBridgeTask(void *parameters)
  *#######################################################################
 */
 //GPS packet
-static void send_LTM_Gframe() 
+static uint16_t pack_LTM_Gframe(uint8_t *LTBuff, uint16_t buf_len)
 {
 	GPSPositionData pdata;
 	BaroAltitudeData bdata;
@@ -220,7 +223,6 @@ static void send_LTM_Gframe()
 	
 	uint8_t lt_gpssats = (int8_t)pdata.Satellites;
 	//pack G frame	
-	uint8_t LTBuff[LTM_GFRAME_SIZE];
 	//G Frame: $T(2 bytes)G(1byte)LAT(cm,4 bytes)LON(cm,4bytes)SPEED(m/s,1bytes)ALT(cm,4bytes)SATS(6bits)FIX(2bits)CRC(xor,1byte)
 	//START
 	LTBuff[0]  = 0x24; //$
@@ -243,11 +245,11 @@ static void send_LTM_Gframe()
 	LTBuff[15] = (lt_altitude >> 8*3) & 0xFF;
 	LTBuff[16] = ((lt_gpssats << 2)& 0xFF ) | (lt_gpsfix & 0b00000011) ; // last 6 bits: sats number, first 2:fix type (0,1,2,3)
 
-	send_LTM_Packet(LTBuff,LTM_GFRAME_SIZE);
+	return finish_LTM_Packet(LTBuff,LTM_GFRAME_SIZE);
 }
 
 //Attitude packet
-static void send_LTM_Aframe() 
+static uint16_t pack_LTM_Aframe(uint8_t *LTBuff, uint16_t buf_len)
 {
 	//prepare data
 	AttitudeActualData adata;
@@ -256,7 +258,6 @@ static void send_LTM_Aframe()
 	int16_t lt_roll	   = (int16_t)(roundf(adata.Roll));		//-180/180°
 	int16_t lt_heading = (int16_t)(roundf(adata.Yaw));		//-180/180°
 	//pack A frame	
-	uint8_t LTBuff[LTM_AFRAME_SIZE];
 	
 	//A Frame: $T(2 bytes)A(1byte)PITCH(2 bytes)ROLL(2bytes)HEADING(2bytes)CRC(xor,1byte)
 	//START
@@ -271,11 +272,11 @@ static void send_LTM_Aframe()
 	LTBuff[6] = (lt_roll >> 8*1) & 0xFF;
 	LTBuff[7] = (lt_heading >> 8*0) & 0xFF;
 	LTBuff[8] = (lt_heading >> 8*1) & 0xFF;
-	send_LTM_Packet(LTBuff,LTM_AFRAME_SIZE);
+	return finish_LTM_Packet(LTBuff,LTM_AFRAME_SIZE);
 }
 
 //Sensors packet
-static void send_LTM_Sframe() 
+static uint16_t pack_LTM_Sframe(uint8_t *LTBuff, uint16_t buf_len)
 {
 	//prepare data
 	uint16_t lt_vbat = 0;
@@ -340,7 +341,6 @@ static void send_LTM_Sframe()
 		lt_flightmode = 19; //Unknown
 	}
 	//pack A frame	
-	uint8_t LTBuff[LTM_SFRAME_SIZE];
 	
 	//A Frame: $T(2 bytes)A(1byte)PITCH(2 bytes)ROLL(2bytes)HEADING(2bytes)CRC(xor,1byte)
 	//START
@@ -356,10 +356,10 @@ static void send_LTM_Sframe()
 	LTBuff[7] = (lt_rssi >> 8*0) & 0xFF;
 	LTBuff[8] = (lt_airspeed >> 8*0) & 0xFF;
 	LTBuff[9] = ((lt_flightmode << 2)& 0xFF ) | ((lt_failsafe << 1)& 0b00000010 ) | (lt_arm & 0b00000001) ; // last 6 bits: flight mode, 2nd bit: failsafe, 1st bit: Arm status.
-	send_LTM_Packet(LTBuff,LTM_SFRAME_SIZE);
+	return finish_LTM_Packet(LTBuff,LTM_SFRAME_SIZE);
 }
 
-static void send_LTM_Packet(uint8_t *LTPacket, uint8_t LTPacket_size)
+static uint16_t finish_LTM_Packet(uint8_t *LTPacket, uint8_t LTPacket_size)
 {
 	//calculate Checksum
 	uint8_t LTCrc = 0x00;
@@ -367,9 +367,8 @@ static void send_LTM_Packet(uint8_t *LTPacket, uint8_t LTPacket_size)
 		LTCrc ^= LTPacket[i];
 	}
 	LTPacket[LTPacket_size-1] = LTCrc;
-	if (lighttelemetryPort) {
-		PIOS_COM_SendBuffer(lighttelemetryPort, LTPacket, LTPacket_size);
-	}
+
+	return LTPacket_size;
 }
 
 static void updateSettings()
@@ -30,6 +30,7 @@
 #include "coordinate_conversions.h"
 #include "physical_constants.h"
 #include "misc_math.h"
+#include "fastmath.h"
 #include "paths.h"
 #include "pid.h"
 
@@ -413,8 +414,9 @@ static float vtol_follower_control_altitude(float downCommand) {
 				 attitudeActual.q4 * attitudeActual.q4;
 
 		// Add ability to scale up the amount of compensation to achieve
-		// level forward flight
-		fraction = powf(fraction, (float) altitudeHoldSettings.AttitudeComp / 100.0f);
+		// level forward flight. A negative fraction is left to the check below.
+		if (fraction > 0.0f)
+			fraction = fast_powf(fraction, (float) altitudeHoldSettings.AttitudeComp / 100.0f);
 
 		// Dividing by the fraction remaining in the vertical projection will
 		// attempt to compensate for tilt. This acts like the thrust is linear
@@ -514,7 +516,7 @@ int32_t vtol_follower_control_attitude(float dT, const float *att_adj)
 		VelocityDesiredData velocityDesired;
 		VelocityDesiredGet(&velocityDesired);
 		float total_vel2 = velocityDesired.East*velocityDesired.East + velocityDesired.North*velocityDesired.North;
-		float path_direction = atan2f(velocityDesired.East, velocityDesired.North) * RAD2DEG;
+		float path_direction = fast_atan2f(velocityDesired.East, velocityDesired.North) * RAD2DEG;
 		if (total_vel2 > 1) {
 			stabDesired.Yaw = path_direction;
 			stabDesired.StabilizationMode[STABILIZATIONDESIRED_STABILIZATIONMODE_YAW] = STABILIZATIONDESIRED_STABILIZATIONMODE_ATTITUDE;
@@ -0,0 +1,40 @@
+/**
+ ******************************************************************************
+ *
+ * @file       pios_epoll_priv.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
+ * @brief      Shared socket I/O thread for the posix COM drivers.
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_EPOLL_PRIV_H
+#define PIOS_EPOLL_PRIV_H
+
+#include <pios.h>
+
+/**
+ * Called from the I/O thread when the registered file descriptor
+ * has data (or a connection) waiting.
+ */
+typedef void (*pios_epoll_handler)(uintptr_t context, int fd);
+
+extern int32_t PIOS_EPOLL_Add(int fd, pios_epoll_handler handler, uintptr_t context);
+extern int32_t PIOS_EPOLL_Remove(int fd);
+
+#endif /* PIOS_EPOLL_PRIV_H */
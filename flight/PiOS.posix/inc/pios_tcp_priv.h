@@ -28,7 +28,6 @@
 
 #include <pios.h>
 #include <stdio.h>
-#include <pthread.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <stdlib.h>
@@ -37,7 +36,11 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
-#include "fifo_buffer.h"
+
+/* Number of clients connected at the same time to one port */
+#if !defined(PIOS_TCP_MAX_CLIENTS)
+#define PIOS_TCP_MAX_CLIENTS 8
+#endif
 
 struct pios_tcp_cfg {
 	const char *ip;
@@ -46,23 +49,19 @@ struct pios_tcp_cfg {
 
 typedef struct {
 	const struct pios_tcp_cfg * cfg;
-	pthread_t rxThread;
 	
 	int socket;
 	struct sockaddr_in server;
-	struct sockaddr_in client;
-	uint32_t clientLength;
-	int socket_connection;
 	
-	pthread_cond_t cond;
-	pthread_mutex_t mutex;
+	/* Connections, -1 when unused. Received data from all of them goes
+	 * to the same COM device and transmitted data is sent to all. */
+	int clients[PIOS_TCP_MAX_CLIENTS];
 	
 	pios_com_callback tx_out_cb;
 	uintptr_t tx_out_context;
 	pios_com_callback rx_in_cb;
 	uintptr_t rx_in_context;
 	
-	t_fifo_buffer rx_fifo;
 	uint8_t rx_buffer[PIOS_TCP_RX_BUFFER_SIZE];
 	uint8_t tx_buffer[PIOS_TCP_RX_BUFFER_SIZE];
 } pios_tcp_dev;
@@ -30,7 +30,6 @@
 
 #include <pios.h>
 #include <stdio.h>
-#include <pthread.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <stdlib.h>
@@ -40,6 +39,11 @@
 #include <netinet/in.h>
 #include "pios_thread.h"
 
+/* Number of peers the data is sent to */
+#if !defined(PIOS_UDP_MAX_CLIENTS)
+#define PIOS_UDP_MAX_CLIENTS 8
+#endif
+
 struct pios_udp_cfg {
   const char * ip;
   uint16_t port;
@@ -47,15 +51,15 @@ struct pios_udp_cfg {
 
 typedef struct {
   const struct pios_udp_cfg * cfg;
-  struct pios_thread *rxThread;
 
   int socket;
   struct sockaddr_in server;
-  struct sockaddr_in client;
-  uint32_t clientLength;
 
-  pthread_cond_t cond;
-  pthread_mutex_t mutex;
+  /* The addresses data was received from most recently, transmitted data
+   * goes to all of them */
+  struct sockaddr_in clients[PIOS_UDP_MAX_CLIENTS];
+  uint32_t clients_heard[PIOS_UDP_MAX_CLIENTS];
+  uint8_t num_clients;
 
   pios_com_callback tx_out_cb;
   uintptr_t tx_out_context;
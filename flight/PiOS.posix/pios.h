@@ -66,6 +66,7 @@
 
 /* PIOS Hardware Includes (posix) */
 #include <pios_heap.h>
+#include <pios_trace.h>
 #include <pios_sys.h>
 #include <pios_delay.h>
 #include <pios_led.h>
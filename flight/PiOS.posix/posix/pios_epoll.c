@@ -0,0 +1,271 @@
+/**
+ ******************************************************************************
+ *
+ * @file       pios_epoll.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
+ * @brief      Shared socket I/O thread for the posix COM drivers.
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * All the simulator threads share a single OS thread, so a driver thread
+ * blocking in the kernel blocks everything. Instead of each socket driver
+ * polling its fd every tick, one I/O thread at the idle priority waits on
+ * all of them at once. It only runs when every other thread is blocked, so
+ * sleeping in epoll_wait() takes the place of the spinning idle thread. The
+ * scheduler tick interrupts the wait with EINTR and preempts it as usual.
+ *
+ * PIOS threads can't be created below PIOS_THREAD_PRIO_LOW, which is where
+ * the low priority modules run. Blocking there would stall them until the
+ * next tick, so the thread drops itself to the idle priority when it starts.
+ *
+ * Handlers are called from the I/O thread and pass the received data on to
+ * the owning COM device, which wakes up the tasks waiting on it.
+ */
+
+/* Project Includes */
+#include "pios.h"
+
+#if defined(PIOS_INCLUDE_TCP) || defined(PIOS_INCLUDE_UDP)
+
+#include <pios_epoll_priv.h>
+#include "pios_thread.h"
+#include <errno.h>
+#include <unistd.h>
+
+#if defined(PIOS_INCLUDE_FREERTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#define PIOS_EPOLL_MAX_FDS 64
+
+struct pios_epoll_slot {
+	int fd;
+	pios_epoll_handler handler;
+	uintptr_t context;
+};
+
+static struct pios_epoll_slot pios_epoll_slots[PIOS_EPOLL_MAX_FDS];
+static struct pios_thread *pios_epoll_thread;
+
+#if defined(__linux__)
+static int pios_epoll_fd = -1;
+#endif
+
+static void PIOS_EPOLL_Task(void *parameters);
+
+/**
+ * Start the I/O thread the first time a file descriptor is added
+ */
+static int32_t PIOS_EPOLL_Start(void)
+{
+	if (pios_epoll_thread != NULL)
+		return 0;
+
+	for (uint32_t i = 0; i < NELEMENTS(pios_epoll_slots); i++)
+		pios_epoll_slots[i].fd = -1;
+
+#if defined(__linux__)
+	pios_epoll_fd = epoll_create(PIOS_EPOLL_MAX_FDS);
+	if (pios_epoll_fd < 0) {
+		perror("epoll_create failed");
+		return -1;
+	}
+#endif
+
+	pios_epoll_thread = PIOS_Thread_Create(
+			PIOS_EPOLL_Task, "pios_epoll", PIOS_THREAD_STACK_SIZE_MIN, NULL, PIOS_THREAD_PRIO_LOW);
+
+	if (pios_epoll_thread == NULL)
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Watch a file descriptor for incoming data
+ * \param[in] fd non-blocking file descriptor to watch
+ * \param[in] handler called from the I/O thread when fd is readable
+ * \param[in] context passed back to the handler
+ * \return 0 on success
+ * \return -1 if no slot is left or the fd could not be added
+ */
+int32_t PIOS_EPOLL_Add(int fd, pios_epoll_handler handler, uintptr_t context)
+{
+	if (PIOS_EPOLL_Start() != 0)
+		return -1;
+
+	int32_t ret = -1;
+
+	PIOS_Thread_Scheduler_Suspend();
+
+	for (uint32_t i = 0; i < NELEMENTS(pios_epoll_slots); i++) {
+		struct pios_epoll_slot *slot = &pios_epoll_slots[i];
+		if (slot->fd != -1)
+			continue;
+
+#if defined(__linux__)
+		struct epoll_event ev = {
+			.events = EPOLLIN,
+			/* Keep the fd to tell a reused slot apart */
+			.data.u64 = ((uint64_t)fd << 32) | i,
+		};
+		if (epoll_ctl(pios_epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+			break;
+#endif
+
+		slot->handler = handler;
+		slot->context = context;
+		slot->fd = fd;
+		ret = 0;
+		break;
+	}
+
+	PIOS_Thread_Scheduler_Resume();
+
+	return ret;
+}
+
+/**
+ * Stop watching a file descriptor. This must be called before the fd
+ * is closed.
+ * \param[in] fd file descriptor previously passed to PIOS_EPOLL_Add()
+ * \return 0 on success
+ * \return -1 if the fd was not being watched
+ */
+int32_t PIOS_EPOLL_Remove(int fd)
+{
+	int32_t ret = -1;
+
+	PIOS_Thread_Scheduler_Suspend();
+
+	for (uint32_t i = 0; i < NELEMENTS(pios_epoll_slots); i++) {
+		struct pios_epoll_slot *slot = &pios_epoll_slots[i];
+		if (slot->fd != fd)
+			continue;
+
+#if defined(__linux__)
+		epoll_ctl(pios_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+
+		slot->fd = -1;
+		slot->handler = NULL;
+		ret = 0;
+		break;
+	}
+
+	PIOS_Thread_Scheduler_Resume();
+
+	return ret;
+}
+
+/**
+ * Call the handler of a slot if it is still registered for fd
+ */
+static void PIOS_EPOLL_Dispatch(uint32_t index, int fd)
+{
+	if (index >= NELEMENTS(pios_epoll_slots))
+		return;
+
+	PIOS_Thread_Scheduler_Suspend();
+
+	struct pios_epoll_slot *slot = &pios_epoll_slots[index];
+	pios_epoll_handler handler = NULL;
+	uintptr_t context = 0;
+
+	/* An earlier handler of this round may have removed it */
+	if (slot->fd == fd) {
+		handler = slot->handler;
+		context = slot->context;
+	}
+
+	PIOS_Thread_Scheduler_Resume();
+
+	if (handler)
+		handler(context, fd);
+}
+
+/**
+ * I/O thread, waits for any of the watched descriptors to become readable
+ */
+static void PIOS_EPOLL_Task(void *parameters)
+{
+#if defined(PIOS_INCLUDE_CHIBIOS)
+	chThdSetPriority(IDLEPRIO);
+#elif defined(PIOS_INCLUDE_FREERTOS)
+	vTaskPrioritySet(NULL, tskIDLE_PRIORITY);
+#endif
+
+	while (1) {
+#if defined(__linux__)
+		struct epoll_event events[16];
+
+		/* Must not be called with the scheduler suspended, the tick
+		 * interrupts the wait. */
+		int n = epoll_wait(pios_epoll_fd, events, NELEMENTS(events), -1);
+		int error = errno;
+
+		for (int i = 0; i < n; i++) {
+			PIOS_EPOLL_Dispatch((uint32_t)events[i].data.u64,
+					(int)(events[i].data.u64 >> 32));
+		}
+#else
+		struct pollfd fds[PIOS_EPOLL_MAX_FDS];
+		uint32_t indexes[PIOS_EPOLL_MAX_FDS];
+		nfds_t nfds = 0;
+
+		/* The set is rebuilt each time, any change made by other
+		 * threads happened while we were preempted and interrupted */
+		PIOS_Thread_Scheduler_Suspend();
+		for (uint32_t i = 0; i < NELEMENTS(pios_epoll_slots); i++) {
+			if (pios_epoll_slots[i].fd == -1)
+				continue;
+			fds[nfds].fd = pios_epoll_slots[i].fd;
+			fds[nfds].events = POLLIN;
+			fds[nfds].revents = 0;
+			indexes[nfds] = i;
+			nfds++;
+		}
+		PIOS_Thread_Scheduler_Resume();
+
+		int n = poll(fds, nfds, -1);
+		int error = errno;
+
+		for (nfds_t i = 0; n > 0 && i < nfds; i++) {
+			if (fds[i].revents == 0)
+				continue;
+			PIOS_EPOLL_Dispatch(indexes[i], fds[i].fd);
+		}
+#endif
+
+		/* EINTR is the scheduler tick, anything else should not happen
+		 * but must not turn this into a busy loop either. */
+		if (n < 0 && error != EINTR)
+			PIOS_Thread_Sleep(1);
+	}
+}
+
+#endif /* PIOS_INCLUDE_TCP || PIOS_INCLUDE_UDP */
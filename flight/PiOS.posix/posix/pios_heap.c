@@ -47,8 +47,28 @@ bool PIOS_heap_malloc_failed_p(void)
 	return malloc_failed_flag;
 }
 
+static bool heap_locked;
+static uint32_t late_allocations;
+
+/**
+ * Count allocations after PIOS_heap_lock(). With DIAG_HEAP_LOCK they
+ * are treated as a bug.
+ */
+static void check_late_allocation(void)
+{
+	if (!heap_locked)
+		return;
+
+	late_allocations++;
+#if defined(DIAG_HEAP_LOCK)
+	PIOS_Assert(0);
+#endif
+}
+
 void * PIOS_malloc(size_t size)
 {
+	check_late_allocation();
+
 #if defined(PIOS_INCLUDE_FREERTOS)
 	void *buf = pvPortMalloc(size);
 #elif defined(PIOS_INCLUDE_CHIBIOS)
@@ -88,6 +108,23 @@ size_t PIOS_heap_get_free_size(void)
 	return 1024;
 }
 
+/**
+ * Mark the end of the start-up. Everything that is still allocated from
+ * the heap after this is counted in PIOS_heap_get_late_allocations().
+ */
+void PIOS_heap_lock(void)
+{
+	heap_locked = true;
+}
+
+/**
+ * Get the number of heap allocations after PIOS_heap_lock()
+ */
+uint32_t PIOS_heap_get_late_allocations(void)
+{
+	return late_allocations;
+}
+
 /**
  * @}
  * @}
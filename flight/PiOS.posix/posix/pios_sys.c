@@ -75,9 +75,13 @@ void PIOS_SYS_Args(int argc, char *argv[]) {
 #include <stdlib.h>		/* printf */
 #include <signal.h>		/* sigaction */
 #include <fenv.h>		/* PE_* */
+#include "pios_thread.h"	/* PIOS_Thread_Profile_Dump */
 static void sigint_handler(int signum, siginfo_t *siginfo, void *ucontext)
 {
 	printf("\nSIGINT received.  Shutting down\n");
+#if defined(DIAG_TASK_PROFILE)
+	PIOS_Thread_Profile_Dump();
+#endif /* defined(DIAG_TASK_PROFILE) */
 	exit(0);
 }
 
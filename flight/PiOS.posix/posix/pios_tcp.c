@@ -33,6 +33,7 @@
 #if defined(PIOS_INCLUDE_TCP)
 
 #include <pios_tcp_priv.h>
+#include <pios_epoll_priv.h>
 #include "pios_thread.h"
 #include <unistd.h>
 #include <sys/types.h>
@@ -46,6 +47,13 @@ static int8_t pios_tcp_num_devices = 0;
 
 static pios_tcp_dev pios_tcp_devices[PIOS_TCP_MAX_DEV];
 
+/* A client going away must not kill the simulator with SIGPIPE */
+#if defined(MSG_NOSIGNAL)
+#define PIOS_TCP_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define PIOS_TCP_SEND_FLAGS 0
+#endif
+
 
 
 /* Provide a COM driver */
@@ -77,109 +85,119 @@ static pios_tcp_dev * find_tcp_dev_by_id(uint8_t tcp)
 }
 
 /**
- * RxTask
+ * Replace a client slot, returns true if it was found
  */
-static void PIOS_TCP_RxTask(void *tcp_dev_n)
+static bool PIOS_TCP_SwapClient(pios_tcp_dev *tcp_dev, int old_fd, int new_fd)
 {
-	pios_tcp_dev *tcp_dev = (pios_tcp_dev*)tcp_dev_n;
-	
-	const int INCOMING_BUFFER_SIZE = 16;
-	char incoming_buffer[INCOMING_BUFFER_SIZE];
-	int error;
-	/**
-	 * com devices never get closed except by application "reboot"
-	 * we also never give up our mutex except for waiting
-	 */
-	while (1) {
-	
-		do
-		{
-			/* Polling the fd has to be executed in thread suspended mode
-			 * to get a correct errno value. */
-			PIOS_Thread_Scheduler_Suspend();
+	bool found = false;
 
-			tcp_dev->socket_connection = accept(tcp_dev->socket, NULL, NULL);
-			error = errno;
+	PIOS_Thread_Scheduler_Suspend();
 
-			PIOS_Thread_Scheduler_Resume();
-
-			PIOS_Thread_Sleep(1);
-		} while (tcp_dev->socket_connection == -1 && (error == EINTR || error == EAGAIN));
-
-		if (tcp_dev->socket_connection < 0) {
-			int error = errno;
-			(void)error;
-			perror("Accept failed");
-			close(tcp_dev->socket);
-			exit(EXIT_FAILURE);
+	for (uint32_t i = 0; i < NELEMENTS(tcp_dev->clients); i++) {
+		if (tcp_dev->clients[i] == old_fd) {
+			tcp_dev->clients[i] = new_fd;
+			found = true;
+			break;
 		}
-		
-		/* Set socket nonblocking. */
-	    int flags;
-	    if ((flags = fcntl(tcp_dev->socket_connection, F_GETFL, 0)) == -1) {
-	    }
-	    if (fcntl(tcp_dev->socket_connection, F_SETFL, flags | O_NONBLOCK) == -1) {
-	    }
+	}
 
+	PIOS_Thread_Scheduler_Resume();
 
-		fprintf(stderr, "Connection accepted\n");
+	return found;
+}
 
-		while (1) {
-			// Received is used to track the scoket whereas the dev variable is only updated when it can be
+/**
+ * Stop serving a client, called from the I/O thread
+ */
+static void PIOS_TCP_CloseClient(pios_tcp_dev *tcp_dev, int fd)
+{
+	PIOS_EPOLL_Remove(fd);
+	PIOS_TCP_SwapClient(tcp_dev, fd, -1);
 
-			/* Polling the fd has to be executed in thread suspended mode
-			 * to get a correct errno value. */
-			PIOS_Thread_Scheduler_Suspend();
+	shutdown(fd, SHUT_RDWR);
+	close(fd);
 
-			int result = read(tcp_dev->socket_connection, incoming_buffer, INCOMING_BUFFER_SIZE);
-			error = errno;
+	fprintf(stderr, "Connection closed\n");
+}
 
-			PIOS_Thread_Scheduler_Resume();
-			
-			if (result > 0 && tcp_dev->rx_in_cb) {
+/**
+ * Data waiting on a client connection
+ */
+static void PIOS_TCP_ClientReadable(uintptr_t context, int fd)
+{
+	pios_tcp_dev *tcp_dev = (pios_tcp_dev *)context;
 
-				bool rx_need_yield = false;
+	/* Reading the fd has to be executed in thread suspended mode
+	 * to get a correct errno value. */
+	PIOS_Thread_Scheduler_Suspend();
 
-				tcp_dev->rx_in_cb(tcp_dev->rx_in_context, (uint8_t*)incoming_buffer, result, NULL, &rx_need_yield);
+	int result = read(fd, tcp_dev->rx_buffer, sizeof(tcp_dev->rx_buffer));
+	int error = errno;
 
-	#if defined(PIOS_INCLUDE_FREERTOS)
-				// Not sure about this
-				if (rx_need_yield) {
-					taskYIELD();
-				}
-	#endif	/* PIOS_INCLUDE_FREERTOS */
+	PIOS_Thread_Scheduler_Resume();
 
-			}
+	if (result > 0) {
+		if (tcp_dev->rx_in_cb) {
+			bool rx_need_yield = false;
 
-			if (result == 0) {
-				break;
-			}
+			/* Data from all the clients is merged like on a shared serial
+			 * line. What the COM buffer can't take is discarded, as the
+			 * USART driver does. */
+			tcp_dev->rx_in_cb(tcp_dev->rx_in_context, tcp_dev->rx_buffer, result, NULL, &rx_need_yield);
 
-			if (result == -1) {
-				if (error == EAGAIN)
-					PIOS_Thread_Sleep(1);
-				else if (error == EINTR)
-					(void)error;
-				else
-					break;
+#if defined(PIOS_INCLUDE_FREERTOS)
+			// Not sure about this
+			if (rx_need_yield) {
+				taskYIELD();
 			}
+#endif	/* PIOS_INCLUDE_FREERTOS */
 		}
-		
-		if (shutdown(tcp_dev->socket_connection, SHUT_RDWR) == -1) {
-			//perror("can not shutdown socket");
-			//close(tcp_dev->socket_connection);
-			//exit(EXIT_FAILURE);
-		}
-		close(tcp_dev->socket_connection);
-		tcp_dev->socket_connection = 0;
+	} else if (result == 0 || (error != EAGAIN && error != EWOULDBLOCK && error != EINTR)) {
+		PIOS_TCP_CloseClient(tcp_dev, fd);
 	}
 }
 
+/**
+ * Connection waiting on the listening socket
+ */
+static void PIOS_TCP_Accept(uintptr_t context, int fd)
+{
+	pios_tcp_dev *tcp_dev = (pios_tcp_dev *)context;
+
+	int connection = accept(fd, NULL, NULL);
+	if (connection < 0)
+		return;
+
+	/* Set socket nonblocking. */
+	int flags = fcntl(connection, F_GETFL, 0);
+	if (flags != -1)
+		fcntl(connection, F_SETFL, flags | O_NONBLOCK);
+
+	int optval = 1;
+	setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+#if defined(SO_NOSIGPIPE)
+	setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &optval, sizeof(optval));
+#endif
+
+	if (!PIOS_TCP_SwapClient(tcp_dev, -1, connection)) {
+		fprintf(stderr, "Connection refused, too many clients\n");
+		close(connection);
+		return;
+	}
+
+	if (PIOS_EPOLL_Add(connection, PIOS_TCP_ClientReadable, context) != 0) {
+		PIOS_TCP_SwapClient(tcp_dev, connection, -1);
+		close(connection);
+		return;
+	}
+
+	fprintf(stderr, "Connection accepted\n");
+}
+
 
 /**
  * Open TCP socket
  */
-struct pios_thread *tcpRxTaskHandle;
 int32_t PIOS_TCP_Init(uintptr_t *tcp_id, const struct pios_tcp_cfg * cfg)
 {
 	
@@ -191,6 +209,8 @@ int32_t PIOS_TCP_Init(uintptr_t *tcp_id, const struct pios_tcp_cfg * cfg)
 	tcp_dev->rx_in_cb = NULL;
 	tcp_dev->tx_out_cb = NULL;
 	tcp_dev->cfg=cfg;
+	for (uint32_t i = 0; i < NELEMENTS(tcp_dev->clients); i++)
+		tcp_dev->clients[i] = -1;
 	
 	/* assign socket */
 	tcp_dev->socket = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
@@ -204,7 +224,6 @@ int32_t PIOS_TCP_Init(uintptr_t *tcp_id, const struct pios_tcp_cfg * cfg)
         setsockopt(tcp_dev->socket, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
 
 	memset(&tcp_dev->server, 0, sizeof(tcp_dev->server));
-	memset(&tcp_dev->client, 0, sizeof(tcp_dev->client));
 
 	tcp_dev->server.sin_family = AF_INET;
 	tcp_dev->server.sin_addr.s_addr = INADDR_ANY; //inet_addr(tcp_dev->cfg->ip);
@@ -235,8 +254,8 @@ int32_t PIOS_TCP_Init(uintptr_t *tcp_id, const struct pios_tcp_cfg * cfg)
     if (fcntl(tcp_dev->socket, F_SETFL, flags | O_NONBLOCK) == -1) {
     }
 
-	tcpRxTaskHandle = PIOS_Thread_Create(
-			PIOS_TCP_RxTask, "pios_tcp_rx", PIOS_THREAD_STACK_SIZE_MIN, tcp_dev, PIOS_THREAD_PRIO_HIGHEST);
+	/* Connections are accepted and served by the shared I/O thread */
+	res = PIOS_EPOLL_Add(tcp_dev->socket, PIOS_TCP_Accept, (uintptr_t)tcp_dev);
 	
 	printf("tcp dev %i - socket %i opened - result %i\n", pios_tcp_num_devices - 1, tcp_dev->socket, res);
 	
@@ -268,7 +287,7 @@ static void PIOS_TCP_TxStart(uintptr_t tcp_id, uint16_t tx_bytes_avail)
 	
 	PIOS_Assert(tcp_dev);
 	
-	int32_t length,rem;
+	int32_t length;
 	
 	/**
 	 * we send everything directly whenever notified of data to send (lazy!)
@@ -277,18 +296,27 @@ static void PIOS_TCP_TxStart(uintptr_t tcp_id, uint16_t tx_bytes_avail)
 		while (tx_bytes_avail > 0) {
 			bool tx_need_yield = false;
 			length = (tcp_dev->tx_out_cb)(tcp_dev->tx_out_context, tcp_dev->tx_buffer, PIOS_TCP_RX_BUFFER_SIZE, NULL, &tx_need_yield);
-			rem = length;
-			while (rem > 0) {
-				ssize_t len = 0;
-				if (tcp_dev->socket_connection != 0) {
-					len = write(tcp_dev->socket_connection, tcp_dev->tx_buffer, length);
-				}
-				if (len <= 0) {
-					rem = 0;
-				} else {
-					rem -= len;
+			if (length <= 0)
+				break;
+
+			/* Fan out to every client. One that can't keep up loses data,
+			 * like on a saturated radio link. Broken connections are closed
+			 * by the I/O thread when it reads from them. */
+			PIOS_Thread_Scheduler_Suspend();
+			for (uint32_t i = 0; i < NELEMENTS(tcp_dev->clients); i++) {
+				int fd = tcp_dev->clients[i];
+				int32_t rem = (fd != -1) ? length : 0;
+				while (rem > 0) {
+					ssize_t len = send(fd, tcp_dev->tx_buffer + length - rem, rem, PIOS_TCP_SEND_FLAGS);
+					if (len <= 0) {
+						rem = 0;
+					} else {
+						rem -= len;
+					}
 				}
 			}
+			PIOS_Thread_Scheduler_Resume();
+
 			tx_bytes_avail -= length;
 #if defined(PIOS_INCLUDE_FREERTOS)
 			// Not sure about this
@@ -33,8 +33,9 @@
 
 #if defined(PIOS_INCLUDE_UDP)
 
-#include <signal.h>
+#include <errno.h>
 #include <pios_udp_priv.h>
+#include <pios_epoll_priv.h>
 #include "pios_thread.h"
 
 /* We need a list of UDP devices */
@@ -47,11 +48,11 @@ static pios_udp_dev pios_udp_devices[PIOS_UDP_MAX_DEV];
 
 
 /* Provide a COM driver */
-static void PIOS_UDP_ChangeBaud(uint32_t udp_id, uint32_t baud);
-static void PIOS_UDP_RegisterRxCallback(uint32_t udp_id, pios_com_callback rx_in_cb, uint32_t context);
-static void PIOS_UDP_RegisterTxCallback(uint32_t udp_id, pios_com_callback tx_out_cb, uint32_t context);
-static void PIOS_UDP_TxStart(uint32_t udp_id, uint16_t tx_bytes_avail);
-static void PIOS_UDP_RxStart(uint32_t udp_id, uint16_t rx_bytes_avail);
+static void PIOS_UDP_ChangeBaud(uintptr_t udp_id, uint32_t baud);
+static void PIOS_UDP_RegisterRxCallback(uintptr_t udp_id, pios_com_callback rx_in_cb, uintptr_t context);
+static void PIOS_UDP_RegisterTxCallback(uintptr_t udp_id, pios_com_callback tx_out_cb, uintptr_t context);
+static void PIOS_UDP_TxStart(uintptr_t udp_id, uint16_t tx_bytes_avail);
+static void PIOS_UDP_RxStart(uintptr_t udp_id, uint16_t rx_bytes_avail);
 
 const struct pios_com_driver pios_udp_com_driver = {
 	.set_baud   = PIOS_UDP_ChangeBaud,
@@ -75,62 +76,89 @@ static pios_udp_dev * find_udp_dev_by_id (uint8_t udp)
 }
 
 /**
- * RxThread
+ * Remember who sent us data so the replies go there. When all the client
+ * slots are taken the one heard from least recently is replaced, so a GCS
+ * that comes back from another port isn't locked out.
  */
-void PIOS_UDP_RxThread(void * udp_dev_n)
+static void PIOS_UDP_AddClient(pios_udp_dev * udp_dev, const struct sockaddr_in * client)
 {
+	uint32_t now = PIOS_Thread_Systime();
 
-	/* needed because of FreeRTOS.posix scheduling */
-	sigset_t set;
-	sigfillset(&set);
-	sigprocmask(SIG_BLOCK, &set, NULL);
-
-	pios_udp_dev * udp_dev = (pios_udp_dev*) udp_dev_n;
-
-   /**
-	* com devices never get closed except by application "reboot"
-	* we also never give up our mutex except for waiting
-	*/
-   while(1) {
-
-		/**
-		 * receive 
-		 */
-		int received;
-		udp_dev->clientLength=sizeof(udp_dev->client);
-		if ((received = recvfrom(udp_dev->socket,
-				&udp_dev->rx_buffer,
-				PIOS_UDP_RX_BUFFER_SIZE,
-				0,
-				(struct sockaddr *) &udp_dev->client,
-				(socklen_t*)&udp_dev->clientLength)) >= 0)
-		{
-
-			/* copy received data to buffer if possible */
-			/* we do NOT buffer data locally. If the com buffer can't receive, data is discarded! */
-			/* (thats what the USART driver does too!) */
-			bool rx_need_yield = false;
-			if (udp_dev->rx_in_cb) {
-			  (void) (udp_dev->rx_in_cb)(udp_dev->rx_in_context, udp_dev->rx_buffer, received, NULL, &rx_need_yield);
-			}
+	PIOS_Thread_Scheduler_Suspend();
 
-#if defined(PIOS_INCLUDE_FREERTOS)
-			if (rx_need_yield) {
-				taskYIELD();
-			}
-#endif	/* PIOS_INCLUDE_FREERTOS */
+	uint8_t slot = udp_dev->num_clients;
+	for (uint8_t i = 0; i < udp_dev->num_clients; i++) {
+		if (udp_dev->clients[i].sin_addr.s_addr == client->sin_addr.s_addr &&
+				udp_dev->clients[i].sin_port == client->sin_port) {
+			slot = i;
+			break;
+		}
+	}
 
+	if (slot == PIOS_UDP_MAX_CLIENTS) {
+		slot = 0;
+		for (uint8_t i = 1; i < udp_dev->num_clients; i++) {
+			if (now - udp_dev->clients_heard[i] > now - udp_dev->clients_heard[slot])
+				slot = i;
 		}
+	} else if (slot == udp_dev->num_clients) {
+		udp_dev->num_clients++;
+	}
 
+	udp_dev->clients[slot] = *client;
+	udp_dev->clients_heard[slot] = now;
+
+	PIOS_Thread_Scheduler_Resume();
+}
+
+/**
+ * Datagram waiting on the socket, called from the I/O thread
+ */
+static void PIOS_UDP_Readable(uintptr_t context, int fd)
+{
+	pios_udp_dev * udp_dev = (pios_udp_dev*) context;
 
+	struct sockaddr_in client;
+	socklen_t clientLength = sizeof(client);
+
+	/* Reading the fd has to be executed in thread suspended mode
+	 * to get a correct errno value. */
+	PIOS_Thread_Scheduler_Suspend();
+
+	int received = recvfrom(fd,
+			udp_dev->rx_buffer,
+			PIOS_UDP_RX_BUFFER_SIZE,
+			0,
+			(struct sockaddr *) &client,
+			&clientLength);
+
+	PIOS_Thread_Scheduler_Resume();
+
+	if (received < 0)
+		return;
+
+	PIOS_UDP_AddClient(udp_dev, &client);
+
+	/* copy received data to buffer if possible */
+	/* we do NOT buffer data locally. If the com buffer can't receive, data is discarded! */
+	/* (thats what the USART driver does too!) */
+	bool rx_need_yield = false;
+	if (udp_dev->rx_in_cb) {
+	  (void) (udp_dev->rx_in_cb)(udp_dev->rx_in_context, udp_dev->rx_buffer, received, NULL, &rx_need_yield);
 	}
+
+#if defined(PIOS_INCLUDE_FREERTOS)
+	if (rx_need_yield) {
+		taskYIELD();
+	}
+#endif	/* PIOS_INCLUDE_FREERTOS */
 }
 
 
 /**
 * Open UDP socket
 */
-int32_t PIOS_UDP_Init(uint32_t * udp_id, const struct pios_udp_cfg * cfg)
+int32_t PIOS_UDP_Init(uintptr_t * udp_id, const struct pios_udp_cfg * cfg)
 {
 
   pios_udp_dev * udp_dev = &pios_udp_devices[pios_udp_num_devices];
@@ -142,19 +170,24 @@ int32_t PIOS_UDP_Init(uint32_t * udp_id, const struct pios_udp_cfg * cfg)
   udp_dev->rx_in_cb = NULL;
   udp_dev->tx_out_cb = NULL;
   udp_dev->cfg=cfg;
+  udp_dev->num_clients = 0;
 
   /* assign socket */
   udp_dev->socket = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
   memset(&udp_dev->server,0,sizeof(udp_dev->server));
-  memset(&udp_dev->client,0,sizeof(udp_dev->client));
   udp_dev->server.sin_family = AF_INET;
   udp_dev->server.sin_addr.s_addr = inet_addr(udp_dev->cfg->ip);
   udp_dev->server.sin_port = htons(udp_dev->cfg->port);
   int res= bind(udp_dev->socket, (struct sockaddr *)&udp_dev->server,sizeof(udp_dev->server));
 
-  /* Create transmit thread for this connection */
-  udp_dev->rxThread = PIOS_Thread_Create(
-		  PIOS_TCP_RxTask, "pios_udp_rx", PIOS_THREAD_STACK_SIZE_MIN, udp_dev, PIOS_THREAD_PRIO_NORMAL);
+  /* Set socket nonblocking. */
+  int flags = fcntl(udp_dev->socket, F_GETFL, 0);
+  if (flags != -1)
+    fcntl(udp_dev->socket, F_SETFL, flags | O_NONBLOCK);
+
+  /* Received datagrams are handled by the shared I/O thread */
+  if (res == 0)
+    res = PIOS_EPOLL_Add(udp_dev->socket, PIOS_UDP_Readable, (uintptr_t)udp_dev);
 
   printf("udp dev %i - socket %i opened - result %i\n",pios_udp_num_devices-1,udp_dev->socket,res);
 
@@ -164,7 +197,7 @@ int32_t PIOS_UDP_Init(uint32_t * udp_id, const struct pios_udp_cfg * cfg)
 }
 
 
-void PIOS_UDP_ChangeBaud(uint32_t udp_id, uint32_t baud)
+void PIOS_UDP_ChangeBaud(uintptr_t udp_id, uint32_t baud)
 {
 	/**
 	 * doesn't apply!
@@ -172,7 +205,7 @@ void PIOS_UDP_ChangeBaud(uint32_t udp_id, uint32_t baud)
 }
 
 
-static void PIOS_UDP_RxStart(uint32_t udp_id, uint16_t rx_bytes_avail)
+static void PIOS_UDP_RxStart(uintptr_t udp_id, uint16_t rx_bytes_avail)
 {
 	/**
 	 * lazy!
@@ -180,13 +213,13 @@ static void PIOS_UDP_RxStart(uint32_t udp_id, uint16_t rx_bytes_avail)
 }
 
 
-static void PIOS_UDP_TxStart(uint32_t udp_id, uint16_t tx_bytes_avail)
+static void PIOS_UDP_TxStart(uintptr_t udp_id, uint16_t tx_bytes_avail)
 {
 	pios_udp_dev * udp_dev = find_udp_dev_by_id(udp_id);
 
 	PIOS_Assert(udp_dev);
 
-	int32_t length,len,rem;
+	int32_t length;
 
 	/**
 	 * we send everything directly whenever notified of data to send (lazy!)
@@ -195,24 +228,25 @@ static void PIOS_UDP_TxStart(uint32_t udp_id, uint16_t tx_bytes_avail)
 		while (tx_bytes_avail>0) {
 			bool tx_need_yield = false;
 			length = (udp_dev->tx_out_cb)(udp_dev->tx_out_context, udp_dev->tx_buffer, PIOS_UDP_RX_BUFFER_SIZE, NULL, &tx_need_yield);
-			rem = length;
-			while (rem>0) {
-				len = sendto(udp_dev->socket, udp_dev->tx_buffer+length-rem, rem, 0,
-						 (struct sockaddr *) &udp_dev->client,
-						 sizeof(udp_dev->client));
-				if (len<=0) {
-					rem=0;
-				} else {
-					rem -= len;
-				}
+			if (length <= 0)
+				break;
+
+			/* Fan out to every peer, datagrams are never split */
+			PIOS_Thread_Scheduler_Suspend();
+			for (uint8_t i = 0; i < udp_dev->num_clients; i++) {
+				sendto(udp_dev->socket, udp_dev->tx_buffer, length, 0,
+						 (struct sockaddr *) &udp_dev->clients[i],
+						 sizeof(udp_dev->clients[i]));
 			}
+			PIOS_Thread_Scheduler_Resume();
+
 			tx_bytes_avail -= length;
 		}
 	}
 
 }
 
-static void PIOS_UDP_RegisterRxCallback(uint32_t udp_id, pios_com_callback rx_in_cb, uint32_t context)
+static void PIOS_UDP_RegisterRxCallback(uintptr_t udp_id, pios_com_callback rx_in_cb, uintptr_t context)
 {
 	pios_udp_dev * udp_dev = find_udp_dev_by_id(udp_id);
 
@@ -226,7 +260,7 @@ static void PIOS_UDP_RegisterRxCallback(uint32_t udp_id, pios_com_callback rx_in
 	udp_dev->rx_in_cb = rx_in_cb;
 }
 
-static void PIOS_UDP_RegisterTxCallback(uint32_t udp_id, pios_com_callback tx_out_cb, uint32_t context)
+static void PIOS_UDP_RegisterTxCallback(uintptr_t udp_id, pios_com_callback tx_out_cb, uintptr_t context)
 {
 	pios_udp_dev * udp_dev = find_udp_dev_by_id(udp_id);
 
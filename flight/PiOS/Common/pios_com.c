@@ -532,6 +532,38 @@ bool PIOS_COM_Available(uintptr_t com_id)
 	return (com_dev->driver->available)(com_dev->lower_id);
 }
 
+/**
+ * Get the number of bytes waiting in the transmit buffer
+ * \param[in] port COM port
+ * \return number of bytes, 0 if the port is not valid or can't transmit
+ */
+uint16_t PIOS_COM_GetTxUsed(uintptr_t com_id)
+{
+	struct pios_com_dev * com_dev = (struct pios_com_dev *)com_id;
+
+	if (!PIOS_COM_validate(com_dev) || !com_dev->has_tx) {
+		return 0;
+	}
+
+	return fifoBuf_getUsed(&com_dev->tx);
+}
+
+/**
+ * Get the free space in the transmit buffer
+ * \param[in] port COM port
+ * \return number of bytes, 0 if the port is not valid or can't transmit
+ */
+uint16_t PIOS_COM_GetTxFree(uintptr_t com_id)
+{
+	struct pios_com_dev * com_dev = (struct pios_com_dev *)com_id;
+
+	if (!PIOS_COM_validate(com_dev) || !com_dev->has_tx) {
+		return 0;
+	}
+
+	return fifoBuf_getFree(&com_dev->tx);
+}
+
 #endif
 
 /**
@@ -184,6 +184,16 @@ uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
 	return diff / us_ticks;
 }
 
+/**
+ * @brief Compare two raw times and convert to us
+ * @return A microsecond value
+ */
+uint32_t PIOS_DELAY_DiffuS2(uint32_t raw, uint32_t later)
+{
+	uint32_t diff = later - raw;
+	return diff / us_ticks;
+}
+
 #endif
 
 /**
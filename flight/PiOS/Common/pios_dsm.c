@@ -275,7 +275,7 @@ stream_error:
 }
 
 /* Update decoder state processing input byte from the DSMx stream */
-static void PIOS_DSM_UpdateState(struct pios_dsm_dev *dsm_dev, uint8_t byte)
+static void PIOS_DSM_UpdateState(struct pios_dsm_dev *dsm_dev, uint8_t byte, bool *need_yield)
 {
 	struct pios_dsm_state *state = &(dsm_dev->state);
 	if (state->frame_found) {
@@ -285,9 +285,11 @@ static void PIOS_DSM_UpdateState(struct pios_dsm_dev *dsm_dev, uint8_t byte)
 			state->received_data[state->byte_count++] = byte;
 			if (state->byte_count == DSM_FRAME_LENGTH) {
 				/* full frame received - process and wait for new one */
-				if (!PIOS_DSM_UnrollChannels(dsm_dev))
+				if (!PIOS_DSM_UnrollChannels(dsm_dev)) {
 					/* data looking good */
 					state->failsafe_timer = 0;
+					PIOS_RCVR_ActiveFromISR(need_yield);
+				}
 
 				/* prepare for the next frame */
 				state->frame_found = 0;
@@ -346,9 +348,12 @@ static uint16_t PIOS_DSM_RxInCallback(uintptr_t context,
 	bool valid = PIOS_DSM_Validate(dsm_dev);
 	PIOS_Assert(valid);
 
+	/* Yield only if a complete frame woke up the receiver task */
+	*need_yield = false;
+
 	/* process byte(s) and clear receive timer */
 	for (uint8_t i = 0; i < buf_len; i++) {
-		PIOS_DSM_UpdateState(dsm_dev, buf[i]);
+		PIOS_DSM_UpdateState(dsm_dev, buf[i], need_yield);
 		dsm_dev->state.receive_timer = 0;
 	}
 
@@ -356,9 +361,6 @@ static uint16_t PIOS_DSM_RxInCallback(uintptr_t context,
 	if (headroom)
 		*headroom = DSM_FRAME_LENGTH;
 
-	/* We never need a yield */
-	*need_yield = false;
-
 	/* Always indicate that all bytes were consumed */
 	return buf_len;
 }
@@ -50,6 +50,24 @@ bool PIOS_heap_malloc_failed_p(void)
 	return malloc_failed_flag;
 }
 
+static bool heap_locked;
+static uint32_t late_allocations;
+
+/**
+ * Count allocations after PIOS_heap_lock(). With DIAG_HEAP_LOCK they
+ * are treated as a bug.
+ */
+static void check_late_allocation(void)
+{
+	if (!heap_locked)
+		return;
+
+	late_allocations++;
+#if defined(DIAG_HEAP_LOCK)
+	PIOS_Assert(0);
+#endif
+}
+
 #if defined(PIOS_INCLUDE_FREERTOS) || defined(PIOS_INCLUDE_CHIBIOS)
 
 #include "pios_thread.h"
@@ -128,6 +146,8 @@ static struct pios_heap pios_standard_heap = {
 void * pvPortMalloc(size_t size) __attribute__((alias ("PIOS_malloc"), weak));
 void * PIOS_malloc(size_t size)
 {
+	check_late_allocation();
+
 	void *buf = simple_malloc(&pios_standard_heap, size);
 
 	if (buf == NULL)
@@ -157,6 +177,8 @@ void * PIOS_malloc_no_dma(size_t size)
 
 	if (buf == NULL)
 		buf = PIOS_malloc(size);
+	else
+		check_late_allocation();
 
 	if (buf == NULL)
 		malloc_failed_hook();
@@ -222,6 +244,23 @@ void PIOS_heap_increase_size(size_t bytes)
 #endif	/* PIOS_INCLUDE_FREERTOS || defined(PIOS_INCLUDE_CHIBIOS) */
 }
 
+/**
+ * Mark the end of the start-up. Everything that is still allocated from
+ * the heap after this is counted in PIOS_heap_get_late_allocations().
+ */
+void PIOS_heap_lock(void)
+{
+	heap_locked = true;
+}
+
+/**
+ * Get the number of heap allocations after PIOS_heap_lock()
+ */
+uint32_t PIOS_heap_get_late_allocations(void)
+{
+	return late_allocations;
+}
+
 /**
  * @}
  * @}
@@ -268,7 +268,7 @@ stream_error:
 }
 
 /* Update decoder state processing input byte from the HoTT stream */
-static void PIOS_HSUM_UpdateState(struct pios_hsum_dev *hsum_dev, uint8_t byte)
+static void PIOS_HSUM_UpdateState(struct pios_hsum_dev *hsum_dev, uint8_t byte, bool *need_yield)
 {
 	struct pios_hsum_state *state = &(hsum_dev->state);
 	if (state->frame_found) {
@@ -282,9 +282,11 @@ static void PIOS_HSUM_UpdateState(struct pios_hsum_dev *hsum_dev, uint8_t byte)
 			}
 			if (state->byte_count == state->frame_length) {
 				/* full frame received - process and wait for new one */
-				if (!PIOS_HSUM_UnrollChannels(hsum_dev))
+				if (!PIOS_HSUM_UnrollChannels(hsum_dev)) {
 					/* data looking good */
 					state->failsafe_timer = 0;
+					PIOS_RCVR_ActiveFromISR(need_yield);
+				}
 				/* prepare for the next frame */
 				state->frame_found = 0;
 			}
@@ -336,9 +338,12 @@ static uint16_t PIOS_HSUM_RxInCallback(uintptr_t context,
 	bool valid = PIOS_HSUM_Validate(hsum_dev);
 	PIOS_Assert(valid);
 
+	/* Yield only if a complete frame woke up the receiver task */
+	*need_yield = false;
+
 	/* process byte(s) and clear receive timer */
 	for (uint8_t i = 0; i < buf_len; i++) {
-		PIOS_HSUM_UpdateState(hsum_dev, buf[i]);
+		PIOS_HSUM_UpdateState(hsum_dev, buf[i], need_yield);
 		hsum_dev->state.receive_timer = 0;
 	}
 
@@ -346,9 +351,6 @@ static uint16_t PIOS_HSUM_RxInCallback(uintptr_t context,
 	if (headroom)
 		*headroom = HSUM_MAX_FRAME_LENGTH;
 
-	/* We never need a yield */
-	*need_yield = false;
-
 	/* Always indicate that all bytes were consumed */
 	return buf_len;
 }
@@ -0,0 +1,157 @@
+/**
+ ******************************************************************************
+ * @file       pios_mempool.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_MEMPOOL Fixed block memory pools
+ * @{
+ * @brief Pools of equally sized blocks that are reused after being freed
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pios.h"
+#include "pios_heap.h"
+#include "pios_mempool.h"
+
+#if defined(PIOS_INCLUDE_FREERTOS) || defined(PIOS_INCLUDE_CHIBIOS)
+#include "pios_thread.h"
+#define POOL_LOCK()     PIOS_Thread_Scheduler_Suspend()
+#define POOL_UNLOCK()   PIOS_Thread_Scheduler_Resume()
+#else
+#define POOL_LOCK()
+#define POOL_UNLOCK()
+#endif /* PIOS_INCLUDE_FREERTOS || PIOS_INCLUDE_CHIBIOS */
+
+//! Take a new block from the heap
+static void *grow_pool(struct pios_mempool *pool)
+{
+	void *block = PIOS_malloc_no_dma(pool->stats.block_size);
+
+	POOL_LOCK();
+	if (block != NULL)
+		pool->stats.blocks++;
+	else
+		pool->stats.failures++;
+	POOL_UNLOCK();
+
+	return block;
+}
+
+/**
+ * Set up an empty pool for blocks whose size is only known at run time
+ *
+ * @param[out] pool       the pool
+ * @param[in] name        name of the pool
+ * @param[in] block_size  bytes per block, rounded up to whole pointers
+ */
+void PIOS_Mempool_Init(struct pios_mempool *pool, const char *name, size_t block_size)
+{
+	*pool = (struct pios_mempool) {
+		.name = name,
+		.stats = { .block_size = PIOS_MEMPOOL_BLOCK_SIZE(block_size) },
+	};
+}
+
+/**
+ * Allocate a block from a pool. When the pool is empty a new block is
+ * taken from the heap.
+ *
+ * @param[in] pool   the pool
+ * @returns the block or NULL if the heap is exhausted
+ */
+void *PIOS_Mempool_Alloc(struct pios_mempool *pool)
+{
+	POOL_LOCK();
+	void *block = pool->free_list;
+	if (block != NULL)
+		pool->free_list = *(void **)block;
+	POOL_UNLOCK();
+
+	if (block == NULL) {
+		block = grow_pool(pool);
+		if (block == NULL)
+			return NULL;
+	}
+
+	POOL_LOCK();
+	pool->stats.in_use++;
+	if (pool->stats.in_use > pool->stats.high_water)
+		pool->stats.high_water = pool->stats.in_use;
+	POOL_UNLOCK();
+
+	return block;
+}
+
+/**
+ * Give a block back to its pool
+ *
+ * @param[in] pool   the pool the block was allocated from
+ * @param[in] block  the block, NULL is ignored
+ */
+void PIOS_Mempool_Free(struct pios_mempool *pool, void *block)
+{
+	if (block == NULL)
+		return;
+
+	POOL_LOCK();
+	*(void **)block = pool->free_list;
+	pool->free_list = block;
+	pool->stats.in_use--;
+	POOL_UNLOCK();
+}
+
+/**
+ * Take blocks from the heap up front so later allocations don't have to
+ *
+ * @param[in] pool        the pool
+ * @param[in] num_blocks  number of free blocks the pool should have
+ * @returns 0 on success, -1 if the heap is exhausted
+ */
+int32_t PIOS_Mempool_Reserve(struct pios_mempool *pool, uint16_t num_blocks)
+{
+	for (uint16_t i = 0; i < num_blocks; i++) {
+		void *block = grow_pool(pool);
+		if (block == NULL)
+			return -1;
+
+		POOL_LOCK();
+		*(void **)block = pool->free_list;
+		pool->free_list = block;
+		POOL_UNLOCK();
+	}
+
+	return 0;
+}
+
+/**
+ * Get the statistics of a pool
+ *
+ * @param[in] pool    the pool
+ * @param[out] stats  the statistics
+ */
+void PIOS_Mempool_GetStats(struct pios_mempool *pool, struct pios_mempool_stats *stats)
+{
+	POOL_LOCK();
+	*stats = pool->stats;
+	POOL_UNLOCK();
+}
+
+/**
+ * @}
+ * @}
+ */
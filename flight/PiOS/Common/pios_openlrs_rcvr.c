@@ -138,6 +138,9 @@ int32_t PIOS_OpenLRS_Rcvr_UpdateChannels(uintptr_t openlrs_rcvr_id, int16_t * ch
 	// let supervisor know we have new data
 	openlrs_rcvr_dev->fresh = true;
 
+	// and the receiver task that a frame is complete
+	PIOS_RCVR_Active();
+
 	return 0;
 }
 
@@ -26,11 +26,26 @@
 
 #include "pios.h"
 #include "pios_queue.h"
+#include "pios_thread.h"
+#include "pios_mempool.h"
 
 #if !defined(PIOS_INCLUDE_FREERTOS) && !defined(PIOS_INCLUDE_CHIBIOS)
 #error "pios_queue.c requires PIOS_INCLUDE_FREERTOS or PIOS_INCLUDE_CHIBIOS"
 #endif
 
+//! Queue headers, queues are usually created once but some are deleted and created again
+static struct pios_mempool queue_pool = PIOS_MEMPOOL_INIT("Queues", struct pios_queue);
+
+/**
+ * Get the statistics of the pool the queues are allocated from
+ *
+ * @param[out] stats  the statistics
+ */
+void PIOS_Queue_GetPoolStats(struct pios_mempool_stats *stats)
+{
+	PIOS_Mempool_GetStats(&queue_pool, stats);
+}
+
 #if defined(PIOS_INCLUDE_FREERTOS)
 
 #include "FreeRTOS.h"
@@ -52,7 +67,7 @@
  */
 struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
 {
-	struct pios_queue *queuep = PIOS_malloc(sizeof(struct pios_queue));
+	struct pios_queue *queuep = PIOS_Mempool_Alloc(&queue_pool);
 
 	if (queuep == NULL)
 		return NULL;
@@ -61,7 +76,7 @@ struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
 
 	if ((queuep->queue_handle = (uintptr_t)xQueueCreate(queue_length, item_size)) == (uintptr_t)NULL)
 	{
-		PIOS_free(queuep);
+		PIOS_Mempool_Free(&queue_pool, queuep);
 		return NULL;
 	}
 
@@ -78,7 +93,7 @@ struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
 void PIOS_Queue_Delete(struct pios_queue *queuep)
 {
 	vQueueDelete((xQueueHandle)queuep->queue_handle);
-	PIOS_free(queuep);
+	PIOS_Mempool_Free(&queue_pool, queuep);
 }
 
 /**
@@ -138,6 +153,31 @@ bool PIOS_Queue_Receive(struct pios_queue *queuep, void *itemp, uint32_t timeout
 #define PIOS_QUEUE_MAX_WAITERS 2
 #endif /* !defined(PIOS_QUEUE_MAX_WAITERS) */
 
+/*
+ * Item and mailbox storage of the queues, by size class, so that a queue
+ * which is deleted and created again reuses its storage. Storage larger
+ * than the largest class comes from the heap and is lost when the queue
+ * is deleted, as the heap doesn't free.
+ */
+static struct pios_mempool storage_pools[] = {
+	PIOS_MEMPOOL_INIT("QueueStorage64", uint8_t[64]),
+	PIOS_MEMPOOL_INIT("QueueStorage128", uint8_t[128]),
+	PIOS_MEMPOOL_INIT("QueueStorage256", uint8_t[256]),
+	PIOS_MEMPOOL_INIT("QueueStorage512", uint8_t[512]),
+	PIOS_MEMPOOL_INIT("QueueStorage1024", uint8_t[1024]),
+};
+
+//! Smallest storage pool with blocks of at least size bytes, NULL if none
+static struct pios_mempool *storage_pool(size_t size)
+{
+	for (uint8_t i = 0; i < sizeof(storage_pools) / sizeof(storage_pools[0]); i++) {
+		if (size <= storage_pools[i].stats.block_size)
+			return &storage_pools[i];
+	}
+
+	return NULL;
+}
+
 /**
  *
  * @brief   Creates a queue.
@@ -147,21 +187,32 @@ bool PIOS_Queue_Receive(struct pios_queue *queuep, void *itemp, uint32_t timeout
  */
 struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
 {
-	struct pios_queue *queuep = PIOS_malloc(sizeof(struct pios_queue));
+	struct pios_queue *queuep = PIOS_Mempool_Alloc(&queue_pool);
 	if (queuep == NULL)
 		return NULL;
 
-	/* Create the memory pool. */
-	queuep->mpb = PIOS_malloc(item_size * (queue_length + PIOS_QUEUE_MAX_WAITERS));
+	/* Items and mailbox share one block of the storage pools. */
+	size_t items_size = item_size * (queue_length + PIOS_QUEUE_MAX_WAITERS);
+	items_size = (items_size + sizeof(msg_t) - 1) & ~(sizeof(msg_t) - 1);
+	size_t storage_size = items_size + sizeof(msg_t) * queue_length;
+
+	queuep->mpb_pool = storage_pool(storage_size);
+	if (queuep->mpb_pool != NULL)
+		queuep->mpb = PIOS_Mempool_Alloc(queuep->mpb_pool);
+	else
+		queuep->mpb = PIOS_malloc(storage_size);
+
 	if (queuep->mpb == NULL) {
-		PIOS_free(queuep);
+		PIOS_Mempool_Free(&queue_pool, queuep);
 		return NULL;
 	}
+
+	/* Create the memory pool. */
 	chPoolInit(&queuep->mp, item_size, NULL);
 	chPoolLoadArray(&queuep->mp, queuep->mpb, queue_length + PIOS_QUEUE_MAX_WAITERS);
 
 	/* Create the mailbox. */
-	msg_t *mb_buf = PIOS_malloc(sizeof(msg_t) * queue_length);
+	msg_t *mb_buf = (msg_t *)((uint8_t *)queuep->mpb + items_size);
 	chMBInit(&queuep->mb, mb_buf, queue_length);
 
 	return queuep;
@@ -176,8 +227,11 @@ struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
  */
 void PIOS_Queue_Delete(struct pios_queue *queuep)
 {
-	PIOS_free(queuep->mpb);
-	PIOS_free(queuep);
+	if (queuep->mpb_pool != NULL)
+		PIOS_Mempool_Free(queuep->mpb_pool, queuep->mpb);
+	else
+		PIOS_free(queuep->mpb);
+	PIOS_Mempool_Free(&queue_pool, queuep);
 }
 
 /**
@@ -207,6 +261,12 @@ bool PIOS_Queue_Send(struct pios_queue *queuep, const void *itemp, uint32_t time
 	else
 		timeout = MS2ST(timeout_ms);
 
+#if defined(DIAG_TASK_PROFILE)
+	// A receiver can only be waiting for the first item
+	if (chMBGetUsedCountI(&queuep->mb) == 0)
+		queuep->post_raw = PIOS_DELAY_GetRaw();
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 	msg_t result = chMBPost(&queuep->mb, (msg_t)buf, timeout);
 
 	if (result != RDY_OK)
@@ -241,6 +301,11 @@ bool PIOS_Queue_Send_FromISR(struct pios_queue *queuep, const void *itemp, bool
 
 	memcpy(buf, itemp, queuep->mp.mp_object_size);
 
+#if defined(DIAG_TASK_PROFILE)
+	if (chMBGetUsedCountI(&queuep->mb) == 0)
+		queuep->post_raw = PIOS_DELAY_GetRaw();
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 	msg_t result = chMBPostI(&queuep->mb, (msg_t)buf);
 
 	if (result != RDY_OK)
@@ -278,11 +343,21 @@ bool PIOS_Queue_Receive(struct pios_queue *queuep, void *itemp, uint32_t timeout
 	else
 		timeout = MS2ST(timeout_ms);
 
+#if defined(DIAG_TASK_PROFILE)
+	bool empty = chMBGetUsedCountI(&queuep->mb) == 0;
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 	msg_t result = chMBFetch(&queuep->mb, &buf, timeout);
 
 	if (result != RDY_OK)
 		return false;
 
+#if defined(DIAG_TASK_PROFILE)
+	// The thread waited for this item
+	if (empty)
+		PIOS_Thread_Profile_Wakeup(queuep->post_raw);
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 	memcpy(itemp, (void*)buf, queuep->mp.mp_object_size);
 
 	chPoolFree(&queuep->mp, (void*)buf);
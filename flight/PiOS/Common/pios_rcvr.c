@@ -4,6 +4,8 @@
 #if defined(PIOS_INCLUDE_RCVR)
 
 #include <pios_rcvr_priv.h>
+#include "pios_semaphore.h"
+#include "pios_thread.h"
 
 enum pios_rcvr_dev_magic {
   PIOS_RCVR_DEV_MAGIC = 0x99aabbcc,
@@ -15,6 +17,9 @@ struct pios_rcvr_dev {
   const struct pios_rcvr_driver * driver;
 };
 
+static struct pios_semaphore *rcvr_activity;
+static volatile uint32_t rcvr_last_frame;
+
 static bool PIOS_RCVR_validate(struct pios_rcvr_dev * rcvr_dev)
 {
   return (rcvr_dev->magic == PIOS_RCVR_DEV_MAGIC);
@@ -108,6 +113,59 @@ int32_t PIOS_RCVR_Read(uintptr_t rcvr_id, uint8_t channel)
   return rcvr_dev->driver->read(rcvr_dev->lower_id, channel);
 }
 
+/**
+ * @brief Called by the receiver drivers when a complete frame has been
+ * decoded and all its channels can be read. Wakes up the task waiting
+ * in PIOS_RCVR_WaitActivity.
+ * @param[out] woken set to true if a higher priority task was woken
+ */
+void PIOS_RCVR_ActiveFromISR(bool *woken)
+{
+	rcvr_last_frame = PIOS_DELAY_GetRaw();
+
+	if (rcvr_activity != NULL)
+		PIOS_Semaphore_Give_FromISR(rcvr_activity, woken);
+}
+
+/**
+ * @brief Same as PIOS_RCVR_ActiveFromISR for drivers that decode their
+ * frames in a task
+ */
+void PIOS_RCVR_Active(void)
+{
+	rcvr_last_frame = PIOS_DELAY_GetRaw();
+
+	if (rcvr_activity != NULL)
+		PIOS_Semaphore_Give(rcvr_activity);
+}
+
+/**
+ * @brief Wait until a receiver decoded a new frame
+ * @param[in] timeout_ms maximum time to wait
+ * @returns true if a frame arrived, false on timeout
+ */
+bool PIOS_RCVR_WaitActivity(uint32_t timeout_ms)
+{
+	if (rcvr_activity == NULL) {
+		rcvr_activity = PIOS_Semaphore_Create();
+		if (rcvr_activity == NULL) {
+			PIOS_Thread_Sleep(timeout_ms);
+			return false;
+		}
+	}
+
+	return PIOS_Semaphore_Take(rcvr_activity, timeout_ms);
+}
+
+/**
+ * @brief Get the time the last frame was decoded by any receiver
+ * @returns the PIOS_DELAY_GetRaw() value of the last frame
+ */
+uint32_t PIOS_RCVR_GetLastActivity(void)
+{
+	return rcvr_last_frame;
+}
+
 #endif
 
 /**
@@ -1829,12 +1829,8 @@ static enum pios_radio_event radio_txStart(struct pios_rfm22b_dev
 
 		// The last byte is a CRC.
 		if (radio_dev->ppm_only_mode) {
-			uint8_t crc = 0;
-			for (uint8_t i = 0;
-			     i < RFM22B_PPM_NUM_CHANNELS + 1; ++i) {
-				crc = PIOS_CRC_updateByte(crc, p[i]);
-			}
-			p[RFM22B_PPM_NUM_CHANNELS + 1] = crc;
+			p[RFM22B_PPM_NUM_CHANNELS + 1] =
+			    PIOS_CRC_updateCRC(0, p, RFM22B_PPM_NUM_CHANNELS + 1);
 		}
 	}
 
@@ -1940,12 +1936,13 @@ static enum pios_radio_event radio_receivePacket(struct pios_rfm22b_dev
 
 		// Attempt to correct any errors in the packet.
 		if (data_len > 0) {
-			decode_data((unsigned char *)p, rx_len);
-			good_packet = check_syndrome() == 0;
+			struct ecc_decoder ecc;
+			decode_data(&ecc, (unsigned char *)p, rx_len);
+			good_packet = check_syndrome(&ecc) == 0;
 
 			// We have an error.  Try to correct it.
 			if (!good_packet &&
-			    (correct_errors_erasures((unsigned char *)p, rx_len, 0, 0) != 0)) {
+			    (correct_errors_erasures(&ecc, (unsigned char *)p, rx_len, 0, 0) != 0)) {
 				// We corrected it
 				corrected_packet = true;
 			}
@@ -1978,10 +1975,7 @@ static enum pios_radio_event radio_receivePacket(struct pios_rfm22b_dev
 
 		// Verify the CRC if this is a PPM only packet.
 		if (good_packet && radio_dev->ppm_only_mode) {
-			uint8_t crc = 0;
-			for (uint8_t i = 0; i < RFM22B_PPM_NUM_CHANNELS + 1; ++i) {
-				crc = PIOS_CRC_updateByte(crc, p[i]);
-			}
+			uint8_t crc = PIOS_CRC_updateCRC(0, p, RFM22B_PPM_NUM_CHANNELS + 1);
 			if (p[RFM22B_PPM_NUM_CHANNELS + 1] != crc) {
 				good_packet = false;
 				corrected_packet = false;
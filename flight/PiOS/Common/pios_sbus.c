@@ -208,7 +208,7 @@ static void PIOS_SBus_UnrollChannels(struct pios_sbus_state *state)
 }
 
 /* Update decoder state processing input byte from the S.Bus stream */
-static void PIOS_SBus_UpdateState(struct pios_sbus_state *state, uint8_t b)
+static void PIOS_SBus_UpdateState(struct pios_sbus_state *state, uint8_t b, bool *need_yield)
 {
 	/* should not process any data until new frame is found */
 	if (!state->frame_found)
@@ -243,6 +243,7 @@ static void PIOS_SBus_UpdateState(struct pios_sbus_state *state, uint8_t b)
 				/* data looking good */
 				PIOS_SBus_UnrollChannels(state);
 				state->failsafe_timer = 0;
+				PIOS_RCVR_ActiveFromISR(need_yield);
 			}
 		} else {
 			/* discard whole frame */
@@ -267,9 +268,12 @@ static uint16_t PIOS_SBus_RxInCallback(uintptr_t context,
 
 	struct pios_sbus_state *state = &(sbus_dev->state);
 
+	/* Yield only if a complete frame woke up the receiver task */
+	*need_yield = false;
+
 	/* process byte(s) and clear receive timer */
 	for (uint8_t i = 0; i < buf_len; i++) {
-		PIOS_SBus_UpdateState(state, buf[i]);
+		PIOS_SBus_UpdateState(state, buf[i], need_yield);
 		state->receive_timer = 0;
 	}
 
@@ -277,9 +281,6 @@ static uint16_t PIOS_SBus_RxInCallback(uintptr_t context,
 	if (headroom)
 		*headroom = SBUS_FRAME_LENGTH;
 
-	/* We never need a yield */
-	*need_yield = false;
-
 	/* Always indicate that all bytes were consumed */
 	return buf_len;
 }
@@ -215,6 +215,146 @@ static uint32_t ceil_size(uint32_t size)
 	size = size + (a - size % a);
 	return size;
 }
+#if defined(DIAG_TASK_PROFILE)
+
+/* Profile of a thread and the state needed to build it */
+struct pios_thread_profile_state
+{
+	struct pios_thread_profile data;
+	const char *name;
+	struct pios_thread_profile_state *next;
+	uint32_t switched_in;   /* raw time the thread last started running */
+	uint32_t woken;         /* raw time the thread started running after blocking */
+	uint32_t active_us;     /* running time of the current activation */
+	bool blocked;
+};
+
+static struct pios_thread_profile_state *profiles;
+
+/**
+ * Count a time in a log2 histogram
+ */
+static void profile_add(uint32_t *histogram, uint32_t *max, uint32_t us)
+{
+	uint32_t bucket = (us == 0) ? 0 : 32 - __builtin_clz(us);
+	if (bucket >= PIOS_THREAD_PROFILE_BUCKETS)
+		bucket = PIOS_THREAD_PROFILE_BUCKETS - 1;
+
+	histogram[bucket]++;
+	if (us > *max)
+		*max = us;
+}
+
+/**
+ * Called by THREAD_CONTEXT_SWITCH_HOOK with the kernel locked. A thread that
+ * is switched out while still ready was preempted, otherwise it blocked and
+ * its activation is over.
+ */
+void PIOS_Thread_Profile_Switch(Thread *ntp, Thread *otp)
+{
+	uint32_t now = PIOS_DELAY_GetRaw();
+	struct pios_thread_profile_state *profile = otp->profile;
+
+	if (profile != NULL) {
+		profile->active_us += PIOS_DELAY_DiffuS2(profile->switched_in, now);
+
+		if (otp->p_state == THD_STATE_READY) {
+			profile->data.preemptions++;
+		} else {
+			profile_add(profile->data.runtime, &profile->data.max_runtime, profile->active_us);
+			profile->data.activations++;
+			profile->active_us = 0;
+			profile->blocked = true;
+		}
+	}
+
+	profile = ntp->profile;
+
+	if (profile != NULL) {
+		profile->switched_in = now;
+
+		if (profile->blocked) {
+			profile->woken = now;
+			profile->blocked = false;
+		}
+	}
+}
+
+/**
+ *
+ * @brief   Records the latency of the calling thread after it blocked on an event.
+ *
+ * @param[in] ready_raw    raw time (PIOS_DELAY_GetRaw) the event happened
+ *
+ */
+void PIOS_Thread_Profile_Wakeup(uint32_t ready_raw)
+{
+	chSysLock();
+
+	struct pios_thread_profile_state *profile = chThdSelf()->profile;
+
+	// Only when the thread started running after the event
+	if (profile != NULL && (int32_t)(profile->woken - ready_raw) >= 0)
+		profile_add(profile->data.latency, &profile->data.max_latency,
+				PIOS_DELAY_DiffuS2(ready_raw, profile->woken));
+
+	chSysUnlock();
+}
+
+/**
+ *
+ * @brief   Returns the scheduling profile of a thread.
+ *
+ * @param[in] threadp      pointer to instance of @p struct pios_thread
+ * @param[out] profile     the profile since the thread was created
+ *
+ * @return true on success, false if the thread is not profiled
+ *
+ */
+bool PIOS_Thread_Get_Profile(struct pios_thread *threadp, struct pios_thread_profile *profile)
+{
+	chSysLock();
+
+	struct pios_thread_profile_state *state = threadp->threadp->profile;
+	if (state != NULL)
+		*profile = state->data;
+
+	chSysUnlock();
+
+	return state != NULL;
+}
+
+#if defined(SIM_POSIX)
+/**
+ *
+ * @brief   Prints the scheduling profile of all threads.
+ *
+ */
+void PIOS_Thread_Profile_Dump(void)
+{
+	for (struct pios_thread_profile_state *state = profiles; state != NULL; state = state->next) {
+		struct pios_thread_profile profile;
+
+		chSysLock();
+		profile = state->data;
+		chSysUnlock();
+
+		printf("%s: %u activations, %u preemptions, max latency %u us, max runtime %u us\n",
+				state->name, (unsigned int)profile.activations, (unsigned int)profile.preemptions,
+				(unsigned int)profile.max_latency, (unsigned int)profile.max_runtime);
+		printf("%12s %12s %12s\n", "us <", "latency", "runtime");
+		for (int i = 0; i < PIOS_THREAD_PROFILE_BUCKETS; i++) {
+			char limit[12] = "inf";
+			if (i < PIOS_THREAD_PROFILE_BUCKETS - 1)
+				snprintf(limit, sizeof(limit), "%u", 1u << i);
+			printf("%12s %12u %12u\n", limit, (unsigned int)profile.latency[i], (unsigned int)profile.runtime[i]);
+		}
+	}
+}
+#endif /* defined(SIM_POSIX) */
+
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 /**
  * ChibiOS stack expects alignment (both start and end)
  * to 8 byte boundaries. This makes sure to allocate enough
@@ -282,6 +422,21 @@ struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, si
 	thread->threadp->p_name = namep;
 #endif /* CH_USE_REGISTRY */
 
+#if defined(DIAG_TASK_PROFILE)
+	struct pios_thread_profile_state *profile = PIOS_malloc(sizeof(*profile));
+	if (profile != NULL) {
+		memset(profile, 0, sizeof(*profile));
+		profile->name = namep;
+
+		chSysLock();
+		profile->next = profiles;
+		profiles = profile;
+		profile->switched_in = PIOS_DELAY_GetRaw();
+		thread->threadp->profile = profile;
+		chSysUnlock();
+	}
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 	return thread;
 }
 
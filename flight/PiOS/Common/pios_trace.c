@@ -0,0 +1,92 @@
+/**
+ ******************************************************************************
+ * @file       pios_trace.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_TRACE Hot path trace buffer
+ * @{
+ * @brief Ring of timestamped events to see the order and timing of the tasks
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pios.h"
+
+#if defined(PIOS_INCLUDE_TRACE)
+
+#include "pios_trace.h"
+
+struct pios_trace pios_trace = {
+	.head = 0,
+	.enabled = true,
+};
+
+static uint32_t frozen_head;
+
+/**
+ * Stop recording so the content can be read out. Writers that were
+ * already past the enabled check still finish their event.
+ *
+ * @returns number of events that can be read with PIOS_Trace_Get
+ */
+uint32_t PIOS_Trace_Freeze(void)
+{
+	pios_trace.enabled = false;
+	frozen_head = pios_trace.head;
+
+	if (frozen_head > PIOS_TRACE_EVENTS)
+		return PIOS_TRACE_EVENTS;
+
+	return frozen_head;
+}
+
+/**
+ * Read an event from a frozen trace
+ *
+ * @param[in] n       index of the event, 0 is the oldest one
+ * @param[out] event  the event
+ * @returns true if the event exists
+ */
+bool PIOS_Trace_Get(uint32_t n, struct pios_trace_event *event)
+{
+	uint32_t count = frozen_head > PIOS_TRACE_EVENTS ? PIOS_TRACE_EVENTS : frozen_head;
+
+	if (pios_trace.enabled || n >= count)
+		return false;
+
+	uint32_t slot = (frozen_head - count + n) & (PIOS_TRACE_EVENTS - 1);
+	*event = pios_trace.events[slot];
+
+	return true;
+}
+
+/**
+ * Clear the trace and start recording again
+ */
+void PIOS_Trace_Resume(void)
+{
+	pios_trace.head = 0;
+	frozen_head = 0;
+	pios_trace.enabled = true;
+}
+
+#endif /* PIOS_INCLUDE_TRACE */
+
+/**
+ * @}
+ * @}
+ */
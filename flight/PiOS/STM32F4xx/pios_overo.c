@@ -157,20 +157,21 @@ void PIOS_OVERO_DMA_irq_handler(uintptr_t overo_id)
 	overo_dev->writing_buffer = 1 - DMA_GetCurrentMemoryTarget(overo_dev->cfg->dma.tx.channel);
 	overo_dev->writing_offset = 0;
 
-#if 0
-	bool rx_need_yield = false;
-	// Get data from the Rx buffer and add to the fifo
-	(void) (overo_dev->rx_in_cb)(overo_dev->rx_in_context, 
-								 &overo_dev->rx_buffer[overo_dev->writing_buffer][0], 
-								PACKET_SIZE, NULL, &rx_need_yield);
+	if (overo_dev->rx_in_cb) {
+		bool rx_need_yield = false;
+		// Get data from the Rx buffer and add to the fifo.  The unused part of the
+		// transfer is 0xFF which the UAVTalk parser skips while looking for a sync
+		(void) (overo_dev->rx_in_cb)(overo_dev->rx_in_context,
+									 &overo_dev->rx_buffer[overo_dev->writing_buffer][0],
+									 PACKET_SIZE, NULL, &rx_need_yield);
 
 #if defined(PIOS_INCLUDE_FREERTOS)
-	portEND_SWITCHING_ISR(rx_need_yield ? pdTRUE : pdFALSE);
+		portEND_SWITCHING_ISR(rx_need_yield ? pdTRUE : pdFALSE);
 #endif /* defined(PIOS_INCLUDE_FREERTOS) */
 
-	// Fill the buffer with known value to prevent rereading these bytes
-	memset(&overo_dev->rx_buffer[overo_dev->writing_buffer][0], 0xFF, PACKET_SIZE);
-#endif
+		// Fill the buffer with known value to prevent rereading these bytes
+		memset(&overo_dev->rx_buffer[overo_dev->writing_buffer][0], 0xFF, PACKET_SIZE);
+	}
 
 	// Fill the buffer with known value to prevent resending any bytes
 	memset(&overo_dev->tx_buffer[overo_dev->writing_buffer][0], 0xFF, PACKET_SIZE);
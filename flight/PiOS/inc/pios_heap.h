@@ -29,6 +29,7 @@
 
 #include <stdlib.h>		/* size_t */
 #include <stdbool.h>		/* bool */
+#include <stdint.h>		/* uint32_t */
 
 extern bool PIOS_heap_malloc_failed_p(void);
 
@@ -40,5 +41,7 @@ extern void PIOS_free(void * buf);
 extern size_t PIOS_heap_get_free_size(void);
 extern void PIOS_heap_initialize_blocks(void);
 extern void PIOS_heap_increase_size(size_t bytes);
+extern void PIOS_heap_lock(void);
+extern uint32_t PIOS_heap_get_late_allocations(void);
 
 #endif	/* PIOS_HEAP_H */
@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @file       pios_mempool.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_MEMPOOL Fixed block memory pools
+ * @{
+ * @brief Pools of equally sized blocks that are reused after being freed
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_MEMPOOL_H
+#define PIOS_MEMPOOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct pios_mempool_stats {
+	uint16_t block_size;    // bytes per block
+	uint16_t blocks;        // blocks taken from the heap
+	uint16_t in_use;        // blocks allocated right now
+	uint16_t high_water;    // most blocks ever allocated at the same time
+	uint16_t failures;      // allocations that failed because the heap was exhausted
+};
+
+/**
+ * A pool of blocks of one type. Blocks are taken from the heap when the
+ * pool runs empty and go back to the pool when they are freed, so the
+ * heap only grows up to the highest number of blocks ever in use.
+ */
+struct pios_mempool {
+	const char *name;
+	void *free_list;
+	struct pios_mempool_stats stats;
+};
+
+//! Block sizes are rounded up to whole pointers
+#define PIOS_MEMPOOL_BLOCK_SIZE(size) (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+//! Initializer for a pool of blocks of the given type
+#define PIOS_MEMPOOL_INIT(pool_name, type) { \
+	.name = (pool_name), \
+	.stats = { .block_size = PIOS_MEMPOOL_BLOCK_SIZE(sizeof(type)) }, \
+}
+
+extern void PIOS_Mempool_Init(struct pios_mempool *pool, const char *name, size_t block_size);
+extern void *PIOS_Mempool_Alloc(struct pios_mempool *pool);
+extern void PIOS_Mempool_Free(struct pios_mempool *pool, void *block);
+extern int32_t PIOS_Mempool_Reserve(struct pios_mempool *pool, uint16_t num_blocks);
+extern void PIOS_Mempool_GetStats(struct pios_mempool *pool, struct pios_mempool_stats *stats);
+
+#endif /* PIOS_MEMPOOL_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -48,6 +48,10 @@ struct pios_queue
 	Mailbox mb;
 	MemoryPool mp;
 	void *mpb;
+	struct pios_mempool *mpb_pool;  /* pool mpb came from, NULL if from the heap */
+#if defined(DIAG_TASK_PROFILE)
+	uint32_t post_raw;      /* raw time the last item was posted to the empty queue */
+#endif /* defined(DIAG_TASK_PROFILE) */
 };
 
 #endif /* defined(PIOS_INCLUDE_FREERTOS) */
@@ -68,6 +72,9 @@ bool PIOS_Queue_Send(struct pios_queue *queuep, const void *itemp, uint32_t time
 bool PIOS_Queue_Send_FromISR(struct pios_queue *queuep, const void *itemp, bool *wokenp);
 bool PIOS_Queue_Receive(struct pios_queue *queuep, void *itemp, uint32_t timeout_ms);
 
+struct pios_mempool_stats;
+void PIOS_Queue_GetPoolStats(struct pios_mempool_stats *stats);
+
 #endif /* PIOS_QUEUE_H_ */
 
 /**
@@ -38,6 +38,10 @@ struct pios_rcvr_driver {
 
 /* Public Functions */
 extern int32_t PIOS_RCVR_Read(uintptr_t rcvr_id, uint8_t channel);
+extern bool PIOS_RCVR_WaitActivity(uint32_t timeout_ms);
+extern uint32_t PIOS_RCVR_GetLastActivity(void);
+extern void PIOS_RCVR_ActiveFromISR(bool *woken);
+extern void PIOS_RCVR_Active(void);
 
 /*! Define error codes for PIOS_RCVR_Get */
 enum PIOS_RCVR_errors {
@@ -89,6 +89,37 @@ uint32_t PIOS_Thread_Get_Runtime(struct pios_thread *threadp);
 void PIOS_Thread_Scheduler_Suspend(void);
 void PIOS_Thread_Scheduler_Resume(void);
 
+#if defined(DIAG_TASK_PROFILE)
+
+#if !defined(PIOS_INCLUDE_CHIBIOS)
+#error "DIAG_TASK_PROFILE requires PIOS_INCLUDE_CHIBIOS"
+#endif
+
+#define PIOS_THREAD_PROFILE_BUCKETS 16
+
+/*
+ * Scheduling statistics of a thread. The histograms have log2 buckets in
+ * microseconds: bucket 0 counts times below 1 us, bucket n times from
+ * 2^(n-1) to 2^n us and the last bucket everything longer.
+ */
+struct pios_thread_profile
+{
+	uint32_t latency[PIOS_THREAD_PROFILE_BUCKETS];  /* from a queue post to running */
+	uint32_t runtime[PIOS_THREAD_PROFILE_BUCKETS];  /* running time of each activation */
+	uint32_t activations;                           /* times the thread blocked after running */
+	uint32_t preemptions;                           /* times the thread was switched out while ready */
+	uint32_t max_latency;
+	uint32_t max_runtime;
+};
+
+bool PIOS_Thread_Get_Profile(struct pios_thread *threadp, struct pios_thread_profile *profile);
+void PIOS_Thread_Profile_Wakeup(uint32_t ready_raw);
+#if defined(SIM_POSIX)
+void PIOS_Thread_Profile_Dump(void);
+#endif /* defined(SIM_POSIX) */
+
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 #endif /* PIOS_THREAD_H_ */
 
 /**
@@ -0,0 +1,116 @@
+/**
+ ******************************************************************************
+ * @file       pios_trace.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_TRACE Hot path trace buffer
+ * @{
+ * @brief Ring of timestamped events to see the order and timing of the tasks
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_TRACE_H
+#define PIOS_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Trace event ids. The Event field of the TraceData object has to list
+ * the same names in the same order.
+ */
+enum pios_trace_id {
+	PIOS_TRACE_NONE = 0,
+	PIOS_TRACE_SENSORS_START,
+	PIOS_TRACE_SENSORS_END,
+	PIOS_TRACE_ATTITUDE_START,
+	PIOS_TRACE_ATTITUDE_END,
+	PIOS_TRACE_STABILIZATION_START,
+	PIOS_TRACE_STABILIZATION_END,
+	PIOS_TRACE_ACTUATOR_START,
+	PIOS_TRACE_ACTUATOR_END,
+	PIOS_TRACE_UAVTALK_SEND,
+	PIOS_TRACE_UAVTALK_RECEIVE,
+	PIOS_TRACE_EVENT_DISPATCH,
+	PIOS_TRACE_NUM_IDS
+};
+
+#if defined(PIOS_INCLUDE_TRACE)
+
+#include "pios_delay.h"
+
+//! Number of events kept, has to be a power of two
+#ifndef PIOS_TRACE_EVENTS
+#define PIOS_TRACE_EVENTS 256
+#endif
+
+#if (PIOS_TRACE_EVENTS & (PIOS_TRACE_EVENTS - 1)) != 0
+#error PIOS_TRACE_EVENTS has to be a power of two
+#endif
+
+struct pios_trace_event {
+	uint32_t time;          // PIOS_DELAY_GetRaw() when the event happened
+	uint32_t data;          // meaning depends on the event, wide enough for an object id
+	uint8_t id;             // enum pios_trace_id
+};
+
+struct pios_trace {
+	volatile uint32_t head; // total number of events written
+	volatile bool enabled;
+	struct pios_trace_event events[PIOS_TRACE_EVENTS];
+};
+
+extern struct pios_trace pios_trace;
+
+/**
+ * Add an event to the trace. Safe to call from any task and from
+ * interrupts, the slot is claimed with a single atomic increment so
+ * writers never wait for each other.
+ *
+ * @param[in] id    the event, one of enum pios_trace_id
+ * @param[in] data  payload stored with the event
+ */
+static inline void PIOS_Trace(uint8_t id, uint32_t data)
+{
+	if (!pios_trace.enabled)
+		return;
+
+	uint32_t slot = __sync_fetch_and_add(&pios_trace.head, 1) & (PIOS_TRACE_EVENTS - 1);
+	struct pios_trace_event *event = &pios_trace.events[slot];
+
+	event->time = PIOS_DELAY_GetRaw();
+	event->id = id;
+	event->data = data;
+}
+
+extern uint32_t PIOS_Trace_Freeze(void);
+extern bool PIOS_Trace_Get(uint32_t n, struct pios_trace_event *event);
+extern void PIOS_Trace_Resume(void);
+
+#else
+
+#define PIOS_Trace(id, data) do { } while (0)
+
+#endif /* PIOS_INCLUDE_TRACE */
+
+#endif /* PIOS_TRACE_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -112,6 +112,7 @@
 
 /* PIOS Hardware Includes (Common) */
 #include <pios_heap.h>
+#include <pios_trace.h>
 #include <pios_sdcard.h>
 #include <pios_com.h>
 #if defined(PIOS_INCLUDE_MPXV7002)
@@ -33,6 +33,7 @@
 #include "pios_mutex.h"
 #include "pios_thread.h"
 #include "pios_queue.h"
+#include "pios_mempool.h"
 
 // Private constants
 #if defined(PIOS_EVENTDISAPTCHER_QUEUE)
@@ -79,6 +80,7 @@ static struct pios_queue *queue;
 static struct pios_thread *eventTaskHandle;
 static struct pios_recursive_mutex *mutex;
 static EventStats stats;
+static struct pios_mempool periodic_pool = PIOS_MEMPOOL_INIT("PeriodicEvents", PeriodicObjectList);
 
 // Private functions
 static int32_t processPeriodicUpdates();
@@ -124,6 +126,15 @@ void EventGetStats(EventStats* statsOut)
 	PIOS_Recursive_Mutex_Unlock(mutex);
 }
 
+/**
+ * Get the statistics of the pool the periodic events are allocated from
+ * @param[out] statsOut The statistics will be copied there
+ */
+void EventGetPoolStats(struct pios_mempool_stats* statsOut)
+{
+	PIOS_Mempool_GetStats(&periodic_pool, statsOut);
+}
+
 /**
  * Clear the statistics counters
  */
@@ -231,8 +242,11 @@ static int32_t eventPeriodicCreate(UAVObjEvent* ev, UAVObjEventCallback cb, stru
 		}
 	}
     // Create handle
-	objEntry = (PeriodicObjectList*)PIOS_malloc(sizeof(PeriodicObjectList));
-	if (objEntry == NULL) return -1;
+	objEntry = (PeriodicObjectList*)PIOS_Mempool_Alloc(&periodic_pool);
+	if (objEntry == NULL) {
+		PIOS_Recursive_Mutex_Unlock(mutex);
+		return -1;
+	}
 	objEntry->evInfo.ev.obj = ev->obj;
 	objEntry->evInfo.ev.instId = ev->instId;
 	objEntry->evInfo.ev.event = ev->event;
@@ -313,6 +327,7 @@ static void eventTask()
 			// Invoke callback, if one
 			if (evInfo.cb != 0)
 			{
+				PIOS_Trace(PIOS_TRACE_EVENT_DISPATCH, UAVObjGetID(evInfo.ev.obj));
 				evInfo.cb(&evInfo.ev); // the function is expected to copy the event information
 			}
 		}
@@ -47,6 +47,8 @@ typedef struct {
 int32_t EventDispatcherInitialize();
 void EventGetStats(EventStats* statsOut);
 void EventClearStats();
+struct pios_mempool_stats;
+void EventGetPoolStats(struct pios_mempool_stats* statsOut);
 int32_t EventCallbackDispatch(UAVObjEvent* ev, UAVObjEventCallback cb);
 int32_t EventPeriodicCallbackCreate(UAVObjEvent* ev, UAVObjEventCallback cb, uint16_t periodMs);
 int32_t EventPeriodicCallbackUpdate(UAVObjEvent* ev, UAVObjEventCallback cb, uint16_t periodMs);
@@ -101,6 +101,12 @@ typedef enum {
 #define EV_MASK_ALL 0
 #define EV_MASK_ALL_UPDATES (EV_UNPACKED | EV_UPDATED | EV_UPDATED_MANUAL | EV_UPDATED_PERIODIC)
 
+/**
+ * Field mask covering every field of an object. Bit n of a field mask stands for
+ * field n of the object (see the generated <OBJECT>_FIELDMASK_<FIELD> defines).
+ */
+#define UAVOBJ_FIELDMASK_ALL 0xFFFFFFFF
+
 /**
  * Access types
  */
@@ -115,7 +121,9 @@ typedef enum {
 typedef struct {
 	UAVObjHandle obj;
 	uint16_t instId;
-	UAVObjEventType event;
+	uint8_t event; /** UAVObjEventType, kept to a byte so the range fits in the padding */
+	uint16_t dataOffset; /** Offset of the changed bytes in the instance data */
+	uint16_t dataSize; /** Number of changed bytes, 0 if the whole instance may have changed */
 } UAVObjEvent;
 
 
@@ -126,11 +134,6 @@ typedef struct {
  */
 typedef void (*UAVObjEventCallback)(UAVObjEvent* ev);
 
-/**
- * Callback used to initialize the object fields to their default values.
- */
-typedef void (*UAVObjInitializeCallback)(UAVObjHandle obj_handle, uint16_t instId);
-
 /**
  * Event manager statistics
  */
@@ -147,19 +150,25 @@ void UAVObjRegisterNewInstanceCB(new_uavo_instance_cb_t callback);
 int32_t UAVObjInitialize();
 void UAVObjGetStats(UAVObjStats* statsOut);
 void UAVObjClearStats();
+struct pios_mempool_stats;
+void UAVObjGetPoolStats(struct pios_mempool_stats* statsOut);
 UAVObjHandle UAVObjRegister(uint32_t id,
-		int32_t isSingleInstance, int32_t isSettings, uint32_t numBytes, UAVObjInitializeCallback initCb);
+		int32_t isSingleInstance, int32_t isSettings, uint32_t numBytes,
+		const void *defaultData, const UAVObjMetadata *defaultMetadata);
 UAVObjHandle UAVObjGetByID(uint32_t id);
 uint32_t UAVObjGetID(UAVObjHandle obj);
 uint32_t UAVObjGetNumBytes(UAVObjHandle obj);
 uint16_t UAVObjGetNumInstances(UAVObjHandle obj);
 UAVObjHandle UAVObjGetLinkedObj(UAVObjHandle obj);
-uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle, UAVObjInitializeCallback initCb);
+uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle, const void *defaultData);
+int32_t UAVObjReserveInstances(UAVObjHandle obj_handle, uint16_t num_instances);
 bool UAVObjIsSingleInstance(UAVObjHandle obj);
 bool UAVObjIsMetaobject(UAVObjHandle obj);
 bool UAVObjIsSettings(UAVObjHandle obj);
 int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t* dataIn);
+int32_t UAVObjUnpackField(UAVObjHandle obj_handle, uint16_t instId, const uint8_t* dataIn, uint32_t offset, uint32_t size);
 int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t* dataOut);
+uint32_t UAVObjGetHash(UAVObjHandle obj_handle);
 int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId);
 int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId);
 int32_t UAVObjDeleteById(uint32_t obj_id, uint16_t inst_id);
@@ -175,10 +184,13 @@ int32_t UAVObjLoadMetaobjects();
 int32_t UAVObjDeleteMetaobjects();
 int32_t UAVObjSetData(UAVObjHandle obj_handle, const void* dataIn);
 int32_t UAVObjSetDataField(UAVObjHandle obj_handle, const void* dataIn, uint32_t offset, uint32_t size);
+int32_t UAVObjSetDataFieldMask(UAVObjHandle obj_handle, const void* dataIn, uint32_t offset, uint32_t size, uint32_t fieldMask);
 int32_t UAVObjGetData(UAVObjHandle obj_handle, void* dataOut);
 int32_t UAVObjGetDataField(UAVObjHandle obj_handle, void* dataOut, uint32_t offset, uint32_t size);
 int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId, const void* dataIn);
+int32_t UAVObjSetInstancesDataQuiet(UAVObjHandle obj_handle, uint16_t firstInstId, uint16_t numInstances, const void* dataIn);
 int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, const void* dataIn, uint32_t offset, uint32_t size);
+int32_t UAVObjSetInstanceDataFieldMask(UAVObjHandle obj_handle, uint16_t instId, const void* dataIn, uint32_t offset, uint32_t size, uint32_t fieldMask);
 int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId, void* dataOut);
 int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, void* dataOut, uint32_t offset, uint32_t size);
 int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata* dataIn);
@@ -198,8 +210,10 @@ UAVObjUpdateMode UAVObjGetGcsTelemetryUpdateMode(const UAVObjMetadata* dataOut);
 void UAVObjSetTelemetryGcsUpdateMode(UAVObjMetadata* dataOut, UAVObjUpdateMode val);
 int8_t UAVObjReadOnly(UAVObjHandle obj);
 int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, struct pios_queue *queue, uint8_t eventMask);
+int32_t UAVObjConnectQueueFields(UAVObjHandle obj_handle, struct pios_queue *queue, uint8_t eventMask, uint32_t fieldMask);
 int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, struct pios_queue *queue);
 int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb, uint8_t eventMask);
+int32_t UAVObjConnectCallbackFields(UAVObjHandle obj_handle, UAVObjEventCallback cb, uint8_t eventMask, uint32_t fieldMask);
 int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb);
 void UAVObjRequestUpdate(UAVObjHandle obj);
 void UAVObjRequestInstanceUpdate(UAVObjHandle obj_handle, uint16_t instId);
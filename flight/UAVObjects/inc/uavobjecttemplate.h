@@ -57,6 +57,9 @@ typedef struct {
 $(DATAFIELDS)
 } __attribute__((packed)) __attribute__((aligned(4))) $(NAME)Data;
 
+// Default field values, stored in flash
+extern const $(NAME)Data $(NAME)DefaultData;
+
 // Typesafe Object access functions
 /**
  * @function $(NAME)Get(dataOut)
@@ -75,7 +78,11 @@ static inline int32_t $(NAME)ConnectQueue(struct pios_queue *queue) { return UAV
 
 static inline int32_t $(NAME)ConnectCallback(UAVObjEventCallback cb) { return UAVObjConnectCallback($(NAME)Handle(), cb, EV_MASK_ALL_UPDATES); }
 
-static inline uint16_t $(NAME)CreateInstance() { return UAVObjCreateInstance($(NAME)Handle(), &$(NAME)SetDefaults); }
+static inline int32_t $(NAME)ConnectQueueFields(struct pios_queue *queue, uint32_t fieldMask) { return UAVObjConnectQueueFields($(NAME)Handle(), queue, EV_MASK_ALL_UPDATES, fieldMask); }
+
+static inline int32_t $(NAME)ConnectCallbackFields(UAVObjEventCallback cb, uint32_t fieldMask) { return UAVObjConnectCallbackFields($(NAME)Handle(), cb, EV_MASK_ALL_UPDATES, fieldMask); }
+
+static inline uint16_t $(NAME)CreateInstance() { return UAVObjCreateInstance($(NAME)Handle(), &$(NAME)DefaultData); }
 
 static inline void $(NAME)RequestUpdate() { UAVObjRequestUpdate($(NAME)Handle()); }
 
@@ -34,6 +34,7 @@
 #include "pios_heap.h"		/* PIOS_malloc_no_dma */
 #include "pios_mutex.h"
 #include "pios_queue.h"
+#include "pios_mempool.h"
 
 extern uintptr_t pios_uavo_settings_fs_id;
 
@@ -55,6 +56,7 @@ struct ObjectEventEntry {
 	struct pios_queue         *queue;
 	UAVObjEventCallback       cb;
 	uint8_t                   eventMask;
+	uint32_t                  fieldMask;
 	struct ObjectEventEntry * next;
 };
 
@@ -131,6 +133,11 @@ struct UAVOMulti {
 	struct UAVOData        uavo;
 
 	uint16_t               num_instances;
+	/*
+	 * Reserved instances, once UAVObjReserveInstances() was called the
+	 * instances past the first one are allocated from here.
+	 */
+	struct pios_mempool  * instance_pool;
 	struct UAVOMultiInst   instance0;
 	/*
 	 * Additional space will be malloc'd here to hold the
@@ -154,10 +161,13 @@ struct UAVOMulti {
 // Private functions
 static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 			UAVObjEventType event);
-static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId);
+static int32_t sendFieldEvent(struct UAVOBase * obj, uint16_t instId,
+			UAVObjEventType event, uint32_t fieldMask, uint16_t offset, uint16_t size);
+static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId, const void *defaultData);
+static InstanceHandle allocInstance(struct UAVOData * obj, uint16_t instId, const void *defaultData);
 static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId);
 static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
-			UAVObjEventCallback cb, uint8_t eventMask);
+			UAVObjEventCallback cb, uint8_t eventMask, uint32_t fieldMask);
 static int32_t disconnectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 			UAVObjEventCallback cb);
 
@@ -177,6 +187,7 @@ static const UAVObjMetadata defMetadata = {
 };
 
 static UAVObjStats stats;
+static struct pios_mempool event_pool = PIOS_MEMPOOL_INIT("ObjectEvents", struct ObjectEventEntry);
 static new_uavo_instance_cb_t newUavObjInstanceCB;
 /**
  * Initialize the object manager
@@ -213,6 +224,15 @@ void UAVObjGetStats(UAVObjStats * statsOut)
 	PIOS_Recursive_Mutex_Unlock(mutex);
 }
 
+/**
+ * Get the statistics of the pool the event connections are allocated from
+ * @param[out] statsOut The statistics will be copied there
+ */
+void UAVObjGetPoolStats(struct pios_mempool_stats * statsOut)
+{
+	PIOS_Mempool_GetStats(&event_pool, statsOut);
+}
+
 /**
  * Clear the statistics counters
  */
@@ -281,6 +301,7 @@ static struct UAVOData * UAVObjAllocMulti(uint32_t num_bytes)
 
 	/* Set up the type-specific part of the UAVO */
 	uavo_multi->num_instances = 1;
+	uavo_multi->instance_pool = NULL;
 
 	/* Clear the instance data carried in the UAVO */
 	uavo_multi->instance0.next = NULL;
@@ -300,14 +321,16 @@ static struct UAVOData * UAVObjAllocMulti(uint32_t num_bytes)
  * \param[in] isSingleInstance Is this a single instance or multi-instance object
  * \param[in] isSettings Is this a settings object
  * \param[in] numBytes Number of bytes of object data (for one instance)
- * \param[in] initCb Default field and metadata initialization function
+ * \param[in] defaultData Default field values (numBytes long), NULL for all zero
+ * \param[in] defaultMetadata Default metadata values, NULL for all zero
  * \return Object handle, or NULL if failure.
  * \return
  */
 UAVObjHandle UAVObjRegister(uint32_t id, 
 			int32_t isSingleInstance, int32_t isSettings,
 			uint32_t num_bytes,
-			UAVObjInitializeCallback initCb)
+			const void *defaultData,
+			const UAVObjMetadata *defaultMetadata)
 {
 	struct UAVOData * uavo_data = NULL;
 
@@ -337,13 +360,19 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 	/* Initialize the embedded meta UAVO */
 	UAVObjInitMetaData (&uavo_data->metaObj);
 
+	/*
+	 * Copy in the default field and metadata values directly, the object is
+	 * not visible to anyone yet so there is no need to lock or fire events
+	 * here. The events are fired once below after loading from flash.
+	 */
+	if (defaultData)
+		memcpy(InstanceData(getInstance(uavo_data, 0)), defaultData, num_bytes);
+	if (defaultMetadata)
+		memcpy(LinkedMetaDataPtr(uavo_data), defaultMetadata, MetaNumBytes);
+
 	/* Add the newly created object to the global list of objects */
 	LL_APPEND(uavo_list, uavo_data);
 
-	/* Initialize object fields and metadata to default values */
-	if (initCb)
-		initCb((UAVObjHandle) uavo_data, 0);
-
 	/* Always try to load the meta object from flash */
 	UAVObjLoad((UAVObjHandle) &(uavo_data->metaObj), 0);
 
@@ -491,9 +520,10 @@ uint16_t UAVObjGetNumInstances(UAVObjHandle obj_handle)
 /**
  * Create a new instance in the object.
  * \param[in] obj The object handle
+ * \param[in] defaultData Default field values of the new instance, NULL for all zero
  * \return The instance ID or 0 if an error
  */
-uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle, UAVObjInitializeCallback initCb)
+uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle, const void *defaultData)
 {
 	PIOS_Assert(obj_handle);
 	if (UAVObjIsMetaobject(obj_handle)) {
@@ -508,20 +538,64 @@ uint16_t UAVObjCreateInstance(UAVObjHandle obj_handle, UAVObjInitializeCallback
 
 	// Create new instance
 	instId = UAVObjGetNumInstances(obj_handle);
-	instEntry = createInstance((struct UAVOData *) obj_handle, instId);
+	instEntry = createInstance((struct UAVOData *) obj_handle, instId, defaultData);
 	if (instEntry == NULL) {
 		goto unlock_exit;
 	}
 
-	// Initialize instance data
-	if (initCb) {
-		initCb(obj_handle, instId);
+unlock_exit:
+	PIOS_Recursive_Mutex_Unlock(mutex);
+
+	return instId;
+}
+
+/**
+ * Reserve memory for the instances of a multi instance object that are
+ * created at run time, e.g. when they are uploaded, so creating them
+ * doesn't need the heap any more. Called from the module initialization.
+ * \param[in] obj The object handle
+ * \param[in] num_instances Number of instances the object can have without the heap
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVObjReserveInstances(UAVObjHandle obj_handle, uint16_t num_instances)
+{
+	PIOS_Assert(obj_handle);
+	if (UAVObjIsMetaobject(obj_handle) || UAVObjIsSingleInstance(obj_handle)) {
+		return -1;
+	}
+
+	int32_t rc = -1;
+
+	// Lock
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	struct UAVOMulti * uavo_multi = (struct UAVOMulti *) obj_handle;
+
+	if (uavo_multi->instance_pool == NULL) {
+		struct pios_mempool *pool = PIOS_malloc_no_dma(sizeof(*pool));
+		if (pool == NULL) {
+			goto unlock_exit;
+		}
+		PIOS_Mempool_Init(pool, "ObjectInstances",
+			sizeof(struct UAVOMultiInst) + uavo_multi->uavo.instance_size);
+		uavo_multi->instance_pool = pool;
+	}
+
+	// The existing instances and the free blocks of the pool
+	struct pios_mempool_stats pool_stats;
+	PIOS_Mempool_GetStats(uavo_multi->instance_pool, &pool_stats);
+
+	uint32_t have = uavo_multi->num_instances + pool_stats.blocks - pool_stats.in_use;
+	rc = 0;
+	if (num_instances > have) {
+		rc = PIOS_Mempool_Reserve(uavo_multi->instance_pool, num_instances - have);
 	}
 
 unlock_exit:
 	PIOS_Recursive_Mutex_Unlock(mutex);
 
-	return instId;
+	return rc;
 }
 
 /**
@@ -603,7 +677,7 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 
 		// If the instance does not exist create it and any other instances before it
 		if (instEntry == NULL) {
-			instEntry = createInstance(obj, instId);
+			instEntry = createInstance(obj, instId, NULL);
 			if (instEntry == NULL) {
 				goto unlock_exit;
 			}
@@ -621,6 +695,51 @@ unlock_exit:
 	return rc;
 }
 
+/**
+ * Unpack a byte range of an existing object instance, used for field updates
+ * \param[in] obj The object handle
+ * \param[in] instId The instance ID
+ * \param[in] dataIn The new data for the range
+ * \param[in] offset Offset of the range in the instance data
+ * \param[in] size Size of the range
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjUnpackField(UAVObjHandle obj_handle, uint16_t instId,
+			const uint8_t * dataIn, uint32_t offset, uint32_t size)
+{
+	PIOS_Assert(obj_handle);
+
+	// Lock
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	int32_t rc = -1;
+
+	if (UAVObjIsMetaobject(obj_handle)) {
+		if (instId != 0 || (size + offset) > MetaNumBytes) {
+			goto unlock_exit;
+		}
+		memcpy((uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, dataIn, size);
+	} else {
+		struct UAVOData *obj = (struct UAVOData *) obj_handle;
+
+		// A partial update can not create the instance, the rest of it would be undefined
+		InstanceHandle instEntry = getInstance(obj, instId);
+		if (instEntry == NULL || (size + offset) > obj->instance_size) {
+			goto unlock_exit;
+		}
+		memcpy((uint8_t *)InstanceData(instEntry) + offset, dataIn, size);
+	}
+
+	// Fire event
+	sendFieldEvent((struct UAVOBase*)obj_handle, instId, EV_UNPACKED,
+			UAVOBJ_FIELDMASK_ALL, offset, size);
+	rc = 0;
+
+unlock_exit:
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return rc;
+}
+
 /**
  * Pack an object to a byte array
  * \param[in] obj The object handle
@@ -665,6 +784,38 @@ unlock_exit:
 	return rc;
 }
 
+/**
+ * Hash the content of an object, the CRC32 of what UAVObjPack gives for
+ * every instance in order
+ * \param[in] obj The object handle
+ * \return the hash
+ */
+uint32_t UAVObjGetHash(UAVObjHandle obj_handle)
+{
+	PIOS_Assert(obj_handle);
+
+	// Lock
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	uint32_t crc = 0;
+
+	if (UAVObjIsMetaobject(obj_handle)) {
+		crc = PIOS_CRC32_updateCRC(crc, (const uint8_t *) MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
+	} else {
+		struct UAVOData *obj = (struct UAVOData *) obj_handle;
+
+		for (uint16_t instId = 0; instId < UAVObjGetNumInstances(obj_handle); instId++) {
+			InstanceHandle instEntry = getInstance(obj, instId);
+			if (instEntry == NULL)
+				break;
+			crc = PIOS_CRC32_updateCRC(crc, InstanceData(instEntry), obj->instance_size);
+		}
+	}
+
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return crc;
+}
+
 #if defined(PIOS_INCLUDE_FASTHEAP)
 /**
  * Trampoline buffer used for loads from the underlying filesystem.
@@ -1054,6 +1205,18 @@ int32_t UAVObjSetDataField(UAVObjHandle obj_handle, const void* dataIn, uint32_t
 	return UAVObjSetInstanceDataField(obj_handle, 0, dataIn, offset, size);
 }
 
+/**
+ * Set a field of the object data and tag the update event with the field mask
+ * \param[in] obj The object handle
+ * \param[in] dataIn The field data
+ * \param[in] fieldMask Mask of the fields being set
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjSetDataFieldMask(UAVObjHandle obj_handle, const void* dataIn, uint32_t offset, uint32_t size, uint32_t fieldMask)
+{
+	return UAVObjSetInstanceDataFieldMask(obj_handle, 0, dataIn, offset, size, fieldMask);
+}
+
 /**
  * Get the object data
  * \param[in] obj The object handle
@@ -1127,6 +1290,66 @@ unlock_exit:
 	return rc;
 }
 
+/**
+ * Set the data of consecutive object instances, creating the ones that
+ * don't exist yet. All instances are set while holding the lock and no
+ * update event is sent, the caller has to call
+ * UAVObjInstanceUpdated(obj, UAVOBJ_ALL_INSTANCES) once it is done.
+ * \param[in] obj The object handle
+ * \param[in] firstInstId The first instance ID, at most the number of instances
+ * \param[in] numInstances The number of instances to set
+ * \param[in] dataIn The data structures of the instances, one after the other
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjSetInstancesDataQuiet(UAVObjHandle obj_handle, uint16_t firstInstId,
+			uint16_t numInstances, const void *dataIn)
+{
+	PIOS_Assert(obj_handle);
+
+	if (UAVObjIsMetaobject(obj_handle)) {
+		return -1;
+	}
+	if (UAVObjIsSingleInstance(obj_handle) && firstInstId + numInstances > 1) {
+		return -1;
+	}
+
+	// Lock
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	int32_t rc = -1;
+	struct UAVOData *obj = (struct UAVOData *) obj_handle;
+	uint16_t numBefore = UAVObjGetNumInstances(obj_handle);
+	const uint8_t *data = (const uint8_t *) dataIn;
+
+	// Check access level and that the instances stay sequential
+	if (UAVObjReadOnly(obj_handle) || firstInstId > numBefore) {
+		goto unlock_exit;
+	}
+
+	rc = 0;
+	for (uint16_t i = 0; i < numInstances; i++) {
+		uint16_t instId = firstInstId + i;
+		InstanceHandle instEntry = getInstance(obj, instId);
+		if (instEntry == NULL) {
+			instEntry = allocInstance(obj, instId, NULL);
+		}
+		if (instEntry == NULL) {
+			rc = -1;
+			break;
+		}
+		memcpy(InstanceData(instEntry), data, obj->instance_size);
+		data += obj->instance_size;
+	}
+
+	if (newUavObjInstanceCB && UAVObjGetNumInstances(obj_handle) != numBefore) {
+		newUavObjInstanceCB(obj->id, UAVObjGetNumInstances(obj_handle));
+	}
+
+unlock_exit:
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return rc;
+}
+
 /**
  * Set the data of a specific object instance
  * \param[in] obj The object handle
@@ -1135,6 +1358,23 @@ unlock_exit:
  * \return 0 if success or -1 if failure
  */
 int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, const void* dataIn, uint32_t offset, uint32_t size)
+{
+	return UAVObjSetInstanceDataFieldMask(obj_handle, instId, dataIn, offset, size, UAVOBJ_FIELDMASK_ALL);
+}
+
+/**
+ * Set a field of a specific object instance. The update event carries the field
+ * mask and the byte range, so subscribers can skip fields they do not use and
+ * telemetry can send only the changed bytes.
+ * \param[in] obj The object handle
+ * \param[in] instId The object instance ID
+ * \param[in] dataIn The field data
+ * \param[in] offset Offset of the field in the instance data
+ * \param[in] size Size of the field
+ * \param[in] fieldMask Mask of the fields being set
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjSetInstanceDataFieldMask(UAVObjHandle obj_handle, uint16_t instId, const void* dataIn, uint32_t offset, uint32_t size, uint32_t fieldMask)
 {
 	PIOS_Assert(obj_handle);
 
@@ -1185,7 +1425,8 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 
 
 	// Fire event
-	sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
+	sendFieldEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED,
+			fieldMask, offset, size);
 	rc = 0;
 
 unlock_exit:
@@ -1507,7 +1748,28 @@ int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, struct pios_queue *queue,
 	PIOS_Assert(queue);
 	int32_t res;
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-	res = connectObj(obj_handle, queue, 0, eventMask);
+	res = connectObj(obj_handle, queue, 0, eventMask, UAVOBJ_FIELDMASK_ALL);
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return res;
+}
+
+/**
+ * Connect an event queue to the object, only for updates touching the given fields.
+ * Events that do not carry field information are always delivered.
+ * \param[in] obj The object handle
+ * \param[in] queue The event queue
+ * \param[in] eventMask The event mask, if EV_MASK_ALL_UPDATES then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \param[in] fieldMask The fields of interest
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjConnectQueueFields(UAVObjHandle obj_handle, struct pios_queue *queue,
+			uint8_t eventMask, uint32_t fieldMask)
+{
+	PIOS_Assert(obj_handle);
+	PIOS_Assert(queue);
+	int32_t res;
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	res = connectObj(obj_handle, queue, 0, eventMask, fieldMask);
 	PIOS_Recursive_Mutex_Unlock(mutex);
 	return res;
 }
@@ -1543,7 +1805,27 @@ int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb,
 	PIOS_Assert(obj_handle);
 	int32_t res;
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
-	res = connectObj(obj_handle, 0, cb, eventMask);
+	res = connectObj(obj_handle, 0, cb, eventMask, UAVOBJ_FIELDMASK_ALL);
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return res;
+}
+
+/**
+ * Connect an event callback to the object, only for updates touching the given fields.
+ * Events that do not carry field information are always delivered.
+ * \param[in] obj The object handle
+ * \param[in] cb The event callback
+ * \param[in] eventMask The event mask, if EV_MASK_ALL_UPDATES then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \param[in] fieldMask The fields of interest
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjConnectCallbackFields(UAVObjHandle obj_handle, UAVObjEventCallback cb,
+			uint8_t eventMask, uint32_t fieldMask)
+{
+	PIOS_Assert(obj_handle);
+	int32_t res;
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	res = connectObj(obj_handle, 0, cb, eventMask, fieldMask);
 	PIOS_Recursive_Mutex_Unlock(mutex);
 	return res;
 }
@@ -1634,21 +1916,37 @@ void UAVObjIterate(void (*iterator) (UAVObjHandle obj))
 }
 
 /**
- * Send a triggered event to all event queues registered on the object.
+ * Send a triggered event for the whole instance to all event queues registered on the object.
  */
 static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 			UAVObjEventType triggered_event)
+{
+	return sendFieldEvent(obj, instId, triggered_event, UAVOBJ_FIELDMASK_ALL, 0, 0);
+}
+
+/**
+ * Send a triggered event to all event queues registered on the object
+ * whose field mask overlaps the changed fields.
+ */
+static int32_t sendFieldEvent(struct UAVOBase * obj, uint16_t instId,
+			UAVObjEventType triggered_event, uint32_t fieldMask,
+			uint16_t offset, uint16_t size)
 {
 	/* Set up the message that will be sent to all registered listeners */
 	UAVObjEvent msg = {
-		.obj    = (UAVObjHandle) obj,
-		.event  = triggered_event,
-		.instId = instId,
+		.obj        = (UAVObjHandle) obj,
+		.event      = triggered_event,
+		.instId     = instId,
+		.dataOffset = offset,
+		.dataSize   = size,
 	};
 
 	// Go through each object and push the event message in the queue (if event is activated for the queue)
 	struct ObjectEventEntry *event;
 	LL_FOREACH(obj->next_event, event) {
+		if ((event->fieldMask & fieldMask) == 0)
+			continue;
+
 		if (event->eventMask == 0
 			|| (event->eventMask & triggered_event) != 0) {
 			// Send to queue if a valid queue is registered
@@ -1676,8 +1974,29 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 
 /**
  * Create a new object instance, return the instance info or NULL if failure.
+ * The instance is initialized from defaultData, or zeroed if it is NULL.
+ */
+static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId, const void *defaultData)
+{
+	InstanceHandle instEntry = allocInstance(obj, instId, defaultData);
+	if (instEntry == NULL)
+		return NULL;
+
+	// Fire event
+	UAVObjInstanceUpdated((UAVObjHandle) obj, instId);
+
+	// Done
+	if (newUavObjInstanceCB) {
+		newUavObjInstanceCB(obj->id, UAVObjGetNumInstances(obj));
+	}
+	return instEntry;
+}
+
+/**
+ * Add a new object instance without sending any events, return the
+ * instance info or NULL if failure.
  */
-static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
+static InstanceHandle allocInstance(struct UAVOData * obj, uint16_t instId, const void *defaultData)
 {
 	struct UAVOMultiInst *instEntry;
 
@@ -1699,27 +2018,27 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 
 	// Create any missing instances (all instance IDs must be sequential)
 	for (uint16_t n = UAVObjGetNumInstances(&(obj->base)); n < instId; ++n) {
-		if (createInstance(obj, n) == NULL) {
+		if (createInstance(obj, n, NULL) == NULL) {
 			return NULL;
 		}
 	}
 
 	/* Create the actual instance */
-	instEntry = (struct UAVOMultiInst *) PIOS_malloc_no_dma(sizeof(struct UAVOMultiInst)+obj->instance_size);
+	struct pios_mempool *instance_pool = ( (struct UAVOMulti*)obj )->instance_pool;
+	if (instance_pool)
+		instEntry = (struct UAVOMultiInst *) PIOS_Mempool_Alloc(instance_pool);
+	else
+		instEntry = (struct UAVOMultiInst *) PIOS_malloc_no_dma(sizeof(struct UAVOMultiInst)+obj->instance_size);
 	if (!instEntry)
 		return NULL;
-	memset(InstanceDataOffset(instEntry), 0, obj->instance_size);
+	if (defaultData)
+		memcpy(InstanceDataOffset(instEntry), defaultData, obj->instance_size);
+	else
+		memset(InstanceDataOffset(instEntry), 0, obj->instance_size);
 	LL_APPEND(( (struct UAVOMulti*)obj )->instance0.next, instEntry);
 
 	( (struct UAVOMulti*)obj )->num_instances++;
 
-	// Fire event
-	UAVObjInstanceUpdated((UAVObjHandle) obj, instId);
-
-	// Done
-	if (newUavObjInstanceCB) {
-		newUavObjInstanceCB(obj->id, UAVObjGetNumInstances(obj));
-	}
 	return InstanceDataOffset(instEntry);
 }
 
@@ -1774,10 +2093,11 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
  * \param[in] queue The event queue
  * \param[in] cb The event callback
  * \param[in] eventMask The event mask, if EV_MASK_ALL_UPDATES then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \param[in] fieldMask The fields of interest, UAVOBJ_FIELDMASK_ALL for all of them
  * \return 0 if success or -1 if failure
  */
 static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
-			UAVObjEventCallback cb, uint8_t eventMask)
+			UAVObjEventCallback cb, uint8_t eventMask, uint32_t fieldMask)
 {
 	struct ObjectEventEntry *event;
 	struct UAVOBase *obj;
@@ -1788,18 +2108,20 @@ static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 		if (event->queue == queue && event->cb == cb) {
 			// Already connected, update event mask and return
 			event->eventMask = eventMask;
+			event->fieldMask = fieldMask;
 			return 0;
 		}
 	}
 
 	// Add queue to list
-	event =	(struct ObjectEventEntry *) PIOS_malloc_no_dma(sizeof(struct ObjectEventEntry));
+	event =	(struct ObjectEventEntry *) PIOS_Mempool_Alloc(&event_pool);
 	if (event == NULL) {
 		return -1;
 	}
 	event->queue = queue;
 	event->cb = cb;
 	event->eventMask = eventMask;
+	event->fieldMask = fieldMask;
 	LL_APPEND(obj->next_event, event);
 
 	// Done
@@ -1825,7 +2147,7 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 		if ((event->queue == queue
 				&& event->cb == cb)) {
 			LL_DELETE(obj->next_event, event);
-			PIOS_free(event);
+			PIOS_Mempool_Free(&event_pool, event);
 			return 0;
 		}
 	}
@@ -40,6 +40,30 @@
 // Private variables
 static UAVObjHandle handle = NULL;
 
+/**
+ * Default values of the object fields, fields without a default value
+ * are zero. Kept const so the table lives in flash and instances are
+ * initialized with a single copy.
+ */
+const $(NAME)Data $(NAME)DefaultData = {
+$(INITFIELDS)};
+
+/**
+ * Default values of the object metadata.
+ */
+static const UAVObjMetadata $(NAME)DefaultMetadata = {
+	.flags =
+		$(FLIGHTACCESS) << UAVOBJ_ACCESS_SHIFT |
+		$(GCSACCESS) << UAVOBJ_GCS_ACCESS_SHIFT |
+		$(FLIGHTTELEM_ACKED) << UAVOBJ_TELEMETRY_ACKED_SHIFT |
+		$(GCSTELEM_ACKED) << UAVOBJ_GCS_TELEMETRY_ACKED_SHIFT |
+		$(FLIGHTTELEM_UPDATEMODE) << UAVOBJ_TELEMETRY_UPDATE_MODE_SHIFT |
+		$(GCSTELEM_UPDATEMODE) << UAVOBJ_GCS_TELEMETRY_UPDATE_MODE_SHIFT,
+	.telemetryUpdatePeriod = $(FLIGHTTELEM_UPDATEPERIOD),
+	.gcsTelemetryUpdatePeriod = $(GCSTELEM_UPDATEPERIOD),
+	.loggingUpdatePeriod = $(LOGGING_UPDATEPERIOD),
+};
+
 /**
  * Initialize object.
  * \return 0 Success
@@ -53,7 +77,8 @@ int32_t $(NAME)Initialize(void)
 	
 	// Register object with the object manager
 	handle = UAVObjRegister($(NAMEUC)_OBJID,
-			$(NAMEUC)_ISSINGLEINST, $(NAMEUC)_ISSETTINGS, $(NAMEUC)_NUMBYTES, &$(NAME)SetDefaults);
+			$(NAMEUC)_ISSINGLEINST, $(NAMEUC)_ISSETTINGS, $(NAMEUC)_NUMBYTES,
+			&$(NAME)DefaultData, &$(NAME)DefaultMetadata);
 
 	// Done
 	if (handle != 0)
@@ -73,28 +98,12 @@ int32_t $(NAME)Initialize(void)
  */
 void $(NAME)SetDefaults(UAVObjHandle obj, uint16_t instId)
 {
-	$(NAME)Data data;
-
 	// Initialize object fields to their default values
-	UAVObjGetInstanceData(obj, instId, &data);
-	memset(&data, 0, sizeof($(NAME)Data));
-$(INITFIELDS)
-	UAVObjSetInstanceData(obj, instId, &data);
+	UAVObjSetInstanceData(obj, instId, &$(NAME)DefaultData);
 
 	// Initialize object metadata to their default values
 	if (instId == 0) {
-		UAVObjMetadata metadata;
-		metadata.flags =
-			$(FLIGHTACCESS) << UAVOBJ_ACCESS_SHIFT |
-			$(GCSACCESS) << UAVOBJ_GCS_ACCESS_SHIFT |
-			$(FLIGHTTELEM_ACKED) << UAVOBJ_TELEMETRY_ACKED_SHIFT |
-			$(GCSTELEM_ACKED) << UAVOBJ_GCS_TELEMETRY_ACKED_SHIFT |
-			$(FLIGHTTELEM_UPDATEMODE) << UAVOBJ_TELEMETRY_UPDATE_MODE_SHIFT |
-			$(GCSTELEM_UPDATEMODE) << UAVOBJ_GCS_TELEMETRY_UPDATE_MODE_SHIFT;
-		metadata.telemetryUpdatePeriod = $(FLIGHTTELEM_UPDATEPERIOD);
-		metadata.gcsTelemetryUpdatePeriod = $(GCSTELEM_UPDATEPERIOD);
-		metadata.loggingUpdatePeriod = $(LOGGING_UPDATEPERIOD);
-		UAVObjSetMetadata(obj, &metadata);
+		UAVObjSetMetadata(obj, &$(NAME)DefaultMetadata);
 	}
 }
 
@@ -43,6 +43,7 @@ static int32_t objectTransaction(UAVTalkConnectionData *connection, UAVObjHandle
 static int32_t sendObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t type);
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId);
+static int32_t sendObjectFields(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint16_t offset, uint16_t size);
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t* data, int32_t length);
 static void updateAck(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
 
@@ -209,6 +210,37 @@ int32_t UAVTalkSendObject(UAVTalkConnection connectionHandle, UAVObjHandle obj,
 	}
 }
 
+/**
+ * Send a byte range of an object instance through the telemetry link, used
+ * when only some fields changed. The receiver applies it to the existing
+ * instance. The packet payload is the little endian offset followed by the
+ * data of the range. This is never acked, the caller should fall back on
+ * UAVTalkSendObject() for acked objects and send the whole object again
+ * later in case the packet was lost. Older receivers don't know the packet,
+ * only send it to one that announced it understands it.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \param[in] offset Offset of the range in the instance data
+ * \param[in] size Size of the range
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectFields(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint16_t offset, uint16_t size)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	if (instId == UAVOBJ_ALL_INSTANCES)
+		return -1;
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+	int32_t ret = sendObjectFields(connection, obj, instId, offset, size);
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
 /**
  * Send the specified object through the telemetry link with a timestamp.
  * \param[in] connection UAVTalkConnection to be used
@@ -393,7 +425,20 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 			}
 			else
 			{
-				if (iproc->obj)
+				if (iproc->obj && iproc->type == UAVTALK_TYPE_OBJ_FIELDS)
+				{
+					// Field updates carry a variable length payload: offset + data
+					iproc->instanceLength = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
+					iproc->timestampLength = 0;
+					iproc->length = iproc->packet_size - iproc->rxPacketLength - iproc->instanceLength;
+					if (iproc->length < 2 || iproc->length > UAVObjGetNumBytes(iproc->obj) + 2)
+					{
+						connection->stats.rxErrors++;
+						iproc->state = UAVTALK_STATE_ERROR;
+						break;
+					}
+				}
+				else if (iproc->obj)
 				{
 					iproc->length = UAVObjGetNumBytes(iproc->obj);
 					iproc->instanceLength = (UAVObjIsSingleInstance(iproc->obj) ? 0 : 2);
@@ -498,13 +543,13 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 
 		case UAVTALK_STATE_DATA:
 			
-			// update the CRC
-			iproc->cs = PIOS_CRC_updateByte(iproc->cs, rxbyte);
-			
 			connection->rxBuffer[iproc->rxCount++] = rxbyte;
 			if (iproc->rxCount < iproc->length)
 				break;
 			
+			// update the CRC over the whole payload at once
+			iproc->cs = PIOS_CRC_updateCRC(iproc->cs, connection->rxBuffer, iproc->length);
+			
 			iproc->state = UAVTALK_STATE_CS;
 			iproc->rxCount = 0;
 			break;
@@ -870,6 +915,8 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
 	UAVObjHandle obj;
 	int32_t ret = 0;
 
+	PIOS_Trace(PIOS_TRACE_UAVTALK_RECEIVE, objId);
+
 	// Get the handle to the Object. Will be zero
 	// if object does not exist.
 	obj = UAVObjGetByID(objId);
@@ -915,6 +962,18 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
 				ret = -1;
 			}
 			break;
+		case UAVTALK_TYPE_OBJ_FIELDS:
+			// Only applies to an instance that already exists
+			if (obj && (instId != UAVOBJ_ALL_INSTANCES) && length >= 2)
+			{
+				uint16_t offset = data[0] | (data[1] << 8);
+				ret = UAVObjUnpackField(obj, instId, &data[2], offset, length - 2);
+			}
+			else
+			{
+				ret = -1;
+			}
+			break;
 		case UAVTALK_TYPE_OBJ_REQ:
 			// Send requested object if message is of type OBJ_REQ
 			if (obj == 0)
@@ -1038,6 +1097,7 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle
 
 	// Setup type and object id fields
 	objId = UAVObjGetID(obj);
+	PIOS_Trace(PIOS_TRACE_UAVTALK_SEND, objId);
 	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
 	connection->txBuffer[1] = type;
 	// data length inserted here below
@@ -1155,6 +1215,85 @@ static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId)
 	return 0;
 }
 
+/**
+ * Send a byte range of an object instance through the telemetry link.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID
+ * \param[in] offset Offset of the range in the instance data
+ * \param[in] size Size of the range
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendObjectFields(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint16_t offset, uint16_t size)
+{
+	int32_t dataOffset;
+	uint32_t objId;
+
+	if (!connection->outStream) return -1;
+
+	// Check the range
+	uint32_t numBytes = UAVObjGetNumBytes(obj);
+	if (size == 0 || (uint32_t)(offset + size) > numBytes || (size + 2) >= UAVTALK_MAX_PAYLOAD_LENGTH)
+	{
+		return -1;
+	}
+
+	// Setup type and object id fields
+	objId = UAVObjGetID(obj);
+	connection->txBuffer[0] = UAVTALK_SYNC_VAL;  // sync byte
+	connection->txBuffer[1] = UAVTALK_TYPE_OBJ_FIELDS;
+	// data length inserted here below
+	connection->txBuffer[4] = (uint8_t)(objId & 0xFF);
+	connection->txBuffer[5] = (uint8_t)((objId >> 8) & 0xFF);
+	connection->txBuffer[6] = (uint8_t)((objId >> 16) & 0xFF);
+	connection->txBuffer[7] = (uint8_t)((objId >> 24) & 0xFF);
+
+	// Setup instance ID if one is required
+	if (UAVObjIsSingleInstance(obj))
+	{
+		dataOffset = 8;
+	}
+	else
+	{
+		connection->txBuffer[8] = (uint8_t)(instId & 0xFF);
+		connection->txBuffer[9] = (uint8_t)((instId >> 8) & 0xFF);
+		dataOffset = 10;
+	}
+
+	// Offset of the range, followed by its data
+	connection->txBuffer[dataOffset] = (uint8_t)(offset & 0xFF);
+	connection->txBuffer[dataOffset + 1] = (uint8_t)((offset >> 8) & 0xFF);
+	dataOffset += 2;
+
+	if (UAVObjGetInstanceDataField(obj, instId, &connection->txBuffer[dataOffset], offset, size) < 0)
+	{
+		return -1;
+	}
+
+	// Store the packet length
+	connection->txBuffer[2] = (uint8_t)((dataOffset+size) & 0xFF);
+	connection->txBuffer[3] = (uint8_t)(((dataOffset+size) >> 8) & 0xFF);
+
+	// Calculate checksum
+	connection->txBuffer[dataOffset+size] = PIOS_CRC_updateCRC(0, connection->txBuffer, dataOffset+size);
+
+	uint16_t tx_msg_len = dataOffset+size+UAVTALK_CHECKSUM_LENGTH;
+	int32_t rc = (*connection->outStream)(connection->txBuffer, tx_msg_len);
+
+	if (rc == tx_msg_len) {
+		// Update stats
+		++connection->stats.txObjects;
+		connection->stats.txBytes += tx_msg_len;
+		connection->stats.txObjectBytes += size;
+	} else {
+		return -1;
+	}
+
+	// Done
+	return 0;
+}
+
 /**
  * @}
  * @}
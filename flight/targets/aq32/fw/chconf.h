@@ -478,6 +478,26 @@ typedef uint32_t halrtcnt_t;
  */
 #define hal_lld_get_counter_value()         DWT_CYCCNT
 
+/**
+ * @brief   Scheduling profile of the threads, see PIOS_Thread_Get_Profile().
+ * @details Only built with DIAG_TASK_PROFILE.
+ */
+#if defined(DIAG_TASK_PROFILE)
+#define THREAD_PROFILE_FIELDS                                               \
+  struct pios_thread_profile_state *profile;
+#define THREAD_PROFILE_INIT_HOOK(tp) {                                      \
+  (tp)->profile = NULL;                                                     \
+}
+#define THREAD_PROFILE_SWITCH_HOOK(ntp, otp) {                              \
+  extern void PIOS_Thread_Profile_Switch(Thread *, Thread *);               \
+  PIOS_Thread_Profile_Switch(ntp, otp);                                     \
+}
+#else
+#define THREAD_PROFILE_FIELDS
+#define THREAD_PROFILE_INIT_HOOK(tp) {}
+#define THREAD_PROFILE_SWITCH_HOOK(ntp, otp) {}
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 /**
  * @brief   Threads descriptor structure extension.
  * @details User fields added to the end of the @p Thread structure.
@@ -486,6 +506,7 @@ typedef uint32_t halrtcnt_t;
 #define THREAD_EXT_FIELDS                                                   \
   halrtcnt_t ticks_switched_in;                                             \
   halrtcnt_t ticks_total;                                                   \
+  THREAD_PROFILE_FIELDS                                                     \
   /* Add threads custom fields here.*/
 #endif
 
@@ -498,6 +519,7 @@ typedef uint32_t halrtcnt_t;
  */
 #if !defined(THREAD_EXT_INIT_HOOK) || defined(__DOXYGEN__)
 #define THREAD_EXT_INIT_HOOK(tp) {                                          \
+  THREAD_PROFILE_INIT_HOOK(tp);                                             \
   /* Add threads initialization code here.*/                                \
 }
 #endif
@@ -524,6 +546,7 @@ typedef uint32_t halrtcnt_t;
 #define THREAD_CONTEXT_SWITCH_HOOK(ntp, otp) {                              \
   ntp->ticks_switched_in = halGetCounterValue();                            \
   otp->ticks_total += ntp->ticks_switched_in - otp->ticks_switched_in;      \
+  THREAD_PROFILE_SWITCH_HOOK(ntp, otp);                                     \
   /* System halt code here.*/                                               \
 }
 #endif
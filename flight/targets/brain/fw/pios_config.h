@@ -55,6 +55,7 @@
 #define PIOS_INCLUDE_RTC
 #define PIOS_INCLUDE_WDG
 #define PIOS_INCLUDE_FASTHEAP
+#define PIOS_INCLUDE_TRACE
 #define PIOS_INCLUDE_HPWM
 #define PIOS_INCLUDE_FRSKY_RSSI
 
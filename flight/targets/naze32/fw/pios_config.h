@@ -104,6 +104,7 @@
 #define PIOS_EVENTDISPATCHER_STACK_SIZE 720
 #define PIOS_MAVLINK_STACK_SIZE         496
 #define PIOS_COMUSBBRIDGE_STACK_SIZE    480
+#define PIOS_RATEGROUP_STACK_SIZE       496
 #define IDLE_COUNTS_PER_SEC_AT_NO_LOAD 1995998
 
 // This can't be too high to stop eventdispatcher thread overflowing
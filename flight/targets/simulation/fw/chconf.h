@@ -472,6 +472,26 @@ typedef uint32_t halrtcnt_t;
 
 halrtcnt_t hal_lld_get_counter_value(void);
 
+/**
+ * @brief   Scheduling profile of the threads, see PIOS_Thread_Get_Profile().
+ * @details Only built with DIAG_TASK_PROFILE.
+ */
+#if defined(DIAG_TASK_PROFILE)
+#define THREAD_PROFILE_FIELDS                                               \
+  struct pios_thread_profile_state *profile;
+#define THREAD_PROFILE_INIT_HOOK(tp) {                                      \
+  (tp)->profile = NULL;                                                     \
+}
+#define THREAD_PROFILE_SWITCH_HOOK(ntp, otp) {                              \
+  extern void PIOS_Thread_Profile_Switch(Thread *, Thread *);               \
+  PIOS_Thread_Profile_Switch(ntp, otp);                                     \
+}
+#else
+#define THREAD_PROFILE_FIELDS
+#define THREAD_PROFILE_INIT_HOOK(tp) {}
+#define THREAD_PROFILE_SWITCH_HOOK(ntp, otp) {}
+#endif /* defined(DIAG_TASK_PROFILE) */
+
 /**
  * @brief   Threads descriptor structure extension.
  * @details User fields added to the end of the @p Thread structure.
@@ -480,6 +500,7 @@ halrtcnt_t hal_lld_get_counter_value(void);
 #define THREAD_EXT_FIELDS                                                   \
   halrtcnt_t ticks_switched_in;                                             \
   halrtcnt_t ticks_total;                                                   \
+  THREAD_PROFILE_FIELDS                                                     \
   /* Add threads custom fields here.*/
 #endif
 
@@ -492,6 +513,7 @@ halrtcnt_t hal_lld_get_counter_value(void);
  */
 #if !defined(THREAD_EXT_INIT_HOOK) || defined(__DOXYGEN__)
 #define THREAD_EXT_INIT_HOOK(tp) {                                          \
+  THREAD_PROFILE_INIT_HOOK(tp);                                             \
   /* Add threads initialization code here.*/                                \
 }
 #endif
@@ -518,6 +540,7 @@ halrtcnt_t hal_lld_get_counter_value(void);
 #define THREAD_CONTEXT_SWITCH_HOOK(ntp, otp) {                              \
   ntp->ticks_switched_in = halGetCounterValue();                            \
   otp->ticks_total += ntp->ticks_switched_in - otp->ticks_switched_in;      \
+  THREAD_PROFILE_SWITCH_HOOK(ntp, otp);                                     \
   /* System halt code here.*/                                               \
 }
 #endif
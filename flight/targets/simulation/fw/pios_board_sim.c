@@ -84,6 +84,67 @@ const struct pios_tcp_cfg pios_tcp_aux_cfg = {
 #define PIOS_COM_TELEM_RF_RX_BUF_LEN 384
 #define PIOS_COM_TELEM_RF_TX_BUF_LEN 384
 #define PIOS_COM_GPS_RX_BUF_LEN 96
+#define PIOS_COM_OVERO_RX_BUF_LEN 256
+#define PIOS_COM_OVERO_TX_BUF_LEN 1024	/* one batch of the module */
+
+#if defined(PIOS_INCLUDE_OVEROSYNC_TCP)
+/*
+ * Companion computer, for the OveroSync module. Only reachable from this
+ * machine, the link can change settings.
+ */
+const struct pios_tcp_cfg pios_tcp_overo_cfg = {
+  .ip = "127.0.0.1",
+  .port = 9004,
+};
+#else
+/*
+ * Without a companion the OveroSync stream is logged to sim_log.tll, one
+ * record of time, length and data for every batch the module sends
+ */
+static FILE *overo_log;
+static pios_com_callback overo_log_tx_out_cb;
+static uintptr_t overo_log_tx_out_context;
+
+static void overo_log_tx_start(uintptr_t id, uint16_t tx_bytes_avail)
+{
+	uint8_t buf[PIOS_COM_OVERO_TX_BUF_LEN];
+	bool woken;
+
+	uint16_t len = overo_log_tx_out_cb(overo_log_tx_out_context, buf, sizeof(buf), NULL, &woken);
+	if (len == 0)
+		return;
+
+	if (overo_log == NULL) {
+		overo_log = fopen("sim_log.tll", "w");
+		if (overo_log == NULL)
+			return;
+	}
+
+	uint32_t time = PIOS_Thread_Systime();
+	uint64_t size = len;
+	fwrite(&time, sizeof(time), 1, overo_log);
+	fwrite(&size, sizeof(size), 1, overo_log);
+	fwrite(buf, 1, len, overo_log);
+	fflush(overo_log);
+}
+
+static void overo_log_bind_rx_cb(uintptr_t id, pios_com_callback rx_in_cb, uintptr_t context)
+{
+	/* Nothing is ever received */
+}
+
+static void overo_log_bind_tx_cb(uintptr_t id, pios_com_callback tx_out_cb, uintptr_t context)
+{
+	overo_log_tx_out_cb = tx_out_cb;
+	overo_log_tx_out_context = context;
+}
+
+static const struct pios_com_driver overo_log_com_driver = {
+	.tx_start   = overo_log_tx_start,
+	.bind_rx_cb = overo_log_bind_rx_cb,
+	.bind_tx_cb = overo_log_bind_tx_cb,
+};
+#endif /* PIOS_INCLUDE_OVEROSYNC_TCP */
 
 /**
  * Simulation of the flash filesystem
@@ -106,6 +167,7 @@ uintptr_t pios_com_telem_usb_id;
 uintptr_t pios_com_gps_id;
 uintptr_t pios_com_aux_id;
 uintptr_t pios_com_spectrum_id;
+uintptr_t pios_com_overo_id;
 uintptr_t pios_rcvr_group_map[MANUALCONTROLSETTINGS_CHANNELGROUPS_NONE];
 
 /**
@@ -224,6 +286,30 @@ void PIOS_Board_Init(void) {
 		}
 	}
 #endif	/* PIOS_INCLUDE_GPS */
+
+	{
+#if defined(PIOS_INCLUDE_OVEROSYNC_TCP)
+		uintptr_t pios_tcp_overo_id;
+		if (PIOS_TCP_Init(&pios_tcp_overo_id, &pios_tcp_overo_cfg)) {
+			PIOS_Assert(0);
+		}
+		const struct pios_com_driver *overo_com_driver = &pios_tcp_com_driver;
+		uintptr_t overo_lower_id = pios_tcp_overo_id;
+#else
+		const struct pios_com_driver *overo_com_driver = &overo_log_com_driver;
+		uintptr_t overo_lower_id = 0;
+#endif /* PIOS_INCLUDE_OVEROSYNC_TCP */
+
+		uint8_t * rx_buffer = (uint8_t *) PIOS_malloc(PIOS_COM_OVERO_RX_BUF_LEN);
+		uint8_t * tx_buffer = (uint8_t *) PIOS_malloc(PIOS_COM_OVERO_TX_BUF_LEN);
+		PIOS_Assert(rx_buffer);
+		PIOS_Assert(tx_buffer);
+		if (PIOS_COM_Init(&pios_com_overo_id, overo_com_driver, overo_lower_id,
+				  rx_buffer, PIOS_COM_OVERO_RX_BUF_LEN,
+				  tx_buffer, PIOS_COM_OVERO_TX_BUF_LEN)) {
+			PIOS_Assert(0);
+		}
+	}
 #endif
 
 #if defined(PIOS_INCLUDE_GCSRCVR)
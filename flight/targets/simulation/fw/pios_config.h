@@ -86,6 +86,8 @@
 #define PIOS_INCLUDE_GPS_UBX_PARSER
 
 #define PIOS_OVERO_SPI
+/* OveroSync talks to a companion on TCP port 9004 instead of logging to sim_log.tll */
+//#define PIOS_INCLUDE_OVEROSYNC_TCP
 /* Supported receiver interfaces */
 #define PIOS_INCLUDE_RCVR
 #define PIOS_INCLUDE_DSM
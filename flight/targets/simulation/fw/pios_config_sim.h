@@ -51,6 +51,7 @@
 #define PIOS_INCLUDE_BL_HELPER
 #define PIOS_INCLUDE_FLASH
 #define PIOS_INCLUDE_LOGFS_SETTINGS
+#define PIOS_INCLUDE_TRACE
 
 #define PIOS_RCVR_MAX_CHANNELS			12
 #define PIOS_RCVR_MAX_DEVS              3
@@ -41,10 +41,12 @@
 extern "C" {
 
 #include "coordinate_conversions.h" /* API for coordinate_conversions functions */
+#include "rotation_math.h"         /* inline rotation kernels */
 
 }
 
 #include <math.h>		/* fabs() */
+#include <time.h>		/* clock() */
 
 // To use a test fixture, derive a class from testing::Test.
 class CoordConversion : public testing::Test {
@@ -85,3 +87,128 @@ TEST_F(RneFromLLATest, Equator) {
   ASSERT_NEAR(0, Rne[2][1], eps);
   ASSERT_NEAR(0, Rne[2][2], eps);
 };
+
+// Test fixture for the inline kernels of rotation_math.h
+class RotationMathTest : public CoordConversion {
+protected:
+  virtual void SetUp() {
+    // A few unit quaternions away from the axes
+    const float rpy[][3] = {
+      { 0, 0, 0 },
+      { 30, -20, 110 },
+      { -170, 60, -45 },
+      { 5, 85, 200 },
+    };
+    for (int i = 0; i < NUM_QUATS; i++)
+      RPY2Quaternion(rpy[i], q[i]);
+  }
+
+  static const int NUM_QUATS = 4;
+  float q[NUM_QUATS][4];
+};
+
+TEST_F(RotationMathTest, QuatRotateMatchesRotMult) {
+  const float v[3] = { 0.3f, -1.2f, 9.81f };
+  const float eps = 1e-5f;
+
+  for (int i = 0; i < NUM_QUATS; i++) {
+    float R[3][3];
+    Quaternion2R(q[i], R);
+
+    float body[3], body_inline[3];
+    rot_mult(R, v, body, false);
+    quat_rotate(q[i], v, body_inline);
+
+    float earth[3], earth_inline[3];
+    rot_mult(R, v, earth, true);
+    quat_rotate_transpose(q[i], v, earth_inline);
+
+    for (int j = 0; j < 3; j++) {
+      EXPECT_NEAR(body[j], body_inline[j], eps);
+      EXPECT_NEAR(earth[j], earth_inline[j], eps);
+    }
+  }
+}
+
+TEST_F(RotationMathTest, ScaleBiasMatchesRotMult) {
+  const float raw[3] = { 812, -1023, 4096 };
+  const float scale[3] = { 0.0024f, 0.0025f, 0.0023f };
+  const float bias[3] = { 0.1f, -0.3f, 0.05f };
+
+  for (int i = 0; i < NUM_QUATS; i++) {
+    float R[3][3];
+    Quaternion2R(q[i], R);
+
+    const float calibrated[3] = {
+      raw[0] * scale[0] - bias[0],
+      raw[1] * scale[1] - bias[1],
+      raw[2] * scale[2] - bias[2]
+    };
+
+    for (int transpose = 0; transpose < 2; transpose++) {
+      float out[3], out_fused[3];
+      rot_mult(R, calibrated, out, transpose);
+      rot_mult_scale_bias(R, raw, scale, bias, out_fused, transpose);
+
+      for (int j = 0; j < 3; j++)
+        EXPECT_FLOAT_EQ(out[j], out_fused[j]);
+    }
+  }
+}
+
+TEST_F(RotationMathTest, IntegrateMatchesQuatMult) {
+  // A first order step is q + dT/2 * q * [0 w]
+  const float rates[3] = { 1.5f, -0.4f, 3.0f };
+  const float dT = 0.002f;
+
+  for (int i = 0; i < NUM_QUATS; i++) {
+    const float w[4] = { 0, rates[0], rates[1], rates[2] };
+    float qdot[4];
+    quat_mult(q[i], w, qdot);
+
+    float expected[4];
+    for (int j = 0; j < 4; j++)
+      expected[j] = q[i][j] + qdot[j] * dT / 2;
+    float qmag = sqrtf(expected[0] * expected[0] + expected[1] * expected[1] +
+                       expected[2] * expected[2] + expected[3] * expected[3]);
+
+    float q_step[4];
+    quat_copy(q[i], q_step);
+    EXPECT_NEAR(qmag, quat_integrate_normalize(q_step, rates, dT), 1e-6f);
+
+    for (int j = 0; j < 4; j++)
+      EXPECT_NEAR(expected[j] / qmag, q_step[j], 1e-6f);
+  }
+}
+
+TEST_F(RotationMathTest, Throughput) {
+  // Rotating a vector into the body frame, as the attitude loop does for
+  // the magnetic field. Reports the time, the result must not differ.
+  const int ITERATIONS = 200000;
+  const float v[3] = { 0.4f, 0.1f, 0.9f };
+  volatile float sink = 0;
+
+  clock_t start = clock();
+  for (int k = 0; k < ITERATIONS; k++) {
+    float R[3][3], out[3];
+    Quaternion2R(q[k % NUM_QUATS], R);
+    rot_mult(R, v, out, false);
+    sink = sink + out[0];
+  }
+  clock_t scalar = clock() - start;
+  float scalar_sum = sink;
+
+  sink = 0;
+  start = clock();
+  for (int k = 0; k < ITERATIONS; k++) {
+    float out[3];
+    quat_rotate(q[k % NUM_QUATS], v, out);
+    sink = sink + out[0];
+  }
+  clock_t fused = clock() - start;
+
+  printf("Quaternion2R + rot_mult: %.1f ns, quat_rotate: %.1f ns\n",
+         1e9 * scalar / CLOCKS_PER_SEC / ITERATIONS,
+         1e9 * fused / CLOCKS_PER_SEC / ITERATIONS);
+  EXPECT_NEAR(scalar_sum, sink, fabsf(scalar_sum) * 1e-4f);
+}
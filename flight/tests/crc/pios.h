@@ -0,0 +1,2 @@
+/* Only the CRC functions are tested, pios_crc.c needs nothing else */
+#include <pios_crc.h>
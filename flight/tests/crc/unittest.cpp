@@ -0,0 +1,218 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the CRC functions
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+#include "pios_crc.h"
+#include "checksum.h"		/* MAVLink X.25 CRC */
+}
+
+#define BUFFER_SIZE 1024
+
+// Bit by bit versions of the CRCs, straight from the definitions
+static uint8_t crc8_bitwise(uint8_t crc, const uint8_t *data, int32_t length)
+{
+	while (length-- > 0) {
+		crc ^= *data++;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+	}
+	return crc;
+}
+
+static uint16_t crc16_bitwise(uint16_t crc, const uint8_t *data, int32_t length)
+{
+	while (length-- > 0) {
+		crc ^= *data++;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : (crc >> 1);
+	}
+	return crc;
+}
+
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *data, int32_t length)
+{
+	while (length-- > 0) {
+		crc ^= (uint32_t)*data++ << 24;
+		for (int i = 0; i < 8; i++)
+			crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+	}
+	return crc;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class Crc : public testing::Test {
+protected:
+	virtual void SetUp() {
+		srand(1234);
+		for (int i = 0; i < BUFFER_SIZE; i++)
+			buffer[i] = rand();
+	}
+
+	virtual void TearDown() {
+	}
+
+	uint8_t buffer[BUFFER_SIZE];
+};
+
+static const uint8_t check[] = "123456789";
+
+TEST_F(Crc, CheckValues) {
+	// Catalogued check values of CRC-8, CRC-16/MCRF4XX and CRC-32/MPEG-2
+	EXPECT_EQ(0xf4, PIOS_CRC_updateCRC(0, check, 9));
+	EXPECT_EQ(0x6f91, PIOS_CRC16_updateCRC(0xffff, check, 9));
+	EXPECT_EQ(0x0376e6e7U, PIOS_CRC32_updateCRC(0xffffffff, check, 9));
+}
+
+TEST_F(Crc, Crc8MatchesByteByByte) {
+	// Every length and alignment to cover the slices and the tail
+	for (int offset = 0; offset < 4; offset++) {
+		for (int length = 0; length < 64; length++) {
+			uint8_t crc = 0x5a;
+			for (int i = 0; i < length; i++)
+				crc = PIOS_CRC_updateByte(crc, buffer[offset + i]);
+
+			EXPECT_EQ(crc, PIOS_CRC_updateCRC(0x5a, &buffer[offset], length));
+			EXPECT_EQ(crc, crc8_bitwise(0x5a, &buffer[offset], length));
+		}
+	}
+
+	EXPECT_EQ(crc8_bitwise(0, buffer, BUFFER_SIZE), PIOS_CRC_updateCRC(0, buffer, BUFFER_SIZE));
+}
+
+TEST_F(Crc, Crc16MatchesByteByByte) {
+	for (int offset = 0; offset < 4; offset++) {
+		for (int length = 0; length < 64; length++) {
+			uint16_t crc = 0xa55a;
+			for (int i = 0; i < length; i++)
+				crc = PIOS_CRC16_updateByte(crc, buffer[offset + i]);
+
+			EXPECT_EQ(crc, PIOS_CRC16_updateCRC(0xa55a, &buffer[offset], length));
+			EXPECT_EQ(crc, crc16_bitwise(0xa55a, &buffer[offset], length));
+		}
+	}
+
+	EXPECT_EQ(crc16_bitwise(0, buffer, BUFFER_SIZE), PIOS_CRC16_updateCRC(0, buffer, BUFFER_SIZE));
+}
+
+TEST_F(Crc, Crc16MatchesMavlink) {
+	for (int length = 0; length < 300; length++) {
+		EXPECT_EQ(crc_calculate(buffer, length), PIOS_CRC16_updateCRC(X25_INIT_CRC, buffer, length));
+	}
+
+	// Continuing a CRC, as done for the payload and the extra CRC byte
+	uint16_t crc = crc_calculate(buffer, 5);
+	crc_accumulate_buffer(&crc, (const char *)&buffer[5], 100);
+	crc_accumulate(buffer[105], &crc);
+	EXPECT_EQ(crc, PIOS_CRC16_updateCRC(X25_INIT_CRC, buffer, 106));
+}
+
+TEST_F(Crc, Crc32MatchesByteByByte) {
+	for (int offset = 0; offset < 4; offset++) {
+		for (int length = 0; length < 64; length++) {
+			uint32_t crc = 0x12345678;
+			for (int i = 0; i < length; i++)
+				crc = PIOS_CRC32_updateByte(crc, buffer[offset + i]);
+
+			EXPECT_EQ(crc, PIOS_CRC32_updateCRC(0x12345678, &buffer[offset], length));
+			EXPECT_EQ(crc, crc32_bitwise(0x12345678, &buffer[offset], length));
+		}
+	}
+}
+
+TEST_F(Crc, SplitBuffers) {
+	// A CRC over a buffer in pieces is the same as over the whole buffer
+	uint8_t crc8 = 0;
+	uint16_t crc16 = 0;
+	for (int i = 0; i < BUFFER_SIZE; i += 37) {
+		int length = (BUFFER_SIZE - i < 37) ? BUFFER_SIZE - i : 37;
+		crc8 = PIOS_CRC_updateCRC(crc8, &buffer[i], length);
+		crc16 = PIOS_CRC16_updateCRC(crc16, &buffer[i], length);
+	}
+	EXPECT_EQ(PIOS_CRC_updateCRC(0, buffer, BUFFER_SIZE), crc8);
+	EXPECT_EQ(PIOS_CRC16_updateCRC(0, buffer, BUFFER_SIZE), crc16);
+}
+
+static double elapsed_us(const struct timespec *start)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+TEST_F(Crc, Benchmark) {
+	const int passes = 2000;
+	struct timespec start;
+	volatile uint32_t sink = 0;
+	double bytes = (double)passes * BUFFER_SIZE;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int n = 0; n < passes; n++) {
+		uint8_t crc = 0;
+		for (int i = 0; i < BUFFER_SIZE; i++)
+			crc = PIOS_CRC_updateByte(crc, buffer[i]);
+		sink += crc;
+	}
+	double byte8 = elapsed_us(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int n = 0; n < passes; n++)
+		sink += PIOS_CRC_updateCRC(0, buffer, BUFFER_SIZE);
+	double buffer8 = elapsed_us(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int n = 0; n < passes; n++) {
+		uint16_t crc = X25_INIT_CRC;
+		for (int i = 0; i < BUFFER_SIZE; i++)
+			crc_accumulate(buffer[i], &crc);
+		sink += crc;
+	}
+	double mavlink16 = elapsed_us(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int n = 0; n < passes; n++)
+		sink += PIOS_CRC16_updateCRC(X25_INIT_CRC, buffer, BUFFER_SIZE);
+	double buffer16 = elapsed_us(&start);
+
+	printf("CRC8  byte by byte %7.1f MB/s, buffer %7.1f MB/s\n", bytes / byte8, bytes / buffer8);
+	printf("CRC16 MAVLink      %7.1f MB/s, buffer %7.1f MB/s\n", bytes / mavlink16, bytes / buffer16);
+
+	(void)sink;
+}
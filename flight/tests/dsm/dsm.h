@@ -1,6 +1,8 @@
 
 #include "stdint.h"
 #include "stdbool.h"
+#include "pios.h"
+#include "pios_stm32.h"
 
 #define PIOS_DSM_NUM_INPUTS     12
 #define DSM_CHANNELS_PER_FRAME  7
@@ -29,6 +31,10 @@ struct pios_dsm_state {
 #endif
 };
 
+struct pios_dsm_cfg {
+	struct stm32_gpio bind;
+};
+
 struct pios_dsm_dev {
 	enum pios_dsm_dev_magic magic;
 	const struct pios_dsm_cfg *cfg;
@@ -36,6 +42,12 @@ struct pios_dsm_dev {
 	enum dsm_resolution resolution;
 };
 
+/* Helpers of the test */
 int PIOS_DSM_Reset(struct pios_dsm_dev *dsm_dev);
+int PIOS_DSM_GetResolution(struct pios_dsm_dev *dsm_dev);
+
+/* From the driver */
 int PIOS_DSM_UnrollChannels(struct pios_dsm_dev *dsm_dev);
-int PIOS_DSM_GetResolution(struct pios_dsm_dev *dsm_dev);
\ No newline at end of file
+int32_t PIOS_DSM_Init(uintptr_t *dsm_id, const struct pios_dsm_cfg *cfg,
+		const struct pios_com_driver *driver, uintptr_t lower_id, uint8_t bind);
+extern const struct pios_rcvr_driver pios_dsm_rcvr_driver;
\ No newline at end of file
@@ -0,0 +1,41 @@
+/* Just enough of PiOS to build the DSM driver on the host */
+#ifndef PIOS_H
+#define PIOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define PIOS_INCLUDE_DSM
+#define PIOS_INCLUDE_RTC
+#define PIOS_DSM_NUM_INPUTS 12
+#define PIOS_SYSCLK 72000000
+
+#define PIOS_Assert(test) assert(test)
+#define PIOS_DEBUG_Assert(test) assert(test)
+#define PIOS_malloc(size) malloc(size)
+
+typedef struct {
+	uint32_t GPIO_Pin;
+	uint32_t GPIO_PuPd;
+} GPIO_InitTypeDef;
+
+typedef struct {
+	uint32_t ODR;
+} GPIO_TypeDef;
+
+#define GPIO_PuPd_UP 1
+
+void GPIO_Init(GPIO_TypeDef *gpio, GPIO_InitTypeDef *init);
+void GPIO_SetBits(GPIO_TypeDef *gpio, uint32_t pins);
+void GPIO_ResetBits(GPIO_TypeDef *gpio, uint32_t pins);
+
+uint32_t PIOS_DELAY_GetRaw(void);
+int32_t PIOS_DELAY_WaituS(uint32_t us);
+bool PIOS_RTC_RegisterTickCallback(void (*callback)(uintptr_t id), uintptr_t id);
+
+#include "pios_com.h"
+#include "pios_rcvr.h"
+
+#endif /* PIOS_H */
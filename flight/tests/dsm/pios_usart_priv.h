@@ -0,0 +1 @@
+/* The DSM driver only needs the COM driver interface */
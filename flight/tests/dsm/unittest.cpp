@@ -42,6 +42,33 @@ extern "C" {
 
 #include "dsm.h"
 
+static int frames_signalled;
+
+void PIOS_RCVR_ActiveFromISR(bool *woken)
+{
+  frames_signalled++;
+  *woken = true;
+}
+
+/* What the driver registers with the USART and the RTC */
+static pios_com_callback usart_rx_cb;
+static uintptr_t usart_rx_context;
+static void (*rtc_tick_cb)(uintptr_t id);
+static uintptr_t rtc_tick_id;
+
+static void usart_bind_rx_cb(uintptr_t, pios_com_callback rx_in_cb, uintptr_t context)
+{
+  usart_rx_cb = rx_in_cb;
+  usart_rx_context = context;
+}
+
+bool PIOS_RTC_RegisterTickCallback(void (*callback)(uintptr_t id), uintptr_t id)
+{
+  rtc_tick_cb = callback;
+  rtc_tick_id = id;
+  return true;
+}
+
 }
 
 // example data can be found at http://wiki.paparazziuav.org/wiki/DSM
@@ -60,6 +87,7 @@ protected:
  void pack_channels_10bit(uint16_t channels[DSM_CHANNELS_PER_FRAME], struct pios_dsm_state *state, bool frame);
  void pack_channels_11bit(uint16_t channels[DSM_CHANNELS_PER_FRAME], struct pios_dsm_state *state, bool frame);
  int validate_file(const char *fn, int resolution, int channels, bool skip);
+ void validate_frame_events(const char *fn, int channels);
  int get_packet(FILE *fid, uint8_t *buf);
  struct pios_dsm_state *state;
  struct pios_dsm_dev dev;
@@ -295,6 +323,96 @@ TEST_F(DsmTest, DX18_DSMX_22ms_XPlus_even) {
   validate_file("DX18_22msDSMX_XPlus.txt",11,12,true);
 }
 
+/**
+ * Feed a capture through the driver one byte at a time, the way the USART
+ * interrupt does, with the RTC ticks of the gaps between the frames. Check
+ * that every complete frame is signalled exactly once, on its last byte
+ * and with all channels already decoded.
+ */
+void DsmTest::validate_frame_events(const char *fn, int channels)
+{
+  static const struct pios_com_driver usart_driver = {
+    .bind_rx_cb = usart_bind_rx_cb,
+  };
+  static const struct pios_dsm_cfg cfg = {};
+
+  uintptr_t dsm_id;
+  ASSERT_EQ(0, PIOS_DSM_Init(&dsm_id, &cfg, &usart_driver, 0, 0));
+  ASSERT_TRUE(usart_rx_cb != NULL);
+  ASSERT_TRUE(rtc_tick_cb != NULL);
+  ASSERT_EQ(dsm_id, usart_rx_context);
+  ASSERT_EQ(dsm_id, rtc_tick_id);
+
+  FILE *fid = fopen(fn, "r");
+  ASSERT_TRUE(fid != NULL);
+
+  char *line = NULL;
+  size_t len = 0;
+
+  // throwaway intro line
+  getline(&line, &len, fid);
+  free(line);
+
+  uint8_t packet[DSM_FRAME_LENGTH];
+  int packets = 0;
+  frames_signalled = 0;
+
+  while (get_packet(fid, packet) == 0) {
+    // the gap before the frame, the supervisor syncs on it
+    for (int i = 0; i < 5; i++)
+      rtc_tick_cb(rtc_tick_id);
+
+    int before = frames_signalled;
+    bool need_yield = true;
+
+    for (int i = 0; i < DSM_FRAME_LENGTH - 1; i++) {
+      EXPECT_EQ(1, usart_rx_cb(usart_rx_context, &packet[i], 1, NULL, &need_yield));
+      EXPECT_FALSE(need_yield);
+    }
+    EXPECT_EQ(before, frames_signalled);
+
+    usart_rx_cb(usart_rx_context, &packet[DSM_FRAME_LENGTH - 1], 1, NULL, &need_yield);
+    packets++;
+
+    // the first packets may be needed to detect the resolution
+    if (packets > 2) {
+      EXPECT_EQ(before + 1, frames_signalled);
+      EXPECT_TRUE(need_yield);
+
+      for (int i = 0; i < channels; i++) {
+        int32_t value = pios_dsm_rcvr_driver.read(dsm_id, i);
+        EXPECT_GT(value, 340);
+        EXPECT_LE(value, 2048);
+      }
+    }
+
+    // bytes after the end of the frame are ignored until the next gap
+    int after = frames_signalled;
+    uint8_t stray = 0xff;
+    usart_rx_cb(usart_rx_context, &stray, 1, NULL, &need_yield);
+    EXPECT_EQ(after, frames_signalled);
+    EXPECT_FALSE(need_yield);
+  }
+
+  EXPECT_GT(packets, 10);
+  EXPECT_GE(frames_signalled, packets - 2);
+
+  fclose(fid);
+  free((void *)dsm_id);
+}
+
+TEST_F(DsmTest, FrameEvents_DX7_DSM2_11ms) {
+  validate_frame_events("DX7_11msDSM2.txt", 8);
+}
+
+TEST_F(DsmTest, FrameEvents_DX7_DSMX_22ms) {
+  validate_frame_events("DX7_22msDSMX.txt", 8);
+}
+
+TEST_F(DsmTest, FrameEvents_DX18_DSMX_11ms) {
+  validate_frame_events("DX18_11msDSMX.txt", 10);
+}
+
 /**
  * Test a file recorded using Sparky2 and a DX7
  * that was bound with 4 pulses.
@@ -37,6 +37,7 @@
 #include <stdlib.h>		/* abort */
 #include <string.h>		/* memset */
 #include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
 
 extern "C" {
 
@@ -81,8 +82,9 @@ TEST_F(EncodeDecode, CorrectEncode) {
 TEST_F(EncodeDecode, PassEncode) {
   unsigned char p[10] = {'a', 'b', 'c', 'd', 'e', 'f'};
   encode_data(p, 6, p);
-  decode_data(p, 6 + RS_ECC_NPARITY);
-  EXPECT_EQ(0, check_syndrome());
+  struct ecc_decoder dec;
+  decode_data(&dec, p, 6 + RS_ECC_NPARITY);
+  EXPECT_EQ(0, check_syndrome(&dec));
 };
 
 TEST_F(EncodeDecode, Recover) {
@@ -94,13 +96,251 @@ TEST_F(EncodeDecode, Recover) {
   p2[4] = 30;
 
   // verify it flags the error
-  decode_data(p2, 6 + RS_ECC_NPARITY);
-  EXPECT_EQ(1, check_syndrome());
+  struct ecc_decoder dec;
+  decode_data(&dec, p2, 6 + RS_ECC_NPARITY);
+  EXPECT_EQ(1, check_syndrome(&dec));
 
   // verify it is corrected
-  EXPECT_EQ(1, correct_errors_erasures(p2, 10, 0, 0));
+  EXPECT_EQ(1, correct_errors_erasures(&dec, p2, 10, 0, 0));
 
   for (int i = 0; i < 6; i++)
     EXPECT_EQ(p[i], p2[i]);
 
 };
+
+// The encoder and syndromes as they were computed before the tables,
+// one multiplication per byte and parity symbol
+static void reference_encode(const unsigned char msg[], int nbytes, unsigned char dst[])
+{
+  int genpoly[MAXDEG * 2], tp[MAXDEG], tp1[MAXDEG];
+  int lfsr[RS_ECC_NPARITY + 1] = {};
+
+  zero_poly(tp1);
+  tp1[0] = 1;
+  for (int i = 1; i <= RS_ECC_NPARITY; i++) {
+    zero_poly(tp);
+    tp[0] = gexp[i];
+    tp[1] = 1;
+    mult_polys(genpoly, tp, tp1);
+    copy_poly(tp1, genpoly);
+  }
+
+  for (int i = 0; i < nbytes; i++) {
+    int dbyte = msg[i] ^ lfsr[RS_ECC_NPARITY - 1];
+    for (int j = RS_ECC_NPARITY - 1; j > 0; j--)
+      lfsr[j] = lfsr[j - 1] ^ gmult(genpoly[j], dbyte);
+    lfsr[0] = gmult(genpoly[0], dbyte);
+  }
+
+  memmove(dst, msg, nbytes);
+  for (int i = 0; i < RS_ECC_NPARITY; i++)
+    dst[nbytes + i] = lfsr[RS_ECC_NPARITY - 1 - i];
+}
+
+static void reference_syndrome(const unsigned char data[], int nbytes, int syn[])
+{
+  for (int j = 0; j < RS_ECC_NPARITY; j++) {
+    int sum = 0;
+    for (int i = 0; i < nbytes; i++)
+      sum = data[i] ^ gmult(gexp[j + 1], sum);
+    syn[j] = sum;
+  }
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#define MAX_PACKET 255
+
+class RandomCodewords : public EncodeDecode {
+protected:
+  virtual void SetUp() {
+    EncodeDecode::SetUp();
+    srand(4321);
+  }
+
+  // Random message of a random length, encoded
+  int random_codeword(unsigned char *codeword) {
+    int len = 1 + rand() % (MAX_PACKET - RS_ECC_NPARITY);
+    for (int i = 0; i < len; i++)
+      codeword[i] = rand();
+    encode_data(codeword, len, codeword);
+    return len + RS_ECC_NPARITY;
+  }
+
+  // Damage some different bytes, returns their positions
+  void damage(unsigned char *codeword, int len, int count, int *positions) {
+    for (int n = 0; n < count; n++) {
+      bool again;
+      do {
+        positions[n] = rand() % len;
+        again = false;
+        for (int m = 0; m < n; m++)
+          again |= positions[m] == positions[n];
+      } while (again);
+      codeword[positions[n]] ^= 1 + rand() % 255;
+    }
+  }
+};
+
+TEST_F(RandomCodewords, MatchesReference) {
+  unsigned char msg[MAX_PACKET], codeword[MAX_PACKET], expected[MAX_PACKET];
+
+  for (int n = 0; n < 2000; n++) {
+    int len = rand() % (MAX_PACKET - RS_ECC_NPARITY + 1);
+    for (int i = 0; i < len; i++)
+      msg[i] = rand();
+
+    encode_data(msg, len, codeword);
+    reference_encode(msg, len, expected);
+    ASSERT_EQ(0, memcmp(expected, codeword, len + RS_ECC_NPARITY)) << len;
+
+    // Syndromes of damaged codewords
+    int positions[3];
+    damage(codeword, len + RS_ECC_NPARITY, 1 + n % 3, positions);
+
+    struct ecc_decoder dec;
+    int syn[RS_ECC_NPARITY];
+    decode_data(&dec, codeword, len + RS_ECC_NPARITY);
+    reference_syndrome(codeword, len + RS_ECC_NPARITY, syn);
+    for (int j = 0; j < RS_ECC_NPARITY; j++)
+      ASSERT_EQ(syn[j], dec.synBytes[j]) << len << " " << j;
+    EXPECT_EQ(1, check_syndrome(&dec));
+  }
+}
+
+TEST_F(RandomCodewords, CorrectErrors) {
+  unsigned char codeword[MAX_PACKET], damaged[MAX_PACKET];
+
+  for (int n = 0; n < 2000; n++) {
+    int len = random_codeword(codeword);
+    memcpy(damaged, codeword, len);
+
+    // Half the parity bytes can correct errors at unknown places
+    int positions[RS_ECC_NPARITY / 2];
+    damage(damaged, len, 1 + n % (RS_ECC_NPARITY / 2), positions);
+
+    struct ecc_decoder dec;
+    decode_data(&dec, damaged, len);
+    ASSERT_EQ(1, check_syndrome(&dec));
+    ASSERT_EQ(1, correct_errors_erasures(&dec, damaged, len, 0, 0)) << len;
+    ASSERT_EQ(0, memcmp(codeword, damaged, len)) << len;
+  }
+}
+
+TEST_F(RandomCodewords, CorrectErasures) {
+  unsigned char codeword[MAX_PACKET], damaged[MAX_PACKET];
+
+  for (int n = 0; n < 2000; n++) {
+    int len = random_codeword(codeword);
+    memcpy(damaged, codeword, len);
+
+    // Every parity byte can correct an error at a known place
+    int positions[RS_ECC_NPARITY], erasures[RS_ECC_NPARITY];
+    int count = 1 + n % RS_ECC_NPARITY;
+    damage(damaged, len, count, positions);
+    for (int i = 0; i < count; i++)
+      erasures[i] = len - 1 - positions[i];
+
+    struct ecc_decoder dec;
+    decode_data(&dec, damaged, len);
+    ASSERT_EQ(1, check_syndrome(&dec));
+    ASSERT_EQ(1, correct_errors_erasures(&dec, damaged, len, count, erasures)) << len;
+    ASSERT_EQ(0, memcmp(codeword, damaged, len)) << len;
+  }
+}
+
+TEST_F(RandomCodewords, DetectTooManyErrors) {
+  unsigned char codeword[MAX_PACKET];
+  int detected = 0;
+
+  for (int n = 0; n < 2000; n++) {
+    int len = random_codeword(codeword);
+
+    // Up to the number of parity bytes every error is detected
+    int positions[RS_ECC_NPARITY];
+    damage(codeword, len, RS_ECC_NPARITY, positions);
+
+    struct ecc_decoder dec;
+    decode_data(&dec, codeword, len);
+    ASSERT_EQ(1, check_syndrome(&dec));
+
+    // A correction may only ever produce a codeword
+    if (correct_errors_erasures(&dec, codeword, len, 0, 0)) {
+      decode_data(&dec, codeword, len);
+      EXPECT_EQ(0, check_syndrome(&dec)) << n;
+    } else {
+      detected++;
+    }
+  }
+  printf("%d of 2000 codewords with %d errors detected as uncorrectable\n", detected, RS_ECC_NPARITY);
+}
+
+TEST_F(RandomCodewords, Interleaved) {
+  unsigned char a[MAX_PACKET], b[MAX_PACKET], a_sent[MAX_PACKET], b_sent[MAX_PACKET];
+  int positions[1];
+
+  // Two radios decode and correct their packets in between each other
+  for (int n = 0; n < 500; n++) {
+    int a_len = random_codeword(a);
+    int b_len = random_codeword(b);
+    memcpy(a_sent, a, a_len);
+    memcpy(b_sent, b, b_len);
+    damage(a, a_len, 1, positions);
+    damage(b, b_len, 1, positions);
+
+    struct ecc_decoder a_dec, b_dec;
+    decode_data(&a_dec, a, a_len);
+    decode_data(&b_dec, b, b_len);
+    ASSERT_EQ(1, correct_errors_erasures(&a_dec, a, a_len, 0, 0));
+    ASSERT_EQ(1, correct_errors_erasures(&b_dec, b, b_len, 0, 0));
+    ASSERT_EQ(0, memcmp(a_sent, a, a_len));
+    ASSERT_EQ(0, memcmp(b_sent, b, b_len));
+  }
+}
+
+TEST_F(RandomCodewords, Benchmark) {
+  const int packets = 2000;
+  const int len = 64;		/* a typical radio packet */
+  static unsigned char data[2000][MAX_PACKET];
+  int syn[RS_ECC_NPARITY];
+
+  for (int n = 0; n < packets; n++)
+    for (int i = 0; i < len; i++)
+      data[n][i] = rand();
+
+  double start = now_ns();
+  for (int n = 0; n < packets; n++)
+    reference_encode(data[n], len, data[n]);
+  double reference_encoded = now_ns() - start;
+
+  start = now_ns();
+  for (int n = 0; n < packets; n++)
+    encode_data(data[n], len, data[n]);
+  double encoded = now_ns() - start;
+
+  start = now_ns();
+  for (int n = 0; n < packets; n++)
+    reference_syndrome(data[n], len + RS_ECC_NPARITY, syn);
+  double reference_decoded = now_ns() - start;
+
+  struct ecc_decoder dec;
+  int errors = 0;
+  start = now_ns();
+  for (int n = 0; n < packets; n++) {
+    decode_data(&dec, data[n], len + RS_ECC_NPARITY);
+    errors += check_syndrome(&dec);
+  }
+  double decoded = now_ns() - start;
+  EXPECT_EQ(0, errors);
+
+  double mb = packets * len / 1e6;
+  printf("encode: %6.1f MB/s, was %6.1f MB/s\n", mb / (encoded / 1e9), mb / (reference_encoded / 1e9));
+  printf("decode: %6.1f MB/s, was %6.1f MB/s\n", mb / (decoded / 1e9), mb / (reference_decoded / 1e9));
+  EXPECT_LT(encoded, reference_encoded);
+  EXPECT_LT(decoded, reference_decoded);
+}
@@ -0,0 +1,222 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* libm reference */
+#include <time.h>		/* clock() */
+
+extern "C" {
+
+#include "fastmath.h"
+
+}
+
+// Sweeps each function against libm in double precision and checks the
+// maximum error stays within what fastmath.h documents
+class FastMath : public testing::Test {
+protected:
+  virtual void SetUp() {
+  }
+
+  virtual void TearDown() {
+  }
+
+  static const int STEPS = 200000;
+};
+
+TEST_F(FastMath, Atan2) {
+  double max_err = 0;
+  const float radii[] = { 1e-6f, 1e-2f, 1.0f, 37.5f, 1e4f };
+
+  for (unsigned int k = 0; k < sizeof(radii) / sizeof(radii[0]); k++) {
+    for (int i = 0; i <= STEPS; i++) {
+      double angle = -M_PI + 2 * M_PI * i / STEPS;
+      float y = radii[k] * sin(angle), x = radii[k] * cos(angle);
+      double err = fabs(fast_atan2f(y, x) - atan2((double) y, (double) x));
+      // pi and -pi are the same angle
+      if (err > M_PI)
+        err = fabs(err - 2 * M_PI);
+      if (err > max_err)
+        max_err = err;
+    }
+  }
+
+  printf("fast_atan2f max error %g rad\n", max_err);
+  EXPECT_LT(max_err, 1.5e-5);
+  EXPECT_EQ(0.0f, fast_atan2f(0, 0));
+}
+
+TEST_F(FastMath, Asin) {
+  double max_err = 0;
+
+  for (int i = 0; i <= STEPS; i++) {
+    float x = -1.0f + 2.0f * i / STEPS;
+    double err = fabs(fast_asinf(x) - asin((double) x));
+    if (err > max_err)
+      max_err = err;
+  }
+
+  printf("fast_asinf max error %g rad\n", max_err);
+  EXPECT_LT(max_err, 1.5e-5);
+  EXPECT_NEAR(M_PI / 2, fast_asinf(1.0001f), 1.5e-5);
+}
+
+TEST_F(FastMath, SinCos) {
+  double max_err = 0;
+
+  for (int i = 0; i <= STEPS; i++) {
+    float x = (float) (-8 * M_PI + 16 * M_PI * i / STEPS);
+    double err_sin = fabs(fast_sinf(x) - sin((double) x));
+    double err_cos = fabs(fast_cosf(x) - cos((double) x));
+    if (err_sin > max_err)
+      max_err = err_sin;
+    if (err_cos > max_err)
+      max_err = err_cos;
+  }
+
+  printf("fast_sinf/fast_cosf max error %g\n", max_err);
+  EXPECT_LT(max_err, 2e-6);
+}
+
+TEST_F(FastMath, Log2) {
+  double max_err = 0, max_err_small = 0;
+
+  // Whole range of normal floats
+  for (int i = 0; i <= STEPS; i++) {
+    float x = (float) exp2(-125.0 + 252.0 * i / STEPS);
+    double err = fabs(fast_log2f(x) - log2((double) x));
+    if (err > max_err)
+      max_err = err;
+    if (fabs(log2((double) x)) <= 16 && err > max_err_small)
+      max_err_small = err;
+  }
+
+  printf("fast_log2f max error %g, %g within 2^-16 and 2^16\n", max_err, max_err_small);
+  EXPECT_LT(max_err, 8e-6);
+  EXPECT_LT(max_err_small, 3e-6);
+}
+
+TEST_F(FastMath, Exp2) {
+  double max_err = 0;
+
+  for (int i = 0; i <= STEPS; i++) {
+    float x = -126.0f + 253.9f * i / STEPS;
+    double ref = exp2((double) x);
+    double err = fabs(fast_exp2f(x) - ref) / ref;
+    if (err > max_err)
+      max_err = err;
+  }
+
+  printf("fast_exp2f max relative error %g\n", max_err);
+  EXPECT_LT(max_err, 4e-6);
+  EXPECT_EQ(0.0f, fast_exp2f(-130.0f));
+}
+
+TEST_F(FastMath, Pow) {
+  double max_err = 0;
+
+  // Bases and exponents of the call sites: tilt compensation, the
+  // barometric formula and squares
+  for (int i = 1; i <= 1000; i++) {
+    float x = 0.001f * i * i;
+    for (int j = -40; j <= 40; j++) {
+      float y = j * 0.1f;
+      double ref = pow((double) x, (double) y);
+      if (fabs(log2(ref)) > 16)
+        continue;
+      double err = fabs(fast_powf(x, y) - ref) / ref;
+      if (err > max_err)
+        max_err = err;
+    }
+  }
+
+  printf("fast_powf max relative error %g\n", max_err);
+  EXPECT_LT(max_err, 1.5e-5);
+  EXPECT_EQ(0.0f, fast_powf(0.0f, 2.0f));
+}
+
+TEST_F(FastMath, Throughput) {
+  // Reports the time of libm against fastmath, the sums must agree
+  const int ITERATIONS = 1000000;
+  volatile float sink;
+
+  struct {
+    const char *name;
+    float (*libm)(float, float);
+    float (*fast)(float, float);
+  } funcs[] = {
+    { "atan2f", atan2f, fast_atan2f },
+    { "powf", powf, fast_powf },
+  };
+
+  for (unsigned int k = 0; k < sizeof(funcs) / sizeof(funcs[0]); k++) {
+    clock_t start = clock();
+    sink = 0;
+    for (int i = 0; i < ITERATIONS; i++)
+      sink = sink + funcs[k].libm(0.5f + i * 1e-6f, 0.75f);
+    clock_t libm_time = clock() - start;
+    float libm_sum = sink;
+
+    start = clock();
+    sink = 0;
+    for (int i = 0; i < ITERATIONS; i++)
+      sink = sink + funcs[k].fast(0.5f + i * 1e-6f, 0.75f);
+    clock_t fast_time = clock() - start;
+
+    printf("%s: libm %.1f ns, fastmath %.1f ns\n", funcs[k].name,
+           1e9 * libm_time / CLOCKS_PER_SEC / ITERATIONS,
+           1e9 * fast_time / CLOCKS_PER_SEC / ITERATIONS);
+    EXPECT_NEAR(libm_sum, sink, fabsf(libm_sum) * 1e-3f);
+  }
+
+  clock_t start = clock();
+  sink = 0;
+  for (int i = 0; i < ITERATIONS; i++)
+    sink = sink + sinf(i * 1e-5f);
+  clock_t libm_time = clock() - start;
+  float libm_sum = sink;
+
+  start = clock();
+  sink = 0;
+  for (int i = 0; i < ITERATIONS; i++)
+    sink = sink + fast_sinf(i * 1e-5f);
+  clock_t fast_time = clock() - start;
+
+  printf("sinf: libm %.1f ns, fastmath %.1f ns\n",
+         1e9 * libm_time / CLOCKS_PER_SEC / ITERATIONS,
+         1e9 * fast_time / CLOCKS_PER_SEC / ITERATIONS);
+  EXPECT_NEAR(libm_sum, sink, fabsf(libm_sum) * 1e-3f);
+}
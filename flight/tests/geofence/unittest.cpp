@@ -0,0 +1,286 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+
+#include "geofence_index.h"	/* API for the geofence index */
+
+}
+
+#include <math.h>		/* fabs() */
+
+#define ARENA_SIZE (64 * 1024)
+#define MAX_VERTICES 2000
+
+// To use a test fixture, derive a class from testing::Test.
+class GeofenceIndex : public testing::Test {
+protected:
+  virtual void SetUp() {
+    num_vertices = 0;
+    srand(1234);
+  }
+
+  virtual void TearDown() {
+  }
+
+  void add_vertex(float north, float east) {
+    ASSERT_LT(num_vertices, MAX_VERTICES);
+    vertices[num_vertices][0] = north;
+    vertices[num_vertices][1] = east;
+    num_vertices++;
+  }
+
+  // Star shaped polygon with a wiggly boundary, concave everywhere
+  void make_star(uint16_t n, float radius) {
+    for (uint16_t i = 0; i < n; i++) {
+      float angle = 2 * (float)M_PI * i / n;
+      float r = radius * (1.0f + 0.3f * sinf(7 * angle) + ((i % 2) ? 0.05f : 0.0f));
+      add_vertex(r * cosf(angle), r * sinf(angle));
+    }
+  }
+
+  // Even-odd ray casting over all the edges
+  bool brute_inside(float north, float east) {
+    bool inside = false;
+    for (uint16_t i = 0, j = num_vertices - 1; i < num_vertices; j = i++) {
+      const float *a = vertices[i];
+      const float *b = vertices[j];
+      if ((a[0] > north) != (b[0] > north)) {
+        float east_cross = a[1] + (north - a[0]) * (b[1] - a[1]) / (b[0] - a[0]);
+        if (east_cross < east)
+          inside = !inside;
+      }
+    }
+    return inside;
+  }
+
+  float brute_distance(float north, float east) {
+    float best = INFINITY;
+    for (uint16_t i = 0, j = num_vertices - 1; i < num_vertices; j = i++) {
+      const float *a = vertices[i];
+      const float *b = vertices[j];
+      float dn = b[0] - a[0], de = b[1] - a[1];
+      float t = ((north - a[0]) * dn + (east - a[1]) * de) / (dn * dn + de * de);
+      t = fminf(fmaxf(t, 0), 1);
+      float pn = a[0] + t * dn - north, pe = a[1] + t * de - east;
+      best = fminf(best, sqrtf(pn * pn + pe * pe));
+    }
+    return best;
+  }
+
+  float random_in(float min, float max) {
+    return min + (max - min) * rand() / (float)RAND_MAX;
+  }
+
+  // Compare the index against the brute force answers on random points
+  void check_random_points(const struct geofence_index *index, float extent, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+      float north = random_in(-extent, extent);
+      float east = random_in(-extent, extent);
+      float distance;
+      bool inside = geofence_index_query(index, north, east, &distance);
+      float expected = brute_distance(north, east);
+
+      // Points right on the boundary can go either way
+      if (expected > 1e-3f * extent) {
+        ASSERT_EQ(brute_inside(north, east), inside) << north << " " << east;
+      }
+
+      // Exact up to half a cell, a lower bound after that
+      float margin = index->cell_size / 2;
+      if (expected < margin) {
+        ASSERT_NEAR(expected, distance, 1e-4f * extent) << north << " " << east;
+      } else {
+        ASSERT_LE(distance, expected * 1.0001f) << north << " " << east;
+      }
+      ASSERT_GE(distance, fminf(expected, margin) - 1e-4f * extent) << north << " " << east;
+    }
+  }
+
+  float vertices[MAX_VERTICES][2];
+  uint16_t num_vertices;
+  uint32_t arena[ARENA_SIZE / sizeof(uint32_t)];
+};
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+TEST_F(GeofenceIndex, Degenerate) {
+  struct geofence_index index;
+
+  // Not enough vertices
+  add_vertex(0, 0);
+  add_vertex(10, 0);
+  EXPECT_EQ(-1, geofence_index_build(&index, vertices, num_vertices, arena, sizeof(arena)));
+
+  // No area
+  add_vertex(20, 0);
+  EXPECT_EQ(-1, geofence_index_build(&index, vertices, num_vertices, arena, sizeof(arena)));
+
+  // No memory
+  add_vertex(20, 20);
+  EXPECT_EQ(-1, geofence_index_build(&index, vertices, num_vertices, arena, 8));
+}
+
+TEST_F(GeofenceIndex, Square) {
+  struct geofence_index index;
+  float distance;
+
+  add_vertex(-100, -100);
+  add_vertex(-100, 100);
+  add_vertex(100, 100);
+  add_vertex(100, -100);
+
+  int32_t used = geofence_index_build(&index, vertices, num_vertices, arena, sizeof(arena));
+  ASSERT_GT(used, 0);
+  EXPECT_LE(used, (int32_t)sizeof(arena));
+
+  EXPECT_TRUE(geofence_index_query(&index, 0, 0, &distance));
+  EXPECT_TRUE(geofence_index_query(&index, 95, -40, &distance));
+  EXPECT_NEAR(5, distance, 1e-4);
+  EXPECT_TRUE(geofence_index_query(&index, -99, 99, &distance));
+  EXPECT_NEAR(1, distance, 1e-4);
+
+  EXPECT_FALSE(geofence_index_query(&index, 103, 0, &distance));
+  EXPECT_NEAR(3, distance, 1e-4);
+  // Further than half a cell the distance is only a lower bound
+  EXPECT_FALSE(geofence_index_query(&index, 0, -150, &distance));
+  EXPECT_LE(distance, 50 + 1e-3);
+  EXPECT_GE(distance, index.cell_size / 2);
+  EXPECT_FALSE(geofence_index_query(&index, 1000, 1000, &distance));
+  EXPECT_NEAR(900 * sqrtf(2), distance, 1e-1);
+}
+
+TEST_F(GeofenceIndex, Concave) {
+  struct geofence_index index;
+
+  // A U shape, the gap must be outside
+  add_vertex(0, 0);
+  add_vertex(0, 300);
+  add_vertex(300, 300);
+  add_vertex(300, 200);
+  add_vertex(100, 200);
+  add_vertex(100, 100);
+  add_vertex(300, 100);
+  add_vertex(300, 0);
+
+  ASSERT_GT(geofence_index_build(&index, vertices, num_vertices, arena, sizeof(arena)), 0);
+
+  float distance;
+  EXPECT_FALSE(geofence_index_query(&index, 250, 150, &distance));
+  EXPECT_LE(distance, 50 + 1e-3);
+  EXPECT_FALSE(geofence_index_query(&index, 250, 195, &distance));
+  EXPECT_NEAR(5, distance, 1e-3);
+  EXPECT_TRUE(geofence_index_query(&index, 250, 50, &distance));
+  EXPECT_TRUE(geofence_index_query(&index, 50, 150, &distance));
+
+  check_random_points(&index, 400, 5000);
+}
+
+TEST_F(GeofenceIndex, LargeStar) {
+  struct geofence_index index;
+
+  make_star(1000, 500);
+  ASSERT_GT(geofence_index_build(&index, vertices, num_vertices, arena, sizeof(arena)), 0);
+
+  check_random_points(&index, 800, 20000);
+}
+
+TEST_F(GeofenceIndex, SmallArena) {
+  struct geofence_index index;
+
+  // Coarser grid when memory is short, the answers stay the same
+  make_star(1000, 500);
+  int32_t full = geofence_index_build(&index, vertices, num_vertices, arena, sizeof(arena));
+  int32_t used = geofence_index_build(&index, vertices, num_vertices, arena, full / 2);
+  ASSERT_GT(used, 0);
+  EXPECT_LE(used, full / 2);
+
+  check_random_points(&index, 800, 5000);
+}
+
+TEST_F(GeofenceIndex, Benchmark) {
+  struct geofence_index index;
+  const uint32_t queries = 20000;
+  static float points[20000][2];
+
+  printf("%8s %10s %12s %12s %10s\n", "vertices", "bytes", "build (us)", "index (ns)", "brute (ns)");
+
+  for (uint16_t n = 100; n <= MAX_VERTICES; n *= 2) {
+    num_vertices = 0;
+    make_star(n, 500);
+
+    for (uint32_t i = 0; i < queries; i++) {
+      points[i][0] = random_in(-800, 800);
+      points[i][1] = random_in(-800, 800);
+    }
+
+    double start = now_ns();
+    int32_t used = geofence_index_build(&index, vertices, num_vertices, arena, sizeof(arena));
+    double build = now_ns() - start;
+    ASSERT_GT(used, 0);
+
+    volatile uint32_t count = 0;
+    float distance;
+
+    start = now_ns();
+    for (uint32_t i = 0; i < queries; i++)
+      count += geofence_index_query(&index, points[i][0], points[i][1], &distance);
+    double indexed = (now_ns() - start) / queries;
+
+    start = now_ns();
+    for (uint32_t i = 0; i < queries; i++) {
+      count += brute_inside(points[i][0], points[i][1]);
+      distance = brute_distance(points[i][0], points[i][1]);
+    }
+    double brute = (now_ns() - start) / queries;
+
+    printf("%8u %10d %12.0f %12.0f %10.0f\n", n, used, build / 1000, indexed, brute);
+
+    // Should not depend on the number of vertices, and a loose bound keeps
+    // this from failing on a loaded machine
+    EXPECT_LT(indexed, brute);
+  }
+}
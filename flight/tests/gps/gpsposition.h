@@ -0,0 +1,34 @@
+#ifndef GPSPOSITION_H
+#define GPSPOSITION_H
+
+#include <stdint.h>
+
+#define GPSPOSITION_OBJID 0x2D7016F6
+
+typedef enum {
+	GPSPOSITION_STATUS_NOGPS = 0,
+	GPSPOSITION_STATUS_NOFIX = 1,
+	GPSPOSITION_STATUS_FIX2D = 2,
+	GPSPOSITION_STATUS_FIX3D = 3,
+	GPSPOSITION_STATUS_DIFF3D = 4
+} GPSPositionStatusOptions;
+
+typedef struct {
+	int32_t Latitude;
+	int32_t Longitude;
+	float Altitude;
+	float GeoidSeparation;
+	float Heading;
+	float Groundspeed;
+	float Accuracy;
+	float PDOP;
+	float HDOP;
+	float VDOP;
+	uint32_t ReceiveTime;
+	uint8_t Status;
+	uint8_t Satellites;
+} GPSPositionData;
+
+int32_t GPSPositionSet(GPSPositionData *data);
+
+#endif /* GPSPOSITION_H */
@@ -0,0 +1,16 @@
+#ifndef GPSVELOCITY_H
+#define GPSVELOCITY_H
+
+#include <stdint.h>
+
+typedef struct {
+	float North;
+	float East;
+	float Down;
+	float Accuracy;
+	uint32_t ReceiveTime;
+} GPSVelocityData;
+
+int32_t GPSVelocitySet(GPSVelocityData *data);
+
+#endif /* GPSVELOCITY_H */
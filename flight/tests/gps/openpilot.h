@@ -0,0 +1,8 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define NELEMENTS(x) (sizeof(x) / sizeof(*(x)))
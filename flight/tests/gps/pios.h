@@ -0,0 +1,7 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PIOS_INCLUDE_GPS_NMEA_PARSER
+#define PIOS_INCLUDE_GPS_UBX_PARSER
+
+#define PIOS_DEBUG_Assert(test)
@@ -0,0 +1,16 @@
+#ifndef UBLOXINFO_H
+#define UBLOXINFO_H
+
+#include <stdint.h>
+
+typedef struct {
+	uint32_t swVersion;
+	uint16_t hwVersion;
+	uint32_t ParseErrors;
+} UBloxInfoData;
+
+int32_t UBloxInfoGet(UBloxInfoData *data);
+int32_t UBloxInfoSet(UBloxInfoData *data);
+int32_t UBloxInfoParseErrorsSet(uint32_t *value);
+
+#endif /* UBLOXINFO_H */
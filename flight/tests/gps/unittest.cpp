@@ -0,0 +1,412 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+#include <string>
+#include <vector>
+
+extern "C" {
+
+#include "NMEA.h"		/* API for the NMEA parser */
+
+// UBX.h can't be included from C++, the header has a field named class
+int parse_ubx_stream(const uint8_t *, uint16_t, uint32_t, char *, GPSPositionData *, struct GPS_RX_STATS *);
+
+static GPSPositionData published;
+static uint32_t num_published;
+static GPSVelocityData published_velocity;
+static uint32_t num_published_velocity;
+
+int32_t GPSPositionSet(GPSPositionData *data)
+{
+  published = *data;
+  num_published++;
+  return 0;
+}
+
+int32_t GPSVelocitySet(GPSVelocityData *data)
+{
+  published_velocity = *data;
+  num_published_velocity++;
+  return 0;
+}
+
+int32_t GPSTimeGet(GPSTimeData *data)
+{
+  memset(data, 0, sizeof(*data));
+  return 0;
+}
+
+int32_t GPSTimeSet(GPSTimeData *)
+{
+  return 0;
+}
+
+int32_t GPSSatellitesSet(GPSSatellitesData *)
+{
+  return 0;
+}
+
+int32_t UBloxInfoGet(UBloxInfoData *data)
+{
+  memset(data, 0, sizeof(*data));
+  return 0;
+}
+
+int32_t UBloxInfoSet(UBloxInfoData *)
+{
+  return 0;
+}
+
+int32_t UBloxInfoParseErrorsSet(uint32_t *)
+{
+  return 0;
+}
+
+}
+
+#define UBX_SYNC1 0xb5
+#define UBX_SYNC2 0x62
+
+// Parsers keep their state in statics, so the tests share one time of week
+static uint32_t next_tow = 100000;
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class GPSParser : public testing::Test {
+protected:
+  virtual void SetUp() {
+    memset(&gpsposition, 0, sizeof(gpsposition));
+    memset(&stats, 0, sizeof(stats));
+    memset(&published, 0, sizeof(published));
+    num_published = 0;
+    num_published_velocity = 0;
+  }
+
+  virtual void TearDown() {
+  }
+
+  static void put16(std::vector<uint8_t> &p, uint16_t offset, uint16_t v) {
+    p[offset] = v & 0xff;
+    p[offset + 1] = v >> 8;
+  }
+
+  static void put32(std::vector<uint8_t> &p, uint16_t offset, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++)
+      p[offset + i] = v >> (8 * i);
+  }
+
+  // Frame a UBX message with its checksum
+  static void ubx_frame(std::vector<uint8_t> &out, uint8_t cls, uint8_t id, const std::vector<uint8_t> &payload) {
+    std::vector<uint8_t> body;
+    body.push_back(cls);
+    body.push_back(id);
+    body.push_back(payload.size() & 0xff);
+    body.push_back(payload.size() >> 8);
+    body.insert(body.end(), payload.begin(), payload.end());
+
+    uint8_t ck_a = 0, ck_b = 0;
+    for (size_t i = 0; i < body.size(); i++) {
+      ck_a += body[i];
+      ck_b += ck_a;
+    }
+
+    out.push_back(UBX_SYNC1);
+    out.push_back(UBX_SYNC2);
+    out.insert(out.end(), body.begin(), body.end());
+    out.push_back(ck_a);
+    out.push_back(ck_b);
+  }
+
+  // One navigation solution the way a u-blox 6 sends it: SOL, POSLLH, DOP and VELNED
+  static void ubx_solution(std::vector<uint8_t> &out, uint32_t tow, int32_t lat, int32_t lon, int32_t vel_n) {
+    std::vector<uint8_t> sol(52, 0);
+    put32(sol, 0, tow);
+    sol[10] = 0x03;          // 3D fix
+    sol[11] = 0x01;          // fix ok
+    put32(sol, 24, 250);     // pAcc 2.5 m
+    put16(sol, 44, 150);     // pDOP
+    sol[47] = 9;             // numSV
+    ubx_frame(out, 0x01, 0x06, sol);
+
+    std::vector<uint8_t> posllh(28, 0);
+    put32(posllh, 0, tow);
+    put32(posllh, 4, lon);
+    put32(posllh, 8, lat);
+    put32(posllh, 12, 150000);
+    put32(posllh, 16, 100000);
+    ubx_frame(out, 0x01, 0x02, posllh);
+
+    std::vector<uint8_t> dop(18, 0);
+    put32(dop, 0, tow);
+    put16(dop, 6, 150);      // pDOP
+    put16(dop, 10, 120);     // vDOP
+    put16(dop, 12, 90);      // hDOP
+    ubx_frame(out, 0x01, 0x04, dop);
+
+    std::vector<uint8_t> velned(36, 0);
+    put32(velned, 0, tow);
+    put32(velned, 4, vel_n);
+    put32(velned, 20, 512);  // gSpeed
+    put32(velned, 24, 9000000);
+    ubx_frame(out, 0x01, 0x12, velned);
+  }
+
+  // Append an NMEA sentence with its checksum and line end
+  static void nmea_sentence(std::string &out, const char *body) {
+    uint8_t checksum = 0;
+    for (const char *c = body; *c; c++)
+      checksum ^= *c;
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", checksum);
+    out += "$";
+    out += body;
+    out += tail;
+  }
+
+  // Feed a stream in spans of the given size, stamping each span with its index
+  int feed_ubx(const uint8_t *data, size_t len, size_t span) {
+    int last = PARSER_INCOMPLETE;
+    for (size_t i = 0; i < len; i += span) {
+      uint16_t n = (len - i < span) ? len - i : span;
+      last = parse_ubx_stream(data + i, n, i / span, (char *)ubx_buffer, &gpsposition, &stats);
+    }
+    return last;
+  }
+
+  int feed_nmea(const std::string &data, size_t span) {
+    int last = PARSER_INCOMPLETE;
+    for (size_t i = 0; i < data.size(); i += span) {
+      uint16_t n = (data.size() - i < span) ? data.size() - i : span;
+      last = parse_nmea_stream((const uint8_t *)data.data() + i, n, i / span, nmea_buffer, &gpsposition, &stats);
+    }
+    return last;
+  }
+
+  GPSPositionData gpsposition;
+  struct GPS_RX_STATS stats;
+  uint32_t ubx_buffer[512 / sizeof(uint32_t)];
+  char nmea_buffer[NMEA_MAX_PACKET_LENGTH];
+};
+
+TEST_F(GPSParser, UBXSolution) {
+  std::vector<uint8_t> stream;
+  ubx_solution(stream, next_tow += 200, 475000000, 85000000, -150);
+
+  EXPECT_EQ(PARSER_COMPLETE, feed_ubx(stream.data(), stream.size(), stream.size()));
+  EXPECT_EQ(4, stats.gpsRxReceived);
+  EXPECT_EQ(0, stats.gpsRxChkSumError);
+
+  ASSERT_EQ(1u, num_published);
+  EXPECT_EQ(GPSPOSITION_STATUS_FIX3D, published.Status);
+  EXPECT_EQ(475000000, published.Latitude);
+  EXPECT_EQ(85000000, published.Longitude);
+  EXPECT_FLOAT_EQ(100.0f, published.Altitude);
+  EXPECT_FLOAT_EQ(50.0f, published.GeoidSeparation);
+  EXPECT_EQ(9, published.Satellites);
+  EXPECT_FLOAT_EQ(1.5f, published.PDOP);
+  EXPECT_FLOAT_EQ(0.9f, published.HDOP);
+  EXPECT_FLOAT_EQ(90.0f, published.Heading);
+
+  ASSERT_EQ(1u, num_published_velocity);
+  EXPECT_FLOAT_EQ(-1.5f, published_velocity.North);
+}
+
+TEST_F(GPSParser, UBXSpans) {
+  // Every span size has to give the same result, including spans that
+  // end in the middle of the sync, header, payload and checksum
+  for (size_t span = 1; span <= 80; span++) {
+    std::vector<uint8_t> stream;
+    int32_t lat = 470000000 + span;
+    ubx_solution(stream, next_tow += 200, lat, 80000000, 0);
+
+    SetUp();
+    EXPECT_EQ(PARSER_COMPLETE, feed_ubx(stream.data(), stream.size(), span)) << span;
+    ASSERT_EQ(4, stats.gpsRxReceived) << span;
+    ASSERT_EQ(1u, num_published) << span;
+    ASSERT_EQ(lat, published.Latitude) << span;
+  }
+}
+
+TEST_F(GPSParser, UBXReceiveTime) {
+  // The solution is stamped with the span its first message started in
+  std::vector<uint8_t> stream;
+  stream.assign(10, 0x00);
+  ubx_solution(stream, next_tow += 200, 1, 2, 3);
+
+  feed_ubx(stream.data(), stream.size(), 8);
+  ASSERT_EQ(1u, num_published);
+  EXPECT_EQ(1u, published.ReceiveTime);
+  EXPECT_EQ(1u, published_velocity.ReceiveTime);
+}
+
+TEST_F(GPSParser, UBXErrors) {
+  std::vector<uint8_t> stream;
+
+  // Noise with sync characters that don't start a message
+  const uint8_t noise[] = { 0x00, UBX_SYNC1, 0x00, UBX_SYNC1, UBX_SYNC1, UBX_SYNC2 - 1, 0x24 };
+  stream.insert(stream.end(), noise, noise + sizeof(noise));
+
+  // A message with a broken checksum
+  std::vector<uint8_t> bad;
+  ubx_frame(bad, 0x01, 0x04, std::vector<uint8_t>(18, 0x11));
+  bad[bad.size() - 1] ^= 0x01;
+  stream.insert(stream.end(), bad.begin(), bad.end());
+
+  // A message that would not fit in the buffer
+  const uint8_t too_long[] = { UBX_SYNC1, UBX_SYNC2, 0x01, 0x30, 0xff, 0x7f };
+  stream.insert(stream.end(), too_long, too_long + sizeof(too_long));
+
+  // A message without payload and a second sync char in front of a message
+  ubx_frame(stream, 0x0a, 0x04, std::vector<uint8_t>());
+  stream.push_back(UBX_SYNC1);
+  ubx_solution(stream, next_tow += 200, 3, 4, 5);
+
+  EXPECT_EQ(PARSER_COMPLETE, feed_ubx(stream.data(), stream.size(), 16));
+  EXPECT_EQ(1, stats.gpsRxChkSumError);
+  EXPECT_EQ(1, stats.gpsRxOverflow);
+  EXPECT_EQ(5, stats.gpsRxReceived);
+  ASSERT_EQ(1u, num_published);
+  EXPECT_EQ(3, published.Latitude);
+
+  // Only errors in a span
+  SetUp();
+  EXPECT_EQ(PARSER_ERROR, feed_ubx(bad.data(), bad.size(), bad.size()));
+  EXPECT_EQ(0u, num_published);
+}
+
+TEST_F(GPSParser, NMEASentences) {
+  std::string stream;
+  nmea_sentence(stream, "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+  nmea_sentence(stream, "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,A");
+  nmea_sentence(stream, "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
+
+  for (size_t span = 1; span <= 100; span += 3) {
+    SetUp();
+    EXPECT_EQ(PARSER_COMPLETE, feed_nmea(stream, span)) << span;
+    EXPECT_EQ(3, stats.gpsRxReceived) << span;
+    EXPECT_EQ(0, stats.gpsRxChkSumError) << span;
+
+    ASSERT_EQ(1u, num_published) << span;
+    EXPECT_EQ(GPSPOSITION_STATUS_FIX3D, published.Status);
+    EXPECT_NEAR(481173000, published.Latitude, 1);
+    EXPECT_NEAR(115166667, published.Longitude, 1);
+    EXPECT_FLOAT_EQ(545.4f, published.Altitude);
+    EXPECT_FLOAT_EQ(46.9f, published.GeoidSeparation);
+    EXPECT_EQ(8, published.Satellites);
+    EXPECT_NEAR(22.4f * 0.51444f, published.Groundspeed, 1e-4);
+
+    // Stamped with the span the GGA sentence started in
+    EXPECT_EQ(stream.rfind('$') / span, published.ReceiveTime) << span;
+  }
+}
+
+TEST_F(GPSParser, NMEAErrors) {
+  std::string stream;
+
+  // Broken checksum
+  std::string bad;
+  nmea_sentence(bad, "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
+  bad[20] = '9';
+  stream += bad;
+
+  // No checksum
+  stream += "$GPGGA,1,2,3\r\n";
+
+  // No line end before the next sentence, the two run into one that is too long
+  stream += "garbage $GPGGA,123519";
+  stream += "$GPTXT," + std::string(80, 'x') + "\r\n";
+
+  nmea_sentence(stream, "GPGGA,123520,4807.038,S,01131.000,W,1,08,0.9,545.4,M,46.9,M,,");
+
+  EXPECT_EQ(PARSER_COMPLETE, feed_nmea(stream, 32));
+  EXPECT_EQ(2, stats.gpsRxChkSumError);
+  EXPECT_EQ(1, stats.gpsRxOverflow);
+  EXPECT_EQ(1, stats.gpsRxReceived);
+  ASSERT_EQ(1u, num_published);
+  EXPECT_NEAR(-481173000, published.Latitude, 1);
+
+  SetUp();
+  EXPECT_EQ(PARSER_ERROR, feed_nmea(bad, bad.size()));
+  EXPECT_EQ(0u, num_published);
+}
+
+TEST_F(GPSParser, Benchmark) {
+  // Synthetic captures: 5 Hz UBX solutions and the NMEA sentences a
+  // receiver sends each fix. Parsing one byte per call is what the task
+  // did before it read in blocks.
+  std::vector<uint8_t> ubx;
+  std::string nmea;
+  for (uint32_t i = 0; i < 200; i++) {
+    ubx_solution(ubx, next_tow += 200, 475000000 + i, 85000000 - i, i);
+    nmea_sentence(nmea, "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,");
+    nmea_sentence(nmea, "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+    nmea_sentence(nmea, "GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,A");
+    nmea_sentence(nmea, "GPVTG,084.4,T,077.8,M,022.4,N,041.5,K,A");
+  }
+
+  const uint32_t rounds = 20;
+  printf("%6s %6s %14s %14s\n", "", "span", "ns/byte", "MB/s");
+
+  for (size_t span = 1; span <= 32; span *= 32) {
+    double start = now_ns();
+    for (uint32_t r = 0; r < rounds; r++)
+      feed_ubx(ubx.data(), ubx.size(), span);
+    double ns = (now_ns() - start) / (rounds * ubx.size());
+    printf("%6s %6zu %14.2f %14.1f\n", "UBX", span, ns, 1e3 / ns);
+  }
+
+  for (size_t span = 1; span <= 32; span *= 32) {
+    double start = now_ns();
+    for (uint32_t r = 0; r < rounds; r++)
+      feed_nmea(nmea, span);
+    double ns = (now_ns() - start) / (rounds * nmea.size());
+    printf("%6s %6zu %14.2f %14.1f\n", "NMEA", span, ns, 1e3 / ns);
+  }
+
+  EXPECT_EQ(0, stats.gpsRxChkSumError);
+  EXPECT_EQ(0, stats.gpsRxOverflow);
+}
@@ -0,0 +1,8 @@
+/* The history only needs memory, the test provides it */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIOS_malloc malloc
+#define PIOS_free free
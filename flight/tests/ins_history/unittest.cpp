@@ -0,0 +1,252 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for fusing delayed measurements with the INS history
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* sinf */
+
+extern "C" {
+#include "ins_history.h"
+#include "insgps.h"
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class InsHistory : public testing::Test {
+protected:
+  virtual void SetUp() {
+    hist = ins_history_create(INS_HISTORY_LENGTH, INS_HISTORY_PERIOD_MS);
+    ASSERT_TRUE(hist != NULL);
+  }
+
+  virtual void TearDown() {
+  }
+
+  // Moving north at 10 m/s and accelerating east at 2 m/s^2, pushed every ms
+  void push_motion(uint32_t from_ms, uint32_t to_ms) {
+    for (uint32_t t = from_ms; t <= to_ms; t++) {
+      float pos[3], vel[3];
+      motion(t, pos, vel);
+      ins_history_push(hist, t, pos, vel);
+    }
+  }
+
+  static void motion(uint32_t t_ms, float pos[3], float vel[3]) {
+    float t = t_ms / 1000.0f;
+
+    pos[0] = 10.0f * t;
+    pos[1] = t * t;
+    pos[2] = -5.0f;
+    vel[0] = 10.0f;
+    vel[1] = 2.0f * t;
+    vel[2] = 0.0f;
+  }
+
+  struct ins_history *hist;
+};
+
+TEST_F(InsHistory, EmptyHasNothing) {
+  float pos[3], vel[3];
+
+  EXPECT_FALSE(ins_history_get(hist, 0, pos, vel));
+
+  push_motion(1000, 1000);
+  EXPECT_FALSE(ins_history_get(hist, 1000, pos, vel));
+}
+
+TEST_F(InsHistory, Interpolates) {
+  push_motion(1000, 1200);
+
+  float pos[3], vel[3], pos_true[3], vel_true[3];
+
+  // Between the samples, linear in time
+  ASSERT_TRUE(ins_history_get(hist, 1133, pos, vel));
+  motion(1133, pos_true, vel_true);
+  EXPECT_NEAR(pos_true[0], pos[0], 1e-4);
+  EXPECT_NEAR(pos_true[1], pos[1], 1e-3);
+  EXPECT_NEAR(pos_true[2], pos[2], 1e-6);
+  EXPECT_NEAR(vel_true[0], vel[0], 1e-5);
+  EXPECT_NEAR(vel_true[1], vel[1], 1e-5);
+
+  // On a sample
+  ASSERT_TRUE(ins_history_get(hist, 1100, pos, vel));
+  motion(1100, pos_true, vel_true);
+  EXPECT_NEAR(pos_true[1], pos[1], 1e-5);
+}
+
+TEST_F(InsHistory, CoversOnlyTheRing) {
+  push_motion(1000, 2000);
+
+  float pos[3], vel[3];
+
+  // The newest 24 samples are 10 ms apart
+  EXPECT_TRUE(ins_history_get(hist, 2000, pos, vel));
+  EXPECT_TRUE(ins_history_get(hist, 2000 - (INS_HISTORY_LENGTH - 1) * INS_HISTORY_PERIOD_MS, pos, vel));
+  EXPECT_FALSE(ins_history_get(hist, 2000 - INS_HISTORY_LENGTH * INS_HISTORY_PERIOD_MS, pos, vel));
+  EXPECT_FALSE(ins_history_get(hist, 2001, pos, vel));
+
+  ins_history_reset(hist);
+  EXPECT_FALSE(ins_history_get(hist, 1990, pos, vel));
+}
+
+TEST_F(InsHistory, ShiftGivesTheDelayedInnovation) {
+  push_motion(1000, 1300);
+
+  float pos_now[3], vel_now[3];
+  motion(1300, pos_now, vel_now);
+
+  // A perfect measurement taken 150 ms ago, after the shift it matches now
+  float pos_meas[3], vel_meas[3];
+  motion(1150, pos_meas, vel_meas);
+
+  ASSERT_TRUE(ins_history_shift(hist, 1150, pos_now, vel_now, pos_meas, vel_meas));
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(pos_now[i], pos_meas[i], 1e-3);
+    EXPECT_NEAR(vel_now[i], vel_meas[i], 1e-4);
+  }
+
+  // Only the velocity, and too old to shift
+  motion(1150, pos_meas, vel_meas);
+  ASSERT_TRUE(ins_history_shift(hist, 1150, pos_now, vel_now, NULL, vel_meas));
+  EXPECT_NEAR(vel_now[1], vel_meas[1], 1e-4);
+
+  motion(500, pos_meas, vel_meas);
+  float pos_old = pos_meas[0];
+  EXPECT_FALSE(ins_history_shift(hist, 500, pos_now, vel_now, pos_meas, vel_meas));
+  EXPECT_EQ(pos_old, pos_meas[0]);
+}
+
+/*
+ * Fly the INS level through a north-south oscillation with GPS that
+ * arrives late, like the attitude module runs it
+ */
+#define INS_DT_MS     2
+#define GPS_PERIOD_MS 200
+#define GPS_LATENCY_MS 100   // the INSSettings.GpsLatency default
+#define GRAVITY       9.81f
+
+static void truth(uint32_t t_ms, float pos[3], float vel[3], float accel[3])
+{
+  const float A = 20.0f;                  // m
+  const float w = 2 * (float) M_PI / 10;  // 10 s period
+  float t = t_ms / 1000.0f;
+
+  pos[0] = A * sinf(w * t);
+  vel[0] = A * w * cosf(w * t);
+  accel[0] = -A * w * w * sinf(w * t);
+  pos[1] = pos[2] = vel[1] = vel[2] = accel[1] = accel[2] = 0;
+}
+
+static void fly(struct ins_history *hist, bool shift, float *pos_rms, float *vel_rms)
+{
+  const float zero[3] = {0, 0, 0};
+  const float q[4] = {1, 0, 0, 0};
+  const float mag[3] = {1, 0, 0};
+  const float accel_var[3] = {0.003f, 0.003f, 0.003f};
+  const float gyro_var[3] = {1e-5f, 1e-5f, 1e-4f};
+  const float mag_var[3] = {10, 10, 100};
+  float pos[3], vel[3], accel[3];
+
+  INSGPSInit();
+  INSSetMagNorth(mag);
+  INSSetAccelVar(accel_var);
+  INSSetGyroVar(gyro_var);
+  INSSetMagVar(mag_var);
+  INSSetBaroVar(0.01f);
+  INSSetPosVelVar(1e-3f, 1e-2f, 0.5f);
+
+  truth(0, pos, vel, accel);
+  INSSetState(pos, vel, q, zero, zero);
+  ins_history_reset(hist);
+
+  double pos_err2 = 0, vel_err2 = 0;
+  uint32_t n = 0;
+
+  for (uint32_t t = INS_DT_MS; t <= 30000; t += INS_DT_MS) {
+    truth(t, pos, vel, accel);
+
+    const float gyro[3] = {0, 0, 0};
+    const float accel_body[3] = {accel[0], accel[1], -GRAVITY};
+    INSStatePrediction(gyro, accel_body, INS_DT_MS / 1000.0f);
+    INSCovariancePrediction(INS_DT_MS / 1000.0f);
+
+    uint16_t sensors = MAG_SENSORS | BARO_SENSOR;
+    float gps_pos[3] = {0, 0, 0}, gps_vel[3] = {0, 0, 0};
+
+    if (t % GPS_PERIOD_MS == 0) {
+      // Arrives now, measured by the receiver GPS_LATENCY_MS earlier
+      const uint32_t receive_time = t;
+      float unused[3];
+      truth(receive_time - GPS_LATENCY_MS, gps_pos, gps_vel, unused);
+      sensors |= HORIZ_POS_SENSORS | HORIZ_VEL_SENSORS | VERT_VEL_SENSORS;
+
+      if (shift) {
+        float pos_now[3], vel_now[3];
+        INSGetState(pos_now, vel_now, NULL, NULL, NULL);
+        ins_history_shift(hist, receive_time - GPS_LATENCY_MS, pos_now, vel_now, gps_pos, gps_vel);
+      }
+    }
+
+    INSCorrection(mag, gps_pos, gps_vel, 0, sensors);
+
+    float pos_est[3], vel_est[3];
+    INSGetState(pos_est, vel_est, NULL, NULL, NULL);
+    ins_history_push(hist, t, pos_est, vel_est);
+
+    // Skip the first period while the filter settles
+    if (t > 10000) {
+      pos_err2 += (pos_est[0] - pos[0]) * (pos_est[0] - pos[0]);
+      vel_err2 += (vel_est[0] - vel[0]) * (vel_est[0] - vel[0]);
+      n++;
+    }
+  }
+
+  *pos_rms = sqrt(pos_err2 / n);
+  *vel_rms = sqrt(vel_err2 / n);
+}
+
+TEST_F(InsHistory, DelayedGpsFusion) {
+  float pos_plain, vel_plain, pos_shifted, vel_shifted;
+
+  fly(hist, false, &pos_plain, &vel_plain);
+  fly(hist, true, &pos_shifted, &vel_shifted);
+
+  fprintf(stdout, "GPS %d ms late, north error RMS: fused as now %.3f m %.3f m/s, shifted %.3f m %.3f m/s\n",
+      GPS_LATENCY_MS, pos_plain, vel_plain, pos_shifted, vel_shifted);
+
+  EXPECT_LT(pos_shifted, 0.5f * pos_plain);
+  EXPECT_LT(vel_shifted, 0.5f * vel_plain);
+}
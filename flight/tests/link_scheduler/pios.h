@@ -0,0 +1,12 @@
+/* The scheduler only needs memory and the COM transmit buffer, the test provides both */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIOS_malloc malloc
+#define PIOS_free free
+
+uint16_t PIOS_COM_GetTxUsed(uintptr_t com_id);
+uint16_t PIOS_COM_GetTxFree(uintptr_t com_id);
+int32_t PIOS_COM_SendBufferNonBlocking(uintptr_t com_id, const uint8_t *buffer, uint16_t len);
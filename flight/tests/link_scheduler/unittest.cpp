@@ -0,0 +1,314 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the telemetry link scheduler
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+#include "link_scheduler.h"
+}
+
+#define PORT_ID      0x1234U
+#define TX_BUF_SIZE  256
+#define MAX_MSG_LEN  64
+#define RUN_PERIOD   20
+
+/*
+ * A virtual serial port: the transmit buffer drains at the baud rate and
+ * refuses data that does not fit, like the COM layer does
+ */
+static struct {
+	uint32_t bytes_per_s;
+	uint32_t used;
+	uint32_t drain_rem;     // fractions of a byte left from the last drain, in 1/1000
+	uint32_t drained;
+	uint32_t refused;
+} port;
+
+static void port_drain(uint32_t ms)
+{
+	uint32_t amount = port.bytes_per_s * ms + port.drain_rem;
+	uint32_t bytes = amount / 1000;
+
+	port.drain_rem = amount % 1000;
+	if (bytes > port.used)
+		bytes = port.used;
+
+	port.used -= bytes;
+	port.drained += bytes;
+}
+
+extern "C" uint16_t PIOS_COM_GetTxUsed(uintptr_t com_id)
+{
+	EXPECT_EQ(PORT_ID, com_id);
+	return port.used;
+}
+
+extern "C" uint16_t PIOS_COM_GetTxFree(uintptr_t com_id)
+{
+	EXPECT_EQ(PORT_ID, com_id);
+	return TX_BUF_SIZE - port.used;
+}
+
+extern "C" int32_t PIOS_COM_SendBufferNonBlocking(uintptr_t com_id, const uint8_t *buffer, uint16_t len)
+{
+	EXPECT_EQ(PORT_ID, com_id);
+	EXPECT_TRUE(buffer != NULL);
+
+	if (port.used + len > TX_BUF_SIZE) {
+		port.refused++;
+		return -2;
+	}
+
+	port.used += len;
+	return len;
+}
+
+/*
+ * Messages of different sizes, each remembers when it was sent
+ */
+#define NUM_MSGS 4
+
+static struct {
+	uint16_t len;
+	uint32_t count;
+	uint32_t bytes;
+	uint32_t last_sent;
+	uint32_t max_gap;
+} msgs[NUM_MSGS];
+
+static uint32_t now;
+
+static uint16_t pack_msg(int n, uint8_t *buf, uint16_t buf_len)
+{
+	EXPECT_LE(msgs[n].len, buf_len);
+	memset(buf, n, msgs[n].len);
+
+	if (msgs[n].count > 0 && now - msgs[n].last_sent > msgs[n].max_gap)
+		msgs[n].max_gap = now - msgs[n].last_sent;
+
+	msgs[n].count++;
+	msgs[n].bytes += msgs[n].len;
+	msgs[n].last_sent = now;
+
+	return msgs[n].len;
+}
+
+static uint16_t pack_msg0(uint8_t *buf, uint16_t buf_len) { return pack_msg(0, buf, buf_len); }
+static uint16_t pack_msg1(uint8_t *buf, uint16_t buf_len) { return pack_msg(1, buf, buf_len); }
+static uint16_t pack_msg2(uint8_t *buf, uint16_t buf_len) { return pack_msg(2, buf, buf_len); }
+static uint16_t pack_msg3(uint8_t *buf, uint16_t buf_len) { return pack_msg(3, buf, buf_len); }
+
+static const link_sched_pack packers[NUM_MSGS] = { pack_msg0, pack_msg1, pack_msg2, pack_msg3 };
+
+// To use a test fixture, derive a class from testing::Test.
+class LinkSched : public testing::Test {
+protected:
+  virtual void SetUp() {
+    memset(&port, 0, sizeof(port));
+    memset(msgs, 0, sizeof(msgs));
+    now = 1000;
+
+    sched = link_sched_create(PORT_ID, NUM_MSGS, MAX_MSG_LEN);
+    ASSERT_TRUE(sched != NULL);
+  }
+
+  virtual void TearDown() {
+  }
+
+  void add(int n, uint16_t period_ms, uint8_t priority, uint16_t len) {
+    msgs[n].len = len;
+    EXPECT_EQ(0, link_sched_add(sched, packers[n], period_ms, priority, len));
+  }
+
+  // Run the scheduler for a while, the port drains in between
+  void run(uint32_t duration_ms) {
+    for (uint32_t t = 0; t < duration_ms; t += RUN_PERIOD) {
+      link_sched_run(sched, now);
+      now += RUN_PERIOD;
+      port_drain(RUN_PERIOD);
+    }
+  }
+
+  struct link_sched *sched;
+};
+
+TEST_F(LinkSched, RegisterLimit) {
+  for (int i = 0; i < NUM_MSGS; i++)
+    add(i, 100, 1, 10);
+
+  EXPECT_EQ(-1, link_sched_add(sched, pack_msg0, 100, 1, 10));
+}
+
+TEST_F(LinkSched, FastLinkKeepsRates) {
+  // 57600 baud carries everything at the requested rates
+  port.bytes_per_s = 5760;
+
+  add(0, 100, 8, 30);
+  add(1, 200, 2, 40);
+  add(2, 500, 1, 60);
+  add(3, 1000, 1, 20);
+
+  // The capacity estimate starts low, give it a moment to find the link
+  struct link_sched_stats stats;
+  run(1000);
+  link_sched_get_stats(sched, &stats);
+  uint32_t late = stats.msgs_late;
+
+  run(9000);
+
+  EXPECT_NEAR(100, msgs[0].count, 3);
+  EXPECT_NEAR(50, msgs[1].count, 2);
+  EXPECT_NEAR(20, msgs[2].count, 1);
+  EXPECT_NEAR(10, msgs[3].count, 1);
+
+  link_sched_get_stats(sched, &stats);
+  EXPECT_EQ(late, stats.msgs_late);
+  EXPECT_EQ(0U, stats.tx_full);
+  EXPECT_EQ(0U, port.refused);
+}
+
+TEST_F(LinkSched, SlowLinkNoOverflowNoStarvation) {
+  // 2400 baud, the messages ask for about 3 times what the link can carry
+  port.bytes_per_s = 240;
+
+  add(0, 40, 8, 30);
+  add(1, 100, 2, 40);
+  add(2, 200, 1, 60);
+  add(3, 500, 1, 20);
+
+  run(20000);
+
+  // Nothing was ever refused by the port
+  struct link_sched_stats stats;
+  link_sched_get_stats(sched, &stats);
+  EXPECT_EQ(0U, stats.tx_full);
+  EXPECT_EQ(0U, port.refused);
+
+  // Everybody got through, regularly
+  for (int i = 0; i < NUM_MSGS; i++) {
+    EXPECT_GT(msgs[i].count, 5U);
+    EXPECT_LT(msgs[i].max_gap, 5000U);
+  }
+
+  // Higher priorities got more of the link
+  EXPECT_GT(msgs[0].bytes, msgs[1].bytes);
+  EXPECT_GT(msgs[1].bytes, msgs[2].bytes);
+
+  // The link was used and the estimate is close to the baud rate
+  EXPECT_GT(port.drained, 240U * 20 * 9 / 10);
+  EXPECT_NEAR(240, stats.capacity, 60);
+
+  // The backlog stays short, so queued data is never old
+  EXPECT_LT(port.used, 240U * 200 / 1000 + MAX_MSG_LEN);
+}
+
+TEST_F(LinkSched, FollowsBaudChange) {
+  port.bytes_per_s = 11520;
+
+  add(0, 20, 4, 60);
+  add(1, 20, 1, 60);
+
+  run(5000);
+
+  struct link_sched_stats stats;
+  link_sched_get_stats(sched, &stats);
+  EXPECT_GT(stats.capacity, 2000U);
+
+  // The link gets slow, e.g. the radio dropped to a lower rate
+  port.bytes_per_s = 480;
+  run(5000);
+
+  link_sched_get_stats(sched, &stats);
+  EXPECT_NEAR(480, stats.capacity, 120);
+  EXPECT_EQ(0U, port.refused);
+  EXPECT_GT(msgs[1].count, 5U);
+
+  // And fast again
+  port.bytes_per_s = 11520;
+  uint32_t before = msgs[1].count;
+  run(5000);
+
+  link_sched_get_stats(sched, &stats);
+  EXPECT_GT(stats.capacity, 2000U);
+  EXPECT_GT(msgs[1].count - before, 100U);
+  EXPECT_EQ(0U, port.refused);
+}
+
+static uint16_t pack_nothing(uint8_t *buf, uint16_t buf_len)
+{
+  (void) buf;
+  (void) buf_len;
+
+  return 0;
+}
+
+TEST_F(LinkSched, EmptyMessagesDontBlock) {
+  port.bytes_per_s = 960;
+
+  EXPECT_EQ(0, link_sched_add(sched, pack_nothing, 20, 8, 60));
+  add(1, 100, 1, 20);
+
+  run(2000);
+
+  EXPECT_NEAR(20, msgs[1].count, 1);
+}
+
+TEST_F(LinkSched, JitterKeepsRates) {
+  port.bytes_per_s = 5760;
+
+  add(0, 100, 1, 30);
+  add(1, 40, 1, 20);
+
+  // Runs come a millisecond early or late, the periods are multiples of
+  // the run period so a message is often due right on a run
+  for (int i = 0; i < 500; i++) {
+    uint32_t jitter = (i % 2) ? 1 : 0;
+    link_sched_run(sched, now - jitter);
+    now += RUN_PERIOD;
+    port_drain(RUN_PERIOD);
+  }
+
+  EXPECT_NEAR(100, msgs[0].count, 2);
+  EXPECT_NEAR(250, msgs[1].count, 2);
+  EXPECT_LE(msgs[0].max_gap, 100U + RUN_PERIOD);
+}
+
+/**
+ * @}
+ * @}
+ */
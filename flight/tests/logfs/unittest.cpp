@@ -249,6 +249,11 @@ TEST_F(LogfsTestCooked, WriteMaxSize) {
   EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ3_ID, 0, obj3, sizeof(obj3)));
 }
 
+TEST_F(LogfsTestCooked, MaxObjSize) {
+  EXPECT_EQ(OBJ3_SIZE, PIOS_FLASHFS_GetMaxObjSize(fs_id));
+  EXPECT_EQ(-1, PIOS_FLASHFS_GetMaxObjSize(fs_id + 1));
+}
+
 TEST_F(LogfsTestCooked, ReadNonexistent) {
   /* Read back a zero length object -- basically an existence check */
   unsigned char obj1_check[OBJ1_SIZE];
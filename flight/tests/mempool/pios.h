@@ -0,0 +1,2 @@
+/* Only the heap is needed, the pools are not locked without an RTOS */
+#include <pios_heap.h>
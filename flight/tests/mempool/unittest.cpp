@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the fixed block pools
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* malloc */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+#include "pios_heap.h"
+#include "pios_mempool.h"
+
+static int heap_allocations;
+static int heap_limit;
+
+void * PIOS_malloc_no_dma(size_t size)
+{
+	if (heap_allocations >= heap_limit)
+		return NULL;
+
+	heap_allocations++;
+	return malloc(size);
+}
+}
+
+struct entry {
+	uint8_t a;
+	uint32_t b;
+	struct entry *next;
+};
+
+// To use a test fixture, derive a class from testing::Test.
+class Mempool : public testing::Test {
+protected:
+	virtual void SetUp() {
+		heap_allocations = 0;
+		heap_limit = 100;
+	}
+
+	virtual void TearDown() {
+	}
+};
+
+TEST_F(Mempool, BlockSize) {
+	static struct pios_mempool pool = PIOS_MEMPOOL_INIT("Test", struct entry);
+	struct pios_mempool_stats stats;
+
+	PIOS_Mempool_GetStats(&pool, &stats);
+	EXPECT_GE(stats.block_size, sizeof(struct entry));
+	EXPECT_EQ(0U, stats.block_size % sizeof(void *));
+	EXPECT_EQ(0, stats.blocks);
+	EXPECT_EQ(0, stats.in_use);
+};
+
+TEST_F(Mempool, FreedBlocksAreReused) {
+	static struct pios_mempool pool = PIOS_MEMPOOL_INIT("Test", struct entry);
+
+	void *first = PIOS_Mempool_Alloc(&pool);
+	ASSERT_TRUE(first != NULL);
+	PIOS_Mempool_Free(&pool, first);
+
+	// The same block comes back without touching the heap
+	for (int i = 0; i < 10; i++) {
+		void *block = PIOS_Mempool_Alloc(&pool);
+		EXPECT_EQ(first, block);
+		PIOS_Mempool_Free(&pool, block);
+	}
+	EXPECT_EQ(1, heap_allocations);
+};
+
+TEST_F(Mempool, HighWater) {
+	static struct pios_mempool pool = PIOS_MEMPOOL_INIT("Test", struct entry);
+	struct pios_mempool_stats stats;
+	void *blocks[5];
+
+	for (int i = 0; i < 5; i++)
+		blocks[i] = PIOS_Mempool_Alloc(&pool);
+	for (int i = 0; i < 3; i++)
+		PIOS_Mempool_Free(&pool, blocks[i]);
+
+	PIOS_Mempool_GetStats(&pool, &stats);
+	EXPECT_EQ(5, stats.blocks);
+	EXPECT_EQ(2, stats.in_use);
+	EXPECT_EQ(5, stats.high_water);
+
+	// Staying below the high water mark doesn't grow the pool
+	for (int i = 0; i < 3; i++)
+		blocks[i] = PIOS_Mempool_Alloc(&pool);
+
+	PIOS_Mempool_GetStats(&pool, &stats);
+	EXPECT_EQ(5, stats.blocks);
+	EXPECT_EQ(5, stats.in_use);
+	EXPECT_EQ(5, stats.high_water);
+	EXPECT_EQ(5, heap_allocations);
+
+	// The blocks are distinct
+	for (int i = 0; i < 5; i++)
+		for (int j = i + 1; j < 5; j++)
+			EXPECT_NE(blocks[i], blocks[j]);
+};
+
+TEST_F(Mempool, Reserve) {
+	static struct pios_mempool pool = PIOS_MEMPOOL_INIT("Test", struct entry);
+	struct pios_mempool_stats stats;
+
+	EXPECT_EQ(0, PIOS_Mempool_Reserve(&pool, 4));
+	EXPECT_EQ(4, heap_allocations);
+
+	// Reserved blocks don't need the heap any more
+	heap_limit = heap_allocations;
+	for (int i = 0; i < 4; i++)
+		EXPECT_TRUE(PIOS_Mempool_Alloc(&pool) != NULL);
+	EXPECT_TRUE(PIOS_Mempool_Alloc(&pool) == NULL);
+
+	PIOS_Mempool_GetStats(&pool, &stats);
+	EXPECT_EQ(4, stats.blocks);
+	EXPECT_EQ(4, stats.in_use);
+	EXPECT_EQ(4, stats.high_water);
+	EXPECT_EQ(1, stats.failures);
+};
+
+TEST_F(Mempool, HeapExhausted) {
+	static struct pios_mempool pool = PIOS_MEMPOOL_INIT("Test", struct entry);
+	struct pios_mempool_stats stats;
+
+	heap_limit = 2;
+	EXPECT_EQ(-1, PIOS_Mempool_Reserve(&pool, 3));
+	EXPECT_TRUE(PIOS_Mempool_Alloc(&pool) != NULL);
+	EXPECT_TRUE(PIOS_Mempool_Alloc(&pool) != NULL);
+	EXPECT_TRUE(PIOS_Mempool_Alloc(&pool) == NULL);
+
+	PIOS_Mempool_GetStats(&pool, &stats);
+	EXPECT_EQ(2, stats.blocks);
+	EXPECT_EQ(2, stats.in_use);
+	EXPECT_EQ(2, stats.failures);
+
+	// Freeing NULL is harmless
+	PIOS_Mempool_Free(&pool, NULL);
+	PIOS_Mempool_GetStats(&pool, &stats);
+	EXPECT_EQ(2, stats.in_use);
+};
+
+TEST_F(Mempool, SizeKnownAtRunTime) {
+	struct pios_mempool pool;
+	struct pios_mempool_stats stats;
+
+	PIOS_Mempool_Init(&pool, "Test", 2 * sizeof(void *) + 1);
+	PIOS_Mempool_GetStats(&pool, &stats);
+	EXPECT_EQ(3 * sizeof(void *), stats.block_size);
+	EXPECT_EQ(0, stats.blocks);
+
+	EXPECT_EQ(0, PIOS_Mempool_Reserve(&pool, 2));
+	void *a = PIOS_Mempool_Alloc(&pool);
+	void *b = PIOS_Mempool_Alloc(&pool);
+	ASSERT_TRUE(a != NULL && b != NULL);
+	memset(a, 0x55, stats.block_size);
+	memset(b, 0xaa, stats.block_size);
+	EXPECT_EQ(2, heap_allocations);
+
+	PIOS_Mempool_Free(&pool, a);
+	PIOS_Mempool_Free(&pool, b);
+	PIOS_Mempool_GetStats(&pool, &stats);
+	EXPECT_EQ(0, stats.in_use);
+	EXPECT_EQ(2, stats.high_water);
+};
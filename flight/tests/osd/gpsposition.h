@@ -0,0 +1,7 @@
+#include <stdint.h>
+
+typedef struct {
+	float GeoidSeparation;
+} GPSPositionData;
+
+int32_t GPSPositionGet(GPSPositionData *data);
@@ -0,0 +1,9 @@
+#include <stdint.h>
+
+typedef struct {
+	int32_t Latitude;
+	int32_t Longitude;
+	float Altitude;
+} HomeLocationData;
+
+int32_t HomeLocationGet(HomeLocationData *data);
@@ -0,0 +1,410 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+
+#include "osd_utils.h"		/* drawing functions */
+#include "osd_widgets.h"	/* API for the retained elements */
+#include "pios_video.h"		/* buffer geometry */
+#include "gpsposition.h"
+#include "homelocation.h"
+
+uint8_t *draw_buffer_level;
+uint8_t *draw_buffer_mask;
+
+static const struct pios_video_type_boundary boundary_pal = { 359, 265 };
+const struct pios_video_type_boundary *pios_video_type_boundary_act = &boundary_pal;
+
+int32_t GPSPositionGet(GPSPositionData *data)
+{
+  memset(data, 0, sizeof(*data));
+  return 0;
+}
+
+int32_t HomeLocationGet(HomeLocationData *data)
+{
+  memset(data, 0, sizeof(*data));
+  return 0;
+}
+
+}
+
+#define BUFFER_SIZE (BUFFER_WIDTH * BUFFER_HEIGHT)
+#define NUM_TEXT_WIDGETS 14
+#define NUM_WIDGETS (NUM_TEXT_WIDGETS + 1)
+
+static uint8_t icon_mask[] = {
+  0x3c, 0x00, 0x7e, 0x00, 0xff, 0x00, 0xff, 0x80, 0xff, 0x80, 0x7f, 0x00, 0x3e, 0x00, 0x1c, 0x00,
+};
+static uint8_t icon_level[] = {
+  0x00, 0x00, 0x3c, 0x00, 0x7e, 0x00, 0x7f, 0x00, 0x7f, 0x00, 0x3e, 0x00, 0x1c, 0x00, 0x00, 0x00,
+};
+static const struct Image icon = {
+  9, 8, icon_mask, icon_level,
+};
+
+// What a page shows, rendered either from scratch or with the widgets
+struct test_page {
+  float values[NUM_TEXT_WIDGETS];
+  bool shown[NUM_TEXT_WIDGETS];
+  bool icon;
+  int horizon;
+};
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class OsdTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    srand(1234);
+    memset(level, 0, sizeof(level));
+    memset(mask, 0, sizeof(mask));
+    select_buffer(0);
+  }
+
+  virtual void TearDown() {
+  }
+
+  void select_buffer(uint8_t i) {
+    draw_buffer_level = level[i];
+    draw_buffer_mask = mask[i];
+  }
+
+  // Two columns at the sides of the screen, the last widgets overlap
+  void widget_position(uint8_t i, int *x, int *y, int *ha, int *font) {
+    if (i < 6) {
+      *x = 10;
+      *y = 10 + i * 20;
+      *ha = TEXT_HA_LEFT;
+    } else if (i < 12) {
+      *x = 350;
+      *y = 10 + (i - 6) * 20;
+      *ha = TEXT_HA_RIGHT;
+    } else {
+      *x = 30 + (i - 12) * 13;
+      *y = 230 + (i - 12) * 5;
+      *ha = TEXT_HA_LEFT;
+    }
+    *font = i % 4;
+  }
+
+  // Regions stay in the middle, away from the widgets
+  void draw_regions(const struct test_page *page) {
+    write_line_outlined(120, 100 + page->horizon, 240, 140 - page->horizon, 2, 2, 0, 1);
+    write_rectangle_outlined(150, 160, 60, 20 + page->horizon / 4, 0, 1);
+    write_circle_outlined(180, 120, 10 + abs(page->horizon) / 2, 0, 0, 0, 1);
+  }
+
+  void draw_full(const struct test_page *page) {
+    char text[16];
+    int x, y, ha, font;
+
+    memset(draw_buffer_level, 0, BUFFER_SIZE);
+    memset(draw_buffer_mask, 0, BUFFER_SIZE);
+    draw_regions(page);
+    for (uint8_t i = 0; i < NUM_TEXT_WIDGETS; i++) {
+      if (page->shown[i]) {
+        widget_position(i, &x, &y, &ha, &font);
+        snprintf(text, sizeof(text), "%0.1f", (double)page->values[i]);
+        write_string(text, x, y, 0, 0, TEXT_VA_TOP, ha, 0, font);
+      }
+    }
+    if (page->icon)
+      draw_image(200, 230, &icon);
+  }
+
+  void draw_retained(const struct test_page *page) {
+    char text[16];
+    int x, y, ha, font;
+
+    osd_widgets_begin(widgets, NUM_WIDGETS);
+    osd_region_begin();
+    draw_regions(page);
+    osd_region_end();
+    for (uint8_t i = 0; i < NUM_TEXT_WIDGETS; i++) {
+      if (page->shown[i] && osd_widget_update(&widgets[i], page->values[i])) {
+        widget_position(i, &x, &y, &ha, &font);
+        snprintf(text, sizeof(text), "%0.1f", (double)page->values[i]);
+        osd_widget_text(&widgets[i], text, x, y, TEXT_VA_TOP, ha, 0, font);
+      }
+    }
+    if (page->icon)
+      osd_widget_image(&widgets[NUM_TEXT_WIDGETS], &icon, 200, 230);
+    osd_widgets_end();
+  }
+
+  void init_page(struct test_page *page) {
+    for (uint8_t i = 0; i < NUM_TEXT_WIDGETS; i++) {
+      page->values[i] = i * 11.5f;
+      page->shown[i] = true;
+    }
+    page->icon = true;
+    page->horizon = 0;
+  }
+
+  // Some values change, some widgets blink, the regions always move
+  void step_page(struct test_page *page, uint32_t frame, uint32_t change_one_in) {
+    for (uint8_t i = 0; i < NUM_TEXT_WIDGETS; i++) {
+      if (rand() % change_one_in == 0)
+        page->values[i] += (rand() % 3 - 1) * (i % 2 ? 0.1f : 10.0f);
+      if (rand() % 50 == 0)
+        page->shown[i] = !page->shown[i];
+    }
+    page->icon = frame % 14 < 7;
+    page->horizon = (int)(frame % 41) - 20;
+  }
+
+  struct osd_widget widgets[NUM_WIDGETS];
+  uint8_t level[3][BUFFER_SIZE];
+  uint8_t mask[3][BUFFER_SIZE];
+};
+
+TEST_F(OsdTest, GlyphCache) {
+  char text[2] = { 0, 0 };
+  int mismatches = 0;
+
+  for (int font = 0; font < NUM_FONTS; font++) {
+    for (int flags = 0; flags <= FONT_INVERT; flags += FONT_INVERT) {
+      for (int ch = 32; ch < 127; ch++) {
+        if (font < 2 && fonts[font].lookup[ch] == (char)0xff)
+          continue;
+
+        for (int x = 40; x < 48; x++) {
+          // Random background, the glyph has to clear level bits too
+          for (uint32_t i = 0; i < BUFFER_SIZE; i++) {
+            level[0][i] = level[1][i] = rand();
+            mask[0][i] = mask[1][i] = rand();
+          }
+
+          select_buffer(0);
+          if (font < 2)
+            write_char(ch, x, 50, flags, font);
+          else
+            write_char16(ch, x, 50, flags, font);
+
+          select_buffer(1);
+          write_char_cached(ch, x, 50, flags, font);
+
+          if (memcmp(level[0], level[1], BUFFER_SIZE) || memcmp(mask[0], mask[1], BUFFER_SIZE))
+            mismatches++;
+        }
+      }
+    }
+  }
+  EXPECT_EQ(0, mismatches);
+
+  // Partly off screen goes through the old path
+  memset(level, 0, sizeof(level));
+  memset(mask, 0, sizeof(mask));
+  text[0] = 'A';
+  select_buffer(0);
+  write_char16('A', -4, 100, 0, 3);
+  select_buffer(1);
+  write_string(text, -4, 100, 0, 0, TEXT_VA_TOP, TEXT_HA_LEFT, 0, 3);
+  EXPECT_EQ(0, memcmp(level[0], level[1], BUFFER_SIZE));
+  EXPECT_EQ(0, memcmp(mask[0], mask[1], BUFFER_SIZE));
+}
+
+TEST_F(OsdTest, ClearRect) {
+  struct osd_rect rect = { 13, 20, 30, 25 };
+
+  memset(level, 0xff, sizeof(level));
+  memset(mask, 0xff, sizeof(mask));
+  clear_rect(&rect);
+
+  // Whole bytes are cleared, nothing outside them
+  for (int y = 0; y < BUFFER_HEIGHT; y++) {
+    for (int x = 0; x < BUFFER_WIDTH; x++) {
+      uint8_t expected = (y >= 20 && y <= 25 && x >= 1 && x <= 3) ? 0 : 0xff;
+      ASSERT_EQ(expected, level[0][y * BUFFER_WIDTH + x]) << x << " " << y;
+      ASSERT_EQ(expected, mask[0][y * BUFFER_WIDTH + x]) << x << " " << y;
+    }
+  }
+
+  // Off the screen is clipped, the last byte of each line is not drawn
+  struct osd_rect outside = { -100, -100, 1000, 1000 };
+  clear_rect(&outside);
+  for (int y = 0; y < BUFFER_HEIGHT; y++) {
+    for (int x = 0; x < BUFFER_WIDTH; x++) {
+      uint8_t expected = (x < GRAPHICS_WIDTH_REAL / 8) ? 0 : 0xff;
+      ASSERT_EQ(expected, level[0][y * BUFFER_WIDTH + x]) << x << " " << y;
+      ASSERT_EQ(expected, mask[0][y * BUFFER_WIDTH + x]) << x << " " << y;
+    }
+  }
+}
+
+TEST_F(OsdTest, FilledRectangleBounds) {
+  // Within one byte, across two bytes and across several
+  const int rects[][2] = { { 9, 4 }, { 13, 6 }, { 13, 20 } };
+
+  for (unsigned r = 0; r < sizeof(rects) / sizeof(rects[0]); r++) {
+    const int x = rects[r][0], width = rects[r][1];
+
+    memset(level, 0, sizeof(level));
+    osd_bounds_reset();
+    write_filled_rectangle(level[0], x, 20, width, 3, 1);
+
+    EXPECT_EQ(x, osd_draw_bounds.x0);
+    EXPECT_EQ(x + width - 1, osd_draw_bounds.x1);
+    EXPECT_EQ(20, osd_draw_bounds.y0);
+    EXPECT_EQ(22, osd_draw_bounds.y1);
+
+    // Exactly the columns x to x + width - 1 are set
+    for (int px = 0; px < GRAPHICS_WIDTH_REAL; px++) {
+      bool set = (level[0][21 * BUFFER_WIDTH + px / 8] >> (7 - px % 8)) & 1;
+      ASSERT_EQ(px >= x && px < x + width, set) << "rect " << r << " x " << px;
+    }
+  }
+}
+
+TEST_F(OsdTest, RetainedMatchesFull) {
+  struct test_page page;
+
+  memset(widgets, 0, sizeof(widgets));
+  init_page(&page);
+
+  for (uint32_t frame = 0; frame < 400; frame++) {
+    step_page(&page, frame, 4);
+
+    // The video driver swaps the buffers after every frame
+    select_buffer(frame % 2);
+
+    if (frame == 200) {
+      osd_widgets_invalidate();
+    }
+
+    if (frame == 300) {
+      // The buffers are swapped in the middle of the frame, nothing
+      // can be said about this one
+      osd_widgets_begin(widgets, NUM_WIDGETS);
+      select_buffer(1 - frame % 2);
+      osd_widgets_end();
+      continue;
+    }
+
+    draw_retained(&page);
+
+    select_buffer(2);
+    draw_full(&page);
+
+    ASSERT_EQ(0, memcmp(level[frame % 2], level[2], BUFFER_SIZE)) << "frame " << frame;
+    ASSERT_EQ(0, memcmp(mask[frame % 2], mask[2], BUFFER_SIZE)) << "frame " << frame;
+  }
+}
+
+TEST_F(OsdTest, HiddenWidgetsAreCleared) {
+  struct test_page page;
+
+  memset(widgets, 0, sizeof(widgets));
+  init_page(&page);
+
+  for (uint32_t frame = 0; frame < 4; frame++) {
+    select_buffer(frame % 2);
+    draw_retained(&page);
+  }
+
+  // Nothing declared: both buffers go back to the regions only
+  for (uint8_t i = 0; i < NUM_TEXT_WIDGETS; i++)
+    page.shown[i] = false;
+  page.icon = false;
+
+  for (uint32_t frame = 4; frame < 6; frame++) {
+    select_buffer(frame % 2);
+    draw_retained(&page);
+    select_buffer(2);
+    draw_full(&page);
+    EXPECT_EQ(0, memcmp(level[frame % 2], level[2], BUFFER_SIZE));
+    EXPECT_EQ(0, memcmp(mask[frame % 2], mask[2], BUFFER_SIZE));
+  }
+}
+
+TEST_F(OsdTest, Benchmark) {
+  struct test_page page;
+  const uint32_t frames = 1000;
+
+  memset(widgets, 0, sizeof(widgets));
+
+  // Values change about every 10 frames, like at 50 Hz with telemetry at 5 Hz
+  init_page(&page);
+  srand(1);
+  double start = now_ns();
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    step_page(&page, frame, 10);
+    select_buffer(frame % 2);
+    draw_full(&page);
+  }
+  double full = (now_ns() - start) / frames;
+
+  init_page(&page);
+  srand(1);
+  start = now_ns();
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    step_page(&page, frame, 10);
+    select_buffer(frame % 2);
+    draw_retained(&page);
+  }
+  double retained = (now_ns() - start) / frames;
+
+  // Characters alone
+  const uint32_t chars = 100000;
+  start = now_ns();
+  for (uint32_t i = 0; i < chars; i++)
+    write_char16('0' + i % 10, 40 + i % 8, 50, 0, 3);
+  double plain = (now_ns() - start) / chars;
+
+  start = now_ns();
+  for (uint32_t i = 0; i < chars; i++)
+    write_char_cached('0' + i % 10, 40 + i % 8, 50, 0, 3);
+  double cached = (now_ns() - start) / chars;
+
+  printf("frame: full %.1f us, retained %.1f us\n", full / 1000, retained / 1000);
+  printf("12x18 char: write_char16 %.0f ns, cached %.0f ns\n", plain, cached);
+
+  // Loose bounds, so this does not fail on a loaded machine
+  EXPECT_LT(retained, full);
+  EXPECT_LT(cached, plain);
+}
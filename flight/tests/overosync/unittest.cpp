@@ -0,0 +1,252 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the batching and subscriptions of the companion link
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+#include "overosync_link.h"
+}
+
+#define PORT_ID      0x4321U
+#define TX_BUF_SIZE  512
+#define BATCH_SIZE   128
+#define MAX_SUBS     4
+
+/*
+ * Loopback port: what the link writes ends up at the companion side, which
+ * reads it whenever the test lets it
+ */
+static struct {
+	uint8_t buf[TX_BUF_SIZE];
+	uint16_t used;
+	uint32_t writes;
+	uint8_t rx[4096];
+	uint32_t rx_len;
+} port;
+
+static void companion_read(void)
+{
+	memcpy(&port.rx[port.rx_len], port.buf, port.used);
+	port.rx_len += port.used;
+	port.used = 0;
+}
+
+extern "C" uint16_t PIOS_COM_GetTxFree(uintptr_t com_id)
+{
+	EXPECT_EQ(PORT_ID, com_id);
+	return TX_BUF_SIZE - port.used;
+}
+
+extern "C" int32_t PIOS_COM_SendBufferNonBlocking(uintptr_t com_id, const uint8_t *buffer, uint16_t len)
+{
+	EXPECT_EQ(PORT_ID, com_id);
+
+	// The link must never send what doesn't fit, frames would be cut
+	EXPECT_LE(port.used + len, TX_BUF_SIZE);
+	if (port.used + len > TX_BUF_SIZE)
+		return -2;
+
+	memcpy(&port.buf[port.used], buffer, len);
+	port.used += len;
+	port.writes++;
+
+	return len;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class OveroSyncLink : public testing::Test {
+protected:
+  virtual void SetUp() {
+    memset(&port, 0, sizeof(port));
+
+    link = overosync_link_create(PORT_ID, BATCH_SIZE, MAX_SUBS);
+    ASSERT_TRUE(link != NULL);
+  }
+
+  virtual void TearDown() {
+  }
+
+  // A frame of len bytes, all of them the value n
+  int32_t write(uint8_t n, uint16_t len) {
+    uint8_t frame[BATCH_SIZE];
+
+    memset(frame, n, len);
+    return overosync_link_write(link, frame, len);
+  }
+
+  struct overosync_link *link;
+};
+
+TEST_F(OveroSyncLink, BatchesFrames) {
+  for (int i = 0; i < 10; i++)
+    EXPECT_EQ(20, write(i, 20));
+
+  // Six frames fit in a batch, the seventh sent it
+  EXPECT_EQ(1U, port.writes);
+  EXPECT_EQ(120, port.used);
+
+  EXPECT_TRUE(overosync_link_flush(link));
+  EXPECT_EQ(2U, port.writes);
+  EXPECT_EQ(200, port.used);
+
+  // The frames arrive whole and in order
+  companion_read();
+  for (uint32_t i = 0; i < port.rx_len; i++)
+    EXPECT_EQ(i / 20, port.rx[i]);
+
+  struct overosync_link_stats stats;
+  overosync_link_get_stats(link, &stats);
+  EXPECT_EQ(200U, stats.sent_bytes);
+  EXPECT_EQ(2U, stats.batches);
+  EXPECT_EQ(0U, stats.dropped);
+
+  // Nothing to do for an empty batch
+  EXPECT_TRUE(overosync_link_flush(link));
+  EXPECT_EQ(2U, port.writes);
+}
+
+TEST_F(OveroSyncLink, DropsWhenPortFull) {
+  // Fill the port until the batch can't go anymore
+  for (int i = 0; i < 30; i++)
+    write(i, 50);
+
+  EXPECT_FALSE(overosync_link_flush(link));
+  EXPECT_GT(port.used, TX_BUF_SIZE - BATCH_SIZE);
+
+  struct overosync_link_stats stats;
+  overosync_link_get_stats(link, &stats);
+  EXPECT_GT(stats.dropped, 0U);
+  EXPECT_EQ(port.used, stats.sent_bytes);
+
+  // Once the companion reads, the kept batch goes out
+  companion_read();
+  EXPECT_TRUE(overosync_link_flush(link));
+  EXPECT_EQ(100, port.used);
+
+  // Only whole frames were sent
+  companion_read();
+  EXPECT_EQ(0U, port.rx_len % 50);
+  for (uint32_t i = 0; i < port.rx_len; i += 50)
+    EXPECT_EQ(port.rx[i], port.rx[i + 49]);
+}
+
+TEST_F(OveroSyncLink, RoomFollowsPort) {
+  EXPECT_EQ(BATCH_SIZE, overosync_link_room(link));
+
+  // The port can take the batch, so all of it is room
+  write(1, 100);
+  EXPECT_EQ(BATCH_SIZE, overosync_link_room(link));
+
+  // Block the port: only the rest of the batch is left
+  for (int i = 0; i < 4; i++) {
+    write(2, 100);
+    overosync_link_flush(link);
+  }
+  write(2, 100);
+  EXPECT_FALSE(overosync_link_flush(link));
+  uint16_t room = overosync_link_room(link);
+  EXPECT_LT(room, BATCH_SIZE);
+
+  // Writing within the room never drops
+  EXPECT_EQ(room, write(3, room));
+
+  struct overosync_link_stats stats;
+  overosync_link_get_stats(link, &stats);
+  EXPECT_EQ(0U, stats.dropped);
+  EXPECT_EQ(0, overosync_link_room(link));
+}
+
+TEST_F(OveroSyncLink, ForwardsEverythingWithoutSubscriptions) {
+  EXPECT_TRUE(overosync_link_forward_update(link, 0x1234));
+
+  EXPECT_EQ(0, overosync_link_subscribe(link, 0x1000, 0));
+  EXPECT_EQ(0, overosync_link_subscribe(link, 0x2000, 100));
+
+  EXPECT_FALSE(overosync_link_forward_update(link, 0x1234));
+  EXPECT_TRUE(overosync_link_forward_update(link, 0x1000));
+  EXPECT_FALSE(overosync_link_forward_update(link, 0x2000));
+
+  overosync_link_unsubscribe_all(link);
+  EXPECT_TRUE(overosync_link_forward_update(link, 0x1234));
+}
+
+TEST_F(OveroSyncLink, SubscriptionLimit) {
+  for (uint32_t i = 1; i <= MAX_SUBS; i++)
+    EXPECT_EQ(0, overosync_link_subscribe(link, i, 100));
+
+  EXPECT_EQ(-1, overosync_link_subscribe(link, 100, 100));
+
+  // Changing the period of a known one still works
+  EXPECT_EQ(0, overosync_link_subscribe(link, 1, 0));
+  EXPECT_TRUE(overosync_link_forward_update(link, 1));
+}
+
+TEST_F(OveroSyncLink, PeriodicSubscriptions) {
+  uint32_t sent[3] = { 0, 0, 0 };
+  uint32_t obj_id;
+
+  EXPECT_EQ(0, overosync_link_subscribe(link, 1, 50));
+  EXPECT_EQ(0, overosync_link_subscribe(link, 2, 200));
+  EXPECT_EQ(0, overosync_link_subscribe(link, 3, 0));
+
+  for (uint32_t now = 1000; now < 3000; now += 10) {
+    while (overosync_link_next_due(link, now, &obj_id)) {
+      ASSERT_GE(obj_id, 1U);
+      ASSERT_LE(obj_id, 2U);
+      sent[obj_id]++;
+      overosync_link_mark_sent(link, obj_id, now);
+    }
+  }
+
+  EXPECT_NEAR(40, sent[1], 1);
+  EXPECT_NEAR(10, sent[2], 1);
+
+  // What isn't sent stays due, the longest waiting first
+  EXPECT_TRUE(overosync_link_next_due(link, 5000, &obj_id));
+  EXPECT_EQ(2U, obj_id);
+  overosync_link_mark_sent(link, 2, 5000);
+  EXPECT_TRUE(overosync_link_next_due(link, 5000, &obj_id));
+  EXPECT_EQ(1U, obj_id);
+  overosync_link_mark_sent(link, 1, 5000);
+  EXPECT_FALSE(overosync_link_next_due(link, 5000, &obj_id));
+}
+
+/**
+ * @}
+ * @}
+ */
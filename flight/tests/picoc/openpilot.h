@@ -0,0 +1,10 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <math.h>
+
+#define PIOS_Assert(test) do { if (!(test)) abort(); } while (0)
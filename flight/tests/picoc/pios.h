@@ -0,0 +1,7 @@
+#define PIOS_INCLUDE_PICOC
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+void *PIOS_malloc(size_t size);
@@ -0,0 +1,4 @@
+#include <stdint.h>
+
+uint32_t PIOS_DELAY_GetRaw();
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw);
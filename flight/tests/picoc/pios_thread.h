@@ -0,0 +1,3 @@
+#include <stdint.h>
+
+void PIOS_Thread_Sleep(uint32_t time_ms);
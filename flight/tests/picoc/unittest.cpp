@@ -0,0 +1,375 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* malloc */
+#include <string.h>		/* memcpy */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+
+#include "openpilot.h"
+#undef assert			/* picoc maps it to PIOS_Assert */
+#include "picoc_port.h"		/* API for the interpreter */
+#undef malloc			/* picoc maps these to its own heap */
+#undef free
+
+static uint32_t thread_sleeps;
+
+void PIOS_Thread_Sleep(uint32_t)
+{
+  thread_sleeps++;
+}
+
+void *PIOS_malloc(size_t size)
+{
+  return malloc(size);
+}
+
+uint32_t PIOS_DELAY_GetRaw()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+  return PIOS_DELAY_GetRaw() - raw;
+}
+
+// The flight library needs the UAVObjects, the scripts here only use the C library
+void PlatformLibraryInit(Picoc *)
+{
+}
+
+// A token store in memory
+static uint8_t store_image[64 * 1024];
+static uint32_t store_len;
+static uint32_t store_loads;
+static uint32_t store_saves;
+
+static int32_t store_load(uint8_t *buffer, uint32_t size)
+{
+  store_loads++;
+  if (size > store_len)
+    return -1;
+  memcpy(buffer, store_image, size);
+  return 0;
+}
+
+static int32_t store_save(const uint8_t *buffer, uint32_t size)
+{
+  store_saves++;
+  if (size > sizeof(store_image))
+    return -1;
+  memcpy(store_image, buffer, size);
+  store_len = size;
+  return 0;
+}
+
+static const struct picoc_token_store store = {
+  store_load,
+  store_save,
+};
+
+}
+
+#define STACK_SIZE (64 * 1024)
+
+// Functions, recursion, string literals, floats and character constants
+static const char *script =
+  "int fib(int n)\n"
+  "{\n"
+  "  if (n < 2)\n"
+  "    return n;\n"
+  "  return fib(n - 1) + fib(n - 2);\n"
+  "}\n"
+  "char *a = \"same text\";\n"
+  "char *b = \"same text\";\n"
+  "char buffer[32];\n"
+  "sprintf(buffer, \"%s-%d\", \"fib\", fib(10));\n"
+  "float half = 0.5;\n"
+  "int result = fib(10) + (a == b) * 1000 + (buffer[4] == '5') * 2000 + (int)(half * 8);\n"
+  "exit(result);\n";
+
+static const int script_result = 55 + 1000 + 2000 + 4;
+
+// Mostly loop, little source
+static const char *loop_script =
+  "int sum = 0;\n"
+  "for (int i = 0; i < 20000; i++)\n"
+  "  sum = sum + i % 7;\n"
+  "exit(sum % 1000);\n";
+
+static int loop_result(void)
+{
+  int sum = 0;
+  for (int i = 0; i < 20000; i++)
+    sum = sum + i % 7;
+  return sum % 1000;
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class PicocTokens : public testing::Test {
+protected:
+  virtual void SetUp() {
+    store_len = 0;
+    store_loads = 0;
+    store_saves = 0;
+    thread_sleeps = 0;
+    picoc_set_time_slice(0);
+    picoc_set_bytecode(true);
+  }
+
+  virtual void TearDown() {
+  }
+};
+
+TEST_F(PicocTokens, Uncached) {
+  EXPECT_EQ(script_result, picoc(script, STACK_SIZE));
+  EXPECT_EQ(loop_result(), picoc(loop_script, STACK_SIZE));
+}
+
+TEST_F(PicocTokens, CacheHit) {
+  // The first run tokenises and saves the image
+  EXPECT_EQ(script_result, picoc_cached(script, STACK_SIZE, &store));
+  EXPECT_EQ(1U, store_saves);
+  EXPECT_GT(store_len, 0U);
+
+  // The next runs only load it
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(script_result, picoc_cached(script, STACK_SIZE, &store));
+  }
+  EXPECT_EQ(1U, store_saves);
+}
+
+TEST_F(PicocTokens, ChangedSource) {
+  EXPECT_EQ(script_result, picoc_cached(script, STACK_SIZE, &store));
+  EXPECT_EQ(1U, store_saves);
+
+  // A different source must not run from the old image
+  EXPECT_EQ(loop_result(), picoc_cached(loop_script, STACK_SIZE, &store));
+  EXPECT_EQ(2U, store_saves);
+
+  EXPECT_EQ(script_result, picoc_cached(script, STACK_SIZE, &store));
+  EXPECT_EQ(3U, store_saves);
+}
+
+TEST_F(PicocTokens, DamagedImage) {
+  EXPECT_EQ(script_result, picoc_cached(script, STACK_SIZE, &store));
+  ASSERT_EQ(1U, store_saves);
+  uint32_t image_len = store_len;
+
+  // Any damaged byte is caught by the header checks or the image hash
+  // and the source is tokenised again
+  for (uint32_t i = 0; i < image_len; i += 37) {
+    store_image[i] ^= 0x5a;
+    uint32_t saves = store_saves;
+    EXPECT_EQ(script_result, picoc_cached(script, STACK_SIZE, &store)) << i;
+    EXPECT_EQ(saves + 1, store_saves) << i;
+  }
+
+  // A truncated image
+  store_len = image_len / 2;
+  EXPECT_EQ(script_result, picoc_cached(script, STACK_SIZE, &store));
+  EXPECT_EQ(image_len, store_len);
+}
+
+TEST_F(PicocTokens, TimeSlice) {
+  // Without a time slice the script never gives up the cpu
+  EXPECT_EQ(loop_result(), picoc(loop_script, STACK_SIZE));
+  EXPECT_EQ(0U, thread_sleeps);
+
+  picoc_set_time_slice(100);
+  double start = now_ns();
+  EXPECT_EQ(loop_result(), picoc_cached(loop_script, STACK_SIZE, &store));
+  double run_us = (now_ns() - start) / 1000;
+  EXPECT_GT(thread_sleeps, 0U);
+  EXPECT_LE(thread_sleeps, run_us / 100 + 1);
+
+  // Functions inherit the check from the parser they are defined with
+  const char *function_loop =
+    "int spin(int n) { int sum = 0; for (int i = 0; i < n; i++) sum += i; return sum; }\n"
+    "exit(spin(20000) % 1000);\n";
+  thread_sleeps = 0;
+  EXPECT_EQ((int)((19999LL * 20000 / 2) % 1000), picoc(function_loop, STACK_SIZE));
+  EXPECT_GT(thread_sleeps, 0U);
+}
+
+TEST_F(PicocTokens, Benchmark) {
+  const int runs = 50;
+
+  // A long source that does little, so the time goes into tokenising.
+  // Tokenising needs four times the source on the stack.
+  char *long_script = (char *)malloc(32 * 1024);
+  char *pos = long_script;
+  for (int i = 0; i < 100; i++) {
+    pos += sprintf(pos, "int function_%d(int value) { return value * %d + %d; }\n", i, i, i % 5);
+  }
+  pos += sprintf(pos, "exit(function_99(1) %% 100);\n");
+  int long_result = (99 + 99 % 5) % 100;
+
+  // Setting up the interpreter and its libraries
+  double start = now_ns();
+  for (int i = 0; i < runs; i++) {
+    ASSERT_EQ(1, picoc("exit(1);", STACK_SIZE));
+  }
+  double empty = (now_ns() - start) / runs / 1000;
+
+  start = now_ns();
+  for (int i = 0; i < runs; i++) {
+    ASSERT_EQ(long_result, picoc(long_script, STACK_SIZE));
+  }
+  double uncached = (now_ns() - start) / runs / 1000;
+
+  ASSERT_EQ(long_result, picoc_cached(long_script, STACK_SIZE, &store));
+  start = now_ns();
+  for (int i = 0; i < runs; i++) {
+    ASSERT_EQ(long_result, picoc_cached(long_script, STACK_SIZE, &store));
+  }
+  double cached = (now_ns() - start) / runs / 1000;
+  EXPECT_EQ(1U, store_saves);
+
+  printf("%6u bytes of source, %6u bytes of tokens: %6.0f us tokenised, %6.0f us cached, %6.0f us empty script\n",
+      (unsigned)strlen(long_script), store_len, uncached, cached, empty);
+  free(long_script);
+
+  // Loop throughput, the cache does not change how the loop runs
+  picoc_set_bytecode(false);
+  start = now_ns();
+  ASSERT_EQ(loop_result(), picoc(loop_script, STACK_SIZE));
+  double interpreted = now_ns() - start;
+
+  picoc_set_bytecode(true);
+  start = now_ns();
+  ASSERT_EQ(loop_result(), picoc(loop_script, STACK_SIZE));
+  double bytecode = now_ns() - start;
+
+  picoc_set_time_slice(1000);
+  start = now_ns();
+  ASSERT_EQ(loop_result(), picoc_cached(loop_script, STACK_SIZE, &store));
+  double sliced = now_ns() - start;
+
+  printf("loop: %6.0f ns per iteration interpreted, %6.0f ns as bytecode, %6.0f ns with a 1 ms time slice (%u yields)\n",
+      interpreted / 20000, bytecode / 20000, sliced / 20000, thread_sleeps);
+  EXPECT_LT(bytecode * 4, interpreted);
+}
+
+// Scripts that have to give the same result with and without bytecode
+static const char *bytecode_scripts[] = {
+  // integer types and operators
+  "int sum = 0; char c = 0; unsigned char uc = 250; short s = 0; unsigned int u = 1; long l = 3;\n"
+  "int i;\n"
+  "for (i = 0; i < 1000; i++) {\n"
+  "  sum += (i * 3) % 7 - (i >> 2) + (i << 1) - (i & 5) + (i | 2) - (i ^ 9);\n"
+  "  c += 7; uc++; s -= 300; u *= 3; l = l * 5 % 1001;\n"
+  "  if (i % 3 == 0 && i % 5 != 0) sum += 2; else if (!(i % 7) || i == 500) sum -= 1;\n"
+  "  sum += ~i & 3; sum -= -i / 4;\n"
+  "}\n"
+  "exit((sum + c + uc + s + u % 1000 + l) % 10000);\n",
+
+  // floating point, mixed with integers, and a floating point condition
+  "float x = 0.0; double y = 1.0; int n = 0; int k = 0; int t = 0;\n"
+  "while (x < 10.0) { x += 0.25; y = y * 1.01 - 0.001; n++; if (y > 1.2) y /= 2; t += x * 3; }\n"
+  "do { k++; x -= 0.75; ++y; } while (x);\n"
+  "while (k < 100) { k += 1.5; y = -y + !x; }\n"
+  "exit(n * 1000 + k * 10 + (int)(y * 100) + t % 1000 + (int)(x * 4));\n",
+
+  // break, continue, nested loops and declarations in them
+  "int total = 0;\n"
+  "for (int i = 0; i < 50; i++) {\n"
+  "  if (i == 40) break;\n"
+  "  if (i % 2) continue;\n"
+  "  for (int j = 0, m = i; j < m; j++) { int t = j * 2; total += t; if (total > 100000) break; }\n"
+  "  int w = 3;\n"
+  "  while (w--) total++;\n"
+  "  do { total += 2; continue; } while (0);\n"
+  "  unsigned char b = total; total += b;\n"
+  "}\n"
+  "exit(total % 10000);\n",
+
+  // defines
+  "#define LIMIT 300\n"
+  "#define STEP (2 + 1)\n"
+  "int acc = 0; int i = 0;\n"
+  "while (i < LIMIT) { acc += STEP * 'a'; i += STEP; }\n"
+  "exit(acc % 10000);\n",
+
+  // calls and arrays are left to the interpreter
+  "int sq(int v) { return v * v; }\n"
+  "int a[10]; int s = 0;\n"
+  "for (int i = 0; i < 10; i++) { a[i] = sq(i); }\n"
+  "for (int i = 0; i < 10; i++) s += a[i];\n"
+  "int i = 0; while (i < 10) { s += i > 5 ? 1 : 2; i++; }\n"
+  "exit(s);\n",
+
+  // locals of a function, chained assignments and the values of increments
+  "int f(int n) {\n"
+  "  int r = 0; int i = 0; int a; int b; int d;\n"
+  "  while (i < n) {\n"
+  "    r = r * 3 + i - (i - 1) * 2 / 3; r %= 100003;\n"
+  "    a = b = r + 1; d = (a = 5) * 2 + b;\n"
+  "    r += i++ * 2; r -= --i; i += 1;\n"
+  "    r = r + d;\n"
+  "  }\n"
+  "  return r;\n"
+  "}\n"
+  "exit(f(500) % 10000);\n",
+};
+
+TEST_F(PicocTokens, Bytecode) {
+  for (unsigned i = 0; i < sizeof(bytecode_scripts) / sizeof(bytecode_scripts[0]); i++) {
+    picoc_set_bytecode(false);
+    int interpreted = picoc(bytecode_scripts[i], STACK_SIZE);
+    picoc_set_bytecode(true);
+    EXPECT_EQ(interpreted, picoc(bytecode_scripts[i], STACK_SIZE)) << i;
+  }
+
+  // Known results of some of them
+  EXPECT_EQ(285 + 4 + 6 * 2, picoc(bytecode_scripts[4], STACK_SIZE));
+  EXPECT_EQ(100 * 3 * 'a' % 10000, picoc(bytecode_scripts[3], STACK_SIZE));
+
+  // A division by zero stops the script instead of the cpu
+  EXPECT_EQ(1, picoc("int z = 0; int n = 0; while (n < 3) n = n + 1 / z; exit(5);", STACK_SIZE));
+}
@@ -0,0 +1,14 @@
+/* The executive only needs memory, a thread and the task monitor, the test provides them */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIOS_malloc malloc
+#define PIOS_free free
+
+struct pios_thread;
+
+#define TASKINFO_RUNNING_RATEGROUPS 37
+
+int32_t TaskMonitorAdd(uint8_t task, struct pios_thread *handlep);
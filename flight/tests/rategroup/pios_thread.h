@@ -0,0 +1,13 @@
+/* Thread calls of the executive, the test records them */
+#include <stdint.h>
+#include <stddef.h>
+
+enum pios_thread_prio_e {
+	PIOS_THREAD_PRIO_LOW = 1,
+};
+
+struct pios_thread;
+
+struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, size_t stack_bytes, void *argp, enum pios_thread_prio_e prio);
+uint32_t PIOS_Thread_Systime(void);
+void PIOS_Thread_Sleep_Until(uint32_t *previous_ms, uint32_t increment_ms);
@@ -0,0 +1,255 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the rate group executive
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+#include "rategroup.h"
+#include "pios_thread.h"
+}
+
+/*
+ * The thread is never run, the test only checks it is created once
+ */
+static struct {
+	uint32_t created;
+	uint32_t monitored;
+	size_t stack_bytes;
+} thread;
+
+static uint8_t thread_dummy;
+
+extern "C" struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, size_t stack_bytes, void *argp, enum pios_thread_prio_e prio)
+{
+	EXPECT_TRUE(fp != NULL);
+	EXPECT_TRUE(namep != NULL);
+	EXPECT_EQ(PIOS_THREAD_PRIO_LOW, prio);
+	(void) argp;
+
+	thread.created++;
+	thread.stack_bytes = stack_bytes;
+
+	return (struct pios_thread *) &thread_dummy;
+}
+
+extern "C" uint32_t PIOS_Thread_Systime(void)
+{
+	return 0;
+}
+
+extern "C" void PIOS_Thread_Sleep_Until(uint32_t *previous_ms, uint32_t increment_ms)
+{
+	*previous_ms += increment_ms;
+}
+
+extern "C" int32_t TaskMonitorAdd(uint8_t task, struct pios_thread *handlep)
+{
+	(void) task;
+	EXPECT_TRUE(handlep != NULL);
+
+	thread.monitored++;
+
+	return 0;
+}
+
+/*
+ * Steps that count their calls and record the order they ran in
+ */
+#define NUM_STEPS 4
+
+static struct {
+	uint32_t count;
+	float dT;
+	uint32_t last_tick;
+	uint32_t order;
+} steps[NUM_STEPS];
+
+static uint32_t now_tick;
+static uint32_t order;
+
+static void step(int n, float dT)
+{
+	steps[n].count++;
+	steps[n].dT = dT;
+	steps[n].last_tick = now_tick;
+	steps[n].order = order++;
+}
+
+static void step0(float dT) { step(0, dT); }
+static void step1(float dT) { step(1, dT); }
+static void step2(float dT) { step(2, dT); }
+static void step3(float dT) { step(3, dT); }
+
+static const rate_group_step step_fns[NUM_STEPS] = { step0, step1, step2, step3 };
+
+// To use a test fixture, derive a class from testing::Test.
+class RateGroup : public testing::Test {
+protected:
+  virtual void SetUp() {
+    memset(steps, 0, sizeof(steps));
+    now_tick = 0;
+    order = 0;
+    wakeups = 0;
+
+    exec = rate_group_exec_create(NUM_STEPS);
+    ASSERT_TRUE(exec != NULL);
+  }
+
+  virtual void TearDown() {
+  }
+
+  void add(int n, enum rate_group group) {
+    EXPECT_EQ(0, rate_group_exec_add(exec, group, step_fns[n]));
+  }
+
+  // Run the executive like its thread does, waking only when told to
+  void run(uint32_t ticks) {
+    uint32_t end = now_tick + ticks;
+
+    while (now_tick < end) {
+      uint32_t next = rate_group_exec_run(exec, now_tick);
+      EXPECT_GT(next, now_tick);
+      wakeups++;
+      now_tick = next;
+    }
+  }
+
+  struct rate_group_exec *exec;
+  uint32_t wakeups;
+};
+
+TEST_F(RateGroup, RegisterLimit) {
+  EXPECT_EQ(-1, rate_group_exec_add(exec, RATE_GROUP_NUM, step0));
+  EXPECT_EQ(-1, rate_group_exec_add(exec, RATE_GROUP_1HZ, NULL));
+
+  for (int i = 0; i < NUM_STEPS; i++)
+    add(i, RATE_GROUP_1HZ);
+
+  EXPECT_EQ(-1, rate_group_exec_add(exec, RATE_GROUP_1HZ, step0));
+}
+
+TEST_F(RateGroup, Rates) {
+  add(0, RATE_GROUP_1HZ);
+  add(1, RATE_GROUP_5HZ);
+  add(2, RATE_GROUP_10HZ);
+  add(3, RATE_GROUP_50HZ);
+
+  // 10 s
+  run(10000 / RATE_GROUP_TICK_MS);
+
+  EXPECT_EQ(10U, steps[0].count);
+  EXPECT_EQ(50U, steps[1].count);
+  EXPECT_EQ(100U, steps[2].count);
+  EXPECT_EQ(500U, steps[3].count);
+
+  EXPECT_FLOAT_EQ(1.0f, steps[0].dT);
+  EXPECT_FLOAT_EQ(0.2f, steps[1].dT);
+  EXPECT_FLOAT_EQ(0.1f, steps[2].dT);
+  EXPECT_FLOAT_EQ(0.02f, steps[3].dT);
+}
+
+TEST_F(RateGroup, FastestGroupFirst) {
+  // Registered slowest first, the tick that runs all of them starts with the fastest
+  add(0, RATE_GROUP_1HZ);
+  add(1, RATE_GROUP_5HZ);
+  add(2, RATE_GROUP_10HZ);
+  add(3, RATE_GROUP_50HZ);
+
+  rate_group_exec_run(exec, 0);
+
+  EXPECT_EQ(3U, steps[0].order);
+  EXPECT_EQ(2U, steps[1].order);
+  EXPECT_EQ(1U, steps[2].order);
+  EXPECT_EQ(0U, steps[3].order);
+}
+
+TEST_F(RateGroup, WakesOnlyWhenDue) {
+  add(0, RATE_GROUP_1HZ);
+  add(1, RATE_GROUP_5HZ);
+  add(2, RATE_GROUP_10HZ);
+
+  // The slower groups run on the ticks of the 10Hz one, so 10 wakeups a second
+  run(10000 / RATE_GROUP_TICK_MS);
+
+  EXPECT_EQ(100U, wakeups);
+  EXPECT_EQ(10U, steps[0].count);
+  EXPECT_EQ(50U, steps[1].count);
+  EXPECT_EQ(100U, steps[2].count);
+
+  // And the slow ones always run on a tick the fast one runs on too
+  EXPECT_EQ(0U, steps[0].last_tick % 5);
+  EXPECT_EQ(0U, steps[1].last_tick % 5);
+}
+
+TEST_F(RateGroup, OneSlowGroupWakesRarely) {
+  add(0, RATE_GROUP_1HZ);
+
+  run(10000 / RATE_GROUP_TICK_MS);
+
+  EXPECT_EQ(10U, wakeups);
+  EXPECT_EQ(10U, steps[0].count);
+}
+
+TEST_F(RateGroup, TwoHzKeepsHalfSecond) {
+  // The old period of the Battery thread
+  add(0, RATE_GROUP_2HZ);
+
+  run(10000 / RATE_GROUP_TICK_MS);
+
+  EXPECT_EQ(20U, wakeups);
+  EXPECT_EQ(20U, steps[0].count);
+  EXPECT_FLOAT_EQ(0.5f, steps[0].dT);
+}
+
+TEST_F(RateGroup, SharedExecutiveStartsOnce) {
+  memset(&thread, 0, sizeof(thread));
+
+  EXPECT_EQ(0, rate_group_add(RATE_GROUP_5HZ, step0));
+  EXPECT_EQ(0, rate_group_add(RATE_GROUP_10HZ, step1));
+  EXPECT_EQ(-1, rate_group_add(RATE_GROUP_NUM, step2));
+
+  EXPECT_EQ(1U, thread.created);
+  EXPECT_EQ(1U, thread.monitored);
+  EXPECT_GT(thread.stack_bytes, 0U);
+
+  // The thread isn't running here, so nothing ran yet
+  struct rate_group_stats stats;
+  rate_group_get_stats(&stats);
+  EXPECT_EQ(0U, stats.wakeups);
+  EXPECT_EQ(0U, stats.steps_run);
+}
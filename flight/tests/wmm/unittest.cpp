@@ -0,0 +1,240 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* rand */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* fabsf */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+
+#include "WorldMagModel.h"	/* API for the magnetic model */
+
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static float random_float(float min, float max)
+{
+  return min + (max - min) * rand() / (float)RAND_MAX;
+}
+
+// Fill the grid around a position, counting the evaluations it took
+static int fill_grid(float lat, float lon, float alt)
+{
+  int calls = 0;
+  int ret;
+
+  do {
+    ret = WMM_UpdateGrid(lat, lon, alt);
+    calls++;
+  } while (ret == 1 && calls < 10);
+
+  EXPECT_EQ(0, ret);
+  return calls;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class WMM : public testing::Test {
+protected:
+  virtual void SetUp() {
+    srand(1);
+  }
+
+  virtual void TearDown() {
+  }
+};
+
+// Test values published with WMM2015, the output is in mGauss
+TEST_F(WMM, TestValues) {
+  const struct {
+    float lat, lon, alt;
+    uint16_t year;
+    float X, Y, Z;
+  } values[] = {
+    {  80,    0,      0, 2015,  6627.1f,  -445.9f,  54432.3f },
+    {   0,  120,      0, 2015, 39518.2f,   392.9f, -11252.4f },
+    { -80, -120,      0, 2015,  5797.3f, 15761.1f, -52919.1f },
+  };
+
+  for (uint32_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    float B[3];
+    EXPECT_EQ(0, WMM_GetMagVector(values[i].lat, values[i].lon, values[i].alt, 1, 1, values[i].year, B));
+    EXPECT_NEAR(values[i].X * 1e-2f, B[0], 0.1f);
+    EXPECT_NEAR(values[i].Y * 1e-2f, B[1], 0.1f);
+    EXPECT_NEAR(values[i].Z * 1e-2f, B[2], 0.1f);
+  }
+}
+
+TEST_F(WMM, Errors) {
+  float B[3] = { 1, 2, 3 };
+
+  EXPECT_EQ(-1, WMM_GetMagVector(-91, 0, 0, 1, 1, 2015, B));
+  EXPECT_EQ(-2, WMM_GetMagVector(91, 0, 0, 1, 1, 2015, B));
+  EXPECT_EQ(-3, WMM_GetMagVector(0, -181, 0, 1, 1, 2015, B));
+  EXPECT_EQ(-4, WMM_GetMagVector(0, 181, 0, 1, 1, 2015, B));
+  EXPECT_EQ(-8, WMM_GetMagVector(0, 0, 0, 13, 1, 2015, B));
+  EXPECT_EQ(-8, WMM_GetMagVector(0, 0, 0, 2, 30, 2016, B));
+
+  // B is only written on success
+  EXPECT_EQ(1, B[0]);
+  EXPECT_EQ(2, B[1]);
+  EXPECT_EQ(3, B[2]);
+}
+
+// The field changes with the date that was set last
+TEST_F(WMM, Date) {
+  float B2015[3], B2017[3], B[3];
+
+  EXPECT_EQ(0, WMM_GetMagVector(47, 8, 0, 1, 1, 2015, B2015));
+  EXPECT_EQ(0, WMM_GetMagVector(47, 8, 0, 1, 1, 2017, B2017));
+  EXPECT_NE(B2015[0], B2017[0]);
+
+  // The grid is computed for the new date
+  EXPECT_EQ(0, WMM_SetDate(1, 1, 2015));
+  fill_grid(47, 8, 0);
+  EXPECT_EQ(0, WMM_GetGridMagVector(47, 8, 0, B));
+  EXPECT_FLOAT_EQ(B2015[0], B[0]);
+  EXPECT_FLOAT_EQ(B2015[2], B[2]);
+
+  EXPECT_EQ(0, WMM_SetDate(1, 1, 2017));
+  EXPECT_EQ(-1, WMM_GetGridMagVector(47, 8, 0, B));
+  fill_grid(47, 8, 0);
+  EXPECT_EQ(0, WMM_GetGridMagVector(47, 8, 0, B));
+  EXPECT_FLOAT_EQ(B2017[0], B[0]);
+  EXPECT_FLOAT_EQ(B2017[2], B[2]);
+}
+
+// Moving to the next cell reuses the corners in common
+TEST_F(WMM, GridUpdate) {
+  float B[3];
+
+  EXPECT_EQ(0, WMM_SetDate(6, 1, 2016));
+
+  EXPECT_EQ(4, fill_grid(10.1f, 20.1f, 100));
+
+  // Still in the same cell
+  EXPECT_EQ(0, WMM_UpdateGrid(10.4f, 20.4f, 100));
+  EXPECT_EQ(0, WMM_GetGridMagVector(10.4f, 20.4f, 100, B));
+
+  // Next cell east, two corners are shared. The old grid is used meanwhile.
+  EXPECT_EQ(1, WMM_UpdateGrid(10.4f, 20.6f, 100));
+  EXPECT_EQ(1, WMM_GetGridMagVector(10.4f, 20.6f, 100, B));
+  EXPECT_EQ(0, WMM_UpdateGrid(10.4f, 20.6f, 100));
+  EXPECT_EQ(0, WMM_GetGridMagVector(10.4f, 20.6f, 100, B));
+
+  // Diagonal, one corner is shared
+  EXPECT_EQ(3, fill_grid(10.6f, 21.1f, 100));
+
+  // Climbing a little doesn't refill the grid, climbing a lot does
+  EXPECT_EQ(0, WMM_UpdateGrid(10.6f, 21.1f, 1000));
+  EXPECT_EQ(4, fill_grid(10.6f, 21.1f, 5000));
+
+  // The last cells include the pole and the date line
+  EXPECT_EQ(4, fill_grid(90, 180, 0));
+  EXPECT_EQ(0, WMM_GetGridMagVector(90, 180, 0, B));
+  EXPECT_EQ(4, fill_grid(-90, -180, 0));
+  EXPECT_EQ(0, WMM_GetGridMagVector(-90, -180, 0, B));
+
+  EXPECT_EQ(-1, WMM_UpdateGrid(-91, 0, 0));
+  EXPECT_EQ(-4, WMM_UpdateGrid(0, 181, 0));
+}
+
+// Interpolating the grid stays close to the model
+TEST_F(WMM, GridAccuracy) {
+  float max_error = 0;
+
+  EXPECT_EQ(0, WMM_SetDate(6, 1, 2016));
+
+  for (int i = 0; i < 1000; i++) {
+    float lat = random_float(-70, 70);
+    float lon = random_float(-180, 180);
+    float alt = random_float(0, 3000);
+    float grid_alt = alt + random_float(-1500, 1500);
+    float B[3], B_grid[3];
+
+    fill_grid(lat, lon, grid_alt);
+    EXPECT_EQ(0, WMM_GetMagVector(lat, lon, alt, 6, 1, 2016, B));
+    EXPECT_EQ(0, WMM_GetGridMagVector(lat, lon, alt, B_grid));
+
+    for (int j = 0; j < 3; j++)
+      max_error = fmaxf(max_error, fabsf(B[j] - B_grid[j]));
+  }
+
+  printf("Largest error of the grid %.3f mGauss\n", max_error);
+
+  // A few mGauss is far below the errors of the model and the magnetometer
+  EXPECT_LT(max_error, 3.0f);
+}
+
+TEST_F(WMM, Benchmark) {
+  const int rounds = 2000;
+  float B[3];
+  float sum = 0;
+
+  EXPECT_EQ(0, WMM_SetDate(6, 1, 2016));
+  fill_grid(47.0f, 8.0f, 500);
+
+  double start = now_ns();
+  for (int i = 0; i < rounds; i++) {
+    WMM_GetMagVector(47.0f + i * 1e-5f, 8.0f, 500, 6, 1, 2016, B);
+    sum += B[0];
+  }
+  double model_ns = (now_ns() - start) / rounds;
+
+  start = now_ns();
+  for (int i = 0; i < rounds; i++) {
+    WMM_GetGridMagVector(47.0f + i * 1e-5f, 8.0f, 500, B);
+    sum += B[0];
+  }
+  double grid_ns = (now_ns() - start) / rounds;
+
+  printf("%14s %14s\n", "model (ns)", "grid (ns)");
+  printf("%14.1f %14.1f\n", model_ns, grid_ns);
+
+  EXPECT_GT(sum, 0);
+  EXPECT_LT(grid_ns, model_ns);
+}
@@ -26,10 +26,17 @@
 * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
 */
 #include "pureimage.h"
+#include <QPixmapCache>
 
 
  
 namespace core {
+// Decoded tiles are 256x256 ARGB32. The working set is what a large screen
+// shows with every overlay layer plus the ring around it that panning and
+// zooming by one level bring in, about 400 tiles.
+static const int TILE_SIZE_KB = 256 * 256 * 4 / 1024;
+static const int TILE_CACHE_TILES = 400;
+
 PureImageProxy::PureImageProxy()
 {
 
@@ -39,6 +46,36 @@ QPixmap PureImageProxy::FromStream(const QByteArray &array)
 {
     return QPixmap::fromImage(QImage::fromData(array));
 }
+/**
+ * @brief Returns the decoded pixmap of a tile, decoding it only on a cache miss
+ * Decoded pixmaps are kept in the QPixmapCache LRU so redrawing an already
+ * visible tile does not decode its compressed image again. Only call this
+ * from the GUI thread.
+ * @param array compressed tile image
+ * @param tile identity of the tile
+ * @param layer index of the overlay within the tile
+ */
+QPixmap PureImageProxy::FromStream(const QByteArray &array, RawTile tile, const int &layer)
+{
+    QString key=QString("tile:%1:%2:%3:%4:%5").arg(tile.Type()).arg(tile.Zoom()).arg(tile.Pos().X()).arg(tile.Pos().Y()).arg(layer);
+    QPixmap pic;
+    if(!QPixmapCache::find(key,&pic))
+    {
+        pic=FromStream(array);
+        QPixmapCache::insert(key,pic);
+    }
+    return pic;
+}
+/**
+ * @brief Grows the QPixmapCache limit to hold the tile working set
+ * The cache is shared with the rest of the GCS, so a larger limit set by
+ * someone else is kept.
+ */
+void PureImageProxy::ReserveCache()
+{
+    if(QPixmapCache::cacheLimit()<TILE_CACHE_TILES*TILE_SIZE_KB)
+        QPixmapCache::setCacheLimit(TILE_CACHE_TILES*TILE_SIZE_KB);
+}
 bool PureImageProxy::Save(const QByteArray &array, QPixmap &pic)
 {
     pic=QPixmap::fromImage(QImage::fromData(array));
@@ -30,6 +30,7 @@
 
 #include <QPixmap>
 #include <QByteArray>
+#include "rawtile.h"
 
 
 namespace core {
@@ -38,6 +39,8 @@ namespace core {
     public:
         PureImageProxy();
         static QPixmap FromStream(const QByteArray &array);
+        static QPixmap FromStream(const QByteArray &array, RawTile tile, const int &layer);
+        static void ReserveCache();
         static bool Save(const QByteArray &array,QPixmap &pic);
     };
 
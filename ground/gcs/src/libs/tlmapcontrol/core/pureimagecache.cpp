@@ -32,7 +32,73 @@
 namespace core {
     qlonglong PureImageCache::ConnCounter=0;
 
-    PureImageCache::PureImageCache()
+    /**
+     * @brief Long lived SQLite connection owned by a single thread
+     *
+     * QSqlDatabase handles may only be used from the thread that created them,
+     * so every thread touching the tile cache gets its own connection which is
+     * kept open, together with its prepared statements, until the thread exits
+     * or the cache location changes.
+     */
+    class PureImageCacheConnection
+    {
+    public:
+        PureImageCacheConnection(const QString &file, const int &generation, const qlonglong &id);
+        ~PureImageCacheConnection();
+        bool IsOpen(){return open;}
+        int Generation(){return generation;}
+        QSqlDatabase db;
+        QSqlQuery *selectTile;
+        QSqlQuery *insertTile;
+        QSqlQuery *insertTileData;
+    private:
+        QString name;
+        int generation;
+        bool open;
+    };
+
+    PureImageCacheConnection::PureImageCacheConnection(const QString &file, const int &generation, const qlonglong &id):
+        selectTile(0),insertTile(0),insertTileData(0),name(QString("PureImageCache%1").arg(id)),generation(generation),open(false)
+    {
+        db = QSqlDatabase::addDatabase("QSQLITE",name);
+        db.setDatabaseName(file);
+        if(!db.open())
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"PureImageCacheConnection: Unable to open database"<<file;
+#endif //DEBUG_PUREIMAGECACHE
+            return;
+        }
+        {
+            QSqlQuery query(db);
+            // WAL lets the tile loader threads read while the cache queue writes
+            query.exec("PRAGMA journal_mode=WAL");
+            query.exec("PRAGMA synchronous=NORMAL");
+            // Databases created by older versions lack the lookup index
+            query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (Type, Zoom, X, Y)");
+        }
+        selectTile = new QSqlQuery(db);
+        selectTile->setForwardOnly(true);
+        selectTile->prepare("SELECT TilesData.Tile FROM Tiles INNER JOIN TilesData ON TilesData.id = Tiles.id "
+                            "WHERE Tiles.Type=? AND Tiles.Zoom=? AND Tiles.X=? AND Tiles.Y=? LIMIT 1");
+        insertTile = new QSqlQuery(db);
+        insertTile->prepare("INSERT INTO Tiles(X, Y, Zoom, Type, Date) VALUES(?, ?, ?, ?, ?)");
+        insertTileData = new QSqlQuery(db);
+        insertTileData->prepare("INSERT INTO TilesData(id, Tile) VALUES(?, ?)");
+        open=true;
+    }
+
+    PureImageCacheConnection::~PureImageCacheConnection()
+    {
+        delete selectTile;
+        delete insertTile;
+        delete insertTileData;
+        db.close();
+        db=QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
+
+    PureImageCache::PureImageCache():generation(0)
     {
 
     }
@@ -41,6 +107,8 @@ namespace core {
     {
         lock.lockForWrite();
         gtilecache=value;
+        // Existing per thread connections point to the old location
+        ++generation;
         QDir d;
         if(!d.exists(gtilecache))
         {
@@ -66,6 +134,24 @@ namespace core {
         return gtilecache;
     }
 
+    /**
+     * @brief Returns the connection of the calling thread, opening it if needed
+     * Must be called with the lock held
+     */
+    PureImageCacheConnection* PureImageCache::Connection()
+    {
+        PureImageCacheConnection *cn=connections.hasLocalData() ? connections.localData() : 0;
+        if(cn!=0 && cn->Generation()==generation)
+            return cn;
+        Mcounter.lock();
+        qlonglong id=++ConnCounter;
+        Mcounter.unlock();
+        cn=new PureImageCacheConnection(gtilecache+"Data.qmdb",generation,id);
+        // QThreadStorage deletes the previous connection, if any
+        connections.setLocalData(cn);
+        return cn;
+    }
+
 
     bool PureImageCache::CreateEmptyDB(const QString &file)
     {
@@ -110,6 +196,15 @@ namespace core {
             {
 #ifdef DEBUG_PUREIMAGECACHE
                 qDebug()<<"CreateEmptyDB: "<<query.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                db.close();
+                return false;
+            }
+            query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (Type, Zoom, X, Y)");
+            if(query.numRowsAffected()==-1)
+            {
+#ifdef DEBUG_PUREIMAGECACHE
+                qDebug()<<"CreateEmptyDB: "<<query.lastError().driverText();
 #endif //DEBUG_PUREIMAGECACHE
                 db.close();
                 return false;
@@ -173,87 +268,96 @@ namespace core {
         return true;
     }
     bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        CacheItemQueue item(type,pos,tile,zoom);
+        QList<CacheItemQueue*> tiles;
+        tiles.append(&item);
+        return PutImagesToCache(tiles);
+    }
+    /**
+     * @brief Stores a batch of tiles in a single transaction
+     * @param tiles tiles to store, ownership stays with the caller
+     * @return true if the transaction was committed
+     */
+    bool PureImageCache::PutImagesToCache(QList<CacheItemQueue*> const& tiles)
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return false;
         lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"PutImageToCache Start:";//<<pos;
+        qDebug()<<"PutImagesToCache Start:"<<tiles.count();
 #endif //DEBUG_PUREIMAGECACHE
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        PureImageCacheConnection *cn=Connection();
+        if(!cn->IsOpen() || !cn->db.transaction())
         {
-            QSqlDatabase cn;
-            cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-            QString db=gtilecache+"Data.qmdb";
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if(cn.open())
+            lock.unlock();
+            return false;
+        }
+        QString date=QDateTime::currentDateTime().toString();
+        foreach(CacheItemQueue *task,tiles)
+        {
+            cn->insertTile->bindValue(0,task->GetPosition().X());
+            cn->insertTile->bindValue(1,task->GetPosition().Y());
+            cn->insertTile->bindValue(2,task->GetZoom());
+            cn->insertTile->bindValue(3,(int)task->GetMapType());
+            cn->insertTile->bindValue(4,date);
+            if(!cn->insertTile->exec())
             {
+#ifdef DEBUG_PUREIMAGECACHE
+                qDebug()<<"PutImagesToCache: "<<cn->insertTile->lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                continue;
+            }
+            QVariant id=cn->insertTile->lastInsertId();
+            cn->insertTileData->bindValue(0,id);
+            cn->insertTileData->bindValue(1,task->GetImg());
+            if(!cn->insertTileData->exec())
+            {
+#ifdef DEBUG_PUREIMAGECACHE
+                qDebug()<<"PutImagesToCache: "<<cn->insertTileData->lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                // Don't leave a Tiles row behind without its data
+                QSqlQuery query(cn->db);
+                query.prepare("DELETE FROM Tiles WHERE id = ?");
+                query.bindValue(0,id);
+                if(!query.exec())
                 {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                    query.addBindValue(pos.X());
-                    query.addBindValue(pos.Y());
-                    query.addBindValue(zoom);
-
-                    query.addBindValue((int)type);
-                    query.addBindValue(QDateTime::currentDateTime().toString());
-                    query.exec();
-                }
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                    query.addBindValue(tile);
-                    query.exec();
+#ifdef DEBUG_PUREIMAGECACHE
+                    qDebug()<<"PutImagesToCache: "<<query.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                    cn->db.rollback();
+                    lock.unlock();
+                    return false;
                 }
-                cn.close();
             }
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
+        bool ret=cn->db.commit();
+        if(!ret)
+            cn->db.rollback();
         lock.unlock();
-        return true;
+        return ret;
     }
     QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
     {
-        lock.lockForRead();
         QByteArray ar;
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return ar;
-        QString dir=gtilecache;
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"Cache dir="<<dir<<" Try to GET:"<<pos.X()+","+pos.Y();
+        qDebug()<<"Cache dir="<<gtilecache<<" Try to GET:"<<pos.X()+","+pos.Y();
 #endif //DEBUG_PUREIMAGECACHE
-
+        PureImageCacheConnection *cn=Connection();
+        if(cn->IsOpen())
         {
-            QString db=dir+"Data.qmdb";
-            {
-                QSqlDatabase cn;
-
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int) type));
-                        query.next();
-                        if(query.isValid())
-                        {
-                            ar=query.value(0).toByteArray();
-                        }
-                    }
-                    cn.close();
-                }
-            }
+            cn->selectTile->bindValue(0,(int)type);
+            cn->selectTile->bindValue(1,zoom);
+            cn->selectTile->bindValue(2,pos.X());
+            cn->selectTile->bindValue(3,pos.Y());
+            if(cn->selectTile->exec() && cn->selectTile->next())
+                ar=cn->selectTile->value(0).toByteArray();
+            // Release the statement so it does not hold a read snapshot open
+            cn->selectTile->finish();
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
         lock.unlock();
         return ar;
     }
@@ -261,42 +365,37 @@ namespace core {
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return;
-        QList<long> add;
-        bool ret=true;
-        QString dir=gtilecache;
+        if(!QFileInfo(gtilecache+"Data.qmdb").exists())
+            return;
+        QList<qlonglong> add;
+        lock.lockForRead();
+        PureImageCacheConnection *cn=Connection();
+        if(cn->IsOpen())
         {
-            QString db=dir+"Data.qmdb";
-            ret=QFileInfo(db).exists();
-            if(ret)
             {
-                QSqlDatabase cn;
-                Mcounter.lock();
-                qlonglong id=++ConnCounter;
-                Mcounter.unlock();
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
+                QSqlQuery query(cn->db);
+                query.setForwardOnly(true);
+                query.exec(QString("SELECT id, Date FROM Tiles"));
+                while(query.next())
                 {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                        while(query.next())
-                        {
-                            if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
-                                add.append(query.value(0).toLongLong());
-                        }
-                        foreach(long i,add)
-                        {
-                            query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                        }
-                    }
-
-                    cn.close();
+                    if(QDateTime::fromString(query.value(1).toString()).daysTo(QDateTime::currentDateTime())>days)
+                        add.append(query.value(0).toLongLong());
+                }
+            }
+            if(!add.isEmpty() && cn->db.transaction())
+            {
+                QSqlQuery query(cn->db);
+                query.prepare("DELETE FROM Tiles WHERE id = ?");
+                foreach(qlonglong i,add)
+                {
+                    query.bindValue(0,i);
+                    query.exec();
                 }
-                QSqlDatabase::removeDatabase(QString::number(id));
+                if(!cn->db.commit())
+                    cn->db.rollback();
             }
         }
+        lock.unlock();
     }
     // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
     bool PureImageCache::ExportMapDataToDB(QString sourceFile, QString destFile)
@@ -43,7 +43,11 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include "cacheitemqueue.h"
 namespace core {
+    class PureImageCacheConnection;
+
     class PureImageCache
     {
 
@@ -51,15 +55,19 @@ namespace core {
         PureImageCache();
         static bool CreateEmptyDB(const QString &file);
         bool PutImageToCache(const QByteArray &tile,const MapType::Types &type,const core::Point &pos, const int &zoom);
+        bool PutImagesToCache(QList<CacheItemQueue*> const& tiles);
         QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
         QString GtileCache();
         void setGtileCache(const QString &value);
         static bool ExportMapDataToDB(QString sourceFile, QString destFile);
         void deleteOlderTiles(int const& days);
     private:
+        PureImageCacheConnection* Connection();
         QString gtilecache;
+        int generation;
         QMutex Mcounter;
         QReadWriteLock lock;
+        QThreadStorage<PureImageCacheConnection*> connections;
         static qlonglong ConnCounter;
 
     };
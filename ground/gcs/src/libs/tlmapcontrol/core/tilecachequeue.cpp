@@ -80,21 +80,22 @@ void TileCacheQueue::run()
 #endif //DEBUG_TILECACHEQUEUE
     while(true)
     {
-        CacheItemQueue *task;
 #ifdef DEBUG_TILECACHEQUEUE
         qDebug()<<"Cache";
 #endif //DEBUG_TILECACHEQUEUE
         if(tileCacheQueue.count()>0)
         {
+            // Drain whatever is pending so it is written in one transaction
+            QList<CacheItemQueue*> batch;
             mutex.lock();
-            task=tileCacheQueue.dequeue();
+            while(tileCacheQueue.count()>0 && batch.count()<MaxBatchSize)
+                batch.append(tileCacheQueue.dequeue());
             mutex.unlock();
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
+            qDebug()<<"Cache engine Put:"<<batch.count()<<"tiles";
 #endif //DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
-            usleep(44);
-            delete task;
+            Cache::Instance()->ImageCache.PutImagesToCache(batch);
+            qDeleteAll(batch);
         }
 
         else
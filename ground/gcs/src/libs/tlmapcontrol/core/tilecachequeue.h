@@ -51,6 +51,7 @@ namespace core {
     protected:
         QQueue<CacheItemQueue*> tileCacheQueue;
     private:
+        static const int MaxBatchSize = 64;
         void run();
         QMutex mutex;
         QMutex waitmutex;
@@ -368,14 +368,15 @@ namespace mapcontrol
                             //lock(t.Overlays)
                             if(t!=0)
                             {
-                                foreach(QByteArray img,t->Overlays)
+                                for(int layer = 0; layer < t->Overlays.count(); layer++)
                                 {
+                                    QByteArray img = t->Overlays.at(layer);
                                     if(img.count()!=0)
                                     {
                                         if(!found)
                                             found = true;
                                         {
-                                            painter->drawPixmap(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(),PureImageProxy::FromStream(img));
+                                            painter->drawPixmap(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(),PureImageProxy::FromStream(img,RawTile(core->GetMapType(),t->GetPos(),t->GetZoom()),layer));
                                         }
                                     }
                                 }
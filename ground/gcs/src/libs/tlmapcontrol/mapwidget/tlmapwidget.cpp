@@ -30,6 +30,7 @@
 #include <QtGui>
 #include <QMetaObject>
 #include "waypointitem.h"
+#include "../core/pureimage.h"
 
 namespace mapcontrol
 {
@@ -67,7 +68,7 @@ namespace mapcontrol
         this->setMouseTracking(followmouse);
         SetShowCompassRose(true);
         SetShowWindCompass(false);
-        QPixmapCache::setCacheLimit(64*1024);
+        core::PureImageProxy::ReserveCache();
 
         this->adjustSize();
     }
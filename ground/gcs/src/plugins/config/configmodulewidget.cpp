@@ -306,6 +306,7 @@ ConfigModuleWidget::ConfigModuleWidget(QWidget *parent) : ConfigTaskWidget(paren
     addUAVObjectToWidgetRelation(picoCSettingsName, "Startup", ui->cb_picocStartup);
     addUAVObjectToWidgetRelation(picoCSettingsName, "Source", ui->cb_picocSource);
     addUAVObjectToWidgetRelation(picoCSettingsName, "ComSpeed", ui->cb_picocComSpeed);
+    addUAVObjectToWidgetRelation(picoCSettingsName, "TimeSlice", ui->sb_picocTimeSlice);
 
     // Connect Airspeed Settings
     addUAVObjectToWidgetRelation(airspeedSettingsName, "AirspeedSensorType", ui->cb_airspeedSensorType);
@@ -161,6 +161,12 @@ plugin_picoc.depends = plugin_coreplugin
 plugin_picoc.depends += plugin_uavobjects
 SUBDIRS += plugin_picoc
 
+# Trace timeline gadget
+plugin_tracetimeline.subdir = tracetimeline
+plugin_tracetimeline.depends = plugin_coreplugin
+plugin_tracetimeline.depends += plugin_uavobjects
+SUBDIRS += plugin_tracetimeline
+
 # Telemetry Scheduler gadget
 plugin_telemetryscheduler.subdir = telemetryscheduler
 plugin_telemetryscheduler.depends = plugin_coreplugin
@@ -0,0 +1,20 @@
+QT += widgets
+TEMPLATE = lib
+TARGET = TraceTimeline
+
+include(../../taulabsgcsplugin.pri)
+include(../../plugins/coreplugin/coreplugin.pri)
+include(tracetimeline_dependencies.pri)
+
+HEADERS += tracetimelineplugin.h
+HEADERS += tracetimelinegadget.h
+HEADERS += tracetimelinegadgetfactory.h
+HEADERS += tracetimelinewidget.h
+
+SOURCES += tracetimelineplugin.cpp
+SOURCES += tracetimelinegadget.cpp
+SOURCES += tracetimelinegadgetfactory.cpp
+SOURCES += tracetimelinewidget.cpp
+
+OTHER_FILES += TraceTimeline.pluginspec
+OTHER_FILES += TraceTimeline.json
@@ -0,0 +1,52 @@
+/**
+ ******************************************************************************
+ * @file       tracetimelinegadgetfactory.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup TraceTimelinePlugin Trace Timeline Plugin
+ * @{
+ * @brief Shows the flight controller trace buffer on a timeline
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "tracetimelinegadgetfactory.h"
+#include "tracetimelinewidget.h"
+#include "tracetimelinegadget.h"
+#include <coreplugin/iuavgadget.h>
+
+TraceTimelineGadgetFactory::TraceTimelineGadgetFactory(QObject *parent) :
+        IUAVGadgetFactory(QString("TraceTimeline"),
+                          tr("Trace Timeline"),
+                          parent)
+{
+}
+
+TraceTimelineGadgetFactory::~TraceTimelineGadgetFactory()
+{
+
+}
+
+IUAVGadget* TraceTimelineGadgetFactory::createGadget(QWidget *parent) {
+    TraceTimelineWidget* gadgetWidget = new TraceTimelineWidget(parent);
+    return new TraceTimelineGadget(QString("TraceTimeline"), gadgetWidget, parent);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,349 @@
+/**
+ ******************************************************************************
+ * @file       tracetimelinewidget.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup TraceTimelinePlugin Trace Timeline Plugin
+ * @{
+ * @brief Shows the flight controller trace buffer on a timeline
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "tracetimelinewidget.h"
+
+#include "extensionsystem/pluginmanager.h"
+#include "uavobjectmanager.h"
+#include "tracedata.h"
+#include "tracecontrol.h"
+
+#include <QEvent>
+#include <QHBoxLayout>
+#include <QHelpEvent>
+#include <QLabel>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPushButton>
+#include <QToolTip>
+#include <QVBoxLayout>
+#include <QWheelEvent>
+#include <QtMath>
+
+static const int LANE_HEIGHT = 24;
+static const int LABEL_WIDTH = 110;
+static const int AXIS_HEIGHT = 20;
+
+TraceTimelineView::TraceTimelineView(QWidget *parent) : QWidget(parent),
+    m_start(0), m_scale(1), m_dragX(0)
+{
+    setMinimumSize(200, 100);
+    setSizePolicy(QSizePolicy::MinimumExpanding, QSizePolicy::MinimumExpanding);
+    setMouseTracking(true);
+}
+
+/**
+ * Show a new trace
+ * @param events the events, oldest first
+ * @param names the name of each event id
+ */
+void TraceTimelineView::setTrace(const QList<TraceEvent> &events, const QStringList &names)
+{
+    m_events = events;
+    m_names = names;
+    m_lanes.clear();
+    m_eventLane.clear();
+    m_eventStart.clear();
+    m_eventEnd.clear();
+
+    foreach (QString name, names) {
+        bool start = name.endsWith("Start");
+        bool end = name.endsWith("End");
+        QString lane = name;
+        if (start)
+            lane.chop(5);
+        else if (end)
+            lane.chop(3);
+
+        if (!m_lanes.contains(lane))
+            m_lanes.append(lane);
+
+        m_eventLane.append(m_lanes.indexOf(lane));
+        m_eventStart.append(start);
+        m_eventEnd.append(end);
+    }
+
+    resetView();
+}
+
+int TraceTimelineView::laneOf(quint8 id) const
+{
+    if (id >= m_eventLane.size())
+        return -1;
+
+    return m_eventLane[id];
+}
+
+double TraceTimelineView::timeToX(double time) const
+{
+    return LABEL_WIDTH + (time - m_start) * m_scale;
+}
+
+double TraceTimelineView::xToTime(double x) const
+{
+    return m_start + (x - LABEL_WIDTH) / m_scale;
+}
+
+//! Fit the whole trace in the view
+void TraceTimelineView::resetView()
+{
+    m_start = 0;
+    m_scale = 1;
+
+    if (!m_events.isEmpty() && m_events.last().time > 0)
+        m_scale = (width() - LABEL_WIDTH - 10) / (double) m_events.last().time;
+
+    update();
+}
+
+void TraceTimelineView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+
+    if (m_events.isEmpty()) {
+        painter.drawText(rect(), Qt::AlignCenter, tr("No trace, press Capture to read the trace buffer"));
+        return;
+    }
+
+    // Lanes with their names
+    for (int i = 0; i < m_lanes.size(); i++) {
+        int y = AXIS_HEIGHT + i * LANE_HEIGHT;
+        if (i % 2)
+            painter.fillRect(0, y, width(), LANE_HEIGHT, palette().alternateBase());
+        painter.setPen(palette().text().color());
+        painter.drawText(4, y, LABEL_WIDTH - 8, LANE_HEIGHT, Qt::AlignVCenter | Qt::AlignLeft, m_lanes[i]);
+    }
+
+    painter.setClipRect(LABEL_WIDTH, 0, width() - LABEL_WIDTH, height());
+
+    // Time axis with about one tick every 100 pixels
+    double step = 1;
+    while (step * m_scale < 100)
+        step *= 10;
+    painter.setPen(palette().mid().color());
+    for (double t = qFloor(xToTime(LABEL_WIDTH) / step) * step; timeToX(t) < width(); t += step) {
+        int x = timeToX(t);
+        painter.drawLine(x, AXIS_HEIGHT, x, AXIS_HEIGHT + m_lanes.size() * LANE_HEIGHT);
+        painter.drawText(x + 2, 0, 100, AXIS_HEIGHT, Qt::AlignVCenter | Qt::AlignLeft,
+                         QString("%1 ms").arg(t / 1000.0));
+    }
+
+    // Bars from xxxStart to the next xxxEnd, ticks for everything else
+    QVector<int> openSince(m_lanes.size(), -1);
+    for (int i = 0; i < m_events.size(); i++) {
+        const TraceEvent &ev = m_events[i];
+        int lane = laneOf(ev.id);
+        if (lane < 0)
+            continue;
+
+        int y = AXIS_HEIGHT + lane * LANE_HEIGHT;
+        QColor color = QColor::fromHsv((lane * 67) % 360, 160, 200);
+
+        if (m_eventStart[ev.id]) {
+            openSince[lane] = i;
+        } else if (m_eventEnd[ev.id]) {
+            if (openSince[lane] >= 0) {
+                double x0 = timeToX(m_events[openSince[lane]].time);
+                double x1 = timeToX(ev.time);
+                painter.fillRect(QRectF(x0, y + 4, qMax(x1 - x0, 1.0), LANE_HEIGHT - 8), color);
+            }
+            openSince[lane] = -1;
+        } else {
+            painter.setPen(color.darker());
+            int x = timeToX(ev.time);
+            painter.drawLine(x, y + 3, x, y + LANE_HEIGHT - 3);
+        }
+    }
+}
+
+void TraceTimelineView::wheelEvent(QWheelEvent *event)
+{
+    // Zoom around the mouse pointer
+    double time = xToTime(event->pos().x());
+    m_scale *= event->delta() > 0 ? 1.25 : 0.8;
+    m_start = time - (event->pos().x() - LABEL_WIDTH) / m_scale;
+    update();
+}
+
+void TraceTimelineView::mousePressEvent(QMouseEvent *event)
+{
+    m_dragX = event->pos().x();
+}
+
+void TraceTimelineView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!(event->buttons() & Qt::LeftButton))
+        return;
+
+    m_start -= (event->pos().x() - m_dragX) / m_scale;
+    m_dragX = event->pos().x();
+    update();
+}
+
+void TraceTimelineView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    Q_UNUSED(event);
+    resetView();
+}
+
+//! Show the event closest to the pointer as tooltip
+bool TraceTimelineView::event(QEvent *event)
+{
+    if (event->type() != QEvent::ToolTip)
+        return QWidget::event(event);
+
+    QHelpEvent *help = static_cast<QHelpEvent *>(event);
+    int lane = (help->pos().y() - AXIS_HEIGHT) / LANE_HEIGHT;
+    double time = xToTime(help->pos().x());
+
+    int best = -1;
+    double bestDistance = 5 / m_scale;
+    for (int i = 0; i < m_events.size(); i++) {
+        double distance = qAbs(m_events[i].time - time);
+        if (laneOf(m_events[i].id) == lane && distance < bestDistance) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+
+    if (best < 0) {
+        QToolTip::hideText();
+        event->ignore();
+        return true;
+    }
+
+    const TraceEvent &ev = m_events[best];
+    QToolTip::showText(help->globalPos(), tr("%1 at %2 us, data %3 (0x%4)")
+                       .arg(m_names.value(ev.id)).arg(ev.time).arg(ev.data)
+                       .arg(ev.data, 8, 16, QChar('0')));
+    return true;
+}
+
+TraceTimelineWidget::TraceTimelineWidget(QWidget *parent) : QWidget(parent),
+    m_reading(false)
+{
+    m_view = new TraceTimelineView(this);
+    m_captureButton = new QPushButton(tr("Capture"), this);
+    m_resumeButton = new QPushButton(tr("Resume"), this);
+    m_status = new QLabel(this);
+
+    QHBoxLayout *buttons = new QHBoxLayout();
+    buttons->addWidget(m_captureButton);
+    buttons->addWidget(m_resumeButton);
+    buttons->addWidget(m_status, 1);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(buttons);
+    layout->addWidget(m_view, 1);
+
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    m_traceData = TraceData::GetInstance(objManager);
+    m_traceControl = TraceControl::GetInstance(objManager);
+    Q_ASSERT(m_traceData && m_traceControl);
+
+    connect(m_traceData, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(traceDataUpdated(UAVObject*)));
+    connect(m_captureButton, SIGNAL(clicked()), this, SLOT(capture()));
+    connect(m_resumeButton, SIGNAL(clicked()), this, SLOT(resume()));
+
+    setToolTip(tr("Order and timing of the flight controller tasks. Scroll to zoom, drag to move and double click to see the whole trace."));
+}
+
+TraceTimelineWidget::~TraceTimelineWidget()
+{
+   // Do nothing
+}
+
+void TraceTimelineWidget::sendOperation(quint8 operation, quint16 chunk)
+{
+    TraceControl::DataFields control = m_traceControl->getData();
+    control.Operation = operation;
+    control.Chunk = chunk;
+    m_traceControl->setData(control);
+    m_traceControl->updated();
+}
+
+/**
+ * Freeze the trace, the flight side answers with the first chunk and
+ * each chunk that arrives requests the next one
+ */
+void TraceTimelineWidget::capture()
+{
+    m_events.clear();
+    m_reading = true;
+    m_status->setText(tr("Reading trace..."));
+    sendOperation(TraceControl::OPERATION_FREEZE, 0);
+}
+
+//! Clear the trace on the flight side and record again
+void TraceTimelineWidget::resume()
+{
+    m_reading = false;
+    m_status->clear();
+    sendOperation(TraceControl::OPERATION_RESUME, 0);
+}
+
+void TraceTimelineWidget::traceDataUpdated(UAVObject *obj)
+{
+    Q_UNUSED(obj);
+
+    if (!m_reading)
+        return;
+
+    TraceData::DataFields data = m_traceData->getData();
+    int count = data.Count;
+
+    // Chunks arrive in order, ignore repeats of an older one
+    if (data.Index != m_events.size())
+        return;
+
+    for (quint32 i = 0; i < TraceData::EVENT_NUMELEM && m_events.size() < count; i++) {
+        TraceEvent ev;
+        ev.time = data.Time[i];
+        ev.id = data.Event[i];
+        ev.data = data.Data[i];
+        m_events.append(ev);
+    }
+
+    if (m_events.size() < count) {
+        m_status->setText(tr("Reading trace %1/%2").arg(m_events.size()).arg(count));
+        sendOperation(TraceControl::OPERATION_READ, m_events.size() / TraceData::EVENT_NUMELEM);
+        return;
+    }
+
+    m_reading = false;
+    m_status->setText(tr("%1 events over %2 ms").arg(m_events.size())
+                      .arg(m_events.isEmpty() ? 0 : m_events.last().time / 1000.0));
+    m_view->setTrace(m_events, m_traceData->getField("Event")->getOptions());
+}
+
+/**
+ * @}
+ * @}
+ */
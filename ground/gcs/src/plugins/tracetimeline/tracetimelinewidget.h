@@ -0,0 +1,118 @@
+/**
+ ******************************************************************************
+ * @file       tracetimelinewidget.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup TraceTimelinePlugin Trace Timeline Plugin
+ * @{
+ * @brief Shows the flight controller trace buffer on a timeline
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef TRACETIMELINEWIDGET_H_
+#define TRACETIMELINEWIDGET_H_
+
+#include <QWidget>
+#include <QList>
+#include <QStringList>
+
+class QLabel;
+class QPushButton;
+class UAVObject;
+class TraceData;
+class TraceControl;
+
+//! One event read from the trace buffer
+struct TraceEvent {
+    quint32 time;   // us since the oldest event
+    quint8 id;
+    quint32 data;
+};
+
+/**
+ * Draws the events with one lane per task. Events named xxxStart and
+ * xxxEnd are drawn as a bar in lane xxx, all others as ticks.
+ */
+class TraceTimelineView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    TraceTimelineView(QWidget *parent = 0);
+
+    void setTrace(const QList<TraceEvent> &events, const QStringList &names);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void wheelEvent(QWheelEvent *event);
+    void mousePressEvent(QMouseEvent *event);
+    void mouseMoveEvent(QMouseEvent *event);
+    void mouseDoubleClickEvent(QMouseEvent *event);
+    bool event(QEvent *event);
+
+private:
+    int laneOf(quint8 id) const;
+    double timeToX(double time) const;
+    double xToTime(double x) const;
+    void resetView();
+
+    QList<TraceEvent> m_events;
+    QStringList m_names;
+    QStringList m_lanes;
+    QList<int> m_eventLane;     // lane of each event id
+    QList<bool> m_eventStart;   // event id starts a bar
+    QList<bool> m_eventEnd;     // event id ends a bar
+
+    double m_start;             // time at the left edge in us
+    double m_scale;             // pixels per us
+    int m_dragX;
+};
+
+class TraceTimelineWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    TraceTimelineWidget(QWidget *parent = 0);
+   ~TraceTimelineWidget();
+
+private slots:
+    void capture();
+    void resume();
+    void traceDataUpdated(UAVObject *obj);
+
+private:
+    void sendOperation(quint8 operation, quint16 chunk);
+
+    TraceData *m_traceData;
+    TraceControl *m_traceControl;
+    TraceTimelineView *m_view;
+    QPushButton *m_captureButton;
+    QPushButton *m_resumeButton;
+    QLabel *m_status;
+
+    bool m_reading;
+    QList<TraceEvent> m_events;
+};
+
+#endif /* TRACETIMELINEWIDGET_H_ */
+
+/**
+ * @}
+ * @}
+ */
@@ -56,7 +56,7 @@ bool HighLightManager::add(TreeItem *itemToAdd)
     // Check so that the item isn't already in the list
     if(!m_itemsList.contains(itemToAdd))
     {
-        m_itemsList.append(itemToAdd);
+        m_itemsList.insert(itemToAdd);
         return true;
     }
     return false;
@@ -72,7 +72,41 @@ bool HighLightManager::remove(TreeItem *itemToRemove)
     QMutexLocker locker(&m_listMutex);
 
     // Remove item and return result
-    return m_itemsList.removeOne(itemToRemove);
+    return m_itemsList.remove(itemToRemove);
+}
+
+/*
+ * Called when the display of an item changed. The item is
+ * repainted on the next refresh tick of the model.
+ */
+void HighLightManager::markDirty(TreeItem *item)
+{
+    QMutexLocker locker(&m_dirtyMutex);
+    m_dirtyItems.insert(item);
+}
+
+/*
+ * Returns all items marked dirty since the last call.
+ */
+QSet<TreeItem*> HighLightManager::takeDirtyItems()
+{
+    QMutexLocker locker(&m_dirtyMutex);
+    QSet<TreeItem*> dirty = m_dirtyItems;
+    m_dirtyItems.clear();
+    return dirty;
+}
+
+/*
+ * Called when an item is destroyed so no dangling pointer is kept.
+ */
+void HighLightManager::forget(TreeItem *item)
+{
+    {
+        QMutexLocker locker(&m_listMutex);
+        m_itemsList.remove(item);
+    }
+    QMutexLocker locker(&m_dirtyMutex);
+    m_dirtyItems.remove(item);
 }
 
 /*
@@ -87,7 +121,7 @@ void HighLightManager::checkItemsExpired()
     QMutexLocker locker(&m_listMutex);
 
     // Get a mutable iterator for the list
-    QMutableLinkedListIterator<TreeItem*> iter(m_itemsList);
+    QMutableSetIterator<TreeItem*> iter(m_itemsList);
 
     // Loop over all items, check if they expired.
     while(iter.hasNext())
@@ -114,7 +148,9 @@ TreeItem::TreeItem(const QList<QVariant> &data, TreeItem *parent) :
         m_parent(parent),
         m_highlight(false),
         m_changed(false),
-        m_updated(false)
+        m_updated(false),
+        m_expanded(false),
+        m_highlightManager(NULL)
 {
 }
 
@@ -124,13 +160,17 @@ TreeItem::TreeItem(const QVariant &data, TreeItem *parent) :
         m_parent(parent),
         m_highlight(false),
         m_changed(false),
-        m_updated(false)
+        m_updated(false),
+        m_expanded(false),
+        m_highlightManager(NULL)
 {
     m_data << data << "" << "";
 }
 
 TreeItem::~TreeItem()
 {
+    if (m_highlightManager)
+        m_highlightManager->forget(this);
     qDeleteAll(m_children);
 }
 
@@ -211,14 +251,14 @@ void TreeItem::setHighlight(bool highlight) {
         // Add to highlightmanager
         if(m_highlightManager->add(this))
         {
-            // Only emit signal if it was added
-            emit updateHighlight(this);
+            // Only repaint if it was added
+            m_highlightManager->markDirty(this);
         }
     }
     else if(m_highlightManager->remove(this))
     {
-        // Only emit signal if it was removed
-        emit updateHighlight(this);
+        // Only repaint if it was removed
+        m_highlightManager->markDirty(this);
     }
 
     // If we have a parent, call recursively to update highlight status of parents.
@@ -259,7 +299,7 @@ void TreeItem::setUpdatedOnlyParent()
 void TreeItem::removeHighlight() {
     m_highlight = false;
     //update();
-    emit updateHighlight(this);
+    m_highlightManager->markDirty(this);
 }
 
 void TreeItem::setHighlightManager(HighLightManager *mgr)
@@ -279,6 +319,16 @@ void TreeItem::setCurrentTime(QTime *currentTime)
     m_currentTime = currentTime;
 }
 
+bool TreeItem::childrenVisible()
+{
+    // The root item is never shown, all others must be expanded
+    for (TreeItem *item = this; item->parent(); item = item->parent()) {
+        if (!item->isExpanded())
+            return false;
+    }
+    return true;
+}
+
 QList<MetaObjectTreeItem *> TopTreeItem::getMetaObjectItems()
 {
     return m_metaObjectTreeItemsPerObjectIds.values();
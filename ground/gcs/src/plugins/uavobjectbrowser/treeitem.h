@@ -34,7 +34,7 @@
 #include "uavmetaobject.h"
 #include "uavobjectfield.h"
 #include <QtCore/QList>
-#include <QtCore/QLinkedList>
+#include <QtCore/QSet>
 #include <QtCore/QMap>
 #include <QtCore/QVariant>
 #include <QtCore/QTime>
@@ -58,6 +58,9 @@ class TreeItem;
 * Items that are updated during the expiration time are
 * left untouched in the list. This reduces unwanted emits
 * of signals to the repaint/update function.
+* Items whose display changed are collected in a dirty set
+* which the model drains once per refresh tick, so the view
+* receives batched updates instead of one signal per item.
 */
 class HighLightManager : public QObject
 {
@@ -73,6 +76,15 @@ public:
     //This is called when an item is set to highlighted = false;
     bool remove(TreeItem* itemToRemove);
 
+    // This is called when the display of an item has changed.
+    void markDirty(TreeItem* item);
+
+    // Returns the items changed since the last call and clears the set.
+    QSet<TreeItem*> takeDirtyItems();
+
+    // This is called when an item is destroyed.
+    void forget(TreeItem* item);
+
 private slots:
     // Timer callback method.
     void checkItemsExpired();
@@ -81,12 +93,18 @@ private:
     // The timer checking highlight expiration.
     QTimer m_expirationTimer;
 
-    // The list holding all items due to be updated.
-    QLinkedList<TreeItem*> m_itemsList;
+    // The set holding all items due to be updated.
+    QSet<TreeItem*> m_itemsList;
 
     //Mutex to lock when accessing list.
     QMutex m_listMutex;
 
+    // The set holding all items to be repainted on the next refresh tick.
+    QSet<TreeItem*> m_dirtyItems;
+
+    //Mutex to lock when accessing the dirty set.
+    QMutex m_dirtyMutex;
+
     // This is the timestamp to compare with
     static QTime *m_currentTime;
 };
@@ -169,8 +187,10 @@ public:
 
     void setCurrentTime(QTime *currentTime);
 
-signals:
-    void updateHighlight(TreeItem*);
+    inline bool isExpanded() { return m_expanded; }
+    inline void setExpanded(bool expanded) { m_expanded = expanded; }
+    // True if the children of this item are shown, i.e. it and all of its ancestors are expanded
+    bool childrenVisible();
 
 private slots:
 
@@ -183,6 +203,7 @@ private:
     bool m_highlight;
     bool m_changed;
     bool m_updated;
+    bool m_expanded;
     QTime m_highlightExpires;
     HighLightManager* m_highlightManager;
     static int m_highlightTimeMs;
@@ -229,16 +250,37 @@ class ObjectTreeItem : public TreeItem
 Q_OBJECT
 public:
     ObjectTreeItem(const QList<QVariant> &data, TreeItem *parent = 0) :
-            TreeItem(data, parent), m_obj(0) { }
+            TreeItem(data, parent), m_obj(0), m_pendingFields(0), m_stale(false) { }
     ObjectTreeItem(const QVariant &data, TreeItem *parent = 0) :
-            TreeItem(data, parent), m_obj(0) { }
+            TreeItem(data, parent), m_obj(0), m_pendingFields(0), m_stale(false) { }
     virtual void setObject(UAVObject *obj) {
         m_obj = obj; setDescription(obj->getDescription());
     }
     inline UAVObject *object() { return m_obj; }
 
+    // Field items are only created when the item is first expanded,
+    // until then this holds the object whose fields are still missing.
+    inline UAVObject *pendingFields() { return m_pendingFields; }
+    inline void setPendingFields(UAVObject *obj) { m_pendingFields = obj; }
+
+    // Set when an update arrived while the fields were not visible
+    inline bool stale() { return m_stale; }
+    inline void setStale(bool stale) { m_stale = stale; }
+
+    // Compares the packed object against the last seen copy and stores it
+    bool objectDataChanged(UAVObject *obj) {
+        QByteArray current(obj->getNumBytes(), 0);
+        obj->pack((quint8*)current.data());
+        bool changed = (current != m_lastData);
+        m_lastData = current;
+        return changed;
+    }
+
 private:
     UAVObject *m_obj;
+    UAVObject *m_pendingFields;
+    bool m_stale;
+    QByteArray m_lastData;
 };
 
 class MetaObjectTreeItem : public ObjectTreeItem
@@ -79,6 +79,9 @@ UAVObjectBrowserWidget::UAVObjectBrowserWidget(QWidget *parent) : QWidget(parent
 
 void UAVObjectBrowserWidget::onTreeItemExpanded(QModelIndex currentIndex)
 {
+    // Let the model refresh the rows that became visible
+    m_model->setExpanded(currentIndex, true);
+
     TreeItem *item = static_cast<TreeItem*>(currentIndex.internalPointer());
     TopTreeItem *top = dynamic_cast<TopTreeItem*>(item->parent());
 
@@ -138,6 +141,8 @@ void UAVObjectBrowserWidget::onTreeItemExpanded(QModelIndex currentIndex)
 
 void UAVObjectBrowserWidget::onTreeItemCollapsed(QModelIndex currentIndex)
 {
+    // Hidden rows are no longer refreshed by the model
+    m_model->setExpanded(currentIndex, false);
 
     TreeItem *item = static_cast<TreeItem*>(currentIndex.internalPointer());
     TopTreeItem *top = dynamic_cast<TopTreeItem*>(item->parent());
@@ -638,21 +643,11 @@ void UAVOBrowserTreeView::onTimeout_updateView()
  */
 void UAVOBrowserTreeView::updateView(QModelIndex topLeft, QModelIndex bottomRight)
 {
+    Q_UNUSED(topLeft);
     Q_UNUSED(bottomRight);
 
-    // First static_cast from *void to a tree item pointer. This is safe because we know all the indices are tree items
-    TreeItem *treeItemPtr = static_cast<TreeItem*>(topLeft.internalPointer());
-
-    // Second, do a dynamic_cast in order to detect if this tree item is a data object
-    DataObjectTreeItem *dataObjectTreeItemPtr = dynamic_cast<DataObjectTreeItem*>(treeItemPtr);
-
-    if (dataObjectTreeItemPtr == NULL) {
-        // Do nothing. These QModelIndices are generated by the highlight manager for individual
-        // UAVO fields, which are both updated when updating that UAVO's branch of the settings or
-        // dynamic data tree.
-        return;
-    }
-
+    // The model already coalesces changed rows into one range per parent and
+    // refresh tick, so any range means the view needs repainting.
     m_updateTreeViewFlag = true;
 }
 
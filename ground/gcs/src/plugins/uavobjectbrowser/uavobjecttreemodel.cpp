@@ -38,10 +38,14 @@
 #include <QtCore/QTimer>
 #include <QtCore/QSignalMapper>
 #include <QtCore/QDebug>
+#include <QtCore/QHash>
 #include <math.h>
 
 #include <QApplication>
 
+// Period at which changed rows are reported to the views, in ms
+#define REFRESH_PERIOD 33
+
 UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool useScientificNotation) :
     QAbstractItemModel(parent),
     m_rootItem(NULL),
@@ -66,12 +70,17 @@ UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool useScientificNotati
     m_currentTimeTimer.start(lrint(fmax(m_recentlyUpdatedTimeout / 10.0f, 10))); // Update the timer 10 times faster than the time
                                                                                  // out. In any case, never go faster than 10ms.
     TreeItem::setHighlightTime(m_recentlyUpdatedTimeout);
+
+    // Changed rows are collected and reported in one batch per tick
+    connect(&m_refreshTimer, SIGNAL(timeout()), this, SLOT(refreshDirtyItems()));
+    m_refreshTimer.start(REFRESH_PERIOD);
 }
 
 UAVObjectTreeModel::~UAVObjectTreeModel()
 {
-    delete m_highlightManager;
+    // Items unregister from the highlight manager when destroyed
     delete m_rootItem;
+    delete m_highlightManager;
 }
 
 /**
@@ -91,11 +100,11 @@ void UAVObjectTreeModel::setupModelData(UAVObjectManager *objManager, bool categ
         disconnect(objManager, SIGNAL(newObject(UAVObject*)), this, SLOT(newObject(UAVObject*)));
         disconnect(objManager, SIGNAL(newInstance(UAVObject*)), this, SLOT(newObject(UAVObject*)));
         disconnect(objManager, SIGNAL(instanceRemoved(UAVObject*)), this, SLOT(instanceRemove(UAVObject*)));
-        delete m_highlightManager;
         int count = m_rootItem->childCount();
         beginRemoveRows(index(m_rootItem), 0, count);
         delete m_rootItem;
         endRemoveRows();
+        delete m_highlightManager;
     }
     // Create highlight manager, let it run every 300 ms.
     m_highlightManager = new HighLightManager(300, &m_currentTime);
@@ -103,6 +112,7 @@ void UAVObjectTreeModel::setupModelData(UAVObjectManager *objManager, bool categ
     rootData << tr("Property") << tr("Value") << tr("Unit");
     m_rootItem = new TreeItem(rootData);
     m_rootItem->setCurrentTime(&m_currentTime);
+    m_rootItem->setExpanded(true);
 
     m_settingsTree = new TopTreeItem(tr("Settings"), m_rootItem);
     m_settingsTree->setHighlightManager(m_highlightManager);
@@ -111,8 +121,6 @@ void UAVObjectTreeModel::setupModelData(UAVObjectManager *objManager, bool categ
     m_nonSettingsTree->setHighlightManager(m_highlightManager);
     m_rootItem->appendChild(m_nonSettingsTree);
     m_rootItem->setHighlightManager(m_highlightManager);
-    connect(m_settingsTree, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
-    connect(m_nonSettingsTree, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
 
     QVector< QVector<UAVDataObject*> > objList = objManager->getDataObjectsVector();
     foreach (QVector<UAVDataObject*> list, objList) {
@@ -153,7 +161,10 @@ void UAVObjectTreeModel::instanceRemove(UAVObject *obj)
             InstanceTreeItem *inst = dynamic_cast<InstanceTreeItem*>(item);
             if(inst && inst->object() == obj)
             {
-                inst->parent()->removeChild(inst);
+                int row = inst->row();
+                beginRemoveRows(index(existing), row, row);
+                existing->removeChild(inst);
+                endRemoveRows();
                 inst->deleteLater();
             }
         }
@@ -179,7 +190,6 @@ void UAVObjectTreeModel::addDataObject(UAVDataObject *obj, bool categorize)
     } else {
         DataObjectTreeItem *dataTreeItem = new DataObjectTreeItem(obj->getName() + " (" + QString::number(obj->getNumBytes()) + " bytes)");
         dataTreeItem->setHighlightManager(m_highlightManager);
-        connect(dataTreeItem, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
         parent->insertChild(dataTreeItem);
         root->addObjectTreeItem(obj->getObjID(), dataTreeItem);
         UAVMetaObject *meta = obj->getMetaObject();
@@ -196,7 +206,6 @@ TreeItem* UAVObjectTreeModel::createCategoryItems(QStringList categoryPath, Tree
         TreeItem* existing = parent->findChildByName(category);
         if(!existing) {
             TreeItem* categoryItem = new CategoryTreeItem(category);
-            connect(categoryItem, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
             categoryItem->setHighlightManager(m_highlightManager);
             parent->insertChild(categoryItem);
             parent = categoryItem;
@@ -214,14 +223,8 @@ MetaObjectTreeItem* UAVObjectTreeModel::addMetaObject(UAVMetaObject *obj, TreeIt
     MetaObjectTreeItem *meta = new MetaObjectTreeItem(obj, tr("Meta Data"));
 
     meta->setHighlightManager(m_highlightManager);
-    connect(meta, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
-    foreach (UAVObjectField *field, obj->getFields()) {
-        if (field->getNumElements() > 1) {
-            addArrayField(field, meta);
-        } else {
-            addSingleField(0, field, meta);
-        }
-    }
+    // The fields are created once the item gets expanded
+    meta->setPendingFields(obj);
     parent->appendChild(meta);
     return meta;
 }
@@ -229,17 +232,16 @@ MetaObjectTreeItem* UAVObjectTreeModel::addMetaObject(UAVMetaObject *obj, TreeIt
 void UAVObjectTreeModel::addInstance(UAVObject *obj, TreeItem *parent)
 {
     connect(obj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(highlightUpdatedObject(UAVObject*)));
-    TreeItem *item;
+    ObjectTreeItem *item;
     DataObjectTreeItem *p = static_cast<DataObjectTreeItem*>(parent);
     if (obj->isSingleInstance()) {
-        item = parent;
+        item = p;
         p->setObject(obj);
     } else {
         p->setObject(NULL);
         QString name = tr("Instance") +  " " + QString::number(obj->getInstID());
         item = new InstanceTreeItem(obj, name);
         item->setHighlightManager(m_highlightManager);
-        connect(item, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
 
         // Inform the model that we will add a row
         beginInsertRows(index(parent), parent->childCount(), parent->childCount());
@@ -250,25 +252,45 @@ void UAVObjectTreeModel::addInstance(UAVObject *obj, TreeItem *parent)
         // Inform the model that the row addition is complete
         endInsertRows();
     }
-    foreach (UAVObjectField *field, obj->getFields()) {
+    // The fields are created once the item gets expanded
+    item->setPendingFields(obj);
+    UAVDataObject * dobj = dynamic_cast<UAVDataObject *>(obj);
+    if(dobj)
+    {
+        connect(dobj, SIGNAL(presentOnHardwareChanged(UAVDataObject*)), this, SLOT(presentOnHardwareChangedCB(UAVDataObject*)), Qt::UniqueConnection);
+    }
+}
+
+/**
+ * @brief Creates the field items of an object item whose fields were deferred
+ * @param item the object item, its fields are appended after the existing children
+ */
+void UAVObjectTreeModel::addFields(ObjectTreeItem *item)
+{
+    UAVObject *obj = item->pendingFields();
+    if (!obj)
+        return;
+    item->setPendingFields(NULL);
+
+    QList<UAVObjectField*> fields = obj->getFields();
+    if (fields.isEmpty())
+        return;
+
+    beginInsertRows(index(item), item->childCount(), item->childCount() + fields.count() - 1);
+    foreach (UAVObjectField *field, fields) {
         if (field->getNumElements() > 1) {
             addArrayField(field, item);
         } else {
             addSingleField(0, field, item);
         }
     }
-    UAVDataObject * dobj = dynamic_cast<UAVDataObject *>(obj);
-    if(dobj)
-    {
-        connect(dobj, SIGNAL(presentOnHardwareChanged(UAVDataObject*)), this, SLOT(presentOnHardwareChangedCB(UAVDataObject*)), Qt::UniqueConnection);
-    }
+    endInsertRows();
 }
 
 void UAVObjectTreeModel::addArrayField(UAVObjectField *field, TreeItem *parent)
 {
     TreeItem *item = new ArrayFieldTreeItem(field->getName());
     item->setHighlightManager(m_highlightManager);
-    connect(item, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
     for (uint i = 0; i < field->getNumElements(); ++i) {
         addSingleField(i, field, item);
     }
@@ -314,7 +336,6 @@ void UAVObjectTreeModel::addSingleField(int index, UAVObjectField *field, TreeIt
         Q_ASSERT(false);
     }
     item->setHighlightManager(m_highlightManager);
-    connect(item, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
     parent->appendChild(item);
 }
 
@@ -343,16 +364,9 @@ QModelIndex UAVObjectTreeModel::index(TreeItem *item)
     if (item->parent() == 0)
         return QModelIndex();
 
-    QModelIndex root = index(item->parent());
-
-    for (int i = 0; i < rowCount(root); ++i) {
-        QModelIndex childIndex = index(i, 0, root);
-        TreeItem *child = static_cast<TreeItem*>(childIndex.internalPointer());
-        if (child == item)
-            return childIndex;
-    }
-    Q_ASSERT(false);
-    return QModelIndex();
+    int row = item->row();
+    Q_ASSERT(row >= 0);
+    return createIndex(row, 0, item);
 }
 
 QModelIndex UAVObjectTreeModel::parent(const QModelIndex &index) const
@@ -382,6 +396,31 @@ int UAVObjectTreeModel::rowCount(const QModelIndex &parent) const
     return parentItem->childCount();
 }
 
+bool UAVObjectTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    // Object items show an expander before their fields are created
+    if (canFetchMore(parent))
+        return true;
+    return rowCount(parent) > 0;
+}
+
+bool UAVObjectTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid() || parent.column() > 0)
+        return false;
+    ObjectTreeItem *item = dynamic_cast<ObjectTreeItem*>(static_cast<TreeItem*>(parent.internalPointer()));
+    return item && item->pendingFields();
+}
+
+void UAVObjectTreeModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+    ObjectTreeItem *item = static_cast<ObjectTreeItem*>(static_cast<TreeItem*>(parent.internalPointer()));
+    addFields(item);
+    item->setStale(false);
+}
+
 int UAVObjectTreeModel::columnCount(const QModelIndex &parent) const
 {
     if (parent.isValid())
@@ -512,22 +551,70 @@ QVariant UAVObjectTreeModel::headerData(int section, Qt::Orientation orientation
     return QVariant();
 }
 
+/**
+ * @brief Refreshes the tree item of an updated object
+ * Field items are only refreshed while they are shown. Hidden objects are
+ * marked stale and refreshed when expanded, only their row gets highlighted.
+ */
 void UAVObjectTreeModel::highlightUpdatedObject(UAVObject *obj)
 {
     Q_ASSERT(obj);
     ObjectTreeItem *item = findObjectTreeItem(obj);
     Q_ASSERT(item);
-    if(!m_onlyHighlightChangedValues){
-        item->setHighlight(true);
+
+    // Multiple instance objects have one child item per instance
+    if (item->object() != obj) {
+        foreach (TreeItem *child, item->treeChildren()) {
+            InstanceTreeItem *inst = dynamic_cast<InstanceTreeItem*>(child);
+            if (inst && inst->object() == obj) {
+                item = inst;
+                break;
+            }
+        }
     }
-    item->update();
-    if(!m_onlyHighlightChangedValues){
-        QModelIndex itemIndex = index(item);
-        Q_ASSERT(itemIndex != QModelIndex());
-        emit dataChanged(itemIndex, itemIndex);
+
+    bool changed = item->objectDataChanged(obj);
+    if (item->childrenVisible() && !item->pendingFields()) {
+        item->setStale(false);
+        if(!m_onlyHighlightChangedValues){
+            item->setHighlight(true);
+        }
+        item->update();
+    } else {
+        item->setStale(true);
+        if(!m_onlyHighlightChangedValues || changed){
+            item->setHighlight(true);
+        }
     }
 }
 
+/**
+ * @brief Tracks which rows are expanded in the view
+ * Expanding an item refreshes the objects below it that became visible.
+ */
+void UAVObjectTreeModel::setExpanded(const QModelIndex &index, bool expanded)
+{
+    if (!index.isValid())
+        return;
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    item->setExpanded(expanded);
+    if (expanded)
+        refreshStaleItems(item);
+}
+
+void UAVObjectTreeModel::refreshStaleItems(TreeItem *item)
+{
+    if (!item->isExpanded())
+        return;
+    ObjectTreeItem *objItem = dynamic_cast<ObjectTreeItem*>(item);
+    if (objItem && objItem->stale() && item->childrenVisible()) {
+        objItem->setStale(false);
+        objItem->update();
+    }
+    foreach (TreeItem *child, item->treeChildren())
+        refreshStaleItems(child);
+}
+
 ObjectTreeItem* UAVObjectTreeModel::findObjectTreeItem(UAVObject *object)
 {
     UAVDataObject *dataObject = qobject_cast<UAVDataObject*>(object);
@@ -558,11 +645,43 @@ MetaObjectTreeItem* UAVObjectTreeModel::findMetaObjectTreeItem(UAVMetaObject *ob
     return root->findMetaObjectTreeItemByObjectId(obj->getObjID());
 }
 
-void UAVObjectTreeModel::updateHighlight(TreeItem *item)
+/**
+ * @brief Reports all rows changed since the last tick
+ * Changed rows are coalesced into a single range per parent item so the views
+ * receive one dataChanged() per refresh tick instead of one per field.
+ */
+void UAVObjectTreeModel::refreshDirtyItems()
 {
-    QModelIndex itemIndex = index(item);
-    Q_ASSERT(itemIndex != QModelIndex());
-    emit dataChanged(itemIndex, itemIndex.sibling(itemIndex.row(), TreeItem::dataColumn));
+    if (!m_highlightManager)
+        return;
+
+    QSet<TreeItem*> dirty = m_highlightManager->takeDirtyItems();
+    if (dirty.isEmpty())
+        return;
+
+    QHash<TreeItem*, QPair<int, int> > ranges;
+    foreach (TreeItem *item, dirty) {
+        TreeItem *parent = item->parent();
+        if (!parent)
+            continue;
+        int row = item->row();
+        if (row < 0)
+            continue; // Already removed from the tree
+        if (!ranges.contains(parent)) {
+            ranges.insert(parent, qMakePair(row, row));
+        } else {
+            QPair<int, int> &range = ranges[parent];
+            range.first = qMin(range.first, row);
+            range.second = qMax(range.second, row);
+        }
+    }
+
+    QHash<TreeItem*, QPair<int, int> >::const_iterator it;
+    for (it = ranges.constBegin(); it != ranges.constEnd(); ++it) {
+        TreeItem *parent = it.key();
+        emit dataChanged(createIndex(it.value().first, 0, parent->getChild(it.value().first)),
+                         createIndex(it.value().second, TreeItem::dataColumn, parent->getChild(it.value().second)));
+    }
 }
 
 
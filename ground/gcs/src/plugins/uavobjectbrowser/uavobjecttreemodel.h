@@ -63,6 +63,9 @@ public:
     QModelIndex parent(const QModelIndex &index) const;
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
 
     TopTreeItem* getSettingsTree(){return m_settingsTree;}
     TopTreeItem* getNonSettingsTree(){return m_nonSettingsTree;}
@@ -81,6 +84,8 @@ public:
 
     QModelIndex getIndex(int indexRow, int indexCol, TopTreeItem *topTreeItem){return createIndex(indexRow, indexCol, topTreeItem);}
 
+    void setExpanded(const QModelIndex &index, bool expanded);
+
 signals:
     void presentOnHardwareChanged();
 public slots:
@@ -89,7 +94,7 @@ public slots:
     void instanceRemove(UAVObject*);
 private slots:
     void highlightUpdatedObject(UAVObject *obj);
-    void updateHighlight(TreeItem*);
+    void refreshDirtyItems();
     void updateCurrentTime();
     void presentOnHardwareChangedCB(UAVDataObject*);
 
@@ -101,6 +106,8 @@ private:
     void addArrayField(UAVObjectField *field, TreeItem *parent);
     void addSingleField(int index, UAVObjectField *field, TreeItem *parent);
     void addInstance(UAVObject *obj, TreeItem *parent);
+    void addFields(ObjectTreeItem *item);
+    void refreshStaleItems(TreeItem *item);
 
     TreeItem *createCategoryItems(QStringList categoryPath, TreeItem *root);
 
@@ -123,6 +130,7 @@ private:
     bool m_hideNotPresent;
     bool m_categorize;
     QTimer m_currentTimeTimer;
+    QTimer m_refreshTimer;
     QTime m_currentTime;
     UAVObjectManager *objManager;
     // Highlight manager to handle highlighting of tree items.
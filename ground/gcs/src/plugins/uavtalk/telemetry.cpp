@@ -1,7 +1,7 @@
 /**
  ******************************************************************************
  * @file       telemetry.cpp
- * @author     Tau Labs, http://taulabs.org, Copyright (C) 2012-2013
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2012-2015
  * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
  * @addtogroup GCSPlugins GCS Plugins
  * @{
@@ -41,38 +41,6 @@
   #define TELEMETRY_QXTLOG_DEBUG(...)
 #endif	// TELEMETRY_DEBUG
 
-/**
- * @brief The TransactionKey class A key for the QMap to track transactions
- */
-class TransactionKey {
-public:
-    TransactionKey(quint32 objId, quint32 instId, bool req) {
-        this->objId = objId;
-        this->instId = instId;
-        this->req = req;
-    }
-
-    TransactionKey(UAVObject *obj, bool req) {
-        this->objId = obj->getObjID();
-        this->instId = obj->getInstID();
-        this->req = req;
-    }
-
-    // See if this is an equivalent transaction key
-    bool operator==(const TransactionKey & rhs) const {
-        return (rhs.objId == objId && rhs.instId == instId && rhs.req == req);
-    }
-
-    bool operator<(const TransactionKey & rhs) const {
-        return objId < rhs.objId || (objId == rhs.objId && instId < rhs.instId) ||
-                (objId == rhs.objId && instId == rhs.instId && req != rhs.req);
-    }
-
-    quint32 objId;
-    quint32 instId;
-    bool req;
-};
-
 /**
  * Constructor
  */
@@ -104,6 +72,19 @@ Telemetry::Telemetry(UAVTalk* utalk, UAVObjectManager* objMngr)
     // Setup and start the stats timer
     txErrors = 0;
     txRetries = 0;
+    // Transactions start with a small window and an unknown round trip time
+    window = INITIAL_WINDOW;
+    windowAcks = 0;
+    windowDecreaseMs = 0;
+    bulkPending = 0;
+    srttMs = 0;
+    rttVarMs = 0;
+    clock.start();
+    // One timer for the timeouts of all transactions
+    wheel.resize(TIMER_WHEEL_SLOTS);
+    wheelTick = 0;
+    wheelTimer = new QTimer(this);
+    connect(wheelTimer, SIGNAL(timeout()), this, SLOT(processTransactionTimeouts()));
 }
 
 Telemetry::~Telemetry()
@@ -276,10 +257,8 @@ void Telemetry::updateObject(UAVObject* obj, quint32 eventType)
  */
 void Telemetry::transactionSuccess(UAVObject* obj)
 {
-    if (updateTransactionMap(obj,false)) {
+    if (completeTransaction(obj, false, true, false)) {
         TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] Transaction succeeded:%0 Instance:%1").arg(obj->getName() + QString(QString(" 0x") + QString::number(obj->getObjID(), 16).toUpper())).arg(obj->getInstID()));
-        obj->emitTransactionCompleted(true);
-        obj->emitTransactionCompleted(true,false);
     } else {
         TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] Received an ACK we were not expecting object:%0").arg(obj->getName()));
     }
@@ -290,10 +269,7 @@ void Telemetry::transactionSuccess(UAVObject* obj)
 
 /**
  * Called when a transaction is completed with failure (uavtalk event).
- * This happens either:
- *  - Because we received a NACK from the UAVTalk layer.
- *  - Because we did not receive an UNPACK event from an object we had requested and
- *    the object request retries is exceeded.
+ * This happens because we received a NACK from the UAVTalk layer.
  */
 void Telemetry::transactionFailure(UAVObject* obj)
 {
@@ -302,10 +278,8 @@ void Telemetry::transactionFailure(UAVObject* obj)
         nacked = true;
     // Here we need to check for true or false as a NAK can occur for OBJ_REQ or an
     // object set
-    if (updateTransactionMap(obj, true) || updateTransactionMap(obj, false)) {
+    if (completeTransaction(obj, true, false, nacked) || completeTransaction(obj, false, false, nacked)) {
         TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] Transaction failed:%0 Instance:%1").arg(obj->getName() + QString(QString(" 0x") + QString::number(obj->getObjID(), 16).toUpper())).arg(obj->getInstID()));
-        obj->emitTransactionCompleted(false);
-        obj->emitTransactionCompleted(false,nacked);
     } else {
         TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] Received a NACK we were not expecting for object %0").arg(obj->getName()));
     }
@@ -320,10 +294,8 @@ void Telemetry::transactionFailure(UAVObject* obj)
  */
 void Telemetry::transactionRequestCompleted(UAVObject* obj)
 {
-    if (updateTransactionMap(obj,true)) {
+    if (completeTransaction(obj, true, true, false)) {
         TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] Transaction succeeded:%0 Instance:%1").arg(obj->getName() + QString(QString(" 0x") + QString::number(obj->getObjID(), 16).toUpper())).arg(obj->getInstID()));
-        obj->emitTransactionCompleted(true);
-        obj->emitTransactionCompleted(true,false);
     } else {
         TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] Received a ACK we were not expecting for object %0").arg(obj->getName()));
     }
@@ -332,37 +304,90 @@ void Telemetry::transactionRequestCompleted(UAVObject* obj)
 }
 
 /**
- * @brief Telemetry::updateTransactionMap
+ * @brief Telemetry::completeTransaction
  *  Check whether the object is in our pending transactions map. If so, remove
- *  it, otherwise return an error (false)
+ *  it and tell the object how it went, otherwise return an error (false)
  * @param obj pointer to the UAV Object
  * @param request : true if the entry in the transaction map should be an object request,
  *                  false if the entry in the transaction map should be an object sent
- *
+ * @param success : whether the remote end answered
+ * @param nacked : whether the answer was a NACK
  */
-bool Telemetry::updateTransactionMap(UAVObject* obj, bool request)
+bool Telemetry::completeTransaction(UAVObject* obj, bool request, bool success, bool nacked)
 {
-    TransactionKey key(obj, request);
-    QMap<TransactionKey, ObjectTransactionInfo*>::iterator itr = transMap.find(key);
-    if ( itr != transMap.end() )
-    {
-        ObjectTransactionInfo *transInfo = itr.value();
-        // Remove this transaction as it is complete.
-        transInfo->timer->stop();
-        transMap.remove(key);
-        delete transInfo;
-        return true;
+    QMap<TransactionKey, ObjectTransactionInfo*>::iterator itr = transMap.find(TransactionKey(obj, request));
+    if ( itr == transMap.end() )
+        return false;
+
+    ObjectTransactionInfo *transInfo = itr.value();
+    transMap.erase(itr);
+
+    if (success) {
+        // Only an answer to the first try tells which one it answers
+        if (transInfo->retriesRemaining == MAX_RETRIES)
+            updateRtt(clock.elapsed() - transInfo->sentMs);
+
+        // Additive increase, one more transaction per window of answers
+        if (++windowAcks >= window) {
+            windowAcks = 0;
+            if (window < MAX_WINDOW)
+                ++window;
+        }
     }
-    return false;
+
+    bool bulk = transInfo->bulk;
+    delete transInfo;
+
+    obj->emitTransactionCompleted(success);
+    obj->emitTransactionCompleted(success, nacked);
+
+    if (bulk && --bulkPending == 0 && objBulkQueue.isEmpty())
+        emit bulkRequestCompleted();
+
+    return true;
 }
 
+/**
+ * Add a round trip time sample to the estimate, like TCP does (RFC 6298)
+ */
+void Telemetry::updateRtt(qint32 sampleMs)
+{
+    sampleMs = qMax(sampleMs, 1);
+
+    if (srttMs == 0) {
+        srttMs = sampleMs;
+        rttVarMs = sampleMs / 2;
+    } else {
+        rttVarMs = (3 * rttVarMs + qAbs(srttMs - sampleMs)) / 4;
+        srttMs = (7 * srttMs + sampleMs) / 8;
+    }
+}
 
 /**
- * Called when a transaction is not completed within the timeout period (timer event)
+ * How long to wait for an answer. The time grows when many transactions are
+ * queued on a slow link, so they are not retried while still on their way.
+ */
+qint32 Telemetry::requestTimeout()
+{
+    if (srttMs == 0)
+        return REQ_TIMEOUT_MS;
+
+    return qBound((qint32) MIN_REQ_TIMEOUT_MS, srttMs + 4 * rttVarMs, (qint32) MAX_REQ_TIMEOUT_MS);
+}
+
+/**
+ * Called when a transaction is not completed within the timeout period
  */
 void Telemetry::transactionTimeout(ObjectTransactionInfo *transInfo)
 {
-    transInfo->timer->stop();
+    // Multiplicative decrease, once for all the transactions that were
+    // on the link together
+    if (transInfo->sentMs >= windowDecreaseMs) {
+        window = qMax(1, window / 2);
+        windowAcks = 0;
+        windowDecreaseMs = clock.elapsed();
+    }
+
     // Check if more retries are pending
     if (transInfo->retriesRemaining > 0)
     {
@@ -374,12 +399,40 @@ void Telemetry::transactionTimeout(ObjectTransactionInfo *transInfo)
     else
     {
         TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] Transaction timeout:%0 Instance:%1 no more retries. FAILED TRANSACT").arg(transInfo->obj->getName() + QString(QString(" 0x") + QString::number(transInfo->obj->getObjID(), 16).toUpper())).arg(transInfo->obj->getInstID()));
-        transInfo->timer->stop();
-        transactionFailure(transInfo->obj);
+        completeTransaction(transInfo->obj, transInfo->objRequest, false, false);
         ++txErrors;
     }
 }
 
+/**
+ * Called each tick of the timer wheel, times out the transactions that are
+ * due on this tick. Transactions that completed or were sent again since
+ * are still listed in the slot and skipped.
+ */
+void Telemetry::processTransactionTimeouts()
+{
+    QMutexLocker locker(mutex);
+
+    ++wheelTick;
+
+    QList<TransactionKey> expired;
+    expired.swap(wheel[wheelTick % TIMER_WHEEL_SLOTS]);
+
+    foreach (const TransactionKey &key, expired) {
+        ObjectTransactionInfo *transInfo = transMap.value(key, NULL);
+        if (transInfo == NULL || transInfo->timeoutTick != wheelTick)
+            continue;
+
+        transactionTimeout(transInfo);
+    }
+
+    if (transMap.isEmpty())
+        wheelTimer->stop();
+
+    // Timeouts make room in the window
+    processObjectQueue();
+}
+
 /**
  * Start an object transaction with UAVTalk, all information is stored in transInfo.
  */
@@ -398,7 +451,12 @@ void Telemetry::processObjectTransaction(ObjectTransactionInfo *transInfo)
     // Start timer if a response is expected
     if ( transInfo->objRequest || transInfo->acked )
     {
-        transInfo->timer->start(REQ_TIMEOUT_MS);
+        transInfo->sentMs = clock.elapsed();
+        int ticks = (requestTimeout() + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+        transInfo->timeoutTick = wheelTick + ticks;
+        wheel[transInfo->timeoutTick % TIMER_WHEEL_SLOTS].append(TransactionKey(transInfo->obj, transInfo->objRequest));
+        if (!wheelTimer->isActive())
+            wheelTimer->start(TIMER_WHEEL_TICK_MS);
     }
     else
     {
@@ -408,6 +466,50 @@ void Telemetry::processObjectTransaction(ObjectTransactionInfo *transInfo)
     }
 }
 
+/**
+ * Request many objects, all instances of each. They go out as fast as the
+ * transaction window allows, after the other updates.
+ * bulkRequestCompleted() is emitted when all requested objects have been
+ * received or failed, each object also emits transactionCompleted().
+ */
+void Telemetry::requestObjects(const QList<UAVObject*> &objs)
+{
+    QMutexLocker locker(mutex);
+
+    if (objs.isEmpty()) {
+        emit bulkRequestCompleted();
+        return;
+    }
+
+    foreach (UAVObject *obj, objs) {
+        ObjectQueueInfo objInfo;
+        objInfo.obj = obj;
+        objInfo.event = EV_UPDATE_REQ;
+        objInfo.allInstances = true;
+        objBulkQueue.enqueue(objInfo);
+    }
+
+    processObjectQueue();
+}
+
+/**
+ * Fail the requested objects that weren't sent yet
+ */
+void Telemetry::failBulkRequests()
+{
+    if (objBulkQueue.isEmpty())
+        return;
+
+    while (!objBulkQueue.isEmpty()) {
+        UAVObject *obj = objBulkQueue.dequeue().obj;
+        obj->emitTransactionCompleted(false);
+        obj->emitTransactionCompleted(false,false);
+    }
+
+    if (bulkPending == 0)
+        emit bulkRequestCompleted();
+}
+
 /**
  * Process the event received from an object we are following. This method
  * only enqueues objects for later processing
@@ -451,7 +553,29 @@ void Telemetry::processObjectUpdates(UAVObject* obj, EventMask event, bool allIn
 }
 
 /**
- * Process events from the object queue.
+ * Whether processing this event starts a transaction that waits for an answer
+ */
+bool Telemetry::startsTransaction(const ObjectQueueInfo &objInfo)
+{
+    UAVObject::Metadata metadata = objInfo.obj->getMetadata();
+    bool request = (objInfo.event == EV_UPDATE_REQ);
+
+    if (transMap.contains(TransactionKey(objInfo.obj, request)))
+        return false;
+
+    if (request)
+        return true;
+
+    if ( objInfo.event == EV_UPDATED || objInfo.event == EV_UPDATED_MANUAL ||
+         ( objInfo.event == EV_UPDATED_PERIODIC && UAVObject::GetGcsTelemetryUpdateMode(metadata) != UAVObject::UPDATEMODE_THROTTLED ) )
+        return UAVObject::GetGcsTelemetryAcked(metadata);
+
+    return false;
+}
+
+/**
+ * Process events from the object queues until they are empty or the
+ * transaction window is full.
  */
 void Telemetry::processObjectQueue()
 {
@@ -459,27 +583,76 @@ void Telemetry::processObjectQueue()
     {
         TELEMETRY_QXTLOG_DEBUG("[telemetry.cpp] **************** Object Queue above 1 in backlog ****************");
     }
-    // Get object information from queue (first the priority and then the regular queue)
-    ObjectQueueInfo objInfo;
+
+    while (processNextQueued())
+        ;
+}
+
+/**
+ * Process one event from the object queues (first the priority, then the
+ * regular and last the bulk queue).
+ * @return false if there was nothing that could be processed
+ */
+bool Telemetry::processNextQueued()
+{
+    QQueue<ObjectQueueInfo> *queue;
     if ( !objPriorityQueue.isEmpty() )
     {
-        objInfo = objPriorityQueue.dequeue();
+        queue = &objPriorityQueue;
     }
     else if ( !objQueue.isEmpty() )
     {
-        objInfo = objQueue.dequeue();
+        queue = &objQueue;
+    }
+    else if ( !objBulkQueue.isEmpty() )
+    {
+        queue = &objBulkQueue;
     }
     else
     {
-        return;
+        return false;
+    }
+
+    // When the window is full wait for answers, but keep handling the events
+    // that don't wait themselves. The unpacks among them are the answers.
+    int idx = 0;
+    if (transMap.size() >= window && startsTransaction(queue->head()))
+    {
+        idx = -1;
+        QQueue<ObjectQueueInfo> *queues[] = { &objPriorityQueue, &objQueue };
+        for (int q = 0; q < 2 && idx < 0; ++q)
+        {
+            for (int i = 0; i < queues[q]->length(); ++i)
+            {
+                if (!startsTransaction(queues[q]->at(i)))
+                {
+                    queue = queues[q];
+                    idx = i;
+                    break;
+                }
+            }
+        }
+        if (idx < 0)
+            return false;
     }
 
+    bool bulk = (queue == &objBulkQueue);
+    ObjectQueueInfo objInfo = queue->takeAt(idx);
+
     // Check if a connection has been established, only process GCSTelemetryStats updates
     // (used to establish the connection)
     GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
     if ( gcsStats.Status != GCSTelemetryStats::STATUS_CONNECTED )
     {
         objQueue.clear();
+        // The requested objects can't arrive anymore
+        if (bulk)
+        {
+            objBulkQueue.prepend(objInfo);
+            failBulkRequests();
+            return true;
+        }
+        failBulkRequests();
         if ( objInfo.obj->getObjID() != GCSTelemetryStats::OBJID &&
              objInfo.obj->getObjID() != HwTauLink::OBJID &&
              objInfo.obj->getObjID() != ObjectPersistence::OBJID )
@@ -490,7 +663,7 @@ void Telemetry::processObjectQueue()
             // - ObjectPersistence (to save modem configuration)
             objInfo.obj->emitTransactionCompleted(false);
             objInfo.obj->emitTransactionCompleted(false,false);
-            return;
+            return true;
         }
     }
 
@@ -500,13 +673,17 @@ void Telemetry::processObjectQueue()
     if ( ( objInfo.event != EV_UNPACKED ) && ( ( objInfo.event != EV_UPDATED_PERIODIC ) || ( updateMode != UAVObject::UPDATEMODE_THROTTLED ) ) )
     {
         // We are either going to send an object, or are requesting one:
-        if (transMap.contains(TransactionKey(objInfo.obj, objInfo.event == EV_UPDATE_REQ))) {
+        ObjectTransactionInfo *pending = transMap.value(TransactionKey(objInfo.obj, objInfo.event == EV_UPDATE_REQ), NULL);
+        if (pending != NULL) {
             TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] Warning: Got request for %0 for which a request is already in progress. Not doing it").arg(objInfo.obj->getName()));
             // We will not re-request it, then, we should wait for a timeout or success...
+            if (bulk && !pending->bulk) {
+                pending->bulk = true;
+                ++bulkPending;
+            }
         } else
         {
-            UAVObject::Metadata metadata = objInfo.obj->getMetadata();
-            ObjectTransactionInfo *transInfo = new ObjectTransactionInfo(this);
+            ObjectTransactionInfo *transInfo = new ObjectTransactionInfo();
             transInfo->obj = objInfo.obj;
             transInfo->allInstances = objInfo.allInstances;
             transInfo->retriesRemaining = MAX_RETRIES;
@@ -519,7 +696,9 @@ void Telemetry::processObjectQueue()
             {
                 transInfo->objRequest = true;
             }
-            transInfo->telem = this;
+            transInfo->bulk = bulk;
+            if (bulk)
+                ++bulkPending;
             // Insert the transaction into the transaction map.
             TransactionKey key(objInfo.obj, transInfo->objRequest);
             transMap.insert(key, transInfo);
@@ -542,15 +721,12 @@ void Telemetry::processObjectQueue()
     // We received an "unpacked" event, check whether
     // this is for an object we were expecting
     if ( objInfo.event == EV_UNPACKED ) {
-        // TODO: Check here this is for a OBJ_REQ
-        if (transMap.contains(TransactionKey(objInfo.obj, true))) {
+        if (completeTransaction(objInfo.obj, true, true, false)) {
             TELEMETRY_QXTLOG_DEBUG(QString("[telemetry.cpp] EV_UNPACKED %0 Instance:%1").arg(objInfo.obj->getName() + QString(QString("0x") + QString::number(objInfo.obj->getObjID(), 16).toUpper())).arg(objInfo.obj->getInstID()));
-            transactionRequestCompleted(objInfo.obj);
-        } else
-        {
-            processObjectQueue();
         }
     }
+
+    return true;
 }
 
 
@@ -693,29 +869,14 @@ void Telemetry::newInstance(UAVObject* obj)
     registerObject(obj);
 }
 
-ObjectTransactionInfo::ObjectTransactionInfo(QObject* parent):QObject(parent)
+ObjectTransactionInfo::ObjectTransactionInfo()
 {
     obj = 0;
     allInstances = false;
     objRequest = false;
     retriesRemaining = 0;
     acked = false;
-    telem = 0;
-    // Setup transaction timer
-    timer = new QTimer(this);
-    timer->stop();
-    connect(timer, SIGNAL(timeout()), this, SLOT(timeout()));
-}
-
-ObjectTransactionInfo::~ObjectTransactionInfo()
-{
-    telem = 0;
-    timer->stop();
-    delete timer;
-}
-
-void ObjectTransactionInfo::timeout()
-{
-    if (!telem.isNull())
-        telem->transactionTimeout(this);
+    bulk = false;
+    sentMs = 0;
+    timeoutTick = 0;
 }
@@ -1,7 +1,7 @@
 /**
  ******************************************************************************
  * @file       telemetry.h
- * @author     Tau Labs, http://taulabs.org, Copyright (C) 2012-2013
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2012-2015
  * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
  * @addtogroup GCSPlugins GCS Plugins
  * @{
@@ -38,24 +38,51 @@
 #include <QTimer>
 #include <QQueue>
 #include <QMap>
+#include <QElapsedTimer>
 
-class TransactionKey;
-
-class ObjectTransactionInfo: public QObject {
-    Q_OBJECT
+/**
+ * @brief The TransactionKey class A key for the QMap to track transactions
+ */
+class TransactionKey {
+public:
+    TransactionKey(quint32 objId, quint32 instId, bool req) {
+        this->objId = objId;
+        this->instId = instId;
+        this->req = req;
+    }
+
+    TransactionKey(UAVObject *obj, bool req) {
+        this->objId = obj->getObjID();
+        this->instId = obj->getInstID();
+        this->req = req;
+    }
+
+    // See if this is an equivalent transaction key
+    bool operator==(const TransactionKey & rhs) const {
+        return (rhs.objId == objId && rhs.instId == instId && rhs.req == req);
+    }
+
+    bool operator<(const TransactionKey & rhs) const {
+        return objId < rhs.objId || (objId == rhs.objId && instId < rhs.instId) ||
+                (objId == rhs.objId && instId == rhs.instId && !req && rhs.req);
+    }
+
+    quint32 objId;
+    quint32 instId;
+    bool req;
+};
 
+class ObjectTransactionInfo {
 public:
-    ObjectTransactionInfo(QObject * parent);
-    ~ObjectTransactionInfo();
+    ObjectTransactionInfo();
     UAVObject* obj;
     bool allInstances;
     bool objRequest;
     qint32 retriesRemaining;
     bool acked;
-    QPointer<class Telemetry>telem;
-    QTimer* timer;
-private slots:
-    void timeout();
+    bool bulk;              /** Part of a bulk request */
+    qint64 sentMs;          /** When it was (re)sent, for the RTT */
+    quint32 timeoutTick;    /** Timer wheel tick the transaction times out on */
 };
 
 class Telemetry: public QObject
@@ -79,17 +106,24 @@ public:
     ~Telemetry();
     TelemetryStats getStats();
     void resetStats();
-    void transactionTimeout(ObjectTransactionInfo *info);
+    void requestObjects(const QList<UAVObject*> &objs);
 
 signals:
+    void bulkRequestCompleted();
 
 private:
     // Constants
     static const int REQ_TIMEOUT_MS = 250;
+    static const int MIN_REQ_TIMEOUT_MS = 100;
+    static const int MAX_REQ_TIMEOUT_MS = 2000;
     static const int MAX_RETRIES = 2;
     static const int MAX_UPDATE_PERIOD_MS = 1000;
     static const int MIN_UPDATE_PERIOD_MS = 1;
-    static const int MAX_QUEUE_SIZE = 20;
+    static const int MAX_QUEUE_SIZE = 100;
+    static const int INITIAL_WINDOW = 4;
+    static const int MAX_WINDOW = 32;
+    static const int TIMER_WHEEL_TICK_MS = 20;
+    static const int TIMER_WHEEL_SLOTS = 128;  /** Must cover MAX_REQ_TIMEOUT_MS */
 
     // Types
     /**
@@ -123,6 +157,7 @@ private:
     QVector<ObjectTimeInfo> objList;
     QQueue<ObjectQueueInfo> objQueue;
     QQueue<ObjectQueueInfo> objPriorityQueue;
+    QQueue<ObjectQueueInfo> objBulkQueue;
     QMap<TransactionKey, ObjectTransactionInfo*>transMap;
     QMutex* mutex;
     QTimer* updateTimer;
@@ -131,6 +166,20 @@ private:
     quint32 txErrors;
     quint32 txRetries;
 
+    // Transactions waiting for a response, at most window of them
+    int window;
+    int windowAcks;
+    qint64 windowDecreaseMs;
+    int bulkPending;
+    QElapsedTimer clock;
+    qint32 srttMs;          /** Smoothed round trip time, 0 until measured */
+    qint32 rttVarMs;
+
+    // Timer wheel for the transaction timeouts
+    QTimer* wheelTimer;
+    QVector< QList<TransactionKey> > wheel;
+    quint32 wheelTick;
+
     // Methods
     void registerObject(UAVObject* obj);
     void addObject(UAVObject* obj);
@@ -140,7 +189,13 @@ private:
     void processObjectUpdates(UAVObject* obj, EventMask event, bool allInstances, bool priority);
     void processObjectTransaction(ObjectTransactionInfo *transInfo);
     void processObjectQueue();
-    bool updateTransactionMap(UAVObject* obj, bool request);
+    bool processNextQueued();
+    bool startsTransaction(const ObjectQueueInfo &objInfo);
+    void failBulkRequests();
+    bool completeTransaction(UAVObject* obj, bool request, bool success, bool nacked);
+    void transactionTimeout(ObjectTransactionInfo *transInfo);
+    void updateRtt(qint32 sampleMs);
+    qint32 requestTimeout();
 
 
 private slots:
@@ -156,6 +211,7 @@ private slots:
     void transactionSuccess(UAVObject* obj);
     void transactionFailure(UAVObject* obj);
     void transactionRequestCompleted(UAVObject* obj);
+    void processTransactionTimeouts();
 
 };
 
@@ -30,6 +30,11 @@
 #include <extensionsystem/pluginmanager.h>
 #include <coreplugin/icore.h>
 #include <coreplugin/threadmanager.h>
+#include "utils/pathutils.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 
 TelemetryManager::TelemetryManager() :
     autopilotConnected(false)
@@ -45,6 +50,7 @@ TelemetryManager::TelemetryManager() :
     settings = pm->getObject<Core::Internal::GeneralSettings>();
     connect(settings, SIGNAL(generalSettingsChanged()), this, SLOT(onGeneralSettingsChanged()));
     connect(pm, SIGNAL(pluginsLoadEnded()), this, SLOT(onGeneralSettingsChanged()));
+    loadObjectCaches();
 }
 
 TelemetryManager::~TelemetryManager()
@@ -66,7 +72,7 @@ void TelemetryManager::onStart()
 {
     utalk = new UAVTalk(device, objMngr);
     telemetry = new Telemetry(utalk, objMngr);
-    telemetryMon = new TelemetryMonitor(objMngr, telemetry, sessions);
+    telemetryMon = new TelemetryMonitor(objMngr, telemetry, sessions, objectCaches);
     connect(telemetryMon, SIGNAL(connected()), this, SLOT(onConnect()));
     connect(telemetryMon, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
 }
@@ -81,6 +87,8 @@ void TelemetryManager::onStop()
 {
     telemetryMon->disconnect(this);
     sessions = telemetryMon->savedSessions();
+    objectCaches = telemetryMon->savedObjectCaches();
+    saveObjectCaches();
     delete telemetryMon;
     delete telemetry;
     delete utalk;
@@ -117,3 +125,53 @@ void TelemetryManager::onGeneralSettingsChanged()
         }
     }
 }
+
+/**
+ * Directory of the object caches, one file per board named after its CPU serial
+ */
+QString TelemetryManager::objectCacheDir()
+{
+    return Utils::PathUtils().GetStoragePath() + "objectcache" + QDir::separator();
+}
+
+/**
+ * Read the object caches stored by previous sessions
+ */
+void TelemetryManager::loadObjectCaches()
+{
+    QDir dir(objectCacheDir());
+    foreach (QString name, dir.entryList(QStringList("*.cache"), QDir::Files)) {
+        QFile file(dir.filePath(name));
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+
+        QDataStream in(&file);
+        TelemetryMonitor::ObjectCache cache;
+        in >> cache;
+        if (in.status() != QDataStream::Ok)
+            continue;
+
+        QByteArray serial = QByteArray::fromHex(QFileInfo(name).baseName().toLatin1());
+        objectCaches.insert(serial, cache);
+    }
+}
+
+/**
+ * Store the object caches so that the next GCS session can use them
+ */
+void TelemetryManager::saveObjectCaches()
+{
+    QDir dir(objectCacheDir());
+    if (!dir.exists() && !dir.mkpath("."))
+        return;
+
+    QHash<QByteArray, TelemetryMonitor::ObjectCache>::const_iterator i;
+    for (i = objectCaches.constBegin(); i != objectCaches.constEnd(); ++i) {
+        QFile file(dir.filePath(QString(i.key().toHex()) + ".cache"));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            continue;
+
+        QDataStream out(&file);
+        out << i.value();
+    }
+}
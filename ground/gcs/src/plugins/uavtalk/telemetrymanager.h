@@ -64,6 +64,10 @@ private slots:
     void onStop();
     void onGeneralSettingsChanged();
 private:
+    QString objectCacheDir();
+    void loadObjectCaches();
+    void saveObjectCaches();
+
     UAVObjectManager* objMngr;
     UAVTalk* utalk;
     Telemetry* telemetry;
@@ -71,6 +75,7 @@ private:
     QIODevice *device;
     bool autopilotConnected;
     QHash<quint16, QList<TelemetryMonitor::objStruc> > sessions;
+    QHash<QByteArray, TelemetryMonitor::ObjectCache> objectCaches;
     Core::Internal::GeneralSettings *settings;
 };
 
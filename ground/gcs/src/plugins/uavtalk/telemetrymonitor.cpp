@@ -3,7 +3,7 @@
  *
  * @file       telemetrymonitor.cpp
  * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
- * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014-2015
  * @addtogroup GCSPlugins GCS Plugins
  * @{
  * @addtogroup UAVTalkPlugin UAVTalk Plugin
@@ -44,6 +44,8 @@
 #define OBJECT_RETRIEVE_TIMEOUT             5000
 //IAP object is very important, retry if not able to get it the first time
 #define IAP_OBJECT_RETRIES                  3
+//Time to wait for all pages of the object hashes, whatever is missing after it is fetched
+#define OBJECT_HASHES_RETRIEVE_TIMEOUT      2000
 
 #ifdef TELEMETRYMONITOR_DEBUG
   #define TELEMETRYMONITOR_QXTLOG_DEBUG(...) qDebug()<<__VA_ARGS__
@@ -51,20 +53,39 @@
   #define TELEMETRYMONITOR_QXTLOG_DEBUG(...)
 #endif	// TELEMETRYMONITOR_DEBUG
 
+/**
+ * Hash of the packed object like the autopilot computes it, a CRC32 with
+ * the polynomial 0x04C11DB7 processed most significant bit first
+ */
+static quint32 objectHash(const QByteArray &data)
+{
+    quint32 crc = 0;
+    foreach (char c, data)
+    {
+        crc ^= (quint32)(quint8)c << 24;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+    }
+    return crc;
+}
+
 /**
  * Constructor
  */
-TelemetryMonitor::TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QHash<quint16, QList<objStruc> > sessions) :
+TelemetryMonitor::TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QHash<quint16, QList<objStruc> > sessions,
+                                   QHash<QByteArray, ObjectCache> objectCaches) :
     connectionStatus(CON_DISCONNECTED),
     objMngr(objMngr),
     tel(tel),
     numberOfObjects(0),
     retries(0),
     isManaged(true),
-    sessions(sessions)
+    sessions(sessions),
+    objectCaches(objectCaches)
 {
     sessionID = QDateTime::currentDateTime().toTime_t();
     this->connectionTimer = new QTime();
+    this->syncTimer = new QTime();
     // Create mutex
     mutex = new QMutex(QMutex::Recursive);
 
@@ -73,6 +94,7 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QH
     flightStatsObj = FlightTelemetryStats::GetInstance(objMngr);
 
     sessionObj = SessionManaging::GetInstance(objMngr);
+    hashesObj = ObjectHashes::GetInstance(objMngr);
 
     // Listen for flight stats updates
     connect(flightStatsObj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(flightStatsUpdated(UAVObject*)));
@@ -85,10 +107,13 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QH
     objectRetrieveTimeout->setSingleShot(true);
     sessionInitialRetrieveTimeout = new QTimer(this);
     sessionInitialRetrieveTimeout->setSingleShot(true);
+    hashesRetrieveTimeout = new QTimer(this);
+    hashesRetrieveTimeout->setSingleShot(true);
     connect(statsTimer, SIGNAL(timeout()), this, SLOT(processStatsUpdates()));
     connect(sessionRetrieveTimeout,SIGNAL(timeout()),this,SLOT(sessionRetrieveTimeoutCB()));
     connect(sessionInitialRetrieveTimeout,SIGNAL(timeout()),this,SLOT(sessionInitialRetrieveTimeoutCB()));
     connect(objectRetrieveTimeout,SIGNAL(timeout()),this,SLOT(objectRetrieveTimeoutCB()));
+    connect(hashesRetrieveTimeout,SIGNAL(timeout()),this,SLOT(hashesRetrieveTimeoutCB()));
     statsTimer->start(STATS_CONNECT_PERIOD_MS);
 
     Core::ConnectionManager *cm = Core::ICore::instance()->connectionManager();
@@ -96,7 +121,9 @@ TelemetryMonitor::TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QH
     connect(this,SIGNAL(disconnected()),cm,SLOT(telemetryDisconnected()));
     connect(this,SIGNAL(telemetryUpdated(double,double)),cm,SLOT(telemetryUpdated(double,double)));
     connect(sessionObj,SIGNAL(objectUnpacked(UAVObject*)),this,SLOT(sessionObjUnpackedCB(UAVObject*)));
+    connect(hashesObj,SIGNAL(objectUnpacked(UAVObject*)),this,SLOT(hashesObjUnpackedCB(UAVObject*)));
     connect(objMngr,SIGNAL(newInstance(UAVObject*)),this,SLOT(newInstanceSlot(UAVObject*)));
+    connect(tel, SIGNAL(bulkRequestCompleted()), this, SLOT(objectRetrievalCompleted()));
 
     ExtensionSystem::PluginManager* pm = ExtensionSystem::PluginManager::instance();
     settings=pm->getObject<Core::Internal::GeneralSettings>();
@@ -123,14 +150,37 @@ TelemetryMonitor::~TelemetryMonitor() {
 }
 
 /**
- * Initiate object retrieval, initialize queue with objects to be retrieved.
+ * Initiate object retrieval. The autopilot first sends the hashes of its
+ * settings and metaobjects, what matches the cache of the board is not
+ * fetched again.
  */
 void TelemetryMonitor::startRetrievingObjects()
+{
+    boardSerial.clear();
+    boardHashes.clear();
+    hashPagesReceived.clear();
+    if (isManaged && hashesObj->getIsPresentOnHardware())
+    {
+        TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 connectionStatus changed to CON_RETRIEVING_HASHES").arg(Q_FUNC_INFO));
+        connectionStatus = CON_RETRIEVING_HASHES;
+        hashesRetrieveTimeout->start(OBJECT_HASHES_RETRIEVE_TIMEOUT);
+        hashesObj->updated();
+        return;
+    }
+    retrieveObjects();
+}
+
+/**
+ * Request all the objects that aren't restored from the cache at once.
+ * Telemetry keeps as many requests on the link as it can carry.
+ */
+void TelemetryMonitor::retrieveObjects()
 {
     TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 connectionStatus changed to CON_RETRIEVING_OBJECT").arg(Q_FUNC_INFO));
     connectionStatus = CON_RETRIEVING_OBJECTS;
     // Get all objects, add metaobjects, settings and data objects with OnChange update mode to the queue
-    queue.empty();
+    QList<UAVObject*> queue;
+    int restored = 0;
     retries = 0;
     objectRetrieveTimeout->start(OBJECT_RETRIEVE_TIMEOUT);
     foreach(UAVObjectManager::ObjectMap map, objMngr->getObjects().values())
@@ -149,18 +199,29 @@ void TelemetryMonitor::startRetrievingObjects()
                 TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 %1 not present on hardware, skipping").arg(Q_FUNC_INFO).arg(obj->getName()));
                 continue;
             }
-            queue.enqueue(dobj->getMetaObject());
+            if (restoreFromCache(dobj->getMetaObject()))
+                ++restored;
+            else
+                queue.append(dobj->getMetaObject());
             if ( dobj->isSettings() )
             {
-                TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 queing settings object %1").arg(Q_FUNC_INFO).arg(dobj->getName()));
-                queue.enqueue(obj);
+                if (restoreFromCache(obj))
+                {
+                    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 settings object %1 restored from the cache").arg(Q_FUNC_INFO).arg(dobj->getName()));
+                    ++restored;
+                }
+                else
+                {
+                    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 queing settings object %1").arg(Q_FUNC_INFO).arg(dobj->getName()));
+                    queue.append(obj);
+                }
             }
             else
             {
                 if ( UAVObject::GetFlightTelemetryUpdateMode(mdata) == UAVObject::UPDATEMODE_ONCHANGE )
                 {
                     TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 queing UPDATEMODE_ONCHANGE object %1").arg(Q_FUNC_INFO).arg(dobj->getName()));
-                    queue.enqueue(obj);
+                    queue.append(obj);
                 }
                 else
                 {
@@ -170,9 +231,67 @@ void TelemetryMonitor::startRetrievingObjects()
         }
     }
     // Start retrieving
-    TELEMETRYMONITOR_QXTLOG_DEBUG(QString(tr("Starting to retrieve meta and settings objects from the autopilot (%1 objects)"))
-                                  .arg( queue.length()));
-    retrieveNextObject();
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString(tr("Starting to retrieve meta and settings objects from the autopilot (%1 objects, %2 cached)"))
+                                  .arg( queue.length()).arg(restored));
+    foreach (UAVObject* obj, queue)
+    {
+        connect(obj, SIGNAL(transactionCompleted(UAVObject*,bool)), this, SLOT(transactionCompleted(UAVObject*,bool)));
+    }
+    tel->requestObjects(queue);
+}
+
+/**
+ * Restore an object from the cache of the board if the autopilot has the
+ * same content
+ * @returns true if it doesn't need to be fetched
+ */
+bool TelemetryMonitor::restoreFromCache(UAVObject *obj)
+{
+    if (!obj->isSingleInstance() || !boardHashes.contains(obj->getObjID()))
+        return false;
+
+    QByteArray data = objectCaches.value(boardSerial).value(obj->getObjID());
+    if (data.size() != (int)obj->getNumBytes() || objectHash(data) != boardHashes.value(obj->getObjID()))
+        return false;
+
+    obj->unpack((const quint8 *)data.constData());
+    return true;
+}
+
+/**
+ * Remember the settings and metaobjects of the board for the next connection
+ */
+void TelemetryMonitor::updateObjectCache()
+{
+    if (boardSerial.isEmpty())
+        return;
+
+    ObjectCache &cache = objectCaches[boardSerial];
+    foreach(UAVObjectManager::ObjectMap map, objMngr->getObjects().values())
+    {
+        UAVDataObject* dobj = dynamic_cast<UAVDataObject*>(map.first());
+        if (dobj == NULL || !dobj->getIsPresentOnHardware())
+            continue;
+
+        QList<UAVObject*> objs;
+        objs.append(dobj->getMetaObject());
+        if (dobj->isSettings() && dobj->isSingleInstance())
+            objs.append(dobj);
+
+        foreach (UAVObject* obj, objs)
+        {
+            QByteArray data(obj->getNumBytes(), 0);
+            obj->pack((quint8 *)data.data());
+            cache.insert(obj->getObjID(), data);
+        }
+    }
+}
+
+QHash<QByteArray, TelemetryMonitor::ObjectCache> TelemetryMonitor::savedObjectCaches()
+{
+    if (connectionStatus == CON_CONNECTED_MANAGED || connectionStatus == CON_CONNECTED_UNMANAGED)
+        updateObjectCache();
+    return objectCaches;
 }
 
 void TelemetryMonitor::changeObjectInstances(quint32 objID, quint32 instID, bool delayed)
@@ -230,44 +349,49 @@ void TelemetryMonitor::changeObjectInstances(quint32 objID, quint32 instID, bool
 }
 
 /**
- * Retrieve the next object in the queue
+ * Called when all the requested objects were retrieved, or failed
  */
-void TelemetryMonitor::retrieveNextObject()
+void TelemetryMonitor::objectRetrievalCompleted()
 {
-    // If queue is empty return
-    if ( queue.isEmpty() )
+    QMutexLocker locker(mutex);
+    if (connectionStatus != CON_RETRIEVING_OBJECTS)
+        return;
+
+    GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
+    if ( gcsStats.Status != GCSTelemetryStats::STATUS_CONNECTED )
     {
-        TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 Object retrieval completed").arg(Q_FUNC_INFO));
-        if(isManaged)
-        {
-            TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 connectionStatus set to CON_CONNECTED_MANAGED( %1 )").arg(Q_FUNC_INFO).arg(connectionStatus));
-            connectionStatus = CON_CONNECTED_MANAGED;            
-        }
-        else
-        {
-            TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 connectionStatus set to CON_CONNECTED_MANAGED( %1 )").arg(Q_FUNC_INFO).arg(connectionStatus));
-            connectionStatus = CON_CONNECTED_UNMANAGED;
-        }
-        //restart periodic updates on the FC
-        sessionObj->setObjectOfInterestIndex(0xFF);
-        sessionObj->updated();
-        foreach (UAVDataObject * uavo, delayedUpdate) {
-            uavo->setIsPresentOnHardware(true);
-        }
-        delayedUpdate.clear();
-        emit connected();
+        TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 connection lost while retrieving objects, stopped object retrievel").arg(Q_FUNC_INFO));
+        objectRetrieveTimeout->stop();
         sessionRetrieveTimeout->stop();
         sessionInitialRetrieveTimeout->stop();
-        objectRetrieveTimeout->stop();
+        connectionStatus = CON_DISCONNECTED;
         return;
     }
-    // Get next object from the queue
-    UAVObject* obj = queue.dequeue();
-    // Connect to object
-    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 requestiong %1 from board INSTID:%2").arg(Q_FUNC_INFO).arg(obj->getName()).arg(obj->getInstID()));
-    connect(obj, SIGNAL(transactionCompleted(UAVObject*,bool)), this, SLOT(transactionCompleted(UAVObject*,bool)));
-    // Request update
-    obj->requestUpdateAllInstances();
+
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 Object retrieval completed").arg(Q_FUNC_INFO));
+    if(isManaged)
+    {
+        TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 connectionStatus set to CON_CONNECTED_MANAGED( %1 )").arg(Q_FUNC_INFO).arg(connectionStatus));
+        connectionStatus = CON_CONNECTED_MANAGED;
+    }
+    else
+    {
+        TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 connectionStatus set to CON_CONNECTED_MANAGED( %1 )").arg(Q_FUNC_INFO).arg(connectionStatus));
+        connectionStatus = CON_CONNECTED_UNMANAGED;
+    }
+    //restart periodic updates on the FC
+    sessionObj->setObjectOfInterestIndex(0xFF);
+    sessionObj->updated();
+    foreach (UAVDataObject * uavo, delayedUpdate) {
+        uavo->setIsPresentOnHardware(true);
+    }
+    delayedUpdate.clear();
+    updateObjectCache();
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 synchronized with the autopilot %1 ms after the handshake").arg(Q_FUNC_INFO).arg(syncTimer->elapsed()));
+    emit connected();
+    sessionRetrieveTimeout->stop();
+    sessionInitialRetrieveTimeout->stop();
+    objectRetrieveTimeout->stop();
 }
 
 /**
@@ -288,22 +412,6 @@ void TelemetryMonitor::transactionCompleted(UAVObject* obj, bool success)
     }
     // Disconnect from sending object
     obj->disconnect(this);
-    // Process next object if telemetry is still available
-    GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
-    if ( gcsStats.Status == GCSTelemetryStats::STATUS_CONNECTED )
-    {
-        connectionStatus = CON_RETRIEVING_OBJECTS;
-        retrieveNextObject();
-    }
-    else
-    {
-        TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 connection lost while retrieving objects, stopped object retrievel").arg(Q_FUNC_INFO));
-        queue.empty();
-        objectRetrieveTimeout->stop();
-        sessionRetrieveTimeout->stop();
-        sessionInitialRetrieveTimeout->stop();
-        connectionStatus = CON_DISCONNECTED;
-    }
 }
 
 /**
@@ -400,6 +508,7 @@ void TelemetryMonitor::sessionObjUnpackedCB(UAVObject *obj)
     case CON_SESSION_INITIALIZING:
         startSessionRetrieving(obj);
         break;
+    case CON_RETRIEVING_HASHES:
     case CON_RETRIEVING_OBJECTS:
         TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 received sessionManaging object during object retrievel, this shouldn't happen").arg(Q_FUNC_INFO));
         break;
@@ -409,9 +518,45 @@ void TelemetryMonitor::sessionObjUnpackedCB(UAVObject *obj)
     }
 }
 
+/**
+ * Collect the pages of object hashes, fetch the objects once all of them arrived
+ */
+void TelemetryMonitor::hashesObjUnpackedCB(UAVObject *obj)
+{
+    Q_UNUSED(obj);
+    QMutexLocker locker(mutex);
+    if (connectionStatus != CON_RETRIEVING_HASHES)
+        return;
+
+    ObjectHashes::DataFields hashes = hashesObj->getData();
+    boardSerial = QByteArray((const char *)hashes.CPUSerial, ObjectHashes::CPUSERIAL_NUMELEM);
+    for (quint32 i = 0; i < ObjectHashes::OBJECTID_NUMELEM; ++i)
+    {
+        if (hashes.ObjectID[i] != 0)
+            boardHashes.insert(hashes.ObjectID[i], hashes.Hash[i]);
+    }
+    hashPagesReceived.insert(hashes.Page);
+
+    if (hashPagesReceived.count() >= hashes.NumberOfPages)
+    {
+        hashesRetrieveTimeout->stop();
+        retrieveObjects();
+    }
+}
+
+void TelemetryMonitor::hashesRetrieveTimeoutCB()
+{
+    QMutexLocker locker(mutex);
+    if (connectionStatus != CON_RETRIEVING_HASHES)
+        return;
+
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 got %1 pages of object hashes, fetching the rest").arg(Q_FUNC_INFO).arg(hashPagesReceived.count()));
+    retrieveObjects();
+}
+
 void TelemetryMonitor::objectRetrieveTimeoutCB()
 {
-    queue.empty();
+    TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 object retrieval takes long, still waiting for the autopilot").arg(Q_FUNC_INFO));
 }
 
 void TelemetryMonitor::sessionInitialRetrieveTimeoutCB()
@@ -594,6 +739,7 @@ void TelemetryMonitor::processStatsUpdates()
     gcsStats.RxFailures += telStats.rxErrors;
     gcsStats.TxFailures += telStats.txErrors;
     gcsStats.TxRetries += telStats.txRetries;
+    gcsStats.PartialUpdates = GCSTelemetryStats::PARTIALUPDATES_TRUE;
 
     // Check for a connection timeout
     bool connectionTimeout;
@@ -616,6 +762,7 @@ void TelemetryMonitor::processStatsUpdates()
     {
         // Request connection
         gcsStats.Status = GCSTelemetryStats::STATUS_HANDSHAKEREQ;
+        syncTimer->start();
     }
     else if ( gcsStats.Status == GCSTelemetryStats::STATUS_HANDSHAKEREQ )
     {
@@ -669,6 +816,9 @@ void TelemetryMonitor::processStatsUpdates()
     if (gcsStats.Status == GCSTelemetryStats::STATUS_DISCONNECTED && gcsStats.Status != oldStatus)
     {
         statsTimer->setInterval(STATS_CONNECT_PERIOD_MS);
+        if (connectionStatus == CON_CONNECTED_MANAGED || connectionStatus == CON_CONNECTED_UNMANAGED)
+            updateObjectCache();
+        hashesRetrieveTimeout->stop();
         connectionStatus = CON_DISCONNECTED;
         ExtensionSystem::PluginManager* pm = ExtensionSystem::PluginManager::instance();
         Core::Internal::GeneralSettings * settings=pm->getObject<Core::Internal::GeneralSettings>();
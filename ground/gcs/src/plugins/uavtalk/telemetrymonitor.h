@@ -3,7 +3,7 @@
  *
  * @file       telemetrymonitor.cpp
  * @author     The OpenPilot Team, http://www.openpilot.org Copyright (C) 2010.
- * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014-2015
  * @addtogroup GCSPlugins GCS Plugins
  * @{
  * @addtogroup UAVTalkPlugin UAVTalk Plugin
@@ -31,6 +31,7 @@
 
 #include <QObject>
 #include <QQueue>
+#include <QSet>
 #include <QTimer>
 #include <QTime>
 #include <QMutex>
@@ -41,6 +42,7 @@
 #include "systemstats.h"
 #include "telemetry.h"
 #include "sessionmanaging.h"
+#include "objecthashes.h"
 #include <coreplugin/generalsettings.h>
 #include <extensionsystem/pluginmanager.h>
 
@@ -55,9 +57,14 @@ public:
         quint32 instID;
     };
 
-    TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QHash<quint16, QList<objStruc> > sessions);
+    //! Packed settings and metaobjects of one board by object ID
+    typedef QHash<quint32, QByteArray> ObjectCache;
+
+    TelemetryMonitor(UAVObjectManager* objMngr, Telemetry* tel, QHash<quint16, QList<objStruc> > sessions,
+                     QHash<QByteArray, ObjectCache> objectCaches);
     ~TelemetryMonitor();
     QHash<quint16, QList<objStruc> > savedSessions() {return sessions;}
+    QHash<QByteArray, ObjectCache> savedObjectCaches();
 signals:
     void connected();
     void disconnected();
@@ -70,6 +77,9 @@ public slots:
     void checkSessionObjNacked(UAVObject*, bool, bool);
 private slots:
     void sessionObjUnpackedCB(UAVObject*obj);
+    void hashesObjUnpackedCB(UAVObject*obj);
+    void hashesRetrieveTimeoutCB();
+    void objectRetrievalCompleted();
     void objectRetrieveTimeoutCB();
     void sessionRetrieveTimeoutCB();
     void sessionInitialRetrieveTimeoutCB();
@@ -77,27 +87,31 @@ private slots:
     void newInstanceSlot(UAVObject*);
 private:
     QList<UAVDataObject *> delayedUpdate;
-    enum connectionStatusEnum {CON_DISCONNECTED, CON_INITIALIZING, CON_SESSION_INITIALIZING, CON_RETRIEVING_OBJECTS, CON_CONNECTED_UNMANAGED,CON_CONNECTED_MANAGED};
+    enum connectionStatusEnum {CON_DISCONNECTED, CON_INITIALIZING, CON_SESSION_INITIALIZING, CON_RETRIEVING_HASHES, CON_RETRIEVING_OBJECTS, CON_CONNECTED_UNMANAGED,CON_CONNECTED_MANAGED};
     static const int STATS_UPDATE_PERIOD_MS = 4000;
     static const int STATS_CONNECT_PERIOD_MS = 2000;
     static const int CONNECTION_TIMEOUT_MS = 8000;
     connectionStatusEnum connectionStatus;
     UAVObjectManager* objMngr;
     Telemetry* tel;
-    QQueue<UAVObject*> queue;
     GCSTelemetryStats* gcsStatsObj;
     FlightTelemetryStats* flightStatsObj;
     QTimer* statsTimer;
     QMutex* mutex;
     QTime* connectionTimer;
+    QTime* syncTimer;
     SessionManaging* sessionObj;
+    ObjectHashes* hashesObj;
     void startRetrievingObjects();
-    void retrieveNextObject();
+    void retrieveObjects();
+    bool restoreFromCache(UAVObject *obj);
+    void updateObjectCache();
     quint16 sessionID;
     quint8 numberOfObjects;
     QTimer* objectRetrieveTimeout;
     QTimer* sessionRetrieveTimeout;
     QTimer* sessionInitialRetrieveTimeout;
+    QTimer* hashesRetrieveTimeout;
     int retries;
     void changeObjectInstances(quint32 objID, quint32 instID, bool delayed);
     void startSessionRetrieving(UAVObject *session);
@@ -105,6 +119,10 @@ private:
     bool isManaged;
     QHash<quint16, QList<objStruc> > sessions;
     int sessionObjRetries;
+    QByteArray boardSerial;
+    QHash<quint32, quint32> boardHashes;
+    QSet<quint8> hashPagesReceived;
+    QHash<QByteArray, ObjectCache> objectCaches;
     Core::Internal::GeneralSettings *settings;
 };
 
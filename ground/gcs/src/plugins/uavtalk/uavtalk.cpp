@@ -327,6 +327,19 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
                 {
                     rxLength = 0;
                 }
+                else if (rxType == TYPE_OBJ_FIELDS)
+                {
+                    // Field updates carry a variable length payload: offset + data
+                    qint32 fieldsLength = packetSize - rxPacketLength - (rxObj->isSingleInstance() ? 0 : 2);
+                    if (fieldsLength < 2 || fieldsLength > (qint32)rxObj->getNumBytes() + 2)
+                    {
+                        stats.rxErrors++;
+                        rxState = STATE_SYNC;
+                        UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (bad field update size)");
+                        break;
+                    }
+                    rxLength = fieldsLength;
+                }
                 else
                 {
                     rxLength = rxObj->getNumBytes();
@@ -407,9 +420,6 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 
         case STATE_DATA:
 
-            // Update CRC
-            rxCS = updateCRC(rxCS, rxbyte);
-
             rxBuffer[rxCount++] = rxbyte;
             if (rxCount < rxLength)
             {
@@ -417,6 +427,9 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
                 break;
             }
 
+            // Update CRC over the whole payload
+            rxCS = updateCRC(rxCS, rxBuffer, rxLength);
+
             rxState = STATE_CS;
             UAVTALK_QXTLOG_DEBUG("UAVTalk: Data->CSum");
             rxCount = 0;
@@ -526,6 +539,21 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8*
             error = true;
         }
         break;
+    case TYPE_OBJ_FIELDS: // We have received an update of some fields of an object
+        // All instances, not allowed for field updates
+        if (!allInstances)
+        {
+            obj = updateObjectFields(objId, instId, data, length);
+            if (obj == NULL)
+            {
+                error = true;
+            }
+        }
+        else
+        {
+            error = true;
+        }
+        break;
     case TYPE_OBJ_REQ:  // We are being asked for an object
         // Get object, if all instances are requested get instance 0 of the object
         if (allInstances)
@@ -638,6 +666,35 @@ UAVObject* UAVTalk::updateObject(quint32 objId, quint16 instId, quint8* data)
 }
 
 
+/**
+ * Update a byte range of an existing object instance. The data starts with
+ * the little endian offset of the range, followed by its bytes. Instances
+ * are not created here since the rest of their data would be unknown.
+ */
+UAVObject* UAVTalk::updateObjectFields(quint32 objId, quint16 instId, quint8* data, qint32 length)
+{
+    UAVObject* obj = objMngr->getObject(objId, instId);
+    if (obj == NULL || length < 2)
+    {
+        return NULL;
+    }
+
+    quint16 offset = qFromLittleEndian<quint16>(data);
+    qint32 size = length - 2;
+    if (offset + size > (qint32)obj->getNumBytes())
+    {
+        return NULL;
+    }
+
+    // Patch the range into the packed object and unpack it back
+    QByteArray packed(obj->getNumBytes(), 0);
+    obj->pack((quint8*)packed.data());
+    memcpy(packed.data() + offset, &data[2], size);
+    obj->unpack((const quint8*)packed.constData());
+    return obj;
+}
+
+
 /**
  * Send an object through the telemetry link.
  * \param[in] obj Object to send
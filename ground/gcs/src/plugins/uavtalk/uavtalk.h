@@ -83,6 +83,7 @@ protected:
     static const int TYPE_OBJ_ACK = (TYPE_VER | 0x02);
     static const int TYPE_ACK = (TYPE_VER | 0x03);
     static const int TYPE_NACK = (TYPE_VER | 0x04);
+    static const int TYPE_OBJ_FIELDS = (TYPE_VER | 0x05);
 
     static const int MIN_HEADER_LENGTH = 8; // sync(1), type (1), size(2), object ID(4)
     static const int MAX_HEADER_LENGTH = 10; // sync(1), type (1), size(2), object ID (4), instance ID(2, not used in single objects)
@@ -131,6 +132,7 @@ protected:
     bool objectTransaction(UAVObject* obj, quint8 type, bool allInstances);
     virtual bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8* data, qint32 length);
     UAVObject* updateObject(quint32 objId, quint16 instId, quint8* data);
+    UAVObject* updateObjectFields(quint32 objId, quint16 instId, quint8* data, qint32 length);
     bool transmitNack(quint32 objId);
     bool transmitObject(UAVObject* obj, quint8 type, bool allInstances);
     bool transmitSingleObject(UAVObject* obj, quint8 type, bool allInstances);
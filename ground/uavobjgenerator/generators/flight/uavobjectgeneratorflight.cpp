@@ -156,6 +156,11 @@ bool UAVObjectGeneratorFlight::process_object(ObjectInfo* info)
     for (int n = 0; n < info->fields.length(); ++n)
     {
         enums.append(QString("// Field %1 information\r\n").arg(info->fields[n]->name));
+        // Bit of the field in the event field masks, fields past the 32nd share the last bit
+        enums.append( QString("#define %1_FIELDMASK_%2 ((uint32_t)1 << %3)\r\n")
+                      .arg( info->name.toUpper() )
+                      .arg( info->fields[n]->name.toUpper() )
+                      .arg( qMin(n, 31) ) );
         // Only for enum types
         if (info->fields[n]->type == FIELDTYPE_ENUM)
         {
@@ -217,61 +222,46 @@ bool UAVObjectGeneratorFlight::process_object(ObjectInfo* info)
     }
     outInclude.replace(QString("$(DATAFIELDINFO)"), enums);
 
-    // Replace the $(INITFIELDS) tag
+    // Replace the $(INITFIELDS) tag, the defaults are emitted as designated
+    // initializers of a const structure so that they end up in flash
     QString initfields;
     for (int n = 0; n < info->fields.length(); ++n)
     {
         if (!info->fields[n]->defaultValues.isEmpty() )
         {
-            // For non-array fields
-            if ( info->fields[n]->numElements == 1)
+            QStringList values;
+            for (int idx = 0; idx < info->fields[n]->numElements; ++idx)
             {
                 if ( info->fields[n]->type == FIELDTYPE_ENUM )
                 {
-                    initfields.append( QString("\tdata.%1 = %2;\r\n")
-                                .arg( info->fields[n]->name )
-                                .arg( info->fields[n]->options.indexOf( info->fields[n]->defaultValues[0] ) ) );
+                    values.append( QString("%1")
+                                .arg( info->fields[n]->options.indexOf( info->fields[n]->defaultValues[idx] ) ) );
                 }
                 else if ( info->fields[n]->type == FIELDTYPE_FLOAT32 )
                 {
-                    initfields.append( QString("\tdata.%1 = %2;\r\n")
-                                .arg( info->fields[n]->name )
-                                .arg( info->fields[n]->defaultValues[0].toFloat() ) );
+                    values.append( QString("%1")
+                                .arg( info->fields[n]->defaultValues[idx].toFloat() ) );
                 }
                 else
                 {
-                    initfields.append( QString("\tdata.%1 = %2;\r\n")
-                                .arg( info->fields[n]->name )
-                                .arg( info->fields[n]->defaultValues[0].toInt() ) );
+                    values.append( QString("%1")
+                                .arg( info->fields[n]->defaultValues[idx].toInt() ) );
                 }
             }
+
+            // For non-array fields
+            if ( info->fields[n]->numElements == 1)
+            {
+                initfields.append( QString("\t.%1 = %2,\r\n")
+                            .arg( info->fields[n]->name )
+                            .arg( values[0] ) );
+            }
             else
             {
                 // Initialize all fields in the array
-                for (int idx = 0; idx < info->fields[n]->numElements; ++idx)
-                {
-                    if ( info->fields[n]->type == FIELDTYPE_ENUM )
-                    {
-                        initfields.append( QString("\tdata.%1[%2] = %3;\r\n")
-                                    .arg( info->fields[n]->name )
-                                    .arg( idx )
-                                    .arg( info->fields[n]->options.indexOf( info->fields[n]->defaultValues[idx] ) ) );
-                    }
-                    else if ( info->fields[n]->type == FIELDTYPE_FLOAT32 )
-                    {
-                        initfields.append( QString("\tdata.%1[%2] = %3;\r\n")
-                                    .arg( info->fields[n]->name )
-                                    .arg( idx )
-                                    .arg( info->fields[n]->defaultValues[idx].toFloat() ) );
-                    }
-                    else
-                    {
-                        initfields.append( QString("\tdata.%1[%2] = %3;\r\n")
-                                    .arg( info->fields[n]->name )
-                                    .arg( idx )
-                                    .arg( info->fields[n]->defaultValues[idx].toInt() ) );
-                    }
-                }
+                initfields.append( QString("\t.%1 = { %2 },\r\n")
+                            .arg( info->fields[n]->name )
+                            .arg( values.join(", ") ) );
             }
         }
     }
@@ -293,10 +283,12 @@ bool UAVObjectGeneratorFlight::process_object(ObjectInfo* info)
 							.arg( info->name )
 							.arg( info->fields[n]->name ) );
 				setgetfields.append( QString("{\r\n") );
-				setgetfields.append( QString("\tUAVObjSetDataField(%1Handle(), (void*)New%2, offsetof( %1Data, %2), sizeof(%3));\r\n")
+				setgetfields.append( QString("\tUAVObjSetDataFieldMask(%1Handle(), (void*)New%2, offsetof( %1Data, %2), sizeof(%3), %4_FIELDMASK_%5);\r\n")
 							.arg( info->name )
 							.arg( info->fields[n]->name )
-							.arg( fieldTypeStrC[info->fields[n]->type] ) );
+							.arg( fieldTypeStrC[info->fields[n]->type] )
+							.arg( info->name.toUpper() )
+							.arg( info->fields[n]->name.toUpper() ) );
 				setgetfields.append( QString("}\r\n") );
 
 				/* GET */
@@ -321,11 +313,13 @@ bool UAVObjectGeneratorFlight::process_object(ObjectInfo* info)
 								.arg( info->name )
 								.arg( info->fields[n]->name ) );
 				setgetfields.append( QString("{\r\n") );
-				setgetfields.append( QString("\tUAVObjSetDataField(%1Handle(), (void*)New%2, offsetof( %1Data, %2), %3*sizeof(%4));\r\n")
+				setgetfields.append( QString("\tUAVObjSetDataFieldMask(%1Handle(), (void*)New%2, offsetof( %1Data, %2), %3*sizeof(%4), %5_FIELDMASK_%6);\r\n")
 								.arg( info->name )
 								.arg( info->fields[n]->name )
 								.arg( info->fields[n]->numElements )
-								.arg( fieldTypeStrC[info->fields[n]->type] ) );
+								.arg( fieldTypeStrC[info->fields[n]->type] )
+								.arg( info->name.toUpper() )
+								.arg( info->fields[n]->name.toUpper() ) );
 				setgetfields.append( QString("}\r\n") );
 
 				/* GET */
@@ -9,13 +9,16 @@ UAVOBJSRCFILENAMES += flighttelemetrystats
 UAVOBJSRCFILENAMES += gcsreceiver
 UAVOBJSRCFILENAMES += gcstelemetrystats
 UAVOBJSRCFILENAMES += modulesettings
+UAVOBJSRCFILENAMES += objecthashes
 UAVOBJSRCFILENAMES += objectpersistence
+UAVOBJSRCFILENAMES += poolstats
 UAVOBJSRCFILENAMES += receiveractivity
 UAVOBJSRCFILENAMES += sessionmanaging
 UAVOBJSRCFILENAMES += systemalarms
 UAVOBJSRCFILENAMES += systemsettings
 UAVOBJSRCFILENAMES += systemstats
 UAVOBJSRCFILENAMES += taskinfo
+UAVOBJSRCFILENAMES += taskprofile
 UAVOBJSRCFILENAMES += watchdogstatus
 
 ifneq ($(UAVO_MINIMAL),YES)
@@ -54,6 +57,8 @@ UAVOBJSRCFILENAMES += stabilizationdesired
 UAVOBJSRCFILENAMES += stabilizationsettings
 UAVOBJSRCFILENAMES += systemident
 UAVOBJSRCFILENAMES += tabletinfo
+UAVOBJSRCFILENAMES += tracecontrol
+UAVOBJSRCFILENAMES += tracedata
 UAVOBJSRCFILENAMES += trimangles
 UAVOBJSRCFILENAMES += trimanglessettings
 UAVOBJSRCFILENAMES += txpidsettings
@@ -63,7 +63,20 @@ class ReplayFlightFunctions():
 
         self.uavo_list = uavo_list
 
-    def run_uavo_list(self):
+    def shift(self, t_meas, times, history, steps, idx):
+        """ Move a measurement taken at t_meas to the current time like
+        ins_history_shift does: returns how much the states in idx changed
+        since then, or zeros when t_meas isn't in the history
+        """
+
+        if steps < 2 or t_meas < times[0,0] or t_meas > times[steps-1,0]:
+            return numpy.zeros(len(idx))
+
+        now = numpy.array([self.sim.state[i] for i in idx])
+        then = numpy.array([numpy.interp(t_meas, times[:steps,0], history[:steps,i]) for i in idx])
+        return now - then
+
+    def run_uavo_list(self, gps_delay=0.0):
 
         import taulabs
         import math
@@ -98,6 +111,7 @@ class ReplayFlightFunctions():
         times = numpy.zeros((STEPS,1))
 
         ned_history = numpy.zeros((gps['Latitude'].size,3))
+        innovation = numpy.zeros((gps['Latitude'].size,2))
 
         steps = 0
         t = gyros['time'][0]
@@ -124,14 +138,18 @@ class ReplayFlightFunctions():
 
             if (gps_idx < gps['time'].size) and (gps['time'][gps_idx] < t):
                 pos = [(gps['Latitude'][gps_idx,0] - lat0) / 10e6 * math.pi / 180.0 * T[0], (gps['Longitude'][gps_idx,0] - lon0)  / 10e6 * math.pi / 180.0 * T[1], -(gps['Altitude'][gps_idx,0]-alt0)]
+                ned_history[gps_idx,:] = pos
+                if gps_delay > 0:
+                    pos = pos + self.shift(gps['time'][gps_idx] - gps_delay, times, history, steps, [0,1,2])
+                innovation[gps_idx,:] = [pos[0] - self.sim.state[0], pos[1] - self.sim.state[1]]
                 self.sim.correction(pos=pos)
-                ned_history[gps_idx,0] = pos[0]
-                ned_history[gps_idx,1] = pos[1]
-                ned_history[gps_idx,2] = pos[2]
                 gps_idx = gps_idx + 1
 
             if (vel_idx < vel['time'].size) and (vel['time'][vel_idx] < t):
-                self.sim.correction(vel=[vel['North'][vel_idx,0], vel['East'][vel_idx,0], vel['Down'][vel_idx,0]])
+                v = [vel['North'][vel_idx,0], vel['East'][vel_idx,0], vel['Down'][vel_idx,0]]
+                if gps_delay > 0:
+                    v = v + self.shift(vel['time'][vel_idx] - gps_delay, times, history, steps, [3,4,5])
+                self.sim.correction(vel=v)
                 vel_idx = vel_idx + 1
 
             if (mag_idx < mag['time'].size) and (mag['time'][mag_idx] < t):
@@ -145,6 +163,11 @@ class ReplayFlightFunctions():
             history[steps,:] = self.sim.state
             history_rpy[steps,:] = quat_rpy(self.sim.state[6:10])
             times[steps] = t
+
+        # With the right delay the filter agrees better with the GPS
+        print "GPS delay %.3f s, horizontal position innovation RMS %.3f m" % \
+            (gps_delay, math.sqrt(numpy.mean(numpy.sum(innovation[:gps_idx,:]**2, axis=1))))
+
         print "Plotting results"
        
         import matplotlib.pyplot as plt
@@ -210,6 +233,11 @@ if __name__ == '__main__':
     # Setup the command line arguments.
     parser = argparse.ArgumentParser(usage = USAGE, description = DESC)
 
+    parser.add_argument("-d", "--gps-delay",
+                        type    = float,
+                        default = 0.0,
+                        help    = "fuse the GPS this many seconds before it was received, like the firmware does with INSSettings.GpsLatency")
+
     parser.add_argument("logfile",
                         nargs = "+",
                         help  = "list of log files for processing")
@@ -219,4 +247,4 @@ if __name__ == '__main__':
 
     replay = ReplayFlightFunctions()
     replay.load(args.logfile[0])
-    replay.run_uavo_list()
\ No newline at end of file
+    replay.run_uavo_list(gps_delay=args.gps_delay)
\ No newline at end of file